@@ -4,7 +4,9 @@ TEMPLATE        = app
 DESTDIR         = $$OUT_PWD/..
 DEPENDPATH     += src 
 INCLUDEPATH    += src $$PWD/../lib/src
-SOURCES        += src/main.cpp
+SOURCES        += src/batch.cpp \
+                  src/main.cpp
+HEADERS        += src/batch.hpp
 
 CONFIG(release, debug|release): TARGET = dilay
 CONFIG(debug  , debug|release): TARGET = dilay_debug
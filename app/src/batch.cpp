@@ -0,0 +1,539 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QStringList>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "batch.hpp"
+#include "config.hpp"
+#include "dimension.hpp"
+#include "dynamic/mesh-distance-field.hpp"
+#include "dynamic/mesh.hpp"
+#include "import-export.hpp"
+#include "isosurface-extraction.hpp"
+#include "isosurface-extraction/grid.hpp"
+#include "mapped-memory.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/plane.hpp"
+#include "scene.hpp"
+#include "sketch/distance-field.hpp"
+#include "sketch/mesh.hpp"
+#include "thread-pool.hpp"
+#include "tool/sculpt/util/action.hpp"
+#include "util.hpp"
+
+namespace
+{
+  typedef std::chrono::steady_clock Clock;
+  typedef std::function<bool(const Config&, Scene&)> Step;
+
+  struct StepReport
+  {
+    std::string  name;
+    float        duration;
+    unsigned int numFaces;
+  };
+
+  /* The first remesh step can be distributed: processes that are given `--brick <i>/<n>` sample
+   * brick `i` of each remeshed mesh (cf. `IsosurfaceExtraction::brickRange`) and write the samples
+   * to their output, after which they stop.  The process that is given the outputs of all bricks
+   * by `--bricks <file,...>` reads their samples instead of sampling and continues.  All processes
+   * must be given the same input, steps and sample format.
+   */
+  struct Bricks
+  {
+    unsigned int               index;
+    unsigned int               number; // 0 if remeshing is not distributed
+    std::ofstream              output;
+    std::vector<std::ifstream> inputs;
+    bool                       isSampled;
+
+    Bricks ()
+      : index (0)
+      , number (0)
+      , isSampled (false)
+    {
+    }
+
+    bool isDistributed () const { return this->number > 0 && this->isSampled == false; }
+    bool isWorker () const { return this->number > 0 && this->inputs.empty (); }
+  };
+
+  int usage ()
+  {
+    std::cerr << "usage: dilay --batch [--threads <n>] [--out-of-core] [--meshes <i,j,...>] "
+                 "[--quantize] [--samples <float32|float16|narrow16|narrow8>] [--report <json>] "
+                 "[--brick <i>/<n> | --bricks <file,...>] "
+                 "<input> <output> [remesh=<resolution> | convert-sketches=<resolution> | "
+                 "mirror=<x|y|z> | decimate=<percentage> | smooth] ...\n";
+    return 1;
+  }
+
+  bool parseSampleFormat (const QString& name, IsosurfaceExtractionGrid::SampleFormat& format)
+  {
+    typedef IsosurfaceExtractionGrid::SampleFormat SampleFormat;
+
+    if (name == "float32")
+    {
+      format = SampleFormat::Float32;
+    }
+    else if (name == "float16")
+    {
+      format = SampleFormat::Float16;
+    }
+    else if (name == "narrow16")
+    {
+      format = SampleFormat::Narrow16;
+    }
+    else if (name == "narrow8")
+    {
+      format = SampleFormat::Narrow8;
+    }
+    else
+    {
+      return false;
+    }
+    return true;
+  }
+
+  std::vector<DynamicMesh*> dynamicMeshes (Scene& scene)
+  {
+    std::vector<DynamicMesh*> meshes;
+    scene.forEachMesh ([&meshes](DynamicMesh& mesh) { meshes.push_back (&mesh); });
+    return meshes;
+  }
+
+  bool remesh (const Config& config, Scene& scene, float resolution, Bricks& bricks)
+  {
+    const bool isDistributed = bricks.isDistributed ();
+
+    bricks.isSampled = bricks.isSampled || isDistributed;
+
+    for (DynamicMesh* mesh : dynamicMeshes (scene))
+    {
+      IsosurfaceExtractionGrid grid (mesh->bounds (), resolution);
+      DynamicMesh              result;
+
+      if (isDistributed && bricks.isWorker () == false)
+      {
+        for (unsigned int i = 0; i < bricks.number; i++)
+        {
+          glm::uvec3 begin, end;
+          IsosurfaceExtraction::brickRange (grid, i, bricks.number, begin, end);
+
+          if (grid.readSamples (bricks.inputs[i], begin, end) == false)
+          {
+            std::cerr << "brick " << i << " does not match the grid\n";
+            return false;
+          }
+        }
+        grid.makeMesh (result);
+      }
+      else
+      {
+        const std::shared_ptr<const DynamicMeshDistanceField> field =
+          DynamicMeshDistanceField::get (*mesh, resolution);
+
+        const IsosurfaceExtraction::DistanceCallback getDistance =
+          [&field](const glm::vec3& pos, float) { return field->distance (pos); };
+
+        if (field == nullptr)
+        {
+          return false;
+        }
+        else if (isDistributed)
+        {
+          glm::uvec3 begin, end;
+          IsosurfaceExtraction::brickRange (grid, bricks.index, bricks.number, begin, end);
+
+          if (IsosurfaceExtraction::sampleBrick (getDistance, grid, bricks.index,
+                                                 bricks.number) == false)
+          {
+            return false;
+          }
+          grid.writeSamples (bricks.output, begin, end);
+          continue;
+        }
+        else if (IsosurfaceExtraction::extract (getDistance, mesh->bounds (), resolution,
+                                                result) == false)
+        {
+          return false;
+        }
+      }
+
+      if (result.isEmpty ())
+      {
+        scene.deleteMesh (*mesh);
+      }
+      else
+      {
+        scene.replaceMesh (config, *mesh, result);
+      }
+    }
+    return true;
+  }
+
+  // cf. `ToolConvertSketch`
+  bool convertSketches (const Config& config, Scene& scene, float resolution)
+  {
+    std::vector<SketchMesh*> sketches;
+    scene.forEachMesh ([&sketches](SketchMesh& sketch) { sketches.push_back (&sketch); });
+
+    for (SketchMesh* sketch : sketches)
+    {
+      glm::vec3 min, max;
+      sketch->minMax (min, max);
+      sketch->optimizePaths ();
+
+      const SketchDistanceField                    field (*sketch);
+      const IsosurfaceExtraction::DistanceCallback getDistance =
+        [&field](const glm::vec3& pos, float upperBound) {
+          return field.distance (pos, upperBound);
+        };
+
+      DynamicMesh result;
+      if (IsosurfaceExtraction::extract (getDistance, PrimAABox (min, max), resolution, result) ==
+          false)
+      {
+        return false;
+      }
+      else if (result.isEmpty () == false)
+      {
+        ToolSculptAction::smoothMesh (scene.newDynamicMesh (config, std::move (result)));
+      }
+      scene.deleteMesh (*sketch);
+    }
+    return true;
+  }
+
+  // dynamic meshes are mirrored at the plane through the origin, sketches through their roots
+  bool mirror (Scene& scene, Dimension dimension)
+  {
+    const PrimPlane plane (glm::vec3 (0.0f), DimensionUtil::vector (dimension));
+
+    for (DynamicMesh* mesh : dynamicMeshes (scene))
+    {
+      if (mesh->mirror (plane) == false)
+      {
+        return false;
+      }
+    }
+    scene.forEachMesh ([dimension](SketchMesh& sketch) { sketch.mirror (dimension); });
+    return true;
+  }
+
+  bool decimate (Scene& scene, unsigned int percentage)
+  {
+    const CancellationToken token;
+
+    for (DynamicMesh* mesh : dynamicMeshes (scene))
+    {
+      mesh->prune ();
+      ToolSculptAction::simplifyMesh (*mesh, (mesh->numFaces () * percentage) / 100, token);
+      mesh->prune ();
+    }
+    return true;
+  }
+
+  bool smooth (Scene& scene)
+  {
+    for (DynamicMesh* mesh : dynamicMeshes (scene))
+    {
+      ToolSculptAction::smoothMesh (*mesh);
+    }
+    return true;
+  }
+
+  // loads only the given meshes and none of the sketches if `meshes` is not empty
+  bool load (const std::string& fileName, const std::vector<unsigned int>& meshes,
+             const Config& config, Scene& scene)
+  {
+    if (meshes.empty ())
+    {
+      return ImportExport::fromDlyFile (fileName, config, scene);
+    }
+
+    ImportExportContents contents;
+    if (contents.tableOfContentsFromDlyFile (fileName) == false)
+    {
+      return false;
+    }
+    for (unsigned int i : meshes)
+    {
+      if (i >= contents.numMeshes () || contents.loadMesh (i) == false)
+      {
+        return false;
+      }
+    }
+    contents.addMeshesToScene (config, scene);
+    return true;
+  }
+
+  bool parseStep (const QString& argument, Bricks& bricks, Step& step)
+  {
+    const QString name = argument.section ('=', 0, 0);
+    const QString value = argument.section ('=', 1);
+    bool          isValid = false;
+
+    if (name == "remesh" || name == "convert-sketches")
+    {
+      const float resolution = value.toFloat (&isValid);
+
+      isValid = isValid && resolution > 0.0f;
+      if (name == "remesh")
+      {
+        step = [resolution, &bricks](const Config& config, Scene& scene) {
+          return remesh (config, scene, resolution, bricks);
+        };
+      }
+      else
+      {
+        step = [resolution](const Config& config, Scene& scene) {
+          return convertSketches (config, scene, resolution);
+        };
+      }
+    }
+    else if (name == "mirror")
+    {
+      const Dimension dimension =
+        value == "y" ? Dimension::Y : (value == "z" ? Dimension::Z : Dimension::X);
+
+      isValid = value == "x" || value == "y" || value == "z";
+      step = [dimension](const Config&, Scene& scene) { return mirror (scene, dimension); };
+    }
+    else if (name == "decimate")
+    {
+      const unsigned int percentage = value.toUInt (&isValid);
+
+      isValid = isValid && percentage > 0 && percentage < 100;
+      step = [percentage](const Config&, Scene& scene) { return decimate (scene, percentage); };
+    }
+    else if (name == "smooth")
+    {
+      isValid = value.isEmpty ();
+      step = [](const Config&, Scene& scene) { return smooth (scene); };
+    }
+    return isValid;
+  }
+
+  void writeReport (std::ostream& stream, const std::vector<StepReport>& reports)
+  {
+    float total = 0.0f;
+
+    stream << "{\n  \"version\": \"" << DILAY_VERSION
+           << "\",\n  \"threads\": " << ThreadPool::global ().numThreads () << ",\n  \"steps\": [";
+    for (unsigned int i = 0; i < reports.size (); i++)
+    {
+      const StepReport& r = reports[i];
+
+      stream << (i == 0 ? "\n" : ",\n") << "    {\"step\": \"" << r.name
+             << "\", \"ms\": " << r.duration << ", \"faces\": " << r.numFaces << "}";
+      total += r.duration;
+    }
+    stream << "\n  ],\n  \"total-ms\": " << total << "\n}\n";
+  }
+}
+
+namespace Batch
+{
+  int run (const QStringList& arguments)
+  {
+    QStringList               positional;
+    std::string               reportFileName;
+    unsigned int              numThreads = 0;
+    std::vector<unsigned int> meshes;
+    bool                      quantize = false;
+    Bricks                    bricks;
+    QStringList               brickFileNames;
+
+    for (int i = 2; i < arguments.size (); i++)
+    {
+      if (arguments.at (i) == "--threads" && i + 1 < arguments.size ())
+      {
+        numThreads = arguments.at (++i).toUInt ();
+      }
+      else if (arguments.at (i) == "--out-of-core")
+      {
+        MappedMemory::enable (true);
+      }
+      else if (arguments.at (i) == "--meshes" && i + 1 < arguments.size ())
+      {
+        for (const QString& index : arguments.at (++i).split (','))
+        {
+          meshes.push_back (index.toUInt ());
+        }
+      }
+      else if (arguments.at (i) == "--quantize")
+      {
+        quantize = true;
+      }
+      else if (arguments.at (i) == "--samples" && i + 1 < arguments.size ())
+      {
+        IsosurfaceExtractionGrid::SampleFormat format;
+        if (parseSampleFormat (arguments.at (++i), format) == false)
+        {
+          std::cerr << "invalid sample format " << arguments.at (i).toStdString () << "\n";
+          return usage ();
+        }
+        IsosurfaceExtractionGrid::defaultSampleFormat (format);
+      }
+      else if (arguments.at (i) == "--report" && i + 1 < arguments.size ())
+      {
+        reportFileName = arguments.at (++i).toStdString ();
+      }
+      else if (arguments.at (i) == "--brick" && i + 1 < arguments.size ())
+      {
+        bool isIndex, isNumber;
+
+        bricks.index = arguments.at (++i).section ('/', 0, 0).toUInt (&isIndex);
+        bricks.number = arguments.at (i).section ('/', 1).toUInt (&isNumber);
+
+        if (isIndex == false || isNumber == false || bricks.index >= bricks.number)
+        {
+          std::cerr << "invalid brick " << arguments.at (i).toStdString () << "\n";
+          return usage ();
+        }
+      }
+      else if (arguments.at (i) == "--bricks" && i + 1 < arguments.size ())
+      {
+        brickFileNames = arguments.at (++i).split (',');
+      }
+      else
+      {
+        positional.append (arguments.at (i));
+      }
+    }
+
+    if (positional.size () < 2)
+    {
+      return usage ();
+    }
+
+    if (brickFileNames.isEmpty () == false)
+    {
+      if (bricks.number > 0)
+      {
+        return usage ();
+      }
+      bricks.number = (unsigned int) (brickFileNames.size ());
+
+      for (const QString& fileName : brickFileNames)
+      {
+        bricks.inputs.emplace_back (fileName.toStdString (), std::ios::binary);
+
+        if (bricks.inputs.back ().is_open () == false)
+        {
+          std::cerr << "could not read " << fileName.toStdString () << "\n";
+          return 1;
+        }
+      }
+    }
+
+    std::vector<Step> steps;
+    for (int i = 2; i < positional.size (); i++)
+    {
+      Step step;
+      if (parseStep (positional.at (i), bricks, step) == false)
+      {
+        std::cerr << "invalid step " << positional.at (i).toStdString () << "\n";
+        return usage ();
+      }
+      steps.push_back (step);
+    }
+
+    if (numThreads > 0)
+    {
+      ThreadPool::globalNumThreads (numThreads);
+    }
+
+    const std::string       input = positional.at (0).toStdString ();
+    const std::string       output = positional.at (1).toStdString ();
+    const Config            config;
+    Scene                   scene (config);
+    std::vector<StepReport> reports;
+
+    const auto runStep = [&config, &scene, &reports](const std::string& name, const Step& step) {
+      const Clock::time_point                        start = Clock::now ();
+      const bool                                     success = step (config, scene);
+      const std::chrono::duration<float, std::milli> duration = Clock::now () - start;
+
+      reports.push_back (StepReport{name, duration.count (), scene.numFaces ()});
+      std::cerr << name << ": " << duration.count () << "ms\n";
+      return success;
+    };
+
+    if (runStep ("load", [&input, &meshes](const Config& c, Scene& s) {
+          return load (input, meshes, c, s);
+        }) == false)
+    {
+      std::cerr << "could not read " << input << "\n";
+      return 1;
+    }
+
+    if (bricks.isWorker ())
+    {
+      bricks.output.open (output, std::ios::binary);
+
+      if (bricks.output.is_open () == false)
+      {
+        std::cerr << "could not write " << output << "\n";
+        return 1;
+      }
+    }
+
+    for (unsigned int i = 0; i < steps.size (); i++)
+    {
+      const std::string name = positional.at (int(i) + 2).toStdString ();
+
+      if (runStep (name, steps[i]) == false)
+      {
+        std::cerr << "could not apply " << name << "\n";
+        return 1;
+      }
+      else if (bricks.isWorker () && bricks.isSampled)
+      {
+        break;
+      }
+    }
+
+    if (bricks.number > 0 && bricks.isSampled == false)
+    {
+      std::cerr << "no remesh step to distribute\n";
+      return 1;
+    }
+    else if (bricks.isWorker ())
+    {
+      bricks.output.close ();
+    }
+
+    const Step save = [&output, quantize](const Config& config, Scene& s) {
+      return Util::hasSuffix (output, ".glb")
+               ? ImportExport::toGlbFile (output, s, quantize)
+               : ImportExport::toDlyFile (output, s, Util::hasSuffix (output, ".obj"),
+                                          config.get<int> ("editor/mesh/file-cache/min-faces"));
+    };
+    const bool isSaved =
+      bricks.isWorker () ? bricks.output.fail () == false : runStep ("save", save);
+
+    if (isSaved == false)
+    {
+      std::cerr << "could not write " << output << "\n";
+      return 1;
+    }
+
+    if (reportFileName.empty () == false)
+    {
+      std::ofstream file (reportFileName);
+      writeReport (file, reports);
+      return file ? 0 : 1;
+    }
+    return 0;
+  }
+}
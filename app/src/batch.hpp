@@ -0,0 +1,38 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_BATCH
+#define DILAY_BATCH
+
+class QStringList;
+
+/* Processes a file without a window or an OpenGL context:
+ *
+ *   dilay --batch [--threads <n>] [--out-of-core] [--meshes <i,j,...>] [--quantize]
+ *                 [--samples <float32|float16|narrow16|narrow8>] [--report <json>]
+ *                 <input> <output> [<step> ...]
+ *
+ * Steps are applied in order to all meshes of the input:
+ *
+ *   remesh=<resolution>            extracts the isosurfaces of dynamic meshes
+ *   convert-sketches=<resolution>  replaces sketches by their isosurfaces
+ *   mirror=<x|y|z>                 mirrors all meshes at the plane through the origin
+ *   decimate=<percentage>          simplifies dynamic meshes to a percentage of their faces
+ *   smooth                         smoothes dynamic meshes
+ *
+ * The output is written as Wavefront file if its name ends with `.obj`, as binary glTF file
+ * without sketches if its name ends with `.glb`, and in the binary format otherwise.  The report
+ * lists the duration of each step in milliseconds.  `--out-of-core` maps mesh data from temporary
+ * files, cf. `MappedMemory`.  `--meshes` reads only the given meshes of the input, which are found
+ * by its table of contents.  `--quantize` quantizes positions and normals of glTF files.
+ * `--samples` sets the format of the samples of remeshing and converting sketches, cf.
+ * `IsosurfaceExtractionGrid::SampleFormat`.
+ */
+namespace Batch
+{
+  // returns the exit code of the application
+  int run (const QStringList&);
+}
+
+#endif
@@ -6,10 +6,16 @@
 #include <QDir>
 #include <QLibraryInfo>
 #include <QStandardPaths>
+#include <exception>
+#include <thread>
+#include "batch.hpp"
 #include "cache.hpp"
 #include "config.hpp"
+#include "cpu-dispatch.hpp"
+#include "isosurface-extraction/grid.hpp"
+#include "mapped-memory.hpp"
 #include "opengl.hpp"
-#include "time-delta.hpp"
+#include "profiler.hpp"
 #include "util.hpp"
 #include "view/log.hpp"
 #include "view/main-window.hpp"
@@ -37,12 +43,22 @@ namespace
   }
 }
 
+// `dilay --batch ...` processes files without a window, cf. `Batch`
 int main (int argv, char** args)
 {
+  if (argv > 1 && QString (args[1]) == "--batch")
+  {
+    QCoreApplication app (argv, args);
+    QCoreApplication::setApplicationName ("Dilay");
+
+    return Batch::run (QCoreApplication::arguments ());
+  }
+
   backupCrashLog ();
   Log::initialize (ViewLog::logPath ().toStdString ());
   DILAY_INFO ("Version: %s", DILAY_VERSION);
   DILAY_INFO ("Architecture: %s", QSysInfo::buildCpuArchitecture ().toStdString ().c_str ());
+  DILAY_INFO ("Instruction set: %s", CpuDispatch::name (CpuDispatch::selected ()));
   DILAY_INFO ("OS: %s", QSysInfo::prettyProductName ().toStdString ().c_str ());
   DILAY_INFO ("Qt: %s", QLibraryInfo::version ().toString ().toStdString ().c_str ());
 
@@ -50,15 +66,47 @@ int main (int argv, char** args)
   QCoreApplication::setAttribute (Qt::AA_UseDesktopOpenGL);
   OpenGL::setDefaultFormat ();
 
+  // the configuration file is parsed while the application is initialized
+  const QString      configFileName = configPath ();
+  Config             config;
+  std::exception_ptr configError;
+  std::thread        configLoader ([&config, &configError, &configFileName]() {
+    try
+    {
+      if (configFileName.isEmpty () == false)
+      {
+        config.fromFile (configFileName.toStdString ());
+      }
+    }
+    catch (...)
+    {
+      configError = std::current_exception ();
+    }
+  });
+
   QApplication app (argv, args);
-  Config       config;
   Cache        cache;
 
-  if (configPath ().isEmpty () == false)
+  configLoader.join ();
+  if (configError)
+  {
+    std::rethrow_exception (configError);
+  }
+  MappedMemory::enable (config.get<bool> ("editor/mesh/out-of-core"));
+
+  if (config.get<bool> ("editor/opengl-debug/enabled"))
   {
-    config.fromFile (configPath ().toStdString ());
+    OpenGL::requestDebugContext ();
   }
 
+  // compact samples are clamped to a narrow band, which suffices for remeshing
+  typedef IsosurfaceExtractionGrid::SampleFormat SampleFormat;
+  const int sampleBits = config.get<int> ("editor/mesh/isosurface-sample-bits");
+
+  IsosurfaceExtractionGrid::defaultSampleFormat (
+    sampleBits == 16 ? SampleFormat::Narrow16
+                     : (sampleBits == 8 ? SampleFormat::Narrow8 : SampleFormat::Float32));
+
   ViewMainWindow mainWindow (config, cache);
   mainWindow.resize (config.get<int> ("window/initial-width"),
                      config.get<int> ("window/initial-height"));
@@ -77,6 +125,9 @@ int main (int argv, char** args)
       config.toFile (configDir.filePath ("dilay.config").toStdString ());
     }
   });
-  TimeDelta::initialize ();
+  Profiler::initialize (
+    QDir (QStandardPaths::writableLocation (QStandardPaths::ConfigLocation))
+      .filePath ("dilay-profile.json")
+      .toStdString ());
   return app.exec ();
 }
@@ -0,0 +1,85 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include <memory>
+#include <random>
+#include <vector>
+#include "bench-mesh.hpp"
+#include "benchmark.hpp"
+#include "dynamic/mesh-distance-field.hpp"
+#include "dynamic/mesh.hpp"
+#include "intersection.hpp"
+#include "isosurface-extraction.hpp"
+#include "mesh.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/ray.hpp"
+#include "util.hpp"
+
+namespace
+{
+  constexpr unsigned int numRepetitions = 10;
+  constexpr unsigned int numQueries = 1000;
+  constexpr float        resolution = 0.04f;
+}
+
+void BenchMesh::run ()
+{
+  Benchmark::forEachIcosphere ([](const Mesh& mesh) {
+    const unsigned int numFaces = mesh.numIndices () / 3;
+    DynamicMesh        dynamicMesh;
+
+    // includes the octree, which is deferred until the first query of a mesh
+    Benchmark::run ("dynamic-mesh-from-mesh", numFaces, numRepetitions,
+                    [&dynamicMesh]() { dynamicMesh.reset (); },
+                    [&dynamicMesh, &mesh]() {
+                      dynamicMesh.fromMesh (mesh);
+                      dynamicMesh.unsignedDistance (glm::vec3 (0.0f));
+                    });
+
+    std::default_random_engine            gen;
+    std::uniform_real_distribution<float> posD (-1.5f, 1.5f);
+    std::vector<glm::vec3>                points;
+    std::vector<PrimRay>                  rays;
+
+    for (unsigned int i = 0; i < numQueries; i++)
+    {
+      const glm::vec3 p (posD (gen), posD (gen), posD (gen));
+
+      points.push_back (p);
+      rays.emplace_back (3.0f * glm::normalize (p), -p);
+    }
+
+    Benchmark::run ("ray-picking", numFaces, numRepetitions, [&dynamicMesh, &rays]() {
+      Intersection intersection;
+      for (const PrimRay& ray : rays)
+      {
+        intersection.reset ();
+        dynamicMesh.intersects (ray, intersection);
+      }
+    });
+
+    Benchmark::run ("unsigned-distance", numFaces, numRepetitions, [&dynamicMesh, &points]() {
+      float sum = 0.0f;
+      for (const glm::vec3& p : points)
+      {
+        sum += dynamicMesh.unsignedDistance (p);
+      }
+      unused (sum);
+    });
+
+    const std::shared_ptr<const DynamicMeshDistanceField> field =
+      DynamicMeshDistanceField::get (dynamicMesh, resolution);
+    const IsosurfaceExtraction::DistanceCallback getDistance =
+      [&field](const glm::vec3& pos, float) { return field->distance (pos); };
+
+    DynamicMesh extractedMesh;
+    Benchmark::run ("isosurface-extraction", numFaces, numRepetitions,
+                    [&extractedMesh]() { extractedMesh.reset (); },
+                    [&getDistance, &dynamicMesh, &extractedMesh]() {
+                      IsosurfaceExtraction::extract (getDistance, dynamicMesh.mesh ().bounds (),
+                                                     resolution, extractedMesh);
+                    });
+  });
+}
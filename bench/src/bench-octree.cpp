@@ -0,0 +1,97 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include <random>
+#include <vector>
+#include "bench-octree.hpp"
+#include "benchmark.hpp"
+#include "dynamic/octree.hpp"
+#include "mesh.hpp"
+#include "primitive/ray.hpp"
+#include "primitive/sphere.hpp"
+#include "primitive/triangle.hpp"
+#include "util.hpp"
+
+namespace
+{
+  constexpr unsigned int numRepetitions = 10;
+  constexpr unsigned int numQueries = 1000;
+
+  void buildOctree (DynamicOctree& octree, const std::vector<PrimTriangle>& triangles)
+  {
+    octree.reset ();
+    octree.setupRoot (glm::vec3 (0.0f), 2.0f);
+
+    for (unsigned int i = 0; i < triangles.size (); i++)
+    {
+      octree.addElement (i, triangles[i].center (), triangles[i].maxDimExtent ());
+    }
+  }
+}
+
+void BenchOctree::run ()
+{
+  Benchmark::forEachIcosphere ([](const Mesh& mesh) {
+    const unsigned int        numFaces = mesh.numIndices () / 3;
+    std::vector<PrimTriangle> triangles;
+    std::vector<PrimSphere>   spheres;
+    std::vector<PrimRay>      rays;
+    DynamicOctree             octree;
+
+    for (unsigned int i = 0; i < mesh.numIndices (); i += 3)
+    {
+      triangles.emplace_back (mesh.vertex (mesh.index (i)), mesh.vertex (mesh.index (i + 1)),
+                              mesh.vertex (mesh.index (i + 2)));
+    }
+
+    std::default_random_engine            gen;
+    std::uniform_real_distribution<float> posD (-1.0f, 1.0f);
+
+    for (unsigned int i = 0; i < numQueries; i++)
+    {
+      const glm::vec3 p (posD (gen), posD (gen), posD (gen));
+
+      spheres.emplace_back (p, 0.1f);
+      rays.emplace_back (3.0f * glm::normalize (p), -p);
+    }
+
+    Benchmark::run ("octree-insert", numFaces, numRepetitions, [&octree, &triangles]() {
+      buildOctree (octree, triangles);
+    });
+
+    Benchmark::run ("octree-delete", numFaces, numRepetitions,
+                    [&octree, &triangles]() { buildOctree (octree, triangles); },
+                    [&octree, &triangles]() {
+                      for (unsigned int i = 0; i < triangles.size (); i++)
+                      {
+                        octree.deleteElement (i);
+                      }
+                    });
+
+    buildOctree (octree, triangles);
+
+    Benchmark::run ("octree-query-sphere", numFaces, numRepetitions, [&octree, &spheres]() {
+      unsigned int numHits = 0;
+      for (const PrimSphere& sphere : spheres)
+      {
+        octree.intersects (sphere, [&numHits](bool, unsigned int) { numHits++; });
+      }
+      unused (numHits);
+    });
+
+    // visits all candidates of each ray
+    Benchmark::run ("octree-query-ray", numFaces, numRepetitions, [&octree, &rays]() {
+      unsigned int numCandidates = 0;
+      for (const PrimRay& ray : rays)
+      {
+        octree.intersects (ray, [&numCandidates](const std::vector<unsigned int>& is) {
+          numCandidates += is.size ();
+          return Util::maxFloat ();
+        });
+      }
+      unused (numCandidates);
+    });
+  });
+}
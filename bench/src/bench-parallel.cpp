@@ -0,0 +1,45 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <vector>
+#include "bench-parallel.hpp"
+#include "benchmark.hpp"
+#include "parallel.hpp"
+
+namespace
+{
+  constexpr unsigned int numRepetitions = 10;
+}
+
+// the number of elements is recorded in place of the number of faces
+void BenchParallel::run ()
+{
+  for (unsigned int n : {1u << 16, 1u << 20, 1u << 22})
+  {
+    std::default_random_engine                  gen;
+    std::uniform_int_distribution<unsigned int> valueD;
+    std::vector<unsigned int>                   input (n);
+    std::vector<unsigned int>                   values;
+
+    for (unsigned int& v : input)
+    {
+      v = valueD (gen);
+    }
+    const auto setup = [&values, &input]() { values = input; };
+
+    Benchmark::run ("serial-sort", n, numRepetitions, setup,
+                    [&values]() { std::sort (values.begin (), values.end ()); });
+    Benchmark::run ("parallel-sort", n, numRepetitions, setup,
+                    [&values]() { Parallel::sort (values, std::less<unsigned int> ()); });
+    Benchmark::run ("parallel-exclusive-scan", n, numRepetitions, setup,
+                    [&values]() { Parallel::exclusiveScan (values); });
+    Benchmark::run ("parallel-prune", n, numRepetitions, setup, [&values]() {
+      std::vector<unsigned int> indexMap;
+      Parallel::prune (values, [](unsigned int v) { return v % 2 == 0; }, &indexMap);
+    });
+  }
+}
@@ -0,0 +1,72 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <iostream>
+#include <vector>
+#include "bench-replay.hpp"
+#include "benchmark.hpp"
+#include "dynamic/mesh.hpp"
+#include "import-export.hpp"
+#include "memory-report.hpp"
+#include "tool/sculpt/util/stroke-record.hpp"
+
+namespace BenchReplay
+{
+  bool run (const std::string& fileName, std::ostream& stream)
+  {
+    ImportExportContents contents;
+    if (contents.fromDlyFile (fileName + ".dly") == false)
+    {
+      std::cerr << "could not read scene " << fileName << ".dly\n";
+      return false;
+    }
+
+    std::vector<DynamicMesh> meshes;
+    meshes.reserve (contents.numMeshes ());
+    for (unsigned int i = 0; i < contents.numMeshes (); i++)
+    {
+      meshes.emplace_back (contents.mesh (i));
+    }
+
+    std::vector<SculptStrokeReplayStep> steps;
+    const auto addStep = [&steps](const SculptStrokeReplayStep& s) { steps.push_back (s); };
+
+    if (SculptStrokeReplay::replay (fileName, meshes, addStep) == false)
+    {
+      std::cerr << "could not replay " << fileName << "\n";
+      return false;
+    }
+
+    float total = 0.0f;
+
+    stream << "{\n  \"version\": \"" << DILAY_VERSION << "\",\n  \"steps\": [";
+    for (unsigned int i = 0; i < steps.size (); i++)
+    {
+      const SculptStrokeReplayStep& s = steps[i];
+
+      stream << (i == 0 ? "\n" : ",\n") << "    {\"stroke\": " << s.stroke
+             << ", \"dabs\": " << s.numDabs << ", \"recorded-ms\": " << s.recordedTime
+             << ", \"replayed-ms\": " << s.duration << "}";
+      total += s.duration;
+    }
+    stream << "\n  ],\n  \"faces\": [";
+
+    // the resulting number of faces tells whether a replay diverges from previous ones
+    for (unsigned int i = 0; i < meshes.size (); i++)
+    {
+      stream << (i == 0 ? "" : ", ") << meshes[i].numFaces ();
+    }
+    MemoryReport report;
+    for (const DynamicMesh& mesh : meshes)
+    {
+      mesh.reportMemory (report);
+    }
+    stream << "],\n  \"bytes\": ";
+    Benchmark::toJson (stream, report);
+    stream << ",\n  \"total-ms\": " << total << "\n}\n";
+
+    std::cerr << fileName << " (" << steps.size () << " steps): " << total << "ms\n";
+    return true;
+  }
+}
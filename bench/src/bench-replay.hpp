@@ -0,0 +1,20 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_BENCH_REPLAY
+#define DILAY_BENCH_REPLAY
+
+#include <iosfwd>
+#include <string>
+
+namespace BenchReplay
+{
+  /* Replays a record of sculpt strokes against the meshes of its scene, which is read from
+   * `<record>.dly`, and writes the duration of each step as JSON.  Returns `false` if either file
+   * cannot be read.
+   */
+  bool run (const std::string&, std::ostream&);
+}
+
+#endif
@@ -0,0 +1,57 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QDir>
+#include <QFile>
+#include <string>
+#include "bench-scene.hpp"
+#include "benchmark.hpp"
+#include "config.hpp"
+#include "history.hpp"
+#include "import-export.hpp"
+#include "memory-report.hpp"
+#include "mesh.hpp"
+#include "scene.hpp"
+
+namespace
+{
+  constexpr unsigned int numRepetitions = 10;
+}
+
+void BenchScene::run ()
+{
+  const QString     filePath = QDir::temp ().filePath ("dilay-bench.dly");
+  const std::string fileName = filePath.toStdString ();
+  const Config      config;
+
+  Benchmark::forEachIcosphere ([&config, &fileName](const Mesh& mesh) {
+    const unsigned int numFaces = mesh.numIndices () / 3;
+    Scene              scene (config);
+    Scene              loadedScene (config);
+    History            history (config);
+
+    scene.newDynamicMesh (config, mesh);
+
+    Benchmark::run ("dly-save", numFaces, numRepetitions, [&scene, &fileName]() {
+      ImportExport::toDlyFile (fileName, scene, false);
+    });
+
+    Benchmark::run ("dly-load", numFaces, numRepetitions,
+                    [&loadedScene]() { loadedScene.deleteDynamicMeshes (); },
+                    [&config, &loadedScene, &fileName]() {
+                      ImportExport::fromDlyFile (fileName, config, loadedScene);
+                    });
+
+    Benchmark::run ("history-snapshot", numFaces, numRepetitions,
+                    [&history]() { history.reset (); },
+                    [&history, &scene]() { history.snapshotAll (scene); });
+
+    MemoryReport report;
+    scene.reportMemory (report);
+    history.reportMemory (report);
+    Benchmark::memory ("scene-with-snapshot", numFaces, report);
+  });
+
+  QFile::remove (filePath);
+}
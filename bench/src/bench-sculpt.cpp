@@ -0,0 +1,120 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <functional>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include "bench-sculpt.hpp"
+#include "benchmark.hpp"
+#include "dynamic/mesh.hpp"
+#include "intersection.hpp"
+#include "mesh.hpp"
+#include "primitive/ray.hpp"
+#include "tool/sculpt/util/action.hpp"
+#include "tool/sculpt/util/brush.hpp"
+
+namespace
+{
+  constexpr unsigned int numRepetitions = 5;
+  constexpr unsigned int numDabs = 64;
+  constexpr unsigned int numDabsPerEvent = 4;
+
+  /* Sculpts dabs along half a circle around the sphere.  Like the sculpt tool, the dabs of an
+   * event share a batch and the mesh is buffered after each event.
+   */
+  void stroke (SculptBrush& brush, DynamicMesh& mesh)
+  {
+    for (unsigned int i = 0; i < numDabs; i++)
+    {
+      const float     angle = glm::pi<float> () * float(i) / float(numDabs);
+      const glm::vec3 direction (glm::cos (angle), 0.3f, glm::sin (angle));
+      Intersection    intersection;
+
+      if (i % numDabsPerEvent == 0)
+      {
+        ToolSculptAction::openBatch ();
+      }
+
+      if (mesh.intersects (PrimRay (3.0f * glm::normalize (direction), -direction), intersection))
+      {
+        brush.setPointOfAction (mesh, intersection.position (), intersection.normal ());
+        ToolSculptAction::sculpt (brush);
+      }
+
+      if ((i + 1) % numDabsPerEvent == 0 || i + 1 == numDabs)
+      {
+        ToolSculptAction::closeBatch ();
+        mesh.bufferData ();
+      }
+    }
+    ToolSculptAction::finishRefinement ();
+    brush.resetPointOfAction ();
+  }
+
+  // grabs the top of the sphere and pulls it upwards, where each event has a single dab
+  void grabStroke (SculptBrush& brush, DynamicMesh& mesh)
+  {
+    Intersection intersection;
+
+    if (mesh.intersects (PrimRay (glm::vec3 (0.0f, 3.0f, 0.0f), glm::vec3 (0.0f, -1.0f, 0.0f)),
+                         intersection))
+    {
+      for (unsigned int i = 0; i <= numDabs; i++)
+      {
+        const glm::vec3 offset (0.0f, 0.5f * float(i) / float(numDabs), 0.0f);
+
+        brush.setPointOfAction (mesh, intersection.position () + offset, intersection.normal ());
+        ToolSculptAction::sculpt (brush);
+        mesh.bufferData ();
+      }
+    }
+    ToolSculptAction::finishRefinement ();
+    brush.resetPointOfAction ();
+  }
+
+  void benchmarkBrush (const char* name, const Mesh& mesh,
+                       const std::function<void(SculptBrush&)>& setup,
+                       const std::function<void(SculptBrush&, DynamicMesh&)>& run = stroke)
+  {
+    DynamicMesh dynamicMesh;
+    SculptBrush brush;
+
+    brush.radius (0.2f);
+    brush.detailFactor (0.75f);
+    brush.stepWidthFactor (0.3f);
+    brush.subdivide (true);
+    setup (brush);
+
+    Benchmark::run (name, mesh.numIndices () / 3, numRepetitions,
+                    [&dynamicMesh, &mesh]() { dynamicMesh.fromMesh (mesh); },
+                    [&brush, &dynamicMesh, &run]() { run (brush, dynamicMesh); });
+  }
+}
+
+void BenchSculpt::run ()
+{
+  Benchmark::forEachIcosphere ([](const Mesh& mesh) {
+    benchmarkBrush ("sculpt-draw", mesh, [](SculptBrush& brush) {
+      brush.initParameters<SBDrawParameters> ().intensity (0.5f);
+    });
+    benchmarkBrush ("sculpt-smooth", mesh, [](SculptBrush& brush) {
+      brush.initParameters<SBSmoothParameters> ().intensity (0.5f);
+    });
+    benchmarkBrush ("sculpt-smooth-iterations", mesh, [](SculptBrush& brush) {
+      auto& parameters = brush.initParameters<SBSmoothParameters> ();
+      parameters.intensity (0.5f);
+      parameters.iterations (8);
+    });
+    benchmarkBrush ("sculpt-crease", mesh, [](SculptBrush& brush) {
+      brush.initParameters<SBCreaseParameters> ().intensity (0.5f);
+    });
+    benchmarkBrush ("sculpt-grab", mesh,
+                    [](SculptBrush& brush) {
+                      brush.initParameters<SBGrablikeParameters> ().discardBack (false);
+                      brush.radius (0.5f);
+                      brush.subdivide (false);
+                    },
+                    grabStroke);
+  });
+}
@@ -0,0 +1,128 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include "benchmark.hpp"
+#include "memory-report.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+
+namespace
+{
+  typedef std::chrono::steady_clock Clock;
+
+  constexpr unsigned int minIcosphereLevel = 3;
+  constexpr unsigned int maxIcosphereLevel = 6;
+
+  struct Result
+  {
+    std::string  name;
+    unsigned int numFaces;
+    unsigned int repetitions;
+    double       minimum;
+    double       median;
+    double       mean;
+  };
+
+  struct MemoryResult
+  {
+    std::string  name;
+    unsigned int numFaces;
+    MemoryReport report;
+  };
+
+  std::vector<Result>       results;
+  std::vector<MemoryResult> memoryResults;
+}
+
+namespace Benchmark
+{
+  void forEachIcosphere (const std::function<void(const Mesh&)>& f)
+  {
+    for (unsigned int level = minIcosphereLevel; level <= maxIcosphereLevel; level++)
+    {
+      f (MeshUtil::icosphere (level));
+    }
+  }
+
+  void run (const std::string& name, unsigned int numFaces, unsigned int repetitions,
+            const std::function<void()>& f)
+  {
+    Benchmark::run (name, numFaces, repetitions, []() {}, f);
+  }
+
+  void run (const std::string& name, unsigned int numFaces, unsigned int repetitions,
+            const std::function<void()>& setup, const std::function<void()>& f)
+  {
+    std::vector<double> durations;
+    double              sum = 0.0;
+
+    for (unsigned int i = 0; i < repetitions; i++)
+    {
+      setup ();
+
+      const Clock::time_point                         start = Clock::now ();
+      f ();
+      const std::chrono::duration<double, std::milli> duration = Clock::now () - start;
+
+      durations.push_back (duration.count ());
+      sum += duration.count ();
+    }
+    std::sort (durations.begin (), durations.end ());
+
+    Result result;
+    result.name = name;
+    result.numFaces = numFaces;
+    result.repetitions = repetitions;
+    result.minimum = durations.empty () ? 0.0 : durations.front ();
+    result.median = durations.empty () ? 0.0 : durations[durations.size () / 2];
+    result.mean = durations.empty () ? 0.0 : sum / double(durations.size ());
+
+    std::cerr << name << " (" << numFaces << " faces): " << result.median << "ms\n";
+    results.push_back (result);
+  }
+
+  void memory (const std::string& name, unsigned int numFaces, const MemoryReport& report)
+  {
+    std::cerr << name << " (" << numFaces << " faces): " << report.total () << " bytes\n";
+    memoryResults.push_back (MemoryResult{name, numFaces, report});
+  }
+
+  void toJson (std::ostream& stream)
+  {
+    stream << "{\n  \"version\": \"" << DILAY_VERSION << "\",\n  \"results\": [";
+    for (unsigned int i = 0; i < results.size (); i++)
+    {
+      const Result& r = results[i];
+
+      stream << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << r.name
+             << "\", \"faces\": " << r.numFaces << ", \"repetitions\": " << r.repetitions
+             << ", \"min-ms\": " << r.minimum << ", \"median-ms\": " << r.median
+             << ", \"mean-ms\": " << r.mean << "}";
+    }
+    stream << "\n  ],\n  \"memory\": [";
+    for (unsigned int i = 0; i < memoryResults.size (); i++)
+    {
+      const MemoryResult& m = memoryResults[i];
+
+      stream << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << m.name
+             << "\", \"faces\": " << m.numFaces << ", \"bytes\": ";
+      Benchmark::toJson (stream, m.report);
+      stream << "}";
+    }
+    stream << "\n  ]\n}\n";
+  }
+
+  void toJson (std::ostream& stream, const MemoryReport& report)
+  {
+    stream << "{";
+    report.forEachCategory ([&stream](MemoryCategory category, std::size_t bytes) {
+      stream << "\"" << MemoryReport::name (category) << "\": " << bytes << ", ";
+    });
+    stream << "\"total\": " << report.total () << "}";
+  }
+}
@@ -0,0 +1,37 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_BENCHMARK
+#define DILAY_BENCHMARK
+
+#include <functional>
+#include <iosfwd>
+#include <string>
+
+class MemoryReport;
+class Mesh;
+
+namespace Benchmark
+{
+  // calls back unit icospheres of several subdivision levels
+  void forEachIcosphere (const std::function<void(const Mesh&)>&);
+
+  /* Calls a function repeatedly and records the minimum, median and mean of its durations under
+   * a name and the number of faces of its input.  The setup is called before each repetition and
+   * is not measured.
+   */
+  void run (const std::string&, unsigned int, unsigned int, const std::function<void()>&);
+  void run (const std::string&, unsigned int, unsigned int, const std::function<void()>&,
+            const std::function<void()>&);
+
+  // records the memory of an input with the given number of faces under a name
+  void memory (const std::string&, unsigned int, const MemoryReport&);
+
+  // writes all recorded results and memory reports as JSON
+  void toJson (std::ostream&);
+  // writes the bytes of each category and their total as JSON object
+  void toJson (std::ostream&, const MemoryReport&);
+}
+
+#endif
@@ -0,0 +1,83 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include "bench-mesh.hpp"
+#include "bench-octree.hpp"
+#include "bench-parallel.hpp"
+#include "bench-replay.hpp"
+#include "bench-scene.hpp"
+#include "bench-sculpt.hpp"
+#include "benchmark.hpp"
+#include "opengl.hpp"
+
+namespace
+{
+  int writeJson (const QStringList& arguments, int index,
+                 const std::function<bool(std::ostream&)>& f)
+  {
+    bool success;
+    if (arguments.size () > index)
+    {
+      std::ofstream file (arguments.at (index).toStdString ());
+      success = f (file);
+    }
+    else
+    {
+      success = f (std::cout);
+    }
+    return success ? 0 : 1;
+  }
+}
+
+/* Meshes are buffered, which requires an OpenGL context but no window.  Without a display, the
+ * benchmarks can be run with `-platform offscreen`.  Results are written as JSON to the file that
+ * is given as first argument, or to the standard output.
+ *
+ * `run-benchmarks --replay <record> [<file>]` replays recorded sculpt strokes instead, which
+ * requires neither a display nor an OpenGL context.
+ */
+int main (int argc, char** argv)
+{
+  QCoreApplication::setApplicationName ("dilay");
+
+  if (argc > 2 && QString (argv[1]) == "--replay")
+  {
+    QCoreApplication app (argc, argv);
+
+    return writeJson (QCoreApplication::arguments (), 3, [](std::ostream& stream) {
+      return BenchReplay::run (QCoreApplication::arguments ().at (2).toStdString (), stream);
+    });
+  }
+
+  OpenGL::setDefaultFormat ();
+
+  QGuiApplication   app (argc, argv);
+  QOffscreenSurface surface;
+  QOpenGLContext    context;
+
+  surface.create ();
+  if (context.create () == false || context.makeCurrent (&surface) == false)
+  {
+    std::cerr << "could not create OpenGL context\n";
+    return 1;
+  }
+  OpenGL::initializeFunctions (false);
+
+  BenchOctree::run ();
+  BenchMesh::run ();
+  BenchSculpt::run ();
+  BenchScene::run ();
+  BenchParallel::run ();
+
+  return writeJson (QCoreApplication::arguments (), 1, [](std::ostream& stream) {
+    Benchmark::toJson (stream);
+    return true;
+  });
+}
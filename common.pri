@@ -5,7 +5,7 @@ MOC_DIR                 = moc
 OBJECTS_DIR             = obj
 QMAKE_CXXFLAGS         += -DDILAY_VERSION=\\\"$$VERSION\\\" -DGLM_FORCE_RADIANS -DGLM_ENABLE_EXPERIMENTAL
 QMAKE_CXXFLAGS_RELEASE += -DNDEBUG
-QMAKE_CXXFLAGS_DEBUG   += -Wall # -pg # -DDILAY_RENDER_OCTREE
+QMAKE_CXXFLAGS_DEBUG   += -Wall # -pg # -DDILAY_PROFILE
 QMAKE_LFLAGS_DEBUG     += # -pg
 
 win32:INCLUDEPATH      += $$PWD/glm/
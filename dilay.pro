@@ -1,9 +1,10 @@
 CONFIG      += debug_and_release
 TEMPLATE     = subdirs
-SUBDIRS      = lib app test
+SUBDIRS      = lib app test bench
 
-app.depends  = lib
-test.depends = lib
+app.depends   = lib
+test.depends  = lib
+bench.depends = lib
 
 unix {
   gdb.commands = gdb -ex run ./dilay_debug
@@ -7,86 +7,127 @@ INCLUDEPATH += src
 CONFIG      += staticlib
 
 SOURCES += \
+           src/autosave.cpp \
            src/camera.cpp \
            src/color.cpp \
            src/config.cpp \
            src/configurable.cpp \
+           src/cpu-dispatch.cpp \
            src/dimension.cpp \
            src/distance.cpp \
            src/dynamic/faces.cpp \
            src/dynamic/mesh.cpp \
+           src/dynamic/mesh-boolean.cpp \
+           src/dynamic/mesh-distance-field.cpp \
            src/dynamic/mesh-intersection.cpp \
+           src/dynamic/mesh-layers.cpp \
+           src/dynamic/mesh-winding-number.cpp \
            src/dynamic/octree.cpp \
+           src/edge-map.cpp \
            src/history.cpp \
            src/import-export.cpp \
            src/intersection.cpp \
            src/isosurface-extraction.cpp \
            src/isosurface-extraction/grid.cpp \
            src/kvstore.cpp \
+           src/latency-profiler.cpp \
            src/log.cpp \
+           src/maintenance.cpp \
+           src/mapped-memory.cpp \
+           src/memory-report.cpp \
            src/mesh.cpp \
+           src/mesh-arena.cpp \
+           src/mesh-bvh.cpp \
+           src/mesh-instances.cpp \
+           src/mesh-occlusion.cpp \
+           src/mesh-primitives.cpp \
+           src/mesh-proxies.cpp \
            src/mesh-util.cpp \
            src/mirror.cpp \
            src/opengl.cpp \
            src/opengl-buffer-id.cpp \
+           src/opengl-upload.cpp \
+           src/overlay-batch.cpp \
            src/primitive/aabox.cpp \
            src/primitive/cone.cpp \
            src/primitive/cone-sphere.cpp \
+           src/primitive/convex-polytope.cpp \
            src/primitive/cylinder.cpp \
            src/primitive/plane.cpp \
            src/primitive/ray.cpp \
            src/primitive/sphere.cpp \
            src/primitive/triangle.cpp \
+           src/profiler.cpp \
            src/render-mode.cpp \
+           src/render-profiler.cpp \
            src/renderer.cpp \
            src/scene.cpp \
+           src/scene-loader.cpp \
            src/shader.cpp \
            src/sketch/bone-intersection.cpp \
+           src/sketch/bvh.cpp \
+           src/sketch/distance-field.cpp \
            src/sketch/mesh.cpp \
            src/sketch/mesh-intersection.cpp \
            src/sketch/node-intersection.cpp \
            src/sketch/path.cpp \
            src/sketch/path-intersection.cpp \
            src/state.cpp \
-           src/time-delta.cpp \
+           src/thread-pool.cpp \
            src/tool.cpp \
+           src/tool/clay.cpp \
            src/tool/convert-sketch.cpp \
+           src/tool/decimate.cpp \
            src/tool/delete-mesh.cpp \
            src/tool/delete-sketch.cpp \
            src/tool/edit-sketch.cpp \
            src/tool/move-camera.cpp \
            src/tool/new-mesh.cpp \
            src/tool/remesh.cpp \
+           src/tool/separate-mesh.cpp \
            src/tool/sculpt.cpp \
            src/tool/sculpt/draw.cpp \
            src/tool/sculpt/crease.cpp \
            src/tool/sculpt/flatten.cpp \
            src/tool/sculpt/grab.cpp \
+           src/tool/sculpt/mask.cpp \
            src/tool/sculpt/pinch.cpp \
            src/tool/sculpt/reduce.cpp \
            src/tool/sculpt/smooth.cpp \
            src/tool/sculpt/util/action.cpp \
            src/tool/sculpt/util/brush.cpp \
-           src/tool/sculpt/util/edge-collection.cpp \
+           src/tool/sculpt/util/governor.cpp \
+           src/tool/sculpt/util/stamp.cpp \
+           src/tool/sculpt/util/stroke-record.cpp \
+           src/tool/sculpt/util/visibility.cpp \
            src/tool/sketch-spheres.cpp \
+           src/tool/subdivide-mesh.cpp \
            src/tool/transform-mesh.cpp \
            src/tool/trim-mesh.cpp \
            src/tool/trim-mesh/action.cpp \
            src/tool/trim-mesh/border.cpp \
            src/tool/trim-mesh/split-mesh.cpp \
+           src/tool/util/clay-volume.cpp \
            src/tool/util/movement.cpp \
+           src/tool/util/prediction.cpp \
+           src/tool/util/refinement.cpp \
            src/tool/util/rotation.cpp \
            src/tool/util/scaling.cpp \
+           src/tool/util/sketch-preview.cpp \
            src/tool/util/step.cpp \
+           src/triangle-batch.cpp \
            src/util.cpp \
            src/view/axis.cpp \
            src/view/color-button.cpp \
            src/view/configuration.cpp \
            src/view/cursor.cpp \
+           src/view/depth-picker.cpp \
            src/view/double-slider.cpp \
            src/view/floor-plane.cpp \
            src/view/gl-widget.cpp \
            src/view/info-pane.cpp \
+           src/view/info-pane/latency.cpp \
+           src/view/info-pane/memory.cpp \
            src/view/info-pane/scene.cpp \
            src/view/input.cpp \
            src/view/key-event.cpp \
@@ -105,18 +146,27 @@ SOURCES += \
            src/xml-conversion.cpp \
 
 HEADERS += \
+           src/autosave.hpp \
            src/bitset.hpp \
            src/cache.hpp \
            src/camera.hpp \
            src/color.hpp \
            src/config.hpp \
            src/configurable.hpp \
+           src/cpu-dispatch.hpp \
            src/dimension.hpp \
            src/distance.hpp \
            src/dynamic/faces.hpp \
            src/dynamic/mesh.hpp \
+           src/dynamic/mesh-boolean.hpp \
+           src/dynamic/mesh-cache.hpp \
+           src/dynamic/mesh-distance-field.hpp \
            src/dynamic/mesh-intersection.hpp \
+           src/dynamic/mesh-layers.hpp \
+           src/dynamic/mesh-version.hpp \
+           src/dynamic/mesh-winding-number.hpp \
            src/dynamic/octree.hpp \
+           src/edge-map.hpp \
            src/hash.hpp \
            src/history.hpp \
            src/import-export.hpp \
@@ -124,61 +174,93 @@ HEADERS += \
            src/isosurface-extraction.hpp \
            src/isosurface-extraction/grid.hpp \
            src/kvstore.hpp \
+           src/latency-profiler.hpp \
            src/log.hpp \
            src/macro.hpp \
+           src/maintenance.hpp \
+           src/mapped-memory.hpp \
            src/maybe.hpp \
+           src/memory-report.hpp \
            src/mesh.hpp \
+           src/mesh-arena.hpp \
+           src/mesh-bvh.hpp \
+           src/mesh-instances.hpp \
+           src/mesh-occlusion.hpp \
+           src/mesh-primitives.hpp \
+           src/mesh-proxies.hpp \
            src/mesh-util.hpp \
            src/mirror.hpp \
            src/opengl.hpp \
            src/opengl-buffer-id.hpp \
+           src/opengl-upload.hpp \
+           src/overlay-batch.hpp \
+           src/parallel.hpp \
+           src/pool-allocator.hpp \
            src/primitive/aabox.hpp \
            src/primitive/cone.hpp \
            src/primitive/cone-sphere.hpp \
+           src/primitive/convex-polytope.hpp \
            src/primitive/cylinder.hpp \
            src/primitive/plane.hpp \
            src/primitive/ray.hpp \
            src/primitive/sphere.hpp \
            src/primitive/triangle.hpp \
+           src/profiler.hpp \
            src/render-mode.hpp \
+           src/render-profiler.hpp \
            src/renderer.hpp \
            src/scene.hpp \
+           src/scene-loader.hpp \
            src/shader.hpp \
            src/sketch/bone-intersection.hpp \
+           src/sketch/bvh.hpp \
+           src/sketch/distance-field.hpp \
            src/sketch/fwd.hpp \
            src/sketch/mesh.hpp \
            src/sketch/mesh-intersection.hpp \
            src/sketch/node-intersection.hpp \
            src/sketch/path.hpp \
            src/sketch/path-intersection.hpp \
+           src/slot-map.hpp \
            src/state.hpp \
-           src/time-delta.hpp \
+           src/thread-pool.hpp \
            src/tool.hpp \
            src/tool/key.hpp \
            src/tool/move-camera.hpp \
            src/tool/sculpt.hpp \
            src/tool/sculpt/util/action.hpp \
            src/tool/sculpt/util/brush.hpp \
-           src/tool/sculpt/util/edge-collection.hpp \
+           src/tool/sculpt/util/governor.hpp \
+           src/tool/sculpt/util/stamp.hpp \
+           src/tool/sculpt/util/stroke-record.hpp \
+           src/tool/sculpt/util/visibility.hpp \
            src/tool/trim-mesh/action.hpp \
            src/tool/trim-mesh/border.hpp \
            src/tool/trim-mesh/split-mesh.hpp \
+           src/tool/util/clay-volume.hpp \
            src/tool/util/movement.hpp \
+           src/tool/util/prediction.hpp \
+           src/tool/util/refinement.hpp \
            src/tool/util/rotation.hpp \
            src/tool/util/scaling.hpp \
+           src/tool/util/sketch-preview.hpp \
            src/tool/util/step.hpp \
            src/tools.hpp \
            src/tree.hpp \
+           src/triangle-batch.hpp \
            src/util.hpp \
            src/variant.hpp \
            src/view/axis.hpp \
            src/view/color-button.hpp \
            src/view/configuration.hpp \
            src/view/cursor.hpp \
+           src/view/depth-picker.hpp \
            src/view/double-slider.hpp \
            src/view/floor-plane.cpp \
            src/view/gl-widget.hpp \
            src/view/info-pane.hpp \
+           src/view/info-pane/latency.hpp \
+           src/view/info-pane/memory.hpp \
            src/view/info-pane/scene.hpp \
            src/view/input.hpp \
            src/view/key-event.hpp \
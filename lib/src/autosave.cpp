@@ -0,0 +1,90 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QTimer>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include "autosave.hpp"
+#include "import-export.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // interval (in milliseconds) in which a running autosave is polled
+  constexpr int pollInterval = 50;
+}
+
+struct Autosave::Impl
+{
+  const std::string                     fileName;
+  QTimer                                timer;
+  std::thread                           thread;
+  std::atomic<bool>                     isFinished;
+  std::unique_ptr<ImportExportSnapshot> snapshot;
+
+  Impl (const std::string& f)
+    : fileName (f)
+    , isFinished (false)
+  {
+    this->timer.setInterval (pollInterval);
+    QObject::connect (&this->timer, &QTimer::timeout, [this]() { this->poll (); });
+  }
+
+  ~Impl ()
+  {
+    this->finish ();
+    std::remove (this->fileName.c_str ());
+  }
+
+  bool isRunning () const { return this->thread.joinable () && this->isFinished == false; }
+
+  bool save (const Scene& scene)
+  {
+    if (this->isRunning ())
+    {
+      return false;
+    }
+    this->finish ();
+
+    this->snapshot.reset (new ImportExportSnapshot (scene));
+    this->isFinished = false;
+    this->thread = std::thread ([this]() {
+      if (this->snapshot->toDlyFile (this->fileName) == false)
+      {
+        DILAY_WARN ("could not autosave to %s", this->fileName.c_str ())
+      }
+      this->isFinished = true;
+    });
+    this->timer.start ();
+    return true;
+  }
+
+  // the snapshot pins the chunks of all meshes, so it is released as soon as it has been written
+  void poll ()
+  {
+    if (this->isFinished)
+    {
+      this->finish ();
+    }
+  }
+
+  void finish ()
+  {
+    this->timer.stop ();
+
+    if (this->thread.joinable ())
+    {
+      this->thread.join ();
+    }
+    this->snapshot.reset ();
+  }
+};
+
+DELEGATE1_BIG2 (Autosave, const std::string&)
+GETTER_CONST (const std::string&, Autosave, fileName)
+DELEGATE_CONST (bool, Autosave, isRunning)
+DELEGATE1 (bool, Autosave, save, const Scene&)
+DELEGATE (void, Autosave, finish)
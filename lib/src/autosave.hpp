@@ -0,0 +1,33 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_AUTOSAVE
+#define DILAY_AUTOSAVE
+
+#include <string>
+#include "macro.hpp"
+
+class Scene;
+
+/* Writes snapshots of a scene to a file on a background thread.  Only taking a snapshot happens
+ * on the calling thread, which is cheap, cf. `ImportExportSnapshot`.  The file is removed once
+ * the autosave is destroyed, so a remaining file indicates that the application has crashed.
+ */
+class Autosave
+{
+public:
+  DECLARE_BIG2 (Autosave, const std::string&)
+
+  const std::string& fileName () const;
+  bool               isRunning () const;
+  // returns `false` if the previous snapshot is still being written
+  bool save (const Scene&);
+  // waits until the current snapshot has been written
+  void finish ();
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -10,6 +10,7 @@
 #include "dimension.hpp"
 #include "intersection.hpp"
 #include "opengl.hpp"
+#include "primitive/aabox.hpp"
 #include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
 #include "renderer.hpp"
@@ -145,6 +146,39 @@ struct Camera::Impl
     return glm::vec2 (w.x, float(resolution.y) - w.y);
   }
 
+  /* Conservative: a box may be reported as visible although it is outside the view frustum.
+   * If `isInside` is given, it is set to whether the box is completely inside the frustum.
+   */
+  bool isVisible (const PrimAABox& box, const glm::mat4x4& model, bool* isInside) const
+  {
+    const glm::mat4x4 mvp = this->projection * this->view * model;
+    glm::bvec3        allBelow (true), allAbove (true);
+    bool              allInside = true;
+
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      const glm::vec3 corner ((i & 1) ? box.maximum ().x : box.minimum ().x,
+                              (i & 2) ? box.maximum ().y : box.minimum ().y,
+                              (i & 4) ? box.maximum ().z : box.minimum ().z);
+      const glm::vec4 p = mvp * glm::vec4 (corner, 1.0f);
+      const glm::vec3 q (p);
+
+      allBelow = glm::bvec3 (allBelow.x && q.x < -p.w, allBelow.y && q.y < -p.w,
+                             allBelow.z && q.z < -p.w);
+      allAbove = glm::bvec3 (allAbove.x && q.x > p.w, allAbove.y && q.y > p.w,
+                             allAbove.z && q.z > p.w);
+      allInside = allInside && glm::all (glm::lessThanEqual (glm::abs (q), glm::vec3 (p.w)));
+    }
+
+    const bool visible = glm::any (allBelow) == false && glm::any (allAbove) == false;
+
+    if (isInside)
+    {
+      *isInside = visible && allInside;
+    }
+    return visible;
+  }
+
   glm::vec3 toWorld (const glm::ivec2& p, float z = 0.0f) const
   {
     const float invY = this->resolution.y - float(p.y);
@@ -160,6 +194,13 @@ struct Camera::Impl
     return onNearPlane * (this->nearClipping + z) / this->nearClipping;
   }
 
+  glm::vec3 unproject (const glm::ivec2& p, float depth) const
+  {
+    const float invY = this->resolution.y - float(p.y);
+    return glm::unProject (glm::vec3 (float(p.x), invY, depth), this->view, this->projection,
+                           this->viewport ());
+  }
+
   PrimRay ray (const glm::ivec2& p) const
   {
     const glm::vec3 w = this->toWorld (p);
@@ -246,6 +287,7 @@ GETTER_CONST (const glm::vec3&, Camera, gazePoint)
 GETTER_CONST (const glm::vec3&, Camera, toEyePoint)
 DELEGATE_CONST (glm::vec3, Camera, realUp)
 GETTER_CONST (const glm::vec3&, Camera, right)
+GETTER_CONST (const glm::mat4x4&, Camera, projection)
 GETTER_CONST (const glm::mat4x4&, Camera, view)
 GETTER_CONST (const glm::mat4x4&, Camera, viewRotation)
 DELEGATE_CONST (glm::vec3, Camera, position)
@@ -258,8 +300,10 @@ DELEGATE1 (void, Camera, stepAlongGaze, float)
 DELEGATE1 (void, Camera, verticalRotation, float)
 DELEGATE1 (void, Camera, horizontalRotation, float)
 DELEGATE3_CONST (glm::vec2, Camera, fromWorld, const glm::vec3&, const glm::mat4x4&, bool)
+DELEGATE3_CONST (bool, Camera, isVisible, const PrimAABox&, const glm::mat4x4&, bool*)
 DELEGATE2_CONST (glm::vec3, Camera, toWorld, const glm::ivec2&, float)
 DELEGATE2_CONST (float, Camera, toWorld, float, float)
+DELEGATE2_CONST (glm::vec3, Camera, unproject, const glm::ivec2&, float)
 DELEGATE1_CONST (PrimRay, Camera, ray, const glm::ivec2&)
 DELEGATE_CONST (Dimension, Camera, primaryDimension)
 DELEGATE1_CONST (glm::vec3, Camera, viewPlaneIntersection, const glm::ivec2&)
@@ -10,6 +10,7 @@
 #include "macro.hpp"
 
 enum class Dimension;
+class PrimAABox;
 class PrimRay;
 class Renderer;
 
@@ -24,6 +25,7 @@ public:
   const glm::vec3&   toEyePoint () const;
   glm::vec3          realUp () const;
   const glm::vec3&   right () const;
+  const glm::mat4x4& projection () const;
   const glm::mat4x4& view () const;
   const glm::mat4x4& viewRotation () const;
   glm::vec3          position () const;
@@ -38,8 +40,11 @@ public:
   void      verticalRotation (float);
   void      horizontalRotation (float);
   glm::vec2 fromWorld (const glm::vec3&, const glm::mat4x4&, bool) const;
+  bool      isVisible (const PrimAABox&, const glm::mat4x4&, bool* = nullptr) const;
   glm::vec3 toWorld (const glm::ivec2&, float = 0.0f) const;
   float     toWorld (float, float = 0.0f) const;
+  // unprojects a point on the screen with a depth of the depth buffer
+  glm::vec3 unproject (const glm::ivec2&, float) const;
   PrimRay   ray (const glm::ivec2&) const;
   Dimension primaryDimension () const;
   glm::vec3 viewPlaneIntersection (const glm::ivec2&) const;
@@ -10,6 +10,7 @@
 namespace
 {
   static constexpr int latestVersion = 10;
+  static const char*   root = "config";
 
   template <typename T>
   void updateValue (Config& config, const std::string& path, const T& oldValue, const T& newValue)
@@ -34,11 +35,13 @@ namespace
 }
 
 Config::Config ()
-  : store ("config")
+  : store (root)
 {
   this->restoreDefaults ();
 }
 
+KVStore::Key Config::resolve (const std::string& path) { return KVStore::key (root, path); }
+
 void Config::restoreDefaults ()
 {
   this->store.reset ();
@@ -71,28 +74,75 @@ void Config::restoreDefaults ()
   this->set ("editor/light/light2/color", Color (1.0f, 1.0f, 1.0f));
   this->set ("editor/light/light2/irradiance", 0.8f);
 
+  this->set ("editor/maintenance/slice-time", 4);
+
   this->set ("editor/mesh/color/normal", Color (0.8f, 0.8f, 0.8f));
   this->set ("editor/mesh/color/wireframe", Color (0.3f, 0.3f, 0.3f));
+  this->set ("editor/mesh/octree/rebalance-delay", 1000);
+  this->set ("editor/mesh/octree/max-depth-increase", 2);
+  this->set ("editor/mesh/octree/min-occupancy-ratio", 0.5f);
+  this->set ("editor/mesh/culling/min-faces", 100000);
+  this->set ("editor/mesh/face-records/min-faces", 50000);
+  this->set ("editor/mesh/face-records/max-megabytes", 256);
+  this->set ("editor/mesh/proxy/min-faces", 200000);
+  this->set ("editor/mesh/proxy/max-faces", 50000);
+  this->set ("editor/mesh/proxy/distant-size", 0.02f);
+  this->set ("editor/mesh/proxy/navigation-delay", 300);
+  this->set ("editor/mesh/occlusion/enabled", true);
+  this->set ("editor/mesh/occlusion/min-faces", 20000);
+  this->set ("editor/mesh/arena/enabled", true);
+  this->set ("editor/mesh/arena/max-faces", 20000);
+  this->set ("editor/mesh/file-cache/min-faces", 200000);
+  this->set ("editor/mesh/background-upload/enabled", true);
+  this->set ("editor/mesh/background-upload/min-kilobytes", 1024);
+  this->set ("editor/mesh/out-of-core", false);
+  this->set ("editor/mesh/isosurface-sample-bits", 32);
 
   this->set ("editor/sketch/node/color", Color (0.5f, 0.5f, 0.9f));
   this->set ("editor/sketch/bubble/color", Color (0.5f, 0.5f, 0.7f));
+  this->set ("editor/sketch/bubble/min-spacing", 3.0f);
   this->set ("editor/sketch/sphere/color", Color (0.7f, 0.7f, 0.9f));
 
   this->set ("editor/tool/cursor-color", Color (1.0f, 0.9f, 0.9f));
 
   this->set ("editor/tool/sculpt/detail-factor", 0.75f);
   this->set ("editor/tool/sculpt/step-width-factor", 0.3f);
+  this->set ("editor/tool/sculpt/subdivision-budget", 8);
   this->set ("editor/tool/sculpt/max-absolute-radius", 2.0f);
+  this->set ("editor/tool/sculpt/defer-normals", false);
+  this->set ("editor/tool/sculpt/prediction-time", 16);
+  this->set ("editor/tool/sculpt/governor/enabled", false);
+  this->set ("editor/tool/sculpt/governor/time-budget", 33);
+  this->set ("editor/tool/sculpt/governor/max-face-growth", 20000);
+  this->set ("editor/tool/sculpt/governor/max-scale", 4.0f);
+  this->set ("editor/tool/sculpt/governor/color", Color (1.0f, 0.6f, 0.3f));
+  this->set ("editor/tool/sculpt/visible-domain/enabled", false);
+  this->set ("editor/tool/sculpt/visible-domain/ring-width", 3);
   this->set ("editor/tool/sculpt/mirror/width", 0.02f);
   this->set ("editor/tool/sculpt/mirror/color", Color (0.8f, 0.8f, 0.8f));
 
   this->set ("editor/tool/sketch-spheres/step-width-factor", 0.3f);
 
+  this->set ("editor/tool/clay/step-width-factor", 0.3f);
+
   this->set ("editor/undo-depth", 15);
+  this->set ("editor/undo-memory-budget", 256);
+  this->set ("editor/autosave-interval", 120);
 
   this->set ("editor/tablet-pressure-intensity", 1.0f);
 
   this->set ("editor/use-geometry-shader", true);
+  this->set ("editor/use-gpu-picking", false);
+  this->set ("editor/opengl-debug/enabled", false);
+  this->set ("editor/opengl-debug/min-severity", 1);
+  this->set ("editor/export/quantize-gltf", false);
+
+  this->set ("editor/dynamic-resolution/target-frame-time", 0.0f);
+  this->set ("editor/dynamic-resolution/min-scale", 0.5f);
+
+  this->set ("editor/octree-statistics/dump-interval", 0);
+  this->set ("editor/render-profiler/dump-interval", 0);
+  this->set ("editor/latency-profiler/dump-interval", 0);
 
   this->set ("window/initial-width", 1024);
   this->set ("window/initial-height", 768);
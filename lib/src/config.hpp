@@ -10,6 +10,21 @@
 class Config
 {
 public:
+  // a path of a value of type `T`, which is resolved once when the key is constructed
+  template <class T> class Key
+  {
+  public:
+    explicit Key (const std::string& path)
+      : _handle (Config::resolve (path))
+    {
+    }
+
+    KVStore::Key handle () const { return this->_handle; }
+
+  private:
+    const KVStore::Key _handle;
+  };
+
   Config ();
 
   template <class T> const T& get (const std::string& path) const
@@ -17,11 +32,25 @@ public:
     return this->store.get<T> (path);
   }
 
+  template <class T> const T& get (const Key<T>& key) const
+  {
+    return this->store.get<T> (key.handle ());
+  }
+
   template <class T> void set (const std::string& path, const T& value)
   {
     this->store.set<T> (path, value);
   }
 
+  template <class T> void set (const Key<T>& key, const T& value)
+  {
+    this->store.set<T> (key.handle (), value);
+  }
+
+  unsigned int subscribe (const KVStore::Subscriber& s) { return this->store.subscribe (s); }
+
+  void unsubscribe (unsigned int id) { this->store.unsubscribe (id); }
+
   void fromFile (const std::string& fileName)
   {
     this->store.fromFile (fileName);
@@ -35,6 +64,8 @@ public:
   void restoreDefaults ();
 
 private:
+  static KVStore::Key resolve (const std::string&);
+
   void update ();
 
   KVStore store;
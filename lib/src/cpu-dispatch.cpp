@@ -0,0 +1,85 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <atomic>
+#include "cpu-dispatch.hpp"
+#include "util.hpp"
+
+namespace
+{
+  std::atomic<CpuDispatch::Isa>& selectedIsa ()
+  {
+    static std::atomic<CpuDispatch::Isa> isa (CpuDispatch::best ());
+    return isa;
+  }
+}
+
+namespace CpuDispatch
+{
+  bool isSupported (Isa isa)
+  {
+    switch (isa)
+    {
+      case Isa::Generic:
+        return true;
+#ifdef DILAY_CPU_DISPATCH_X86
+      case Isa::SSE4:
+        return __builtin_cpu_supports ("sse4.2");
+      case Isa::AVX2:
+        return __builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma");
+      case Isa::AVX512:
+        return __builtin_cpu_supports ("avx512f") && __builtin_cpu_supports ("avx512vl") &&
+               isSupported (Isa::AVX2);
+#else
+      case Isa::SSE4:
+      case Isa::AVX2:
+      case Isa::AVX512:
+        return false;
+#endif
+      default:
+        DILAY_IMPOSSIBLE
+    }
+  }
+
+  Isa best ()
+  {
+    for (Isa isa : {Isa::AVX512, Isa::AVX2, Isa::SSE4})
+    {
+      if (isSupported (isa))
+      {
+        return isa;
+      }
+    }
+    return Isa::Generic;
+  }
+
+  Isa selected () { return selectedIsa (); }
+
+  bool select (Isa isa)
+  {
+    if (isSupported (isa))
+    {
+      selectedIsa () = isa;
+      return true;
+    }
+    return false;
+  }
+
+  const char* name (Isa isa)
+  {
+    switch (isa)
+    {
+      case Isa::Generic:
+        return "generic";
+      case Isa::SSE4:
+        return "SSE4.2";
+      case Isa::AVX2:
+        return "AVX2";
+      case Isa::AVX512:
+        return "AVX-512";
+      default:
+        DILAY_IMPOSSIBLE
+    }
+  }
+}
@@ -0,0 +1,39 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_CPU_DISPATCH
+#define DILAY_CPU_DISPATCH
+
+/* Instruction sets that hot kernels are compiled for in addition to the generic build, which only
+ * uses the instruction set of the build target (e.g. SSE2 on x86-64 and NEON on AArch64).  The
+ * best instruction set of the processor is selected when a kernel runs for the first time.  Other
+ * compilers and architectures only have the generic build.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DILAY_CPU_DISPATCH_X86
+#define DILAY_TARGET(isa) __attribute__ ((target (isa)))
+#define DILAY_KERNEL inline __attribute__ ((always_inline))
+#else
+#define DILAY_KERNEL inline
+#endif
+
+namespace CpuDispatch
+{
+  enum class Isa
+  {
+    Generic,
+    SSE4,
+    AVX2,
+    AVX512
+  };
+
+  bool        isSupported (Isa);
+  Isa         best ();
+  Isa         selected ();
+  // selects a supported instruction set for all kernels, e.g. to validate them against each other
+  bool        select (Isa);
+  const char* name (Isa);
+}
+
+#endif
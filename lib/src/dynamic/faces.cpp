@@ -4,37 +4,63 @@
  */
 #include "dynamic/faces.hpp"
 
-void DynamicFaces::insert (unsigned int i) { this->_uncommitted.insert (i); }
+void DynamicFaces::insert (unsigned int i)
+{
+  if (i >= this->_flags.size ())
+  {
+    this->_flags.resize (i + 1, 0);
+  }
+  if ((this->_flags[i] & DynamicFaces::uncommittedFlag) == 0)
+  {
+    this->_flags[i] |= DynamicFaces::uncommittedFlag;
+    this->_uncommitted.push_back (i);
+  }
+}
 
 void DynamicFaces::insert (const DynamicFaces::Container& v)
 {
-  this->_uncommitted.insert (v.begin (), v.end ());
+  for (unsigned int i : v)
+  {
+    this->insert (i);
+  }
 }
 
 void DynamicFaces::reset ()
 {
   this->resetCommitted ();
+
+  for (unsigned int i : this->_uncommitted)
+  {
+    this->_flags[i] &= ~DynamicFaces::uncommittedFlag;
+  }
   this->_uncommitted.clear ();
 }
 
-void DynamicFaces::resetCommitted () { this->_indices.clear (); }
-
-void DynamicFaces::commit ()
+void DynamicFaces::resetCommitted ()
 {
-  if (this->_indices.empty ())
+  for (unsigned int i : this->_indices)
   {
-    this->_indices.swap (this->_uncommitted);
+    this->_flags[i] &= ~DynamicFaces::committedFlag;
   }
-  else
+  this->_indices.clear ();
+}
+
+void DynamicFaces::commit ()
+{
+  for (unsigned int i : this->_uncommitted)
   {
-    this->_indices.insert (this->_uncommitted.begin (), this->_uncommitted.end ());
-    this->_uncommitted.clear ();
+    if ((this->_flags[i] & DynamicFaces::committedFlag) == 0)
+    {
+      this->_indices.push_back (i);
+    }
+    this->_flags[i] = DynamicFaces::committedFlag;
   }
+  this->_uncommitted.clear ();
 }
 
 bool DynamicFaces::contains (unsigned int i) const
 {
-  return this->_indices.find (i) != this->_indices.end ();
+  return i < this->_flags.size () && (this->_flags[i] & DynamicFaces::committedFlag);
 }
 
 bool DynamicFaces::isEmpty () const
@@ -46,26 +72,29 @@ bool DynamicFaces::hasUncomitted () const { return this->_uncommitted.empty () =
 
 void DynamicFaces::filter (const std::function<bool(unsigned int)>& f)
 {
-  for (auto it = this->_indices.begin (); it != this->_indices.end ();)
-  {
-    if (f (*it) == false)
-    {
-      it = this->_indices.erase (it);
-    }
-    else
-    {
-      ++it;
-    }
-  }
-  for (auto it = this->_uncommitted.begin (); it != this->_uncommitted.end ();)
-  {
-    if (f (*it) == false)
-    {
-      it = this->_uncommitted.erase (it);
-    }
-    else
+  const auto filterContainer = [this, &f](Container& container, unsigned char flag) {
+    unsigned int numKept = 0;
+
+    for (unsigned int i : container)
     {
-      ++it;
+      if (f (i))
+      {
+        container[numKept++] = i;
+      }
+      else
+      {
+        this->_flags[i] &= ~flag;
+      }
     }
-  }
+    container.resize (numKept);
+  };
+
+  filterContainer (this->_indices, DynamicFaces::committedFlag);
+  filterContainer (this->_uncommitted, DynamicFaces::uncommittedFlag);
+}
+
+std::size_t DynamicFaces::numBytes () const
+{
+  return ((this->_indices.capacity () + this->_uncommitted.capacity ()) * sizeof (unsigned int)) +
+         this->_flags.capacity ();
 }
@@ -5,17 +5,25 @@
 #ifndef DILAY_DYNAMIC_FACES
 #define DILAY_DYNAMIC_FACES
 
+#include <cstddef>
 #include <functional>
-#include <unordered_set>
+#include <vector>
 
+/* A set of face indices, which are first inserted as uncommitted and become part of the set
+ * once they are committed.  Membership is tracked by a dense array of flags indexed by face,
+ * while committed and uncommitted indices are kept in lists in order of their insertion.
+ * All operations only touch the indices involved, so the storage is reused without further
+ * allocations once it has grown to the size of a mesh.
+ */
 class DynamicFaces
 {
 public:
-  typedef std::unordered_set<unsigned int> Container;
+  typedef std::vector<unsigned int> Container;
 
   const Container& indices () const { return this->_indices; }
   const Container& uncommitted () const { return this->_uncommitted; }
   unsigned int     numElements () const { return this->_indices.size (); }
+  std::size_t      numBytes () const;
 
   Container::iterator       begin () { return this->_indices.begin (); }
   Container::iterator       end () { return this->_indices.end (); }
@@ -33,8 +41,12 @@ public:
   void filter (const std::function<bool(unsigned int)>&);
 
 private:
-  Container _indices;
-  Container _uncommitted;
+  static constexpr unsigned char committedFlag = 1;
+  static constexpr unsigned char uncommittedFlag = 2;
+
+  Container                  _indices;
+  Container                  _uncommitted;
+  std::vector<unsigned char> _flags;
 };
 
 #endif
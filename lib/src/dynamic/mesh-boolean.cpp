@@ -0,0 +1,969 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <array>
+#include <glm/glm.hpp>
+#include <map>
+#include <numeric>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../mesh.hpp"
+#include "dynamic/faces.hpp"
+#include "dynamic/mesh-boolean.hpp"
+#include "dynamic/mesh.hpp"
+#include "hash.hpp"
+#include "intersection.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/ray.hpp"
+#include "primitive/triangle.hpp"
+#include "thread-pool.hpp"
+#include "util.hpp"
+
+namespace
+{
+  typedef DynamicMeshBoolean::Operation         Operation;
+  typedef std::pair<unsigned int, unsigned int> Edge;
+  typedef std::pair<unsigned int, unsigned int> Segment;
+
+  // six times the signed volume of the tetrahedron `(a, b, c, d)`
+  double orientation (const glm::dvec3& a, const glm::dvec3& b, const glm::dvec3& c,
+                      const glm::dvec3& d)
+  {
+    return glm::dot (glm::cross (b - a, c - a), d - a);
+  }
+
+  // twice the signed area of the triangle `(a, b, c)`
+  double orientation (const glm::dvec2& a, const glm::dvec2& b, const glm::dvec2& c)
+  {
+    return ((b.x - a.x) * (c.y - a.y)) - ((b.y - a.y) * (c.x - a.x));
+  }
+
+  bool haveOppositeSigns (double a, double b)
+  {
+    return (a > 0.0 && b < 0.0) || (a < 0.0 && b > 0.0);
+  }
+
+  // tests if two segments cross each other in a single point that is not an end point
+  bool crosses (const glm::dvec2& a1, const glm::dvec2& a2, const glm::dvec2& b1,
+                const glm::dvec2& b2)
+  {
+    return haveOppositeSigns (orientation (a1, a2, b1), orientation (a1, a2, b2)) &&
+           haveOppositeSigns (orientation (b1, b2, a1), orientation (b1, b2, a2));
+  }
+
+  // parity test, such that the holes of bridged polygons are outside
+  bool contains (const std::vector<glm::dvec2>& polygon, const glm::dvec2& p)
+  {
+    bool isInside = false;
+
+    for (std::size_t i = 0, j = polygon.size () - 1; i < polygon.size (); j = i++)
+    {
+      const glm::dvec2& a = polygon[i];
+      const glm::dvec2& b = polygon[j];
+
+      if ((a.y > p.y) != (b.y > p.y) && p.x < a.x + ((p.y - a.y) * (b.x - a.x) / (b.y - a.y)))
+      {
+        isInside = !isInside;
+      }
+    }
+    return isInside;
+  }
+
+  double signedArea (const std::vector<glm::dvec2>& polygon)
+  {
+    double area = 0.0;
+
+    for (std::size_t i = 0, j = polygon.size () - 1; i < polygon.size (); j = i++)
+    {
+      area += (polygon[j].x * polygon[i].y) - (polygon[i].x * polygon[j].y);
+    }
+    return 0.5 * area;
+  }
+
+  // vertex of a retriangulated face, which is either a vertex of its mesh or a cut point
+  struct Node
+  {
+    bool         isCutPoint;
+    unsigned int index;
+
+    bool operator== (const Node& o) const
+    {
+      return this->isCutPoint == o.isCutPoint && this->index == o.index;
+    }
+  };
+
+  typedef std::vector<Node> Polygon;
+
+  /* Triangulates a counter-clockwise polygon by clipping ears.  Polygons may be bridged to their
+   * holes, such that the nodes of a bridge appear twice.  Fails if no ear can be clipped.
+   */
+  bool triangulate (const Polygon& polygon, const std::vector<glm::dvec2>& positions,
+                    std::vector<Node>& triangles)
+  {
+    if (polygon.size () < 3)
+    {
+      return false;
+    }
+
+    std::vector<unsigned int> remaining (polygon.size ());
+    std::iota (remaining.begin (), remaining.end (), 0);
+
+    const auto isEar = [&polygon, &positions, &remaining](unsigned int a, unsigned int b,
+                                                           unsigned int c) {
+      if (orientation (positions[a], positions[b], positions[c]) <= 0.0)
+      {
+        return false;
+      }
+      for (unsigned int i : remaining)
+      {
+        if (polygon[i] == polygon[a] || polygon[i] == polygon[b] || polygon[i] == polygon[c])
+        {
+          continue;
+        }
+        else if (orientation (positions[a], positions[b], positions[i]) >= 0.0 &&
+                 orientation (positions[b], positions[c], positions[i]) >= 0.0 &&
+                 orientation (positions[c], positions[a], positions[i]) >= 0.0)
+        {
+          return false;
+        }
+      }
+      return true;
+    };
+
+    while (remaining.size () > 3)
+    {
+      const unsigned int n = remaining.size ();
+      bool               isClipped = false;
+
+      for (unsigned int k = 0; k < n && isClipped == false; k++)
+      {
+        const unsigned int a = remaining[(k + n - 1) % n];
+        const unsigned int b = remaining[k];
+        const unsigned int c = remaining[(k + 1) % n];
+
+        if (isEar (a, b, c))
+        {
+          triangles.push_back (polygon[a]);
+          triangles.push_back (polygon[b]);
+          triangles.push_back (polygon[c]);
+          remaining.erase (remaining.begin () + k);
+          isClipped = true;
+        }
+      }
+      if (isClipped == false)
+      {
+        return false;
+      }
+    }
+
+    if (orientation (positions[remaining[0]], positions[remaining[1]], positions[remaining[2]]) <=
+        0.0)
+    {
+      return false;
+    }
+    triangles.push_back (polygon[remaining[0]]);
+    triangles.push_back (polygon[remaining[1]]);
+    triangles.push_back (polygon[remaining[2]]);
+    return true;
+  }
+
+  /* Projects positions onto the coordinate plane that is most parallel to a face, such that the
+   * face keeps its counter-clockwise orientation.
+   */
+  struct Projection
+  {
+    unsigned int u;
+    unsigned int v;
+
+    Projection (const glm::vec3& normal)
+    {
+      const glm::vec3    n = glm::abs (normal);
+      const unsigned int k = (n.x >= n.y && n.x >= n.z) ? 0 : (n.y >= n.z ? 1 : 2);
+      const bool         isPositive = normal[k] > 0.0f;
+
+      this->u = isPositive ? (k + 1) % 3 : (k + 2) % 3;
+      this->v = isPositive ? (k + 2) % 3 : (k + 1) % 3;
+    }
+
+    glm::dvec2 operator() (const glm::vec3& p) const
+    {
+      return glm::dvec2 (p[this->u], p[this->v]);
+    }
+  };
+
+  // point where an edge of one mesh pierces a face of the other mesh
+  struct CutPoint
+  {
+    glm::vec3    position;
+    unsigned int side;          // mesh of the edge
+    double       edgeParameter; // from the vertex of the edge with the smaller index
+  };
+
+  enum class Pierce
+  {
+    None,
+    Point,
+    Degenerate
+  };
+
+  enum class FaceState : unsigned char
+  {
+    Unknown,
+    Visited,
+    Cut,
+    Inside,
+    Outside
+  };
+
+  // region of a cut face between the intersection curve and the edges of the face
+  struct Piece
+  {
+    std::vector<Node> triangles;
+    bool              isInside;
+  };
+
+  struct Side
+  {
+    const DynamicMesh&                                  mesh;
+    std::map<unsigned int, std::vector<Segment>>        segments;
+    std::unordered_map<Edge, std::vector<unsigned int>> edgePoints;
+    std::vector<FaceState>                              states;
+    std::vector<Piece>                                  pieces;
+    std::vector<unsigned int>                           vertexMap;
+
+    Side (const DynamicMesh& m)
+      : mesh (m)
+      , states (m.mesh ().numIndices () / 3, FaceState::Unknown)
+      , vertexMap (m.mesh ().numVertices (), Util::invalidIndex ())
+    {
+    }
+
+    unsigned int numFaceSlots () const { return this->states.size (); }
+  };
+
+  struct BooleanOperation
+  {
+    const Operation                                     operation;
+    DynamicMesh&                                        result;
+    const CancellationToken*                            token;
+    Side                                                sideA;
+    Side                                                sideB;
+    std::vector<CutPoint>                               cutPoints;
+    std::map<std::array<unsigned int, 4>, unsigned int> cutPointIndices;
+    std::vector<unsigned int>                           cutPointMap;
+
+    BooleanOperation (const DynamicMesh& a, const DynamicMesh& b, Operation o, DynamicMesh& r,
+                      const CancellationToken* t)
+      : operation (o)
+      , result (r)
+      , token (t)
+      , sideA (a)
+      , sideB (b)
+    {
+    }
+
+    bool isCancelled () const { return this->token && this->token->isCancelled (); }
+
+    Side& side (unsigned int s) { return s == 0 ? this->sideA : this->sideB; }
+
+    const Side& side (unsigned int s) const { return s == 0 ? this->sideA : this->sideB; }
+
+    const glm::vec3& position (unsigned int s, const Node& node) const
+    {
+      return node.isCutPoint ? this->cutPoints[node.index].position
+                             : this->side (s).mesh.vertex (node.index);
+    }
+
+    std::vector<glm::dvec2> project (unsigned int s, const Projection& projection,
+                                     const Polygon& polygon) const
+    {
+      std::vector<glm::dvec2> positions;
+      positions.reserve (polygon.size ());
+
+      for (const Node& node : polygon)
+      {
+        positions.push_back (projection (this->position (s, node)));
+      }
+      return positions;
+    }
+
+    /* Tests if the edge `(v1, v2)` of side `s` pierces the face `f` of the other side.  Each
+     * test only depends on the edge and the face, such that faces that share an edge agree on
+     * its cut points.
+     */
+    Pierce pierce (unsigned int s, unsigned int v1, unsigned int v2, unsigned int f,
+                   unsigned int& point)
+    {
+      if (v1 > v2)
+      {
+        std::swap (v1, v2);
+      }
+
+      const DynamicMesh& mesh = this->side (s).mesh;
+      const DynamicMesh& other = this->side (1 - s).mesh;
+
+      unsigned int j1, j2, j3;
+      other.vertexIndices (f, j1, j2, j3);
+
+      const glm::dvec3 p (mesh.vertex (v1));
+      const glm::dvec3 q (mesh.vertex (v2));
+      const glm::dvec3 a (other.vertex (j1));
+      const glm::dvec3 b (other.vertex (j2));
+      const glm::dvec3 c (other.vertex (j3));
+
+      const double dp = orientation (a, b, c, p);
+      const double dq = orientation (a, b, c, q);
+
+      if (dp == 0.0 || dq == 0.0)
+      {
+        return Pierce::Degenerate;
+      }
+      else if (haveOppositeSigns (dp, dq) == false)
+      {
+        return Pierce::None;
+      }
+
+      const double e1 = orientation (p, q, a, b);
+      const double e2 = orientation (p, q, b, c);
+      const double e3 = orientation (p, q, c, a);
+
+      if (e1 == 0.0 || e2 == 0.0 || e3 == 0.0)
+      {
+        return Pierce::Degenerate;
+      }
+      else if (haveOppositeSigns (e1, e2) || haveOppositeSigns (e1, e3))
+      {
+        return Pierce::None;
+      }
+
+      const std::array<unsigned int, 4> key = {{s, v1, v2, f}};
+      const auto                        it = this->cutPointIndices.find (key);
+
+      if (it == this->cutPointIndices.end ())
+      {
+        const double t = dp / (dp - dq);
+
+        point = this->cutPoints.size ();
+        this->cutPoints.push_back (CutPoint{glm::vec3 (glm::mix (p, q, t)), s, t});
+        this->cutPointIndices.emplace (key, point);
+        this->side (s).edgePoints[Edge (v1, v2)].push_back (point);
+      }
+      else
+      {
+        point = it->second;
+      }
+      return Pierce::Point;
+    }
+
+    // adds the segment of the intersection curve that crosses two faces
+    bool intersectFaces (unsigned int fA, unsigned int fB)
+    {
+      std::array<unsigned int, 6> points;
+      unsigned int                numPoints = 0;
+
+      for (unsigned int s = 0; s < 2; s++)
+      {
+        const unsigned int f = s == 0 ? fA : fB;
+        const unsigned int o = s == 0 ? fB : fA;
+
+        unsigned int i[3];
+        this->side (s).mesh.vertexIndices (f, i[0], i[1], i[2]);
+
+        for (unsigned int k = 0; k < 3; k++)
+        {
+          unsigned int point;
+
+          switch (this->pierce (s, i[k], i[(k + 1) % 3], o, point))
+          {
+            case Pierce::None:
+              break;
+            case Pierce::Point:
+              points[numPoints++] = point;
+              break;
+            case Pierce::Degenerate:
+              return false;
+          }
+        }
+      }
+
+      if (numPoints == 0)
+      {
+        return true;
+      }
+      else if (numPoints != 2 || points[0] == points[1])
+      {
+        return false;
+      }
+      else
+      {
+        const Segment segment (points[0], points[1]);
+
+        this->sideA.segments[fA].push_back (segment);
+        this->sideB.segments[fB].push_back (segment);
+        return true;
+      }
+    }
+
+    // only visits the faces of both meshes that overlap the bounds of the other mesh
+    bool intersect ()
+    {
+      const PrimAABox boundsA = this->sideA.mesh.bounds ();
+      const PrimAABox boundsB = this->sideB.mesh.bounds ();
+      const glm::vec3 min = glm::max (boundsA.minimum (), boundsB.minimum ());
+      const glm::vec3 max = glm::min (boundsA.maximum (), boundsB.maximum ());
+
+      if (glm::any (glm::greaterThan (min, max)))
+      {
+        return true;
+      }
+
+      DynamicFaces facesA;
+      DynamicFaces facesB;
+      this->sideB.mesh.intersects (PrimAABox (min, max), facesB);
+
+      for (unsigned int fB : facesB)
+      {
+        if (this->isCancelled ())
+        {
+          return false;
+        }
+
+        const PrimTriangle triangle = this->sideB.mesh.face (fB);
+        const glm::vec3    margin (Util::epsilon ());
+
+        facesA.reset ();
+        this->sideA.mesh.intersects (
+          PrimAABox (triangle.minimum () - margin, triangle.maximum () + margin), facesA);
+
+        for (unsigned int fA : facesA)
+        {
+          if (this->intersectFaces (fA, fB) == false)
+          {
+            return false;
+          }
+        }
+      }
+
+      for (unsigned int s = 0; s < 2; s++)
+      {
+        for (auto& e : this->side (s).edgePoints)
+        {
+          std::sort (e.second.begin (), e.second.end (), [this](unsigned int p, unsigned int q) {
+            return this->cutPoints[p].edgeParameter < this->cutPoints[q].edgeParameter;
+          });
+        }
+      }
+      this->cutPointMap.resize (this->cutPoints.size (), Util::invalidIndex ());
+      return true;
+    }
+
+    // splits the polygon that contains the end points of a chain of cut points
+    bool splitPolygon (std::vector<Polygon>& polygons, const std::vector<unsigned int>& chain)
+    {
+      const Node start{true, chain.front ()};
+      const Node end{true, chain.back ()};
+
+      for (Polygon& polygon : polygons)
+      {
+        const auto s = std::find (polygon.begin (), polygon.end (), start);
+
+        if (s == polygon.end ())
+        {
+          continue;
+        }
+
+        const auto e = std::find (polygon.begin (), polygon.end (), end);
+
+        if (e == polygon.end ())
+        {
+          return false;
+        }
+
+        const std::size_t n = polygon.size ();
+        const std::size_t iS = s - polygon.begin ();
+        const std::size_t iE = e - polygon.begin ();
+        Polygon           polygon1;
+        Polygon           polygon2;
+
+        for (std::size_t i = iS;; i = (i + 1) % n)
+        {
+          polygon1.push_back (polygon[i]);
+          if (i == iE)
+          {
+            break;
+          }
+        }
+        for (std::size_t c = chain.size () - 2; c > 0; c--)
+        {
+          polygon1.push_back (Node{true, chain[c]});
+        }
+
+        for (std::size_t i = iE;; i = (i + 1) % n)
+        {
+          polygon2.push_back (polygon[i]);
+          if (i == iS)
+          {
+            break;
+          }
+        }
+        for (std::size_t c = 1; c + 1 < chain.size (); c++)
+        {
+          polygon2.push_back (Node{true, chain[c]});
+        }
+
+        polygon = std::move (polygon1);
+        polygons.push_back (std::move (polygon2));
+        return true;
+      }
+      return false;
+    }
+
+    /* Cuts a closed loop of cut points out of the polygon that contains it.  The polygon is
+     * bridged to the loop by its shortest edge to a node of the loop that crosses no other edge.
+     */
+    bool insertLoop (unsigned int s, const Projection& projection, std::vector<Polygon>& polygons,
+                     const std::vector<unsigned int>& loop)
+    {
+      Polygon hole;
+      for (unsigned int p : loop)
+      {
+        hole.push_back (Node{true, p});
+      }
+
+      std::vector<glm::dvec2> holePositions = this->project (s, projection, hole);
+
+      if (signedArea (holePositions) < 0.0)
+      {
+        std::reverse (hole.begin (), hole.end ());
+        std::reverse (holePositions.begin (), holePositions.end ());
+      }
+
+      for (Polygon& polygon : polygons)
+      {
+        const std::vector<glm::dvec2> positions = this->project (s, projection, polygon);
+
+        if (contains (positions, holePositions[0]) == false)
+        {
+          continue;
+        }
+
+        const auto crossesEdges = [](const Polygon& nodes, const std::vector<glm::dvec2>& ps,
+                                     const Node& n1, const Node& n2, const glm::dvec2& p1,
+                                     const glm::dvec2& p2) {
+          for (std::size_t i = 0, j = nodes.size () - 1; i < nodes.size (); j = i++)
+          {
+            if (nodes[i] == n1 || nodes[i] == n2 || nodes[j] == n1 || nodes[j] == n2)
+            {
+              continue;
+            }
+            else if (crosses (p1, p2, ps[i], ps[j]))
+            {
+              return true;
+            }
+          }
+          return false;
+        };
+
+        unsigned int bridgeP = Util::invalidIndex ();
+        unsigned int bridgeH = Util::invalidIndex ();
+        double       bridgeLength = 0.0;
+
+        for (unsigned int i = 0; i < polygon.size (); i++)
+        {
+          for (unsigned int j = 0; j < hole.size (); j++)
+          {
+            const glm::dvec2 d = holePositions[j] - positions[i];
+            const double     length = glm::dot (d, d);
+
+            if ((bridgeP == Util::invalidIndex () || length < bridgeLength) &&
+                crossesEdges (polygon, positions, polygon[i], hole[j], positions[i],
+                              holePositions[j]) == false &&
+                crossesEdges (hole, holePositions, polygon[i], hole[j], positions[i],
+                              holePositions[j]) == false)
+            {
+              bridgeP = i;
+              bridgeH = j;
+              bridgeLength = length;
+            }
+          }
+        }
+
+        if (bridgeP == Util::invalidIndex ())
+        {
+          return false;
+        }
+
+        // the hole is traversed clockwise
+        Polygon bridged (polygon.begin (), polygon.begin () + bridgeP + 1);
+        for (std::size_t k = 0; k <= hole.size (); k++)
+        {
+          bridged.push_back (hole[(bridgeH + hole.size () - (k % hole.size ())) % hole.size ()]);
+        }
+        bridged.insert (bridged.end (), polygon.begin () + bridgeP, polygon.end ());
+
+        polygon = std::move (bridged);
+        polygons.push_back (std::move (hole));
+        return true;
+      }
+      return false;
+    }
+
+    bool isInside (unsigned int s, const glm::vec3& origin, const glm::vec3& direction) const
+    {
+      Intersection intersection;
+
+      return this->side (1 - s).mesh.intersects (PrimRay (origin, direction), intersection,
+                                                 true) &&
+             glm::dot (intersection.normal (), direction) > 0.0f;
+    }
+
+    /* Splits a cut face along its segments of the intersection curve into pieces.  Chains of
+     * segments that end on the edges of the face split pieces in two, whereas closed loops cut
+     * holes into pieces.
+     */
+    bool retriangulate (unsigned int s, unsigned int f, const std::vector<Segment>& segments)
+    {
+      Side& side = this->side (s);
+
+      unsigned int i[3];
+      side.mesh.vertexIndices (f, i[0], i[1], i[2]);
+
+      const glm::vec3  normal = side.mesh.faceNormal (f);
+      const Projection projection (normal);
+      Polygon          boundary;
+
+      for (unsigned int k = 0; k < 3; k++)
+      {
+        const unsigned int v1 = i[k];
+        const unsigned int v2 = i[(k + 1) % 3];
+        const auto         it = side.edgePoints.find (Edge (glm::min (v1, v2), glm::max (v1, v2)));
+
+        boundary.push_back (Node{false, v1});
+
+        if (it != side.edgePoints.end ())
+        {
+          if (v1 < v2)
+          {
+            for (auto p = it->second.begin (); p != it->second.end (); ++p)
+            {
+              boundary.push_back (Node{true, *p});
+            }
+          }
+          else
+          {
+            for (auto p = it->second.rbegin (); p != it->second.rend (); ++p)
+            {
+              boundary.push_back (Node{true, *p});
+            }
+          }
+        }
+      }
+
+      std::map<unsigned int, std::vector<unsigned int>> neighbours;
+      for (const Segment& segment : segments)
+      {
+        neighbours[segment.first].push_back (segment.second);
+        neighbours[segment.second].push_back (segment.first);
+      }
+
+      // cut points on the edges of the face end chains, all others continue them
+      for (const auto& n : neighbours)
+      {
+        const bool isOnEdge = this->cutPoints[n.first].side == s;
+
+        if (n.second.size () != (isOnEdge ? 1 : 2) ||
+            (n.second.size () == 2 && n.second[0] == n.second[1]))
+        {
+          return false;
+        }
+      }
+
+      std::set<unsigned int> visited;
+
+      const auto walk = [&neighbours, &visited](unsigned int start) {
+        std::vector<unsigned int> chain{start};
+        unsigned int              previous = Util::invalidIndex ();
+        unsigned int              current = start;
+
+        visited.insert (start);
+        for (;;)
+        {
+          const std::vector<unsigned int>& n = neighbours.at (current);
+          const unsigned int               next =
+            n[0] != previous ? n[0] : (n.size () > 1 ? n[1] : Util::invalidIndex ());
+
+          if (next == Util::invalidIndex () || next == start)
+          {
+            return chain;
+          }
+          chain.push_back (next);
+          visited.insert (next);
+          previous = current;
+          current = next;
+        }
+      };
+
+      std::vector<Polygon> polygons{boundary};
+
+      for (const auto& n : neighbours)
+      {
+        if (this->cutPoints[n.first].side == s && visited.count (n.first) == 0)
+        {
+          if (this->splitPolygon (polygons, walk (n.first)) == false)
+          {
+            return false;
+          }
+        }
+      }
+      for (const auto& n : neighbours)
+      {
+        if (visited.count (n.first) == 0)
+        {
+          if (this->insertLoop (s, projection, polygons, walk (n.first)) == false)
+          {
+            return false;
+          }
+        }
+      }
+
+      for (const Polygon& polygon : polygons)
+      {
+        Piece piece;
+
+        if (triangulate (polygon, this->project (s, projection, polygon), piece.triangles) ==
+            false)
+        {
+          return false;
+        }
+
+        const glm::vec3 center = (this->position (s, piece.triangles[0]) +
+                                  this->position (s, piece.triangles[1]) +
+                                  this->position (s, piece.triangles[2])) /
+                                 3.0f;
+
+        piece.isInside = this->isInside (s, center, normal);
+        side.pieces.push_back (std::move (piece));
+      }
+      side.states[f] = FaceState::Cut;
+      return true;
+    }
+
+    /* Classifies the faces of side `s` that have not been cut.  Faces outside of the bounds of
+     * the other mesh are outside, and so are all faces that are connected to them without
+     * crossing the intersection curve.  Only the remaining components of faces are tested by
+     * casting a ray.
+     */
+    bool classify (unsigned int s)
+    {
+      Side&           side = this->side (s);
+      const PrimAABox bounds = this->side (1 - s).mesh.bounds ();
+      const glm::vec3 margin (Util::epsilon ());
+
+      DynamicFaces region;
+      side.mesh.intersects (PrimAABox (bounds.minimum () - margin, bounds.maximum () + margin),
+                            region);
+
+      std::vector<bool> isInRegion (side.numFaceSlots (), false);
+      for (unsigned int f : region)
+      {
+        isInRegion[f] = true;
+      }
+
+      for (unsigned int f = 0; f < side.numFaceSlots (); f++)
+      {
+        if (side.mesh.isFreeFace (f) == false && isInRegion[f] == false &&
+            side.states[f] == FaceState::Unknown)
+        {
+          side.states[f] = FaceState::Outside;
+        }
+      }
+
+      std::vector<unsigned int> component;
+      for (unsigned int f : region)
+      {
+        if (side.states[f] != FaceState::Unknown)
+        {
+          continue;
+        }
+        else if (this->isCancelled ())
+        {
+          return false;
+        }
+
+        bool isOutside = false;
+
+        component.clear ();
+        component.push_back (f);
+        side.states[f] = FaceState::Visited;
+
+        for (std::size_t k = 0; k < component.size (); k++)
+        {
+          const unsigned int g = component[k];
+
+          for (unsigned int h = 3 * g; h < (3 * g) + 3; h++)
+          {
+            const unsigned int o = side.mesh.oppositeHalfEdge (h);
+
+            if (o == Util::invalidIndex ())
+            {
+              continue;
+            }
+
+            const unsigned int a = side.mesh.halfEdgeFace (o);
+
+            if (isInRegion[a] == false)
+            {
+              isOutside = true;
+            }
+            else if (side.states[a] == FaceState::Unknown)
+            {
+              side.states[a] = FaceState::Visited;
+              component.push_back (a);
+            }
+          }
+        }
+
+        if (isOutside == false)
+        {
+          isOutside = this->isInside (s, side.mesh.face (f).center (),
+                                      side.mesh.faceNormal (f)) == false;
+        }
+        for (unsigned int g : component)
+        {
+          side.states[g] = isOutside ? FaceState::Outside : FaceState::Inside;
+        }
+      }
+      return true;
+    }
+
+    bool keeps (unsigned int s, bool isInside) const
+    {
+      switch (this->operation)
+      {
+        case Operation::Union:
+          return isInside == false;
+        case Operation::Difference:
+          return s == 0 ? isInside == false : isInside;
+        case Operation::Intersection:
+          return isInside;
+      }
+      DILAY_IMPOSSIBLE
+    }
+
+    unsigned int resultVertex (unsigned int s, const Node& node)
+    {
+      unsigned int& index =
+        node.isCutPoint ? this->cutPointMap[node.index] : this->side (s).vertexMap[node.index];
+
+      if (index == Util::invalidIndex ())
+      {
+        index = this->result.addVertex (this->position (s, node), glm::vec3 (0.0f));
+      }
+      return index;
+    }
+
+    // faces of the subtracted mesh are flipped
+    unsigned int addFace (unsigned int s, const Node& n1, const Node& n2, const Node& n3)
+    {
+      const unsigned int i1 = this->resultVertex (s, n1);
+      const unsigned int i2 = this->resultVertex (s, n2);
+      const unsigned int i3 = this->resultVertex (s, n3);
+
+      if (this->operation == Operation::Difference && s == 1)
+      {
+        return this->result.addFace (i1, i3, i2);
+      }
+      else
+      {
+        return this->result.addFace (i1, i2, i3);
+      }
+    }
+
+    // cut points are shared by both sides, which stitches their pieces along the curve
+    bool assemble ()
+    {
+      DynamicFaces stitchedFaces;
+
+      for (unsigned int s = 0; s < 2; s++)
+      {
+        const Side& side = this->side (s);
+
+        for (unsigned int f = 0; f < side.numFaceSlots (); f++)
+        {
+          const FaceState state = side.states[f];
+
+          if ((state == FaceState::Inside || state == FaceState::Outside) &&
+              this->keeps (s, state == FaceState::Inside))
+          {
+            unsigned int i1, i2, i3;
+            side.mesh.vertexIndices (f, i1, i2, i3);
+
+            this->addFace (s, Node{false, i1}, Node{false, i2}, Node{false, i3});
+          }
+        }
+        for (const Piece& piece : side.pieces)
+        {
+          if (this->keeps (s, piece.isInside))
+          {
+            for (std::size_t i = 0; i < piece.triangles.size (); i += 3)
+            {
+              stitchedFaces.insert (this->addFace (s, piece.triangles[i], piece.triangles[i + 1],
+                                                   piece.triangles[i + 2]));
+            }
+          }
+        }
+      }
+      stitchedFaces.commit ();
+      this->result.setAllNormals ();
+
+      return stitchedFaces.isEmpty () || this->result.checkConsistency (stitchedFaces);
+    }
+
+    bool run ()
+    {
+      this->result.reset ();
+
+      if (this->sideA.mesh.isEmpty () || this->sideB.mesh.isEmpty () ||
+          this->intersect () == false)
+      {
+        return false;
+      }
+
+      for (unsigned int s = 0; s < 2; s++)
+      {
+        for (const auto& f : this->side (s).segments)
+        {
+          if (this->isCancelled () || this->retriangulate (s, f.first, f.second) == false)
+          {
+            return false;
+          }
+        }
+      }
+      return this->classify (0) && this->classify (1) && this->isCancelled () == false &&
+             this->assemble ();
+    }
+  };
+}
+
+namespace DynamicMeshBoolean
+{
+  bool compute (const DynamicMesh& meshA, const DynamicMesh& meshB, Operation operation,
+                DynamicMesh& result, const CancellationToken* token)
+  {
+    BooleanOperation boolean (meshA, meshB, operation, result, token);
+
+    if (boolean.run ())
+    {
+      return true;
+    }
+    else
+    {
+      result.reset ();
+      return false;
+    }
+  }
+}
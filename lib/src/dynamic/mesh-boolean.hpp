@@ -0,0 +1,32 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_DYNAMIC_MESH_BOOLEAN
+#define DILAY_DYNAMIC_MESH_BOOLEAN
+
+class CancellationToken;
+class DynamicMesh;
+
+/* Boolean operations of two closed meshes, which cut both meshes along their intersection curve.
+ * Only faces that are crossed by the curve are retriangulated, whereas all other faces are kept
+ * or dropped as a whole.
+ */
+namespace DynamicMeshBoolean
+{
+  enum class Operation
+  {
+    Union,
+    Difference,
+    Intersection
+  };
+
+  /* Returns `false` if the operation has been cancelled, or if the meshes touch in degenerate
+   * configurations (e.g. coplanar faces) that are not resolved, or if the result would not be a
+   * consistent mesh.  Callers should then fall back to sampling both meshes.
+   */
+  bool compute (const DynamicMesh&, const DynamicMesh&, Operation, DynamicMesh&,
+                const CancellationToken* = nullptr);
+}
+
+#endif
@@ -0,0 +1,26 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_DYNAMIC_MESH_CACHE
+#define DILAY_DYNAMIC_MESH_CACHE
+
+#include <vector>
+#include "dynamic/octree.hpp"
+
+/* Adjacency and octree of a pruned dynamic mesh in flat arrays, which binary files store along
+ * with the mesh, such that it is loaded without building them (cf. `DynamicMesh::cache`).  The
+ * faces adjacent to vertex `i` are `[adjacencyOffsets[i], adjacencyOffsets[i + 1])` of
+ * `adjacentFaces`.
+ */
+struct DynamicMeshCache
+{
+  std::vector<unsigned int> adjacencyOffsets;
+  std::vector<unsigned int> adjacentFaces;
+  std::vector<unsigned int> oppositeHalfEdges;
+  DynamicOctreeNodes        octree;
+
+  bool isEmpty () const { return this->adjacencyOffsets.empty (); }
+};
+
+#endif
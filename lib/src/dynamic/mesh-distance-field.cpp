@@ -0,0 +1,248 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cmath>
+#include <glm/glm.hpp>
+#include <utility>
+#include <vector>
+#include "../mesh.hpp"
+#include "dynamic/mesh-distance-field.hpp"
+#include "dynamic/mesh-winding-number.hpp"
+#include "dynamic/mesh.hpp"
+#include "isosurface-extraction/grid.hpp"
+#include "primitive/aabox.hpp"
+#include "util.hpp"
+
+struct DynamicMeshDistanceField::Impl
+{
+  IsosurfaceExtractionGrid grid;
+  glm::vec3                sampleMin;
+  glm::vec3                sampleMax;
+
+  Impl (IsosurfaceExtractionGrid& g)
+    : grid (std::move (g))
+  {
+    const glm::uvec3& numSamples = this->grid.numSamples ();
+
+    assert (numSamples.x > 1 && numSamples.y > 1 && numSamples.z > 1);
+
+    this->sampleMin = this->grid.samplePos (0, 0, 0);
+    this->sampleMax = this->grid.samplePos (numSamples.x - 1, numSamples.y - 1, numSamples.z - 1);
+  }
+
+  float resolution () const { return this->grid.resolution (); }
+
+  PrimAABox bounds () const { return PrimAABox (this->sampleMin, this->sampleMax); }
+
+  float sample (unsigned int x, unsigned int y, unsigned int z) const
+  {
+    return this->grid.sample (this->grid.sampleIndex (x, y, z));
+  }
+
+  float distance (const glm::vec3& pos) const
+  {
+    const glm::vec3 outside =
+      glm::max (glm::max (this->sampleMin - pos, pos - this->sampleMax), glm::vec3 (0.0f));
+
+    // the boundary samples of the grid are outside of the mesh
+    if (outside != glm::vec3 (0.0f))
+    {
+      return glm::max (glm::length (outside), this->resolution ());
+    }
+
+    const glm::uvec3 maxCell = this->grid.numSamples () - glm::uvec3 (2);
+    const glm::vec3  p = (pos - this->sampleMin) / this->resolution ();
+    const glm::uvec3 c = glm::min (glm::uvec3 (p), maxCell);
+    const glm::vec3  t = glm::clamp (p - glm::vec3 (c), glm::vec3 (0.0f), glm::vec3 (1.0f));
+
+    const float s00 =
+      glm::mix (this->sample (c.x, c.y, c.z), this->sample (c.x + 1, c.y, c.z), t.x);
+    const float s10 = glm::mix (this->sample (c.x, c.y + 1, c.z),
+                                this->sample (c.x + 1, c.y + 1, c.z), t.x);
+    const float s01 = glm::mix (this->sample (c.x, c.y, c.z + 1),
+                                this->sample (c.x + 1, c.y, c.z + 1), t.x);
+    const float s11 = glm::mix (this->sample (c.x, c.y + 1, c.z + 1),
+                                this->sample (c.x + 1, c.y + 1, c.z + 1), t.x);
+
+    return glm::mix (glm::mix (s00, s10, t.y), glm::mix (s01, s11, t.y), t.z);
+  }
+
+  static std::shared_ptr<const DynamicMeshDistanceField> get (
+    const DynamicMesh& mesh, float resolution,
+    const IsosurfaceExtraction::ProgressCallback& progress, const CancellationToken* token)
+  {
+    std::shared_ptr<const DynamicMeshDistanceField> field = mesh.distanceField ();
+
+    if (field && field->resolution () <= resolution + Util::epsilon ())
+    {
+      return field;
+    }
+
+    const IsosurfaceExtraction::DistanceCallback getDistance =
+      [&mesh](const glm::vec3& pos, float upperBound) {
+        return mesh.unsignedDistance (pos, upperBound);
+      };
+
+    // winding numbers classify samples independently of each other, even if the mesh has holes
+    const DynamicMeshWindingNumber             windingNumber (mesh);
+    const IsosurfaceExtraction::InsideCallback isInside =
+      [&windingNumber](const glm::vec3& pos) { return windingNumber.isInside (pos); };
+
+    IsosurfaceExtractionGrid grid (mesh.bounds (), resolution);
+
+    if (IsosurfaceExtraction::sample (getDistance, isInside, grid, progress, token))
+    {
+      field = std::make_shared<const DynamicMeshDistanceField> (grid);
+      mesh.distanceField (field);
+      return field;
+    }
+    else
+    {
+      return nullptr;
+    }
+  }
+};
+
+DELEGATE1_BIG2 (DynamicMeshDistanceField, IsosurfaceExtractionGrid&)
+DELEGATE_CONST (float, DynamicMeshDistanceField, resolution)
+DELEGATE1_CONST (float, DynamicMeshDistanceField, distance, const glm::vec3&)
+DELEGATE_CONST (PrimAABox, DynamicMeshDistanceField, bounds)
+DELEGATE4_STATIC (std::shared_ptr<const DynamicMeshDistanceField>, DynamicMeshDistanceField, get,
+                  const DynamicMesh&, float, const IsosurfaceExtraction::ProgressCallback&,
+                  const CancellationToken*)
+
+namespace
+{
+  // maximal number of cells of the index along each dimension
+  constexpr unsigned int maxNumCells = 16;
+
+  float boxDistance (const glm::vec3& min1, const glm::vec3& max1, const glm::vec3& min2,
+                     const glm::vec3& max2)
+  {
+    return glm::length (glm::max (glm::max (min1 - max2, min2 - max1), glm::vec3 (0.0f)));
+  }
+}
+
+struct DynamicMeshDistanceFields::Impl
+{
+  typedef std::shared_ptr<const DynamicMeshDistanceField> Field;
+
+  struct Cell
+  {
+    std::vector<unsigned int> fields;
+
+    // bound of the distances of the fields that do not intersect the cell
+    float bound;
+  };
+
+  const std::vector<Field> fields;
+  const Operation          operation;
+  std::vector<glm::vec3>   fieldMins;
+  std::vector<glm::vec3>   fieldMaxs;
+  glm::vec3                min;
+  glm::vec3                max;
+  glm::uvec3               numCells;
+  glm::vec3                cellSize;
+  std::vector<Cell>        cells;
+
+  Impl (const std::vector<Field>& f, Operation o)
+    : fields (f)
+    , operation (o)
+    , min (Util::maxFloat ())
+    , max (Util::minFloat ())
+  {
+    assert (this->fields.empty () == false);
+
+    for (const Field& field : this->fields)
+    {
+      const PrimAABox bounds = field->bounds ();
+
+      this->fieldMins.push_back (bounds.minimum ());
+      this->fieldMaxs.push_back (bounds.maximum ());
+      this->min = glm::min (this->min, bounds.minimum ());
+      this->max = glm::max (this->max, bounds.maximum ());
+    }
+
+    const unsigned int n = glm::clamp (
+      (unsigned int) (2.0f * std::cbrt (float(this->fields.size ()))), 1u, maxNumCells);
+
+    this->numCells = glm::uvec3 (n);
+    this->cellSize = (this->max - this->min) / glm::vec3 (this->numCells);
+    this->cells.resize (n * n * n);
+
+    for (unsigned int z = 0; z < n; z++)
+    {
+      for (unsigned int y = 0; y < n; y++)
+      {
+        for (unsigned int x = 0; x < n; x++)
+        {
+          const glm::vec3 cellMin = this->min + (glm::vec3 (x, y, z) * this->cellSize);
+          const glm::vec3 cellMax = cellMin + this->cellSize;
+          Cell&           cell = this->cells[this->cellIndex (glm::uvec3 (x, y, z))];
+
+          cell.bound =
+            this->operation == Operation::Union ? Util::maxFloat () : Util::minFloat ();
+
+          for (unsigned int i = 0; i < this->fields.size (); i++)
+          {
+            const float d = boxDistance (cellMin, cellMax, this->fieldMins[i], this->fieldMaxs[i]);
+
+            if (d > 0.0f)
+            {
+              cell.bound = this->operation == Operation::Union ? glm::min (cell.bound, d)
+                                                               : glm::max (cell.bound, d);
+            }
+            else
+            {
+              cell.fields.push_back (i);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  unsigned int cellIndex (const glm::uvec3& c) const
+  {
+    return (c.z * this->numCells.x * this->numCells.y) + (c.y * this->numCells.x) + c.x;
+  }
+
+  PrimAABox bounds () const { return PrimAABox (this->min, this->max); }
+
+  float combine (float d1, float d2) const
+  {
+    return this->operation == Operation::Union ? glm::min (d1, d2) : glm::max (d1, d2);
+  }
+
+  // fields that do not intersect a cell are farther away from its points than its bound
+  float distance (const glm::vec3& pos) const
+  {
+    if (glm::any (glm::lessThan (pos, this->min)) || glm::any (glm::greaterThan (pos, this->max)))
+    {
+      float d = this->fields[0]->distance (pos);
+
+      for (unsigned int i = 1; i < this->fields.size (); i++)
+      {
+        d = this->combine (d, this->fields[i]->distance (pos));
+      }
+      return d;
+    }
+
+    const glm::uvec3 c = glm::min (glm::uvec3 ((pos - this->min) / this->cellSize),
+                                   this->numCells - glm::uvec3 (1));
+    const Cell&      cell = this->cells[this->cellIndex (c)];
+    float            d = cell.bound;
+
+    for (unsigned int i : cell.fields)
+    {
+      d = this->combine (d, this->fields[i]->distance (pos));
+    }
+    return d;
+  }
+};
+
+DELEGATE2_BIG2 (DynamicMeshDistanceFields,
+                const std::vector<std::shared_ptr<const DynamicMeshDistanceField>>&, Operation)
+DELEGATE_CONST (PrimAABox, DynamicMeshDistanceFields, bounds)
+DELEGATE1_CONST (float, DynamicMeshDistanceFields, distance, const glm::vec3&)
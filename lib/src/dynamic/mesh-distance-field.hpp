@@ -0,0 +1,71 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_DYNAMIC_MESH_DISTANCE_FIELD
+#define DILAY_DYNAMIC_MESH_DISTANCE_FIELD
+
+#include <glm/fwd.hpp>
+#include <memory>
+#include <vector>
+#include "isosurface-extraction.hpp"
+#include "macro.hpp"
+
+class CancellationToken;
+class DynamicMesh;
+class IsosurfaceExtractionGrid;
+class PrimAABox;
+
+/* Signed distances of a mesh, which are sampled on a grid.  Distances in between samples are
+ * interpolated, such that a field can be resampled at any resolution that is not finer than its
+ * own without querying the mesh again.
+ */
+class DynamicMeshDistanceField
+{
+public:
+  // takes the samples of the grid
+  DECLARE_BIG2 (DynamicMeshDistanceField, IsosurfaceExtractionGrid&)
+
+  float resolution () const;
+  float distance (const glm::vec3&) const;
+
+  // bounds of the samples, outside of which distances are bounded by the distance to the bounds
+  PrimAABox bounds () const;
+
+  /* Returns the cached field of a mesh if its resolution is not coarser than the given one.
+   * Otherwise a new field is sampled and cached.  Returns `nullptr` if sampling has been
+   * cancelled.
+   */
+  static std::shared_ptr<const DynamicMeshDistanceField> get (
+    const DynamicMesh&, float, const IsosurfaceExtraction::ProgressCallback& = nullptr,
+    const CancellationToken* = nullptr);
+
+private:
+  IMPLEMENTATION
+};
+
+/* Union or intersection of several fields, which are indexed by a coarse grid over their bounds.
+ * Each cell of the index only evaluates the fields whose bounds intersect it, and bounds the
+ * distances of all other fields by the distances to their bounds.
+ */
+class DynamicMeshDistanceFields
+{
+public:
+  enum class Operation
+  {
+    Union,
+    Intersection
+  };
+
+  DECLARE_BIG2 (DynamicMeshDistanceFields,
+                const std::vector<std::shared_ptr<const DynamicMeshDistanceField>>&, Operation)
+
+  // bounds of all fields
+  PrimAABox bounds () const;
+  float     distance (const glm::vec3&) const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
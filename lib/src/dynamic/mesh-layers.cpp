@@ -0,0 +1,291 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+#include "dynamic/mesh-layers.hpp"
+#include "util.hpp"
+
+namespace
+{
+  constexpr unsigned int chunkSize = 64;
+
+  // displacements are stored per coordinate, such that they are scaled in vectorized loops
+  struct Chunk
+  {
+    std::uint64_t occupied;
+    float         x[chunkSize];
+    float         y[chunkSize];
+    float         z[chunkSize];
+
+    Chunk ()
+      : occupied (0)
+      , x ()
+      , y ()
+      , z ()
+    {
+    }
+
+    static std::uint64_t bit (unsigned int i) { return std::uint64_t (1) << (i % chunkSize); }
+
+    bool isOccupied (unsigned int i) const { return (this->occupied & bit (i)) != 0; }
+  };
+
+  struct Layer
+  {
+    float strength;
+    bool  isEnabled;
+
+    // maps each chunk of vertices to its slot in `chunks`
+    std::vector<unsigned int> directory;
+    std::vector<unsigned int> chunkIndices;
+    std::vector<Chunk>        chunks;
+
+    Layer ()
+      : strength (1.0f)
+      , isEnabled (true)
+    {
+    }
+
+    const Chunk* findChunk (unsigned int vertex) const
+    {
+      const unsigned int c = vertex / chunkSize;
+
+      if (c < this->directory.size () && this->directory[c] != Util::invalidIndex ())
+      {
+        return &this->chunks[this->directory[c]];
+      }
+      return nullptr;
+    }
+
+    Chunk* findChunk (unsigned int vertex)
+    {
+      return const_cast<Chunk*> (static_cast<const Layer&> (*this).findChunk (vertex));
+    }
+
+    Chunk& chunk (unsigned int vertex)
+    {
+      const unsigned int c = vertex / chunkSize;
+
+      if (c >= this->directory.size ())
+      {
+        this->directory.resize (c + 1, Util::invalidIndex ());
+      }
+      if (this->directory[c] == Util::invalidIndex ())
+      {
+        this->directory[c] = this->chunks.size ();
+        this->chunkIndices.push_back (c);
+        this->chunks.emplace_back ();
+      }
+      return this->chunks[this->directory[c]];
+    }
+
+    glm::vec3 displacement (unsigned int vertex) const
+    {
+      const Chunk* c = this->findChunk (vertex);
+
+      if (c && c->isOccupied (vertex))
+      {
+        const unsigned int j = vertex % chunkSize;
+        return glm::vec3 (c->x[j], c->y[j], c->z[j]);
+      }
+      return glm::vec3 (0.0f);
+    }
+
+    void displacement (unsigned int vertex, const glm::vec3& d)
+    {
+      if (d == glm::vec3 (0.0f))
+      {
+        this->resetVertex (vertex);
+      }
+      else
+      {
+        Chunk&             c = this->chunk (vertex);
+        const unsigned int j = vertex % chunkSize;
+
+        c.occupied |= Chunk::bit (vertex);
+        c.x[j] = d.x;
+        c.y[j] = d.y;
+        c.z[j] = d.z;
+      }
+    }
+
+    void resetVertex (unsigned int vertex)
+    {
+      Chunk* c = this->findChunk (vertex);
+
+      if (c && c->isOccupied (vertex))
+      {
+        const unsigned int j = vertex % chunkSize;
+
+        c->occupied &= ~Chunk::bit (vertex);
+        c->x[j] = c->y[j] = c->z[j] = 0.0f;
+      }
+    }
+
+    void resetDisplacements ()
+    {
+      this->directory.clear ();
+      this->chunkIndices.clear ();
+      this->chunks.clear ();
+    }
+
+    void blend (float factor, const DynamicMeshLayers::DisplacementCallback& f) const
+    {
+      float x[chunkSize];
+      float y[chunkSize];
+      float z[chunkSize];
+
+      for (unsigned int s = 0; s < this->chunks.size (); s++)
+      {
+        const Chunk& c = this->chunks[s];
+
+        if (c.occupied != 0)
+        {
+          // unoccupied displacements are zero, so whole chunks are scaled
+          for (unsigned int j = 0; j < chunkSize; j++)
+          {
+            x[j] = factor * c.x[j];
+            y[j] = factor * c.y[j];
+            z[j] = factor * c.z[j];
+          }
+
+          const unsigned int first = this->chunkIndices[s] * chunkSize;
+          for (unsigned int j = 0; j < chunkSize; j++)
+          {
+            if (c.occupied & (std::uint64_t (1) << j))
+            {
+              f (first + j, glm::vec3 (x[j], y[j], z[j]));
+            }
+          }
+        }
+      }
+    }
+
+    std::size_t numBytes () const
+    {
+      return (this->directory.capacity () * sizeof (unsigned int)) +
+             (this->chunkIndices.capacity () * sizeof (unsigned int)) +
+             (this->chunks.capacity () * sizeof (Chunk));
+    }
+  };
+}
+
+struct DynamicMeshLayers::Impl
+{
+  std::vector<Layer> layers;
+
+  unsigned int numLayers () const { return this->layers.size (); }
+
+  unsigned int addLayer ()
+  {
+    this->layers.emplace_back ();
+    return this->layers.size () - 1;
+  }
+
+  void deleteLayer (unsigned int l)
+  {
+    assert (l < this->numLayers ());
+    this->layers.erase (this->layers.begin () + l);
+  }
+
+  float strength (unsigned int l) const { return this->layers.at (l).strength; }
+
+  void strength (unsigned int l, float s) { this->layers.at (l).strength = s; }
+
+  bool isEnabled (unsigned int l) const { return this->layers.at (l).isEnabled; }
+
+  void enable (unsigned int l, bool e) { this->layers.at (l).isEnabled = e; }
+
+  float weight (unsigned int l) const
+  {
+    return this->isEnabled (l) ? this->strength (l) : 0.0f;
+  }
+
+  glm::vec3 displacement (unsigned int l, unsigned int vertex) const
+  {
+    return this->layers.at (l).displacement (vertex);
+  }
+
+  void displacement (unsigned int l, unsigned int vertex, const glm::vec3& d)
+  {
+    this->layers.at (l).displacement (vertex, d);
+  }
+
+  void resetVertex (unsigned int vertex)
+  {
+    for (Layer& layer : this->layers)
+    {
+      layer.resetVertex (vertex);
+    }
+  }
+
+  void moveVertex (unsigned int from, unsigned int to)
+  {
+    for (Layer& layer : this->layers)
+    {
+      const glm::vec3 d = layer.displacement (from);
+
+      layer.resetVertex (from);
+      layer.displacement (to, d);
+    }
+  }
+
+  void resetDisplacements ()
+  {
+    for (Layer& layer : this->layers)
+    {
+      layer.resetDisplacements ();
+    }
+  }
+
+  void forEachDisplacement (unsigned int vertex, const DisplacementCallback& f) const
+  {
+    for (unsigned int l = 0; l < this->layers.size (); l++)
+    {
+      const glm::vec3 d = this->layers[l].displacement (vertex);
+
+      if (d != glm::vec3 (0.0f))
+      {
+        f (l, d);
+      }
+    }
+  }
+
+  void blend (unsigned int l, float factor, const DisplacementCallback& f) const
+  {
+    this->layers.at (l).blend (factor, f);
+  }
+
+  std::size_t numBytes () const
+  {
+    std::size_t n = this->layers.capacity () * sizeof (Layer);
+
+    for (const Layer& layer : this->layers)
+    {
+      n += layer.numBytes ();
+    }
+    return n;
+  }
+};
+
+DELEGATE_BIG6 (DynamicMeshLayers)
+DELEGATE_CONST (unsigned int, DynamicMeshLayers, numLayers)
+DELEGATE (unsigned int, DynamicMeshLayers, addLayer)
+DELEGATE1 (void, DynamicMeshLayers, deleteLayer, unsigned int)
+DELEGATE1_CONST (float, DynamicMeshLayers, strength, unsigned int)
+DELEGATE2 (void, DynamicMeshLayers, strength, unsigned int, float)
+DELEGATE1_CONST (bool, DynamicMeshLayers, isEnabled, unsigned int)
+DELEGATE2 (void, DynamicMeshLayers, enable, unsigned int, bool)
+DELEGATE1_CONST (float, DynamicMeshLayers, weight, unsigned int)
+DELEGATE2_CONST (glm::vec3, DynamicMeshLayers, displacement, unsigned int, unsigned int)
+DELEGATE3 (void, DynamicMeshLayers, displacement, unsigned int, unsigned int, const glm::vec3&)
+DELEGATE1 (void, DynamicMeshLayers, resetVertex, unsigned int)
+DELEGATE2 (void, DynamicMeshLayers, moveVertex, unsigned int, unsigned int)
+DELEGATE (void, DynamicMeshLayers, resetDisplacements)
+DELEGATE2_CONST (void, DynamicMeshLayers, forEachDisplacement, unsigned int,
+                 const DisplacementCallback&)
+DELEGATE3_CONST (void, DynamicMeshLayers, blend, unsigned int, float, const DisplacementCallback&)
+DELEGATE_CONST (std::size_t, DynamicMeshLayers, numBytes)
@@ -0,0 +1,54 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_DYNAMIC_MESH_LAYERS
+#define DILAY_DYNAMIC_MESH_LAYERS
+
+#include <cstddef>
+#include <functional>
+#include <glm/fwd.hpp>
+#include "macro.hpp"
+
+/* Sculpt layers of a dynamic mesh.  Each layer stores displacements of the vertices that have been
+ * sculpted into it, which are weighted by the layer's strength if the layer is enabled.  Vertices
+ * are grouped into chunks of consecutive indices, and only chunks with at least one displaced
+ * vertex are stored.  The layers do not move any vertices themselves, cf. `DynamicMesh::layer*`.
+ */
+class DynamicMeshLayers
+{
+public:
+  DECLARE_BIG6 (DynamicMeshLayers)
+
+  typedef std::function<void(unsigned int, const glm::vec3&)> DisplacementCallback;
+
+  unsigned int numLayers () const;
+  unsigned int addLayer ();
+  void         deleteLayer (unsigned int);
+  float        strength (unsigned int) const;
+  void         strength (unsigned int, float);
+  bool         isEnabled (unsigned int) const;
+  void         enable (unsigned int, bool);
+  // the strength of an enabled layer and zero otherwise
+  float        weight (unsigned int) const;
+
+  // displacements of a vertex that is not displaced by a layer are zero
+  glm::vec3 displacement (unsigned int, unsigned int) const;
+  void      displacement (unsigned int, unsigned int, const glm::vec3&);
+  void      resetVertex (unsigned int);
+  void      moveVertex (unsigned int, unsigned int);
+  void      resetDisplacements ();
+
+  // calls `f` with each layer and displacement of a vertex
+  void forEachDisplacement (unsigned int, const DisplacementCallback&) const;
+
+  // calls `f` with each vertex of a layer and its displacement scaled by a factor
+  void blend (unsigned int, float, const DisplacementCallback&) const;
+
+  std::size_t numBytes () const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
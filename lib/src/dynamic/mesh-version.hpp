@@ -0,0 +1,24 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_DYNAMIC_MESH_VERSION
+#define DILAY_DYNAMIC_MESH_VERSION
+
+#include <vector>
+#include "mesh.hpp"
+
+/* Immutable geometry of a dynamic mesh at one revision, which background jobs read without locks
+ * while the mesh is modified.  Its buffers share their chunks with the mesh, which copies a chunk
+ * before it modifies it for as long as a version pins it (cf. `DynamicMesh::version`).  Free
+ * vertices and faces are included, such that readers skip them as if the version was pruned.
+ */
+struct DynamicMeshVersion
+{
+  const unsigned int              revision;
+  const Mesh                      mesh;
+  const std::vector<unsigned int> freeVertexIndices;
+  const std::vector<unsigned int> freeFaceIndices;
+};
+
+#endif
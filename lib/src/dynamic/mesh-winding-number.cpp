@@ -0,0 +1,166 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <vector>
+#include "dynamic/mesh-winding-number.hpp"
+#include "dynamic/mesh.hpp"
+#include "primitive/triangle.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // nodes that are farther away than this multiple of their radius are approximated
+  constexpr float approximationDistance = 2.0f;
+
+  /* Nodes are stored in depth-first order, such that the subtree of a node is the range
+   * `[index, end)` of nodes.
+   */
+  struct Node
+  {
+    glm::vec3    center;
+    glm::vec3    dipole;
+    float        radius;
+    unsigned int end;
+    unsigned int facesBegin;
+    unsigned int facesEnd;
+  };
+
+  // solid angle of a triangle as seen from the origin, cf. Van Oosterom and Strackee
+  float solidAngle (const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+  {
+    const float la = glm::length (a);
+    const float lb = glm::length (b);
+    const float lc = glm::length (c);
+    const float numerator = glm::dot (a, glm::cross (b, c));
+    const float denominator =
+      (la * lb * lc) + (glm::dot (a, b) * lc) + (glm::dot (b, c) * la) + (glm::dot (c, a) * lb);
+
+    return 2.0f * glm::atan (numerator, denominator);
+  }
+}
+
+struct DynamicMeshWindingNumber::Impl
+{
+  std::vector<Node>      nodes;
+  std::vector<glm::vec3> corners;
+
+  /* The dipole of a node is the sum of the area-weighted normals of its subtree's faces, which is
+   * located at their area-weighted center.  Its radius bounds the distance between the center and
+   * the faces.
+   */
+  Impl (const DynamicMesh& mesh)
+  {
+    std::vector<unsigned int> parents;
+
+    mesh.forEachOctreeNode (
+      [this, &mesh, &parents](unsigned int parent, const std::vector<unsigned int>& faces) {
+        Node node;
+        node.center = glm::vec3 (0.0f);
+        node.dipole = glm::vec3 (0.0f);
+        node.radius = 0.0f;
+        node.end = this->nodes.size () + 1;
+        node.facesBegin = this->corners.size () / 3;
+
+        for (unsigned int f : faces)
+        {
+          const PrimTriangle triangle = mesh.face (f);
+
+          this->corners.push_back (triangle.vertex1 ());
+          this->corners.push_back (triangle.vertex2 ());
+          this->corners.push_back (triangle.vertex3 ());
+        }
+        node.facesEnd = this->corners.size () / 3;
+
+        this->nodes.push_back (node);
+        parents.push_back (parent);
+      });
+
+    std::vector<float>     areas (this->nodes.size (), 0.0f);
+    std::vector<glm::vec3> minima (this->nodes.size (), glm::vec3 (Util::maxFloat ()));
+    std::vector<glm::vec3> maxima (this->nodes.size (), glm::vec3 (-Util::maxFloat ()));
+
+    for (unsigned int i = 0; i < this->nodes.size (); i++)
+    {
+      Node& node = this->nodes[i];
+
+      for (unsigned int f = node.facesBegin; f < node.facesEnd; f++)
+      {
+        const glm::vec3& v1 = this->corners[(3 * f) + 0];
+        const glm::vec3& v2 = this->corners[(3 * f) + 1];
+        const glm::vec3& v3 = this->corners[(3 * f) + 2];
+        const glm::vec3  cross = glm::cross (v2 - v1, v3 - v1);
+        const float      area = 0.5f * glm::length (cross);
+
+        node.dipole += 0.5f * cross;
+        node.center += area * (v1 + v2 + v3) / 3.0f;
+        areas[i] += area;
+        minima[i] = glm::min (minima[i], glm::min (v1, glm::min (v2, v3)));
+        maxima[i] = glm::max (maxima[i], glm::max (v1, glm::max (v2, v3)));
+      }
+    }
+
+    // children follow their parents in depth-first order
+    for (unsigned int i = this->nodes.size (); i-- > 1;)
+    {
+      const Node&        node = this->nodes[i];
+      const unsigned int p = parents[i];
+
+      this->nodes[p].dipole += node.dipole;
+      this->nodes[p].center += node.center;
+      this->nodes[p].end = glm::max (this->nodes[p].end, node.end);
+      areas[p] += areas[i];
+      minima[p] = glm::min (minima[p], minima[i]);
+      maxima[p] = glm::max (maxima[p], maxima[i]);
+    }
+
+    for (unsigned int i = 0; i < this->nodes.size (); i++)
+    {
+      Node& node = this->nodes[i];
+
+      if (areas[i] > 0.0f)
+      {
+        node.center /= areas[i];
+        node.radius = glm::length (glm::max (node.center - minima[i], maxima[i] - node.center));
+      }
+    }
+  }
+
+  float windingNumber (const glm::vec3& pos) const
+  {
+    float solidAngles = 0.0f;
+
+    for (unsigned int i = 0; i < this->nodes.size ();)
+    {
+      const Node&     node = this->nodes[i];
+      const glm::vec3 d = node.center - pos;
+      const float     distance2 = glm::dot (d, d);
+      const float     maxRadius = approximationDistance * node.radius;
+
+      if (distance2 > maxRadius * maxRadius)
+      {
+        solidAngles += glm::dot (d, node.dipole) / (distance2 * glm::sqrt (distance2));
+        i = node.end;
+      }
+      else
+      {
+        for (unsigned int f = node.facesBegin; f < node.facesEnd; f++)
+        {
+          solidAngles += solidAngle (this->corners[(3 * f) + 0] - pos,
+                                     this->corners[(3 * f) + 1] - pos,
+                                     this->corners[(3 * f) + 2] - pos);
+        }
+        i++;
+      }
+    }
+    return solidAngles / (4.0f * glm::pi<float> ());
+  }
+
+  bool isInside (const glm::vec3& pos) const { return this->windingNumber (pos) > 0.5f; }
+};
+
+DELEGATE1_BIG2 (DynamicMeshWindingNumber, const DynamicMesh&)
+DELEGATE1_CONST (float, DynamicMeshWindingNumber, windingNumber, const glm::vec3&)
+DELEGATE1_CONST (bool, DynamicMeshWindingNumber, isInside, const glm::vec3&)
@@ -0,0 +1,31 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_DYNAMIC_MESH_WINDING_NUMBER
+#define DILAY_DYNAMIC_MESH_WINDING_NUMBER
+
+#include <glm/fwd.hpp>
+#include "macro.hpp"
+
+class DynamicMesh;
+
+/* Generalized winding numbers of a mesh, which classify positions as inside or outside even if the
+ * mesh has holes or self-intersections.  Faces of far away nodes of the mesh's octree are
+ * approximated by their dipoles (cf. Barill et al., "Fast Winding Numbers for Soups and Clouds").
+ * The faces are copied, such that the mesh may be modified afterwards, and queries may be run
+ * concurrently.
+ */
+class DynamicMeshWindingNumber
+{
+public:
+  DECLARE_BIG2 (DynamicMeshWindingNumber, const DynamicMesh&)
+
+  float windingNumber (const glm::vec3&) const;
+  bool  isInside (const glm::vec3&) const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
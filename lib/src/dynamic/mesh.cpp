@@ -2,53 +2,74 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
+#include <memory>
+#include <mutex>
+#include <utility>
 #include <vector>
 #include "../mesh.hpp"
+#include "camera.hpp"
+#include "color.hpp"
 #include "config.hpp"
 #include "distance.hpp"
 #include "dynamic/faces.hpp"
+#include "dynamic/mesh-cache.hpp"
+#include "dynamic/mesh-layers.hpp"
 #include "dynamic/mesh-intersection.hpp"
+#include "dynamic/mesh-version.hpp"
 #include "dynamic/mesh.hpp"
 #include "dynamic/octree.hpp"
 #include "intersection.hpp"
+#include "latency-profiler.hpp"
+#include "memory-report.hpp"
 #include "mesh-util.hpp"
+#include "parallel.hpp"
 #include "primitive/aabox.hpp"
 #include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
 #include "primitive/triangle.hpp"
+#include "profiler.hpp"
 #include "tool/sculpt/util/action.hpp"
+#include "triangle-batch.hpp"
 #include "util.hpp"
 
 namespace
 {
+  // keys of the values that are read for each mesh whenever the configuration changes
+  const Config::Key<Color> normalColorKey ("editor/mesh/color/normal");
+  const Config::Key<Color> wireframeColorKey ("editor/mesh/color/wireframe");
+  const Config::Key<int>   octreeMaxDepthIncreaseKey ("editor/mesh/octree/max-depth-increase");
+  const Config::Key<float> octreeMinOccupancyRatioKey ("editor/mesh/octree/min-occupancy-ratio");
+  const Config::Key<int>   minCulledFacesKey ("editor/mesh/culling/min-faces");
+  const Config::Key<int>   minFaceRecordFacesKey ("editor/mesh/face-records/min-faces");
+  const Config::Key<int>   maxFaceRecordMegabytesKey ("editor/mesh/face-records/max-megabytes");
+
+  /* The faces adjacent to a vertex are stored in the range `[offset, offset + valence)` of a
+   * pool that is shared by all vertices (cf. `DynamicMesh::Impl::adjacency`).  The range may
+   * grow up to `capacity` in place.  A reset vertex keeps its range for later reuse.
+   */
   struct VertexData
   {
-    bool                      isFree;
-    std::vector<unsigned int> adjacentFaces;
-
-    VertexData () { this->reset (); }
-    void reset ()
+    bool         isFree;
+    unsigned int offset;
+    unsigned int valence;
+    unsigned int capacity;
+
+    VertexData ()
+      : offset (0)
+      , capacity (0)
     {
-      this->isFree = true;
-      this->adjacentFaces.clear ();
+      this->reset ();
     }
 
-    void addAdjacentFace (unsigned int face) { this->adjacentFaces.push_back (face); }
-
-    void deleteAdjacentFace (unsigned int face)
+    void reset ()
     {
-      for (auto it = this->adjacentFaces.begin (); it != this->adjacentFaces.end (); ++it)
-      {
-        if (*it == face)
-        {
-          this->adjacentFaces.erase (it);
-          return;
-        }
-      }
-      DILAY_IMPOSSIBLE
+      this->isFree = true;
+      this->valence = 0;
     }
   };
 
@@ -59,730 +80,3151 @@ namespace
     FaceData () { this->reset (); }
     void reset () { this->isFree = true; }
   };
-}
 
-struct DynamicMesh::Impl
-{
-  DynamicMesh*               self;
-  Mesh                       mesh;
-  std::vector<VertexData>    vertexData;
-  std::vector<unsigned char> vertexVisited;
-  std::vector<unsigned int>  freeVertexIndices;
-  std::vector<FaceData>      faceData;
-  std::vector<unsigned char> faceVisited;
-  std::vector<unsigned int>  freeFaceIndices;
-  DynamicOctree              octree;
+  // moves a used slot (`first`) into a free slot (`second`)
+  typedef std::pair<unsigned int, unsigned int> PruneMove;
 
-  Impl (DynamicMesh* s)
-    : self (s)
+  /* Pairs the free slots below the pruned number of slots with the used slots above it, so that
+   * the latter can be moved into the former.  Only the free slots and the slots above the pruned
+   * number of slots are visited.
+   */
+  template <typename T>
+  std::vector<PruneMove> pruneMoves (const std::vector<T>& data,
+                                     const std::vector<unsigned int>& freeIndices)
   {
-  }
+    const unsigned int newSize = data.size () - freeIndices.size ();
 
-  Impl (DynamicMesh* s, const Mesh& m)
-    : self (s)
-  {
-    this->fromMesh (m);
-  }
+    std::vector<PruneMove> moves;
+    unsigned int           from = data.size ();
 
-  unsigned int numVertices () const
-  {
-    assert (this->mesh.numVertices () >= this->freeVertexIndices.size ());
-    assert (this->mesh.numVertices () == this->vertexData.size ());
-    return this->mesh.numVertices () - this->freeVertexIndices.size ();
+    for (unsigned int to : freeIndices)
+    {
+      if (to < newSize)
+      {
+        do
+        {
+          assert (from > newSize);
+          from--;
+        } while (data[from].isFree);
+
+        moves.emplace_back (from, to);
+      }
+    }
+    return moves;
   }
 
-  unsigned int numFaces () const
+  // maps used slots to their slots after pruning, and free slots to `Util::invalidIndex`
+  void pruneIndexMap (unsigned int size, const std::vector<unsigned int>& freeIndices,
+                      const std::vector<PruneMove>& moves, std::vector<unsigned int>& indexMap)
   {
-    assert (this->faceData.size () >= this->freeFaceIndices.size ());
-    return this->faceData.size () - this->freeFaceIndices.size ();
+    indexMap.resize (size);
+    for (unsigned int i = 0; i < size; i++)
+    {
+      indexMap[i] = i;
+    }
+    for (unsigned int i : freeIndices)
+    {
+      indexMap[i] = Util::invalidIndex ();
+    }
+    for (const PruneMove& m : moves)
+    {
+      indexMap[m.first] = m.second;
+    }
   }
 
-  bool isEmpty () const { return this->numFaces () == 0; }
+  // source of revisions, such that meshes with different geometries never share a revision
+  std::atomic<unsigned int> nextRevision (1);
 
-  bool isFreeVertex (unsigned int i) const
+  // distance field of a revision, which is shared by all copies of a mesh
+  struct DistanceFieldCache
   {
-    assert (i < this->vertexData.size ());
-    return this->vertexData[i].isFree;
-  }
+    std::mutex                                      mutex;
+    unsigned int                                    revision;
+    std::shared_ptr<const DynamicMeshDistanceField> field;
 
-  bool isFreeFace (unsigned int i) const
+    DistanceFieldCache ()
+      : revision (0)
+    {
+    }
+  };
+
+  void packUnsigned (std::vector<char>& buffer, unsigned int value)
   {
-    assert (i < this->faceData.size ());
-    return this->faceData[i].isFree;
+    while (value >= 0x80)
+    {
+      buffer.push_back (char((value & 0x7f) | 0x80));
+      value >>= 7;
+    }
+    buffer.push_back (char(value));
   }
 
-  bool isPruned () const
+  unsigned int unpackUnsigned (const char*& data)
   {
-    return this->freeFaceIndices.empty () && this->freeVertexIndices.empty ();
+    unsigned int value = 0;
+    unsigned int shift = 0;
+    unsigned char byte;
+    do
+    {
+      byte = static_cast<unsigned char> (*data++);
+      value |= (byte & 0x7fu) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+    return value;
   }
 
-  unsigned int valence (unsigned int i) const
+  // packs the difference of `value` to `previous` and updates `previous`
+  void packSigned (std::vector<char>& buffer, unsigned int& previous, unsigned int value)
   {
-    assert (this->isFreeVertex (i) == false);
-    return this->vertexData[i].adjacentFaces.size ();
+    const int difference = int(value - previous);
+
+    packUnsigned (buffer, (static_cast<unsigned int> (difference) << 1) ^
+                            static_cast<unsigned int> (difference >> 31));
+    previous = value;
   }
 
-  void vertexIndices (unsigned int i, unsigned int& i1, unsigned int& i2, unsigned int& i3) const
+  unsigned int unpackSigned (const char*& data, unsigned int& previous)
   {
-    assert (this->isFreeFace (i) == false);
+    const unsigned int zigzag = unpackUnsigned (data);
 
-    i1 = this->mesh.index ((3 * i) + 0);
-    i2 = this->mesh.index ((3 * i) + 1);
-    i3 = this->mesh.index ((3 * i) + 2);
+    previous += (zigzag >> 1) ^ (0u - (zigzag & 1u));
+    return previous;
   }
 
-  PrimTriangle face (unsigned int i) const
+  template <typename T> void packRaw (std::vector<char>& buffer, const T& v)
   {
-    assert (this->isFreeFace (i) == false);
-
-    return PrimTriangle (this->mesh.vertex (this->mesh.index ((3 * i) + 0)),
-                         this->mesh.vertex (this->mesh.index ((3 * i) + 1)),
-                         this->mesh.vertex (this->mesh.index ((3 * i) + 2)));
+    const char* data = reinterpret_cast<const char*> (&v);
+    buffer.insert (buffer.end (), data, data + sizeof (T));
   }
 
-  const glm::vec3& vertexNormal (unsigned int i) const { return this->mesh.normal (i); }
+  template <typename T> void unpackRaw (const char*& data, T& v)
+  {
+    std::memcpy (&v, data, sizeof (T));
+    data += sizeof (T);
+  }
 
-  glm::vec3 faceNormal (unsigned int i) const
+  // delta that is recorded into, which is not passed on to copies of a mesh
+  struct DeltaRecorder
   {
-    assert (this->isFreeFace (i) == false);
+    DynamicMeshDelta* delta;
 
-    unsigned int i1, i2, i3;
-    this->vertexIndices (i, i1, i2, i3);
+    DeltaRecorder ()
+      : delta (nullptr)
+    {
+    }
 
-    return glm::normalize (glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
-                                       this->mesh.vertex (i3) - this->mesh.vertex (i1)));
-  }
+    DeltaRecorder (const DeltaRecorder&)
+      : delta (nullptr)
+    {
+    }
 
-  void findAdjacent (unsigned int e1, unsigned int e2, unsigned int& leftFace,
-                     unsigned int& leftVertex, unsigned int& rightFace,
-                     unsigned int& rightVertex) const
+    DeltaRecorder& operator= (const DeltaRecorder&)
+    {
+      this->delta = nullptr;
+      return *this;
+    }
+  };
+
+  /* Vertices that have been modified while a layer is recorded, with their positions before their
+   * first modification.  Vertices are new if their slot was free or has been freed since.  Copies
+   * of a mesh do not record.
+   */
+  struct LayerRecorder
   {
-    assert (this->isFreeVertex (e1) == false);
-    assert (this->isFreeVertex (e2) == false);
+    unsigned int               layer;
+    std::vector<unsigned int>  vertices;
+    std::vector<glm::vec3>     positions;
+    std::vector<unsigned char> isNew;
+    std::vector<unsigned int>  entries;
+
+    LayerRecorder ()
+      : layer (Util::invalidIndex ())
+    {
+    }
 
-    leftFace = Util::invalidIndex ();
-    leftVertex = Util::invalidIndex ();
-    rightFace = Util::invalidIndex ();
-    rightVertex = Util::invalidIndex ();
+    LayerRecorder (const LayerRecorder&)
+      : LayerRecorder ()
+    {
+    }
 
-    for (unsigned int a : this->vertexData[e1].adjacentFaces)
+    LayerRecorder (LayerRecorder&&) = default;
+
+    LayerRecorder& operator= (const LayerRecorder&)
     {
-      unsigned int i1, i2, i3;
-      this->vertexIndices (a, i1, i2, i3);
+      *this = LayerRecorder ();
+      return *this;
+    }
 
-      if (e1 == i1 && e2 == i2)
-      {
-        leftFace = a;
-        leftVertex = i3;
-      }
-      else if (e1 == i2 && e2 == i1)
-      {
-        rightFace = a;
-        rightVertex = i3;
-      }
-      else if (e1 == i2 && e2 == i3)
-      {
-        leftFace = a;
-        leftVertex = i1;
-      }
-      else if (e1 == i3 && e2 == i2)
-      {
-        rightFace = a;
-        rightVertex = i1;
-      }
-      else if (e1 == i3 && e2 == i1)
-      {
-        leftFace = a;
-        leftVertex = i2;
-      }
-      else if (e1 == i1 && e2 == i3)
-      {
-        rightFace = a;
-        rightVertex = i2;
-      }
+    LayerRecorder& operator= (LayerRecorder&&) = default;
+
+    bool isRecording () const { return this->layer != Util::invalidIndex (); }
+
+    void reset (unsigned int l)
+    {
+      this->layer = l;
+      this->vertices.clear ();
+      this->positions.clear ();
+      this->isNew.clear ();
+      this->entries.clear ();
     }
-    assert (leftFace != Util::invalidIndex ());
-    assert (leftVertex != Util::invalidIndex ());
-    assert (rightFace != Util::invalidIndex ());
-    assert (rightVertex != Util::invalidIndex ());
-  }
+  };
 
-  const std::vector<unsigned int>& adjacentFaces (unsigned int i) const
+  /* Marks of visited elements, which are stamped with the current generation.  All marks are
+   * cleared at once by starting a new generation, so that a traversal costs as much as the number
+   * of elements it visits.  Stamps are only reset when the generation wraps around.
+   */
+  class VisitedMarks
   {
-    assert (this->isFreeVertex (i) == false);
-    return this->vertexData[i].adjacentFaces;
-  }
+  public:
+    VisitedMarks ()
+      : generation (1)
+    {
+    }
 
-  void forEachVertex (const std::function<void(unsigned int)>& f)
-  {
-    for (unsigned int i = 0; i < this->vertexData.size (); i++)
+    bool         isVisited (unsigned int i) const { return this->stamps[i] == this->generation; }
+    void         visit (unsigned int i) { this->stamps[i] = this->generation; }
+    void         unvisit (unsigned int i) { this->stamps[i] = 0; }
+    void         add () { this->stamps.push_back (0); }
+    void         resize (unsigned int n) { this->stamps.resize (n, 0); }
+    void         clear () { this->stamps.clear (); }
+    unsigned int size () const { return this->stamps.size (); }
+    std::size_t  capacity () const { return this->stamps.capacity (); }
+
+    const unsigned int& operator[] (unsigned int i) const { return this->stamps[i]; }
+
+    void copy (unsigned int from, unsigned int to) { this->stamps[to] = this->stamps[from]; }
+
+    void unvisitAll ()
     {
-      if (this->isFreeVertex (i) == false)
+      this->generation++;
+      if (this->generation == 0)
       {
-        f (i);
+        std::fill (this->stamps.begin (), this->stamps.end (), 0);
+        this->generation = 1;
       }
     }
-  }
 
-  void visitVertices (unsigned int i, const std::function<void(unsigned int)>& f)
+  private:
+    std::vector<unsigned int> stamps;
+    unsigned int              generation;
+  };
+
+  /* Indices of modified vertices and faces, which subscribers consume with their own cursors.
+   * Nothing is logged without subscribers, and entries are dropped once all subscribers have
+   * consumed them.  Subscribers must process the whole mesh instead if they lag behind by more
+   * than `maxEntries` entries, or if all vertices and faces have been modified or renumbered at
+   * once.  Copies have no subscribers.
+   */
+  struct ChangeJournal
   {
-    assert (this->isFreeFace (i) == false);
+    struct Cursor
+    {
+      bool        isSubscribed;
+      bool        isEverything;
+      std::size_t vertex;
+      std::size_t face;
+    };
 
-    unsigned int i1, i2, i3;
-    this->vertexIndices (i, i1, i2, i3);
+    static constexpr std::size_t maxEntries = 1 << 22;
+
+    std::vector<unsigned int> vertices;
+    std::vector<unsigned int> faces;
+    std::size_t               firstVertex;
+    std::size_t               firstFace;
+    std::vector<Cursor>       cursors;
+    unsigned int              numSubscribers;
 
-    if (this->vertexVisited[i1] == 0)
+    ChangeJournal ()
+      : firstVertex (0)
+      , firstFace (0)
+      , numSubscribers (0)
     {
-      this->vertexVisited[i1] = 1;
-      f (i1);
     }
-    if (this->vertexVisited[i2] == 0)
+
+    ChangeJournal (const ChangeJournal&)
+      : ChangeJournal ()
     {
-      this->vertexVisited[i2] = 1;
-      f (i2);
     }
-    if (this->vertexVisited[i3] == 0)
+
+    ChangeJournal (ChangeJournal&&) = default;
+
+    ChangeJournal& operator= (const ChangeJournal&)
     {
-      this->vertexVisited[i3] = 1;
-      f (i3);
+      *this = ChangeJournal ();
+      return *this;
     }
-    this->faceVisited[i] = 1;
-  }
-
-  void unvisitVertices ()
-  {
-    std::memset (this->vertexVisited.data (), 0, this->vertexVisited.size ());
-  }
 
-  void unvisitFaces () { std::memset (this->faceVisited.data (), 0, this->faceVisited.size ()); }
+    ChangeJournal& operator= (ChangeJournal&&) = default;
 
-  void forEachVertex (const DynamicFaces& faces, const std::function<void(unsigned int)>& f)
-  {
-    this->unvisitVertices ();
+    std::size_t endVertex () const { return this->firstVertex + this->vertices.size (); }
+    std::size_t endFace () const { return this->firstFace + this->faces.size (); }
 
-    for (unsigned int i : faces)
+    unsigned int subscribe ()
     {
-      this->visitVertices (i, f);
+      unsigned int id = 0;
+      while (id < this->cursors.size () && this->cursors[id].isSubscribed)
+      {
+        id++;
+      }
+      if (id == this->cursors.size ())
+      {
+        this->cursors.emplace_back ();
+      }
+      this->cursors[id] = Cursor{true, false, this->endVertex (), this->endFace ()};
+      this->numSubscribers++;
+      return id;
     }
-  }
-
-  void forEachVertexExt (const DynamicFaces& faces, const std::function<void(unsigned int)>& f)
-  {
-    this->unvisitVertices ();
-    this->unvisitFaces ();
 
-    for (unsigned int i : faces)
+    void unsubscribe (unsigned int id)
     {
-      this->visitVertices (i, [this, &f](unsigned int j) {
-        f (j);
+      assert (id < this->cursors.size () && this->cursors[id].isSubscribed);
 
-        for (unsigned int a : this->vertexData[j].adjacentFaces)
+      this->cursors[id].isSubscribed = false;
+      this->numSubscribers--;
+      this->dropConsumed ();
+    }
+
+    void logVertex (unsigned int i)
+    {
+      if (this->numSubscribers > 0)
+      {
+        this->vertices.push_back (i);
+        if (this->vertices.size () > maxEntries)
         {
-          if (this->faceVisited[a] == 0)
-          {
-            this->visitVertices (a, f);
-          }
+          this->logEverything ();
         }
-      });
+      }
     }
-  }
 
-  void forEachVertexAdjacentToVertex (unsigned int                             i,
-                                      const std::function<void(unsigned int)>& f) const
-  {
-    assert (this->isFreeVertex (i) == false);
+    void logFace (unsigned int i)
+    {
+      if (this->numSubscribers > 0)
+      {
+        this->faces.push_back (i);
+        if (this->faces.size () > maxEntries)
+        {
+          this->logEverything ();
+        }
+      }
+    }
 
-    for (unsigned int a : this->vertexData[i].adjacentFaces)
+    void logEverything ()
     {
-      unsigned int a1, a2, a3;
-      this->vertexIndices (a, a1, a2, a3);
+      this->firstVertex = this->endVertex ();
+      this->firstFace = this->endFace ();
+      this->vertices.clear ();
+      this->faces.clear ();
 
-      if (i == a1)
+      for (Cursor& c : this->cursors)
       {
-        f (a2);
+        c.isEverything = c.isSubscribed;
+        c.vertex = this->firstVertex;
+        c.face = this->firstFace;
       }
-      else if (i == a2)
+    }
+
+    bool consume (unsigned int id, std::vector<unsigned int>& vertices,
+                  std::vector<unsigned int>& faces)
+    {
+      assert (id < this->cursors.size () && this->cursors[id].isSubscribed);
+
+      Cursor&    c = this->cursors[id];
+      const bool isEverything = c.isEverything;
+
+      const auto collect = [](const std::vector<unsigned int>& log, std::size_t first,
+                              std::size_t cursor, std::vector<unsigned int>& indices) {
+        indices.assign (log.begin () + std::ptrdiff_t (cursor - first), log.end ());
+        std::sort (indices.begin (), indices.end ());
+        indices.erase (std::unique (indices.begin (), indices.end ()), indices.end ());
+      };
+
+      if (isEverything)
       {
-        f (a3);
+        vertices.clear ();
+        faces.clear ();
       }
-      else if (i == a3)
+      else
       {
-        f (a1);
+        collect (this->vertices, this->firstVertex, c.vertex, vertices);
+        collect (this->faces, this->firstFace, c.face, faces);
       }
-      else
+      c.isEverything = false;
+      c.vertex = this->endVertex ();
+      c.face = this->endFace ();
+      this->dropConsumed ();
+      return isEverything == false;
+    }
+
+    void dropConsumed ()
+    {
+      std::size_t vertex = this->endVertex ();
+      std::size_t face = this->endFace ();
+
+      for (const Cursor& c : this->cursors)
       {
-        DILAY_IMPOSSIBLE
+        if (c.isSubscribed)
+        {
+          vertex = std::min (vertex, c.vertex);
+          face = std::min (face, c.face);
+        }
       }
+      this->vertices.erase (this->vertices.begin (),
+                            this->vertices.begin () + std::ptrdiff_t (vertex - this->firstVertex));
+      this->faces.erase (this->faces.begin (),
+                         this->faces.begin () + std::ptrdiff_t (face - this->firstFace));
+      this->firstVertex = vertex;
+      this->firstFace = face;
     }
-  }
+  };
 
-  void forEachVertexAdjacentToFace (unsigned int                             i,
-                                    const std::function<void(unsigned int)>& f) const
+  /* Whether the octree of a mesh still has to be built.  The first query that needs the octree
+   * builds it, which may happen concurrently on several threads.  Copies do not share the mutex.
+   */
+  struct PendingOctree
   {
-    assert (this->isFreeFace (i) == false);
+    std::atomic<bool> isPending;
+    std::mutex        mutex;
 
-    unsigned int i1, i2, i3;
-    this->vertexIndices (i, i1, i2, i3);
+    PendingOctree ()
+      : isPending (false)
+    {
+    }
 
-    f (i1);
-    f (i2);
-    f (i3);
-  }
+    PendingOctree (const PendingOctree& other)
+      : isPending (other.isPending.load ())
+    {
+    }
 
-  void forEachFace (const std::function<void(unsigned int)>& f)
-  {
-    for (unsigned int i = 0; i < this->faceData.size (); i++)
+    PendingOctree& operator= (const PendingOctree& other)
     {
-      if (this->isFreeFace (i) == false)
-      {
-        f (i);
-      }
+      this->isPending = other.isPending.load ();
+      return *this;
     }
-  }
+  };
 
-  void forEachFaceExt (const DynamicFaces& faces, const std::function<void(unsigned int)>& f)
+  // shape of a freshly built octree, which later octree statistics are compared against
+  struct OctreeShape
   {
-    this->unvisitVertices ();
-    this->unvisitFaces ();
+    bool  isValid;
+    int   depthRange;
+    float occupancy;
+
+    OctreeShape ()
+      : isValid (false)
+      , depthRange (0)
+      , occupancy (0.0f)
+    {
+    }
 
-    for (unsigned int i : faces)
+    OctreeShape (const DynamicOctreeStatistics& stats)
+      : isValid (stats.numNodes > 0)
+      , depthRange (stats.maxDepth - stats.minDepth)
+      , occupancy (this->isValid ? float(stats.numElements) / float(stats.numNodes) : 0.0f)
     {
-      if (this->faceVisited[i] == 0)
-      {
-        f (i);
-        this->faceVisited[i] = 1;
-      }
-      this->visitVertices (i, [this, &f](unsigned int j) {
-        for (unsigned int a : this->vertexData[j].adjacentFaces)
-        {
-          if (this->faceVisited[a] == 0)
-          {
-            f (a);
-            this->faceVisited[a] = 1;
-          }
-        }
-      });
     }
+  };
+
+  // the distance of an intersection that has been found before bounds the search for nearer ones
+  float upperBound (const Intersection& intersection)
+  {
+    return intersection.isIntersection () ? intersection.distance () : Util::maxFloat ();
   }
 
-  void average (const DynamicFaces& faces, glm::vec3& position, glm::vec3& normal) const
+  // queries may run concurrently and are issued for each sample of a grid, so batches are reused
+  TriangleBatch& scratchBatch ()
   {
-    assert (faces.numElements () > 0);
+    static thread_local TriangleBatch instance;
+    return instance;
+  }
+}
 
-    position = glm::vec3 (0.0f);
-    normal = glm::vec3 (0.0f);
-
-    for (unsigned int f : faces)
-    {
-      unsigned int i1, i2, i3;
-      this->vertexIndices (f, i1, i2, i3);
+struct DynamicMeshDelta::Impl
+{
+  struct Vertex
+  {
+    unsigned int index;
+    bool         isFree;
+    glm::vec3    position;
+    glm::vec3    normal;
+    float        mask;
+  };
 
-      position += this->mesh.vertex (i1);
-      position += this->mesh.vertex (i2);
-      position += this->mesh.vertex (i3);
-      normal += glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
-                            this->mesh.vertex (i3) - this->mesh.vertex (i1));
-    }
-    position /= float(faces.numElements () * 3);
-    normal = glm::normalize (normal);
-  }
+  struct Face
+  {
+    unsigned int index;
+    bool         isFree;
+    unsigned int i1, i2, i3;
+  };
 
-  glm::vec3 averagePosition (const DynamicFaces& faces) const
+  // displacement of a recorded vertex in one of the mesh's layers
+  struct LayerDisplacement
   {
-    assert (faces.numElements () > 0);
+    unsigned int vertex;
+    unsigned int layer;
+    glm::vec3    displacement;
+  };
 
-    glm::vec3 position = glm::vec3 (0.0f);
+  std::vector<Vertex>            vertices;
+  std::vector<Face>              faces;
+  std::vector<LayerDisplacement> layerDisplacements;
+  std::vector<unsigned char>     isRecordedVertex;
+  std::vector<unsigned char>     isRecordedFace;
 
-    for (unsigned int f : faces)
-    {
-      this->forEachVertexAdjacentToFace (
-        f, [this, &position](unsigned int v) { position += this->mesh.vertex (v); });
-    }
-    return position / float(faces.numElements () * 3);
-  }
+  // strengths of all layers before any of them has been changed
+  bool                       hasLayerStates;
+  std::vector<float>         layerStrengths;
+  std::vector<unsigned char> isLayerEnabled;
 
-  glm::vec3 averagePosition (unsigned int i) const
+  Impl ()
+    : hasLayerStates (false)
   {
-    assert (this->isFreeVertex (i) == false);
-    assert (this->vertexData[i].adjacentFaces.size () > 0);
+  }
 
-    glm::vec3 position = glm::vec3 (0.0f);
+  bool isEmpty () const
+  {
+    return this->vertices.empty () && this->faces.empty () && this->hasLayerStates == false;
+  }
 
-    this->forEachVertexAdjacentToVertex (
-      i, [this, &position](unsigned int v) { position += this->mesh.vertex (v); });
-    return position / float(this->vertexData[i].adjacentFaces.size ());
+  std::size_t numBytes () const
+  {
+    return (this->vertices.capacity () * sizeof (Vertex)) +
+           (this->faces.capacity () * sizeof (Face)) +
+           (this->layerDisplacements.capacity () * sizeof (LayerDisplacement)) +
+           this->isRecordedVertex.capacity () + this->isRecordedFace.capacity () +
+           (this->layerStrengths.capacity () * sizeof (float)) + this->isLayerEnabled.capacity ();
   }
 
-  glm::vec3 averageNormal (const DynamicFaces& faces) const
+  /* Indices are encoded as variable-length differences to the previously encoded index, which
+   * are small since vertices and faces are recorded in the order in which they are touched.
+   */
+  void pack (std::vector<char>& buffer)
   {
-    assert (faces.numElements () > 0);
+    assert (this->isRecordedVertex.empty () && this->isRecordedFace.empty ());
 
-    glm::vec3 normal = glm::vec3 (0.0f);
+    packUnsigned (buffer, this->vertices.size ());
+    packUnsigned (buffer, this->faces.size ());
 
-    for (unsigned int f : faces)
+    unsigned int previous = 0;
+    for (const Vertex& v : this->vertices)
     {
-      unsigned int i1, i2, i3;
-      this->vertexIndices (f, i1, i2, i3);
+      packSigned (buffer, previous, v.index);
+      buffer.push_back (v.isFree ? 1 : 0);
+      if (v.isFree == false)
+      {
+        packRaw (buffer, v.position);
+        packRaw (buffer, v.normal);
+        packRaw (buffer, v.mask);
+      }
+    }
 
-      normal += glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
-                            this->mesh.vertex (i3) - this->mesh.vertex (i1));
+    previous = 0;
+    for (const Face& f : this->faces)
+    {
+      unsigned int previousVertex = f.i1;
+
+      packSigned (buffer, previous, f.index);
+      buffer.push_back (f.isFree ? 1 : 0);
+      if (f.isFree == false)
+      {
+        packUnsigned (buffer, f.i1);
+        packSigned (buffer, previousVertex, f.i2);
+        packSigned (buffer, previousVertex, f.i3);
+      }
     }
-    return glm::normalize (normal);
+
+    packUnsigned (buffer, this->layerDisplacements.size ());
+    previous = 0;
+    for (const LayerDisplacement& d : this->layerDisplacements)
+    {
+      packSigned (buffer, previous, d.vertex);
+      packUnsigned (buffer, d.layer);
+      packRaw (buffer, d.displacement);
+    }
+
+    buffer.push_back (this->hasLayerStates ? 1 : 0);
+    if (this->hasLayerStates)
+    {
+      packUnsigned (buffer, this->layerStrengths.size ());
+      for (unsigned int l = 0; l < this->layerStrengths.size (); l++)
+      {
+        packRaw (buffer, this->layerStrengths[l]);
+        buffer.push_back (char(this->isLayerEnabled[l]));
+      }
+    }
+    this->vertices = std::vector<Vertex> ();
+    this->faces = std::vector<Face> ();
+    this->layerDisplacements = std::vector<LayerDisplacement> ();
+    this->hasLayerStates = false;
+    this->layerStrengths = std::vector<float> ();
+    this->isLayerEnabled = std::vector<unsigned char> ();
   }
 
-  glm::vec3 averageNormal (unsigned int i) const
+  const char* unpack (const char* data)
   {
-    assert (this->isFreeVertex (i) == false);
-    assert (this->vertexData[i].adjacentFaces.size () > 0);
+    assert (this->isEmpty ());
 
-    glm::vec3 normal = glm::vec3 (0.0f);
+    this->vertices.resize (unpackUnsigned (data));
+    this->faces.resize (unpackUnsigned (data));
 
-    for (unsigned int f : this->vertexData[i].adjacentFaces)
+    unsigned int previous = 0;
+    for (Vertex& v : this->vertices)
     {
-      unsigned int i1, i2, i3;
-      this->vertexIndices (f, i1, i2, i3);
+      v.index = unpackSigned (data, previous);
+      v.isFree = *data++ == 1;
+      if (v.isFree)
+      {
+        v.position = glm::vec3 (0.0f);
+        v.normal = glm::vec3 (0.0f);
+        v.mask = 0.0f;
+      }
+      else
+      {
+        unpackRaw (data, v.position);
+        unpackRaw (data, v.normal);
+        unpackRaw (data, v.mask);
+      }
+    }
 
-      normal += glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
-                            this->mesh.vertex (i3) - this->mesh.vertex (i1));
+    previous = 0;
+    for (Face& f : this->faces)
+    {
+      f.index = unpackSigned (data, previous);
+      f.isFree = *data++ == 1;
+      if (f.isFree)
+      {
+        f.i1 = f.i2 = f.i3 = 0;
+      }
+      else
+      {
+        unsigned int previousVertex = unpackUnsigned (data);
+
+        f.i1 = previousVertex;
+        f.i2 = unpackSigned (data, previousVertex);
+        f.i3 = unpackSigned (data, previousVertex);
+      }
     }
-    return glm::normalize (normal);
-  }
 
-  float averageEdgeLengthSqr (const DynamicFaces& faces) const
-  {
-    assert (faces.numElements () > 0);
+    this->layerDisplacements.resize (unpackUnsigned (data));
+    previous = 0;
+    for (LayerDisplacement& d : this->layerDisplacements)
+    {
+      d.vertex = unpackSigned (data, previous);
+      d.layer = unpackUnsigned (data);
+      unpackRaw (data, d.displacement);
+    }
 
-    float length = 0.0f;
-    for (unsigned int i : faces)
+    this->hasLayerStates = *data++ == 1;
+    if (this->hasLayerStates)
     {
-      length += this->averageEdgeLengthSqr (i);
+      this->layerStrengths.resize (unpackUnsigned (data));
+      this->isLayerEnabled.resize (this->layerStrengths.size ());
+      for (unsigned int l = 0; l < this->layerStrengths.size (); l++)
+      {
+        unpackRaw (data, this->layerStrengths[l]);
+        this->isLayerEnabled[l] = *data++;
+      }
     }
-    return length / float(faces.numElements ());
+    return data;
   }
 
-  float averageEdgeLengthSqr (unsigned int i) const
+  void stopRecording ()
   {
-    assert (this->isFreeFace (i) == false);
+    this->isRecordedVertex.clear ();
+    this->isRecordedVertex.shrink_to_fit ();
+    this->isRecordedFace.clear ();
+    this->isRecordedFace.shrink_to_fit ();
+  }
+};
 
-    unsigned int i1, i2, i3;
-    this->vertexIndices (i, i1, i2, i3);
+DELEGATE_BIG3 (DynamicMeshDelta)
+DELEGATE_CONST (bool, DynamicMeshDelta, isEmpty)
+DELEGATE_CONST (std::size_t, DynamicMeshDelta, numBytes)
+DELEGATE1 (void, DynamicMeshDelta, pack, std::vector<char>&)
+DELEGATE1 (const char*, DynamicMeshDelta, unpack, const char*)
 
-    const glm::vec3& v1 = this->mesh.vertex (i1);
-    const glm::vec3& v2 = this->mesh.vertex (i2);
-    const glm::vec3& v3 = this->mesh.vertex (i3);
+struct DynamicMesh::Impl
+{
+  DynamicMesh*               self;
+  Mesh                       mesh;
+  std::vector<VertexData>    vertexData;
+  std::vector<unsigned int>  adjacency;
+  unsigned int               numUnusedAdjacency;
+  VisitedMarks               vertexVisited;
+  std::vector<unsigned int>  freeVertexIndices;
+  std::vector<float>         masks;
+  std::vector<FaceData>      faceData;
+  std::vector<unsigned int>  oppositeHalfEdges;
+  VisitedMarks               faceVisited;
+  std::vector<unsigned int>  freeFaceIndices;
+  std::vector<unsigned int>  collected;
+  std::vector<unsigned int>  realignIndices;
+  std::vector<glm::vec3>     realignPositions;
+  std::vector<float>         realignMaxDimExtents;
+  std::vector<glm::vec3>     faceNormalCache;
+  mutable DynamicOctree      octree;
+  mutable OctreeShape        octreeShape;
+  mutable PendingOctree      pendingOctree;
+  int                        octreeMaxDepthIncrease;
+  float                      octreeMinOccupancyRatio;
+  unsigned int               minCulledFaces;
+  unsigned int               revision;
+  DeltaRecorder              recorder;
+  ChangeJournal              journal;
+  DynamicMeshLayers          layers;
+  LayerRecorder              layerRecorder;
+
+  // cf. `symmetricVertex`, which is empty if the mesh has no symmetry
+  std::vector<unsigned int> symmetricVertices;
+  glm::vec3                 symmetryPoint;
+  glm::vec3                 symmetryNormal;
+
+  /* Precomputed triangles of all faces that have been aligned in the octree, which are read by
+   * ray and distance queries instead of the faces' indices and vertices.  They are only kept for
+   * meshes with at least `minFaceRecordFaces` faces, as long as they fit into `maxFaceRecordBytes`.
+   * A record is refreshed whenever its face is realigned or one of its vertices is moved.
+   */
+  mutable std::vector<TriangleRecord> faceRecords;
+  mutable bool                        hasFaceRecords;
+  unsigned int                        minFaceRecordFaces;
+  std::size_t                         maxFaceRecordBytes;
+
+  std::shared_ptr<DistanceFieldCache> distanceFieldCache;
+
+  // the mesh does not pin its latest version, so chunks are only copied while readers pin it
+  mutable std::weak_ptr<const DynamicMeshVersion> publishedVersion;
+
+  // ranges of faces that are drawn in a darker color because their vertices are masked
+  std::vector<unsigned int> maskedRangeFirsts;
+  std::vector<unsigned int> maskedRangeCounts;
+
+  // cf. `renderVisible`
+  mutable std::vector<unsigned char> visibleFaces;
+  mutable std::vector<unsigned int>  visibleRangeFirsts;
+  mutable std::vector<unsigned int>  visibleRangeCounts;
+
+  static constexpr unsigned int adjacencySlack = 2;
+  static constexpr unsigned int minAdjacencyCapacity = 8;
 
-    return (glm::distance2 (v1, v2) + glm::distance2 (v1, v3) + glm::distance2 (v2, v3)) / 3.0f;
+  Impl (DynamicMesh* s)
+    : self (s)
+    , numUnusedAdjacency (0)
+    , octreeMaxDepthIncrease (2)
+    , octreeMinOccupancyRatio (0.5f)
+    , minCulledFaces (100000)
+    , revision (nextRevision++)
+    , symmetryPoint (0.0f)
+    , symmetryNormal (0.0f)
+    , hasFaceRecords (false)
+    , minFaceRecordFaces (50000)
+    , maxFaceRecordBytes (256 * 1024 * 1024)
+    , distanceFieldCache (std::make_shared<DistanceFieldCache> ())
+  {
   }
 
-  unsigned int addVertex (const glm::vec3& vertex, const glm::vec3& normal)
+  Impl (DynamicMesh* s, const Mesh& m)
+    : self (s)
+    , numUnusedAdjacency (0)
+    , octreeMaxDepthIncrease (2)
+    , octreeMinOccupancyRatio (0.5f)
+    , minCulledFaces (100000)
+    , revision (nextRevision++)
+    , symmetryPoint (0.0f)
+    , symmetryNormal (0.0f)
+    , hasFaceRecords (false)
+    , minFaceRecordFaces (50000)
+    , maxFaceRecordBytes (256 * 1024 * 1024)
+    , distanceFieldCache (std::make_shared<DistanceFieldCache> ())
   {
-    assert (this->vertexData.size () == this->mesh.numVertices ());
-    assert (this->vertexVisited.size () == this->mesh.numVertices ());
+    this->build (m);
+  }
 
-    if (this->freeVertexIndices.empty ())
-    {
-      this->vertexData.emplace_back ();
-      this->vertexData.back ().isFree = false;
-      this->vertexVisited.push_back (0);
-      return this->mesh.addVertex (vertex, normal);
-    }
-    else
+  Impl (DynamicMesh* s, const Mesh& m, const DynamicMeshCache& cache)
+    : Impl (s)
+  {
+    if (this->restore (m, cache) == false)
     {
-      const unsigned int index = this->freeVertexIndices.back ();
-      this->mesh.vertex (index, vertex);
-      this->mesh.normal (index, normal);
-      this->vertexData[index].reset ();
-      this->vertexData[index].isFree = false;
-      this->vertexVisited[index] = 0;
-      this->freeVertexIndices.pop_back ();
-      return index;
+      this->build (m);
     }
   }
 
-  unsigned int addFace (unsigned int i1, unsigned int i2, unsigned int i3)
+  unsigned int numVertices () const
   {
-    assert (i1 < this->mesh.numVertices ());
-    assert (i2 < this->mesh.numVertices ());
-    assert (i3 < this->mesh.numVertices ());
-    assert (3 * this->faceData.size () == this->mesh.numIndices ());
-    assert (this->faceData.size () == this->faceVisited.size ());
-
-    unsigned int index = Util::invalidIndex ();
-
-    if (this->freeFaceIndices.empty ())
-    {
-      index = this->numFaces ();
-      this->faceData.emplace_back ();
-      this->faceVisited.push_back (0);
+    assert (this->mesh.numVertices () >= this->freeVertexIndices.size ());
+    assert (this->mesh.numVertices () == this->vertexData.size ());
+    return this->mesh.numVertices () - this->freeVertexIndices.size ();
+  }
 
-      this->mesh.addIndex (i1);
-      this->mesh.addIndex (i2);
-      this->mesh.addIndex (i3);
-    }
-    else
-    {
-      index = this->freeFaceIndices.back ();
-      this->faceData[index].reset ();
-      this->faceVisited[index] = 0;
-      this->freeFaceIndices.pop_back ();
+  unsigned int numFaces () const
+  {
+    assert (this->faceData.size () >= this->freeFaceIndices.size ());
+    return this->faceData.size () - this->freeFaceIndices.size ();
+  }
 
-      this->mesh.index ((3 * index) + 0, i1);
-      this->mesh.index ((3 * index) + 1, i2);
-      this->mesh.index ((3 * index) + 2, i3);
-    }
-    this->faceData[index].isFree = false;
+  bool isEmpty () const { return this->numFaces () == 0; }
 
-    this->vertexData[i1].addAdjacentFace (index);
-    this->vertexData[i2].addAdjacentFace (index);
-    this->vertexData[i3].addAdjacentFace (index);
+  bool isFreeVertex (unsigned int i) const
+  {
+    assert (i < this->vertexData.size ());
+    return this->vertexData[i].isFree;
+  }
 
-    this->addFaceToOctree (index);
+  bool isFreeFace (unsigned int i) const
+  {
+    assert (i < this->faceData.size ());
+    return this->faceData[i].isFree;
+  }
 
-    return index;
+  bool isPruned () const
+  {
+    return this->freeFaceIndices.empty () && this->freeVertexIndices.empty ();
   }
 
-  void addFaceToOctree (unsigned int i)
+  unsigned int valence (unsigned int i) const
   {
-    const PrimTriangle tri = this->face (i);
+    assert (this->isFreeVertex (i) == false);
+    return this->vertexData[i].valence;
+  }
 
-    if (this->octree.hasRoot () == false)
-    {
-      this->octree.setupRoot (tri.center (), tri.maxDimExtent ());
-    }
+  void vertexIndices (unsigned int i, unsigned int& i1, unsigned int& i2, unsigned int& i3) const
+  {
+    assert (this->isFreeFace (i) == false);
 
-    this->octree.addElement (i, tri.center (), tri.maxDimExtent ());
+    i1 = this->mesh.index ((3 * i) + 0);
+    i2 = this->mesh.index ((3 * i) + 1);
+    i3 = this->mesh.index ((3 * i) + 2);
   }
 
-  void deleteVertex (unsigned int i)
+  PrimTriangle face (unsigned int i) const
   {
-    assert (i < this->vertexData.size ());
-    assert (i < this->vertexVisited.size ());
+    assert (this->isFreeFace (i) == false);
 
-    std::vector<unsigned int> adjacentFaces = this->vertexData[i].adjacentFaces;
-    for (unsigned int f : adjacentFaces)
-    {
-      this->deleteFace (f);
-    }
-    this->vertexData[i].reset ();
-    this->vertexVisited[i] = 0;
-    this->freeVertexIndices.push_back (i);
+    return PrimTriangle (this->mesh.vertex (this->mesh.index ((3 * i) + 0)),
+                         this->mesh.vertex (this->mesh.index ((3 * i) + 1)),
+                         this->mesh.vertex (this->mesh.index ((3 * i) + 2)));
   }
 
-  void deleteFace (unsigned int i)
+  TriangleRecord faceRecord (unsigned int i) const
   {
-    assert (i < this->faceData.size ());
-    assert (i < this->faceVisited.size ());
+    assert (this->isFreeFace (i) == false);
 
-    this->vertexData[this->mesh.index ((3 * i) + 0)].deleteAdjacentFace (i);
-    this->vertexData[this->mesh.index ((3 * i) + 1)].deleteAdjacentFace (i);
-    this->vertexData[this->mesh.index ((3 * i) + 2)].deleteAdjacentFace (i);
+    return TriangleRecord (this->mesh.vertex (this->mesh.index ((3 * i) + 0)),
+                           this->mesh.vertex (this->mesh.index ((3 * i) + 1)),
+                           this->mesh.vertex (this->mesh.index ((3 * i) + 2)));
+  }
 
-    this->faceData[i].reset ();
-    this->faceVisited[i] = 0;
-    this->freeFaceIndices.push_back (i);
-    this->octree.deleteElement (i);
+  const glm::vec3& vertexNormal (unsigned int i) const { return this->mesh.normal (i); }
+
+  bool hasMask () const { return this->masks.empty () == false; }
+
+  float mask (unsigned int i) const
+  {
+    assert (this->isFreeVertex (i) == false);
+    return i < this->masks.size () ? this->masks[i] : 0.0f;
   }
 
-  void vertexNormal (unsigned int i, const glm::vec3& n)
+  void mask (unsigned int i, float m)
   {
     assert (this->isFreeVertex (i) == false);
-    assert (this->mesh.numVertices () == this->vertexData.size ());
 
-    this->mesh.normal (i, n);
+    const float clamped = glm::clamp (m, 0.0f, 1.0f);
+    if (clamped != this->mask (i))
+    {
+      this->recordVertex (i);
+      this->setMask (i, clamped);
+    }
   }
 
-  void setVertexNormal (unsigned int i)
+  // masks are only stored up to the last slot that has been masked
+  void setMask (unsigned int i, float m)
   {
-    const glm::vec3 avg = this->averageNormal (i);
-
-    if (Util::isNaN (avg))
+    if (i < this->masks.size ())
     {
-      this->mesh.normal (i, glm::vec3 (0.0f));
+      this->masks[i] = m;
     }
-    else
+    else if (m > 0.0f)
     {
-      this->mesh.normal (i, avg);
+      this->masks.resize (this->numVertexSlots (), 0.0f);
+      this->masks[i] = m;
     }
   }
 
-  void setAllNormals ()
+  void resetMask ()
   {
-    this->forEachVertex ([this](unsigned int i) { this->setVertexNormal (i); });
+    for (unsigned int i = 0; i < this->masks.size (); i++)
+    {
+      if (this->isFreeVertex (i) == false && this->masks[i] > 0.0f)
+      {
+        this->recordVertex (i);
+      }
+    }
+    this->masks.clear ();
   }
 
-  void reset ()
+  glm::vec3 faceNormal (unsigned int i) const
   {
-    this->mesh.reset ();
+    assert (this->isFreeFace (i) == false);
+
+    unsigned int i1, i2, i3;
+    this->vertexIndices (i, i1, i2, i3);
+
+    return glm::normalize (glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
+                                       this->mesh.vertex (i3) - this->mesh.vertex (i1)));
+  }
+
+  void findAdjacent (unsigned int e1, unsigned int e2, unsigned int& leftFace,
+                     unsigned int& leftVertex, unsigned int& rightFace,
+                     unsigned int& rightVertex) const
+  {
+    assert (this->isFreeVertex (e1) == false);
+    assert (this->isFreeVertex (e2) == false);
+
+    const unsigned int left = this->halfEdge (e1, e2);
+    assert (left != Util::invalidIndex ());
+
+    const unsigned int right = this->oppositeHalfEdge (left);
+    assert (right != Util::invalidIndex ());
+
+    leftFace = this->halfEdgeFace (left);
+    leftVertex = this->halfEdgeTarget (this->nextHalfEdge (left));
+    rightFace = this->halfEdgeFace (right);
+    rightVertex = this->halfEdgeTarget (this->nextHalfEdge (right));
+  }
+
+  /* The `k`-th half-edge of face `f` has index `3 * f + k` and runs from the `k`-th vertex of
+   * `f` to its successor.  The index of a half-edge is thus also its index into the index
+   * buffer of `mesh`.
+   */
+  unsigned int halfEdge (unsigned int i1, unsigned int i2) const
+  {
+    assert (this->isFreeVertex (i1) == false);
+
+    for (unsigned int a : this->adjacentFaces (i1))
+    {
+      for (unsigned int h = 3 * a; h < (3 * a) + 3; h++)
+      {
+        if (this->halfEdgeSource (h) == i1 && this->halfEdgeTarget (h) == i2)
+        {
+          return h;
+        }
+      }
+    }
+    return Util::invalidIndex ();
+  }
+
+  unsigned int oppositeHalfEdge (unsigned int h) const
+  {
+    assert (this->isFreeFace (this->halfEdgeFace (h)) == false);
+    return this->oppositeHalfEdges[h];
+  }
+
+  unsigned int nextHalfEdge (unsigned int h) const { return h % 3 == 2 ? h - 2 : h + 1; }
+
+  unsigned int halfEdgeFace (unsigned int h) const { return h / 3; }
+
+  unsigned int halfEdgeSource (unsigned int h) const { return this->mesh.index (h); }
+
+  unsigned int halfEdgeTarget (unsigned int h) const
+  {
+    return this->mesh.index (this->nextHalfEdge (h));
+  }
+
+  bool isBoundaryHalfEdge (unsigned int h) const
+  {
+    return this->oppositeHalfEdge (h) == Util::invalidIndex ();
+  }
+
+  // pairs the half-edges of face `f` with the half-edges of its neighbours
+  void linkHalfEdges (unsigned int f)
+  {
+    for (unsigned int h = 3 * f; h < (3 * f) + 3; h++)
+    {
+      const unsigned int opposite =
+        this->halfEdge (this->halfEdgeTarget (h), this->halfEdgeSource (h));
+
+      this->oppositeHalfEdges[h] = opposite;
+      if (opposite != Util::invalidIndex ())
+      {
+        this->oppositeHalfEdges[opposite] = h;
+      }
+    }
+  }
+
+  void unlinkHalfEdges (unsigned int f)
+  {
+    for (unsigned int h = 3 * f; h < (3 * f) + 3; h++)
+    {
+      const unsigned int opposite = this->oppositeHalfEdges[h];
+
+      if (opposite != Util::invalidIndex () && this->oppositeHalfEdges[opposite] == h)
+      {
+        this->oppositeHalfEdges[opposite] = Util::invalidIndex ();
+      }
+      this->oppositeHalfEdges[h] = Util::invalidIndex ();
+    }
+  }
+
+  DynamicMesh::AdjacentFaces adjacentFaces (unsigned int i) const
+  {
+    assert (this->isFreeVertex (i) == false);
+
+    const VertexData& d = this->vertexData[i];
+    return DynamicMesh::AdjacentFaces (this->adjacency.data () + d.offset, d.valence);
+  }
+
+  void addAdjacentFace (unsigned int i, unsigned int face)
+  {
+    if (this->vertexData[i].valence == this->vertexData[i].capacity)
+    {
+      this->growAdjacency (i);
+    }
+    VertexData& d = this->vertexData[i];
+    this->adjacency[d.offset + d.valence] = face;
+    d.valence++;
+  }
+
+  void deleteAdjacentFace (unsigned int i, unsigned int face)
+  {
+    VertexData&   d = this->vertexData[i];
+    unsigned int* begin = this->adjacency.data () + d.offset;
+    unsigned int* end = begin + d.valence;
+    unsigned int* it = std::find (begin, end, face);
+
+    assert (it != end);
+    std::copy (it + 1, end, it);
+    d.valence--;
+  }
+
+  // moves the range of `i` to the end of the pool, where it can grow
+  void growAdjacency (unsigned int i)
+  {
+    if (this->numUnusedAdjacency > this->adjacency.size () / 2)
+    {
+      this->compactAdjacency ();
+    }
+
+    VertexData&        d = this->vertexData[i];
+    const unsigned int capacity = glm::max (Impl::minAdjacencyCapacity, 2 * d.capacity);
+
+    if (d.offset + d.capacity == this->adjacency.size ())
+    {
+      this->adjacency.resize (d.offset + capacity);
+    }
+    else
+    {
+      const unsigned int offset = this->adjacency.size ();
+
+      this->adjacency.resize (offset + capacity);
+      std::copy (this->adjacency.begin () + d.offset,
+                 this->adjacency.begin () + d.offset + d.valence,
+                 this->adjacency.begin () + offset);
+      this->numUnusedAdjacency += d.capacity;
+      d.offset = offset;
+    }
+    d.capacity = capacity;
+  }
+
+  // removes the unused parts of the pool
+  void compactAdjacency ()
+  {
+    std::vector<unsigned int> compacted;
+    unsigned int              size = 0;
+
+    for (const VertexData& d : this->vertexData)
+    {
+      size += d.capacity;
+    }
+    compacted.resize (size);
+
+    unsigned int offset = 0;
+    for (VertexData& d : this->vertexData)
+    {
+      std::copy (this->adjacency.begin () + d.offset,
+                 this->adjacency.begin () + d.offset + d.valence, compacted.begin () + offset);
+      d.offset = offset;
+      offset += d.capacity;
+    }
+    this->adjacency = std::move (compacted);
+    this->numUnusedAdjacency = 0;
+  }
+
+  // lays out the ranges of all vertices densely, each with room for its valence plus some slack
+  void allocateAdjacency (const std::vector<unsigned int>& valences)
+  {
+    assert (valences.size () == this->vertexData.size ());
+
+    unsigned int offset = 0;
+    for (unsigned int i = 0; i < this->vertexData.size (); i++)
+    {
+      VertexData& d = this->vertexData[i];
+
+      assert (d.valence == 0);
+      d.offset = offset;
+      d.capacity = valences[i] + Impl::adjacencySlack;
+      offset += d.capacity;
+    }
+    this->adjacency.clear ();
+    this->adjacency.resize (offset);
+    this->numUnusedAdjacency = 0;
+  }
+
+  template <typename F> void forEachVertex (const F& f)
+  {
+    for (unsigned int i = 0; i < this->vertexData.size (); i++)
+    {
+      if (this->isFreeVertex (i) == false)
+      {
+        f (i);
+      }
+    }
+  }
+
+  template <typename F> void visitVertices (unsigned int i, const F& f)
+  {
+    assert (this->isFreeFace (i) == false);
+
+    unsigned int i1, i2, i3;
+    this->vertexIndices (i, i1, i2, i3);
+
+    if (this->vertexVisited.isVisited (i1) == false)
+    {
+      this->vertexVisited.visit (i1);
+      f (i1);
+    }
+    if (this->vertexVisited.isVisited (i2) == false)
+    {
+      this->vertexVisited.visit (i2);
+      f (i2);
+    }
+    if (this->vertexVisited.isVisited (i3) == false)
+    {
+      this->vertexVisited.visit (i3);
+      f (i3);
+    }
+    this->faceVisited.visit (i);
+  }
+
+  void unvisitVertices () { this->vertexVisited.unvisitAll (); }
+
+  void unvisitFaces () { this->faceVisited.unvisitAll (); }
+
+  template <typename F> void forEachVertex (const DynamicFaces& faces, const F& f)
+  {
+    this->unvisitVertices ();
+
+    for (unsigned int i : faces)
+    {
+      this->visitVertices (i, f);
+    }
+  }
+
+  template <typename F> void forEachVertexExt (const DynamicFaces& faces, const F& f)
+  {
+    this->unvisitVertices ();
+    this->unvisitFaces ();
+
+    for (unsigned int i : faces)
+    {
+      this->visitVertices (i, [this, &f](unsigned int j) {
+        f (j);
+
+        for (unsigned int a : this->adjacentFaces (j))
+        {
+          if (this->faceVisited.isVisited (a) == false)
+          {
+            this->visitVertices (a, f);
+          }
+        }
+      });
+    }
+  }
+
+  template <typename F> void forEachVertexAdjacentToVertex (unsigned int i, const F& f) const
+  {
+    assert (this->isFreeVertex (i) == false);
+
+    for (unsigned int a : this->adjacentFaces (i))
+    {
+      unsigned int a1, a2, a3;
+      this->vertexIndices (a, a1, a2, a3);
+
+      if (i == a1)
+      {
+        f (a2);
+      }
+      else if (i == a2)
+      {
+        f (a3);
+      }
+      else if (i == a3)
+      {
+        f (a1);
+      }
+      else
+      {
+        DILAY_IMPOSSIBLE
+      }
+    }
+  }
+
+  template <typename F> void forEachVertexAdjacentToFace (unsigned int i, const F& f) const
+  {
+    assert (this->isFreeFace (i) == false);
+
+    unsigned int i1, i2, i3;
+    this->vertexIndices (i, i1, i2, i3);
+
+    f (i1);
+    f (i2);
+    f (i3);
+  }
+
+  template <typename F> void forEachFace (const F& f)
+  {
+    for (unsigned int i = 0; i < this->faceData.size (); i++)
+    {
+      if (this->isFreeFace (i) == false)
+      {
+        f (i);
+      }
+    }
+  }
+
+  template <typename F> void forEachFaceExt (const DynamicFaces& faces, const F& f)
+  {
+    this->unvisitVertices ();
+    this->unvisitFaces ();
+
+    for (unsigned int i : faces)
+    {
+      if (this->faceVisited.isVisited (i) == false)
+      {
+        f (i);
+        this->faceVisited.visit (i);
+      }
+      this->visitVertices (i, [this, &f](unsigned int j) {
+        for (unsigned int a : this->adjacentFaces (j))
+        {
+          if (this->faceVisited.isVisited (a) == false)
+          {
+            f (a);
+            this->faceVisited.visit (a);
+          }
+        }
+      });
+    }
+  }
+
+  // number of vertices including free ones
+  unsigned int numVertexSlots () const { return this->vertexData.size (); }
+
+  // number of faces including free ones
+  unsigned int numFaceSlots () const { return this->faceData.size (); }
+
+  const std::vector<unsigned int>& collectVertices (const DynamicFaces& faces)
+  {
+    this->collected.clear ();
+    this->forEachVertex (faces, [this](unsigned int i) { this->collected.push_back (i); });
+    return this->collected;
+  }
+
+  const std::vector<unsigned int>& collectVerticesExt (const DynamicFaces& faces)
+  {
+    this->collected.clear ();
+    this->forEachVertexExt (faces, [this](unsigned int i) { this->collected.push_back (i); });
+    return this->collected;
+  }
+
+  const std::vector<unsigned int>& collectFacesExt (const DynamicFaces& faces)
+  {
+    this->collected.clear ();
+    this->forEachFaceExt (faces, [this](unsigned int i) { this->collected.push_back (i); });
+    return this->collected;
+  }
+
+  void average (const DynamicFaces& faces, glm::vec3& position, glm::vec3& normal) const
+  {
+    assert (faces.numElements () > 0);
+
+    position = glm::vec3 (0.0f);
+    normal = glm::vec3 (0.0f);
+
+    for (unsigned int f : faces)
+    {
+      unsigned int i1, i2, i3;
+      this->vertexIndices (f, i1, i2, i3);
+
+      position += this->mesh.vertex (i1);
+      position += this->mesh.vertex (i2);
+      position += this->mesh.vertex (i3);
+      normal += glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
+                            this->mesh.vertex (i3) - this->mesh.vertex (i1));
+    }
+    position /= float(faces.numElements () * 3);
+    normal = glm::normalize (normal);
+  }
+
+  glm::vec3 averagePosition (const DynamicFaces& faces) const
+  {
+    assert (faces.numElements () > 0);
+
+    glm::vec3 position = glm::vec3 (0.0f);
+
+    for (unsigned int f : faces)
+    {
+      this->forEachVertexAdjacentToFace (
+        f, [this, &position](unsigned int v) { position += this->mesh.vertex (v); });
+    }
+    return position / float(faces.numElements () * 3);
+  }
+
+  glm::vec3 averagePosition (unsigned int i) const
+  {
+    assert (this->isFreeVertex (i) == false);
+    assert (this->vertexData[i].valence > 0);
+
+    glm::vec3 position = glm::vec3 (0.0f);
+
+    this->forEachVertexAdjacentToVertex (
+      i, [this, &position](unsigned int v) { position += this->mesh.vertex (v); });
+    return position / float(this->vertexData[i].valence);
+  }
+
+  glm::vec3 averageNormal (const DynamicFaces& faces) const
+  {
+    assert (faces.numElements () > 0);
+
+    glm::vec3 normal = glm::vec3 (0.0f);
+
+    for (unsigned int f : faces)
+    {
+      unsigned int i1, i2, i3;
+      this->vertexIndices (f, i1, i2, i3);
+
+      normal += glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
+                            this->mesh.vertex (i3) - this->mesh.vertex (i1));
+    }
+    return glm::normalize (normal);
+  }
+
+  glm::vec3 averageNormal (unsigned int i) const
+  {
+    assert (this->isFreeVertex (i) == false);
+    assert (this->vertexData[i].valence > 0);
+
+    glm::vec3 normal = glm::vec3 (0.0f);
+
+    for (unsigned int f : this->adjacentFaces (i))
+    {
+      unsigned int i1, i2, i3;
+      this->vertexIndices (f, i1, i2, i3);
+
+      normal += glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
+                            this->mesh.vertex (i3) - this->mesh.vertex (i1));
+    }
+    return glm::normalize (normal);
+  }
+
+  float averageEdgeLengthSqr (const DynamicFaces& faces) const
+  {
+    assert (faces.numElements () > 0);
+
+    float length = 0.0f;
+    for (unsigned int i : faces)
+    {
+      length += this->averageEdgeLengthSqr (i);
+    }
+    return length / float(faces.numElements ());
+  }
+
+  float averageEdgeLengthSqr (unsigned int i) const
+  {
+    assert (this->isFreeFace (i) == false);
+
+    unsigned int i1, i2, i3;
+    this->vertexIndices (i, i1, i2, i3);
+
+    const glm::vec3& v1 = this->mesh.vertex (i1);
+    const glm::vec3& v2 = this->mesh.vertex (i2);
+    const glm::vec3& v3 = this->mesh.vertex (i3);
+
+    return (glm::distance2 (v1, v2) + glm::distance2 (v1, v3) + glm::distance2 (v2, v3)) / 3.0f;
+  }
+
+  // must be called whenever the geometry of the mesh is modified
+  void touch () { this->revision = nextRevision.fetch_add (1, std::memory_order_relaxed); }
+
+  std::shared_ptr<const DynamicMeshDistanceField> distanceField () const
+  {
+    std::lock_guard<std::mutex> lock (this->distanceFieldCache->mutex);
+
+    if (this->distanceFieldCache->revision == this->revision)
+    {
+      return this->distanceFieldCache->field;
+    }
+    else
+    {
+      return nullptr;
+    }
+  }
+
+  void distanceField (const std::shared_ptr<const DynamicMeshDistanceField>& field) const
+  {
+    std::lock_guard<std::mutex> lock (this->distanceFieldCache->mutex);
+
+    this->distanceFieldCache->revision = this->revision;
+    this->distanceFieldCache->field = field;
+  }
+
+  std::shared_ptr<const DynamicMeshVersion> version () const
+  {
+    std::shared_ptr<const DynamicMeshVersion> version = this->publishedVersion.lock ();
+
+    if (version == nullptr || version->revision != this->revision ||
+        version->mesh.modelMatrix () != this->mesh.modelMatrix ())
+    {
+      version.reset (new DynamicMeshVersion{this->revision, this->mesh, this->freeVertexIndices,
+                                            this->freeFaceIndices});
+      this->publishedVersion = version;
+    }
+    return version;
+  }
+
+  unsigned int subscribeToChanges () { return this->journal.subscribe (); }
+
+  void unsubscribeFromChanges (unsigned int id) { this->journal.unsubscribe (id); }
+
+  bool consumeChanges (unsigned int id, std::vector<unsigned int>& vertices,
+                       std::vector<unsigned int>& faces)
+  {
+    return this->journal.consume (id, vertices, faces);
+  }
+
+  // vertices and faces are logged to the journal whenever they are recorded
+  void recordVertex (unsigned int i)
+  {
+    this->journal.logVertex (i);
+
+    if (this->layerRecorder.isRecording ())
+    {
+      this->recordLayerVertex (i);
+    }
+
+    if (this->recorder.delta)
+    {
+      DynamicMeshDelta::Impl& delta = *this->recorder.delta->impl;
+
+      if (i >= delta.isRecordedVertex.size ())
+      {
+        delta.isRecordedVertex.resize (glm::max (i + 1, 2 * this->numVertexSlots ()), 0);
+      }
+      if (delta.isRecordedVertex[i] == 0)
+      {
+        if (i < this->numVertexSlots () && this->isFreeVertex (i) == false)
+        {
+          delta.vertices.push_back (
+            {i, false, this->mesh.vertex (i), this->mesh.normal (i), this->mask (i)});
+
+          if (this->layers.numLayers () > 0)
+          {
+            this->layers.forEachDisplacement (i, [&delta, i](unsigned int l, const glm::vec3& d) {
+              delta.layerDisplacements.push_back ({i, l, d});
+            });
+          }
+        }
+        else
+        {
+          delta.vertices.push_back ({i, true, glm::vec3 (0.0f), glm::vec3 (0.0f), 0.0f});
+        }
+        delta.isRecordedVertex[i] = 1;
+      }
+    }
+  }
+
+  void recordFace (unsigned int i)
+  {
+    this->journal.logFace (i);
+
+    if (this->recorder.delta)
+    {
+      DynamicMeshDelta::Impl& delta = *this->recorder.delta->impl;
+
+      if (i >= delta.isRecordedFace.size ())
+      {
+        delta.isRecordedFace.resize (glm::max (i + 1, 2 * this->numFaceSlots ()), 0);
+      }
+      if (delta.isRecordedFace[i] == 0)
+      {
+        if (i < this->numFaceSlots () && this->isFreeFace (i) == false)
+        {
+          unsigned int i1, i2, i3;
+          this->vertexIndices (i, i1, i2, i3);
+          delta.faces.push_back ({i, false, i1, i2, i3});
+        }
+        else
+        {
+          delta.faces.push_back ({i, true, 0, 0, 0});
+        }
+        delta.isRecordedFace[i] = 1;
+      }
+    }
+  }
+
+  void recordLayerVertex (unsigned int i)
+  {
+    LayerRecorder& r = this->layerRecorder;
+
+    if (i >= r.entries.size ())
+    {
+      r.entries.resize (glm::max (i + 1, 2 * this->numVertexSlots ()), Util::invalidIndex ());
+    }
+    if (r.entries[i] == Util::invalidIndex ())
+    {
+      const bool isNew = i >= this->numVertexSlots () || this->isFreeVertex (i);
+
+      r.entries[i] = r.vertices.size ();
+      r.vertices.push_back (i);
+      r.positions.push_back (isNew ? glm::vec3 (0.0f) : this->mesh.vertex (i));
+      r.isNew.push_back (isNew ? 1 : 0);
+    }
+  }
+
+  // must be called before the strength of a layer is changed or a layer is enabled or disabled
+  void recordLayerStates ()
+  {
+    if (this->recorder.delta && this->recorder.delta->impl->hasLayerStates == false)
+    {
+      DynamicMeshDelta::Impl& delta = *this->recorder.delta->impl;
+
+      delta.hasLayerStates = true;
+      for (unsigned int l = 0; l < this->layers.numLayers (); l++)
+      {
+        delta.layerStrengths.push_back (this->layers.strength (l));
+        delta.isLayerEnabled.push_back (this->layers.isEnabled (l) ? 1 : 0);
+      }
+    }
+  }
+
+  // must be called before vertices or faces are renumbered or modified all at once
+  void recordAll ()
+  {
+    if (this->recorder.delta)
+    {
+      for (unsigned int i = 0; i < this->numVertexSlots (); i++)
+      {
+        this->recordVertex (i);
+      }
+      for (unsigned int i = 0; i < this->numFaceSlots (); i++)
+      {
+        this->recordFace (i);
+      }
+    }
+    this->journal.logEverything ();
+  }
+
+  void recordDelta (DynamicMeshDelta* delta)
+  {
+    if (this->recorder.delta)
+    {
+      this->recorder.delta->impl->stopRecording ();
+    }
+    this->recorder.delta = delta;
+  }
+
+  // enlarges the mesh by free slots such that `i` is a valid vertex index
+  void ensureVertexSlot (unsigned int i)
+  {
+    while (this->numVertexSlots () <= i)
+    {
+      this->vertexData.emplace_back ();
+      this->vertexData.back ().offset = this->adjacency.size ();
+      this->vertexVisited.add ();
+      this->mesh.addVertex (glm::vec3 (0.0f), glm::vec3 (0.0f));
+    }
+  }
+
+  // enlarges the mesh by free slots such that `i` is a valid face index
+  void ensureFaceSlot (unsigned int i)
+  {
+    while (this->numFaceSlots () <= i)
+    {
+      this->faceData.emplace_back ();
+      this->faceVisited.add ();
+      this->mesh.addIndex (0);
+      this->mesh.addIndex (0);
+      this->mesh.addIndex (0);
+    }
+    this->oppositeHalfEdges.resize (3 * this->faceData.size (), Util::invalidIndex ());
+  }
+
+  void applyDelta (DynamicMeshDelta& delta)
+  {
+    assert (this->recorder.delta == nullptr);
+
+    std::vector<DynamicMeshDelta::Impl::Vertex>& vertices = delta.impl->vertices;
+    std::vector<DynamicMeshDelta::Impl::Face>&   faces = delta.impl->faces;
+
+    DynamicMeshDelta inverse;
+    this->recorder.delta = &inverse;
+    for (const DynamicMeshDelta::Impl::Vertex& v : vertices)
+    {
+      this->recordVertex (v.index);
+    }
+    for (const DynamicMeshDelta::Impl::Face& f : faces)
+    {
+      this->recordFace (f.index);
+    }
+    if (delta.impl->hasLayerStates)
+    {
+      this->recordLayerStates ();
+    }
+    this->recordDelta (nullptr);
+
+    for (const DynamicMeshDelta::Impl::Face& f : faces)
+    {
+      if (f.index < this->numFaceSlots () && this->isFreeFace (f.index) == false)
+      {
+        this->deleteFace (f.index);
+      }
+    }
+
+    for (const DynamicMeshDelta::Impl::Vertex& v : vertices)
+    {
+      this->ensureVertexSlot (v.index);
+      this->unpairVertex (v.index);
+
+      VertexData& d = this->vertexData[v.index];
+      if (v.isFree)
+      {
+        assert (d.valence == 0);
+        d.reset ();
+      }
+      else
+      {
+        d.isFree = false;
+        this->mesh.vertex (v.index, v.position);
+        this->mesh.normal (v.index, v.normal);
+        this->setMask (v.index, v.mask);
+      }
+      this->layers.resetVertex (v.index);
+    }
+
+    for (const DynamicMeshDelta::Impl::LayerDisplacement& d : delta.impl->layerDisplacements)
+    {
+      this->layers.displacement (d.layer, d.vertex, d.displacement);
+    }
+
+    if (delta.impl->hasLayerStates)
+    {
+      assert (delta.impl->layerStrengths.size () == this->layers.numLayers ());
+
+      for (unsigned int l = 0; l < this->layers.numLayers (); l++)
+      {
+        this->layers.strength (l, delta.impl->layerStrengths[l]);
+        this->layers.enable (l, delta.impl->isLayerEnabled[l] == 1);
+      }
+    }
+
+    for (const DynamicMeshDelta::Impl::Face& f : faces)
+    {
+      this->ensureFaceSlot (f.index);
+
+      if (f.isFree == false)
+      {
+        assert (this->isFreeVertex (f.i1) == false);
+        assert (this->isFreeVertex (f.i2) == false);
+        assert (this->isFreeVertex (f.i3) == false);
+
+        this->mesh.index ((3 * f.index) + 0, f.i1);
+        this->mesh.index ((3 * f.index) + 1, f.i2);
+        this->mesh.index ((3 * f.index) + 2, f.i3);
+        this->faceData[f.index].isFree = false;
+
+        this->addAdjacentFace (f.i1, f.index);
+        this->addAdjacentFace (f.i2, f.index);
+        this->addAdjacentFace (f.i3, f.index);
+        this->linkHalfEdges (f.index);
+        this->addFaceToOctree (f.index);
+      }
+    }
+
+    this->freeVertexIndices.clear ();
+    for (unsigned int i = 0; i < this->numVertexSlots (); i++)
+    {
+      if (this->isFreeVertex (i))
+      {
+        this->freeVertexIndices.push_back (i);
+      }
+    }
+    this->freeFaceIndices.clear ();
+    for (unsigned int i = 0; i < this->numFaceSlots (); i++)
+    {
+      if (this->isFreeFace (i))
+      {
+        this->freeFaceIndices.push_back (i);
+      }
+    }
+
+    // faces whose vertices have been moved
+    this->unvisitFaces ();
+    for (const DynamicMeshDelta::Impl::Vertex& v : vertices)
+    {
+      if (v.isFree == false)
+      {
+        for (unsigned int a : this->adjacentFaces (v.index))
+        {
+          if (this->faceVisited.isVisited (a) == false)
+          {
+            this->realignFace (a);
+            this->faceVisited.visit (a);
+          }
+        }
+      }
+    }
+
+    vertices = std::move (inverse.impl->vertices);
+    faces = std::move (inverse.impl->faces);
+    delta.impl->layerDisplacements = std::move (inverse.impl->layerDisplacements);
+    delta.impl->hasLayerStates = inverse.impl->hasLayerStates;
+    delta.impl->layerStrengths = std::move (inverse.impl->layerStrengths);
+    delta.impl->isLayerEnabled = std::move (inverse.impl->isLayerEnabled);
+    this->touch ();
+  }
+
+  unsigned int addLayer ()
+  {
+    assert (this->recorder.delta == nullptr);
+    assert (this->layerRecorder.isRecording () == false);
+
+    return this->layers.addLayer ();
+  }
+
+  void applyLayer (unsigned int l)
+  {
+    assert (this->recorder.delta == nullptr);
+    assert (this->layerRecorder.isRecording () == false);
+
+    this->layers.deleteLayer (l);
+  }
+
+  void layerStrength (unsigned int l, float strength)
+  {
+    const float weight = this->layers.weight (l);
+
+    this->recordLayerStates ();
+    this->layers.strength (l, strength);
+    this->blendLayer (l, weight);
+  }
+
+  void enableLayer (unsigned int l, bool enable)
+  {
+    const float weight = this->layers.weight (l);
+
+    this->recordLayerStates ();
+    this->layers.enable (l, enable);
+    this->blendLayer (l, weight);
+  }
+
+  // moves the displaced vertices of a layer by the change of its weight
+  void blendLayer (unsigned int l, float previousWeight)
+  {
+    assert (this->layerRecorder.isRecording () == false);
+
+    const float factor = this->layers.weight (l) - previousWeight;
+
+    if (factor != 0.0f)
+    {
+      DynamicFaces faces;
+
+      this->touch ();
+      this->layers.blend (l, factor, [this, &faces](unsigned int i, const glm::vec3& d) {
+        assert (this->isFreeVertex (i) == false);
+
+        this->recordVertex (i);
+        this->mesh.vertex (i, this->mesh.vertex (i) + d);
+
+        for (unsigned int f : this->adjacentFaces (i))
+        {
+          faces.insert (f);
+        }
+      });
+      faces.commit ();
+
+      this->realignFaces (faces);
+      this->setVertexNormals (faces);
+    }
+  }
+
+  void recordLayer (unsigned int l)
+  {
+    assert (l == Util::invalidIndex () || l < this->layers.numLayers ());
+
+    if (this->layerRecorder.isRecording ())
+    {
+      this->addRecordedDisplacements ();
+    }
+    this->layerRecorder.reset (l);
+  }
+
+  /* Modifications are divided by the weight of the layer, such that the weighted displacements
+   * match them.  Vertices that have been added take the average displacement of their adjacent
+   * vertices that have been there before.  Modifications of a layer with zero weight are kept
+   * by the mesh but are not added to the layer.
+   */
+  void addRecordedDisplacements ()
+  {
+    LayerRecorder&     r = this->layerRecorder;
+    const unsigned int l = r.layer;
+    const float        weight = this->layers.weight (l);
+
+    // recording is stopped before displacements are changed, which are recorded by deltas
+    r.layer = Util::invalidIndex ();
+
+    if (weight <= 0.0f)
+    {
+      return;
+    }
+
+    const auto isAlive = [this](unsigned int i) {
+      return i < this->numVertexSlots () && this->isFreeVertex (i) == false;
+    };
+
+    for (unsigned int k = 0; k < r.vertices.size (); k++)
+    {
+      const unsigned int i = r.vertices[k];
+
+      if (r.isNew[k] == 0 && isAlive (i))
+      {
+        const glm::vec3 moved = this->mesh.vertex (i) - r.positions[k];
+
+        if (moved != glm::vec3 (0.0f))
+        {
+          this->recordVertex (i);
+          this->layers.displacement (l, i, this->layers.displacement (l, i) + (moved / weight));
+        }
+      }
+    }
+
+    for (unsigned int k = 0; k < r.vertices.size (); k++)
+    {
+      const unsigned int i = r.vertices[k];
+
+      if (r.isNew[k] == 1 && isAlive (i))
+      {
+        glm::vec3    sum (0.0f);
+        unsigned int n = 0;
+
+        this->self->forEachVertexAdjacentToVertex (i, [this, l, &r, &sum, &n](unsigned int a) {
+          if (a >= r.entries.size () || r.entries[a] == Util::invalidIndex () ||
+              r.isNew[r.entries[a]] == 0)
+          {
+            sum += this->layers.displacement (l, a);
+            n++;
+          }
+        });
+
+        this->recordVertex (i);
+        this->layers.displacement (l, i, n > 0 ? sum / float(n) : glm::vec3 (0.0f));
+      }
+    }
+  }
+
+  unsigned int addVertex (const glm::vec3& vertex, const glm::vec3& normal)
+  {
+    this->touch ();
+    this->recordVertex (this->freeVertexIndices.empty () ? this->numVertexSlots ()
+                                                         : this->freeVertexIndices.back ());
+
+    assert (this->vertexData.size () == this->mesh.numVertices ());
+    assert (this->vertexVisited.size () == this->mesh.numVertices ());
+
+    if (this->freeVertexIndices.empty ())
+    {
+      this->vertexData.emplace_back ();
+      this->vertexData.back ().isFree = false;
+      this->vertexData.back ().offset = this->adjacency.size ();
+      this->vertexVisited.add ();
+      return this->mesh.addVertex (vertex, normal);
+    }
+    else
+    {
+      const unsigned int index = this->freeVertexIndices.back ();
+      this->mesh.vertex (index, vertex);
+      this->mesh.normal (index, normal);
+      this->vertexData[index].reset ();
+      this->vertexData[index].isFree = false;
+      this->vertexVisited.unvisit (index);
+      this->setMask (index, 0.0f);
+      this->layers.resetVertex (index);
+      this->freeVertexIndices.pop_back ();
+      return index;
+    }
+  }
+
+  unsigned int addFace (unsigned int i1, unsigned int i2, unsigned int i3)
+  {
+    const unsigned int index = this->addFaceData (i1, i2, i3);
+    this->addFaceToOctree (index);
+    return index;
+  }
+
+  // adds a face without adding it to the octree
+  unsigned int addFaceData (unsigned int i1, unsigned int i2, unsigned int i3)
+  {
+    this->touch ();
+    this->recordFace (this->freeFaceIndices.empty () ? this->numFaceSlots ()
+                                                     : this->freeFaceIndices.back ());
+    assert (i1 < this->mesh.numVertices ());
+    assert (i2 < this->mesh.numVertices ());
+    assert (i3 < this->mesh.numVertices ());
+    assert (3 * this->faceData.size () == this->mesh.numIndices ());
+    assert (this->faceData.size () == this->faceVisited.size ());
+
+    unsigned int index = Util::invalidIndex ();
+
+    if (this->freeFaceIndices.empty ())
+    {
+      index = this->numFaces ();
+      this->faceData.emplace_back ();
+      this->faceVisited.add ();
+      this->oppositeHalfEdges.resize (3 * this->faceData.size (), Util::invalidIndex ());
+
+      this->mesh.addIndex (i1);
+      this->mesh.addIndex (i2);
+      this->mesh.addIndex (i3);
+    }
+    else
+    {
+      index = this->freeFaceIndices.back ();
+      this->faceData[index].reset ();
+      this->faceVisited.unvisit (index);
+      this->freeFaceIndices.pop_back ();
+
+      this->mesh.index ((3 * index) + 0, i1);
+      this->mesh.index ((3 * index) + 1, i2);
+      this->mesh.index ((3 * index) + 2, i3);
+    }
+    this->faceData[index].isFree = false;
+
+    this->addAdjacentFace (i1, index);
+    this->addAdjacentFace (i2, index);
+    this->addAdjacentFace (i3, index);
+    this->linkHalfEdges (index);
+
+    return index;
+  }
+
+  void addFaceToOctree (unsigned int i)
+  {
+    if (this->pendingOctree.isPending)
+    {
+      return;
+    }
+    const PrimTriangle tri = this->face (i);
+
+    if (this->octree.hasRoot () == false)
+    {
+      this->octree.setupRoot (tri.center (), tri.maxDimExtent ());
+    }
+
+    this->octree.addElement (i, tri.center (), tri.maxDimExtent ());
+    this->updateFaceRecord (i);
+  }
+
+  void buildOctree () const
+  {
+    std::vector<unsigned int> indices;
+    std::vector<glm::vec3>    positions;
+    std::vector<float>        maxDimExtents;
+
+    indices.reserve (this->numFaces ());
+    positions.reserve (this->numFaces ());
+    maxDimExtents.reserve (this->numFaces ());
+
+    for (unsigned int i = 0; i < this->faceData.size (); i++)
+    {
+      if (this->isFreeFace (i) == false)
+      {
+        const PrimTriangle tri = this->face (i);
+
+        indices.push_back (i);
+        positions.push_back (tri.center ());
+        maxDimExtents.push_back (tri.maxDimExtent ());
+      }
+    }
+    this->octree.build (indices, positions, maxDimExtents);
+    this->octreeShape = OctreeShape (this->octree.statistics ());
+    this->buildFaceRecords ();
+  }
+
+  void buildFaceRecords () const
+  {
+    const std::size_t numBytes = this->faceData.size () * sizeof (TriangleRecord);
+
+    this->faceRecords.clear ();
+    this->hasFaceRecords =
+      this->numFaces () >= this->minFaceRecordFaces && numBytes <= this->maxFaceRecordBytes;
+
+    if (this->hasFaceRecords)
+    {
+      this->faceRecords.resize (this->faceData.size ());
+
+      for (unsigned int i = 0; i < this->faceData.size (); i++)
+      {
+        if (this->isFreeFace (i) == false)
+        {
+          this->faceRecords[i] = this->faceRecord (i);
+        }
+      }
+    }
+    else
+    {
+      this->faceRecords.shrink_to_fit ();
+    }
+  }
+
+  void updateFaceRecord (unsigned int i)
+  {
+    if (this->hasFaceRecords)
+    {
+      if (i >= this->faceRecords.size ())
+      {
+        this->faceRecords.resize (this->faceData.size ());
+      }
+      this->faceRecords[i] = this->faceRecord (i);
+    }
+  }
+
+  void clearFaceRecords ()
+  {
+    this->faceRecords.clear ();
+    this->faceRecords.shrink_to_fit ();
+    this->hasFaceRecords = false;
+  }
+
+  // the octree is built by the first query that needs it, cf. `PendingOctree`
+  void deferOctree ()
+  {
+    this->octree.reset ();
+    this->octreeShape = OctreeShape ();
+    this->pendingOctree.isPending = true;
+    this->clearFaceRecords ();
+  }
+
+  void requireOctree () const
+  {
+    if (this->pendingOctree.isPending)
+    {
+      std::lock_guard<std::mutex> lock (this->pendingOctree.mutex);
+
+      if (this->pendingOctree.isPending)
+      {
+        this->buildOctree ();
+        this->pendingOctree.isPending = false;
+      }
+    }
+  }
+
+  /* Rebuilds the octree if it got considerably deeper or sparser than it was when it was built
+   * the last time, e.g. after a long sculpting session.
+   */
+  bool rebalanceOctree ()
+  {
+    if (this->pendingOctree.isPending)
+    {
+      return false;
+    }
+    const OctreeShape shape (this->octree.statistics ());
+
+    if (shape.isValid == false)
+    {
+      return false;
+    }
+    else if (this->octreeShape.isValid == false)
+    {
+      this->octreeShape = shape;
+      return false;
+    }
+    else
+    {
+      const bool depthSkew =
+        shape.depthRange > this->octreeShape.depthRange + this->octreeMaxDepthIncrease;
+      const bool occupancySkew =
+        shape.occupancy < this->octreeShape.occupancy * this->octreeMinOccupancyRatio;
+
+      if (depthSkew || occupancySkew)
+      {
+        this->buildOctree ();
+        return true;
+      }
+      return false;
+    }
+  }
+
+  void deleteVertex (unsigned int i)
+  {
+    assert (i < this->vertexData.size ());
+    assert (i < this->vertexVisited.size ());
+
+    this->recordVertex (i);
+
+    const DynamicMesh::AdjacentFaces adjacent = this->adjacentFaces (i);
+    const std::vector<unsigned int>  adjacentFaces (adjacent.begin (), adjacent.end ());
+    for (unsigned int f : adjacentFaces)
+    {
+      this->deleteFace (f);
+    }
+    this->vertexData[i].reset ();
+    this->vertexVisited.unvisit (i);
+    this->freeVertexIndices.push_back (i);
+    this->unpairVertex (i);
+    this->freeLayerVertex (i);
+  }
+
+  // a slot that is freed while a layer is recorded is new once it is reused
+  void freeLayerVertex (unsigned int i)
+  {
+    this->layers.resetVertex (i);
+
+    if (this->layerRecorder.isRecording ())
+    {
+      LayerRecorder& r = this->layerRecorder;
+
+      assert (i < r.entries.size () && r.entries[i] != Util::invalidIndex ());
+      r.isNew[r.entries[i]] = 1;
+    }
+  }
+
+  /* Same as deleting each vertex, but the adjacency of each remaining vertex is filtered only
+   * once, and only the deleted vertices and faces are visited.
+   */
+  void deleteVertices (const std::vector<unsigned int>& vertices)
+  {
+    std::vector<unsigned int> sortedVertices (vertices);
+    std::vector<unsigned int> faces;
+    std::vector<unsigned int> remaining;
+
+    std::sort (sortedVertices.begin (), sortedVertices.end ());
+    sortedVertices.erase (std::unique (sortedVertices.begin (), sortedVertices.end ()),
+                          sortedVertices.end ());
+
+    const auto isDeletedVertex = [&sortedVertices](unsigned int i) {
+      return std::binary_search (sortedVertices.begin (), sortedVertices.end (), i);
+    };
+
+    for (unsigned int i : sortedVertices)
+    {
+      for (unsigned int f : this->adjacentFaces (i))
+      {
+        faces.push_back (f);
+      }
+    }
+    std::sort (faces.begin (), faces.end ());
+    faces.erase (std::unique (faces.begin (), faces.end ()), faces.end ());
+
+    if (faces.empty () == false)
+    {
+      this->touch ();
+    }
+
+    for (unsigned int f : faces)
+    {
+      this->recordFace (f);
+      for (unsigned int k = 0; k < 3; k++)
+      {
+        const unsigned int i = this->mesh.index ((3 * f) + k);
+        if (isDeletedVertex (i) == false)
+        {
+          remaining.push_back (i);
+        }
+      }
+      this->unlinkHalfEdges (f);
+    }
+    std::sort (remaining.begin (), remaining.end ());
+    remaining.erase (std::unique (remaining.begin (), remaining.end ()), remaining.end ());
+
+    for (unsigned int i : remaining)
+    {
+      VertexData&         d = this->vertexData[i];
+      unsigned int* const begin = this->adjacency.data () + d.offset;
+      unsigned int* const end = std::remove_if (begin, begin + d.valence, [&faces](unsigned int f) {
+        return std::binary_search (faces.begin (), faces.end (), f);
+      });
+      d.valence = end - begin;
+    }
+
+    for (unsigned int f : faces)
+    {
+      this->faceData[f].reset ();
+      this->faceVisited.unvisit (f);
+      this->freeFaceIndices.push_back (f);
+
+      if (this->pendingOctree.isPending == false)
+      {
+        this->octree.deleteElement (f);
+      }
+    }
+    for (unsigned int i : sortedVertices)
+    {
+      this->recordVertex (i);
+      this->vertexData[i].reset ();
+      this->vertexVisited.unvisit (i);
+      this->freeVertexIndices.push_back (i);
+      this->unpairVertex (i);
+      this->freeLayerVertex (i);
+    }
+  }
+
+  void deleteFace (unsigned int i)
+  {
+    this->touch ();
+    this->recordFace (i);
+    assert (i < this->faceData.size ());
+    assert (i < this->faceVisited.size ());
+
+    this->deleteAdjacentFace (this->mesh.index ((3 * i) + 0), i);
+    this->deleteAdjacentFace (this->mesh.index ((3 * i) + 1), i);
+    this->deleteAdjacentFace (this->mesh.index ((3 * i) + 2), i);
+    this->unlinkHalfEdges (i);
+
+    this->faceData[i].reset ();
+    this->faceVisited.unvisit (i);
+    this->freeFaceIndices.push_back (i);
+
+    if (this->pendingOctree.isPending == false)
+    {
+      this->octree.deleteElement (i);
+    }
+  }
+
+  void vertex (unsigned int i, const glm::vec3& v)
+  {
+    this->touch ();
+    this->recordVertex (i);
+    this->mesh.vertex (i, v);
+
+    // queries may run before the adjacent faces are realigned
+    if (this->hasFaceRecords)
+    {
+      for (unsigned int a : this->adjacentFaces (i))
+      {
+        this->updateFaceRecord (a);
+      }
+    }
+  }
+
+  void vertexNormal (unsigned int i, const glm::vec3& n)
+  {
+    assert (this->isFreeVertex (i) == false);
+    assert (this->mesh.numVertices () == this->vertexData.size ());
+
+    this->recordVertex (i);
+    this->mesh.normal (i, n);
+  }
+
+  void setVertexNormal (unsigned int i)
+  {
+    const glm::vec3 avg = this->averageNormal (i);
+
+    this->recordVertex (i);
+    if (Util::isNaN (avg))
+    {
+      this->mesh.normal (i, glm::vec3 (0.0f));
+    }
+    else
+    {
+      this->mesh.normal (i, avg);
+    }
+  }
+
+  // unnormalized face normal, which is computed only once between calls to `unvisitFaces`
+  const glm::vec3& cachedFaceNormal (unsigned int i)
+  {
+    assert (this->isFreeFace (i) == false);
+
+    if (this->faceVisited.isVisited (i) == false)
+    {
+      unsigned int i1, i2, i3;
+      this->vertexIndices (i, i1, i2, i3);
+
+      this->faceNormalCache[i] = glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
+                                             this->mesh.vertex (i3) - this->mesh.vertex (i1));
+      this->faceVisited.visit (i);
+    }
+    return this->faceNormalCache[i];
+  }
+
+  // same as `setVertexNormal` but takes face normals from `cachedFaceNormal`
+  void setCachedVertexNormal (unsigned int i)
+  {
+    assert (this->isFreeVertex (i) == false);
+
+    glm::vec3 normal = glm::vec3 (0.0f);
+
+    for (unsigned int f : this->adjacentFaces (i))
+    {
+      normal += this->cachedFaceNormal (f);
+    }
+    normal = glm::normalize (normal);
+
+    this->recordVertex (i);
+    this->mesh.normal (i, Util::isNaN (normal) ? glm::vec3 (0.0f) : normal);
+  }
+
+  void setVertexNormals (const DynamicFaces& faces)
+  {
+    const std::vector<unsigned int>& vertices = this->collectVertices (faces);
+
+    this->unvisitFaces ();
+    this->faceNormalCache.resize (this->faceData.size ());
+
+    for (unsigned int i : vertices)
+    {
+      this->setCachedVertexNormal (i);
+    }
+  }
+
+  void setAllNormals ()
+  {
+    this->unvisitFaces ();
+    this->faceNormalCache.resize (this->faceData.size ());
+    this->forEachVertex ([this](unsigned int i) { this->setCachedVertexNormal (i); });
+  }
+
+  void reset ()
+  {
+    this->touch ();
+    this->recordAll ();
+    this->mesh.reset ();
     this->vertexData.clear ();
+    this->adjacency.clear ();
+    this->numUnusedAdjacency = 0;
     this->vertexVisited.clear ();
     this->freeVertexIndices.clear ();
+    this->masks.clear ();
+    this->layers.resetDisplacements ();
     this->faceData.clear ();
+    this->oppositeHalfEdges.clear ();
     this->faceVisited.clear ();
     this->freeFaceIndices.clear ();
     this->octree.reset ();
+    this->pendingOctree.isPending = false;
+    this->clearFaceRecords ();
+    this->resetSymmetry ();
+  }
+
+  // like `fromMesh` but without touching OpenGL, such that it can run on any thread
+  void build (const Mesh& mesh)
+  {
+    this->reset ();
+    this->mesh.reserveVertices (mesh.numVertices ());
+
+    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    {
+      this->addVertex (mesh.vertex (i), mesh.normal (i));
+    }
+
+    assert (mesh.numIndices () % 3 == 0);
+    this->mesh.reserveIndices (mesh.numIndices ());
+
+    std::vector<unsigned int> valences (mesh.numVertices (), 0);
+    for (unsigned int i = 0; i < mesh.numIndices (); i++)
+    {
+      valences[mesh.index (i)]++;
+    }
+    this->allocateAdjacency (valences);
+
+    for (unsigned int i = 0; i < mesh.numIndices (); i += 3)
+    {
+      this->addFaceData (mesh.index (i), mesh.index (i + 1), mesh.index (i + 2));
+    }
+    this->deferOctree ();
+    this->setAllNormals ();
+  }
+
+  /* Restores the adjacency and the octree of a mesh from a cache instead of building them.  The
+   * cache is only checked for the bounds of its indices, since binary files validate it by the
+   * checksum of the mesh.  Returns `false` if it does not match, after which the mesh is reset.
+   */
+  bool restore (const Mesh& mesh, const DynamicMeshCache& cache)
+  {
+    PROFILE_ZONE ("dynamic-mesh/restore")
+    const unsigned int               numVertices = mesh.numVertices ();
+    const unsigned int               numIndices = mesh.numIndices ();
+    const std::vector<unsigned int>& offsets = cache.adjacencyOffsets;
+
+    if (numIndices % 3 != 0 || offsets.size () != numVertices + 1 || offsets.front () != 0 ||
+        offsets.back () != numIndices || cache.adjacentFaces.size () != numIndices ||
+        cache.oppositeHalfEdges.size () != numIndices)
+    {
+      return false;
+    }
+    for (unsigned int i = 0; i < numVertices; i++)
+    {
+      if (offsets[i] > offsets[i + 1])
+      {
+        return false;
+      }
+    }
+    for (unsigned int i = 0; i < numIndices; i++)
+    {
+      const unsigned int opposite = cache.oppositeHalfEdges[i];
+
+      if (mesh.index (i) >= numVertices || cache.adjacentFaces[i] >= numIndices / 3 ||
+          (opposite != Util::invalidIndex () && opposite >= numIndices))
+      {
+        return false;
+      }
+    }
+
+    this->reset ();
+
+    if (this->octree.fromNodes (cache.octree, numIndices / 3) == false)
+    {
+      return false;
+    }
+    this->mesh = mesh;
+    this->vertexData.resize (numVertices);
+    this->vertexVisited.resize (numVertices);
+    this->adjacency.resize (numIndices + (numVertices * Impl::adjacencySlack));
+
+    for (unsigned int i = 0; i < numVertices; i++)
+    {
+      VertexData& d = this->vertexData[i];
+
+      d.isFree = false;
+      d.offset = offsets[i] + (i * Impl::adjacencySlack);
+      d.valence = offsets[i + 1] - offsets[i];
+      d.capacity = d.valence + Impl::adjacencySlack;
+      std::copy (cache.adjacentFaces.begin () + offsets[i],
+                 cache.adjacentFaces.begin () + offsets[i + 1],
+                 this->adjacency.begin () + d.offset);
+    }
+
+    this->faceData.resize (numIndices / 3);
+    this->faceVisited.resize (numIndices / 3);
+    for (FaceData& d : this->faceData)
+    {
+      d.isFree = false;
+    }
+    this->oppositeHalfEdges = cache.oppositeHalfEdges;
+    this->octreeShape = OctreeShape (this->octree.statistics ());
+    this->buildFaceRecords ();
+    this->setAllNormals ();
+    return true;
+  }
+
+  // requires the mesh to be pruned
+  void cache (DynamicMeshCache& cache) const
+  {
+    PROFILE_ZONE ("dynamic-mesh/cache")
+    assert (this->freeVertexIndices.empty ());
+    assert (this->freeFaceIndices.empty ());
+
+    this->requireOctree ();
+
+    cache.adjacencyOffsets.resize (this->vertexData.size () + 1);
+    cache.adjacentFaces.clear ();
+    cache.adjacentFaces.reserve (this->mesh.numIndices ());
+
+    for (unsigned int i = 0; i < this->vertexData.size (); i++)
+    {
+      const VertexData& d = this->vertexData[i];
+
+      cache.adjacencyOffsets[i] = cache.adjacentFaces.size ();
+      cache.adjacentFaces.insert (cache.adjacentFaces.end (), this->adjacency.begin () + d.offset,
+                                  this->adjacency.begin () + d.offset + d.valence);
+    }
+    cache.adjacencyOffsets.back () = cache.adjacentFaces.size ();
+    cache.oppositeHalfEdges = this->oppositeHalfEdges;
+    this->octree.toNodes (cache.octree);
+  }
+
+  void fromMesh (const Mesh& mesh)
+  {
+    this->build (mesh);
+    this->mesh.bufferData ();
+  }
+
+  void optimizeLayout ()
+  {
+    this->prune (nullptr, nullptr);
+    this->build (MeshUtil::optimizeLayout (this->mesh));
+  }
+
+  void realignFace (unsigned int i)
+  {
+    assert (this->isFreeFace (i) == false);
+
+    if (this->pendingOctree.isPending == false)
+    {
+      const PrimTriangle tri = this->face (i);
+
+      this->octree.realignElement (i, tri.center (), tri.maxDimExtent ());
+      this->updateFaceRecord (i);
+    }
+  }
+
+  // realigns the faces that are enumerated by `forEach` in one batch
+  template <typename F> void realignFacesBy (const F& forEach)
+  {
+    if (this->pendingOctree.isPending)
+    {
+      return;
+    }
+    std::vector<unsigned int>& indices = this->realignIndices;
+    std::vector<glm::vec3>&    positions = this->realignPositions;
+    std::vector<float>&        maxDimExtents = this->realignMaxDimExtents;
+
+    indices.clear ();
+    positions.clear ();
+    maxDimExtents.clear ();
+
+    forEach ([this, &indices, &positions, &maxDimExtents](unsigned int i) {
+      assert (this->isFreeFace (i) == false);
+
+      const PrimTriangle tri = this->face (i);
+
+      indices.push_back (i);
+      positions.push_back (tri.center ());
+      maxDimExtents.push_back (tri.maxDimExtent ());
+      this->updateFaceRecord (i);
+    });
+    this->octree.realignElements (indices, positions, maxDimExtents);
+  }
+
+  void realignFaces (const DynamicFaces& faces)
+  {
+    this->realignFacesBy ([&faces](const auto& f) {
+      for (unsigned int i : faces)
+      {
+        f (i);
+      }
+    });
+  }
+
+  void realignAllFaces ()
+  {
+    this->realignFacesBy ([this](const auto& f) { this->forEachFace (f); });
+  }
+
+  void sanitize ()
+  {
+    if (this->pendingOctree.isPending == false)
+    {
+      this->octree.deleteEmptyChildren ();
+      this->octree.shrinkRoot ();
+    }
+  }
+
+  void moveFace (unsigned int from, unsigned int to)
+  {
+    assert (this->isFreeFace (from) == false);
+    assert (this->isFreeFace (to));
+
+    this->recordFace (from);
+    this->recordFace (to);
+
+    for (unsigned int k = 0; k < 3; k++)
+    {
+      const unsigned int v = this->mesh.index ((3 * from) + k);
+      VertexData&        d = this->vertexData[v];
+      unsigned int*      begin = this->adjacency.data () + d.offset;
+
+      *std::find (begin, begin + d.valence, from) = to;
+      this->mesh.index ((3 * to) + k, v);
+    }
+    for (unsigned int k = 0; k < 3; k++)
+    {
+      const unsigned int opposite = this->oppositeHalfEdges[(3 * from) + k];
+
+      this->oppositeHalfEdges[(3 * to) + k] = opposite;
+      this->oppositeHalfEdges[(3 * from) + k] = Util::invalidIndex ();
+
+      if (opposite != Util::invalidIndex ())
+      {
+        this->oppositeHalfEdges[opposite] = (3 * to) + k;
+      }
+    }
+    this->faceData[to] = this->faceData[from];
+    this->faceData[from].reset ();
+    this->faceVisited.copy (from, to);
+
+    if (this->pendingOctree.isPending == false)
+    {
+      this->octree.moveElement (from, to);
+    }
+    if (this->hasFaceRecords && from < this->faceRecords.size ())
+    {
+      this->faceRecords[to] = this->faceRecords[from];
+    }
+  }
+
+  void moveVertex (unsigned int from, unsigned int to)
+  {
+    assert (this->isFreeVertex (from) == false);
+    assert (this->isFreeVertex (to));
+
+    this->recordVertex (from);
+    this->recordVertex (to);
+
+    for (unsigned int f : this->adjacentFaces (from))
+    {
+      this->recordFace (f);
+
+      for (unsigned int k = 0; k < 3; k++)
+      {
+        if (this->mesh.index ((3 * f) + k) == from)
+        {
+          this->mesh.index ((3 * f) + k, to);
+        }
+      }
+    }
+    this->numUnusedAdjacency += this->vertexData[to].capacity;
+    this->vertexData[to] = this->vertexData[from];
+    this->vertexData[from].reset ();
+    this->vertexData[from].capacity = 0;
+    this->vertexVisited.copy (from, to);
+
+    this->mesh.vertex (to, this->mesh.vertex (from));
+    this->mesh.normal (to, this->mesh.normal (from));
+    this->setMask (to, from < this->masks.size () ? this->masks[from] : 0.0f);
+    this->layers.moveVertex (from, to);
+
+    const unsigned int symmetric = this->symmetricVertex (from);
+    if (symmetric != Util::invalidIndex ())
+    {
+      this->unpairVertex (from);
+      this->pairVertices (to, symmetric == from ? to : symmetric);
+    }
+  }
+
+  /* Moves the last used vertices and faces into free slots and drops the remaining slots, so
+   * that its cost depends on the number of free slots rather than on the size of the mesh.  Only
+   * moved elements are written to the buffers of the mesh.  Index maps are only computed if
+   * requested.
+   */
+  void prune (std::vector<unsigned int>* pVertexIndexMap, std::vector<unsigned int>* pFaceIndexMap)
+  {
+    if (this->isPruned () == false)
+    {
+      const unsigned int oldNumVertices = this->numVertexSlots ();
+      const unsigned int oldNumFaces = this->numFaceSlots ();
+      const unsigned int newNumVertices = this->numVertices ();
+      const unsigned int newNumFaces = this->numFaces ();
+
+      const std::vector<PruneMove> vertexMoves =
+        pruneMoves (this->vertexData, this->freeVertexIndices);
+      const std::vector<PruneMove> faceMoves = pruneMoves (this->faceData, this->freeFaceIndices);
+
+      this->touch ();
+
+      if (pVertexIndexMap)
+      {
+        pruneIndexMap (oldNumVertices, this->freeVertexIndices, vertexMoves, *pVertexIndexMap);
+      }
+      if (pFaceIndexMap)
+      {
+        pruneIndexMap (oldNumFaces, this->freeFaceIndices, faceMoves, *pFaceIndexMap);
+      }
+
+      // faces are moved first, such that moved vertices update the indices of moved faces
+      for (const PruneMove& m : faceMoves)
+      {
+        this->moveFace (m.first, m.second);
+      }
+      for (const PruneMove& m : vertexMoves)
+      {
+        this->moveVertex (m.first, m.second);
+      }
+
+      for (unsigned int i = newNumVertices; i < oldNumVertices; i++)
+      {
+        assert (this->isFreeVertex (i));
+
+        this->recordVertex (i);
+        this->numUnusedAdjacency += this->vertexData[i].capacity;
+      }
+      for (unsigned int i = newNumFaces; i < oldNumFaces; i++)
+      {
+        assert (this->isFreeFace (i));
+
+        this->recordFace (i);
+      }
+      // logged indices refer to slots before the renumbering
+      this->journal.logEverything ();
+
+      this->freeVertexIndices.clear ();
+      this->vertexData.resize (newNumVertices);
+      this->mesh.shrinkVertices (newNumVertices);
+      this->vertexVisited.resize (newNumVertices);
+      if (this->masks.size () > newNumVertices)
+      {
+        this->masks.resize (newNumVertices);
+      }
+      if (this->symmetricVertices.size () > newNumVertices)
+      {
+        this->symmetricVertices.resize (newNumVertices);
+      }
+      assert (this->numVertices () == newNumVertices);
+
+      this->freeFaceIndices.clear ();
+      this->faceData.resize (newNumFaces);
+      this->mesh.shrinkIndices (3 * newNumFaces);
+      this->oppositeHalfEdges.resize (3 * newNumFaces);
+      this->faceVisited.resize (newNumFaces);
+      assert (this->numFaces () == newNumFaces);
+
+      if (this->hasFaceRecords && this->faceRecords.size () > newNumFaces)
+      {
+        this->faceRecords.resize (newNumFaces);
+      }
+    }
+  }
+
+  bool pruneAndCheckConsistency (std::vector<unsigned int>* pVertexIndexMap,
+                                 std::vector<unsigned int>* pFaceIndexMap)
+  {
+    this->prune (pVertexIndexMap, pFaceIndexMap);
+    this->bufferData ();
+
+    if (MeshUtil::checkConsistency (this->mesh))
+    {
+      for (unsigned int i = 0; i < this->vertexData.size (); i++)
+      {
+        if (this->vertexData[i].isFree == false)
+        {
+          if (this->vertexData[i].valence == 0)
+          {
+            DILAY_WARN ("vertex %u is not free but has no adjacent faces", i);
+            return false;
+          }
+        }
+      }
+      for (unsigned int h = 0; h < this->oppositeHalfEdges.size (); h++)
+      {
+        const unsigned int opposite = this->oppositeHalfEdges[h];
+
+        if (opposite == Util::invalidIndex () || this->oppositeHalfEdges[opposite] != h ||
+            this->halfEdgeSource (opposite) != this->halfEdgeTarget (h))
+        {
+          DILAY_WARN ("half-edge %u has no consistent opposite half-edge", h);
+          return false;
+        }
+      }
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  /* Checks the faces that share a vertex with the given faces like `pruneAndCheckConsistency`,
+   * without visiting the rest of the mesh.  Each edge of a checked face must be shared by exactly
+   * two faces with opposite half-edges.
+   */
+  bool checkConsistency (const DynamicFaces& faces) const
+  {
+    std::vector<unsigned int> vertices;
+
+    for (unsigned int f : faces)
+    {
+      if (f >= this->numFaceSlots () || this->isFreeFace (f))
+      {
+        DILAY_WARN ("face %u is free", f);
+        return false;
+      }
+      unsigned int i1, i2, i3;
+      this->vertexIndices (f, i1, i2, i3);
+      vertices.push_back (i1);
+      vertices.push_back (i2);
+      vertices.push_back (i3);
+    }
+    std::sort (vertices.begin (), vertices.end ());
+    vertices.erase (std::unique (vertices.begin (), vertices.end ()), vertices.end ());
+
+    const auto numSharingFaces = [this](unsigned int i1, unsigned int i2) {
+      unsigned int n = 0;
+      for (unsigned int f : this->adjacentFaces (i1))
+      {
+        unsigned int j1, j2, j3;
+        this->vertexIndices (f, j1, j2, j3);
+        n += (j1 == i2 || j2 == i2 || j3 == i2) ? 1 : 0;
+      }
+      return n;
+    };
+
+    for (unsigned int v : vertices)
+    {
+      if (v >= this->numVertexSlots () || this->isFreeVertex (v))
+      {
+        DILAY_WARN ("vertex %u is free", v);
+        return false;
+      }
+      else if (this->vertexData[v].valence < 3)
+      {
+        DILAY_WARN ("inconsistent vertex %u with %u adjacent faces", v,
+                    this->vertexData[v].valence);
+        return false;
+      }
+
+      for (unsigned int f : this->adjacentFaces (v))
+      {
+        unsigned int i1, i2, i3;
+        this->vertexIndices (f, i1, i2, i3);
+
+        if (i1 == i2 || i1 == i3 || i2 == i3)
+        {
+          DILAY_WARN ("inconsistent face %u with vertices (%u,%u,%u)", f, i1, i2, i3);
+          return false;
+        }
+        for (unsigned int h = 3 * f; h < (3 * f) + 3; h++)
+        {
+          const unsigned int opposite = this->oppositeHalfEdges[h];
+
+          if (opposite == Util::invalidIndex () || this->oppositeHalfEdges[opposite] != h ||
+              this->halfEdgeSource (opposite) != this->halfEdgeTarget (h))
+          {
+            DILAY_WARN ("half-edge %u has no consistent opposite half-edge", h);
+            return false;
+          }
+          else if (numSharingFaces (this->halfEdgeSource (h), this->halfEdgeTarget (h)) != 2)
+          {
+            DILAY_WARN ("inconsistent edge (%u,%u)", this->halfEdgeSource (h),
+                        this->halfEdgeTarget (h));
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  unsigned int symmetricVertex (unsigned int i) const
+  {
+    return i < this->symmetricVertices.size () ? this->symmetricVertices[i]
+                                               : Util::invalidIndex ();
+  }
+
+  void pairVertices (unsigned int i, unsigned int j)
+  {
+    if (this->symmetricVertices.size () <= glm::max (i, j))
+    {
+      this->symmetricVertices.resize (glm::max (i, j) + 1, Util::invalidIndex ());
+    }
+    this->symmetricVertices[i] = j;
+    this->symmetricVertices[j] = i;
+  }
+
+  void unpairVertex (unsigned int i)
+  {
+    const unsigned int symmetric = this->symmetricVertex (i);
+
+    if (symmetric != Util::invalidIndex ())
+    {
+      this->symmetricVertices[symmetric] = Util::invalidIndex ();
+      this->symmetricVertices[i] = Util::invalidIndex ();
+    }
+  }
+
+  bool hasSymmetry () const { return this->symmetryNormal != glm::vec3 (0.0f); }
+
+  bool hasSymmetry (const PrimPlane& plane) const
+  {
+    return this->hasSymmetry () &&
+           glm::abs (glm::dot (plane.normal (), this->symmetryNormal)) >= 1.0f - Util::epsilon () &&
+           plane.absDistance (this->symmetryPoint) <= Util::epsilon ();
+  }
+
+  void resetSymmetry ()
+  {
+    this->symmetricVertices.clear ();
+    this->symmetryPoint = glm::vec3 (0.0f);
+    this->symmetryNormal = glm::vec3 (0.0f);
+  }
+
+  /* Pairs the third vertex of each face whose other two vertices are paired with the third vertex
+   * of the face that is reflected at their edge, if its position is close to the reflection.  Faces
+   * of newly paired vertices are visited as well if they belong to the domain.
+   */
+  template <typename F>
+  void matchSymmetricVertices (std::vector<unsigned int>& stack, const F& isDomain)
+  {
+    const PrimPlane plane (this->symmetryPoint, this->symmetryNormal);
+
+    while (stack.empty () == false)
+    {
+      const unsigned int f = stack.back ();
+      stack.pop_back ();
+
+      for (unsigned int h = 3 * f; h < (3 * f) + 3; h++)
+      {
+        const unsigned int s = this->symmetricVertex (this->halfEdgeSource (h));
+        const unsigned int t = this->symmetricVertex (this->halfEdgeTarget (h));
+        const unsigned int n = this->halfEdgeTarget (this->nextHalfEdge (h));
+
+        if (s == Util::invalidIndex () || t == Util::invalidIndex () ||
+            this->symmetricVertex (n) != Util::invalidIndex ())
+        {
+          continue;
+        }
+
+        const unsigned int m = this->halfEdge (t, s);
+        if (m != Util::invalidIndex ())
+        {
+          const unsigned int c = this->halfEdgeTarget (this->nextHalfEdge (m));
+          const float        maxDistanceSqr =
+            0.0625f * glm::distance2 (this->mesh.vertex (s), this->mesh.vertex (t));
+
+          if ((c == n || this->symmetricVertex (c) == Util::invalidIndex ()) &&
+              glm::distance2 (plane.mirror (this->mesh.vertex (n)), this->mesh.vertex (c)) <=
+                maxDistanceSqr)
+          {
+            this->pairVertices (n, c);
+
+            for (unsigned int a : this->adjacentFaces (n))
+            {
+              if (a != f && isDomain (a))
+              {
+                stack.push_back (a);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // pairs vertices in the plane with themselves and matches the remaining vertices from there
+  void establishSymmetry (const PrimPlane& plane)
+  {
+    std::vector<unsigned int> stack;
+
+    this->resetSymmetry ();
+    this->symmetryPoint = plane.point ();
+    this->symmetryNormal = plane.normal ();
+
+    this->forEachVertex ([this, &plane](unsigned int i) {
+      if (plane.absDistance (this->mesh.vertex (i)) <= Util::epsilon () * 0.5f)
+      {
+        this->pairVertices (i, i);
+      }
+    });
+    this->forEachFace ([&stack](unsigned int f) { stack.push_back (f); });
+    this->matchSymmetricVertices (stack, [](unsigned int) { return true; });
   }
 
-  void fromMesh (const Mesh& mesh)
+  /* The reflected faces of the given faces are only collected if no vertex of the given faces is
+   * reflected to a vertex of the given faces, such that both halves can be modified separately.
+   */
+  bool symmetricFaces (const DynamicFaces& faces, DynamicFaces& mirrored)
   {
-    this->reset ();
-    this->mesh.reserveVertices (mesh.numVertices ());
+    mirrored.reset ();
 
-    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    if (this->hasSymmetry () == false)
     {
-      this->addVertex (mesh.vertex (i), mesh.normal (i));
+      return false;
     }
 
-    assert (mesh.numIndices () % 3 == 0);
-    this->mesh.reserveIndices (mesh.numIndices ());
+    std::vector<unsigned int> stack (faces.begin (), faces.end ());
+    this->matchSymmetricVertices (stack, [&faces](unsigned int f) { return faces.contains (f); });
 
-    for (unsigned int i = 0; i < mesh.numIndices (); i += 3)
+    if (this->dropAsymmetricPairs (faces))
     {
-      this->addFace (mesh.index (i), mesh.index (i + 1), mesh.index (i + 2));
+      return false;
     }
-    this->setAllNormals ();
-    this->mesh.bufferData ();
-  }
 
-  void realignFace (unsigned int i)
-  {
-    assert (this->isFreeFace (i) == false);
+    for (unsigned int f : faces)
+    {
+      unsigned int i1, i2, i3;
+      this->vertexIndices (f, i1, i2, i3);
 
-    const PrimTriangle tri = this->face (i);
+      const unsigned int s1 = this->symmetricVertex (i1);
+      const unsigned int s2 = this->symmetricVertex (i2);
+      const unsigned int s3 = this->symmetricVertex (i3);
 
-    this->octree.realignElement (i, tri.center (), tri.maxDimExtent ());
-  }
+      if (s1 == Util::invalidIndex () || s2 == Util::invalidIndex () ||
+          s3 == Util::invalidIndex () || s1 == i1 || s2 == i2 || s3 == i3)
+      {
+        mirrored.reset ();
+        return false;
+      }
 
-  void realignFaces (const DynamicFaces& faces)
-  {
-    for (unsigned int i : faces)
+      const unsigned int m = this->halfEdge (s2, s1);
+      if (m == Util::invalidIndex () || this->halfEdgeTarget (this->nextHalfEdge (m)) != s3)
+      {
+        mirrored.reset ();
+        return false;
+      }
+      mirrored.insert (this->halfEdgeFace (m));
+    }
+    mirrored.commit ();
+
+    for (unsigned int i : this->collectVertices (faces))
     {
-      this->realignFace (i);
+      if (this->vertexVisited.isVisited (this->symmetricVertex (i)))
+      {
+        mirrored.reset ();
+        return false;
+      }
     }
+    return true;
   }
 
-  void realignAllFaces ()
+  /* Unpairs the vertices of the given faces that are no longer reflections of their paired
+   * vertices, e.g. after one half has been sculpted without mirroring.  Returns whether any pair
+   * has been dropped.
+   */
+  bool dropAsymmetricPairs (const DynamicFaces& faces)
   {
-    this->forEachFace ([this](unsigned int i) { this->realignFace (i); });
+    const PrimPlane plane (this->symmetryPoint, this->symmetryNormal);
+    const float     maxDistanceSqr = Util::epsilon () * Util::epsilon ();
+    bool            hasDropped = false;
+
+    for (unsigned int i : this->collectVertices (faces))
+    {
+      const unsigned int s = this->symmetricVertex (i);
+
+      if (s != Util::invalidIndex () &&
+          glm::distance2 (plane.mirror (this->mesh.vertex (i)), this->mesh.vertex (s)) >
+            maxDistanceSqr)
+      {
+        this->unpairVertex (i);
+        hasDropped = true;
+      }
+    }
+    return hasDropped;
   }
 
-  void sanitize ()
+  /* Mirrors the positive half like `MeshUtil::mirror`, but keeps its data and octree: the negative
+   * half is deleted and mirrored vertices and faces are added to the freed slots.  Vertices in the
+   * plane that connect both halves are shared by the mirrored faces.  Returns false if there is
+   * no positive half, or if a face crosses the plane, in which case nothing has been changed.
+   */
+  void mirrorLayerVertex (unsigned int from, unsigned int to, const PrimPlane& plane)
   {
-    this->octree.deleteEmptyChildren ();
-    this->octree.shrinkRoot ();
+    this->layers.forEachDisplacement (from, [this, to, &plane](unsigned int l, const glm::vec3& d) {
+      this->layers.displacement (l, to, plane.mirrorDirection (d));
+    });
   }
 
-  void prune (std::vector<unsigned int>* pVertexIndexMap, std::vector<unsigned int>* pFaceIndexMap)
+  bool mirrorInPlace (const PrimPlane& plane)
   {
-    if (this->isPruned () == false)
+    enum class Side
     {
-      std::vector<unsigned int> defaultVertexIndexMap;
-      std::vector<unsigned int> defaultFaceIndexMap;
+      Negative,
+      Border,
+      Positive
+    };
+    constexpr unsigned char connectsNegative = 1;
+    constexpr unsigned char connectsPositive = 2;
+
+    const float                eps = Util::epsilon () * 0.5f;
+    std::vector<Side>          sides (this->numVertexSlots (), Side::Negative);
+    std::vector<unsigned char> connects (this->numVertexSlots (), 0);
+    bool                       hasPositive = false;
+    bool                       isCrossed = false;
+
+    this->forEachVertex ([this, &plane, eps, &sides, &hasPositive](unsigned int i) {
+      const float d = plane.distance (this->mesh.vertex (i));
 
-      if (pVertexIndexMap == nullptr)
+      sides[i] = d < -eps ? Side::Negative : (d > eps ? Side::Positive : Side::Border);
+      hasPositive = hasPositive || sides[i] == Side::Positive;
+    });
+
+    this->forEachFace ([this, &sides, &connects, &isCrossed](unsigned int f) {
+      unsigned char faceConnects = 0;
+      for (unsigned int k = 0; k < 3; k++)
       {
-        pVertexIndexMap = &defaultVertexIndexMap;
+        const Side s = sides[this->mesh.index ((3 * f) + k)];
+
+        faceConnects |= s == Side::Negative ? connectsNegative : 0;
+        faceConnects |= s == Side::Positive ? connectsPositive : 0;
       }
-      if (pFaceIndexMap == nullptr)
+      isCrossed = isCrossed || faceConnects == (connectsNegative | connectsPositive);
+
+      for (unsigned int k = 0; k < 3; k++)
       {
-        pFaceIndexMap = &defaultFaceIndexMap;
+        connects[this->mesh.index ((3 * f) + k)] |= faceConnects;
       }
+    });
 
-      Util::prune<VertexData> (this->vertexData, [](const VertexData& d) { return d.isFree; },
-                               pVertexIndexMap);
-      Util::prune<FaceData> (this->faceData, [](const FaceData& d) { return d.isFree; },
-                             pFaceIndexMap);
+    if (hasPositive == false || isCrossed)
+    {
+      return false;
+    }
 
-      const unsigned int newNumVertices = this->vertexData.size ();
-      const unsigned int newNumFaces = this->faceData.size ();
+    std::vector<unsigned int> deleted;
+    std::vector<unsigned int> kept;
 
-      for (VertexData& d : this->vertexData)
+    for (unsigned int i = 0; i < sides.size (); i++)
+    {
+      if (this->isFreeVertex (i) == false)
       {
-        for (unsigned int& f : d.adjacentFaces)
+        if (sides[i] == Side::Border && connects[i] == 0)
         {
-          assert (pFaceIndexMap->at (f) != Util::invalidIndex ());
-
-          f = pFaceIndexMap->at (f);
+          return false;
         }
-      }
-
-      for (unsigned int i = 0; i < pVertexIndexMap->size (); i++)
-      {
-        const unsigned int newV = pVertexIndexMap->at (i);
-        if (newV != Util::invalidIndex ())
+        else if (sides[i] == Side::Negative || (connects[i] & connectsPositive) == 0)
         {
-          this->mesh.vertex (newV, this->mesh.vertex (i));
-          this->mesh.normal (newV, this->mesh.normal (i));
+          deleted.push_back (i);
         }
         else
         {
-          // Expensive (!) in debug builds
-          assert (std::find (this->freeVertexIndices.begin (), this->freeVertexIndices.end (), i) !=
-                  this->freeVertexIndices.end ());
+          kept.push_back (i);
         }
       }
-      this->freeVertexIndices.clear ();
-      this->mesh.shrinkVertices (newNumVertices);
-      this->vertexVisited.resize (newNumVertices);
-      assert (this->numVertices () == newNumVertices);
+    }
+    this->deleteVertices (deleted);
 
-      for (unsigned int i = 0; i < pFaceIndexMap->size (); i++)
-      {
-        const unsigned int newF = pFaceIndexMap->at (i);
-        if (newF != Util::invalidIndex ())
-        {
-          const unsigned int oldI1 = this->mesh.index ((3 * i) + 0);
-          const unsigned int oldI2 = this->mesh.index ((3 * i) + 1);
-          const unsigned int oldI3 = this->mesh.index ((3 * i) + 2);
+    std::vector<unsigned int> faces;
+    std::vector<unsigned int> mirrored (sides.size (), Util::invalidIndex ());
 
-          assert (pVertexIndexMap->at (oldI1) != Util::invalidIndex ());
-          assert (pVertexIndexMap->at (oldI2) != Util::invalidIndex ());
-          assert (pVertexIndexMap->at (oldI3) != Util::invalidIndex ());
+    this->forEachFace ([&faces](unsigned int f) { faces.push_back (f); });
 
-          this->mesh.index ((3 * newF) + 0, pVertexIndexMap->at (oldI1));
-          this->mesh.index ((3 * newF) + 1, pVertexIndexMap->at (oldI2));
-          this->mesh.index ((3 * newF) + 2, pVertexIndexMap->at (oldI3));
-        }
-        else
-        {
-          // Expensive (!) in debug builds
-          assert (std::find (this->freeFaceIndices.begin (), this->freeFaceIndices.end (), i) !=
-                  this->freeFaceIndices.end ());
-        }
+    for (unsigned int i : kept)
+    {
+      const glm::vec3 position = this->mesh.vertex (i);
+      const glm::vec3 normal = plane.mirrorDirection (this->mesh.normal (i));
+
+      if (sides[i] == Side::Positive)
+      {
+        mirrored[i] = this->addVertex (plane.mirror (position), normal);
+        this->setMask (mirrored[i], this->mask (i));
+        this->mirrorLayerVertex (i, mirrored[i], plane);
       }
-      this->freeFaceIndices.clear ();
-      this->mesh.shrinkIndices (3 * newNumFaces);
-      this->faceVisited.resize (newNumFaces);
-      assert (this->numFaces () == newNumFaces);
+      else if (connects[i] == connectsPositive)
+      {
+        mirrored[i] = this->addVertex (position, normal);
+        this->setMask (mirrored[i], this->mask (i));
+        this->mirrorLayerVertex (i, mirrored[i], plane);
+      }
+      else
+      {
+        mirrored[i] = i;
+      }
+    }
 
-      this->octree.updateIndices (*pFaceIndexMap);
+    for (unsigned int f : faces)
+    {
+      unsigned int i1, i2, i3;
+      this->vertexIndices (f, i1, i2, i3);
+      this->addFace (mirrored[i3], mirrored[i2], mirrored[i1]);
     }
-  }
 
-  bool pruneAndCheckConsistency (std::vector<unsigned int>* pVertexIndexMap,
-                                 std::vector<unsigned int>* pFaceIndexMap)
-  {
-    this->prune (pVertexIndexMap, pFaceIndexMap);
-    this->bufferData ();
+    this->resetSymmetry ();
+    this->symmetryPoint = plane.point ();
+    this->symmetryNormal = plane.normal ();
 
-    if (MeshUtil::checkConsistency (this->mesh))
+    for (unsigned int i : kept)
     {
-      for (unsigned int i = 0; i < this->vertexData.size (); i++)
+      if (mirrored[i] == i)
       {
-        if (this->vertexData[i].isFree == false)
-        {
-          if (this->vertexData[i].adjacentFaces.empty ())
-          {
-            DILAY_WARN ("vertex %u is not free but has no adjacent faces", i);
-            return false;
-          }
-        }
+        this->setVertexNormal (i);
       }
-      return true;
-    }
-    else
-    {
-      return false;
+      this->pairVertices (i, mirrored[i]);
     }
+    this->prune (nullptr, nullptr);
+    return true;
   }
 
   bool mirror (const PrimPlane& plane)
@@ -818,6 +3260,12 @@ struct DynamicMesh::Impl
 
     this->prune (nullptr, nullptr);
 
+    if (this->mirrorInPlace (plane))
+    {
+      assert (this->pruneAndCheckConsistency (nullptr, nullptr));
+      return true;
+    }
+
     Mesh mirrored = MeshUtil::mirror (this->mesh, plane);
     if (mirrored.numVertices () == 0)
     {
@@ -827,6 +3275,7 @@ struct DynamicMesh::Impl
     else
     {
       this->fromMesh (mirrored);
+      this->establishSymmetry (plane);
       assert (this->pruneAndCheckConsistency (nullptr, nullptr));
       return true;
     }
@@ -834,6 +3283,9 @@ struct DynamicMesh::Impl
 
   void bufferData ()
   {
+    PROFILE_ZONE ("render/buffer-upload")
+    LatencyTimer timer (LatencyStage::BufferUpload);
+
     const auto findNonFreeFaceIndex = [this]() -> unsigned int {
       assert (this->numFaces () > 0);
 
@@ -859,57 +3311,245 @@ struct DynamicMesh::Impl
       }
     }
     this->mesh.bufferData ();
+    this->updateMaskedRanges ();
+  }
+
+  // faces are masked if the average mask of their vertices is at least one half
+  void updateMaskedRanges ()
+  {
+    this->maskedRangeFirsts.clear ();
+    this->maskedRangeCounts.clear ();
+
+    if (this->hasMask ())
+    {
+      for (unsigned int f = 0; f < this->numFaceSlots (); f++)
+      {
+        if (this->isFreeFace (f) == false)
+        {
+          unsigned int i1, i2, i3;
+          this->vertexIndices (f, i1, i2, i3);
+
+          if (this->mask (i1) + this->mask (i2) + this->mask (i3) >= 1.5f)
+          {
+            if (this->maskedRangeFirsts.empty () ||
+                this->maskedRangeFirsts.back () + this->maskedRangeCounts.back () != 3 * f)
+            {
+              this->maskedRangeFirsts.push_back (3 * f);
+              this->maskedRangeCounts.push_back (0);
+            }
+            this->maskedRangeCounts.back () += 3;
+          }
+        }
+      }
+    }
   }
 
   void render (Camera& camera) const
   {
-    this->mesh.render (camera);
-#ifdef DILAY_RENDER_OCTREE
-    this->octree.render (camera);
-#endif
+    if (this->numFaces () < this->minCulledFaces || this->pendingOctree.isPending)
+    {
+      this->mesh.render (camera);
+    }
+    else
+    {
+      this->renderVisible (camera);
+    }
+    if (this->maskedRangeFirsts.empty () == false)
+    {
+      this->mesh.renderRanges (camera, this->maskedRangeFirsts, this->maskedRangeCounts,
+                               Color (this->mesh.color (), 0.5f));
+    }
   }
 
-  bool intersects (const PrimRay& ray, Intersection& intersection, bool bothSides) const
+  void renderOctree (Camera& camera, DynamicOctreeOverlay overlay)
   {
-    this->octree.intersects (ray, [this, &ray, &intersection, bothSides](unsigned int i) -> float {
-      const PrimTriangle tri = this->face (i);
-      float              t;
+    this->octree.countVisits (overlay == DynamicOctreeOverlay::Visits);
+
+    if (overlay != DynamicOctreeOverlay::None)
+    {
+      this->requireOctree ();
+      this->octree.render (camera, overlay);
+    }
+  }
+
+  /* The octree's nodes are the chunks that are culled against the view frustum.  Faces of visible
+   * nodes are drawn in ranges of consecutive face indices, which may include small gaps of
+   * invisible faces to keep the number of ranges low.
+   */
+  void renderVisible (Camera& camera) const
+  {
+    static constexpr unsigned int maxRangeGap = 64;
+
+    const glm::mat4x4 model = this->mesh.modelMatrix ();
+    bool              isInside;
+
+    this->visibleRangeFirsts.clear ();
+    this->visibleRangeCounts.clear ();
+
+    if (camera.isVisible (this->octree.bounds (), model, &isInside) == false)
+    {
+      this->mesh.renderRanges (camera, this->visibleRangeFirsts, this->visibleRangeCounts);
+    }
+    else if (isInside)
+    {
+      this->mesh.render (camera);
+    }
+    else
+    {
+      this->visibleFaces.resize (this->faceData.size (), 0);
+      this->octree.visibleElements (camera, model, [this](const std::vector<unsigned int>& faces) {
+        for (unsigned int i : faces)
+        {
+          this->visibleFaces[i] = 1;
+        }
+      });
+
+      unsigned int end = 0;
+      for (unsigned int i = 0; i < this->visibleFaces.size (); i++)
+      {
+        if (this->visibleFaces[i])
+        {
+          this->visibleFaces[i] = 0;
 
-      if (IntersectionUtil::intersects (ray, tri, bothSides, &t))
+          if (this->visibleRangeFirsts.empty () || i > end + maxRangeGap)
+          {
+            this->visibleRangeFirsts.push_back (3 * i);
+            this->visibleRangeCounts.push_back (0);
+          }
+          end = i + 1;
+          this->visibleRangeCounts.back () = (3 * end) - this->visibleRangeFirsts.back ();
+        }
+      }
+      this->mesh.renderRanges (camera, this->visibleRangeFirsts, this->visibleRangeCounts);
+    }
+  }
+
+  void gatherFaces (const std::vector<unsigned int>& faces, TriangleBatch& batch) const
+  {
+    batch.reset ();
+    for (unsigned int i : faces)
+    {
+      assert (this->isFreeFace (i) == false);
+
+      if (this->hasFaceRecords)
       {
-        intersection.update (t, ray.pointAt (t), tri.normal ());
-        return t;
+        batch.add (i, this->faceRecords[i]);
       }
       else
       {
-        return Util::maxFloat ();
+        batch.add (i, this->mesh.vertex (this->mesh.index ((3 * i) + 0)),
+                   this->mesh.vertex (this->mesh.index ((3 * i) + 1)),
+                   this->mesh.vertex (this->mesh.index ((3 * i) + 2)));
       }
-    });
+    }
+  }
+
+  bool intersects (const PrimRay& ray, Intersection& intersection, bool bothSides) const
+  {
+    TriangleBatch& batch = scratchBatch ();
+
+    this->requireOctree ();
+    this->octree.intersects (
+      ray, upperBound (intersection),
+      [this, &ray, &intersection, &batch, bothSides](const std::vector<unsigned int>& faces) {
+        unsigned int i;
+        float        t;
+
+        this->gatherFaces (faces, batch);
+        if (batch.intersects (ray, bothSides, upperBound (intersection), i, t))
+        {
+          intersection.update (t, ray.pointAt (t), this->faceNormal (i));
+        }
+        return upperBound (intersection);
+      });
     return intersection.isIntersection ();
   }
 
   bool intersects (const PrimRay& ray, DynamicMeshIntersection& intersection)
   {
-    this->octree.intersects (ray, [this, &ray, &intersection](unsigned int i) -> float {
-      const PrimTriangle tri = this->face (i);
-      float              t;
+    TriangleBatch& batch = scratchBatch ();
+
+    this->requireOctree ();
+    this->octree.intersects (
+      ray, upperBound (intersection),
+      [this, &ray, &intersection, &batch](const std::vector<unsigned int>& faces) {
+        unsigned int i;
+        float        t;
+
+        this->gatherFaces (faces, batch);
+        if (batch.intersects (ray, false, upperBound (intersection), i, t))
+        {
+          intersection.update (t, ray.pointAt (t), this->faceNormal (i), i, *this->self);
+        }
+        return upperBound (intersection);
+      });
+    return intersection.isIntersection ();
+  }
+
+  bool intersectsNeighborhood (const PrimRay& ray, unsigned int face,
+                               DynamicMeshIntersection& intersection)
+  {
+    if (face < this->faceData.size () && this->isFreeFace (face) == false)
+    {
+      TriangleBatch&            batch = scratchBatch ();
+      std::vector<unsigned int> faces;
+      unsigned int              i1, i2, i3;
 
-      if (IntersectionUtil::intersects (ray, tri, false, &t))
+      // faces that are adjacent to several vertices are gathered more than once
+      this->vertexIndices (face, i1, i2, i3);
+      for (unsigned int v : {i1, i2, i3})
       {
-        intersection.update (t, ray.pointAt (t), tri.normal (), i, *this->self);
-        return intersection.distance ();
+        for (unsigned int a : this->adjacentFaces (v))
+        {
+          faces.push_back (a);
+        }
       }
-      else
+      this->gatherFaces (faces, batch);
+
+      unsigned int i;
+      float        t;
+
+      if (batch.intersects (ray, false, upperBound (intersection), i, t))
       {
-        return Util::maxFloat ();
+        intersection.update (t, ray.pointAt (t), this->faceNormal (i), i, *this->self);
       }
-    });
+    }
     return intersection.isIntersection ();
   }
 
+  // the faces of a node are gathered once for all rays that intersect it
+  void intersects (const PrimRay* rays, unsigned int numRays, Intersection* intersections,
+                   bool bothSides) const
+  {
+    TriangleBatch& batch = scratchBatch ();
+
+    this->requireOctree ();
+    this->octree.intersects (
+      rays, numRays,
+      [this, rays, intersections, &batch, bothSides](const std::vector<unsigned int>& faces,
+                                                     const unsigned int* rs, unsigned int n,
+                                                     float* distances) {
+        this->gatherFaces (faces, batch);
+
+        for (unsigned int j = 0; j < n; j++)
+        {
+          const unsigned int r = rs[j];
+          unsigned int       i;
+          float              t;
+
+          if (batch.intersects (rays[r], bothSides, upperBound (intersections[r]), i, t))
+          {
+            intersections[r].update (t, rays[r].pointAt (t), this->faceNormal (i));
+          }
+          distances[r] = upperBound (intersections[r]);
+        }
+      });
+  }
+
   template <typename T, typename... Ts>
   bool intersectsT (const T& t, DynamicFaces& faces, const Ts&... args) const
   {
+    this->requireOctree ();
     this->octree.intersects (t, [this, &t, &faces, &args...](unsigned int i) {
       if (IntersectionUtil::intersects (t, this->face (i), args...))
       {
@@ -923,6 +3563,7 @@ struct DynamicMesh::Impl
   template <typename T, typename... Ts>
   bool containsOrIntersectsT (const T& t, DynamicFaces& faces, const Ts&... args) const
   {
+    this->requireOctree ();
     this->octree.intersects (t, [this, &t, &faces, &args...](bool contains, unsigned int i) {
       if (contains || IntersectionUtil::intersects (t, this->face (i), args...))
       {
@@ -948,31 +3589,147 @@ struct DynamicMesh::Impl
     return this->containsOrIntersectsT<PrimAABox> (box, faces);
   }
 
+  bool intersects (const PrimConvexPolytope& polytope, DynamicFaces& faces) const
+  {
+    return this->containsOrIntersectsT<PrimConvexPolytope> (polytope, faces);
+  }
+
+  bool intersects (const PrimSphere& sphere1, const PrimSphere& sphere2, DynamicFaces& faces1,
+                   DynamicFaces& faces2) const
+  {
+    this->requireOctree ();
+    this->octree.intersects (sphere1, sphere2, [this, &sphere1, &sphere2, &faces1, &faces2](
+                                                 unsigned int s, bool contains, unsigned int i) {
+      const PrimSphere& sphere = s == 0 ? sphere1 : sphere2;
+      DynamicFaces&     faces = s == 0 ? faces1 : faces2;
+
+      if (contains || IntersectionUtil::intersects (sphere, this->face (i)))
+      {
+        faces.insert (i);
+      }
+    });
+    faces1.commit ();
+    faces2.commit ();
+    return faces1.isEmpty () == false || faces2.isEmpty () == false;
+  }
+
   float unsignedDistance (const glm::vec3& pos) const
   {
-    return this->octree.distance (
-      pos, [this, &pos](unsigned int i) { return Distance::distance (this->face (i), pos); });
+    return this->unsignedDistance (pos, Util::maxFloat ());
+  }
+
+  float unsignedDistance (const glm::vec3& pos, float upperBound) const
+  {
+    TriangleBatch& batch = scratchBatch ();
+
+    this->requireOctree ();
+    return this->octree.distance (pos, upperBound,
+                                  [this, &pos, &batch](const std::vector<unsigned int>& faces) {
+                                    this->gatherFaces (faces, batch);
+                                    return batch.distance (pos);
+                                  });
+  }
+
+  void closestPoints (std::vector<glm::vec3>& points, float upperBound) const
+  {
+    this->requireOctree ();
+
+    Parallel::forEach (points.size (), [this, &points, upperBound](unsigned int p) {
+      const glm::vec3 pos = points[p];
+      float           nearest = upperBound;
+
+      const auto getDistance = [this, &points, &pos, &nearest,
+                                p](const std::vector<unsigned int>& faces) {
+        for (unsigned int i : faces)
+        {
+          const glm::vec3 closest = Distance::closestPoint (this->face (i), pos);
+          const float     d = glm::distance (pos, closest);
+
+          if (d < nearest)
+          {
+            nearest = d;
+            points[p] = closest;
+          }
+        }
+        return nearest;
+      };
+      this->octree.distance (pos, upperBound, getDistance);
+    });
+  }
+
+  PrimAABox bounds () const
+  {
+    assert (this->isEmpty () == false);
+
+    this->requireOctree ();
+    return this->octree.bounds ();
   }
 
   void normalize ()
   {
+    if (this->mesh.modelMatrix () == glm::mat4x4 (1.0f))
+    {
+      return;
+    }
+    this->touch ();
+    this->recordAll ();
     this->mesh.normalize ();
-    this->octree.reset ();
+    this->deferOctree ();
+  }
+
+  DynamicOctreeStatistics octreeStatistics () const
+  {
+    this->requireOctree ();
+    return this->octree.statistics ();
+  }
+
+  void forEachOctreeNode (const DynamicMesh::OctreeNodeCallback& f) const
+  {
+    this->requireOctree ();
+    this->octree.forEachNode (f);
+  }
 
-    this->forEachFace ([this](unsigned int i) { this->addFaceToOctree (i); });
+  void printStatistics () const
+  {
+    this->requireOctree ();
+    this->octree.printStatistics ();
   }
 
-  void printStatistics () const { this->octree.printStatistics (); }
+  // an octree that has not been built yet is not reported
+  void reportMemory (MemoryReport& report) const
+  {
+    const auto bytes = [](const auto& v) { return v.capacity () * sizeof (v[0]); };
+
+    this->mesh.reportMemory (report);
+
+    report.add (MemoryCategory::Topology,
+                bytes (this->vertexData) + bytes (this->adjacency) + bytes (this->vertexVisited) +
+                  bytes (this->freeVertexIndices) + bytes (this->masks) +
+                  bytes (this->faceData) + bytes (this->oppositeHalfEdges) +
+                  bytes (this->faceVisited) + bytes (this->freeFaceIndices) +
+                  bytes (this->collected) + bytes (this->realignIndices) +
+                  bytes (this->realignPositions) + bytes (this->realignMaxDimExtents) +
+                  bytes (this->faceNormalCache) + bytes (this->symmetricVertices) +
+                  this->layers.numBytes ());
+
+    report.add (MemoryCategory::Octree, this->octree.numBytes () + bytes (this->faceRecords));
+  }
 
   void runFromConfig (const Config& config)
   {
-    this->mesh.color (config.get<Color> ("editor/mesh/color/normal"));
-    this->mesh.wireframeColor (config.get<Color> ("editor/mesh/color/wireframe"));
+    this->mesh.color (config.get (normalColorKey));
+    this->mesh.wireframeColor (config.get (wireframeColorKey));
+    this->octreeMaxDepthIncrease = config.get (octreeMaxDepthIncreaseKey);
+    this->octreeMinOccupancyRatio = config.get (octreeMinOccupancyRatioKey);
+    this->minCulledFaces = config.get (minCulledFacesKey);
+    this->minFaceRecordFaces = config.get (minFaceRecordFacesKey);
+    this->maxFaceRecordBytes = std::size_t (config.get (maxFaceRecordMegabytesKey)) * 1024 * 1024;
   }
 };
 
 DELEGATE_BIG4_COPY_SELF (DynamicMesh)
 DELEGATE1_CONSTRUCTOR_SELF (DynamicMesh, const Mesh&)
+DELEGATE2_CONSTRUCTOR_SELF (DynamicMesh, const Mesh&, const DynamicMeshCache&)
 DELEGATE_CONST (unsigned int, DynamicMesh, numVertices)
 DELEGATE_CONST (unsigned int, DynamicMesh, numFaces)
 DELEGATE_CONST (bool, DynamicMesh, isEmpty)
@@ -984,9 +3741,20 @@ DELEGATE4_CONST (void, DynamicMesh, vertexIndices, unsigned int, unsigned int&,
                  unsigned int&)
 DELEGATE1_CONST (PrimTriangle, DynamicMesh, face, unsigned int)
 DELEGATE1_CONST (const glm::vec3&, DynamicMesh, vertexNormal, unsigned int)
+DELEGATE_CONST (bool, DynamicMesh, hasMask)
+DELEGATE1_CONST (float, DynamicMesh, mask, unsigned int)
 DELEGATE1_CONST (glm::vec3, DynamicMesh, faceNormal, unsigned int)
-DELEGATE1_CONST (const std::vector<unsigned int>&, DynamicMesh, adjacentFaces, unsigned int)
+DELEGATE1_CONST (DynamicMesh::AdjacentFaces, DynamicMesh, adjacentFaces, unsigned int)
+DELEGATE2_CONST (unsigned int, DynamicMesh, halfEdge, unsigned int, unsigned int)
+DELEGATE1_CONST (unsigned int, DynamicMesh, oppositeHalfEdge, unsigned int)
+DELEGATE1_CONST (unsigned int, DynamicMesh, nextHalfEdge, unsigned int)
+DELEGATE1_CONST (unsigned int, DynamicMesh, halfEdgeFace, unsigned int)
+DELEGATE1_CONST (unsigned int, DynamicMesh, halfEdgeSource, unsigned int)
+DELEGATE1_CONST (unsigned int, DynamicMesh, halfEdgeTarget, unsigned int)
+DELEGATE1_CONST (bool, DynamicMesh, isBoundaryHalfEdge, unsigned int)
 GETTER_CONST (const Mesh&, DynamicMesh, mesh)
+GETTER_CONST (const std::vector<unsigned int>&, DynamicMesh, freeVertexIndices)
+GETTER_CONST (const std::vector<unsigned int>&, DynamicMesh, freeFaceIndices)
 DELEGATE1 (void, DynamicMesh, forEachVertex, const std::function<void(unsigned int)>&)
 DELEGATE2 (void, DynamicMesh, forEachVertex, const DynamicFaces&,
            const std::function<void(unsigned int)>&)
@@ -999,6 +3767,11 @@ DELEGATE2_CONST (void, DynamicMesh, forEachVertexAdjacentToFace, unsigned int,
 DELEGATE1 (void, DynamicMesh, forEachFace, const std::function<void(unsigned int)>&)
 DELEGATE2 (void, DynamicMesh, forEachFaceExt, const DynamicFaces&,
            const std::function<void(unsigned int)>&)
+DELEGATE_CONST (unsigned int, DynamicMesh, numVertexSlots)
+DELEGATE_CONST (unsigned int, DynamicMesh, numFaceSlots)
+DELEGATE1 (const std::vector<unsigned int>&, DynamicMesh, collectVertices, const DynamicFaces&)
+DELEGATE1 (const std::vector<unsigned int>&, DynamicMesh, collectVerticesExt, const DynamicFaces&)
+DELEGATE1 (const std::vector<unsigned int>&, DynamicMesh, collectFacesExt, const DynamicFaces&)
 DELEGATE3_CONST (void, DynamicMesh, average, const DynamicFaces&, glm::vec3&, glm::vec3&)
 DELEGATE1_CONST (glm::vec3, DynamicMesh, averagePosition, const DynamicFaces&)
 DELEGATE1_CONST (glm::vec3, DynamicMesh, averagePosition, unsigned int)
@@ -1010,33 +3783,73 @@ DELEGATE2 (unsigned int, DynamicMesh, addVertex, const glm::vec3&, const glm::ve
 DELEGATE3 (unsigned int, DynamicMesh, addFace, unsigned int, unsigned int, unsigned int)
 DELEGATE1 (void, DynamicMesh, deleteVertex, unsigned int)
 DELEGATE1 (void, DynamicMesh, deleteFace, unsigned int)
-DELEGATE2_MEMBER (void, DynamicMesh, vertex, mesh, unsigned int, const glm::vec3&)
+DELEGATE1 (void, DynamicMesh, deleteVertices, const std::vector<unsigned int>&)
+DELEGATE2 (void, DynamicMesh, vertex, unsigned int, const glm::vec3&)
 DELEGATE2 (void, DynamicMesh, vertexNormal, unsigned int, const glm::vec3&)
+DELEGATE2 (void, DynamicMesh, mask, unsigned int, float)
+DELEGATE (void, DynamicMesh, resetMask)
+GETTER_CONST (const DynamicMeshLayers&, DynamicMesh, layers)
+DELEGATE (unsigned int, DynamicMesh, addLayer)
+DELEGATE1 (void, DynamicMesh, applyLayer, unsigned int)
+DELEGATE2 (void, DynamicMesh, layerStrength, unsigned int, float)
+DELEGATE2 (void, DynamicMesh, enableLayer, unsigned int, bool)
+DELEGATE1 (void, DynamicMesh, recordLayer, unsigned int)
 DELEGATE1 (void, DynamicMesh, setVertexNormal, unsigned int)
+DELEGATE1 (void, DynamicMesh, setVertexNormals, const DynamicFaces&)
 DELEGATE (void, DynamicMesh, setAllNormals)
 DELEGATE (void, DynamicMesh, reset)
 DELEGATE1 (void, DynamicMesh, fromMesh, const Mesh&)
+DELEGATE (void, DynamicMesh, optimizeLayout)
+DELEGATE1_CONST (void, DynamicMesh, cache, DynamicMeshCache&)
 DELEGATE1 (void, DynamicMesh, realignFace, unsigned int)
 DELEGATE1 (void, DynamicMesh, realignFaces, const DynamicFaces&)
 DELEGATE (void, DynamicMesh, realignAllFaces)
 DELEGATE (void, DynamicMesh, sanitize)
 DELEGATE2 (void, DynamicMesh, prune, std::vector<unsigned int>*, std::vector<unsigned int>*)
+DELEGATE1_CONST (bool, DynamicMesh, checkConsistency, const DynamicFaces&)
 DELEGATE2 (bool, DynamicMesh, pruneAndCheckConsistency, std::vector<unsigned int>*,
            std::vector<unsigned int>*)
 DELEGATE1 (bool, DynamicMesh, mirror, const PrimPlane&)
+DELEGATE1_CONST (bool, DynamicMesh, hasSymmetry, const PrimPlane&)
+DELEGATE1_CONST (unsigned int, DynamicMesh, symmetricVertex, unsigned int)
+DELEGATE2 (bool, DynamicMesh, symmetricFaces, const DynamicFaces&, DynamicFaces&)
+DELEGATE (void, DynamicMesh, resetSymmetry)
 DELEGATE (void, DynamicMesh, bufferData)
+DELEGATE1 (void, DynamicMesh, recordDelta, DynamicMeshDelta*)
+DELEGATE1 (void, DynamicMesh, applyDelta, DynamicMeshDelta&)
 DELEGATE1_CONST (void, DynamicMesh, render, Camera&)
+DELEGATE2 (void, DynamicMesh, renderOctree, Camera&, DynamicOctreeOverlay)
 DELEGATE_MEMBER_CONST (const RenderMode&, DynamicMesh, renderMode, mesh)
 DELEGATE_MEMBER (RenderMode&, DynamicMesh, renderMode, mesh)
+DELEGATE_MEMBER_CONST (bool, DynamicMesh, deferNormals, mesh)
+DELEGATE1_MEMBER (void, DynamicMesh, deferNormals, mesh, bool)
 
 DELEGATE3_CONST (bool, DynamicMesh, intersects, const PrimRay&, Intersection&, bool)
 DELEGATE2 (bool, DynamicMesh, intersects, const PrimRay&, DynamicMeshIntersection&)
+DELEGATE3 (bool, DynamicMesh, intersectsNeighborhood, const PrimRay&, unsigned int,
+           DynamicMeshIntersection&)
+DELEGATE4_CONST (void, DynamicMesh, intersects, const PrimRay*, unsigned int, Intersection*, bool)
 DELEGATE2_CONST (bool, DynamicMesh, intersects, const PrimPlane&, DynamicFaces&)
 DELEGATE2_CONST (bool, DynamicMesh, intersects, const PrimSphere&, DynamicFaces&)
+DELEGATE4_CONST (bool, DynamicMesh, intersects, const PrimSphere&, const PrimSphere&, DynamicFaces&,
+                 DynamicFaces&)
 DELEGATE2_CONST (bool, DynamicMesh, intersects, const PrimAABox&, DynamicFaces&)
+DELEGATE2_CONST (bool, DynamicMesh, intersects, const PrimConvexPolytope&, DynamicFaces&)
 DELEGATE1_CONST (float, DynamicMesh, unsignedDistance, const glm::vec3&)
+DELEGATE2_CONST (float, DynamicMesh, unsignedDistance, const glm::vec3&, float)
+DELEGATE2_CONST (void, DynamicMesh, closestPoints, std::vector<glm::vec3>&, float)
+DELEGATE_CONST (PrimAABox, DynamicMesh, bounds)
 
 DELEGATE (void, DynamicMesh, normalize)
+GETTER_CONST (unsigned int, DynamicMesh, revision)
+DELEGATE_CONST (std::shared_ptr<const DynamicMeshVersion>, DynamicMesh, version)
+DELEGATE (unsigned int, DynamicMesh, subscribeToChanges)
+DELEGATE1 (void, DynamicMesh, unsubscribeFromChanges, unsigned int)
+DELEGATE3 (bool, DynamicMesh, consumeChanges, unsigned int, std::vector<unsigned int>&,
+           std::vector<unsigned int>&)
+DELEGATE_CONST (std::shared_ptr<const DynamicMeshDistanceField>, DynamicMesh, distanceField)
+DELEGATE1_CONST (void, DynamicMesh, distanceField,
+                 const std::shared_ptr<const DynamicMeshDistanceField>&)
 DELEGATE1_MEMBER (void, DynamicMesh, scale, mesh, const glm::vec3&)
 DELEGATE1_MEMBER (void, DynamicMesh, scaling, mesh, const glm::vec3&)
 DELEGATE_MEMBER_CONST (glm::vec3, DynamicMesh, scaling, mesh)
@@ -1059,6 +3872,10 @@ DELEGATE1_MEMBER (void, DynamicMesh, color, mesh, const Color&)
 DELEGATE_MEMBER_CONST (const Color&, DynamicMesh, wireframeColor, mesh)
 DELEGATE1_MEMBER (void, DynamicMesh, wireframeColor, mesh, const Color&)
 
+DELEGATE_CONST (DynamicOctreeStatistics, DynamicMesh, octreeStatistics)
+DELEGATE1_CONST (void, DynamicMesh, forEachOctreeNode, const DynamicMesh::OctreeNodeCallback&)
+DELEGATE1_CONST (void, DynamicMesh, reportMemory, MemoryReport&)
+DELEGATE (bool, DynamicMesh, rebalanceOctree)
 DELEGATE_CONST (void, DynamicMesh, printStatistics)
 DELEGATE1 (void, DynamicMesh, runFromConfig, const Config&)
 
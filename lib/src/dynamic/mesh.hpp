@@ -7,6 +7,7 @@
 
 #include <functional>
 #include <glm/fwd.hpp>
+#include <memory>
 #include <vector>
 #include "configurable.hpp"
 #include "macro.hpp"
@@ -14,21 +15,76 @@
 class Camera;
 class Color;
 class DynamicFaces;
+struct DynamicMeshCache;
+class DynamicMeshDistanceField;
 class DynamicMeshIntersection;
+class DynamicMeshLayers;
+struct DynamicMeshVersion;
+enum class DynamicOctreeOverlay;
+struct DynamicOctreeStatistics;
 class Intersection;
+class MemoryReport;
 class Mesh;
 class PrimAABox;
+class PrimConvexPolytope;
 class PrimPlane;
 class PrimRay;
 class PrimSphere;
 class PrimTriangle;
 class RenderMode;
 
+/* The states of all vertices and faces of a dynamic mesh that have been modified while the delta
+ * was recorded (cf. `DynamicMesh::recordDelta`), as they were before their first modification.
+ */
+class DynamicMeshDelta
+{
+public:
+  DECLARE_BIG3 (DynamicMeshDelta)
+
+  bool        isEmpty () const;
+  std::size_t numBytes () const;
+
+  // appends a compact encoding of the delta to a buffer and empties the delta
+  void pack (std::vector<char>&);
+
+  // restores a packed delta and returns the end of its encoding
+  const char* unpack (const char*);
+
+private:
+  friend class DynamicMesh;
+
+  IMPLEMENTATION
+};
+
 class DynamicMesh : public Configurable
 {
 public:
+  // view of the faces adjacent to a vertex, which is invalidated when the mesh is modified
+  class AdjacentFaces
+  {
+  public:
+    AdjacentFaces (const unsigned int* b, unsigned int n)
+      : _begin (b)
+      , _size (n)
+    {
+    }
+
+    const unsigned int* begin () const { return this->_begin; }
+    const unsigned int* end () const { return this->_begin + this->_size; }
+    unsigned int        size () const { return this->_size; }
+    bool                empty () const { return this->_size == 0; }
+    unsigned int        operator[] (unsigned int i) const { return this->_begin[i]; }
+
+  private:
+    const unsigned int* _begin;
+    unsigned int        _size;
+  };
+
   DECLARE_BIG4_EXPLICIT_COPY (DynamicMesh);
+  // does not buffer the mesh, such that meshes can be constructed on any thread
   DynamicMesh (const Mesh&);
+  // restores adjacency and octree from a cache of the mesh, or builds them if it does not match
+  DynamicMesh (const Mesh&, const DynamicMeshCache&);
 
   unsigned int     numVertices () const;
   unsigned int     numFaces () const;
@@ -41,10 +97,45 @@ public:
   PrimTriangle     face (unsigned int) const;
   const glm::vec3& vertexNormal (unsigned int) const;
   glm::vec3        faceNormal (unsigned int) const;
+
+  /* Each vertex has a mask in `[0, 1]`, which protects it from being moved by brushes.  Masks
+   * are interpolated when edges are split or collapsed, and are recorded by deltas.
+   */
+  bool  hasMask () const;
+  float mask (unsigned int) const;
+  void  mask (unsigned int, float);
+  void  resetMask ();
+
+  /* Sculpt layers (cf. `DynamicMeshLayers`), whose weighted displacements are part of the
+   * positions of the vertices.  Changing the strength of a layer or enabling it moves its
+   * displaced vertices, which is recorded by deltas.  Layers must not be added or applied while a
+   * delta is recorded.  Rebuilding the mesh drops all displacements but keeps the layers.
+   */
+  const DynamicMeshLayers& layers () const;
+  unsigned int             addLayer ();
+  // keeps the current positions of the displaced vertices of a layer and drops the layer
+  void                     applyLayer (unsigned int);
+  void                     layerStrength (unsigned int, float);
+  void                     enableLayer (unsigned int, bool);
+
+  /* Adds the modifications of all subsequently modified vertices to the displacements of a
+   * layer when recording is stopped by passing `Util::invalidIndex ()`.  Copies of the mesh do
+   * not record.
+   */
+  void recordLayer (unsigned int);
+
   void findAdjacent (unsigned int, unsigned int, unsigned int&, unsigned int&, unsigned int&,
                      unsigned int&) const;
 
-  const std::vector<unsigned int>& adjacentFaces (unsigned int) const;
+  AdjacentFaces adjacentFaces (unsigned int) const;
+
+  unsigned int halfEdge (unsigned int, unsigned int) const;
+  unsigned int oppositeHalfEdge (unsigned int) const;
+  unsigned int nextHalfEdge (unsigned int) const;
+  unsigned int halfEdgeFace (unsigned int) const;
+  unsigned int halfEdgeSource (unsigned int) const;
+  unsigned int halfEdgeTarget (unsigned int) const;
+  bool         isBoundaryHalfEdge (unsigned int) const;
 
   void forEachVertex (const std::function<void(unsigned int)>&);
   void forEachVertex (const DynamicFaces&, const std::function<void(unsigned int)>&);
@@ -54,6 +145,100 @@ public:
   void forEachFace (const std::function<void(unsigned int)>&);
   void forEachFaceExt (const DynamicFaces&, const std::function<void(unsigned int)>&);
 
+  /* Visitors that are visible to the compiler, such that a lambda passed to them can be
+   * inlined.  They visit the same elements in the same order as their `std::function`
+   * counterparts.  Visitors of `DynamicFaces` iterate over a buffer that is reused by the
+   * next such visitor.
+   */
+  template <typename F> void forEachVertex (const F& f)
+  {
+    const unsigned int n = this->numVertexSlots ();
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+      if (this->isFreeVertex (i) == false)
+      {
+        f (i);
+      }
+    }
+  }
+
+  template <typename F> void forEachVertex (const DynamicFaces& faces, const F& f)
+  {
+    const std::vector<unsigned int>& collected = this->collectVertices (faces);
+
+    for (std::size_t i = 0; i < collected.size (); i++)
+    {
+      f (collected[i]);
+    }
+  }
+
+  template <typename F> void forEachVertexExt (const DynamicFaces& faces, const F& f)
+  {
+    const std::vector<unsigned int>& collected = this->collectVerticesExt (faces);
+
+    for (std::size_t i = 0; i < collected.size (); i++)
+    {
+      f (collected[i]);
+    }
+  }
+
+  template <typename F> void forEachVertexAdjacentToVertex (unsigned int i, const F& f) const
+  {
+    for (unsigned int a : this->adjacentFaces (i))
+    {
+      unsigned int a1, a2, a3;
+      this->vertexIndices (a, a1, a2, a3);
+
+      if (i == a1)
+      {
+        f (a2);
+      }
+      else if (i == a2)
+      {
+        f (a3);
+      }
+      else
+      {
+        assert (i == a3);
+        f (a1);
+      }
+    }
+  }
+
+  template <typename F> void forEachVertexAdjacentToFace (unsigned int i, const F& f) const
+  {
+    unsigned int i1, i2, i3;
+    this->vertexIndices (i, i1, i2, i3);
+
+    f (i1);
+    f (i2);
+    f (i3);
+  }
+
+  template <typename F> void forEachFace (const F& f)
+  {
+    const unsigned int n = this->numFaceSlots ();
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+      if (this->isFreeFace (i) == false)
+      {
+        f (i);
+      }
+    }
+  }
+
+  template <typename F> void forEachFaceExt (const DynamicFaces& faces, const F& f)
+  {
+    const std::vector<unsigned int>& collected = this->collectFacesExt (faces);
+
+    for (std::size_t i = 0; i < collected.size (); i++)
+    {
+      f (collected[i]);
+    }
+  }
+
   void      average (const DynamicFaces&, glm::vec3&, glm::vec3&) const;
   glm::vec3 averagePosition (const DynamicFaces&) const;
   glm::vec3 averagePosition (unsigned int) const;
@@ -67,14 +252,24 @@ public:
   unsigned int addFace (unsigned int, unsigned int, unsigned int);
   void         deleteVertex (unsigned int);
   void         deleteFace (unsigned int);
+  void         deleteVertices (const std::vector<unsigned int>&);
+
+  // slots of deleted vertices and faces, which remain part of `mesh` until it is pruned
+  const std::vector<unsigned int>& freeVertexIndices () const;
+  const std::vector<unsigned int>& freeFaceIndices () const;
 
   void vertex (unsigned int, const glm::vec3&);
   void vertexNormal (unsigned int, const glm::vec3&);
   void setVertexNormal (unsigned int);
+  void setVertexNormals (const DynamicFaces&);
   void setAllNormals ();
 
   void reset ();
   void fromMesh (const Mesh&);
+  // requires the mesh to be pruned, cf. `DynamicMeshCache`
+  void cache (DynamicMeshCache&) const;
+  // rebuilds the mesh in the order of `MeshUtil::optimizeLayout`, which drops masks and symmetry
+  void optimizeLayout ();
   void realignFace (unsigned int);
   void realignFaces (const DynamicFaces&);
   void realignAllFaces ();
@@ -82,20 +277,87 @@ public:
   void prune (std::vector<unsigned int>* = nullptr, std::vector<unsigned int>* = nullptr);
   bool pruneAndCheckConsistency (std::vector<unsigned int>* = nullptr,
                                  std::vector<unsigned int>* = nullptr);
+  // only checks the faces that share a vertex with the given faces
+  bool checkConsistency (const DynamicFaces&) const;
   bool mirror (const PrimPlane&);
+
+  /* Pairs each vertex with its reflection by the plane of the last `mirror`.  Pairs are dropped
+   * when one of their vertices is deleted, and vertices that are added to paired regions are
+   * paired again by `symmetricFaces`.  Unpaired vertices yield `Util::invalidIndex ()`.
+   */
+  bool         hasSymmetry (const PrimPlane&) const;
+  unsigned int symmetricVertex (unsigned int) const;
+  bool         symmetricFaces (const DynamicFaces&, DynamicFaces&);
+  void         resetSymmetry ();
   void bufferData ();
 
+  /* Records the previous states of all subsequently modified vertices and faces into a delta,
+   * until recording is stopped by passing `nullptr`.  Copies of the mesh do not record.
+   */
+  void recordDelta (DynamicMeshDelta*);
+
+  /* Restores the states of a delta, which must have been recorded from the current state of the
+   * mesh, and turns the delta into its inverse.  Vertices and faces keep their indices.
+   */
+  void applyDelta (DynamicMeshDelta&);
+
   void render (Camera&) const;
+  // renders the octree of the mesh if the overlay is not `None`, cf. `DynamicOctree::render`
+  void renderOctree (Camera&, DynamicOctreeOverlay);
 
   const RenderMode& renderMode () const;
   RenderMode&       renderMode ();
+  // cf. `Mesh::deferNormals`
+  bool              deferNormals () const;
+  void              deferNormals (bool);
 
   bool  intersects (const PrimRay&, Intersection&, bool = false) const;
   bool  intersects (const PrimRay&, DynamicMeshIntersection&);
+  // intersects a face and the faces adjacent to its vertices, which is cheap for coherent rays
+  bool  intersectsNeighborhood (const PrimRay&, unsigned int, DynamicMeshIntersection&);
+  void  intersects (const PrimRay*, unsigned int, Intersection*, bool = false) const;
   bool  intersects (const PrimPlane&, DynamicFaces&) const;
   bool  intersects (const PrimSphere&, DynamicFaces&) const;
+  // collects the faces of two spheres in a single traversal of the octree
+  bool  intersects (const PrimSphere&, const PrimSphere&, DynamicFaces&, DynamicFaces&) const;
   bool  intersects (const PrimAABox&, DynamicFaces&) const;
+  // collects faces that are not separated from the polytope by any of its planes
+  bool  intersects (const PrimConvexPolytope&, DynamicFaces&) const;
   float unsignedDistance (const glm::vec3&) const;
+  float unsignedDistance (const glm::vec3&, float) const;
+  /* Replaces points by their closest points on the mesh, unless these are farther away than the
+   * given upper bound.  Points are queried in parallel.
+   */
+  void  closestPoints (std::vector<glm::vec3>&, float) const;
+
+  // conservative bounds of all faces of a non-empty mesh
+  PrimAABox bounds () const;
+
+  // changes whenever the geometry of the mesh is modified
+  unsigned int revision () const;
+
+  /* Publishes the current revision and transformation of the mesh.  Readers of the same revision
+   * share a version as long as one of them pins it.  Must be called on the thread that modifies
+   * the mesh.
+   */
+  std::shared_ptr<const DynamicMeshVersion> version () const;
+
+  /* Journal of modified vertices and faces.  Each subscriber consumes the indices of the vertices
+   * and faces that have been modified since its previous call, sorted and without duplicates.
+   * Faces are only logged when their vertices change.  `consumeChanges` returns `false` if the
+   * whole mesh has to be processed instead, e.g. after it has been pruned.  Copies of a mesh have
+   * no subscribers.
+   */
+  unsigned int subscribeToChanges ();
+  void         unsubscribeFromChanges (unsigned int);
+  bool consumeChanges (unsigned int, std::vector<unsigned int>&, std::vector<unsigned int>&);
+
+  /* Caches a distance field of the current revision.  The cache is shared by all copies of the
+   * mesh, such that a field that has been sampled from a copy is available to all copies with
+   * the same revision.
+   */
+  std::shared_ptr<const DynamicMeshDistanceField> distanceField () const;
+  void distanceField (const std::shared_ptr<const DynamicMeshDistanceField>&) const;
 
   void               normalize ();
   void               scale (const glm::vec3&);
@@ -120,9 +382,22 @@ public:
   const Color&       wireframeColor () const;
   void               wireframeColor (const Color&);
 
-  void printStatistics () const;
+  typedef std::function<void(unsigned int, const std::vector<unsigned int>&)> OctreeNodeCallback;
+
+  DynamicOctreeStatistics octreeStatistics () const;
+  // cf. `DynamicOctree::forEachNode`, whose elements are the faces of the mesh
+  void                    forEachOctreeNode (const OctreeNodeCallback&) const;
+  bool                    rebalanceOctree ();
+  void                    printStatistics () const;
+  void                    reportMemory (MemoryReport&) const;
 
 private:
+  unsigned int                     numVertexSlots () const;
+  unsigned int                     numFaceSlots () const;
+  const std::vector<unsigned int>& collectVertices (const DynamicFaces&);
+  const std::vector<unsigned int>& collectVerticesExt (const DynamicFaces&);
+  const std::vector<unsigned int>& collectFacesExt (const DynamicFaces&);
+
   IMPLEMENTATION
 
   void runFromConfig (const Config&);
@@ -2,64 +2,152 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
-#include <array>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <glm/glm.hpp>
 #include <iostream>
-#include <unordered_map>
-#include <unordered_set>
+#include <queue>
+#include "camera.hpp"
+#include "color.hpp"
 #include "dynamic/octree.hpp"
 #include "intersection.hpp"
-#include "maybe.hpp"
+#include "overlay-batch.hpp"
 #include "primitive/aabox.hpp"
+#include "primitive/convex-polytope.hpp"
 #include "primitive/plane.hpp"
+#include "primitive/ray.hpp"
 #include "primitive/sphere.hpp"
+#include "profiler.hpp"
+#include "renderer.hpp"
+#include "thread-pool.hpp"
 #include "util.hpp"
 
-#ifdef DILAY_RENDER_OCTREE
-#include "../mesh.hpp"
-#include "color.hpp"
-#include "render-mode.hpp"
-#endif
-
 namespace
 {
-  struct IndexOctreeNode;
-  typedef Maybe<IndexOctreeNode> Child;
-
-  struct IndexOctreeStatistics
+  // number of visits of queries, which may be counted concurrently
+  struct VisitCounter
   {
-    typedef std::unordered_map<int, unsigned int> DepthMap;
+    mutable std::atomic<unsigned int> value;
+
+    VisitCounter ()
+      : value (0)
+    {
+    }
+
+    VisitCounter (const VisitCounter& other) noexcept
+      : value (other.get ())
+    {
+    }
+
+    VisitCounter& operator= (const VisitCounter& other) noexcept
+    {
+      this->value.store (other.get (), std::memory_order_relaxed);
+      return *this;
+    }
 
-    unsigned int numNodes;
-    unsigned int numElements;
-    int          minDepth;
-    int          maxDepth;
-    unsigned int maxElementsPerNode;
-    DepthMap     numElementsPerDepth;
-    DepthMap     numNodesPerDepth;
+    unsigned int get () const { return this->value.load (std::memory_order_relaxed); }
+    void         increment () const { this->value.fetch_add (1, std::memory_order_relaxed); }
+    void         halve () const { this->value.store (this->get () / 2, std::memory_order_relaxed); }
+    void         reset () { this->value.store (0, std::memory_order_relaxed); }
   };
 
+  /* Nodes are stored in a contiguous array: the root is always stored at index 0 and the
+   * children of a node are stored in a block of 8 consecutive nodes starting at `firstChild`.
+   * Children within a block are Morton-ordered (see `childIndex`), i.e. the i-th child of a node
+   * is stored at `firstChild + i`.  Unused blocks are recycled, which also recycles the storage
+   * of their element lists.
+   * The elements of a node are stored densely: each element knows its slot in its node's list
+   * (cf. `ElementLocation`), so elements can be swap-removed in constant time.
+   * Besides its loose box, each node keeps conservative bounds of all elements of its subtree,
+   * which only grow when elements are inserted or realigned.  Queries cull with these bounds.
+   */
   struct IndexOctreeNode
   {
-    const glm::vec3                  center;
-    const float                      width;
-    const int                        depth;
-    const PrimAABox                  looseAABox;
-    std::array<Child, 8>             children;
-    std::unordered_set<unsigned int> indices;
+    glm::vec3                 center;
+    float                     width;
+    int                       depth;
+    unsigned int              parent;
+    unsigned int              firstChild;
+    unsigned char             childMask;
+    glm::vec3                 boundsMin;
+    glm::vec3                 boundsMax;
+    std::vector<unsigned int> indices;
+    VisitCounter              visits;
 
     static constexpr float relativeMinElementExtent = 0.25f;
 
-    IndexOctreeNode (const glm::vec3& c, float w, int d)
-      : center (c)
-      , width (w)
-      , depth (d)
-      , looseAABox (c, 2.0f * w, 2.0f * w, 2.0f * w)
+    IndexOctreeNode ()
+      : width (0.0f)
+      , depth (0)
+      , parent (Util::invalidIndex ())
+      , firstChild (Util::invalidIndex ())
+      , childMask (0)
+      , boundsMin (Util::maxFloat ())
+      , boundsMax (-Util::maxFloat ())
+    {
+    }
+
+    void setup (const glm::vec3& c, float w, int d)
     {
       static_assert (IndexOctreeNode::relativeMinElementExtent < 0.5f,
                      "relativeMinElementExtent must be smaller than 0.5f");
       assert (w > 0.0f);
+
+      this->center = c;
+      this->width = w;
+      this->depth = d;
+      this->parent = Util::invalidIndex ();
+      this->firstChild = Util::invalidIndex ();
+      this->childMask = 0;
+      this->boundsMin = glm::vec3 (Util::maxFloat ());
+      this->boundsMax = glm::vec3 (-Util::maxFloat ());
+      this->indices.clear ();
+      this->visits.reset ();
+    }
+
+    PrimAABox looseAABox () const
+    {
+      return PrimAABox (this->center, 2.0f * this->width, 2.0f * this->width, 2.0f * this->width);
+    }
+
+    bool hasBounds () const { return this->boundsMin.x <= this->boundsMax.x; }
+
+    PrimAABox tightAABox () const
+    {
+      assert (this->hasBounds ());
+      return PrimAABox (this->boundsMin, this->boundsMax);
+    }
+
+    // returns `true` if the bounds had to be extended
+    bool extendBounds (const glm::vec3& min, const glm::vec3& max)
+    {
+      if (glm::all (glm::lessThanEqual (this->boundsMin, min)) &&
+          glm::all (glm::lessThanEqual (max, this->boundsMax)))
+      {
+        return false;
+      }
+      else
+      {
+        this->boundsMin = glm::min (this->boundsMin, min);
+        this->boundsMax = glm::max (this->boundsMax, max);
+        return true;
+      }
+    }
+
+    // lower bound of the distance between `position` and any element of this node's subtree
+    float lowerBoundDistance (const glm::vec3& position) const
+    {
+      if (this->hasBounds ())
+      {
+        const glm::vec3 d = glm::max (this->boundsMin - position, position - this->boundsMax);
+        return glm::length (glm::max (d, glm::vec3 (0.0f)));
+      }
+      else
+      {
+        return Util::maxFloat ();
+      }
     }
 
     bool approxContains (const glm::vec3& position, float maxDimExtent) const
@@ -98,341 +186,318 @@ namespace
       return index;
     }
 
-    bool hasChildren () const
+    glm::vec3 childCenter (unsigned int childIndex) const
     {
-      return bool(this->children[0]) || bool(this->children[1]) || bool(this->children[2]) ||
-             bool(this->children[3]) || bool(this->children[4]) || bool(this->children[5]) ||
-             bool(this->children[6]) || bool(this->children[7]);
-    }
+      assert (childIndex < 8);
 
-    bool insertIntoChild (float maxDimExtent) const
-    {
-      return maxDimExtent <= this->width * IndexOctreeNode::relativeMinElementExtent;
+      const float q = this->width * 0.25f;
+      return this->center + glm::vec3 ((childIndex & 4) ? q : -q, (childIndex & 2) ? q : -q,
+                                       (childIndex & 1) ? q : -q);
     }
 
-    IndexOctreeNode& insertIntoChild (unsigned int index, const glm::vec3& position,
-                                      float maxDimExtent)
+    bool hasChild (unsigned int childIndex) const
     {
-      const unsigned int childIndex = this->childIndex (position);
+      return (this->childMask & (1 << childIndex)) != 0;
+    }
 
-      if (this->children[childIndex] == false)
-      {
-        const float q = this->width * 0.25f;
-        const float width = this->width * 0.5f;
-        const int   depth = this->depth + 1;
+    bool hasChildren () const { return this->childMask != 0; }
 
-        switch (childIndex)
-        {
-          case 0:
-            this->children[0] = Child::make (this->center + glm::vec3 (-q, -q, -q), width, depth);
-            break;
-          case 1:
-            this->children[1] = Child::make (this->center + glm::vec3 (-q, -q, +q), width, depth);
-            break;
-          case 2:
-            this->children[2] = Child::make (this->center + glm::vec3 (-q, +q, -q), width, depth);
-            break;
-          case 3:
-            this->children[3] = Child::make (this->center + glm::vec3 (-q, +q, +q), width, depth);
-            break;
-          case 4:
-            this->children[4] = Child::make (this->center + glm::vec3 (+q, -q, -q), width, depth);
-            break;
-          case 5:
-            this->children[5] = Child::make (this->center + glm::vec3 (+q, -q, +q), width, depth);
-            break;
-          case 6:
-            this->children[6] = Child::make (this->center + glm::vec3 (+q, +q, -q), width, depth);
-            break;
-          case 7:
-            this->children[7] = Child::make (this->center + glm::vec3 (+q, +q, +q), width, depth);
-            break;
-        }
-      }
-      return this->children[childIndex]->addElement (index, position, maxDimExtent);
+    unsigned int child (unsigned int childIndex) const
+    {
+      assert (this->hasChild (childIndex));
+      return this->firstChild + childIndex;
     }
 
-    IndexOctreeNode& addElement (unsigned int index, const glm::vec3& position, float maxDimExtent)
+    bool insertIntoChild (float maxDimExtent) const
     {
-      assert (this->approxContains (position, maxDimExtent));
-
-      if (this->insertIntoChild (maxDimExtent))
-      {
-        return this->insertIntoChild (index, position, maxDimExtent);
-      }
-      else
-      {
-        this->indices.insert (index);
-        return *this;
-      }
+      return maxDimExtent <= this->width * IndexOctreeNode::relativeMinElementExtent;
     }
 
     bool isEmpty () const { return this->indices.empty () && this->hasChildren () == false; }
 
-    void deleteElement (unsigned int index)
+    unsigned int addElement (unsigned int index)
     {
-      unsigned int n = this->indices.erase (index);
-      assert (n > 0);
-      unused (n);
+      this->indices.push_back (index);
+      return this->indices.size () - 1;
     }
 
-    bool deleteEmptyChildren ()
+    // swap-removes the element at `slot` and returns the element that now occupies `slot`
+    unsigned int deleteElement (unsigned int slot)
     {
-      bool allChildrenEmpty = true;
-
-      for (unsigned int i = 0; i < 8; i++)
-      {
-        if (this->children[i])
-        {
-          if (this->children[i]->deleteEmptyChildren ())
-          {
-            this->children[i].reset ();
-          }
-          else
-          {
-            allChildrenEmpty = false;
-          }
-        }
-      }
-
-      if (allChildrenEmpty)
-      {
-        assert (this->hasChildren () == false);
-        return this->indices.empty ();
-      }
-      else
-      {
-        return false;
-      }
-    }
+      assert (slot < this->indices.size ());
 
-#ifdef DILAY_RENDER_OCTREE
-    void render (Camera& camera, Mesh& nodeMesh) const
-    {
-      nodeMesh.position (this->center);
-      nodeMesh.scaling (glm::vec3 (this->width * 0.5f));
-      nodeMesh.renderLines (camera);
+      this->indices[slot] = this->indices.back ();
+      this->indices.pop_back ();
 
-      for (unsigned int i = 0; i < 8; i++)
-      {
-        if (this->children[i])
-        {
-          this->children[i]->render (camera, nodeMesh);
-        }
-      }
+      return slot < this->indices.size () ? this->indices[slot] : Util::invalidIndex ();
     }
-#endif
 
-    template <typename T>
-    void containsOrIntersectsT (const T&                                           t,
-                                const DynamicOctree::ContainsIntersectionCallback& f) const
-    {
-      const bool contains = t.contains (this->looseAABox);
-
-      if (contains || IntersectionUtil::intersects (t, this->looseAABox))
-      {
-        for (unsigned int index : this->indices)
-        {
-          f (contains, index);
-        }
-        for (unsigned int i = 0; i < 8; i++)
-        {
-          if (this->children[i])
-          {
-            this->children[i]->containsOrIntersectsT<T> (t, f);
-          }
-        }
-      }
-    }
+    unsigned int numElements () const { return this->indices.size (); }
+  };
 
-    template <typename T>
-    void intersectsT (const T& t, const DynamicOctree::IntersectionCallback& f) const
-    {
-      if (IntersectionUtil::intersects (t, this->looseAABox))
-      {
-        for (unsigned int index : this->indices)
-        {
-          f (index);
-        }
-        for (unsigned int i = 0; i < 8; i++)
-        {
-          if (this->children[i])
-          {
-            this->children[i]->intersectsT<T> (t, f);
-          }
-        }
-      }
-    }
+  struct ElementLocation
+  {
+    unsigned int node;
+    unsigned int slot;
 
-    void intersects (const PrimRay& ray, float& distance,
-                     const DynamicOctree::RayIntersectionCallback& f) const
+    ElementLocation ()
+      : node (Util::invalidIndex ())
+      , slot (Util::invalidIndex ())
     {
-      float t;
-      if (IntersectionUtil::intersects (ray, this->looseAABox, &t) && t < distance)
-      {
-        for (unsigned int index : this->indices)
-        {
-          distance = glm::min (f (index), distance);
-        }
-        for (unsigned int i = 0; i < 8; i++)
-        {
-          if (this->children[i])
-          {
-            this->children[i]->intersects (ray, distance, f);
-          }
-        }
-      }
     }
 
-    void distance (PrimSphere& sphere, const DynamicOctree::DistanceCallback& getDistance) const
-    {
-      for (unsigned int i : this->indices)
-      {
-        const float distance = getDistance (i);
-        if (distance < sphere.radius ())
-        {
-          sphere.radius (distance);
-        }
-      }
+    bool isValid () const { return this->node != Util::invalidIndex (); }
+  };
 
-      const unsigned int first = this->childIndex (sphere.center ());
-      const bool         hasFirst = bool(this->children[first]);
-      if (hasFirst && IntersectionUtil::intersects (sphere, this->children[first]->looseAABox))
-      {
-        this->children[first]->distance (sphere, getDistance);
-      }
+  // spreads the lower 21 bits of `v` such that there are two zero bits between each of them
+  uint64_t spreadBits (uint64_t v)
+  {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffff;
+    v = (v | v << 16) & 0x1f0000ff0000ff;
+    v = (v | v << 8) & 0x100f00f00f00f00f;
+    v = (v | v << 4) & 0x10c30c30c30c30c3;
+    v = (v | v << 2) & 0x1249249249249249;
+    return v;
+  }
 
-      for (unsigned int i = 0; i < 8; i++)
-      {
-        const bool hasChild = i != first && bool(this->children[i]);
-        if (hasChild && IntersectionUtil::intersects (sphere, this->children[i]->looseAABox))
-        {
-          this->children[i]->distance (sphere, getDistance);
-        }
-      }
-    }
+  // Morton code of a normalized position in [0,1]^3, consistent with `childIndex`
+  uint64_t mortonCode (const glm::vec3& position)
+  {
+    const float     scale = float((1 << 21) - 1);
+    const glm::vec3 q = glm::clamp (position, glm::vec3 (0.0f), glm::vec3 (1.0f)) * scale;
 
-    unsigned int numElements () const { return this->indices.size (); }
+    return (spreadBits (uint64_t (q.x)) << 2) | (spreadBits (uint64_t (q.y)) << 1) |
+           spreadBits (uint64_t (q.z));
+  }
 
-    void updateIndices (const std::vector<unsigned int>& indexMap)
+  /* A packet of rays that is traversed together: the rays are stored as structure of arrays, so
+   * that the slab tests of all rays against a node's bounds run in a single dense loop without
+   * indirections, whose results are then compacted.  `active` is used as a stack of ray-index
+   * ranges, i.e. each visited node appends the rays that hit its box and truncates them again
+   * once its subtree has been traversed.
+   */
+  struct RayPacket
+  {
+    std::vector<float>         originX, originY, originZ;
+    std::vector<float>         invDirX, invDirY, invDirZ;
+    std::vector<unsigned char> isLine;
+    std::vector<float>         distances;
+    std::vector<unsigned char> hits;
+    std::vector<unsigned int>  active;
+
+    RayPacket (const PrimRay* rays, unsigned int numRays)
+      : originX (numRays)
+      , originY (numRays)
+      , originZ (numRays)
+      , invDirX (numRays)
+      , invDirY (numRays)
+      , invDirZ (numRays)
+      , isLine (numRays)
+      , distances (numRays, Util::maxFloat ())
+      , hits (numRays)
     {
-      std::unordered_set<unsigned int> newIndices;
+      this->active.reserve (4 * numRays);
 
-      for (unsigned int i : this->indices)
+      for (unsigned int i = 0; i < numRays; i++)
       {
-        assert (indexMap[i] != Util::invalidIndex ());
-
-        newIndices.insert (indexMap[i]);
-      }
-      this->indices = std::move (newIndices);
-
-      for (unsigned int i = 0; i < 8; i++)
-      {
-        if (this->children[i])
-        {
-          this->children[i]->updateIndices (indexMap);
-        }
+        this->originX[i] = rays[i].origin ().x;
+        this->originY[i] = rays[i].origin ().y;
+        this->originZ[i] = rays[i].origin ().z;
+        this->invDirX[i] = 1.0f / rays[i].direction ().x;
+        this->invDirY[i] = 1.0f / rays[i].direction ().y;
+        this->invDirZ[i] = 1.0f / rays[i].direction ().z;
+        this->isLine[i] = rays[i].isLine () ? 1 : 0;
+        this->active.push_back (i);
       }
     }
 
-    void updateStatistics (IndexOctreeStatistics& stats) const
+    /* Appends all rays of `active[begin, end)` that hit the box and returns the new end.  All rays
+     * of the packet are tested, since a dense loop is cheaper than gathering the active ones.
+     */
+    unsigned int cull (unsigned int begin, unsigned int end, const glm::vec3& min,
+                       const glm::vec3& max)
     {
-      stats.numNodes += 1;
-      stats.numElements += this->numElements ();
-      stats.minDepth = glm::min (stats.minDepth, this->depth);
-      stats.maxDepth = glm::max (stats.maxDepth, this->depth);
-      stats.maxElementsPerNode = glm::max (stats.maxElementsPerNode, this->numElements ());
+      const unsigned int numRays = this->hits.size ();
 
-      auto e = stats.numElementsPerDepth.find (this->depth);
-      if (e == stats.numElementsPerDepth.end ())
+      for (unsigned int r = 0; r < numRays; r++)
       {
-        stats.numElementsPerDepth.emplace (this->depth, this->numElements ());
+        const float x1 = (min.x - this->originX[r]) * this->invDirX[r];
+        const float x2 = (max.x - this->originX[r]) * this->invDirX[r];
+        const float y1 = (min.y - this->originY[r]) * this->invDirY[r];
+        const float y2 = (max.y - this->originY[r]) * this->invDirY[r];
+        const float z1 = (min.z - this->originZ[r]) * this->invDirZ[r];
+        const float z2 = (max.z - this->originZ[r]) * this->invDirZ[r];
+
+        const float tMin = glm::max (glm::max (glm::min (x1, x2), glm::min (y1, y2)),
+                                     glm::min (z1, z2));
+        const float tMax = glm::min (glm::min (glm::max (x1, x2), glm::max (y1, y2)),
+                                     glm::max (z1, z2));
+
+        // bitwise operators keep the loop free of branches
+        this->hits[r] = ((tMax >= 0.0f) | (this->isLine[r] != 0)) & (tMin <= tMax) &
+                        (tMin < this->distances[r]);
       }
-      else
-      {
-        e->second = e->second + this->numElements ();
-      }
-      e = stats.numNodesPerDepth.find (this->depth);
-      if (e == stats.numNodesPerDepth.end ())
-      {
-        stats.numNodesPerDepth.emplace (this->depth, 1);
-      }
-      else
-      {
-        e->second = e->second + 1;
-      }
-      for (unsigned int i = 0; i < 8; i++)
+
+      for (unsigned int i = begin; i < end; i++)
       {
-        if (this->children[i])
+        const unsigned int r = this->active[i];
+
+        if (this->hits[r])
         {
-          this->children[i]->updateStatistics (stats);
+          this->active.push_back (r);
         }
       }
+      return this->active.size ();
     }
   };
 }
 
 struct DynamicOctree::Impl
 {
-  Child                         root;
-  std::vector<IndexOctreeNode*> elementNodeMap;
+  std::vector<IndexOctreeNode> nodes;
+  std::vector<unsigned int>    freeBlocks;
+  std::vector<ElementLocation> elementLocations;
+  bool                         isCountingVisits;
+
+  Impl ()
+    : isCountingVisits (false)
+  {
+  }
 
-  Impl () {}
+  bool hasRoot () const { return this->nodes.empty () == false; }
+
+  PrimAABox bounds () const
+  {
+    assert (this->hasRoot ());
+    return this->nodes[0].tightAABox ();
+  }
 
-  Impl (const Impl& other)
-    : root (other.root)
+  IndexOctreeNode& root ()
   {
-    this->makeElementNodeMap ();
+    assert (this->hasRoot ());
+    return this->nodes[0];
   }
 
-  bool hasRoot () const { return bool(this->root); }
+  const IndexOctreeNode& root () const
+  {
+    assert (this->hasRoot ());
+    return this->nodes[0];
+  }
 
   void setupRoot (const glm::vec3& position, float width)
   {
     assert (this->hasRoot () == false);
-    this->root = IndexOctreeNode (position, width, 0);
+    this->nodes.emplace_back ();
+    this->nodes[0].setup (position, width, 0);
+  }
+
+  unsigned int allocateBlock ()
+  {
+    if (this->freeBlocks.empty ())
+    {
+      const unsigned int block = this->nodes.size ();
+      this->nodes.resize (block + 8);
+      return block;
+    }
+    else
+    {
+      const unsigned int block = this->freeBlocks.back ();
+      this->freeBlocks.pop_back ();
+      return block;
+    }
+  }
+
+  void freeBlock (unsigned int block)
+  {
+    assert (block != Util::invalidIndex ());
+    assert (block + 8 <= this->nodes.size ());
+
+    for (unsigned int i = block; i < block + 8; i++)
+    {
+      assert (this->nodes[i].isEmpty ());
+      this->nodes[i].indices.clear ();
+    }
+    this->freeBlocks.push_back (block);
   }
 
-  void makeElementNodeMap ()
+  // Caution: may invalidate references to nodes
+  unsigned int makeChild (unsigned int node, unsigned int childIndex)
   {
-    std::function<void(IndexOctreeNode&)> traverse = [this, &traverse](IndexOctreeNode& node) {
-      for (unsigned i : node.indices)
+    if (this->nodes[node].hasChild (childIndex) == false)
+    {
+      if (this->nodes[node].firstChild == Util::invalidIndex ())
       {
-        this->addToElementNodeMap (i, node);
+        const unsigned int block = this->allocateBlock ();
+        this->nodes[node].firstChild = block;
       }
-      for (unsigned int i = 0; i < 8; i++)
+      IndexOctreeNode& parent = this->nodes[node];
+      IndexOctreeNode& child = this->nodes[parent.firstChild + childIndex];
+
+      child.setup (parent.childCenter (childIndex), parent.width * 0.5f, parent.depth + 1);
+      child.parent = node;
+      parent.childMask |= (unsigned char) (1 << childIndex);
+    }
+    return this->nodes[node].child (childIndex);
+  }
+
+  void moveNode (unsigned int from, unsigned int to)
+  {
+    assert (from != to);
+
+    this->nodes[to] = std::move (this->nodes[from]);
+    this->nodes[from].indices.clear ();
+    this->nodes[from].firstChild = Util::invalidIndex ();
+    this->nodes[from].childMask = 0;
+
+    for (unsigned int i : this->nodes[to].indices)
+    {
+      this->elementLocations[i].node = to;
+    }
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      if (this->nodes[to].hasChild (i))
       {
-        if (node.children[i])
-        {
-          traverse (*node.children[i]);
-        }
+        this->nodes[this->nodes[to].child (i)].parent = to;
       }
-    };
-    if (this->root)
+    }
+  }
+
+  /* Extends the bounds of `node` and its ancestors by the bounds of an element.  Since `position`
+   * lies within the element, the element is contained in a cube of size `2 * maxDimExtent`.
+   */
+  void extendBounds (unsigned int node, const glm::vec3& position, float maxDimExtent)
+  {
+    const glm::vec3 min = position - glm::vec3 (maxDimExtent);
+    const glm::vec3 max = position + glm::vec3 (maxDimExtent);
+
+    while (node != Util::invalidIndex () && this->nodes[node].extendBounds (min, max))
     {
-      traverse (*this->root);
+      node = this->nodes[node].parent;
     }
   }
 
-  void addToElementNodeMap (unsigned int index, IndexOctreeNode& node)
+  void setElementLocation (unsigned int index, unsigned int node, unsigned int slot)
   {
-    if (index >= this->elementNodeMap.size ())
+    if (index >= this->elementLocations.size ())
     {
-      this->elementNodeMap.resize (index + 1, nullptr);
+      this->elementLocations.resize (index + 1);
     }
-    assert (this->elementNodeMap[index] == nullptr);
-    this->elementNodeMap[index] = &node;
+    assert (this->elementLocations[index].isValid () == false);
+    this->elementLocations[index].node = node;
+    this->elementLocations[index].slot = slot;
   }
 
   void makeParent (const glm::vec3& position)
   {
     assert (this->hasRoot ());
 
-    const glm::vec3 rootCenter = this->root->center;
-    const float     rootWidth = this->root->width;
-    const float     halfRootWidth = this->root->width * 0.5f;
+    const glm::vec3 rootCenter = this->root ().center;
+    const float     rootWidth = this->root ().width;
+    const float     halfRootWidth = this->root ().width * 0.5f;
+    const int       rootDepth = this->root ().depth;
     glm::vec3       parentCenter;
-    int             index = 0;
+    unsigned int    index = 0;
 
     if (rootCenter.x < position.x)
       parentCenter.x = rootCenter.x + halfRootWidth;
@@ -456,20 +521,39 @@ struct DynamicOctree::Impl
       index += 1;
     }
 
-    IndexOctreeNode* newRoot =
-      new IndexOctreeNode (parentCenter, rootWidth * 2.0f, this->root->depth - 1);
-    newRoot->children[index] = std::move (this->root);
-    this->root.reset (newRoot);
+    const unsigned int block = this->allocateBlock ();
+    this->moveNode (0, block + index);
+
+    this->root ().setup (parentCenter, rootWidth * 2.0f, rootDepth - 1);
+    this->root ().firstChild = block;
+    this->root ().childMask = (unsigned char) (1 << index);
+    this->root ().boundsMin = this->nodes[block + index].boundsMin;
+    this->root ().boundsMax = this->nodes[block + index].boundsMax;
+    this->nodes[block + index].parent = 0;
+  }
+
+  // inserts an element into the subtree of `node`, which must contain the element
+  void insertElement (unsigned int node, unsigned int index, const glm::vec3& position,
+                      float maxDimExtent)
+  {
+    assert (this->nodes[node].approxContains (position, maxDimExtent));
+
+    while (this->nodes[node].insertIntoChild (maxDimExtent))
+    {
+      node = this->makeChild (node, this->nodes[node].childIndex (position));
+      assert (this->nodes[node].approxContains (position, maxDimExtent));
+    }
+    this->setElementLocation (index, node, this->nodes[node].addElement (index));
+    this->extendBounds (node, position, maxDimExtent);
   }
 
   void addElement (unsigned int index, const glm::vec3& position, float maxDimExtent)
   {
     assert (this->hasRoot ());
 
-    if (this->root->approxContains (position, maxDimExtent))
+    if (this->root ().approxContains (position, maxDimExtent))
     {
-      IndexOctreeNode& node = this->root->addElement (index, position, maxDimExtent);
-      this->addToElementNodeMap (index, node);
+      this->insertElement (0, index, position, maxDimExtent);
     }
     else
     {
@@ -478,90 +562,424 @@ struct DynamicOctree::Impl
     }
   }
 
-  void realignElement (unsigned int index, const glm::vec3& position, float maxDimExtent)
+  /* Builds the octree from scratch: the root is sized to fit all elements at once, so that no
+   * parents have to be created.  The subtrees of the root's children are built concurrently and
+   * are spliced into the node array afterwards.  The new tree replaces the current tree only
+   * once it is complete.
+   */
+  void build (const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+              const std::vector<float>& maxDimExtents)
   {
-    assert (this->hasRoot ());
-    assert (index < this->elementNodeMap.size ());
-    assert (this->elementNodeMap[index]);
+    PROFILE_ZONE ("octree/build")
+    Impl octree;
+    octree.buildFromScratch (indices, positions, maxDimExtents);
+
+    this->nodes.swap (octree.nodes);
+    this->freeBlocks.swap (octree.freeBlocks);
+    this->elementLocations.swap (octree.elementLocations);
+  }
 
-    IndexOctreeNode* node = this->elementNodeMap[index];
+  void buildFromScratch (const std::vector<unsigned int>& indices,
+                         const std::vector<glm::vec3>&    positions,
+                         const std::vector<float>&        maxDimExtents)
+  {
+    assert (indices.size () == positions.size ());
+    assert (indices.size () == maxDimExtents.size ());
+    assert (this->hasRoot () == false);
 
-    if (node->approxContains (position, maxDimExtent) == false ||
-        node->insertIntoChild (maxDimExtent))
+    if (indices.empty ())
     {
-      this->deleteElement (index);
-      this->addElement (index, position, maxDimExtent);
+      return;
     }
-  }
 
-  void deleteElement (unsigned int index)
-  {
-    assert (index < this->elementNodeMap.size ());
-    assert (this->elementNodeMap[index]);
+    glm::vec3 min = positions[0];
+    glm::vec3 max = positions[0];
+    float     maxExtent = 0.0f;
+
+    for (unsigned int i = 0; i < indices.size (); i++)
+    {
+      min = glm::min (min, positions[i]);
+      max = glm::max (max, positions[i]);
+      maxExtent = glm::max (maxExtent, maxDimExtents[i]);
+    }
 
-    this->elementNodeMap[index]->deleteElement (index);
-    this->elementNodeMap[index] = nullptr;
+    const glm::vec3 extent = max - min;
+    const float     width = glm::max (glm::max (glm::max (extent.x, extent.y), extent.z),
+                                      glm::max (maxExtent, Util::epsilon ()));
 
-    if (this->hasRoot ())
+    this->setupRoot ((min + max) * 0.5f, width);
+
+    std::vector<unsigned int> childElements[8];
+    for (unsigned int i = 0; i < indices.size (); i++)
     {
-      if (this->root->isEmpty ())
+      if (this->root ().insertIntoChild (maxDimExtents[i]))
       {
-        this->root.reset ();
+        childElements[this->root ().childIndex (positions[i])].push_back (i);
       }
       else
       {
-        this->shrinkRoot ();
+        this->addElement (indices[i], positions[i], maxDimExtents[i]);
       }
     }
-  }
 
-  void deleteEmptyChildren ()
-  {
-    if (this->hasRoot ())
+    DynamicOctree::Impl subtrees[8];
+
+    ThreadPool::global ().parallelFor (8, 1, [&](unsigned int c, unsigned int) {
+      if (childElements[c].empty () == false)
+      {
+        subtrees[c].buildSubtree (this->root ().childCenter (c), this->root ().width * 0.5f,
+                                  this->root ().depth + 1, childElements[c], positions,
+                                  maxDimExtents);
+      }
+    });
+
+    for (unsigned int c = 0; c < 8; c++)
     {
-      if (this->root->deleteEmptyChildren ())
+      if (childElements[c].empty () == false)
       {
-        this->root.reset ();
+        this->attachSubtree (c, subtrees[c], childElements[c], indices);
       }
     }
   }
 
-  void updateIndices (const std::vector<unsigned int>& newIndices)
+  /* Builds a detached subtree, whose elements are identified by their position in `elements`.
+   * Elements are inserted in Morton order, so that blocks are allocated in the order of a
+   * depth-first traversal.
+   */
+  void buildSubtree (const glm::vec3& center, float width, int depth,
+                     const std::vector<unsigned int>& elements,
+                     const std::vector<glm::vec3>&    positions,
+                     const std::vector<float>&        maxDimExtents)
   {
-    for (unsigned int i = 0; i < newIndices.size (); i++)
-    {
-      const unsigned int newI = newIndices[i];
-      if (newI != Util::invalidIndex () && newI != i)
-      {
-        assert (i < this->elementNodeMap.size ());
-        assert (newI < this->elementNodeMap.size ());
-        assert (this->elementNodeMap[i]);
-        assert (this->elementNodeMap[newI] == nullptr);
+    assert (this->hasRoot () == false);
 
-        this->elementNodeMap[newI] = this->elementNodeMap[i];
-        this->elementNodeMap[i] = nullptr;
-      }
+    this->nodes.emplace_back ();
+    this->root ().setup (center, width, depth);
+
+    const glm::vec3 min = center - glm::vec3 (width * 0.5f);
+
+    std::vector<std::pair<uint64_t, unsigned int>> order;
+    order.reserve (elements.size ());
+
+    for (unsigned int i = 0; i < elements.size (); i++)
+    {
+      order.emplace_back (mortonCode ((positions[elements[i]] - min) / width), i);
     }
-    this->elementNodeMap.resize (newIndices.size ());
+    std::sort (order.begin (), order.end ());
 
-    if (this->hasRoot ())
+    for (const std::pair<uint64_t, unsigned int>& o : order)
     {
-      this->root->updateIndices (newIndices);
+      const glm::vec3& position = positions[elements[o.second]];
+      const float      maxDimExtent = maxDimExtents[elements[o.second]];
+
+      assert (this->root ().approxContains (position, maxDimExtent));
+      this->addElement (o.second, position, maxDimExtent);
     }
   }
 
-  void shrinkRoot ()
+  // moves the nodes of a subtree built by `buildSubtree` into the root's `childIndex`-th child
+  void attachSubtree (unsigned int childIndex, Impl& subtree,
+                      const std::vector<unsigned int>& elements,
+                      const std::vector<unsigned int>& indices)
   {
-    if (this->hasRoot () && this->root->indices.empty () && this->root->hasChildren ())
+    assert (subtree.hasRoot ());
+    assert (subtree.freeBlocks.empty ());
+    assert (this->root ().hasChild (childIndex) == false);
+
+    if (this->root ().firstChild == Util::invalidIndex ())
     {
-      int singleNonEmptyChildIndex = -1;
-      for (int i = 0; i < 8; i++)
+      const unsigned int block = this->allocateBlock ();
+      this->root ().firstChild = block;
+    }
+
+    const unsigned int target = this->root ().firstChild + childIndex;
+    const unsigned int offset = this->nodes.size () - 1;
+    const auto         mapNode = [target, offset](unsigned int n) {
+      return n == 0 ? target : n + offset;
+    };
+
+    this->nodes.resize (this->nodes.size () + subtree.nodes.size () - 1);
+    this->root ().childMask |= (unsigned char) (1 << childIndex);
+
+    for (unsigned int n = 0; n < subtree.nodes.size (); n++)
+    {
+      IndexOctreeNode& node = this->nodes[mapNode (n)];
+
+      node = std::move (subtree.nodes[n]);
+      node.parent = n == 0 ? 0 : mapNode (node.parent);
+      if (node.firstChild != Util::invalidIndex ())
       {
-        if (this->root->children[i] && this->root->children[i]->isEmpty () == false)
+        node.firstChild = mapNode (node.firstChild);
+      }
+      for (unsigned int& index : node.indices)
+      {
+        index = indices[elements[index]];
+      }
+    }
+
+    for (unsigned int i = 0; i < elements.size (); i++)
+    {
+      const ElementLocation& location = subtree.elementLocations[i];
+      this->setElementLocation (indices[elements[i]], mapNode (location.node), location.slot);
+    }
+    this->root ().extendBounds (this->nodes[target].boundsMin, this->nodes[target].boundsMax);
+  }
+
+  void realignElement (unsigned int index, const glm::vec3& position, float maxDimExtent)
+  {
+    assert (this->hasRoot ());
+    assert (index < this->elementLocations.size ());
+    assert (this->elementLocations[index].isValid ());
+
+    if (this->needsRealignment (index, position, maxDimExtent))
+    {
+      this->deleteElement (index);
+      this->addElement (index, position, maxDimExtent);
+    }
+    else
+    {
+      this->extendBounds (this->elementLocations[index].node, position, maxDimExtent);
+    }
+  }
+
+  bool needsRealignment (unsigned int index, const glm::vec3& position, float maxDimExtent) const
+  {
+    assert (index < this->elementLocations.size ());
+    assert (this->elementLocations[index].isValid ());
+
+    const IndexOctreeNode& node = this->nodes[this->elementLocations[index].node];
+
+    return node.approxContains (position, maxDimExtent) == false ||
+           node.insertIntoChild (maxDimExtent);
+  }
+
+  /* Realigns a batch of elements: elements that left their nodes are reinserted into the lowest
+   * existing node that contains all of them, instead of being reinserted from the root one by
+   * one.
+   */
+  void realignElements (const std::vector<unsigned int>& indices,
+                        const std::vector<glm::vec3>&    positions,
+                        const std::vector<float>&        maxDimExtents)
+  {
+    assert (this->hasRoot ());
+    assert (indices.size () == positions.size ());
+    assert (indices.size () == maxDimExtents.size ());
+
+    std::vector<unsigned int> moved;
+
+    for (unsigned int i = 0; i < indices.size (); i++)
+    {
+      if (this->needsRealignment (indices[i], positions[i], maxDimExtents[i]))
+      {
+        moved.push_back (i);
+      }
+      else
+      {
+        this->extendBounds (this->elementLocations[indices[i]].node, positions[i],
+                            maxDimExtents[i]);
+      }
+    }
+
+    if (moved.empty ())
+    {
+      return;
+    }
+
+    // deletions may shrink or reset the root, so the common node is found afterwards
+    for (unsigned int i : moved)
+    {
+      this->deleteElement (indices[i]);
+    }
+
+    if (this->hasRoot () == false)
+    {
+      this->setupRoot (positions[moved[0]], maxDimExtents[moved[0]]);
+    }
+
+    bool rootContainsAll = true;
+    for (unsigned int i : moved)
+    {
+      rootContainsAll = rootContainsAll &&
+                        this->root ().approxContains (positions[i], maxDimExtents[i]);
+    }
+
+    if (rootContainsAll == false)
+    {
+      for (unsigned int i : moved)
+      {
+        this->addElement (indices[i], positions[i], maxDimExtents[i]);
+      }
+      return;
+    }
+
+    unsigned int common = 0;
+    while (true)
+    {
+      const IndexOctreeNode& node = this->nodes[common];
+      const unsigned int     childIndex = node.childIndex (positions[moved[0]]);
+
+      if (node.hasChild (childIndex) == false)
+      {
+        break;
+      }
+
+      bool descend = true;
+      for (unsigned int i : moved)
+      {
+        if (node.insertIntoChild (maxDimExtents[i]) == false ||
+            node.childIndex (positions[i]) != childIndex)
+        {
+          descend = false;
+          break;
+        }
+      }
+
+      if (descend)
+      {
+        common = node.child (childIndex);
+      }
+      else
+      {
+        break;
+      }
+    }
+
+    for (unsigned int i : moved)
+    {
+      this->insertElement (common, indices[i], positions[i], maxDimExtents[i]);
+    }
+  }
+
+  void deleteElement (unsigned int index)
+  {
+    assert (index < this->elementLocations.size ());
+    assert (this->elementLocations[index].isValid ());
+
+    const ElementLocation location = this->elementLocations[index];
+    const unsigned int    moved = this->nodes[location.node].deleteElement (location.slot);
+
+    if (moved != Util::invalidIndex ())
+    {
+      assert (this->elementLocations[moved].node == location.node);
+      this->elementLocations[moved].slot = location.slot;
+    }
+    this->elementLocations[index] = ElementLocation ();
+
+    if (this->hasRoot ())
+    {
+      if (this->root ().isEmpty ())
+      {
+        this->resetNodes ();
+      }
+      else
+      {
+        this->shrinkRoot ();
+      }
+    }
+  }
+
+  bool deleteEmptyChildren (unsigned int node)
+  {
+    if (this->nodes[node].hasChildren ())
+    {
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        if (this->nodes[node].hasChild (i) &&
+            this->deleteEmptyChildren (this->nodes[node].child (i)))
+        {
+          this->nodes[node].childMask &= (unsigned char) ~(1 << i);
+        }
+      }
+      if (this->nodes[node].hasChildren () == false)
+      {
+        this->freeBlock (this->nodes[node].firstChild);
+        this->nodes[node].firstChild = Util::invalidIndex ();
+      }
+    }
+    return this->nodes[node].isEmpty ();
+  }
+
+  void deleteEmptyChildren ()
+  {
+    PROFILE_ZONE ("octree/delete-empty-children")
+    if (this->hasRoot ())
+    {
+      if (this->deleteEmptyChildren (0))
+      {
+        this->resetNodes ();
+      }
+    }
+  }
+
+  // renumbers a single element in place; trailing unused locations are dropped
+  void moveElement (unsigned int from, unsigned int to)
+  {
+    assert (from < this->elementLocations.size ());
+    assert (this->elementLocations[from].isValid ());
+
+    if (to >= this->elementLocations.size ())
+    {
+      this->elementLocations.resize (to + 1);
+    }
+    assert (this->elementLocations[to].isValid () == false);
+
+    const ElementLocation location = this->elementLocations[from];
+
+    this->nodes[location.node].indices[location.slot] = to;
+    this->elementLocations[to] = location;
+    this->elementLocations[from] = ElementLocation ();
+
+    while (this->elementLocations.empty () == false &&
+           this->elementLocations.back ().isValid () == false)
+    {
+      this->elementLocations.pop_back ();
+    }
+  }
+
+  void updateIndices (const std::vector<unsigned int>& newIndices)
+  {
+    PROFILE_ZONE ("octree/update-indices")
+    for (unsigned int i = 0; i < newIndices.size (); i++)
+    {
+      const unsigned int newI = newIndices[i];
+      if (newI != Util::invalidIndex () && newI != i)
+      {
+        assert (i < this->elementLocations.size ());
+        assert (newI < this->elementLocations.size ());
+        assert (this->elementLocations[i].isValid ());
+        assert (this->elementLocations[newI].isValid () == false);
+
+        this->elementLocations[newI] = this->elementLocations[i];
+        this->elementLocations[i] = ElementLocation ();
+      }
+    }
+    this->elementLocations.resize (newIndices.size ());
+
+    // element lists of unused nodes are always empty, so all nodes can be processed linearly
+    for (IndexOctreeNode& node : this->nodes)
+    {
+      for (unsigned int& i : node.indices)
+      {
+        assert (newIndices[i] != Util::invalidIndex ());
+        i = newIndices[i];
+      }
+    }
+  }
+
+  void shrinkRoot ()
+  {
+    PROFILE_ZONE ("octree/shrink-root")
+    if (this->hasRoot () && this->root ().indices.empty () && this->root ().hasChildren ())
+    {
+      int singleNonEmptyChildIndex = -1;
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        if (this->root ().hasChild (i) &&
+            this->nodes[this->root ().child (i)].isEmpty () == false)
         {
           if (singleNonEmptyChildIndex == -1)
           {
-            singleNonEmptyChildIndex = i;
+            singleNonEmptyChildIndex = int(i);
           }
           else
           {
@@ -571,87 +989,431 @@ struct DynamicOctree::Impl
       }
       if (singleNonEmptyChildIndex != -1)
       {
-        this->root = std::move (this->root->children[singleNonEmptyChildIndex]);
+        const unsigned int block = this->root ().firstChild;
+
+        this->moveNode (block + singleNonEmptyChildIndex, 0);
+        this->root ().parent = Util::invalidIndex ();
+        this->freeBlock (block);
         this->shrinkRoot ();
       }
     }
   }
 
+  void resetNodes ()
+  {
+    this->nodes.clear ();
+    this->freeBlocks.clear ();
+  }
+
   void reset ()
   {
-    this->root.reset ();
-    this->elementNodeMap.clear ();
-  }
-
-#ifdef DILAY_RENDER_OCTREE
-  void render (Camera& camera) const
-  {
-    Mesh nodeMesh;
-    nodeMesh.addVertex (glm::vec3 (-1.0f, -1.0f, -1.0f));
-    nodeMesh.addVertex (glm::vec3 (-1.0f, -1.0f, 1.0f));
-    nodeMesh.addVertex (glm::vec3 (-1.0f, 1.0f, -1.0f));
-    nodeMesh.addVertex (glm::vec3 (-1.0f, 1.0f, 1.0f));
-    nodeMesh.addVertex (glm::vec3 (1.0f, -1.0f, -1.0f));
-    nodeMesh.addVertex (glm::vec3 (1.0f, -1.0f, 1.0f));
-    nodeMesh.addVertex (glm::vec3 (1.0f, 1.0f, -1.0f));
-    nodeMesh.addVertex (glm::vec3 (1.0f, 1.0f, 1.0f));
-
-    nodeMesh.addIndex (0);
-    nodeMesh.addIndex (1);
-    nodeMesh.addIndex (1);
-    nodeMesh.addIndex (3);
-    nodeMesh.addIndex (3);
-    nodeMesh.addIndex (2);
-    nodeMesh.addIndex (2);
-    nodeMesh.addIndex (0);
-
-    nodeMesh.addIndex (4);
-    nodeMesh.addIndex (5);
-    nodeMesh.addIndex (5);
-    nodeMesh.addIndex (7);
-    nodeMesh.addIndex (7);
-    nodeMesh.addIndex (6);
-    nodeMesh.addIndex (6);
-    nodeMesh.addIndex (4);
-
-    nodeMesh.addIndex (1);
-    nodeMesh.addIndex (5);
-    nodeMesh.addIndex (5);
-    nodeMesh.addIndex (7);
-    nodeMesh.addIndex (7);
-    nodeMesh.addIndex (3);
-    nodeMesh.addIndex (3);
-    nodeMesh.addIndex (1);
-
-    nodeMesh.addIndex (4);
-    nodeMesh.addIndex (6);
-    nodeMesh.addIndex (6);
-    nodeMesh.addIndex (2);
-    nodeMesh.addIndex (2);
-    nodeMesh.addIndex (0);
-    nodeMesh.addIndex (0);
-    nodeMesh.addIndex (4);
-
-    nodeMesh.renderMode ().constantShading (true);
-    nodeMesh.renderMode ().noDepthTest (true);
-    nodeMesh.color (Color (1.0f, 1.0f, 0.0f));
-    nodeMesh.bufferData ();
+    this->resetNodes ();
+    this->elementLocations.clear ();
+  }
+
+  void toNodes (DynamicOctreeNodes& flat) const
+  {
+    flat.geometry.clear ();
+    flat.links.clear ();
+    flat.elements.clear ();
+    flat.geometry.reserve (this->nodes.size () * DynamicOctreeNodes::floatsPerNode);
+    flat.links.reserve (this->nodes.size () * DynamicOctreeNodes::wordsPerNode);
+    flat.elements.reserve (this->elementLocations.size ());
+
+    for (const IndexOctreeNode& node : this->nodes)
+    {
+      flat.geometry.insert (flat.geometry.end (),
+                            {node.center.x, node.center.y, node.center.z, node.width,
+                             node.boundsMin.x, node.boundsMin.y, node.boundsMin.z,
+                             node.boundsMax.x, node.boundsMax.y, node.boundsMax.z});
+      flat.links.insert (flat.links.end (),
+                         {(unsigned int) (node.depth), node.parent, node.firstChild,
+                          (unsigned int) (node.childMask), (unsigned int) (flat.elements.size ()),
+                          node.numElements ()});
+      flat.elements.insert (flat.elements.end (), node.indices.begin (), node.indices.end ());
+    }
+    flat.freeBlocks = this->freeBlocks;
+  }
+
+  // each element must be part of exactly one node
+  bool fromNodes (const DynamicOctreeNodes& flat, unsigned int numElements)
+  {
+    const unsigned int numNodes = flat.numNodes ();
+
+    if (flat.links.size () != numNodes * DynamicOctreeNodes::wordsPerNode ||
+        flat.geometry.size () != numNodes * DynamicOctreeNodes::floatsPerNode ||
+        flat.elements.size () != numElements || (numNodes == 0 && numElements > 0))
+    {
+      return false;
+    }
+
+    std::vector<IndexOctreeNode> nodes (numNodes);
+    std::vector<ElementLocation> locations (numElements);
+
+    for (unsigned int n = 0; n < numNodes; n++)
+    {
+      const float*        g = flat.geometry.data () + (n * DynamicOctreeNodes::floatsPerNode);
+      const unsigned int* l = flat.links.data () + (n * DynamicOctreeNodes::wordsPerNode);
+      IndexOctreeNode&    node = nodes[n];
+
+      const bool validParent = l[1] == Util::invalidIndex () || l[1] < numNodes;
+      const bool validChildren =
+        l[2] == Util::invalidIndex () ? l[3] == 0 : l[2] < numNodes && numNodes - l[2] >= 8;
+      const bool validElements = l[4] <= numElements && l[5] <= numElements - l[4];
+
+      if (validParent == false || validChildren == false || l[3] > 0xff ||
+          validElements == false || g[3] <= 0.0f)
+      {
+        return false;
+      }
+      node.center = glm::vec3 (g[0], g[1], g[2]);
+      node.width = g[3];
+      node.boundsMin = glm::vec3 (g[4], g[5], g[6]);
+      node.boundsMax = glm::vec3 (g[7], g[8], g[9]);
+      node.depth = int(l[0]);
+      node.parent = l[1];
+      node.firstChild = l[2];
+      node.childMask = (unsigned char) (l[3]);
+      node.indices.assign (flat.elements.begin () + l[4], flat.elements.begin () + l[4] + l[5]);
+
+      for (unsigned int slot = 0; slot < l[5]; slot++)
+      {
+        const unsigned int e = node.indices[slot];
+
+        if (e >= numElements || locations[e].isValid ())
+        {
+          return false;
+        }
+        locations[e].node = n;
+        locations[e].slot = slot;
+      }
+    }
+    for (unsigned int block : flat.freeBlocks)
+    {
+      if (block >= numNodes || numNodes - block < 8)
+      {
+        return false;
+      }
+    }
+    this->nodes.swap (nodes);
+    this->elementLocations.swap (locations);
+    this->freeBlocks = flat.freeBlocks;
+    return true;
+  }
+
+  unsigned int heat (const IndexOctreeNode& node, DynamicOctreeOverlay overlay) const
+  {
+    return overlay == DynamicOctreeOverlay::Visits ? node.visits.get () : node.numElements ();
+  }
+
+  unsigned int maxHeat (unsigned int n, DynamicOctreeOverlay overlay) const
+  {
+    const IndexOctreeNode& node = this->nodes[n];
+    unsigned int           max = this->heat (node, overlay);
+
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      if (node.hasChild (i))
+      {
+        max = glm::max (max, this->maxHeat (node.child (i), overlay));
+      }
+    }
+    return max;
+  }
+
+  /* Nodes are colored from blue to red by their share of the maximum, which is quantized such
+   * that the overlay batch draws few groups.  Visits are halved afterwards.
+   */
+  void render (OverlayBatch& overlay, unsigned int n, DynamicOctreeOverlay mode,
+               unsigned int maxHeat) const
+  {
+    static constexpr float numLevels = 8.0f;
+
+    const IndexOctreeNode& node = this->nodes[n];
+    const unsigned int     heat = this->heat (node, mode);
+
+    if (heat > 0)
+    {
+      const float     t = glm::ceil (numLevels * float(heat) / float(maxHeat)) / numLevels;
+      const glm::vec3 halfWidth (node.width * 0.5f);
+
+      overlay.box (node.center - halfWidth, node.center + halfWidth, Color (t, 0.2f, 1.0f - t),
+                   false);
+    }
+    if (mode == DynamicOctreeOverlay::Visits)
+    {
+      node.visits.halve ();
+    }
+
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      if (node.hasChild (i))
+      {
+        this->render (overlay, node.child (i), mode, maxHeat);
+      }
+    }
+  }
+
+  void render (Camera& camera, DynamicOctreeOverlay mode) const
+  {
+    if (this->hasRoot () && mode != DynamicOctreeOverlay::None)
+    {
+      const unsigned int maxHeat = this->maxHeat (0, mode);
+
+      if (maxHeat > 0)
+      {
+        this->render (camera.renderer ().overlay (), 0, mode, maxHeat);
+      }
+    }
+  }
 
+  void countVisits (bool value)
+  {
+    if (value != this->isCountingVisits)
+    {
+      for (IndexOctreeNode& node : this->nodes)
+      {
+        node.visits.reset ();
+      }
+      this->isCountingVisits = value;
+    }
+  }
+
+  void visit (const IndexOctreeNode& node) const
+  {
+    if (this->isCountingVisits)
+    {
+      node.visits.increment ();
+    }
+  }
+
+  template <typename T>
+  void containsOrIntersectsT (unsigned int n, const T& t,
+                              const DynamicOctree::ContainsIntersectionCallback& f) const
+  {
+    const IndexOctreeNode& node = this->nodes[n];
+    this->visit (node);
+
+    if (node.hasBounds () == false)
+    {
+      return;
+    }
+
+    const PrimAABox tightAABox = node.tightAABox ();
+    const bool      contains = t.contains (tightAABox);
+
+    if (contains || IntersectionUtil::intersects (t, tightAABox))
+    {
+      for (unsigned int index : node.indices)
+      {
+        f (contains, index);
+      }
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        if (node.hasChild (i))
+        {
+          this->containsOrIntersectsT<T> (node.child (i), t, f);
+        }
+      }
+    }
+  }
+
+  // a sphere is only tested against the children of nodes that it intersects
+  void intersects (unsigned int n, const PrimSphere& sphere1, const PrimSphere& sphere2, bool test1,
+                   bool test2, const DynamicOctree::SpheresIntersectionCallback& f) const
+  {
+    const IndexOctreeNode& node = this->nodes[n];
+    this->visit (node);
+
+    if (node.hasBounds () == false)
+    {
+      return;
+    }
+
+    const PrimAABox tightAABox = node.tightAABox ();
+    const bool      contains1 = test1 && sphere1.contains (tightAABox);
+    const bool      contains2 = test2 && sphere2.contains (tightAABox);
+    const bool      intersects1 =
+      contains1 || (test1 && IntersectionUtil::intersects (sphere1, tightAABox));
+    const bool intersects2 =
+      contains2 || (test2 && IntersectionUtil::intersects (sphere2, tightAABox));
+
+    if (intersects1 || intersects2)
+    {
+      for (unsigned int index : node.indices)
+      {
+        if (intersects1)
+        {
+          f (0, contains1, index);
+        }
+        if (intersects2)
+        {
+          f (1, contains2, index);
+        }
+      }
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        if (node.hasChild (i))
+        {
+          this->intersects (node.child (i), sphere1, sphere2, intersects1, intersects2, f);
+        }
+      }
+    }
+  }
+
+  /* Each node is classified once against the planes of the polytope whose half-spaces it
+   * straddles.  Planes that contain a node are not tested against its children, and the elements
+   * of a node that all planes contain are reported as contained.
+   */
+  void intersects (unsigned int n, const PrimConvexPolytope& polytope, std::uint32_t straddled,
+                   const DynamicOctree::ContainsIntersectionCallback& f) const
+  {
+    const IndexOctreeNode& node = this->nodes[n];
+    this->visit (node);
+
+    if (node.hasBounds () == false)
+    {
+      return;
+    }
+    else if (straddled != 0)
+    {
+      const PrimAABox tightAABox = node.tightAABox ();
+      const glm::vec3 halfWidth = tightAABox.halfWidth ();
+
+      for (unsigned int i = 0; i < polytope.planes ().size (); i++)
+      {
+        const std::uint32_t bit = std::uint32_t (1) << i;
+
+        if (straddled & bit)
+        {
+          const PrimPlane& plane = polytope.planes ()[i];
+          const float      r = glm::dot (halfWidth, glm::abs (plane.normal ()));
+          const float      d = plane.distance (tightAABox.center ());
+
+          if (d - r > 0.0f)
+          {
+            return;
+          }
+          else if (d + r <= 0.0f)
+          {
+            straddled &= ~bit;
+          }
+        }
+      }
+    }
+
+    for (unsigned int index : node.indices)
+    {
+      f (straddled == 0, index);
+    }
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      if (node.hasChild (i))
+      {
+        this->intersects (node.child (i), polytope, straddled, f);
+      }
+    }
+  }
+
+  template <typename T>
+  void intersectsT (unsigned int n, const T& t, const DynamicOctree::IntersectionCallback& f) const
+  {
+    const IndexOctreeNode& node = this->nodes[n];
+    this->visit (node);
+
+    if (node.hasBounds () && IntersectionUtil::intersects (t, node.tightAABox ()))
+    {
+      for (unsigned int index : node.indices)
+      {
+        f (index);
+      }
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        if (node.hasChild (i))
+        {
+          this->intersectsT<T> (node.child (i), t, f);
+        }
+      }
+    }
+  }
+
+  void intersects (unsigned int n, const PrimRay& ray, float& distance,
+                   const DynamicOctree::RayIntersectionCallback& f) const
+  {
+    const IndexOctreeNode& node = this->nodes[n];
+    float                  t;
+
+    this->visit (node);
+
+    if (node.hasBounds () && IntersectionUtil::intersects (ray, node.tightAABox (), &t) &&
+        t < distance)
+    {
+      if (node.indices.empty () == false)
+      {
+        distance = glm::min (f (node.indices), distance);
+      }
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        if (node.hasChild (i))
+        {
+          this->intersects (node.child (i), ray, distance, f);
+        }
+      }
+    }
+  }
+
+  void intersects (unsigned int n, RayPacket& packet, unsigned int begin, unsigned int end,
+                   const DynamicOctree::PacketRayIntersectionCallback& f) const
+  {
+    const IndexOctreeNode& node = this->nodes[n];
+    this->visit (node);
+
+    const unsigned int hitsBegin = end;
+    const unsigned int hitsEnd =
+      node.hasBounds () ? packet.cull (begin, end, node.boundsMin, node.boundsMax) : end;
+
+    if (hitsBegin < hitsEnd)
+    {
+      if (node.indices.empty () == false)
+      {
+        f (node.indices, &packet.active[hitsBegin], hitsEnd - hitsBegin,
+           packet.distances.data ());
+      }
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        if (node.hasChild (i))
+        {
+          this->intersects (node.child (i), packet, hitsBegin, hitsEnd, f);
+        }
+      }
+    }
+    packet.active.resize (hitsBegin);
+  }
+
+  void intersects (const PrimRay& ray, float upperBound,
+                   const DynamicOctree::RayIntersectionCallback& f) const
+  {
+    PROFILE_ZONE ("octree/ray")
     if (this->hasRoot ())
     {
-      this->root->render (camera, nodeMesh);
+      float distance = upperBound;
+      return this->intersects (0, ray, distance, f);
     }
   }
-#else
-  void render (Camera&) const { DILAY_IMPOSSIBLE }
-#endif
 
   void intersects (const PrimRay& ray, const DynamicOctree::RayIntersectionCallback& f) const
   {
-    if (this->hasRoot ())
+    return this->intersects (ray, Util::maxFloat (), f);
+  }
+
+  void intersects (const PrimRay* rays, unsigned int numRays,
+                   const DynamicOctree::PacketRayIntersectionCallback& f) const
+  {
+    PROFILE_ZONE ("octree/ray-packet")
+    if (this->hasRoot () && numRays > 0)
     {
-      float distance = Util::maxFloat ();
-      return this->root->intersects (ray, distance, f);
+      RayPacket packet (rays, numRays);
+      this->intersects (0, packet, 0, numRays, f);
     }
   }
 
@@ -659,16 +1421,17 @@ struct DynamicOctree::Impl
   {
     if (this->hasRoot ())
     {
-      return this->root->intersectsT<PrimPlane> (plane, f);
+      return this->intersectsT<PrimPlane> (0, plane, f);
     }
   }
 
   void intersects (const PrimSphere&                                  sphere,
                    const DynamicOctree::ContainsIntersectionCallback& f) const
   {
+    PROFILE_ZONE ("octree/sphere")
     if (this->hasRoot ())
     {
-      return this->root->containsOrIntersectsT<PrimSphere> (sphere, f);
+      return this->containsOrIntersectsT<PrimSphere> (0, sphere, f);
     }
   }
 
@@ -676,60 +1439,265 @@ struct DynamicOctree::Impl
   {
     if (this->hasRoot ())
     {
-      return this->root->containsOrIntersectsT<PrimAABox> (box, f);
+      return this->containsOrIntersectsT<PrimAABox> (0, box, f);
     }
   }
 
-  float distance (const glm::vec3& p, const DistanceCallback& getDistance) const
+  void intersects (const PrimSphere& sphere1, const PrimSphere& sphere2,
+                   const DynamicOctree::SpheresIntersectionCallback& f) const
+  {
+    PROFILE_ZONE ("octree/spheres")
+    if (this->hasRoot ())
+    {
+      this->intersects (0, sphere1, sphere2, true, true, f);
+    }
+  }
+
+  void intersects (const PrimConvexPolytope&                         polytope,
+                   const DynamicOctree::ContainsIntersectionCallback& f) const
+  {
+    if (this->hasRoot ())
+    {
+      const unsigned int numPlanes = polytope.planes ().size ();
+
+      assert (numPlanes <= PrimConvexPolytope::maxNumPlanes);
+      this->intersects (0, polytope,
+                        numPlanes == 32 ? ~std::uint32_t (0) : (std::uint32_t (1) << numPlanes) - 1,
+                        f);
+    }
+  }
+
+  // the subtree of a node that is completely inside the view frustum is not tested any further
+  void visibleElements (unsigned int n, const Camera& camera, const glm::mat4x4& model,
+                        bool isInside, const DynamicOctree::ElementsCallback& f) const
+  {
+    const IndexOctreeNode& node = this->nodes[n];
+
+    if (node.hasBounds () == false)
+    {
+      return;
+    }
+    else if (isInside || camera.isVisible (node.tightAABox (), model, &isInside))
+    {
+      if (node.indices.empty () == false)
+      {
+        f (node.indices);
+      }
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        if (node.hasChild (i))
+        {
+          this->visibleElements (node.child (i), camera, model, isInside, f);
+        }
+      }
+    }
+  }
+
+  void visibleElements (const Camera& camera, const glm::mat4x4& model,
+                        const DynamicOctree::ElementsCallback& f) const
+  {
+    if (this->hasRoot ())
+    {
+      this->visibleElements (0, camera, model, false, f);
+    }
+  }
+
+  /* Best-first search: nodes are visited in the order of their lower bound distances and the
+   * search terminates as soon as no remaining node can contain an element that is closer than
+   * the closest element found so far (or closer than `upperBound`).
+   */
+  float distance (const glm::vec3& p, float upperBound, const DistanceCallback& getDistance) const
   {
     assert (this->hasRoot ());
-    PrimSphere sphere (p, Util::maxFloat ());
-    this->root->distance (sphere, getDistance);
-    return sphere.radius ();
+
+    typedef std::pair<float, unsigned int> Candidate;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+
+    float distance = upperBound;
+    candidates.emplace (this->root ().lowerBoundDistance (p), 0);
+
+    while (candidates.empty () == false && candidates.top ().first < distance)
+    {
+      const IndexOctreeNode& node = this->nodes[candidates.top ().second];
+      this->visit (node);
+      candidates.pop ();
+
+      if (node.indices.empty () == false)
+      {
+        distance = glm::min (distance, getDistance (node.indices));
+      }
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        if (node.hasChild (i))
+        {
+          const float lowerBound = this->nodes[node.child (i)].lowerBoundDistance (p);
+          if (lowerBound < distance)
+          {
+            candidates.emplace (lowerBound, node.child (i));
+          }
+        }
+      }
+    }
+    return distance;
   }
 
-  void printStatistics () const
+  float distance (const glm::vec3& p, const DistanceCallback& getDistance) const
+  {
+    return this->distance (p, Util::maxFloat (), getDistance);
+  }
+
+  void forEachNode (unsigned int n, unsigned int parent, unsigned int& numVisited,
+                    const DynamicOctree::NodeCallback& f) const
+  {
+    const IndexOctreeNode& node = this->nodes[n];
+    const unsigned int     id = numVisited++;
+
+    f (parent, node.indices);
+
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      if (node.hasChild (i))
+      {
+        this->forEachNode (node.child (i), id, numVisited, f);
+      }
+    }
+  }
+
+  void forEachNode (const DynamicOctree::NodeCallback& f) const
   {
-    IndexOctreeStatistics stats{0,
-                                0,
-                                Util::maxInt (),
-                                Util::minInt (),
-                                0,
-                                IndexOctreeStatistics::DepthMap (),
-                                IndexOctreeStatistics::DepthMap ()};
     if (this->hasRoot ())
     {
-      this->root->updateStatistics (stats);
+      unsigned int numVisited = 0;
+      this->forEachNode (0, Util::invalidIndex (), numVisited, f);
+    }
+  }
+
+  void updateStatistics (unsigned int n, DynamicOctreeStatistics& stats) const
+  {
+    const IndexOctreeNode& node = this->nodes[n];
+
+    stats.numNodes += 1;
+    stats.numElements += node.numElements ();
+    stats.minDepth = glm::min (stats.minDepth, node.depth);
+    stats.maxDepth = glm::max (stats.maxDepth, node.depth);
+    stats.maxElementsPerNode = glm::max (stats.maxElementsPerNode, node.numElements ());
+
+    stats.numElementsPerDepth[node.depth] += node.numElements ();
+    stats.numNodesPerDepth[node.depth] += 1;
+
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      if (node.hasChild (i))
+      {
+        this->updateStatistics (node.child (i), stats);
+      }
     }
+  }
+
+  DynamicOctreeStatistics statistics () const
+  {
+    DynamicOctreeStatistics stats;
+
+    if (this->hasRoot ())
+    {
+      this->updateStatistics (0, stats);
+    }
+
+    stats.nodeMemory = this->nodeMemory ();
+    stats.elementMemory = this->elementMemory ();
+    return stats;
+  }
+
+  std::size_t nodeMemory () const
+  {
+    return (this->nodes.capacity () * sizeof (IndexOctreeNode)) +
+           (this->freeBlocks.capacity () * sizeof (unsigned int)) +
+           (this->elementLocations.capacity () * sizeof (ElementLocation));
+  }
+
+  std::size_t elementMemory () const
+  {
+    std::size_t n = 0;
+
+    for (const IndexOctreeNode& node : this->nodes)
+    {
+      n += node.indices.capacity () * sizeof (unsigned int);
+    }
+    return n;
+  }
+
+  std::size_t numBytes () const { return this->nodeMemory () + this->elementMemory (); }
+
+  void printStatistics () const
+  {
+    const DynamicOctreeStatistics stats = this->statistics ();
+
     std::cout << "octree:"
               << "\n\tnum nodes:\t\t\t" << stats.numNodes << "\n\tnum elements:\t\t\t"
               << stats.numElements << "\n\tmax elements per node:\t\t" << stats.maxElementsPerNode
               << "\n\tmin depth:\t\t\t" << stats.minDepth << "\n\tmax depth:\t\t\t"
               << stats.maxDepth << "\n\telements per node:\t\t"
-              << float(stats.numElements) / float(stats.numNodes) << std::endl;
+              << float(stats.numElements) / float(stats.numNodes) << "\n\tnode memory:\t\t\t"
+              << stats.nodeMemory << "\n\telement memory:\t\t\t" << stats.elementMemory
+              << std::endl;
   }
 };
 
+DynamicOctreeStatistics::DynamicOctreeStatistics ()
+  : numNodes (0)
+  , numElements (0)
+  , minDepth (Util::maxInt ())
+  , maxDepth (Util::minInt ())
+  , maxElementsPerNode (0)
+  , nodeMemory (0)
+  , elementMemory (0)
+{
+}
+
 DELEGATE_BIG4_COPY (DynamicOctree)
 
 DELEGATE_CONST (bool, DynamicOctree, hasRoot)
 DELEGATE2 (void, DynamicOctree, setupRoot, const glm::vec3&, float)
 DELEGATE3 (void, DynamicOctree, addElement, unsigned int, const glm::vec3&, float)
+DELEGATE3 (void, DynamicOctree, build, const std::vector<unsigned int>&,
+           const std::vector<glm::vec3>&, const std::vector<float>&)
 DELEGATE3 (void, DynamicOctree, realignElement, unsigned int, const glm::vec3&, float)
+DELEGATE3 (void, DynamicOctree, realignElements, const std::vector<unsigned int>&,
+           const std::vector<glm::vec3>&, const std::vector<float>&)
 DELEGATE1 (void, DynamicOctree, deleteElement, unsigned int)
 DELEGATE (void, DynamicOctree, deleteEmptyChildren)
+DELEGATE2 (void, DynamicOctree, moveElement, unsigned int, unsigned int)
 DELEGATE1 (void, DynamicOctree, updateIndices, const std::vector<unsigned int>&)
 DELEGATE (void, DynamicOctree, shrinkRoot)
 DELEGATE (void, DynamicOctree, reset)
-DELEGATE1_CONST (void, DynamicOctree, render, Camera&)
+DELEGATE1_CONST (void, DynamicOctree, toNodes, DynamicOctreeNodes&)
+DELEGATE2 (bool, DynamicOctree, fromNodes, const DynamicOctreeNodes&, unsigned int)
+DELEGATE2_CONST (void, DynamicOctree, render, Camera&, DynamicOctreeOverlay)
+DELEGATE1 (void, DynamicOctree, countVisits, bool)
 DELEGATE2_CONST (void, DynamicOctree, intersects, const PrimRay&,
                  const DynamicOctree::RayIntersectionCallback&)
+DELEGATE3_CONST (void, DynamicOctree, intersects, const PrimRay&, float,
+                 const DynamicOctree::RayIntersectionCallback&)
+DELEGATE3_CONST (void, DynamicOctree, intersects, const PrimRay*, unsigned int,
+                 const DynamicOctree::PacketRayIntersectionCallback&)
 DELEGATE2_CONST (void, DynamicOctree, intersects, const PrimPlane&,
                  const DynamicOctree::IntersectionCallback&)
 DELEGATE2_CONST (void, DynamicOctree, intersects, const PrimSphere&,
                  const DynamicOctree::ContainsIntersectionCallback&)
 DELEGATE2_CONST (void, DynamicOctree, intersects, const PrimAABox&,
                  const DynamicOctree::ContainsIntersectionCallback&)
+DELEGATE3_CONST (void, DynamicOctree, intersects, const PrimSphere&, const PrimSphere&,
+                 const DynamicOctree::SpheresIntersectionCallback&)
+DELEGATE2_CONST (void, DynamicOctree, intersects, const PrimConvexPolytope&,
+                 const DynamicOctree::ContainsIntersectionCallback&)
+DELEGATE3_CONST (void, DynamicOctree, visibleElements, const Camera&, const glm::mat4x4&,
+                 const DynamicOctree::ElementsCallback&)
 DELEGATE2_CONST (float, DynamicOctree, distance, const glm::vec3&,
                  const DynamicOctree::DistanceCallback&)
+DELEGATE3_CONST (float, DynamicOctree, distance, const glm::vec3&, float,
+                 const DynamicOctree::DistanceCallback&)
+DELEGATE1_CONST (void, DynamicOctree, forEachNode, const DynamicOctree::NodeCallback&)
+DELEGATE_CONST (PrimAABox, DynamicOctree, bounds)
+DELEGATE_CONST (DynamicOctreeStatistics, DynamicOctree, statistics)
+DELEGATE_CONST (std::size_t, DynamicOctree, numBytes)
 DELEGATE_CONST (void, DynamicOctree, printStatistics)
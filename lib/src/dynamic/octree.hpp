@@ -5,43 +5,143 @@
 #ifndef DILAY_DYNAMIC_OCTREE
 #define DILAY_DYNAMIC_OCTREE
 
+#include <cstddef>
 #include <functional>
 #include <glm/fwd.hpp>
+#include <map>
 #include <vector>
 #include "macro.hpp"
 
 class Camera;
 class PrimAABox;
+class PrimConvexPolytope;
 class PrimPlane;
 class PrimRay;
 class PrimSphere;
 
+struct DynamicOctreeStatistics
+{
+  typedef std::map<int, unsigned int> DepthMap;
+
+  unsigned int numNodes;
+  unsigned int numElements;
+  int          minDepth;
+  int          maxDepth;
+  unsigned int maxElementsPerNode;
+  DepthMap     numElementsPerDepth;
+  DepthMap     numNodesPerDepth;
+  std::size_t  nodeMemory;
+  std::size_t  elementMemory;
+
+  DynamicOctreeStatistics ();
+};
+
+/* Flat copy of the nodes of an octree (cf. `DynamicOctree::toNodes`), which is stored in binary
+ * files.  Node `n` consists of `floatsPerNode` values of `geometry` (its center, width and the
+ * bounds of its subtree) and `wordsPerNode` values of `links` (its depth, parent, first child,
+ * child mask and the range of its elements in `elements`).
+ */
+struct DynamicOctreeNodes
+{
+  static constexpr unsigned int floatsPerNode = 10;
+  static constexpr unsigned int wordsPerNode = 6;
+
+  std::vector<float>        geometry;
+  std::vector<unsigned int> links;
+  std::vector<unsigned int> elements;
+  std::vector<unsigned int> freeBlocks;
+
+  unsigned int numNodes () const { return this->links.size () / wordsPerNode; }
+};
+
+// how `DynamicOctree::render` colors nodes
+enum class DynamicOctreeOverlay
+{
+  None,
+  Visits,
+  Elements
+};
+
+/* Const member functions may be called concurrently, as long as no non-const member function
+ * is called at the same time.  `build` constructs the subtrees of the root's children
+ * concurrently.
+ */
 class DynamicOctree
 {
 public:
   DECLARE_BIG4_EXPLICIT_COPY (DynamicOctree)
 
-  typedef std::function<void(unsigned int)>       IntersectionCallback;
-  typedef std::function<float(unsigned int)>      RayIntersectionCallback;
-  typedef std::function<void(bool, unsigned int)> ContainsIntersectionCallback;
-  typedef std::function<float(unsigned int)>      DistanceCallback;
+  typedef std::function<void(unsigned int)>                      IntersectionCallback;
+  typedef std::function<float(const std::vector<unsigned int>&)> RayIntersectionCallback;
+  typedef std::function<void(bool, unsigned int)>                ContainsIntersectionCallback;
+  typedef std::function<float(const std::vector<unsigned int>&)> DistanceCallback;
+  typedef std::function<void(const std::vector<unsigned int>&)>  ElementsCallback;
+  typedef std::function<void(const std::vector<unsigned int>&, const unsigned int*, unsigned int,
+                             float*)>
+    PacketRayIntersectionCallback;
+  typedef std::function<void(unsigned int, bool, unsigned int)> SpheresIntersectionCallback;
+  typedef std::function<void(unsigned int, const std::vector<unsigned int>&)> NodeCallback;
 
   bool  hasRoot () const;
   void  setupRoot (const glm::vec3&, float);
   void  addElement (unsigned int, const glm::vec3&, float);
+  void  build (const std::vector<unsigned int>&, const std::vector<glm::vec3>&,
+               const std::vector<float>&);
   void  realignElement (unsigned int, const glm::vec3&, float);
+  void  realignElements (const std::vector<unsigned int>&, const std::vector<glm::vec3>&,
+                         const std::vector<float>&);
   void  deleteElement (unsigned int);
   void  deleteEmptyChildren ();
+  void  moveElement (unsigned int, unsigned int);
   void  updateIndices (const std::vector<unsigned int>&);
   void  shrinkRoot ();
   void  reset ();
-  void  render (Camera&) const;
+  void  toNodes (DynamicOctreeNodes&) const;
+  /* Replaces the octree by a copy of nodes whose elements are `[0, n)`.  Returns `false` without
+   * modifying the octree if the nodes are inconsistent.
+   */
+  bool  fromNodes (const DynamicOctreeNodes&, unsigned int);
+  /* Adds the nodes that were visited by queries or that have elements to the overlay batch of the
+   * camera's renderer.  Visits are halved afterwards, such that nodes of recent queries stand out.
+   */
+  void  render (Camera&, DynamicOctreeOverlay) const;
+  // counts the visits of nodes by queries, except of `visibleElements`
+  void  countVisits (bool);
+  /* Calls the callback with the elements of each node that is intersected by the ray.  The
+   * callback returns the distance of the nearest intersection among the elements.
+   */
   void  intersects (const PrimRay&, const RayIntersectionCallback&) const;
+  // elements whose nodes are farther away than the given upper bound are skipped
+  void  intersects (const PrimRay&, float, const RayIntersectionCallback&) const;
+  /* Calls the callback with the elements of each node and the indices of the rays that intersect
+   * it.  The callback lowers the distances of these rays to their nearest intersection.
+   */
+  void  intersects (const PrimRay*, unsigned int, const PacketRayIntersectionCallback&) const;
   void  intersects (const PrimPlane&, const IntersectionCallback&) const;
   void  intersects (const PrimSphere&, const ContainsIntersectionCallback&) const;
   void  intersects (const PrimAABox&, const ContainsIntersectionCallback&) const;
+  /* Intersects two spheres in a single traversal.  The callback is called with the index of the
+   * sphere (0 or 1), whether the element's node is contained in it, and the element.
+   */
+  void  intersects (const PrimSphere&, const PrimSphere&, const SpheresIntersectionCallback&) const;
+  void  intersects (const PrimConvexPolytope&, const ContainsIntersectionCallback&) const;
+  // calls the callback with the elements of each node that may be visible
+  void  visibleElements (const Camera&, const glm::mat4x4&, const ElementsCallback&) const;
+  /* Calls the callback with the elements of each node that may contain the nearest element.  The
+   * callback returns the distance of the nearest element among them.
+   */
   float distance (const glm::vec3&, const DistanceCallback&) const;
-  void  printStatistics () const;
+  float distance (const glm::vec3&, float, const DistanceCallback&) const;
+  /* Calls the callback with the parent and the elements of each node in depth-first order, in
+   * which nodes are numbered from 0.  The parent of the root is `Util::invalidIndex ()`.
+   */
+  void  forEachNode (const NodeCallback&) const;
+  // conservative bounds of all elements
+  PrimAABox               bounds () const;
+  DynamicOctreeStatistics statistics () const;
+  // memory of nodes and elements, without traversing the tree as `statistics` does
+  std::size_t             numBytes () const;
+  void                    printStatistics () const;
 
 private:
   IMPLEMENTATION
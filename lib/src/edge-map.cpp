@@ -0,0 +1,193 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include "edge-map.hpp"
+#include "util.hpp"
+
+namespace
+{
+  constexpr unsigned int  minNumSlots = 64;
+  constexpr std::uint64_t emptyKey = ~std::uint64_t (0);
+
+  std::uint64_t makeKey (unsigned int i1, unsigned int i2)
+  {
+    assert (i1 != i2);
+    return (std::uint64_t (glm::min (i1, i2)) << 32) | std::uint64_t (glm::max (i1, i2));
+  }
+
+  // cf. the finalizer of MurmurHash3, which spreads the bits of both indices over all bits
+  std::uint64_t mix (std::uint64_t key)
+  {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    key ^= key >> 33;
+    return key;
+  }
+}
+
+unsigned int EdgeTable::insert (unsigned int i1, unsigned int i2, bool& inserted)
+{
+  const std::uint64_t key = makeKey (i1, i2);
+
+  if (2 * (this->usedSlots.size () + 1) > this->slots.size ())
+  {
+    this->rehash (glm::max (minNumSlots, 2 * (unsigned int) this->slots.size ()));
+  }
+
+  const unsigned int slot = this->findSlot (key);
+
+  inserted = this->slots[slot].key == emptyKey;
+  if (inserted)
+  {
+    this->slots[slot].key = key;
+    this->slots[slot].value = Util::invalidIndex ();
+    this->usedSlots.push_back (slot);
+  }
+  return slot;
+}
+
+unsigned int EdgeTable::find (unsigned int i1, unsigned int i2) const
+{
+  if (this->slots.empty ())
+  {
+    return Util::invalidIndex ();
+  }
+  else
+  {
+    const unsigned int slot = this->findSlot (makeKey (i1, i2));
+
+    return this->slots[slot].key == emptyKey ? Util::invalidIndex () : slot;
+  }
+}
+
+void EdgeTable::reserve (unsigned int numElements)
+{
+  unsigned int numSlots = minNumSlots;
+  while (numSlots < 2 * numElements)
+  {
+    numSlots *= 2;
+  }
+  if (numSlots > this->slots.size ())
+  {
+    this->rehash (numSlots);
+  }
+  this->usedSlots.reserve (numElements);
+}
+
+void EdgeTable::reset ()
+{
+  for (unsigned int slot : this->usedSlots)
+  {
+    this->slots[slot].key = emptyKey;
+  }
+  this->usedSlots.clear ();
+}
+
+EdgeTable::Edge EdgeTable::edge (unsigned int slot) const
+{
+  const std::uint64_t key = this->slots[slot].key;
+
+  return Edge ((unsigned int) (key >> 32), (unsigned int) (key));
+}
+
+// returns the slot of `key` or the empty slot where it would be inserted
+unsigned int EdgeTable::findSlot (std::uint64_t key) const
+{
+  assert (this->slots.empty () == false);
+
+  const unsigned int mask = this->slots.size () - 1;
+  unsigned int       slot = (unsigned int) (mix (key)) & mask;
+
+  while (this->slots[slot].key != emptyKey && this->slots[slot].key != key)
+  {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+void EdgeTable::rehash (unsigned int numSlots)
+{
+  std::vector<Slot>         oldSlots (std::move (this->slots));
+  std::vector<unsigned int> oldUsedSlots (std::move (this->usedSlots));
+
+  this->slots.clear ();
+  this->slots.resize (numSlots, Slot{emptyKey, 0});
+  this->usedSlots.clear ();
+  this->usedSlots.reserve (oldUsedSlots.capacity ());
+
+  for (unsigned int oldSlot : oldUsedSlots)
+  {
+    const unsigned int slot = this->findSlot (oldSlots[oldSlot].key);
+
+    this->slots[slot] = oldSlots[oldSlot];
+    this->usedSlots.push_back (slot);
+  }
+}
+
+void EdgeMap::insert (unsigned int i1, unsigned int i2, unsigned int value)
+{
+  bool               inserted;
+  const unsigned int slot = this->table.insert (i1, i2, inserted);
+
+  assert (inserted);
+  unused (inserted);
+  this->table.value (slot) = value;
+}
+
+unsigned int EdgeMap::findOrInsert (unsigned int i1, unsigned int i2, unsigned int value,
+                                    bool& inserted)
+{
+  const unsigned int slot = this->table.insert (i1, i2, inserted);
+
+  if (inserted)
+  {
+    this->table.value (slot) = value;
+  }
+  return this->table.value (slot);
+}
+
+unsigned int EdgeMap::find (unsigned int i1, unsigned int i2) const
+{
+  const unsigned int slot = this->table.find (i1, i2);
+
+  return slot == Util::invalidIndex () ? Util::invalidIndex () : this->table.value (slot);
+}
+
+bool EdgeMap::contains (unsigned int i1, unsigned int i2) const
+{
+  return this->find (i1, i2) != Util::invalidIndex ();
+}
+
+bool EdgeMap::isEmpty () const { return this->table.numElements () == 0; }
+
+void EdgeMap::reserve (unsigned int numElements) { this->table.reserve (numElements); }
+
+void EdgeMap::reset () { this->table.reset (); }
+
+void EdgeSet::insert (unsigned int i1, unsigned int i2)
+{
+  bool               inserted;
+  const unsigned int slot = this->table.insert (i1, i2, inserted);
+
+  if (inserted)
+  {
+    this->edges.push_back (this->table.edge (slot));
+  }
+}
+
+bool EdgeSet::contains (unsigned int i1, unsigned int i2) const
+{
+  return this->table.find (i1, i2) != Util::invalidIndex ();
+}
+
+bool EdgeSet::isEmpty () const { return this->edges.empty (); }
+
+void EdgeSet::reset ()
+{
+  this->table.reset ();
+  this->edges.clear ();
+}
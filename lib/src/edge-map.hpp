@@ -0,0 +1,83 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_EDGE_MAP
+#define DILAY_EDGE_MAP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/* Open-addressing hash table of undirected edges, each of which is stored as a single 64-bit key
+ * of its smaller and its larger vertex index.  Resetting the table only clears the slots in use
+ * and keeps its storage, so a table that is reused does not allocate once it has grown large
+ * enough.
+ */
+class EdgeTable
+{
+public:
+  typedef std::pair<unsigned int, unsigned int> Edge;
+
+  // returns the index of the edge's slot, which is inserted if it is not contained yet
+  unsigned int insert (unsigned int, unsigned int, bool&);
+  unsigned int find (unsigned int, unsigned int) const;
+  unsigned int numElements () const { return this->usedSlots.size (); }
+  // prepares the table for a number of elements
+  void         reserve (unsigned int);
+  void         reset ();
+
+  Edge          edge (unsigned int slot) const;
+  unsigned int  value (unsigned int slot) const { return this->slots[slot].value; }
+  unsigned int& value (unsigned int slot) { return this->slots[slot].value; }
+
+private:
+  struct Slot
+  {
+    std::uint64_t key;
+    unsigned int  value;
+  };
+
+  unsigned int findSlot (std::uint64_t) const;
+  void         rehash (unsigned int);
+
+  std::vector<Slot>         slots;
+  std::vector<unsigned int> usedSlots;
+};
+
+class EdgeMap
+{
+public:
+  void         insert (unsigned int, unsigned int, unsigned int);
+  // returns the value of the edge, which is inserted with `value` if it is not contained yet
+  unsigned int findOrInsert (unsigned int, unsigned int, unsigned int value, bool&);
+  unsigned int find (unsigned int, unsigned int) const;
+  bool         contains (unsigned int, unsigned int) const;
+  bool         isEmpty () const;
+  void         reserve (unsigned int);
+  void         reset ();
+
+private:
+  EdgeTable table;
+};
+
+class EdgeSet
+{
+public:
+  typedef std::vector<EdgeTable::Edge> Edges;
+
+  void insert (unsigned int, unsigned int);
+  bool contains (unsigned int, unsigned int) const;
+  bool isEmpty () const;
+  void reset ();
+
+  // edges in the order of their insertion
+  Edges::const_iterator begin () const { return this->edges.begin (); }
+  Edges::const_iterator end () const { return this->edges.end (); }
+
+private:
+  EdgeTable table;
+  Edges     edges;
+};
+
+#endif
@@ -2,12 +2,18 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <cstdio>
+#include <iterator>
 #include <list>
+#include <memory>
+#include <thread>
 #include <vector>
 #include "config.hpp"
 #include "dynamic/mesh.hpp"
 #include "history.hpp"
+#include "log.hpp"
 #include "maybe.hpp"
+#include "memory-report.hpp"
 #include "mesh.hpp"
 #include "scene.hpp"
 #include "sketch/mesh.hpp"
@@ -20,57 +26,199 @@ namespace
   {
     bool snapshotDynamicMeshes;
     bool snapshotSketchMeshes;
+    bool recordDynamicMeshes;
 
-    SnapshotConfig (bool d, bool s)
+    SnapshotConfig (bool d, bool s, bool r = false)
       : snapshotDynamicMeshes (d)
       , snapshotSketchMeshes (s)
+      , recordDynamicMeshes (r)
     {
-      assert (this->snapshotDynamicMeshes || this->snapshotSketchMeshes);
+      assert (this->snapshotDynamicMeshes || this->snapshotSketchMeshes ||
+              this->recordDynamicMeshes);
+      assert (this->recordDynamicMeshes == false || this->snapshotDynamicMeshes == false);
     }
   };
 
+  typedef std::vector<std::shared_ptr<const DynamicMesh>> DynamicMeshCopies;
+
+  /* A snapshot either copies meshes or records deltas of all dynamic meshes.  Deltas are stored
+   * in the order of the meshes in the scene, which is the same whenever a snapshot is undone or
+   * redone.
+   */
   struct SceneSnapshot
   {
-    const SnapshotConfig   config;
-    std::list<DynamicMesh> dynamicMeshes;
-    std::list<SketchMesh>  sketchMeshes;
+    const SnapshotConfig        config;
+    DynamicMeshCopies           dynamicMeshes;
+    std::vector<SketchMesh>     sketchMeshes;
+    std::list<DynamicMeshDelta> dynamicMeshDeltas;
+    long                        spillOffset; // negative if the deltas are kept in memory
+    std::size_t                 spillSize;
 
     SceneSnapshot (const SnapshotConfig& c)
       : config (c)
+      , spillOffset (-1)
+      , spillSize (0)
+    {
+    }
+
+    bool isSpilled () const { return this->spillOffset >= 0; }
+
+    std::size_t numDeltaBytes () const
+    {
+      std::size_t n = 0;
+      for (const DynamicMeshDelta& delta : this->dynamicMeshDeltas)
+      {
+        n += delta.numBytes ();
+      }
+      return n;
+    }
+  };
+
+  /* Temporary file that packed deltas of old snapshots are moved to, once the deltas in memory
+   * exceed `editor/undo-memory-budget`.  The file is removed when it is closed.
+   */
+  class SpillFile
+  {
+  public:
+    SpillFile ()
+      : file (nullptr)
+    {
+    }
+
+    SpillFile (const SpillFile&) = delete;
+
+    SpillFile (SpillFile&& source)
+      : file (source.file)
+    {
+      source.file = nullptr;
+    }
+
+    ~SpillFile () { this->close (); }
+
+    bool isOpen () const { return this->file != nullptr; }
+
+    bool write (const std::vector<char>& data, long& offset)
+    {
+      if (this->file == nullptr)
+      {
+        this->file = std::tmpfile ();
+      }
+      if (this->file == nullptr || std::fseek (this->file, 0, SEEK_END) != 0)
+      {
+        return false;
+      }
+      offset = std::ftell (this->file);
+      return offset >= 0 && std::fwrite (data.data (), 1, data.size (), this->file) == data.size ();
+    }
+
+    bool read (long offset, std::vector<char>& data)
+    {
+      return this->file && std::fseek (this->file, offset, SEEK_SET) == 0 &&
+             std::fread (data.data (), 1, data.size (), this->file) == data.size ();
+    }
+
+    void close ()
     {
+      if (this->file)
+      {
+        std::fclose (this->file);
+        this->file = nullptr;
+      }
     }
+
+  private:
+    std::FILE* file;
   };
 
   typedef std::list<SceneSnapshot> Timeline;
 
-  SceneSnapshot sceneSnapshot (const Scene& scene, const SnapshotConfig& config)
+  // geometries are compared by revision, which is shared by copies with the same geometry
+  bool isUnchanged (const DynamicMesh& copy, const DynamicMesh& mesh)
+  {
+    return copy.revision () == mesh.revision () && copy.position () == mesh.position () &&
+           copy.scaling () == mesh.scaling () && copy.rotationMatrix () == mesh.rotationMatrix ();
+  }
+
+  /* Copies of meshes that are unchanged since they have been copied for a neighbouring snapshot
+   * are shared with that snapshot, such that an operation only copies the meshes it modifies.
+   */
+  SceneSnapshot sceneSnapshot (const Scene& scene, const SnapshotConfig& config,
+                               const SceneSnapshot* neighbour)
   {
     SceneSnapshot snapshot (config);
 
     if (config.snapshotDynamicMeshes)
     {
-      scene.forEachConstMesh (
-        [&snapshot](const DynamicMesh& mesh) { snapshot.dynamicMeshes.emplace_back (mesh); });
+      snapshot.dynamicMeshes.reserve (scene.numDynamicMeshes ());
+      scene.forEachConstMesh ([&snapshot, neighbour](const DynamicMesh& mesh) {
+        if (neighbour)
+        {
+          for (const std::shared_ptr<const DynamicMesh>& copy : neighbour->dynamicMeshes)
+          {
+            if (isUnchanged (*copy, mesh))
+            {
+              snapshot.dynamicMeshes.push_back (copy);
+              return;
+            }
+          }
+        }
+        snapshot.dynamicMeshes.push_back (std::make_shared<DynamicMesh> (mesh));
+      });
     }
     if (config.snapshotSketchMeshes)
     {
+      snapshot.sketchMeshes.reserve (scene.numSketchMeshes ());
       scene.forEachConstMesh (
         [&snapshot](const SketchMesh& mesh) { snapshot.sketchMeshes.emplace_back (mesh); });
     }
     return snapshot;
   }
 
+  void applyDeltas (SceneSnapshot& snapshot, Scene& scene)
+  {
+    assert (snapshot.config.recordDynamicMeshes);
+
+    auto delta = snapshot.dynamicMeshDeltas.begin ();
+    scene.forEachMesh ([&snapshot, &delta](DynamicMesh& mesh) {
+      assert (delta != snapshot.dynamicMeshDeltas.end ());
+
+      if (delta->isEmpty () == false)
+      {
+        mesh.applyDelta (*delta);
+        mesh.bufferData ();
+      }
+      ++delta;
+    });
+    assert (delta == snapshot.dynamicMeshDeltas.end ());
+  }
+
   void resetToSnapshot (const SceneSnapshot& snapshot, State& state)
   {
     Scene& scene = state.scene ();
 
     if (snapshot.config.snapshotDynamicMeshes)
     {
-      scene.deleteDynamicMeshes ();
+      if (scene.numDynamicMeshes () == snapshot.dynamicMeshes.size ())
+      {
+        std::vector<DynamicMesh*> meshes;
+        scene.forEachMesh ([&meshes](DynamicMesh& mesh) { meshes.push_back (&mesh); });
 
-      for (const DynamicMesh& mesh : snapshot.dynamicMeshes)
+        for (unsigned int i = 0; i < meshes.size (); i++)
+        {
+          if (isUnchanged (*snapshot.dynamicMeshes[i], *meshes[i]) == false)
+          {
+            scene.replaceMesh (state.config (), *meshes[i], *snapshot.dynamicMeshes[i]);
+          }
+        }
+      }
+      else
       {
-        scene.newDynamicMesh (state.config (), mesh);
+        scene.deleteDynamicMeshes ();
+
+        for (const std::shared_ptr<const DynamicMesh>& mesh : snapshot.dynamicMeshes)
+        {
+          scene.newDynamicMesh (state.config (), *mesh);
+        }
       }
     }
     if (snapshot.config.snapshotSketchMeshes)
@@ -85,14 +233,44 @@ namespace
   }
 }
 
+/* Once recording stops, e.g. when a stroke is released, dropped snapshots are destroyed and the
+ * oldest snapshots are spilled on a background thread.  Until the thread is finished, snapshots
+ * may be added to and dropped from the timelines, but only the most recent snapshots may be
+ * accessed.  Dropped snapshots are kept until the next finalization, such that starting a stroke
+ * neither waits for the thread nor destroys copies of meshes.  They are destroyed on the calling
+ * thread, since copies of sketch meshes may release OpenGL buffers.
+ */
 struct History::Impl
 {
-  unsigned int undoDepth;
-  Timeline     past;
-  Timeline     future;
+  unsigned int              undoDepth;
+  std::size_t               memoryBudget;
+  Timeline                  past;
+  Timeline                  future;
+  Timeline                  dropped;
+  std::vector<DynamicMesh*> recordingMeshes;
+  SpillFile                 spillFile;
+
+  // lazily copied meshes of the snapshot that is currently recorded
+  mutable std::list<DynamicMesh> recentMeshes;
+  mutable std::thread            thread;
 
   Impl (const Config& config) { this->runFromConfig (config); }
 
+  ~Impl () { this->finish (); }
+
+  void finish () const
+  {
+    if (this->thread.joinable ())
+    {
+      this->thread.join ();
+    }
+  }
+
+  void drop (Timeline& timeline, Timeline::iterator snapshot)
+  {
+    this->dropped.splice (this->dropped.end (), timeline, snapshot);
+  }
+
   void snapshotAll (const Scene& scene) { this->snapshot (scene, SnapshotConfig (true, true)); }
 
   void snapshotDynamicMeshes (const Scene& scene)
@@ -105,24 +283,193 @@ struct History::Impl
     this->snapshot (scene, SnapshotConfig (false, true));
   }
 
+  void snapshotDynamicMeshDeltas (Scene& scene)
+  {
+    this->snapshot (scene, SnapshotConfig (false, false, true));
+
+    SceneSnapshot& snapshot = this->past.front ();
+    scene.forEachMesh ([this, &snapshot](DynamicMesh& mesh) {
+      snapshot.dynamicMeshDeltas.emplace_back ();
+      mesh.recordDelta (&snapshot.dynamicMeshDeltas.back ());
+      this->recordingMeshes.push_back (&mesh);
+    });
+  }
+
   void snapshot (const Scene& scene, const SnapshotConfig& config)
   {
     assert (undoDepth > 0);
 
-    this->future.clear ();
+    this->stopRecording ();
+    this->dropped.splice (this->dropped.end (), this->future);
 
     while (this->past.size () >= this->undoDepth)
     {
-      this->past.pop_back ();
+      this->drop (this->past, std::prev (this->past.end ()));
+    }
+    this->past.push_front (
+      sceneSnapshot (scene, config, this->past.empty () ? nullptr : &this->past.front ()));
+  }
+
+  bool isRecording () const { return this->recordingMeshes.empty () == false; }
+
+  void stopRecording ()
+  {
+    if (this->isRecording ())
+    {
+      for (DynamicMesh* mesh : this->recordingMeshes)
+      {
+        mesh->recordDelta (nullptr);
+      }
+      this->recordingMeshes.clear ();
+      this->recentMeshes.clear ();
+      this->finalizeInBackground ();
+    }
+  }
+
+  void finalizeInBackground ()
+  {
+    this->finish ();
+
+    const std::vector<SceneSnapshot*> snapshots = this->snapshotsToSpill ();
+
+    this->dropped.clear ();
+    this->thread = std::thread ([this, snapshots]() {
+      for (SceneSnapshot* snapshot : snapshots)
+      {
+        if (this->spill (*snapshot) == false)
+        {
+          break;
+        }
+      }
+    });
+  }
+
+  bool spill (SceneSnapshot& snapshot)
+  {
+    assert (snapshot.isSpilled () == false);
+
+    std::vector<char> buffer;
+    for (DynamicMeshDelta& delta : snapshot.dynamicMeshDeltas)
+    {
+      delta.pack (buffer);
+    }
+
+    if (this->spillFile.write (buffer, snapshot.spillOffset))
+    {
+      snapshot.spillSize = buffer.size ();
+      return true;
+    }
+    else
+    {
+      DILAY_WARN ("could not move undo history to a temporary file");
+      snapshot.spillOffset = -1;
+      this->unpack (snapshot, buffer);
+      return false;
+    }
+  }
+
+  void unpack (SceneSnapshot& snapshot, const std::vector<char>& buffer)
+  {
+    const char* data = buffer.data ();
+    for (DynamicMeshDelta& delta : snapshot.dynamicMeshDeltas)
+    {
+      data = delta.unpack (data);
+    }
+    assert (data == buffer.data () + buffer.size ());
+  }
+
+  bool load (SceneSnapshot& snapshot)
+  {
+    if (snapshot.isSpilled ())
+    {
+      std::vector<char> buffer (snapshot.spillSize);
+
+      if (this->spillFile.read (snapshot.spillOffset, buffer) == false)
+      {
+        DILAY_WARN ("could not read undo history from a temporary file");
+        return false;
+      }
+      this->unpack (snapshot, buffer);
+      snapshot.spillOffset = -1;
+    }
+    return true;
+  }
+
+  // the oldest snapshots that exceed the memory budget, except the ones undone or redone next
+  std::vector<SceneSnapshot*> snapshotsToSpill ()
+  {
+    std::vector<SceneSnapshot*> snapshots;
+    std::size_t                 memory = 0;
+    bool                        hasSpilled = false;
+
+    const auto count = [&memory, &hasSpilled](const Timeline& timeline) {
+      for (const SceneSnapshot& s : timeline)
+      {
+        memory += s.isSpilled () ? 0 : s.numDeltaBytes ();
+        hasSpilled = hasSpilled || s.isSpilled ();
+      }
+    };
+    count (this->past);
+    count (this->future);
+
+    if (hasSpilled == false)
+    {
+      this->spillFile.close ();
+    }
+
+    const auto spillOldest = [this, &memory, &snapshots](Timeline& timeline) {
+      for (auto it = timeline.rbegin (); it != timeline.rend () && memory > this->memoryBudget;
+           ++it)
+      {
+        if (std::next (it) != timeline.rend () && it->config.recordDynamicMeshes &&
+            it->isSpilled () == false)
+        {
+          snapshots.push_back (&*it);
+          memory -= it->numDeltaBytes ();
+        }
+      }
+    };
+    if (this->memoryBudget > 0)
+    {
+      spillOldest (this->past);
+      spillOldest (this->future);
+    }
+    return snapshots;
+  }
+
+  /* Replaces the recorded snapshot by copies of the meshes as they were before recording, e.g.
+   * before a recorded mesh is deleted.
+   */
+  void resolveDynamicMeshDeltas ()
+  {
+    if (this->isRecording ())
+    {
+      SceneSnapshot snapshot (SnapshotConfig (true, false));
+      auto          delta = this->past.front ().dynamicMeshDeltas.begin ();
+
+      for (DynamicMesh* mesh : this->recordingMeshes)
+      {
+        mesh->recordDelta (nullptr);
+        std::shared_ptr<DynamicMesh> copy = std::make_shared<DynamicMesh> (*mesh);
+
+        copy->applyDelta (*delta);
+        snapshot.dynamicMeshes.push_back (copy);
+        ++delta;
+      }
+      this->recordingMeshes.clear ();
+      this->recentMeshes.clear ();
+      this->drop (this->past, this->past.begin ());
+      this->past.push_front (std::move (snapshot));
     }
-    this->past.push_front (sceneSnapshot (scene, config));
   }
 
   void dropPastSnapshot ()
   {
+    this->stopRecording ();
+
     if (this->past.empty () == false)
     {
-      this->past.pop_front ();
+      this->drop (this->past, this->past.begin ());
     }
   }
 
@@ -130,65 +477,161 @@ struct History::Impl
   {
     if (this->future.empty () == false)
     {
-      this->future.pop_front ();
+      this->drop (this->future, this->future.begin ());
     }
   }
 
   void undo (State& state)
   {
+    this->stopRecording ();
+    this->finish ();
+
     if (this->past.empty () == false)
     {
       const SnapshotConfig& config = this->past.front ().config;
 
-      this->future.push_front (sceneSnapshot (state.scene (), config));
-      resetToSnapshot (this->past.front (), state);
-      this->past.pop_front ();
+      if (config.recordDynamicMeshes)
+      {
+        if (this->load (this->past.front ()) == false)
+        {
+          this->reset ();
+          return;
+        }
+        applyDeltas (this->past.front (), state.scene ());
+        this->future.splice (this->future.begin (), this->past, this->past.begin ());
+      }
+      else
+      {
+        this->future.push_front (sceneSnapshot (state.scene (), config, &this->past.front ()));
+        resetToSnapshot (this->past.front (), state);
+        this->past.pop_front ();
+      }
     }
   }
 
   void redo (State& state)
   {
+    this->stopRecording ();
+    this->finish ();
+
     if (this->future.empty () == false)
     {
       const SnapshotConfig& config = this->future.front ().config;
 
-      this->past.push_front (sceneSnapshot (state.scene (), config));
-      resetToSnapshot (this->future.front (), state);
-      this->future.pop_front ();
+      if (config.recordDynamicMeshes)
+      {
+        if (this->load (this->future.front ()) == false)
+        {
+          this->reset ();
+          return;
+        }
+        applyDeltas (this->future.front (), state.scene ());
+        this->past.splice (this->past.begin (), this->future, this->future.begin ());
+      }
+      else
+      {
+        this->past.push_front (sceneSnapshot (state.scene (), config, &this->future.front ()));
+        resetToSnapshot (this->future.front (), state);
+        this->future.pop_front ();
+      }
     }
   }
 
   bool hasRecentDynamicMesh () const
   {
-    return this->past.empty () == false && this->past.front ().config.snapshotDynamicMeshes;
+    return this->past.empty () == false &&
+           (this->past.front ().config.snapshotDynamicMeshes || this->isRecording ());
   }
 
+  /* The meshes of a recorded snapshot are copied when they are requested for the first time,
+   * which must happen before they are modified.
+   */
   void forEachRecentDynamicMesh (const std::function<void(const DynamicMesh&)>& f) const
   {
     assert (this->hasRecentDynamicMesh ());
 
-    for (const DynamicMesh& m : this->past.front ().dynamicMeshes)
+    if (this->past.front ().config.recordDynamicMeshes)
+    {
+      if (this->recentMeshes.empty ())
+      {
+        auto delta = this->past.front ().dynamicMeshDeltas.begin ();
+
+        for (const DynamicMesh* mesh : this->recordingMeshes)
+        {
+          assert (delta->isEmpty ());
+          this->recentMeshes.emplace_back (*mesh);
+          ++delta;
+        }
+      }
+      for (const DynamicMesh& m : this->recentMeshes)
+      {
+        f (m);
+      }
+    }
+    else
+    {
+      for (const std::shared_ptr<const DynamicMesh>& m : this->past.front ().dynamicMeshes)
+      {
+        f (*m);
+      }
+    }
+  }
+
+  // spilled deltas are not reported, since they are kept on disk
+  void reportMemory (MemoryReport& report) const
+  {
+    this->finish ();
+
+    const auto reportCopy = [&report](const DynamicMesh& mesh) {
+      MemoryReport copy;
+      mesh.reportMemory (copy);
+      report.add (MemoryCategory::History, copy.total ());
+    };
+
+    const auto reportTimeline = [&report, &reportCopy](const Timeline& timeline) {
+      for (const SceneSnapshot& s : timeline)
+      {
+        report.add (MemoryCategory::History, s.isSpilled () ? 0 : s.numDeltaBytes ());
+
+        for (const std::shared_ptr<const DynamicMesh>& mesh : s.dynamicMeshes)
+        {
+          reportCopy (*mesh);
+        }
+      }
+    };
+    reportTimeline (this->past);
+    reportTimeline (this->future);
+
+    for (const DynamicMesh& mesh : this->recentMeshes)
     {
-      f (m);
+      reportCopy (mesh);
     }
   }
 
   void reset ()
   {
+    this->stopRecording ();
+    this->finish ();
     this->past.clear ();
     this->future.clear ();
+    this->dropped.clear ();
+    this->spillFile.close ();
   }
 
   void runFromConfig (const Config& config)
   {
     this->undoDepth = config.get<int> ("editor/undo-depth");
+    this->memoryBudget = std::size_t (config.get<int> ("editor/undo-memory-budget")) << 20;
   }
 };
 
-DELEGATE1_BIG3 (History, const Config&)
+DELEGATE1_BIG2 (History, const Config&)
 DELEGATE1 (void, History, snapshotAll, const Scene&)
 DELEGATE1 (void, History, snapshotDynamicMeshes, const Scene&)
 DELEGATE1 (void, History, snapshotSketchMeshes, const Scene&)
+DELEGATE1 (void, History, snapshotDynamicMeshDeltas, Scene&)
+DELEGATE (void, History, stopRecording)
+DELEGATE (void, History, resolveDynamicMeshDeltas)
 DELEGATE (void, History, dropPastSnapshot)
 DELEGATE (void, History, dropFutureSnapshot)
 DELEGATE1 (void, History, undo, State&)
@@ -196,5 +639,6 @@ DELEGATE1 (void, History, redo, State&)
 DELEGATE_CONST (bool, History, hasRecentDynamicMesh)
 DELEGATE1_CONST (void, History, forEachRecentDynamicMesh,
                  const std::function<void(const DynamicMesh&)>&)
+DELEGATE1_CONST (void, History, reportMemory, MemoryReport&)
 DELEGATE (void, History, reset)
 DELEGATE1 (void, History, runFromConfig, const Config&)
@@ -10,23 +10,34 @@
 #include "macro.hpp"
 
 class DynamicMesh;
+class MemoryReport;
 class Scene;
 class State;
 
 class History : public Configurable
 {
 public:
-  DECLARE_BIG3 (History, const Config&)
+  DECLARE_BIG2 (History, const Config&)
 
   void snapshotAll (const Scene&);
   void snapshotDynamicMeshes (const Scene&);
   void snapshotSketchMeshes (const Scene&);
+
+  /* Records the modifications of all dynamic meshes until recording is stopped, which happens
+   * implicitly with any other operation of the history.  Recorded meshes must not be deleted.
+   * Stopping finalizes the history in the background, so starting to record does not wait.
+   */
+  void snapshotDynamicMeshDeltas (Scene&);
+  void stopRecording ();
+  void resolveDynamicMeshDeltas ();
   void dropPastSnapshot ();
   void dropFutureSnapshot ();
   void undo (State&);
   void redo (State&);
   bool hasRecentDynamicMesh () const;
   void forEachRecentDynamicMesh (const std::function<void(const DynamicMesh&)>&) const;
+  // reports deltas in memory and copies of meshes as `MemoryCategory::History`
+  void reportMemory (MemoryReport&) const;
   void reset ();
 
 private:
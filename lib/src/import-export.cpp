@@ -2,17 +2,36 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <QByteArray>
+#include <QFile>
+#include <QtEndian>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <functional>
+#include <glm/glm.hpp>
+#include <iterator>
+#include <limits>
+#include <memory>
 #include <sstream>
+#include <string>
+#include <vector>
+#include "dynamic/mesh-cache.hpp"
+#include "dynamic/mesh-version.hpp"
 #include "dynamic/mesh.hpp"
 #include "import-export.hpp"
 #include "mesh-util.hpp"
 #include "mesh.hpp"
+#include "primitive/aabox.hpp"
 #include "scene.hpp"
 #include "sketch/fwd.hpp"
 #include "sketch/mesh.hpp"
 #include "sketch/path.hpp"
+#include "thread-pool.hpp"
 #include "util.hpp"
 
 namespace
@@ -23,322 +42,2630 @@ namespace
     return os;
   }
 
-  std::istream& operator>> (std::istream& is, glm::vec3& v)
+  // number of lines of a text file that are formatted or parsed by a single task
+  constexpr unsigned int linesPerChunk = 4096;
+
+  /* Vertex and face lines are formatted in parallel chunks, each of which has its own buffer.
+   * The buffers take their format from `stream`, so the output does not depend on the chunks.
+   */
+  void toDlyFile (std::ostream& stream, const Mesh& mesh)
+  {
+    const unsigned int       numVertices = mesh.numVertices ();
+    const unsigned int       numLines = numVertices + (mesh.numIndices () / 3);
+    std::vector<std::string> chunks ((numLines + linesPerChunk - 1) / linesPerChunk);
+
+    ThreadPool::global ().parallelFor (
+      numLines, linesPerChunk, [&](unsigned int first, unsigned int last) {
+        std::ostringstream chunk;
+        chunk.copyfmt (stream);
+
+        for (unsigned int i = first; i < last; i++)
+        {
+          if (i < numVertices)
+          {
+            chunk << "v " << mesh.vertex (i) << "\n";
+          }
+          else
+          {
+            const unsigned int f = 3 * (i - numVertices);
+
+            chunk << "f " << mesh.index (f + 0) + 1 << " " << mesh.index (f + 1) + 1 << " "
+                  << mesh.index (f + 2) + 1 << "\n";
+          }
+        }
+        chunks[first / linesPerChunk] = chunk.str ();
+      });
+
+    stream << "o\n";
+    for (const std::string& chunk : chunks)
+    {
+      stream.write (chunk.data (), std::streamsize (chunk.size ()));
+    }
+  }
+
+  /* The binary format starts with `binaryMagic` and `binaryVersion`, followed by the number of
+   * meshes and sketches.  Each mesh consists of a vertex block and an index block, each of which
+   * is prefixed by its number of elements.  Each sketch consists of its nodes in pre-order with
+   * the indices of their parents, followed by its paths.  Values are stored in native byte order.
+   *
+   * Since version 2, the elements of a block are divided into chunks of `elementsPerChunk`
+   * elements, each of which is compressed on its own and prefixed by its compressed size.
+   *
+   * Since version 3, the header is followed by a table of contents with an entry for each mesh
+   * and sketch, which locates it in the file and lists its number of faces and its bounds.
+   *
+   * Since version 4, the index block of each mesh is followed by a flag and optionally by its
+   * cache (cf. `DynamicMeshCache`): the checksum of its vertex and index blocks and of the cache,
+   * followed by the uncompressed arrays of the cache, each of which is prefixed by its number of
+   * values.
+   */
+  const char             binaryMagic[] = {'D', 'L', 'Y', 'B'};
+  const unsigned int     binaryVersion = 4;
+  constexpr unsigned int elementsPerChunk = 1 << 16;
+  constexpr std::size_t  headerSize = sizeof (binaryMagic) + (3 * sizeof (std::uint32_t));
+  constexpr std::size_t  contentsEntrySize = (2 * sizeof (std::uint64_t)) + (7 * sizeof (float));
+
+  // upper bound of zlib's compression ratio, which bounds the words of a block by its bytes
+  constexpr std::uint64_t maxCompressionRatio = 1032;
+
+  // offsets are relative to the beginning of the file, sketches have no faces
+  struct ContentsEntry
+  {
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::uint32_t numFaces;
+    glm::vec3     minimum;
+    glm::vec3     maximum;
+
+    ContentsEntry ()
+      : offset (0)
+      , size (0)
+      , numFaces (0)
+      , minimum (Util::maxFloat ())
+      , maximum (Util::minFloat ())
+    {
+    }
+
+    void extend (const glm::vec3& min, const glm::vec3& max)
+    {
+      this->minimum = glm::min (this->minimum, min);
+      this->maximum = glm::max (this->maximum, max);
+    }
+  };
+
+  class BinaryWriter
+  {
+  public:
+    BinaryWriter (std::ostream& s)
+      : stream (s)
+    {
+    }
+
+    void write (const void* data, std::size_t size)
+    {
+      this->stream.write (static_cast<const char*> (data), std::streamsize (size));
+    }
+
+    void write (std::uint32_t value) { this->write (&value, sizeof (value)); }
+
+    void write (std::uint64_t value) { this->write (&value, sizeof (value)); }
+
+    void write (float value) { this->write (&value, sizeof (value)); }
+
+    void write (const glm::vec3& v)
+    {
+      this->write (v.x);
+      this->write (v.y);
+      this->write (v.z);
+    }
+
+    void write (const PrimSphere& sphere)
+    {
+      this->write (sphere.center ());
+      this->write (sphere.radius ());
+    }
+
+    template <typename T> void write (const std::vector<T>& values)
+    {
+      static_assert (sizeof (T) == sizeof (std::uint32_t), "values must have 32 bits");
+
+      this->write (std::uint32_t (values.size ()));
+      this->write (values.data (), values.size () * sizeof (T));
+    }
+
+  private:
+    std::ostream& stream;
+  };
+
+  class BinaryReader
+  {
+  public:
+    BinaryReader (const char* b, const char* e)
+      : current (b)
+      , end (e)
+    {
+    }
+
+    bool read (void* data, std::size_t size)
+    {
+      if (std::size_t (this->end - this->current) < size)
+      {
+        return false;
+      }
+      std::memcpy (data, this->current, size);
+      this->current += size;
+      return true;
+    }
+
+    bool read (std::uint32_t& value) { return this->read (&value, sizeof (value)); }
+
+    bool read (std::uint64_t& value) { return this->read (&value, sizeof (value)); }
+
+    // points `data` to the next `size` bytes and skips them
+    bool take (std::size_t size, const char*& data)
+    {
+      if (std::size_t (this->end - this->current) < size)
+      {
+        return false;
+      }
+      data = this->current;
+      this->current += size;
+      return true;
+    }
+
+    bool read (float& value) { return this->read (&value, sizeof (value)); }
+
+    bool read (glm::vec3& v) { return this->read (v.x) && this->read (v.y) && this->read (v.z); }
+
+    bool read (glm::vec3& center, float& radius)
+    {
+      return this->read (center) && this->read (radius);
+    }
+
+    std::size_t numBytesLeft () const { return std::size_t (this->end - this->current); }
+
+    // whether `n` elements of `size` bytes each can be read
+    bool hasElements (std::uint32_t n, std::size_t size) const
+    {
+      return std::size_t (this->end - this->current) / size >= n;
+    }
+
+    template <typename T> bool read (std::vector<T>& values)
+    {
+      static_assert (sizeof (T) == sizeof (std::uint32_t), "values must have 32 bits");
+      std::uint32_t n;
+
+      if (this->read (n) == false || this->hasElements (n, sizeof (T)) == false)
+      {
+        return false;
+      }
+      values.resize (n);
+      return this->read (values.data (), n * sizeof (T));
+    }
+
+  private:
+    const char* current;
+    const char* end;
+  };
+
+  /* Before a chunk is compressed, each word is replaced by its difference to the word `stride`
+   * words before: coordinates by the exclusive or of their bits and indices by their zigzag-encoded
+   * difference.  The residuals of neighboring vertices share most of their leading bits, which are
+   * then gathered by transposing the chunk into planes of the n-th bytes of all words.
+   */
+  QByteArray compressChunk (const std::uint32_t* words, unsigned int numWords, bool isIndices)
+  {
+    const unsigned int stride = isIndices ? 1 : 3;
+    QByteArray         planes (int(numWords * sizeof (std::uint32_t)), Qt::Uninitialized);
+    char*              bytes = planes.data ();
+
+    for (unsigned int i = 0; i < numWords; i++)
+    {
+      const std::uint32_t previous = i < stride ? 0 : words[i - stride];
+      const std::uint32_t difference = words[i] - previous;
+      const std::uint32_t residual =
+        isIndices ? (difference << 1) ^ (0u - (difference >> 31)) : words[i] ^ previous;
+
+      for (unsigned int b = 0; b < sizeof (std::uint32_t); b++)
+      {
+        bytes[(b * numWords) + i] = char((residual >> (8 * b)) & 0xff);
+      }
+    }
+    return qCompress (planes);
+  }
+
+  bool decompressChunk (const char* data, std::uint32_t size, unsigned int numWords,
+                        bool isIndices, std::vector<std::uint32_t>& words)
+  {
+    const unsigned int stride = isIndices ? 1 : 3;
+    const QByteArray   planes = qUncompress (reinterpret_cast<const uchar*> (data), int(size));
+
+    if (planes.size () != int(numWords * sizeof (std::uint32_t)))
+    {
+      return false;
+    }
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*> (planes.constData ());
+
+    words.resize (numWords);
+    for (unsigned int i = 0; i < numWords; i++)
+    {
+      const std::uint32_t previous = i < stride ? 0 : words[i - stride];
+      std::uint32_t       residual = 0;
+
+      for (unsigned int b = 0; b < sizeof (std::uint32_t); b++)
+      {
+        residual |= std::uint32_t (bytes[(b * numWords) + i]) << (8 * b);
+      }
+      words[i] = isIndices ? previous + ((residual >> 1) ^ (0u - (residual & 1u)))
+                           : residual ^ previous;
+    }
+    return true;
+  }
+
+  // compresses the chunks of a block in parallel
+  void writeBlock (BinaryWriter& writer, const std::vector<std::uint32_t>& words,
+                   unsigned int wordsPerElement, bool isIndices)
+  {
+    const unsigned int      numElements = words.size () / wordsPerElement;
+    const unsigned int      numChunks = (numElements + elementsPerChunk - 1) / elementsPerChunk;
+    std::vector<QByteArray> chunks (numChunks);
+
+    ThreadPool::global ().parallelFor (numChunks, 1, [&](unsigned int first, unsigned int last) {
+      for (unsigned int c = first; c < last; c++)
+      {
+        const unsigned int begin = c * elementsPerChunk;
+        const unsigned int end = std::min (begin + elementsPerChunk, numElements);
+
+        chunks[c] = compressChunk (words.data () + (begin * wordsPerElement),
+                                   (end - begin) * wordsPerElement, isIndices);
+      }
+    });
+
+    writer.write (std::uint32_t (numElements));
+    for (const QByteArray& chunk : chunks)
+    {
+      writer.write (std::uint32_t (chunk.size ()));
+      writer.write (chunk.constData (), std::size_t (chunk.size ()));
+    }
+  }
+
+  // decompresses the chunks of a block in parallel
+  bool readBlock (BinaryReader& reader, unsigned int wordsPerElement, bool isIndices,
+                  std::uint32_t& numElements, std::vector<std::vector<std::uint32_t>>& chunks)
+  {
+    std::vector<const char*>   data;
+    std::vector<std::uint32_t> sizes;
+
+    if (reader.read (numElements) == false)
+    {
+      return false;
+    }
+
+    // counts of corrupt headers must neither wrap around nor exceed what the stream can hold
+    const std::uint64_t numWords = std::uint64_t (numElements) * wordsPerElement;
+    const std::uint64_t numChunks =
+      (std::uint64_t (numElements) + elementsPerChunk - 1) / elementsPerChunk;
+
+    if (numWords * sizeof (std::uint32_t) >
+          std::uint64_t (reader.numBytesLeft ()) * maxCompressionRatio ||
+        reader.hasElements (std::uint32_t (numChunks), sizeof (std::uint32_t)) == false)
+    {
+      return false;
+    }
+    data.resize (numChunks);
+    sizes.resize (numChunks);
+    for (unsigned int c = 0; c < numChunks; c++)
+    {
+      if (reader.read (sizes[c]) == false || reader.take (sizes[c], data[c]) == false)
+      {
+        return false;
+      }
+    }
+
+    std::atomic<bool> isValid (true);
+
+    chunks.resize (numChunks);
+    ThreadPool::global ().parallelFor (numChunks, 1, [&](unsigned int first, unsigned int last) {
+      for (unsigned int c = first; c < last; c++)
+      {
+        const unsigned int n = std::min (numElements - (c * elementsPerChunk), elementsPerChunk);
+
+        if (decompressChunk (data[c], sizes[c], n * wordsPerElement, isIndices, chunks[c]) ==
+            false)
+        {
+          isValid = false;
+        }
+      }
+    });
+    return isValid;
+  }
+
+  // FNV-1a of the words of consecutive blocks
+  std::uint64_t checksum (const std::uint32_t* words, std::size_t n,
+                          std::uint64_t hash = 0xcbf29ce484222325)
+  {
+    for (std::size_t i = 0; i < n; i++)
+    {
+      hash = (hash ^ words[i]) * 0x100000001b3;
+    }
+    return hash;
+  }
+
+  std::uint64_t checksum (const std::vector<std::vector<std::uint32_t>>& vertexChunks,
+                          const std::vector<std::vector<std::uint32_t>>& indexChunks)
+  {
+    std::uint64_t hash = checksum (nullptr, 0);
+
+    for (const std::vector<std::uint32_t>& chunk : vertexChunks)
+    {
+      hash = checksum (chunk.data (), chunk.size (), hash);
+    }
+    for (const std::vector<std::uint32_t>& chunk : indexChunks)
+    {
+      hash = checksum (chunk.data (), chunk.size (), hash);
+    }
+    return hash;
+  }
+
+  template <typename T> std::uint64_t checksum (const std::vector<T>& values, std::uint64_t hash)
+  {
+    static_assert (sizeof (T) == sizeof (std::uint32_t), "values must have 32 bits");
+
+    const std::uint32_t n = values.size ();
+
+    hash = checksum (&n, 1, hash);
+    for (const T& value : values)
+    {
+      std::uint32_t word;
+      std::memcpy (&word, &value, sizeof (word));
+      hash = checksum (&word, 1, hash);
+    }
+    return hash;
+  }
+
+  // the cache is not validated when it is restored, so a damaged cache must change the checksum
+  std::uint64_t checksum (const DynamicMeshCache& cache, std::uint64_t hash)
+  {
+    hash = checksum (cache.adjacencyOffsets, hash);
+    hash = checksum (cache.adjacentFaces, hash);
+    hash = checksum (cache.oppositeHalfEdges, hash);
+    hash = checksum (cache.octree.geometry, hash);
+    hash = checksum (cache.octree.links, hash);
+    hash = checksum (cache.octree.elements, hash);
+    return checksum (cache.octree.freeBlocks, hash);
+  }
+
+  void writeCache (BinaryWriter& writer, std::uint64_t hash, const DynamicMeshCache& cache)
+  {
+    writer.write (std::uint32_t (1));
+    writer.write (checksum (cache, hash));
+    writer.write (cache.adjacencyOffsets);
+    writer.write (cache.adjacentFaces);
+    writer.write (cache.oppositeHalfEdges);
+    writer.write (cache.octree.geometry);
+    writer.write (cache.octree.links);
+    writer.write (cache.octree.elements);
+    writer.write (cache.octree.freeBlocks);
+  }
+
+  // the cache is left empty if it is missing or if its checksum does not match the mesh and cache
+  bool readCache (BinaryReader& reader, std::uint64_t hash, DynamicMeshCache& cache)
+  {
+    std::uint32_t hasCache;
+    std::uint64_t cachedHash;
+
+    if (reader.read (hasCache) == false)
+    {
+      return false;
+    }
+    else if (hasCache == 0)
+    {
+      return true;
+    }
+    else if (reader.read (cachedHash) == false || reader.read (cache.adjacencyOffsets) == false ||
+             reader.read (cache.adjacentFaces) == false ||
+             reader.read (cache.oppositeHalfEdges) == false ||
+             reader.read (cache.octree.geometry) == false ||
+             reader.read (cache.octree.links) == false ||
+             reader.read (cache.octree.elements) == false ||
+             reader.read (cache.octree.freeBlocks) == false)
+    {
+      return false;
+    }
+    else if (cachedHash != checksum (cache, hash))
+    {
+      DILAY_WARN ("ignoring outdated cache of mesh in binary file")
+      cache = DynamicMeshCache ();
+    }
+    return true;
+  }
+
+  ContentsEntry writeMesh (BinaryWriter& writer, const std::vector<float>& vertices,
+                           const std::vector<std::uint32_t>& indices,
+                           const DynamicMeshCache* cache = nullptr)
+  {
+    ContentsEntry              entry;
+    std::vector<std::uint32_t> vertexWords (vertices.size ());
+
+    entry.numFaces = indices.size () / 3;
+    for (unsigned int i = 0; i < vertices.size (); i += 3)
+    {
+      const glm::vec3 v (vertices[i + 0], vertices[i + 1], vertices[i + 2]);
+      entry.extend (v, v);
+    }
+
+    std::memcpy (vertexWords.data (), vertices.data (), vertices.size () * sizeof (float));
+    writeBlock (writer, vertexWords, 3, false);
+    writeBlock (writer, indices, 1, true);
+
+    if (cache)
+    {
+      const std::uint64_t hash = checksum (vertexWords.data (), vertexWords.size ());
+
+      writeCache (writer, checksum (indices.data (), indices.size (), hash), *cache);
+    }
+    else
+    {
+      writer.write (std::uint32_t (0));
+    }
+    return entry;
+  }
+
+  ContentsEntry toBinaryDlyFile (BinaryWriter& writer, const Mesh& mesh,
+                                 const DynamicMeshCache* cache)
+  {
+    std::vector<float> vertices;
+    vertices.reserve (3 * mesh.numVertices ());
+    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    {
+      vertices.push_back (mesh.vertex (i).x);
+      vertices.push_back (mesh.vertex (i).y);
+      vertices.push_back (mesh.vertex (i).z);
+    }
+
+    std::vector<std::uint32_t> indices;
+    indices.reserve (mesh.numIndices ());
+    for (unsigned int i = 0; i < mesh.numIndices (); i++)
+    {
+      indices.push_back (mesh.index (i));
+    }
+
+    return writeMesh (writer, vertices, indices, cache);
+  }
+
+  // cf. `SketchMesh::minMax`
+  ContentsEntry contentsEntry (const SketchTree& tree, const SketchPaths& paths)
+  {
+    ContentsEntry entry;
+
+    if (tree.hasRoot ())
+    {
+      tree.root ().forEachConstNode ([&entry](const SketchNode& node) {
+        const PrimSphere& s = node.data ();
+        entry.extend (s.center () - glm::vec3 (s.radius ()), s.center () + glm::vec3 (s.radius ()));
+      });
+    }
+    for (const SketchPath& p : paths)
+    {
+      entry.extend (p.minimum (), p.maximum ());
+    }
+    return entry;
+  }
+
+  unsigned int toBinaryDlyFile (BinaryWriter& writer, const SketchNode& node,
+                                unsigned int parentIndex, unsigned int nodeIndex)
+  {
+    writer.write (std::uint32_t (parentIndex));
+    writer.write (node.data ());
+
+    unsigned int childIndex = nodeIndex;
+
+    node.forEachConstChild ([&writer, nodeIndex, &childIndex](const SketchNode& child) {
+      childIndex = toBinaryDlyFile (writer, child, nodeIndex, childIndex + 1);
+    });
+    return childIndex;
+  }
+
+  ContentsEntry toBinaryDlyFile (BinaryWriter& writer, const SketchTree& tree,
+                                 const SketchPaths& paths)
+  {
+    if (tree.hasRoot ())
+    {
+      writer.write (std::uint32_t (tree.root ().numNodes ()));
+      toBinaryDlyFile (writer, tree.root (), Util::invalidIndex (), 0);
+    }
+    else
+    {
+      writer.write (std::uint32_t (0));
+    }
+
+    std::uint32_t numPaths = 0;
+    for (const SketchPath& p : paths)
+    {
+      numPaths += p.isEmpty () ? 0 : 1;
+    }
+    writer.write (numPaths);
+
+    for (const SketchPath& p : paths)
+    {
+      if (p.isEmpty () == false)
+      {
+        writer.write (p.intersectionFirst ());
+        writer.write (p.intersectionLast ());
+        writer.write (std::uint32_t (p.spheres ().size ()));
+
+        for (const PrimSphere& s : p.spheres ())
+        {
+          writer.write (s);
+        }
+      }
+    }
+    return contentsEntry (tree, paths);
+  }
+
+  typedef std::function<ContentsEntry(BinaryWriter&, unsigned int)> PartWriter;
+
+  /* Writes the header, the table of contents and parts `[0, numMeshes + numSketches)`.  Each part
+   * is written by `writePart` to a buffer first, such that its offset is known in advance.
+   */
+  void toBinaryDlyFile (std::ostream& stream, unsigned int numMeshes, unsigned int numSketches,
+                        const PartWriter& writePart)
+  {
+    const unsigned int         numParts = numMeshes + numSketches;
+    std::vector<std::string>   parts (numParts);
+    std::vector<ContentsEntry> entries (numParts);
+    std::uint64_t              offset = headerSize + (numParts * contentsEntrySize);
+
+    for (unsigned int i = 0; i < numParts; i++)
+    {
+      std::ostringstream partStream;
+      BinaryWriter       partWriter (partStream);
+
+      entries[i] = writePart (partWriter, i);
+      parts[i] = partStream.str ();
+      entries[i].offset = offset;
+      entries[i].size = parts[i].size ();
+      offset += parts[i].size ();
+    }
+
+    BinaryWriter writer (stream);
+
+    writer.write (binaryMagic, sizeof (binaryMagic));
+    writer.write (std::uint32_t (binaryVersion));
+    writer.write (std::uint32_t (numMeshes));
+    writer.write (std::uint32_t (numSketches));
+
+    for (const ContentsEntry& entry : entries)
+    {
+      writer.write (entry.offset);
+      writer.write (entry.size);
+      writer.write (entry.numFaces);
+      writer.write (entry.minimum);
+      writer.write (entry.maximum);
+    }
+    for (const std::string& part : parts)
+    {
+      writer.write (part.data (), part.size ());
+    }
+  }
+
+  /* Copies a mesh of the scene as if it had been pruned.  Meshes of the scene are never pruned,
+   * because undo and redo apply deltas to their slots.
+   */
+  Mesh compactMesh (const DynamicMesh& mesh)
+  {
+    return MeshUtil::compact (mesh.mesh (), mesh.freeVertexIndices (), mesh.freeFaceIndices ());
+  }
+
+  // meshes with at least `minCachedFaces` faces are written with their caches, unless it is 0
+  void toBinaryDlyFile (std::ostream& stream, const Scene& scene, unsigned int minCachedFaces)
+  {
+    std::vector<const DynamicMesh*> meshes;
+    std::vector<const SketchMesh*>  sketches;
+
+    scene.forEachConstMesh ([&meshes](const DynamicMesh& mesh) { meshes.push_back (&mesh); });
+    scene.forEachConstMesh ([&sketches](const SketchMesh& mesh) {
+      if (mesh.isEmpty () == false)
+      {
+        sketches.push_back (&mesh);
+      }
+    });
+
+    toBinaryDlyFile (stream, meshes.size (), sketches.size (),
+                     [&meshes, &sketches, minCachedFaces](BinaryWriter& writer, unsigned int i) {
+                       if (i < meshes.size ())
+                       {
+                         const DynamicMesh& mesh = *meshes[i];
+
+                         if (minCachedFaces > 0 && mesh.numFaces () >= minCachedFaces)
+                         {
+                           // caches require a pruned mesh, which is pruned as a copy
+                           DynamicMesh      pruned (mesh);
+                           DynamicMeshCache cache;
+
+                           pruned.prune ();
+                           pruned.cache (cache);
+                           return toBinaryDlyFile (writer, pruned.mesh (), &cache);
+                         }
+                         else
+                         {
+                           return toBinaryDlyFile (writer, compactMesh (mesh), nullptr);
+                         }
+                       }
+                       else
+                       {
+                         const SketchMesh& sketch = *sketches[i - meshes.size ()];
+                         return toBinaryDlyFile (writer, sketch.tree (), sketch.paths ());
+                       }
+                     });
+  }
+
+  struct SketchCopy
+  {
+    SketchTree  tree;
+    SketchPaths paths;
+  };
+
+  // writes a version as if it had been pruned
+  ContentsEntry toBinaryDlyFile (BinaryWriter& writer, const DynamicMeshVersion& version)
+  {
+    const Mesh&                mesh = version.mesh;
+    std::vector<unsigned char> isFreeFace (mesh.numIndices () / 3, 0);
+    std::vector<unsigned int>  vertexIndexMap (mesh.numVertices (), 0);
+
+    for (unsigned int i : version.freeVertexIndices)
+    {
+      vertexIndexMap[i] = Util::invalidIndex ();
+    }
+    for (unsigned int i : version.freeFaceIndices)
+    {
+      isFreeFace[i] = 1;
+    }
+
+    std::vector<float> vertices;
+    vertices.reserve (3 * (mesh.numVertices () - version.freeVertexIndices.size ()));
+    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    {
+      if (vertexIndexMap[i] != Util::invalidIndex ())
+      {
+        vertexIndexMap[i] = vertices.size () / 3;
+        vertices.push_back (mesh.vertex (i).x);
+        vertices.push_back (mesh.vertex (i).y);
+        vertices.push_back (mesh.vertex (i).z);
+      }
+    }
+
+    std::vector<std::uint32_t> indices;
+    indices.reserve (mesh.numIndices () - (3 * version.freeFaceIndices.size ()));
+    for (unsigned int f = 0; f < isFreeFace.size (); f++)
+    {
+      if (isFreeFace[f] == 0)
+      {
+        for (unsigned int i = 3 * f; i < (3 * f) + 3; i++)
+        {
+          assert (vertexIndexMap[mesh.index (i)] != Util::invalidIndex ());
+          indices.push_back (vertexIndexMap[mesh.index (i)]);
+        }
+      }
+    }
+
+    return writeMesh (writer, vertices, indices);
+  }
+
+  // files of versions before 4 have no caches
+  bool fromCompressedDlyFile (BinaryReader& reader, std::uint32_t version, Mesh& mesh,
+                              DynamicMeshCache& cache)
+  {
+    std::uint32_t                           numVertices, numIndices;
+    std::vector<std::vector<std::uint32_t>> vertexChunks, indexChunks;
+
+    if (readBlock (reader, 3, false, numVertices, vertexChunks) == false ||
+        readBlock (reader, 1, true, numIndices, indexChunks) == false || numIndices % 3 != 0)
+    {
+      return false;
+    }
+    else if (version >= 4 &&
+             readCache (reader, checksum (vertexChunks, indexChunks), cache) == false)
+    {
+      return false;
+    }
+    mesh.reserveVertices (numVertices);
+    for (const std::vector<std::uint32_t>& chunk : vertexChunks)
+    {
+      for (unsigned int i = 0; i < chunk.size (); i += 3)
+      {
+        glm::vec3 vertex;
+        std::memcpy (&vertex.x, &chunk[i + 0], sizeof (float));
+        std::memcpy (&vertex.y, &chunk[i + 1], sizeof (float));
+        std::memcpy (&vertex.z, &chunk[i + 2], sizeof (float));
+        mesh.addVertex (vertex);
+      }
+    }
+    mesh.reserveIndices (numIndices);
+    for (const std::vector<std::uint32_t>& chunk : indexChunks)
+    {
+      for (std::uint32_t index : chunk)
+      {
+        if (index >= mesh.numVertices ())
+        {
+          return false;
+        }
+        mesh.addIndex (index);
+      }
+    }
+    return true;
+  }
+
+  bool fromBinaryDlyFile (BinaryReader& reader, Mesh& mesh)
+  {
+    std::uint32_t numVertices, numIndices;
+
+    if (reader.read (numVertices) == false || reader.hasElements (numVertices, 12) == false)
+    {
+      return false;
+    }
+    mesh.reserveVertices (numVertices);
+    for (std::uint32_t i = 0; i < numVertices; i++)
+    {
+      glm::vec3 vertex;
+      reader.read (vertex);
+      mesh.addVertex (vertex);
+    }
+
+    if (reader.read (numIndices) == false || numIndices % 3 != 0 ||
+        reader.hasElements (numIndices, sizeof (std::uint32_t)) == false)
+    {
+      return false;
+    }
+    mesh.reserveIndices (numIndices);
+    for (std::uint32_t i = 0; i < numIndices; i++)
+    {
+      std::uint32_t index;
+      reader.read (index);
+
+      if (index >= numVertices)
+      {
+        return false;
+      }
+      mesh.addIndex (index);
+    }
+    return true;
+  }
+
+  bool fromBinaryDlyFile (BinaryReader& reader, SketchCopy& sketch)
+  {
+    std::uint32_t            numNodes;
+    std::vector<SketchNode*> nodes;
+
+    if (reader.read (numNodes) == false)
+    {
+      return false;
+    }
+    for (std::uint32_t i = 0; i < numNodes; i++)
+    {
+      std::uint32_t parentIndex;
+      glm::vec3     center;
+      float         radius;
+
+      if (reader.read (parentIndex) == false || reader.read (center, radius) == false)
+      {
+        return false;
+      }
+      else if (i == 0)
+      {
+        nodes.push_back (&sketch.tree.emplaceRoot (PrimSphere (center, radius)));
+      }
+      else if (parentIndex < nodes.size ())
+      {
+        nodes.push_back (&nodes[parentIndex]->emplaceChild (PrimSphere (center, radius)));
+      }
+      else
+      {
+        DILAY_WARN ("invalid parent index of sketch node %u", i)
+        return false;
+      }
+    }
+
+    std::uint32_t numPaths;
+    if (reader.read (numPaths) == false)
+    {
+      return false;
+    }
+    for (std::uint32_t i = 0; i < numPaths; i++)
+    {
+      glm::vec3     intersectionFirst, intersectionLast;
+      std::uint32_t numSpheres;
+
+      if (reader.read (intersectionFirst) == false || reader.read (intersectionLast) == false ||
+          reader.read (numSpheres) == false)
+      {
+        return false;
+      }
+
+      sketch.paths.emplace_back ();
+
+      SketchPath& path = sketch.paths.back ();
+      for (std::uint32_t j = 0; j < numSpheres; j++)
+      {
+        glm::vec3 center;
+        float     radius;
+
+        if (reader.read (center, radius) == false)
+        {
+          return false;
+        }
+        path.addSphere (j == 0 ? intersectionFirst : intersectionLast, center, radius);
+      }
+    }
+    return true;
+  }
+
+  // reads the table of contents of a file of `fileSize` bytes
+  bool readContents (BinaryReader& reader, std::uint32_t numEntries, std::uint64_t fileSize,
+                     std::vector<ContentsEntry>& entries)
+  {
+    if (reader.hasElements (numEntries, contentsEntrySize) == false)
+    {
+      return false;
+    }
+    entries.resize (numEntries);
+    for (ContentsEntry& entry : entries)
+    {
+      reader.read (entry.offset);
+      reader.read (entry.size);
+      reader.read (entry.numFaces);
+      reader.read (entry.minimum);
+      reader.read (entry.maximum);
+
+      if (entry.offset > fileSize || entry.size > fileSize - entry.offset)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // parts follow the table of contents in order, so they are read sequentially
+  bool fromBinaryDlyFile (const char* begin, const char* end, std::vector<Mesh>& meshes,
+                          std::vector<DynamicMeshCache>& caches, std::vector<SketchCopy>& sketches)
+  {
+    BinaryReader               reader (begin, end);
+    std::uint32_t              version, numMeshes, numSketches;
+    std::vector<ContentsEntry> entries;
+
+    if (reader.read (version) == false || reader.read (numMeshes) == false ||
+        reader.read (numSketches) == false)
+    {
+      DILAY_WARN ("could not parse header of binary file")
+      return false;
+    }
+    else if (version == 0 || version > binaryVersion)
+    {
+      DILAY_WARN ("unsupported version %u of binary file", version)
+      return false;
+    }
+    else if (version >= 3 &&
+             readContents (reader, numMeshes + numSketches,
+                           std::uint64_t (end - begin) + sizeof (binaryMagic), entries) == false)
+    {
+      DILAY_WARN ("could not parse table of contents of binary file")
+      return false;
+    }
+    else if (reader.hasElements (numMeshes, 2 * sizeof (std::uint32_t)) == false)
+    {
+      DILAY_WARN ("invalid number of meshes in binary file")
+      return false;
+    }
+
+    meshes.resize (numMeshes);
+    caches.resize (numMeshes);
+    for (std::uint32_t i = 0; i < numMeshes; i++)
+    {
+      if ((version == 1 ? fromBinaryDlyFile (reader, meshes[i])
+                        : fromCompressedDlyFile (reader, version, meshes[i], caches[i])) == false)
+      {
+        DILAY_WARN ("could not parse mesh of binary file")
+        return false;
+      }
+    }
+    for (std::uint32_t i = 0; i < numSketches; i++)
+    {
+      sketches.emplace_back ();
+
+      if (fromBinaryDlyFile (reader, sketches.back ()) == false)
+      {
+        DILAY_WARN ("could not parse sketch of binary file")
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool isSpace (char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+  bool isDigit (char c) { return c >= '0' && c <= '9'; }
+
+  /* Locale-independent parser of the values of a single line of a text file.  Values are
+   * separated by spaces or tabs.
+   */
+  class TextParser
+  {
+  public:
+    TextParser (const char* b, const char* e)
+      : current (b)
+      , end (e)
+    {
+    }
+
+    const char* position () const { return this->current; }
+
+    bool isKeyword (const char* keyword)
+    {
+      this->skipSpaces ();
+
+      const char* c = this->current;
+      for (; *keyword != '\0'; keyword++, c++)
+      {
+        if (c == this->end || *c != *keyword)
+        {
+          return false;
+        }
+      }
+      if (c == this->end || isSpace (*c))
+      {
+        this->current = c;
+        return true;
+      }
+      return false;
+    }
+
+    bool hasValue ()
+    {
+      this->skipSpaces ();
+      return this->current != this->end;
+    }
+
+    bool read (unsigned int& value)
+    {
+      this->skipSpaces ();
+      return this->readDigits (value) && this->isAtSeparator ();
+    }
+
+    // reads the vertex index of a face element, e.g. `1` of `1/2/3`
+    bool readFaceIndex (unsigned int& value)
+    {
+      this->skipSpaces ();
+      if (this->readDigits (value) == false)
+      {
+        return false;
+      }
+      while (this->current != this->end && isSpace (*this->current) == false)
+      {
+        this->current++;
+      }
+      return true;
+    }
+
+    bool read (float& value)
+    {
+      this->skipSpaces ();
+
+      const char* c = this->current;
+      bool        isNegative = false;
+      double      mantissa = 0.0;
+      int         exponent = 0;
+      bool        hasDigits = false;
+
+      if (c != this->end && (*c == '-' || *c == '+'))
+      {
+        isNegative = *c == '-';
+        c++;
+      }
+      for (; c != this->end && isDigit (*c); c++)
+      {
+        mantissa = (10.0 * mantissa) + double(*c - '0');
+        hasDigits = true;
+      }
+      if (c != this->end && *c == '.')
+      {
+        for (c++; c != this->end && isDigit (*c); c++)
+        {
+          mantissa = (10.0 * mantissa) + double(*c - '0');
+          exponent--;
+          hasDigits = true;
+        }
+      }
+      if (hasDigits == false)
+      {
+        return false;
+      }
+      if (c != this->end && (*c == 'e' || *c == 'E'))
+      {
+        bool isNegativeExponent = false;
+        int  e = 0;
+
+        c++;
+        if (c != this->end && (*c == '-' || *c == '+'))
+        {
+          isNegativeExponent = *c == '-';
+          c++;
+        }
+        if (c == this->end || isDigit (*c) == false)
+        {
+          return false;
+        }
+        for (; c != this->end && isDigit (*c); c++)
+        {
+          e = glm::min ((10 * e) + (*c - '0'), 1000);
+        }
+        exponent += isNegativeExponent ? -e : e;
+      }
+      this->current = c;
+
+      if (this->isAtSeparator () == false)
+      {
+        return false;
+      }
+      else
+      {
+        const double v = exponent < 0 ? mantissa / std::pow (10.0, -exponent)
+                                      : mantissa * std::pow (10.0, exponent);
+        value = float(isNegative ? -v : v);
+        return true;
+      }
+    }
+
+    bool read (glm::vec3& v) { return this->read (v.x) && this->read (v.y) && this->read (v.z); }
+
+    bool read (glm::vec3& center, float& radius)
+    {
+      return this->read (center) && this->read (radius);
+    }
+
+  private:
+    const char* current;
+    const char* end;
+
+    void skipSpaces ()
+    {
+      while (this->current != this->end && isSpace (*this->current))
+      {
+        this->current++;
+      }
+    }
+
+    bool isAtSeparator () const { return this->current == this->end || isSpace (*this->current); }
+
+    bool readDigits (unsigned int& value)
+    {
+      if (this->current == this->end || isDigit (*this->current) == false)
+      {
+        return false;
+      }
+      value = 0;
+      for (; this->current != this->end && isDigit (*this->current); this->current++)
+      {
+        const unsigned int digit = (unsigned int) (*this->current - '0');
+
+        if (value > (std::numeric_limits<unsigned int>::max () - digit) / 10)
+        {
+          return false;
+        }
+        value = (10 * value) + digit;
+      }
+      return true;
+    }
+  };
+
+  // the values of a vertex or face line, which are parsed after all lines have been split
+  struct TextLine
+  {
+    const char*  begin;
+    const char*  end;
+    unsigned int number;
+    unsigned int mesh;
+  };
+
+  struct TextFace
+  {
+    unsigned int indices[4];
+    bool         isQuad;
+  };
+
+  bool fromTextDlyFile (const char* begin, const char* end, std::vector<Mesh>& meshes,
+                        std::vector<SketchCopy>& sketches)
+  {
+    std::vector<TextLine>    vertexLines;
+    std::vector<TextLine>    faceLines;
+    unsigned int             numMeshes = 0;
+    std::vector<SketchNode*> nodes;
+    SketchCopy*              sketch = nullptr;
+    SketchPath*              sketchPath = nullptr;
+    glm::vec3                intersectionFirst, intersectionLast;
+    unsigned int             lineNumber = 0;
+
+    for (const char* line = begin; line < end;)
+    {
+      const char* lineEnd = static_cast<const char*> (std::memchr (line, '\n', end - line));
+      if (lineEnd == nullptr)
+      {
+        lineEnd = end;
+      }
+      lineNumber++;
+
+      TextParser parser (line, lineEnd);
+      if (parser.isKeyword ("o"))
+      {
+        numMeshes++;
+      }
+      else if (parser.isKeyword ("v"))
+      {
+        numMeshes = glm::max (numMeshes, 1u);
+        vertexLines.push_back (TextLine{parser.position (), lineEnd, lineNumber, numMeshes - 1});
+      }
+      else if (parser.isKeyword ("f"))
+      {
+        numMeshes = glm::max (numMeshes, 1u);
+        faceLines.push_back (TextLine{parser.position (), lineEnd, lineNumber, numMeshes - 1});
+      }
+      else if (parser.isKeyword ("dly_sketch_mesh"))
+      {
+        nodes.clear ();
+        sketches.emplace_back ();
+        sketch = &sketches.back ();
+        sketchPath = nullptr;
+      }
+      else if (parser.isKeyword ("dly_sketch_node"))
+      {
+        if (sketch == nullptr)
+        {
+          DILAY_WARN ("could not parse sketch node: no sketch found at line %u", lineNumber)
+          return false;
+        }
+        unsigned int nodeIndex;
+        unsigned int parentIndex;
+        glm::vec3    center;
+        float        radius;
+
+        if (parser.read (nodeIndex) == false || parser.read (parentIndex) == false ||
+            parser.read (center, radius) == false)
+        {
+          DILAY_WARN ("could not parse sketch node at line %u", lineNumber)
+          return false;
+        }
+
+        if (nodeIndex == nodes.size ())
+        {
+          if (nodeIndex == 0)
+          {
+            nodes.push_back (&sketch->tree.emplaceRoot (PrimSphere (center, radius)));
+          }
+          else if (parentIndex < nodes.size ())
+          {
+            nodes.push_back (&nodes.at (parentIndex)->emplaceChild (PrimSphere (center, radius)));
+          }
+          else
+          {
+            DILAY_WARN ("invalid parent index at line %u", lineNumber)
+            return false;
+          }
+        }
+        else
+        {
+          DILAY_WARN ("invalid node index at line %u", lineNumber)
+          return false;
+        }
+      }
+      else if (parser.isKeyword ("dly_sketch_path"))
+      {
+        if (parser.read (intersectionFirst) == false || parser.read (intersectionLast) == false)
+        {
+          DILAY_WARN ("could not parse sketch path at line %u", lineNumber)
+          return false;
+        }
+        if (sketch)
+        {
+          sketch->paths.emplace_back ();
+          sketchPath = &sketch->paths.back ();
+        }
+        else
+        {
+          DILAY_WARN ("could not parse sketch path: no sketch found at line %u", lineNumber)
+          return false;
+        }
+      }
+      else if (parser.isKeyword ("dly_sketch_sphere"))
+      {
+        glm::vec3 center;
+        float     radius;
+
+        if (parser.read (center, radius) == false)
+        {
+          DILAY_WARN ("could not parse sketch sphere at line %u", lineNumber)
+          return false;
+        }
+
+        if (sketchPath)
+        {
+          sketchPath->addSphere (sketchPath->isEmpty () ? intersectionFirst : intersectionLast,
+                                 center, radius);
+        }
+        else
+        {
+          DILAY_WARN ("could not parse sketch sphere: no sketch path found at line %u", lineNumber)
+          return false;
+        }
+      }
+      line = lineEnd + 1;
+    }
+
+    // vertex and face lines are independent of each other and are parsed in parallel
+    std::vector<glm::vec3>     vertices (vertexLines.size ());
+    std::vector<TextFace>      faces (faceLines.size ());
+    std::vector<unsigned char> isVertexValid (vertexLines.size ());
+    std::vector<unsigned char> isFaceValid (faceLines.size ());
+
+    ThreadPool::global ().parallelFor (
+      vertexLines.size (), linesPerChunk, [&](unsigned int first, unsigned int last) {
+        for (unsigned int i = first; i < last; i++)
+        {
+          TextParser parser (vertexLines[i].begin, vertexLines[i].end);
+          isVertexValid[i] = parser.read (vertices[i]);
+        }
+      });
+
+    ThreadPool::global ().parallelFor (
+      faceLines.size (), linesPerChunk, [&](unsigned int first, unsigned int last) {
+        for (unsigned int i = first; i < last; i++)
+        {
+          TextParser parser (faceLines[i].begin, faceLines[i].end);
+          TextFace&  face = faces[i];
+
+          isFaceValid[i] = parser.readFaceIndex (face.indices[0]) &&
+                           parser.readFaceIndex (face.indices[1]) &&
+                           parser.readFaceIndex (face.indices[2]);
+          face.isQuad = isFaceValid[i] && parser.hasValue ();
+          if (face.isQuad)
+          {
+            isFaceValid[i] = parser.readFaceIndex (face.indices[3]);
+          }
+        }
+      });
+
+    for (unsigned int i = 0; i < vertexLines.size (); i++)
+    {
+      if (isVertexValid[i] == false)
+      {
+        DILAY_WARN ("could not parse vertex at line %u", vertexLines[i].number)
+        return false;
+      }
+    }
+    for (unsigned int i = 0; i < faceLines.size (); i++)
+    {
+      if (isFaceValid[i] == false)
+      {
+        DILAY_WARN ("could not parse face at line %u", faceLines[i].number)
+        return false;
+      }
+    }
+
+    std::vector<unsigned int> numVertices (numMeshes, 0);
+    std::vector<unsigned int> numIndices (numMeshes, 0);
+
+    meshes.resize (numMeshes);
+
+    for (const TextLine& line : vertexLines)
+    {
+      numVertices[line.mesh]++;
+    }
+    for (unsigned int i = 0; i < faceLines.size (); i++)
+    {
+      numIndices[faceLines[i].mesh] += faces[i].isQuad ? 6 : 3;
+    }
+    for (unsigned int m = 0; m < numMeshes; m++)
+    {
+      meshes[m].reserveVertices (numVertices[m]);
+      meshes[m].reserveIndices (numIndices[m]);
+    }
+    for (unsigned int i = 0; i < vertexLines.size (); i++)
+    {
+      meshes[vertexLines[i].mesh].addVertex (vertices[i]);
+    }
+    for (unsigned int i = 0; i < faceLines.size (); i++)
+    {
+      const unsigned int* v = faces[i].indices;
+      Mesh&               mesh = meshes[faceLines[i].mesh];
+
+      if (faces[i].isQuad)
+      {
+        MeshUtil::addFace (mesh, v[0] - 1, v[1] - 1, v[2] - 1, v[3] - 1);
+      }
+      else
+      {
+        MeshUtil::addFace (mesh, v[0] - 1, v[1] - 1, v[2] - 1);
+      }
+    }
+    return true;
+  }
+
+  // number of faces or vertices of a binary STL or PLY file that are read by a single task
+  constexpr unsigned int recordsPerChunk = 16384;
+  constexpr std::size_t  stlHeaderSize = 84;
+  constexpr std::size_t  stlFaceSize = 50;
+
+  float littleEndianFloat (const char* data)
+  {
+    const quint32 bits = qFromLittleEndian<quint32> (reinterpret_cast<const uchar*> (data));
+    float         value;
+
+    std::memcpy (&value, &bits, sizeof (value));
+    return value;
+  }
+
+  // binary STL files have no magic number, but their size follows from their number of faces
+  bool isStlFile (const char* begin, const char* end)
+  {
+    if (std::size_t (end - begin) < stlHeaderSize)
+    {
+      return false;
+    }
+    const quint32 numFaces =
+      qFromLittleEndian<quint32> (reinterpret_cast<const uchar*> (begin + stlHeaderSize - 4));
+
+    return std::uint64_t (end - begin) == stlHeaderSize + (std::uint64_t (numFaces) * stlFaceSize);
+  }
+
+  // each face consists of its normal, which is ignored, its corners and an attribute
+  bool fromStlFile (const char* begin, const char* end, std::vector<Mesh>& meshes)
+  {
+    const unsigned int     numFaces = (end - begin - stlHeaderSize) / stlFaceSize;
+    std::vector<glm::vec3> corners (3 * numFaces);
+
+    ThreadPool::global ().parallelFor (
+      numFaces, recordsPerChunk, [begin, &corners](unsigned int first, unsigned int last) {
+        for (unsigned int f = first; f < last; f++)
+        {
+          const char* face = begin + stlHeaderSize + (f * stlFaceSize) + (3 * sizeof (float));
+
+          for (unsigned int i = 0; i < 9; i++)
+          {
+            corners[(3 * f) + (i / 3)][i % 3] = littleEndianFloat (face + (i * sizeof (float)));
+          }
+        }
+      });
+
+    meshes.push_back (MeshUtil::weld (corners));
+    return true;
+  }
+
+  /* Binary glTF files consist of a header, a JSON chunk that describes the scene, and a binary
+   * chunk with the positions, normals and indices of all meshes.  Each mesh becomes a node with a
+   * single primitive.  Quantized positions are 16-bit integers relative to the center of their
+   * mesh, which are restored by the translation and scale of its node, cf. `KHR_mesh_quantization`.
+   */
+  constexpr std::uint32_t glbMagic = 0x46546c67;
+  constexpr std::uint32_t glbVersion = 2;
+  constexpr std::uint32_t glbJsonChunk = 0x4e4f534a;
+  constexpr std::uint32_t glbBinaryChunk = 0x004e4942;
+
+  // number of elements of a buffer that are encoded before they are written
+  constexpr unsigned int glbElementsPerChunk = 1 << 16;
+
+  std::uint32_t glbPadded (std::uint32_t size) { return (size + 3) & ~std::uint32_t (3); }
+
+  // glTF is little-endian regardless of the host
+  template <typename T> void toGlb (char* data, T value)
+  {
+    qToLittleEndian<T> (value, reinterpret_cast<uchar*> (data));
+  }
+
+  void toGlb (char* data, float value)
+  {
+    std::uint32_t bits;
+    std::memcpy (&bits, &value, sizeof (float));
+    toGlb<std::uint32_t> (data, bits);
+  }
+
+  struct GlbMesh
+  {
+    const Mesh&   mesh;
+    const bool    isQuantized;
+    glm::vec3     minimum;
+    glm::vec3     maximum;
+    glm::vec3     center;
+    float         step;
+    std::uint32_t offset;
+
+    GlbMesh (const Mesh& m, bool q, std::uint32_t o)
+      : mesh (m)
+      , isQuantized (q)
+      , minimum (std::numeric_limits<float>::max ())
+      , maximum (std::numeric_limits<float>::lowest ())
+      , offset (o)
+    {
+      for (unsigned int i = 0; i < m.numVertices (); i++)
+      {
+        this->minimum = glm::min (this->minimum, m.vertex (i));
+        this->maximum = glm::max (this->maximum, m.vertex (i));
+      }
+      this->center = (this->minimum + this->maximum) * 0.5f;
+
+      const glm::vec3 halfExtent = this->maximum - this->center;
+      const float     maxHalfExtent =
+        glm::max (halfExtent.x, glm::max (halfExtent.y, halfExtent.z));
+
+      this->step = maxHalfExtent > 0.0f ? maxHalfExtent / 32767.0f : 1.0f;
+    }
+
+    unsigned int positionStride () const { return this->isQuantized ? 8 : 12; }
+    unsigned int normalStride () const { return this->isQuantized ? 4 : 12; }
+
+    // the largest value of a component type must not be used as index
+    bool hasShortIndices () const { return this->mesh.numVertices () < 0xffff; }
+
+    unsigned int indexSize () const { return this->hasShortIndices () ? 2 : 4; }
+
+    std::uint32_t positionSize () const
+    {
+      return this->mesh.numVertices () * this->positionStride ();
+    }
+
+    std::uint32_t normalSize () const { return this->mesh.numVertices () * this->normalStride (); }
+
+    std::uint32_t indicesSize () const
+    {
+      return glbPadded (this->mesh.numIndices () * this->indexSize ());
+    }
+
+    std::uint32_t size () const
+    {
+      return this->positionSize () + this->normalSize () + this->indicesSize ();
+    }
+
+    glm::ivec3 quantize (const glm::vec3& position) const
+    {
+      return glm::ivec3 (glm::round ((position - this->center) / this->step));
+    }
+
+    void writeJsonAccessors (std::ostream& stream, unsigned int bufferView) const
+    {
+      stream << "{\"bufferView\":" << bufferView << ",\"count\":" << this->mesh.numVertices ()
+             << ",\"type\":\"VEC3\",";
+      if (this->isQuantized)
+      {
+        const glm::ivec3 min = this->quantize (this->minimum);
+        const glm::ivec3 max = this->quantize (this->maximum);
+
+        stream << "\"componentType\":5122,\"min\":[" << min.x << "," << min.y << "," << min.z
+               << "],\"max\":[" << max.x << "," << max.y << "," << max.z << "]},";
+      }
+      else
+      {
+        stream << "\"componentType\":5126,\"min\":[" << this->minimum.x << "," << this->minimum.y
+               << "," << this->minimum.z << "],\"max\":[" << this->maximum.x << ","
+               << this->maximum.y << "," << this->maximum.z << "]},";
+      }
+      stream << "{\"bufferView\":" << (bufferView + 1) << ",\"count\":" << this->mesh.numVertices ()
+             << ",\"type\":\"VEC3\","
+             << (this->isQuantized ? "\"componentType\":5120,\"normalized\":true},"
+                                   : "\"componentType\":5126},");
+      stream << "{\"bufferView\":" << (bufferView + 2) << ",\"count\":" << this->mesh.numIndices ()
+             << ",\"type\":\"SCALAR\",\"componentType\":"
+             << (this->hasShortIndices () ? 5123 : 5125) << "}";
+    }
+
+    void writeJsonBufferViews (std::ostream& stream) const
+    {
+      const std::uint32_t normalOffset = this->offset + this->positionSize ();
+      const std::uint32_t indexOffset = normalOffset + this->normalSize ();
+
+      stream << "{\"buffer\":0,\"byteOffset\":" << this->offset
+             << ",\"byteLength\":" << this->positionSize ()
+             << ",\"byteStride\":" << this->positionStride () << ",\"target\":34962},";
+      stream << "{\"buffer\":0,\"byteOffset\":" << normalOffset
+             << ",\"byteLength\":" << this->normalSize ()
+             << ",\"byteStride\":" << this->normalStride () << ",\"target\":34962},";
+      stream << "{\"buffer\":0,\"byteOffset\":" << indexOffset
+             << ",\"byteLength\":" << (this->mesh.numIndices () * this->indexSize ())
+             << ",\"target\":34963}";
+    }
+
+    void writeJsonNode (std::ostream& stream, unsigned int index) const
+    {
+      stream << "{\"mesh\":" << index;
+      if (this->isQuantized)
+      {
+        stream << ",\"translation\":[" << this->center.x << "," << this->center.y << ","
+               << this->center.z << "],\"scale\":[" << this->step << "," << this->step << ","
+               << this->step << "]";
+      }
+      stream << "}";
+    }
+
+    // encodes elements into a buffer of `glbElementsPerChunk` elements that is written repeatedly
+    template <typename F>
+    void writeElements (std::ostream& stream, unsigned int n, unsigned int elementSize,
+                        const F& encode) const
+    {
+      std::vector<char> buffer (std::min (n, glbElementsPerChunk) * elementSize, 0);
+
+      for (unsigned int first = 0; first < n; first += glbElementsPerChunk)
+      {
+        const unsigned int last = std::min (first + glbElementsPerChunk, n);
+
+        for (unsigned int i = first; i < last; i++)
+        {
+          encode (i, buffer.data () + ((i - first) * elementSize));
+        }
+        stream.write (buffer.data (), std::streamsize ((last - first) * elementSize));
+      }
+    }
+
+    void writeBuffers (std::ostream& stream) const
+    {
+      const unsigned int numVertices = this->mesh.numVertices ();
+
+      if (this->isQuantized)
+      {
+        this->writeElements (stream, numVertices, 8, [this](unsigned int i, char* data) {
+          const glm::ivec3 q = this->quantize (this->mesh.vertex (i));
+          toGlb<std::int16_t> (data, std::int16_t (q.x));
+          toGlb<std::int16_t> (data + 2, std::int16_t (q.y));
+          toGlb<std::int16_t> (data + 4, std::int16_t (q.z));
+        });
+        this->writeElements (stream, numVertices, 4, [this](unsigned int i, char* data) {
+          const glm::vec3 n = glm::round (this->mesh.normal (i) * 127.0f);
+          data[0] = char(n.x);
+          data[1] = char(n.y);
+          data[2] = char(n.z);
+        });
+      }
+      else
+      {
+        this->writeElements (stream, numVertices, 12, [this](unsigned int i, char* data) {
+          const glm::vec3& v = this->mesh.vertex (i);
+          toGlb (data, v.x);
+          toGlb (data + 4, v.y);
+          toGlb (data + 8, v.z);
+        });
+        this->writeElements (stream, numVertices, 12, [this](unsigned int i, char* data) {
+          const glm::vec3& n = this->mesh.normal (i);
+          toGlb (data, n.x);
+          toGlb (data + 4, n.y);
+          toGlb (data + 8, n.z);
+        });
+      }
+
+      const unsigned int numIndices = this->mesh.numIndices ();
+      if (this->hasShortIndices ())
+      {
+        this->writeElements (stream, numIndices, 2, [this](unsigned int i, char* data) {
+          toGlb<std::uint16_t> (data, std::uint16_t (this->mesh.index (i)));
+        });
+      }
+      else
+      {
+        this->writeElements (stream, numIndices, 4, [this](unsigned int i, char* data) {
+          toGlb<std::uint32_t> (data, std::uint32_t (this->mesh.index (i)));
+        });
+      }
+      const char         zeros[4] = {0, 0, 0, 0};
+      const unsigned int padding = this->indicesSize () - (numIndices * this->indexSize ());
+      stream.write (zeros, std::streamsize (padding));
+    }
+  };
+
+  std::string glbJson (const std::vector<GlbMesh>& meshes, std::uint32_t binarySize,
+                       bool isQuantized)
+  {
+    std::ostringstream json;
+    json.imbue (std::locale::classic ());
+    json.precision (9);
+
+    json << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"Dilay " DILAY_VERSION "\"},";
+    if (isQuantized)
+    {
+      json << "\"extensionsUsed\":[\"KHR_mesh_quantization\"],"
+              "\"extensionsRequired\":[\"KHR_mesh_quantization\"],";
+    }
+    json << "\"scene\":0,\"scenes\":[{\"nodes\":[";
+    for (unsigned int i = 0; i < meshes.size (); i++)
+    {
+      json << (i == 0 ? "" : ",") << i;
+    }
+    json << "]}]";
+
+    if (meshes.empty () == false)
+    {
+      json << ",\"nodes\":[";
+      for (unsigned int i = 0; i < meshes.size (); i++)
+      {
+        json << (i == 0 ? "" : ",");
+        meshes[i].writeJsonNode (json, i);
+      }
+      json << "],\"meshes\":[";
+      for (unsigned int i = 0; i < meshes.size (); i++)
+      {
+        json << (i == 0 ? "" : ",") << "{\"primitives\":[{\"attributes\":{\"POSITION\":" << (3 * i)
+             << ",\"NORMAL\":" << (3 * i + 1) << "},\"indices\":" << (3 * i + 2)
+             << ",\"mode\":4}]}";
+      }
+      json << "],\"accessors\":[";
+      for (unsigned int i = 0; i < meshes.size (); i++)
+      {
+        json << (i == 0 ? "" : ",");
+        meshes[i].writeJsonAccessors (json, 3 * i);
+      }
+      json << "],\"bufferViews\":[";
+      for (unsigned int i = 0; i < meshes.size (); i++)
+      {
+        json << (i == 0 ? "" : ",");
+        meshes[i].writeJsonBufferViews (json);
+      }
+      json << "],\"buffers\":[{\"byteLength\":" << binarySize << "}]";
+    }
+    json << "}";
+    return json.str ();
+  }
+
+  void toGlbFile (std::ostream& stream, const std::vector<const Mesh*>& meshes, bool isQuantized)
+  {
+    std::vector<GlbMesh> glbMeshes;
+    std::uint32_t        binarySize = 0;
+
+    glbMeshes.reserve (meshes.size ());
+    for (const Mesh* mesh : meshes)
+    {
+      glbMeshes.emplace_back (*mesh, isQuantized, binarySize);
+      binarySize += glbMeshes.back ().size ();
+    }
+
+    std::string json = glbJson (glbMeshes, binarySize, isQuantized);
+    json.resize (glbPadded (std::uint32_t (json.size ())), ' ');
+
+    const std::uint32_t jsonSize = std::uint32_t (json.size ());
+    const std::uint32_t length = 12 + 8 + jsonSize + (binarySize > 0 ? 8 + binarySize : 0);
+
+    const auto writeWord = [&stream](std::uint32_t value) {
+      char data[4];
+      toGlb<std::uint32_t> (data, value);
+      stream.write (data, 4);
+    };
+
+    writeWord (glbMagic);
+    writeWord (glbVersion);
+    writeWord (length);
+    writeWord (jsonSize);
+    writeWord (glbJsonChunk);
+    stream.write (json.data (), std::streamsize (jsonSize));
+
+    if (binarySize > 0)
+    {
+      writeWord (binarySize);
+      writeWord (glbBinaryChunk);
+      for (const GlbMesh& mesh : glbMeshes)
+      {
+        mesh.writeBuffers (stream);
+      }
+    }
+  }
+
+  bool isPlyFile (const char* begin, const char* end)
+  {
+    return end - begin >= 4 && std::memcmp (begin, "ply", 3) == 0 &&
+           (begin[3] == '\n' || begin[3] == '\r');
+  }
+
+  enum class PlyType
+  {
+    None,
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Float32,
+    Float64
+  };
+
+  struct PlyProperty
+  {
+    std::string name;
+    PlyType     type;
+    PlyType     countType;  // `PlyType::None` if the property is not a list
+  };
+
+  struct PlyElement
+  {
+    std::string              name;
+    unsigned int             count;
+    std::vector<PlyProperty> properties;
+  };
+
+  PlyType plyType (const std::string& name)
+  {
+    if (name == "char" || name == "int8")
+    {
+      return PlyType::Int8;
+    }
+    else if (name == "uchar" || name == "uint8")
+    {
+      return PlyType::UInt8;
+    }
+    else if (name == "short" || name == "int16")
+    {
+      return PlyType::Int16;
+    }
+    else if (name == "ushort" || name == "uint16")
+    {
+      return PlyType::UInt16;
+    }
+    else if (name == "int" || name == "int32")
+    {
+      return PlyType::Int32;
+    }
+    else if (name == "uint" || name == "uint32")
+    {
+      return PlyType::UInt32;
+    }
+    else if (name == "float" || name == "float32")
+    {
+      return PlyType::Float32;
+    }
+    else if (name == "double" || name == "float64")
+    {
+      return PlyType::Float64;
+    }
+    return PlyType::None;
+  }
+
+  std::size_t plySize (PlyType type)
+  {
+    switch (type)
+    {
+      case PlyType::Int8:
+      case PlyType::UInt8:
+        return 1;
+      case PlyType::Int16:
+      case PlyType::UInt16:
+        return 2;
+      case PlyType::Int32:
+      case PlyType::UInt32:
+      case PlyType::Float32:
+        return 4;
+      case PlyType::Float64:
+        return 8;
+      default:
+        DILAY_IMPOSSIBLE
+    }
+  }
+
+  template <typename T> double plyValue (const char* data, bool isBigEndian)
+  {
+    char bytes[sizeof (T)];
+    T    value;
+
+    std::memcpy (bytes, data, sizeof (T));
+    if (isBigEndian != (Q_BYTE_ORDER == Q_BIG_ENDIAN))
+    {
+      std::reverse (bytes, bytes + sizeof (T));
+    }
+    std::memcpy (&value, bytes, sizeof (T));
+    return double(value);
+  }
+
+  double plyValue (const char* data, PlyType type, bool isBigEndian)
+  {
+    switch (type)
+    {
+      case PlyType::Int8:
+        return plyValue<std::int8_t> (data, isBigEndian);
+      case PlyType::UInt8:
+        return plyValue<std::uint8_t> (data, isBigEndian);
+      case PlyType::Int16:
+        return plyValue<std::int16_t> (data, isBigEndian);
+      case PlyType::UInt16:
+        return plyValue<std::uint16_t> (data, isBigEndian);
+      case PlyType::Int32:
+        return plyValue<std::int32_t> (data, isBigEndian);
+      case PlyType::UInt32:
+        return plyValue<std::uint32_t> (data, isBigEndian);
+      case PlyType::Float32:
+        return plyValue<float> (data, isBigEndian);
+      case PlyType::Float64:
+        return plyValue<double> (data, isBigEndian);
+      default:
+        DILAY_IMPOSSIBLE
+    }
+  }
+
+  // only binary PLY files are supported, whose comments are ignored
+  bool fromPlyHeader (const char*& data, const char* end, bool& isBigEndian,
+                      std::vector<PlyElement>& elements)
+  {
+    bool hasFormat = false;
+
+    while (data < end)
+    {
+      const char* lineEnd = static_cast<const char*> (std::memchr (data, '\n', end - data));
+      if (lineEnd == nullptr)
+      {
+        return false;
+      }
+
+      std::istringstream line (std::string (data, lineEnd));
+      std::string        keyword;
+
+      data = lineEnd + 1;
+      line >> keyword;
+
+      if (keyword == "format")
+      {
+        std::string format;
+        line >> format;
+
+        if (format != "binary_little_endian" && format != "binary_big_endian")
+        {
+          DILAY_WARN ("unsupported format %s of PLY file", format.c_str ())
+          return false;
+        }
+        isBigEndian = format == "binary_big_endian";
+        hasFormat = true;
+      }
+      else if (keyword == "element")
+      {
+        elements.emplace_back ();
+        line >> elements.back ().name >> elements.back ().count;
+      }
+      else if (keyword == "property" && elements.empty () == false)
+      {
+        PlyProperty property;
+        std::string type;
+
+        line >> type;
+        if (type == "list")
+        {
+          std::string countType;
+          line >> countType >> type;
+          property.countType = plyType (countType);
+
+          if (property.countType == PlyType::None)
+          {
+            return false;
+          }
+        }
+        else
+        {
+          property.countType = PlyType::None;
+        }
+        property.type = plyType (type);
+        line >> property.name;
+
+        if (property.type == PlyType::None)
+        {
+          return false;
+        }
+        elements.back ().properties.push_back (property);
+      }
+      else if (keyword == "end_header")
+      {
+        return hasFormat;
+      }
+
+      if (line.fail ())
+      {
+        return false;
+      }
+    }
+    return false;
+  }
+
+  // points `values` to the `numValues` values of a property of a record and skips them
+  bool fromPlyProperty (const char*& data, const char* end, const PlyProperty& property,
+                        bool isBigEndian, const char*& values, unsigned int& numValues)
+  {
+    numValues = 1;
+    if (property.countType != PlyType::None)
+    {
+      if (std::size_t (end - data) < plySize (property.countType))
+      {
+        return false;
+      }
+      const double count = plyValue (data, property.countType, isBigEndian);
+
+      if (count < 0.0)
+      {
+        return false;
+      }
+      numValues = (unsigned int) (count);
+      data += plySize (property.countType);
+    }
+    if (std::size_t (end - data) / plySize (property.type) < numValues)
+    {
+      return false;
+    }
+    values = data;
+    data += numValues * plySize (property.type);
+    return true;
+  }
+
+  // vertices have no list properties, so they are read in parallel
+  bool fromPlyVertices (const char*& data, const char* end, const PlyElement& element,
+                        bool isBigEndian, std::vector<glm::vec3>& vertices)
+  {
+    std::size_t recordSize = 0;
+    std::size_t offsets[3] = {0, 0, 0};
+    PlyType     types[3] = {PlyType::None, PlyType::None, PlyType::None};
+
+    for (const PlyProperty& property : element.properties)
+    {
+      if (property.countType != PlyType::None)
+      {
+        DILAY_WARN ("unsupported list property %s of PLY vertices", property.name.c_str ())
+        return false;
+      }
+      else if (property.name == "x" || property.name == "y" || property.name == "z")
+      {
+        const unsigned int d = property.name == "x" ? 0 : (property.name == "y" ? 1 : 2);
+
+        offsets[d] = recordSize;
+        types[d] = property.type;
+      }
+      recordSize += plySize (property.type);
+    }
+
+    if (types[0] == PlyType::None || types[1] == PlyType::None || types[2] == PlyType::None ||
+        std::size_t (end - data) / recordSize < element.count)
+    {
+      return false;
+    }
+
+    vertices.resize (element.count);
+    ThreadPool::global ().parallelFor (
+      element.count, recordsPerChunk, [&](unsigned int first, unsigned int last) {
+        for (unsigned int v = first; v < last; v++)
+        {
+          const char* record = data + (v * recordSize);
+
+          for (unsigned int d = 0; d < 3; d++)
+          {
+            vertices[v][d] = float(plyValue (record + offsets[d], types[d], isBigEndian));
+          }
+        }
+      });
+    data += element.count * recordSize;
+    return true;
+  }
+
+  // polygons are split into fans of triangles
+  bool fromPlyFaces (const char*& data, const char* end, const PlyElement& element,
+                     bool isBigEndian, const std::vector<glm::vec3>& vertices,
+                     std::vector<glm::vec3>& corners)
+  {
+    for (unsigned int f = 0; f < element.count; f++)
+    {
+      for (const PlyProperty& property : element.properties)
+      {
+        const char*  values;
+        unsigned int numValues;
+
+        if (fromPlyProperty (data, end, property, isBigEndian, values, numValues) == false)
+        {
+          return false;
+        }
+        else if (property.name != "vertex_indices" && property.name != "vertex_index")
+        {
+          continue;
+        }
+
+        const std::size_t size = plySize (property.type);
+        unsigned int      indices[3] = {0, 0, 0};
+
+        for (unsigned int i = 0; i < numValues; i++)
+        {
+          const double index = plyValue (values + (i * size), property.type, isBigEndian);
+
+          if ((index >= 0.0 && index < double(vertices.size ())) == false)
+          {
+            DILAY_WARN ("invalid vertex index of PLY face %u", f)
+            return false;
+          }
+          indices[glm::min (i, 2u)] = (unsigned int) (index);
+
+          if (i >= 2)
+          {
+            corners.push_back (vertices[indices[0]]);
+            corners.push_back (vertices[indices[1]]);
+            corners.push_back (vertices[indices[2]]);
+            indices[1] = indices[2];
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  bool skipPlyElement (const char*& data, const char* end, const PlyElement& element,
+                       bool isBigEndian)
+  {
+    for (unsigned int i = 0; i < element.count; i++)
+    {
+      for (const PlyProperty& property : element.properties)
+      {
+        const char*  values;
+        unsigned int numValues;
+
+        if (fromPlyProperty (data, end, property, isBigEndian, values, numValues) == false)
+        {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // vertices are welded, such that files that store each face with its own vertices are read
+  bool fromPlyFile (const char* begin, const char* end, std::vector<Mesh>& meshes)
+  {
+    const char*             data = begin;
+    bool                    isBigEndian = false;
+    std::vector<PlyElement> elements;
+    std::vector<glm::vec3>  vertices;
+    std::vector<glm::vec3>  corners;
+
+    if (fromPlyHeader (data, end, isBigEndian, elements) == false)
+    {
+      DILAY_WARN ("could not parse header of PLY file")
+      return false;
+    }
+
+    for (const PlyElement& element : elements)
+    {
+      if (element.name == "vertex"
+            ? fromPlyVertices (data, end, element, isBigEndian, vertices) == false
+            : (element.name == "face"
+                 ? fromPlyFaces (data, end, element, isBigEndian, vertices, corners) == false
+                 : skipPlyElement (data, end, element, isBigEndian) == false))
+      {
+        DILAY_WARN ("could not parse element %s of PLY file", element.name.c_str ())
+        return false;
+      }
+    }
+    meshes.push_back (MeshUtil::weld (corners));
+    return true;
+  }
+};
+
+struct ImportExportContents::Impl
+{
+  std::string                   fileName;
+  std::vector<ContentsEntry>    meshEntries;
+  std::vector<ContentsEntry>    sketchEntries;
+  std::uint32_t                 version;
+  std::vector<Mesh>             meshes;
+  std::vector<DynamicMeshCache> caches;
+  std::vector<SketchCopy>       sketches;
+  std::vector<bool>             isMeshLoaded;
+  std::vector<bool>             isSketchLoaded;
+  bool                          isImported;
+
+  Impl ()
+    : version (0)
+    , isImported (false)
+  {
+  }
+
+  void clear ()
+  {
+    this->fileName.clear ();
+    this->meshEntries.clear ();
+    this->sketchEntries.clear ();
+    this->version = 0;
+    this->meshes.clear ();
+    this->caches.clear ();
+    this->sketches.clear ();
+    this->isMeshLoaded.clear ();
+    this->isSketchLoaded.clear ();
+    this->isImported = false;
+  }
+
+  bool fromData (const char* begin, const char* end)
+  {
+    bool isParsed;
+
+    this->clear ();
+
+    if (std::size_t (end - begin) >= sizeof (binaryMagic) &&
+        std::memcmp (begin, binaryMagic, sizeof (binaryMagic)) == 0)
+    {
+      isParsed = fromBinaryDlyFile (begin + sizeof (binaryMagic), end, this->meshes,
+                                    this->caches, this->sketches);
+    }
+    else if (isPlyFile (begin, end))
+    {
+      isParsed = fromPlyFile (begin, end, this->meshes);
+      this->isImported = true;
+    }
+    else if (isStlFile (begin, end))
+    {
+      isParsed = fromStlFile (begin, end, this->meshes);
+      this->isImported = true;
+    }
+    else
+    {
+      isParsed = fromTextDlyFile (begin, end, this->meshes, this->sketches);
+    }
+
+    if (isParsed == false)
+    {
+      return false;
+    }
+    this->caches.resize (this->meshes.size ());
+
+    for (unsigned int i = this->meshes.size (); i-- > 0;)
+    {
+      if (this->meshes[i].numVertices () == 0)
+      {
+        this->meshes.erase (this->meshes.begin () + i);
+        this->caches.erase (this->caches.begin () + i);
+      }
+    }
+    for (unsigned int i = 0; i < this->meshes.size (); i++)
+    {
+      if (this->prepareMesh (this->meshes[i], this->caches[i]) == false)
+      {
+        return false;
+      }
+    }
+    for (const Mesh& m : this->meshes)
+    {
+      this->meshEntries.emplace_back ();
+      this->meshEntries.back ().numFaces = m.numIndices () / 3;
+      for (unsigned int i = 0; i < m.numVertices (); i++)
+      {
+        this->meshEntries.back ().extend (m.vertex (i), m.vertex (i));
+      }
+    }
+    for (const SketchCopy& s : this->sketches)
+    {
+      this->sketchEntries.push_back (contentsEntry (s.tree, s.paths));
+    }
+    this->isMeshLoaded.resize (this->meshes.size (), true);
+    this->isSketchLoaded.resize (this->sketches.size (), true);
+    return true;
+  }
+
+  /* Meshes with caches have been written by `DynamicMesh::cache`, so they are neither checked
+   * nor reordered, which would invalidate their caches.
+   */
+  bool prepareMesh (Mesh& mesh, const DynamicMeshCache& cache) const
   {
-    is >> v.x >> v.y >> v.z;
-    return is;
+    if (cache.isEmpty ())
+    {
+      if (MeshUtil::checkConsistency (mesh) == false)
+      {
+        return false;
+      }
+      mesh = MeshUtil::optimizeLayout (mesh);
+    }
+    return true;
   }
 
-  void toDlyFile (std::ostream& stream, const Mesh& mesh)
+  // streams that cannot seek, e.g. pipes, are read sequentially
+  bool fromDlyFile (std::istream& stream)
   {
-    stream << "o\n";
-    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    std::vector<char>    data;
+    const std::streampos begin = stream.tellg ();
+    std::streampos       end = -1;
+
+    if (begin != std::streampos (-1) && stream.seekg (0, std::ios::end))
+    {
+      end = stream.tellg ();
+    }
+
+    if (end != std::streampos (-1) && stream.seekg (begin))
     {
-      stream << "v " << mesh.vertex (i) << std::endl;
+      data.resize (std::size_t (end - begin));
+      stream.read (data.data (), std::streamsize (data.size ()));
+
+      if (stream.fail ())
+      {
+        return false;
+      }
     }
-    for (unsigned int i = 0; i < mesh.numIndices (); i += 3)
+    else
     {
-      stream << "f " << mesh.index (i + 0) + 1 << " " << mesh.index (i + 1) + 1 << " "
-             << mesh.index (i + 2) + 1 << std::endl;
+      stream.clear ();
+      data.assign (std::istreambuf_iterator<char> (stream), std::istreambuf_iterator<char> ());
+
+      if (stream.bad ())
+      {
+        return false;
+      }
     }
+    return this->fromData (data.data (), data.data () + data.size ());
   }
 
-  unsigned int toDlyFile (std::ostream& stream, const SketchNode& node, unsigned int parentIndex,
-                          unsigned nodeIndex)
+  // files are mapped if possible, such that large files are not copied before they are parsed
+  bool fromDlyFile (const std::string& fileName)
   {
-    stream << "dly_sketch_node " << nodeIndex << " " << parentIndex << " " << node.data ().center ()
-           << " " << node.data ().radius () << std::endl;
+    QFile file (QString::fromStdString (fileName));
 
-    unsigned int childIndex = nodeIndex;
+    if (file.open (QIODevice::ReadOnly) == false)
+    {
+      return false;
+    }
 
-    node.forEachConstChild ([&stream, nodeIndex, &childIndex](const SketchNode& child) {
-      childIndex = toDlyFile (stream, child, nodeIndex, childIndex + 1);
-    });
-    return childIndex;
+    const uchar* data = file.size () > 0 ? file.map (0, file.size ()) : nullptr;
+
+    if (data)
+    {
+      const char* begin = reinterpret_cast<const char*> (data);
+      return this->fromData (begin, begin + file.size ());
+    }
+    else
+    {
+      std::ifstream stream (fileName, std::ios::in | std::ios::binary);
+      return stream.is_open () && this->fromDlyFile (stream);
+    }
   }
 
-  void toDlyFile (std::ostream& stream, const SketchPath& path)
+  bool tableOfContentsFromDlyFile (const std::string& fileName)
   {
-    if (path.isEmpty () == false)
+    std::ifstream file (fileName, std::ios::in | std::ios::binary);
+    char          header[headerSize];
+
+    this->clear ();
+
+    if (file.is_open () == false)
     {
-      stream << "dly_sketch_path"
-             << " " << path.intersectionFirst () << " " << path.intersectionLast () << std::endl;
+      return false;
+    }
+    file.seekg (0, std::ios::end);
 
-      for (const PrimSphere& s : path.spheres ())
-      {
-        stream << "dly_sketch_sphere"
-               << " " << s.center () << " " << s.radius () << std::endl;
-      }
+    const std::uint64_t fileSize = std::uint64_t (file.tellg ());
+
+    file.seekg (0);
+    file.read (header, headerSize);
+
+    BinaryReader  reader (header + sizeof (binaryMagic), header + headerSize);
+    std::uint32_t version, numMeshes, numSketches;
+
+    if (file.fail () || std::memcmp (header, binaryMagic, sizeof (binaryMagic)) != 0 ||
+        reader.read (version) == false || version < 3)
+    {
+      return this->fromDlyFile (fileName);
+    }
+    else if (version > binaryVersion || reader.read (numMeshes) == false ||
+             reader.read (numSketches) == false)
+    {
+      DILAY_WARN ("unsupported version %u of binary file", version)
+      return false;
     }
-  }
 
-  void toDlyFile (std::ostream& stream, const SketchMesh& mesh)
-  {
-    if (mesh.isEmpty () == false)
+    const std::uint64_t numEntries = std::uint64_t (numMeshes) + numSketches;
+
+    if (numEntries * contentsEntrySize > fileSize - headerSize)
     {
-      stream << "dly_sketch_mesh\n";
+      DILAY_WARN ("invalid table of contents of binary file")
+      return false;
+    }
 
-      if (mesh.tree ().hasRoot ())
-      {
-        toDlyFile (stream, mesh.tree ().root (), Util::invalidIndex (), 0);
-      }
+    std::vector<char>          contents (numEntries * contentsEntrySize);
+    std::vector<ContentsEntry> entries;
 
-      for (const SketchPath& p : mesh.paths ())
-      {
-        toDlyFile (stream, p);
-      }
+    file.read (contents.data (), std::streamsize (contents.size ()));
+
+    BinaryReader contentsReader (contents.data (), contents.data () + contents.size ());
+
+    if (file.fail () || readContents (contentsReader, numEntries, fileSize, entries) == false)
+    {
+      DILAY_WARN ("could not parse table of contents of binary file")
+      return false;
     }
+    this->fileName = fileName;
+    this->version = version;
+    this->meshEntries.assign (entries.begin (), entries.begin () + numMeshes);
+    this->sketchEntries.assign (entries.begin () + numMeshes, entries.end ());
+    this->meshes.resize (numMeshes);
+    this->caches.resize (numMeshes);
+    this->sketches.resize (numSketches);
+    this->isMeshLoaded.resize (numMeshes, false);
+    this->isSketchLoaded.resize (numSketches, false);
+    return true;
   }
-};
 
-namespace ImportExport
-{
-  void toDlyFile (std::ostream& stream, Scene& scene, bool isObjFile)
+  bool readPart (const ContentsEntry& entry, std::vector<char>& data) const
   {
-    scene.forEachMesh ([&stream](DynamicMesh& mesh) {
-      mesh.prune ();
-      ::toDlyFile (stream, mesh.mesh ());
-    });
+    std::ifstream file (this->fileName, std::ios::in | std::ios::binary);
+
+    data.resize (entry.size);
+    file.seekg (std::streamoff (entry.offset));
+    file.read (data.data (), std::streamsize (data.size ()));
+
+    return file.is_open () && file.fail () == false;
+  }
+
+  bool loadMesh (unsigned int i)
+  {
+    assert (i < this->meshes.size ());
 
-    if (isObjFile == false)
+    std::vector<char> data;
+    Mesh              mesh;
+    DynamicMeshCache  cache;
+
+    if (this->isMeshLoaded[i])
+    {
+      return true;
+    }
+    else if (this->readPart (this->meshEntries[i], data) == false)
+    {
+      return false;
+    }
+
+    BinaryReader reader (data.data (), data.data () + data.size ());
+
+    if (fromCompressedDlyFile (reader, this->version, mesh, cache) == false)
+    {
+      DILAY_WARN ("could not parse mesh %u of binary file", i)
+      return false;
+    }
+    else if (mesh.numVertices () > 0 && this->prepareMesh (mesh, cache) == false)
     {
-      scene.forEachConstMesh ([&stream](const SketchMesh& mesh) { ::toDlyFile (stream, mesh); });
+      return false;
     }
+    this->meshes[i] = std::move (mesh);
+    this->caches[i] = std::move (cache);
+    this->isMeshLoaded[i] = true;
+    return true;
   }
 
-  bool toDlyFile (const std::string& fileName, Scene& scene, bool isObjFile)
+  bool loadSketch (unsigned int i)
   {
-    std::ofstream file (fileName);
+    assert (i < this->sketches.size ());
 
-    if (file.is_open ())
+    std::vector<char> data;
+    SketchCopy        sketch;
+
+    if (this->isSketchLoaded[i])
     {
-      ImportExport::toDlyFile (file, scene, isObjFile);
-      file.close ();
       return true;
     }
-    else
+    else if (this->readPart (this->sketchEntries[i], data) == false)
+    {
+      return false;
+    }
+
+    BinaryReader reader (data.data (), data.data () + data.size ());
+
+    if (fromBinaryDlyFile (reader, sketch) == false)
     {
+      DILAY_WARN ("could not parse sketch %u of binary file", i)
       return false;
     }
+    this->sketches[i] = std::move (sketch);
+    this->isSketchLoaded[i] = true;
+    return true;
   }
 
-  bool fromDlyFile (std::istream& stream, const Config& config, Scene& scene)
+  bool isImportedFile () const { return this->isImported; }
+
+  unsigned int numMeshes () const { return this->meshes.size (); }
+
+  unsigned int numSketches () const { return this->sketches.size (); }
+
+  unsigned int numFaces (unsigned int i) const
   {
-    unsigned int       lineNumber = 0;
-    std::istringstream lineStream;
+    assert (i < this->meshEntries.size ());
+    return this->meshEntries[i].numFaces;
+  }
 
-    std::vector<Mesh>        meshes;
-    std::vector<SketchNode*> nodes;
-    SketchMesh*              sketch = nullptr;
-    SketchPath*              sketchPath = nullptr;
-    glm::vec3                intersectionFirst, intersectionLast;
+  PrimAABox meshBounds (unsigned int i) const
+  {
+    assert (i < this->meshEntries.size ());
+    return PrimAABox (this->meshEntries[i].minimum, this->meshEntries[i].maximum);
+  }
 
-    auto extractFirst = [](const std::string& string, unsigned int& value) -> bool {
-      auto slashPos = string.find ('/');
-      return Util::fromString (string.substr (0, slashPos), value);
-    };
+  PrimAABox sketchBounds (unsigned int i) const
+  {
+    assert (i < this->sketchEntries.size ());
+    return PrimAABox (this->sketchEntries[i].minimum, this->sketchEntries[i].maximum);
+  }
 
-    auto nextLine = [&stream, &lineNumber, &lineStream]() -> bool {
-      std::string line;
-      std::getline (stream, line);
 
-      if (stream)
-      {
-        lineNumber++;
-        lineStream.clear ();
-        lineStream.str (line);
-        return true;
-      }
-      else
+  const Mesh& mesh (unsigned int i) const
+  {
+    assert (i < this->meshes.size ());
+    assert (this->isMeshLoaded[i]);
+    return this->meshes[i];
+  }
+
+  DynamicMesh dynamicMesh (unsigned int i) const
+  {
+    assert (i < this->meshes.size ());
+    assert (this->isMeshLoaded[i]);
+    return DynamicMesh (this->meshes[i], this->caches[i]);
+  }
+
+  void addMeshesToScene (const Config& config, Scene& scene) const
+  {
+    for (unsigned int i = 0; i < this->meshes.size (); i++)
+    {
+      if (this->isMeshLoaded[i] && this->meshes[i].numVertices () > 0)
       {
-        return false;
+        scene.newDynamicMesh (config, this->dynamicMesh (i));
       }
-    };
+    }
+  }
 
-    while (nextLine ())
+  void addSketchesToScene (const Config& config, Scene& scene) const
+  {
+    for (unsigned int i = 0; i < this->sketches.size (); i++)
     {
-      std::string keyword;
-      lineStream >> keyword;
-
-      if (lineStream.fail () == false)
+      if (this->isSketchLoaded[i])
       {
-        if (keyword == "o")
+        SketchMesh& sketch = scene.newSketchMesh (config, this->sketches[i].tree);
+
+        for (const SketchPath& p : this->sketches[i].paths)
         {
-          meshes.push_back (Mesh ());
+          sketch.addPath (p);
         }
-        else if (keyword == "v")
-        {
-          glm::vec3 vertex;
-          lineStream >> vertex;
+      }
+    }
+  }
+};
 
-          if (lineStream.fail ())
-          {
-            DILAY_WARN ("could not parse vertex at line %u", lineNumber)
-            return false;
-          }
-          else
-          {
-            if (meshes.empty ())
-            {
-              meshes.push_back (Mesh ());
-            }
-            meshes.back ().addVertex (vertex);
-          }
-        }
-        else if (keyword == "f")
-        {
-          std::string  v1String, v2String, v3String;
-          unsigned int v1, v2, v3;
+DELEGATE_BIG3 (ImportExportContents)
+DELEGATE1 (bool, ImportExportContents, fromDlyFile, std::istream&)
+DELEGATE1 (bool, ImportExportContents, fromDlyFile, const std::string&)
+DELEGATE1 (bool, ImportExportContents, tableOfContentsFromDlyFile, const std::string&)
+DELEGATE1 (bool, ImportExportContents, loadMesh, unsigned int)
+DELEGATE1 (bool, ImportExportContents, loadSketch, unsigned int)
+DELEGATE_CONST (bool, ImportExportContents, isImportedFile)
+DELEGATE_CONST (unsigned int, ImportExportContents, numMeshes)
+DELEGATE_CONST (unsigned int, ImportExportContents, numSketches)
+DELEGATE1_CONST (unsigned int, ImportExportContents, numFaces, unsigned int)
+DELEGATE1_CONST (PrimAABox, ImportExportContents, meshBounds, unsigned int)
+DELEGATE1_CONST (PrimAABox, ImportExportContents, sketchBounds, unsigned int)
+DELEGATE1_CONST (const Mesh&, ImportExportContents, mesh, unsigned int)
+DELEGATE1_CONST (DynamicMesh, ImportExportContents, dynamicMesh, unsigned int)
+DELEGATE2_CONST (void, ImportExportContents, addMeshesToScene, const Config&, Scene&)
+DELEGATE2_CONST (void, ImportExportContents, addSketchesToScene, const Config&, Scene&)
 
-          lineStream >> v1String >> v2String >> v3String;
+struct ImportExportSnapshot::Impl
+{
+  std::vector<std::shared_ptr<const DynamicMeshVersion>> meshes;
+  std::vector<SketchCopy>                                sketches;
 
-          if (lineStream.fail () || extractFirst (v1String, v1) == false ||
-              extractFirst (v2String, v2) == false || extractFirst (v3String, v3) == false)
-          {
-            DILAY_WARN ("could not parse face at line %u", lineNumber)
-            return false;
-          }
-          else
-          {
-            std::string  v4String;
-            unsigned int v4;
-            lineStream >> v4String;
-
-            if (lineStream.fail ())
-            {
-              lineStream.clear ();
-
-              if (meshes.empty ())
-              {
-                meshes.push_back (Mesh ());
-              }
-              MeshUtil::addFace (meshes.back (), v1 - 1, v2 - 1, v3 - 1);
-            }
-            else if (extractFirst (v4String, v4) == false)
-            {
-              DILAY_WARN ("could not parse face at line %u", lineNumber)
-              return false;
-            }
-            else
-            {
-              if (meshes.empty ())
-              {
-                meshes.push_back (Mesh ());
-              }
-              MeshUtil::addFace (meshes.back (), v1 - 1, v2 - 1, v3 - 1, v4 - 1);
-            }
-          }
-        }
-        else if (keyword == "dly_sketch_mesh")
-        {
-          nodes.clear ();
-          sketch = &scene.newSketchMesh (config, SketchTree ());
-        }
-        else if (keyword == "dly_sketch_node")
-        {
-          if (sketch == nullptr)
-          {
-            DILAY_WARN ("could not parse sketch node: no sketch found at line %u", lineNumber)
-            return false;
-          }
-          unsigned int nodeIndex;
-          unsigned int parentIndex;
-          glm::vec3    center;
-          float        radius;
+  Impl (const Scene& scene)
+  {
+    scene.forEachConstMesh (
+      [this](const DynamicMesh& mesh) { this->meshes.push_back (mesh.version ()); });
 
-          lineStream >> nodeIndex >> parentIndex >> center >> radius;
+    scene.forEachConstMesh ([this](const SketchMesh& mesh) {
+      if (mesh.isEmpty () == false)
+      {
+        this->sketches.push_back (SketchCopy{mesh.tree (), mesh.paths ()});
+      }
+    });
+  }
 
-          if (lineStream.fail ())
-          {
-            DILAY_WARN ("could not parse sketch node at line %u", lineNumber)
-            return false;
-          }
+  void toDlyFile (std::ostream& stream) const
+  {
+    toBinaryDlyFile (stream, this->meshes.size (), this->sketches.size (),
+                     [this](BinaryWriter& writer, unsigned int i) {
+                       if (i < this->meshes.size ())
+                       {
+                         return toBinaryDlyFile (writer, *this->meshes[i]);
+                       }
+                       else
+                       {
+                         const SketchCopy& sketch = this->sketches[i - this->meshes.size ()];
+                         return toBinaryDlyFile (writer, sketch.tree, sketch.paths);
+                       }
+                     });
+  }
 
-          if (nodeIndex == nodes.size ())
-          {
-            if (nodeIndex == 0)
-            {
-              nodes.push_back (&sketch->tree ().emplaceRoot (PrimSphere (center, radius)));
-            }
-            else if (parentIndex < nodes.size ())
-            {
-              nodes.push_back (&nodes.at (parentIndex)->emplaceChild (PrimSphere (center, radius)));
-            }
-            else
-            {
-              DILAY_WARN ("invalid parent index at line %u", lineNumber)
-              return false;
-            }
-          }
-          else
-          {
-            DILAY_WARN ("invalid node index at line %u", lineNumber)
-            return false;
-          }
-        }
-        else if (keyword == "dly_sketch_path")
-        {
-          lineStream >> intersectionFirst >> intersectionLast;
+  // the file is replaced only once the snapshot has been written completely
+  bool toDlyFile (const std::string& fileName) const
+  {
+    const std::string tmpFileName = fileName + ".tmp";
+    std::ofstream     file (tmpFileName, std::ios::out | std::ios::binary);
 
-          if (lineStream.fail ())
-          {
-            DILAY_WARN ("could not parse sketch path at line %u", lineNumber)
-            return false;
-          }
-          if (sketch)
-          {
-            sketchPath = &sketch->addPath (SketchPath ());
-          }
-          else
-          {
-            DILAY_WARN ("could not parse sketch path: no sketch found at line %u", lineNumber)
-            return false;
-          }
-        }
-        else if (keyword == "dly_sketch_sphere")
-        {
-          glm::vec3 center;
-          float     radius;
+    if (file.is_open ())
+    {
+      this->toDlyFile (file);
+      file.close ();
 
-          lineStream >> center >> radius;
+      if (file)
+      {
+        std::remove (fileName.c_str ());
+        return std::rename (tmpFileName.c_str (), fileName.c_str ()) == 0;
+      }
+    }
+    return false;
+  }
+};
 
-          if (lineStream.fail ())
-          {
-            DILAY_WARN ("could not parse sketch sphere at line %u", lineNumber)
-            return false;
-          }
+DELEGATE1_BIG3 (ImportExportSnapshot, const Scene&)
+DELEGATE1_CONST (void, ImportExportSnapshot, toDlyFile, std::ostream&)
+DELEGATE1_CONST (bool, ImportExportSnapshot, toDlyFile, const std::string&)
 
-          if (sketchPath)
-          {
-            if (sketchPath->isEmpty ())
-            {
-              sketchPath->addSphere (intersectionFirst, center, radius);
-            }
-            else
-            {
-              sketchPath->addSphere (intersectionLast, center, radius);
-            }
-          }
-          else
-          {
-            DILAY_WARN ("could not parse sketch sphere: no sketch path found at line %u",
-                        lineNumber)
-            return false;
-          }
-        }
-      }
+namespace ImportExport
+{
+  void toDlyFile (std::ostream& stream, Scene& scene, bool isObjFile, unsigned int minCachedFaces)
+  {
+    if (isObjFile)
+    {
+      scene.forEachConstMesh (
+        [&stream](const DynamicMesh& mesh) { ::toDlyFile (stream, compactMesh (mesh)); });
+    }
+    else
+    {
+      toBinaryDlyFile (stream, scene, minCachedFaces);
     }
-    meshes.erase (std::remove_if (meshes.begin (), meshes.end (),
-                                  [](Mesh& m) { return m.numVertices () == 0; }),
-                  meshes.end ());
+  }
+
+  bool toDlyFile (const std::string& fileName, Scene& scene, bool isObjFile,
+                  unsigned int minCachedFaces)
+  {
+    std::ofstream file (fileName, isObjFile ? std::ios::out : std::ios::out | std::ios::binary);
 
-    if (std::all_of (meshes.begin (), meshes.end (),
-                     [](Mesh& m) { return MeshUtil::checkConsistency (m); }))
+    if (file.is_open ())
+    {
+      ImportExport::toDlyFile (file, scene, isObjFile, minCachedFaces);
+      file.close ();
+      return true;
+    }
+    else
     {
-      for (Mesh& m : meshes)
+      return false;
+    }
+  }
+
+  void toGlbFile (std::ostream& stream, Scene& scene, bool quantize)
+  {
+    std::vector<Mesh>        compacted;
+    std::vector<const Mesh*> meshes;
+
+    scene.forEachConstMesh ([&compacted](const DynamicMesh& mesh) {
+      if (mesh.isEmpty () == false)
       {
-        scene.newDynamicMesh (config, m);
+        compacted.push_back (compactMesh (mesh));
       }
+    });
+    for (const Mesh& mesh : compacted)
+    {
+      meshes.push_back (&mesh);
+    }
+    ::toGlbFile (stream, meshes, quantize);
+  }
+
+  bool toGlbFile (const std::string& fileName, Scene& scene, bool quantize)
+  {
+    std::ofstream file (fileName, std::ios::out | std::ios::binary);
+
+    if (file.is_open ())
+    {
+      ImportExport::toGlbFile (file, scene, quantize);
+      file.close ();
+      return bool(file);
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  bool fromDlyFile (std::istream& stream, const Config& config, Scene& scene)
+  {
+    ImportExportContents contents;
+
+    if (contents.fromDlyFile (stream))
+    {
+      contents.addMeshesToScene (config, scene);
+      contents.addSketchesToScene (config, scene);
       return true;
     }
     else
@@ -349,13 +2676,13 @@ namespace ImportExport
 
   bool fromDlyFile (const std::string& fileName, const Config& config, Scene& scene)
   {
-    std::ifstream file (fileName);
+    ImportExportContents contents;
 
-    if (file.is_open ())
+    if (contents.fromDlyFile (fileName))
     {
-      const bool success = ImportExport::fromDlyFile (file, config, scene);
-      file.close ();
-      return success;
+      contents.addMeshesToScene (config, scene);
+      contents.addSketchesToScene (config, scene);
+      return true;
     }
     else
     {
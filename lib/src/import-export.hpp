@@ -7,14 +7,81 @@
 
 #include <iosfwd>
 #include <string>
+#include "macro.hpp"
 
 class Config;
+class DynamicMesh;
+class Mesh;
+class PrimAABox;
 class Scene;
 
+/* Meshes and sketches of a file.  A file can be read on any thread, whereas its contents must be
+ * added to a scene on the thread that renders the scene.
+ *
+ * `tableOfContentsFromDlyFile` only reads the table of contents of a binary file, after which
+ * meshes and sketches are read selectively by `loadMesh` and `loadSketch`.  Files without a table
+ * of contents are read completely.  Only loaded meshes and sketches are added to a scene.
+ *
+ * Binary STL and PLY files are imported as a single mesh, whose vertices are welded.
+ */
+class ImportExportContents
+{
+public:
+  DECLARE_BIG3 (ImportExportContents)
+
+  // reads the binary format, text, binary STL and binary PLY
+  bool         fromDlyFile (std::istream&);
+  bool         fromDlyFile (const std::string&);
+  bool         tableOfContentsFromDlyFile (const std::string&);
+  bool         loadMesh (unsigned int);
+  bool         loadSketch (unsigned int);
+  // whether the file was STL or PLY, which can not be written
+  bool         isImportedFile () const;
+  unsigned int numMeshes () const;
+  unsigned int numSketches () const;
+  unsigned int numFaces (unsigned int) const;
+  PrimAABox    meshBounds (unsigned int) const;
+  PrimAABox    sketchBounds (unsigned int) const;
+  // require the mesh to be loaded
+  const Mesh&  mesh (unsigned int) const;
+  // restores the adjacency and octree of the mesh if the file has stored them
+  DynamicMesh  dynamicMesh (unsigned int) const;
+  void         addMeshesToScene (const Config&, Scene&) const;
+  void         addSketchesToScene (const Config&, Scene&) const;
+
+private:
+  IMPLEMENTATION
+};
+
+/* Copy of the meshes and sketches of a scene, which can be written on another thread.  Meshes are
+ * pinned versions (cf. `DynamicMesh::version`) that share their chunks with the scene, so taking a
+ * snapshot is cheap.
+ */
+class ImportExportSnapshot
+{
+public:
+  DECLARE_BIG3 (ImportExportSnapshot, const Scene&)
+
+  // writes the binary format
+  void toDlyFile (std::ostream&) const;
+  bool toDlyFile (const std::string&) const;
+
+private:
+  IMPLEMENTATION
+};
+
 namespace ImportExport
 {
-  void toDlyFile (std::ostream&, Scene&, bool);
-  bool toDlyFile (const std::string&, Scene&, bool);
+  /* Writes Wavefront files as text and everything else in the binary format, which stores the
+   * caches of meshes with at least the given number of faces (cf. `DynamicMeshCache`), or of no
+   * meshes if it is 0.
+   */
+  void toDlyFile (std::ostream&, Scene&, bool, unsigned int = 0);
+  bool toDlyFile (const std::string&, Scene&, bool, unsigned int = 0);
+  // writes dynamic meshes as binary glTF, whose positions and normals are quantized if requested
+  void toGlbFile (std::ostream&, Scene&, bool);
+  bool toGlbFile (const std::string&, Scene&, bool);
+  // cf. `ImportExportContents::fromDlyFile`
   bool fromDlyFile (std::istream&, const Config&, Scene&);
   bool fromDlyFile (const std::string&, const Config&, Scene&);
 };
@@ -7,6 +7,7 @@
 #include "intersection.hpp"
 #include "primitive/aabox.hpp"
 #include "primitive/cone.hpp"
+#include "primitive/convex-polytope.hpp"
 #include "primitive/cylinder.hpp"
 #include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
@@ -490,3 +491,30 @@ bool IntersectionUtil::intersects (const PrimAABox& box, const PrimTriangle& tri
     return IntersectionUtil::intersects (PrimPlane (tri.vertex1 (), tri.normal ()), box);
   }
 }
+
+bool IntersectionUtil::intersects (const PrimConvexPolytope& polytope, const PrimAABox& box)
+{
+  for (const PrimPlane& plane : polytope.planes ())
+  {
+    const float r = glm::dot (box.halfWidth (), glm::abs (plane.normal ()));
+
+    if (plane.distance (box.center ()) - r > 0.0f)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IntersectionUtil::intersects (const PrimConvexPolytope& polytope, const PrimTriangle& tri)
+{
+  for (const PrimPlane& plane : polytope.planes ())
+  {
+    if (plane.distance (tri.vertex1 ()) > 0.0f && plane.distance (tri.vertex2 ()) > 0.0f &&
+        plane.distance (tri.vertex3 ()) > 0.0f)
+    {
+      return false;
+    }
+  }
+  return true;
+}
@@ -9,6 +9,7 @@
 
 class PrimAABox;
 class PrimCone;
+class PrimConvexPolytope;
 class PrimCylinder;
 class PrimPlane;
 class PrimRay;
@@ -55,6 +56,10 @@ namespace IntersectionUtil
   bool intersects (const PrimCone&, const glm::vec3&);
   bool intersects (const PrimAABox&, const PrimAABox&);
   bool intersects (const PrimAABox&, const PrimTriangle&);
+
+  // conservative tests, which only fail if a plane of the polytope separates the primitive
+  bool intersects (const PrimConvexPolytope&, const PrimAABox&);
+  bool intersects (const PrimConvexPolytope&, const PrimTriangle&);
 }
 
 #endif
@@ -3,8 +3,10 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <glm/gtx/norm.hpp>
-#include <thread>
 #include <vector>
 #include "distance.hpp"
 #include "dynamic/mesh.hpp"
@@ -12,174 +14,456 @@
 #include "isosurface-extraction.hpp"
 #include "isosurface-extraction/grid.hpp"
 #include "mesh.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
+#include "primitive/triangle.hpp"
+#include "profiler.hpp"
+#include "thread-pool.hpp"
 #include "util.hpp"
 
 namespace
 {
-  typedef IsosurfaceExtraction::DistanceCallback     DistanceCallback;
-  typedef IsosurfaceExtraction::IntersectionCallback IntersectionCallback;
+  typedef IsosurfaceExtraction::DistanceCallback           DistanceCallback;
+  typedef IsosurfaceExtraction::InsideCallback             InsideCallback;
+  typedef IsosurfaceExtraction::IntersectionCallback       IntersectionCallback;
+  typedef IsosurfaceExtraction::PacketIntersectionCallback PacketIntersectionCallback;
+  typedef IsosurfaceExtraction::ProgressCallback           ProgressCallback;
 
-  static const float markInside = -0.5f;
-  static const float markOutside = 0.5f;
-  static const float markInsideToSample = -0.6f;
-  static const float markOutsideToSample = 0.6f;
+  const float& markInside = IsosurfaceExtractionGrid::markInside;
+  const float& markOutside = IsosurfaceExtractionGrid::markOutside;
+  const float& markInsideToSample = IsosurfaceExtractionGrid::markInsideToSample;
+  const float& markOutsideToSample = IsosurfaceExtractionGrid::markOutsideToSample;
+
+  // distances are sampled in cubic tiles of samples, each of which is a task of the thread pool
+  static const unsigned int tileSize = 8;
+
+  // width of the band around the surface (in samples), in which distances are sampled exactly
+  static const float narrowBand = 2.0f;
 
   struct Parameters
   {
-    const DistanceCallback&     getDistance;
-    const IntersectionCallback* getIntersection;
-    IsosurfaceExtractionGrid    grid;
-
-    Parameters (const DistanceCallback& d, const IntersectionCallback* i, const PrimAABox& b,
-                float r)
+    const DistanceCallback&           getDistance;
+    const PacketIntersectionCallback* getIntersection;
+    const ProgressCallback&           progress;
+    const CancellationToken*          token;
+    IsosurfaceExtractionGrid&         grid;
+    // whether the signs of all samples are classified before distances are sampled
+    bool                              isClassified;
+    unsigned int                      numTasks;
+    std::atomic<unsigned int>         numFinishedTasks;
+
+    Parameters (const DistanceCallback& d, const PacketIntersectionCallback* i,
+                const ProgressCallback& p, const CancellationToken* t, IsosurfaceExtractionGrid& g)
       : getDistance (d)
       , getIntersection (i)
-      , grid (b, r)
+      , progress (p)
+      , token (t)
+      , grid (g)
+      , isClassified (i != nullptr)
+      , numTasks (0)
+      , numFinishedTasks (0)
     {
     }
+
+    bool hasSamples () const
+    {
+      return this->grid.numSamples ().x > 0 && this->grid.numSamples ().y > 0 &&
+             this->grid.numSamples ().z > 0;
+    }
+
+    bool isCancelled () const { return this->token && this->token->isCancelled (); }
+
+    void finishTasks (unsigned int n)
+    {
+      const unsigned int numFinished = this->numFinishedTasks += n;
+
+      if (this->progress)
+      {
+        assert (numFinished <= this->numTasks);
+        this->progress (float(numFinished) / float(this->numTasks));
+      }
+    }
   };
 
-  void sampleDistancesThread (Parameters& params, unsigned int numThreads, unsigned int threadId)
+  // a sampled distance, which bounds the distances at nearby positions
+  struct SampledDistance
   {
-    std::vector<float>& samples = params.grid.samples ();
+    glm::vec3 pos;
+    float     distance;
+
+    SampledDistance ()
+      : pos (0.0f)
+      , distance (Util::maxFloat ())
+    {
+    }
+
+    SampledDistance (const glm::vec3& p, float d)
+      : pos (p)
+      , distance (d)
+    {
+    }
 
-    for (unsigned int z = 0; z < params.grid.numSamples ().z; z++)
+    float upperBound (const glm::vec3& p) const
+    {
+      return this->distance == Util::maxFloat ()
+               ? Util::maxFloat ()
+               : this->distance + glm::distance (this->pos, p) + Util::epsilon ();
+    }
+  };
+
+  /* If every sample of the tile `[begin, end)` is farther away from the surface than
+   * `narrowBand`, no cube with a sample in the tile is intersected.  In this case all samples of
+   * the tile are set to a bound of their distance derived from the distance at the tile's center,
+   * which has their sign, and `true` is returned.  Skipping a tile only saves calls of the
+   * distance callback: its samples are stored like all others, so the memory of a grid does not
+   * shrink, cf. `IsosurfaceExtractionGrid::SampleFormat`.
+   */
+  bool skipFarTile (Parameters& params, const glm::uvec3& begin, const glm::uvec3& end)
+  {
+    const glm::vec3 minPos = params.grid.samplePos (begin.x, begin.y, begin.z);
+    const glm::vec3 maxPos = params.grid.samplePos (end.x - 1, end.y - 1, end.z - 1);
+    const glm::vec3 center = 0.5f * (minPos + maxPos);
+    const float     halfDiagonal = 0.5f * glm::distance (minPos, maxPos);
+    const float     threshold = halfDiagonal + (narrowBand * params.grid.resolution ());
+    const float     distance = params.getDistance (center, threshold);
+
+    if (glm::abs (distance) < threshold)
+    {
+      return false;
+    }
+    else
     {
-      for (unsigned int y = 0; y < params.grid.numSamples ().y; y++)
+      const float bound = glm::sign (distance) * (glm::abs (distance) - halfDiagonal);
+
+      for (unsigned int z = begin.z; z < end.z; z++)
       {
-        for (unsigned int x = 0; x < params.grid.numSamples ().x; x++)
+        for (unsigned int y = begin.y; y < end.y; y++)
+        {
+          for (unsigned int x = begin.x; x < end.x; x++)
+          {
+            const unsigned int index = params.grid.sampleIndex (x, y, z);
+
+            assert (params.grid.sample (index) == Util::maxFloat ());
+            params.grid.sample (index, bound);
+          }
+        }
+      }
+      return true;
+    }
+  }
+
+  /* Samples a tile of `tileSize`³ samples.  Since unsigned distances change at most by the
+   * distance between two sample positions, already sampled neighbours bound the distance of the
+   * next sample, which lets the distance callback terminate early.  Besides the previous sample,
+   * the first samples of the previous row and slice of the tile are used as neighbours.
+   */
+  void sampleDistancesTile (Parameters& params, const glm::uvec3& tile)
+  {
+    PROFILE_ZONE ("isosurface/sample-distances-tile")
+    const glm::uvec3& numSamples = params.grid.numSamples ();
+    const glm::uvec3  begin = tile * tileSize;
+    const glm::uvec3  end = glm::min (begin + glm::uvec3 (tileSize), numSamples);
+
+    // samples of the narrow band have already been marked if signs are classified
+    if (params.isClassified == false && skipFarTile (params, begin, end))
+    {
+      return;
+    }
+    SampledDistance     previous, firstOfRow, firstOfSlice;
+    bool                isNewRow = true;
+    bool                isNewSlice = true;
+
+    const auto getDistance = [&](const glm::vec3& pos) {
+      const float upperBound =
+        glm::min (previous.upperBound (pos),
+                  glm::min (firstOfRow.upperBound (pos), firstOfSlice.upperBound (pos)));
+
+      previous = SampledDistance (pos, params.getDistance (pos, upperBound));
+
+      if (isNewRow)
+      {
+        firstOfRow = previous;
+        isNewRow = false;
+      }
+      if (isNewSlice)
+      {
+        firstOfSlice = previous;
+        isNewSlice = false;
+      }
+      return previous.distance;
+    };
+
+    for (unsigned int z = begin.z; z < end.z; z++)
+    {
+      isNewSlice = true;
+
+      for (unsigned int y = begin.y; y < end.y; y++)
+      {
+        isNewRow = true;
+
+        for (unsigned int x = begin.x; x < end.x; x++)
         {
           const unsigned int index = params.grid.sampleIndex (x, y, z);
+          const glm::vec3    pos = params.grid.samplePos (x, y, z);
+          const float        current = params.grid.sample (index);
+          float              sample;
 
-          if (index % numThreads == threadId)
+          if (params.isClassified)
           {
-            const glm::vec3 pos = params.grid.samplePos (x, y, z);
-
-            if (params.getIntersection)
+            if (current == markInsideToSample)
             {
-              if (samples[index] == markInsideToSample)
-              {
-                samples[index] = -params.getDistance (pos);
-              }
-              else if (samples[index] == markOutsideToSample)
-              {
-                samples[index] = params.getDistance (pos);
-              }
-              else
-              {
-                continue;
-              }
+              sample = -getDistance (pos);
+            }
+            else if (current == markOutsideToSample)
+            {
+              sample = getDistance (pos);
             }
             else
             {
-              assert (samples[index] == Util::maxFloat ());
-              samples[index] = params.getDistance (pos);
+              continue;
             }
-            assert (Util::isNaN (samples[index]) == false);
-            assert (samples[index] != Util::maxFloat ());
-            assert ((x > 0 && x < params.grid.numSamples ().x - 1) || samples[index] > 0.0f);
-            assert ((y > 0 && y < params.grid.numSamples ().y - 1) || samples[index] > 0.0f);
-            assert ((z > 0 && z < params.grid.numSamples ().z - 1) || samples[index] > 0.0f);
           }
+          else
+          {
+            assert (current == Util::maxFloat ());
+            sample = getDistance (pos);
+          }
+          assert (Util::isNaN (sample) == false);
+          assert (sample != Util::maxFloat ());
+          assert ((x > 0 && x < numSamples.x - 1) || sample > 0.0f);
+          assert ((y > 0 && y < numSamples.y - 1) || sample > 0.0f);
+          assert ((z > 0 && z < numSamples.z - 1) || sample > 0.0f);
+          params.grid.sample (index, sample);
         }
       }
     }
   }
 
-  void sampleDistances (Parameters& params)
+  glm::uvec3 numTiles (const Parameters& params)
   {
-    const unsigned int       numThreads = std::thread::hardware_concurrency ();
-    std::vector<std::thread> threads;
+    return (params.grid.numSamples () + glm::uvec3 (tileSize - 1)) / tileSize;
+  }
 
-    for (unsigned int i = 0; i < numThreads; i++)
-    {
-      threads.emplace_back (sampleDistancesThread, std::ref (params), numThreads, i);
-    }
-    for (unsigned int i = 0; i < numThreads; i++)
+  // samples the tiles `[tileBegin, tileEnd)`
+  bool sampleDistances (Parameters& params, const glm::uvec3& tileBegin, const glm::uvec3& tileEnd)
+  {
+    PROFILE_ZONE ("isosurface/sample-distances")
+    const glm::uvec3 numTiles = tileEnd - tileBegin;
+
+    return ThreadPool::global ().parallelFor (
+      numTiles.x * numTiles.y * numTiles.z, 1,
+      [&params, &tileBegin, &numTiles](unsigned int t, unsigned int) {
+        const glm::uvec3 tile (t % numTiles.x, (t / numTiles.x) % numTiles.y,
+                               t / (numTiles.x * numTiles.y));
+        sampleDistancesTile (params, tileBegin + tile);
+        params.finishTasks (1);
+      },
+      params.token);
+  }
+
+  bool sampleDistances (Parameters& params)
+  {
+    return sampleDistances (params, glm::uvec3 (0), numTiles (params));
+  }
+
+  // range `[tileBegin, tileEnd)` of the tiles that contain the samples of a region
+  void tileRange (const Parameters& params, const PrimAABox& region, glm::uvec3& tileBegin,
+                  glm::uvec3& tileEnd)
+  {
+    glm::uvec3 sampleBegin, sampleEnd;
+    params.grid.sampleRange (region, sampleBegin, sampleEnd);
+
+    tileBegin = sampleBegin / tileSize;
+    tileEnd = (sampleEnd + glm::uvec3 (tileSize - 1)) / tileSize;
+  }
+
+  unsigned int numTiles (const glm::uvec3& tileBegin, const glm::uvec3& tileEnd)
+  {
+    const glm::uvec3 n = tileEnd - tileBegin;
+    return n.x * n.y * n.z;
+  }
+
+  // resets the samples of the tiles `[tileBegin, tileEnd)`, such that they can be sampled again
+  void resetTiles (Parameters& params, const glm::uvec3& tileBegin, const glm::uvec3& tileEnd)
+  {
+    const glm::uvec3 begin = tileBegin * tileSize;
+    const glm::uvec3 end = glm::min (tileEnd * tileSize, params.grid.numSamples ());
+
+    for (unsigned int z = begin.z; z < end.z; z++)
     {
-      threads.at (i).join ();
+      for (unsigned int y = begin.y; y < end.y; y++)
+      {
+        const unsigned int index = params.grid.sampleIndex (begin.x, y, z);
+
+        for (unsigned int i = index; i < index + (end.x - begin.x); i++)
+        {
+          params.grid.sample (i, Util::maxFloat ());
+        }
+      }
     }
   }
 
-  void sampleIntersectionsThread (Parameters& params, unsigned int numThreads,
-                                  unsigned int threadId)
+  // state of a ray that samples a single (x, y) column of the grid
+  struct SampleColumn
+  {
+    unsigned int x;
+    unsigned int z;
+    bool         inside;
+    glm::vec3    origin;
+  };
+
+  /* All columns of a row are sampled as one packet of coherent rays: each iteration intersects
+   * the rays of all columns that have not left the grid yet and advances them past their
+   * intersections.
+   */
+  void sampleIntersectionsRows (Parameters& params, unsigned int yBegin, unsigned int yEnd)
   {
     assert (params.getIntersection);
 
-    std::vector<float>& samples = params.grid.samples ();
+    const glm::vec3                                 dir (0.0f, 0.0f, 1.0f);
+    std::vector<SampleColumn>                       columns;
+    std::vector<PrimRay>                            rays;
+    std::vector<Intersection>                       intersections;
+    std::vector<IsosurfaceExtraction::Intersection> results;
 
-    for (unsigned int y = 0; y < params.grid.numSamples ().y; y++)
+    for (unsigned int y = yBegin; y < yEnd; y++)
     {
+      columns.clear ();
       for (unsigned int x = 0; x < params.grid.numSamples ().x; x++)
       {
-        if (params.grid.sampleIndex (x, y, 0) % numThreads == threadId)
+        const glm::vec3 origin = params.grid.samplePos (x, y, 0.0f) - (dir * Util::epsilon ());
+        columns.push_back (SampleColumn{x, 0, false, origin});
+      }
+
+      while (columns.empty () == false)
+      {
+        rays.clear ();
+        for (const SampleColumn& column : columns)
+        {
+          rays.emplace_back (column.origin, dir);
+        }
+        intersections.resize (columns.size ());
+        for (Intersection& intersection : intersections)
         {
-          const glm::vec3 dir (0.0f, 0.0f, 1.0f);
-          bool            inside = false;
-          unsigned int    z = 0;
-          Intersection    intersection;
-          PrimRay         ray (params.grid.samplePos (x, y, 0.0f) - (dir * Util::epsilon ()), dir);
+          intersection.reset ();
+        }
+        results.resize (columns.size ());
 
-          while (true)
-          {
-            intersection.reset ();
-            IsosurfaceExtraction::Intersection i = (*params.getIntersection) (ray, intersection);
+        (*params.getIntersection) (rays.data (), rays.size (), intersections.data (),
+                                   results.data ());
 
-            if (i == IsosurfaceExtraction::Intersection::None)
-            {
-              break;
-            }
-            else
+        unsigned int numActive = 0;
+        for (unsigned int i = 0; i < columns.size (); i++)
+        {
+          SampleColumn&                      column = columns[i];
+          const Intersection&                intersection = intersections[i];
+          IsosurfaceExtraction::Intersection result = results[i];
+
+          if (result == IsosurfaceExtraction::Intersection::None)
+          {
+            assert (column.z < params.grid.numSamples ().z - 1);
+            for (; column.z < params.grid.numSamples ().z; column.z++)
             {
-              const float d2 = intersection.distance () * intersection.distance ();
+              const unsigned int index = params.grid.sampleIndex (column.x, y, column.z);
 
-              while (glm::distance2 (params.grid.samplePos (x, y, z), ray.origin ()) < d2)
-              {
-                const unsigned int index = params.grid.sampleIndex (x, y, z);
+              assert (params.grid.sample (index) == Util::maxFloat ());
+              params.grid.sample (index, markOutside);
+            }
+          }
+          else
+          {
+            const float d2 = intersection.distance () * intersection.distance ();
 
-                assert (samples[index] == Util::maxFloat ());
-                samples[index] = inside ? markInside : markOutside;
+            while (glm::distance2 (params.grid.samplePos (column.x, y, column.z), column.origin) <
+                   d2)
+            {
+              const unsigned int index = params.grid.sampleIndex (column.x, y, column.z);
 
-                z++;
-              }
-              ray.origin (intersection.position () + (dir * Util::epsilon ()));
+              assert (params.grid.sample (index) == Util::maxFloat ());
+              params.grid.sample (index, column.inside ? markInside : markOutside);
 
-              if (i == IsosurfaceExtraction::Intersection::Sample)
-              {
-                inside = not inside;
-              }
+              column.z++;
             }
-          }
+            column.origin = intersection.position () + (dir * Util::epsilon ());
 
-          assert (z < params.grid.numSamples ().z - 1);
-          for (; z < params.grid.numSamples ().z; z++)
-          {
-            const unsigned int index = params.grid.sampleIndex (x, y, z);
-
-            assert (samples[index] == Util::maxFloat ());
-            samples[index] = markOutside;
+            if (result == IsosurfaceExtraction::Intersection::Sample)
+            {
+              column.inside = not column.inside;
+            }
+            columns[numActive++] = column;
           }
         }
+        columns.resize (numActive);
       }
     }
   }
 
-  void sampleIntersections (Parameters& params)
+  bool sampleIntersections (Parameters& params)
   {
-    const unsigned int       numThreads = std::thread::hardware_concurrency ();
-    std::vector<std::thread> threads;
+    PROFILE_ZONE ("isosurface/sample-intersections")
+    return ThreadPool::global ().parallelFor (params.grid.numSamples ().y, 1,
+                                              [&params](unsigned int yBegin, unsigned int yEnd) {
+                                                sampleIntersectionsRows (params, yBegin, yEnd);
+                                                params.finishTasks (yEnd - yBegin);
+                                              },
+                                              params.token);
+  }
 
-    for (unsigned int i = 0; i < numThreads; i++)
-    {
-      threads.emplace_back (sampleIntersectionsThread, std::ref (params), numThreads, i);
-    }
-    for (unsigned int i = 0; i < numThreads; i++)
+  /* Classifies the samples of a tile by the callback.  If the tile's center is farther away from
+   * the surface than any sample of the tile, all samples share the center's sign.  Boundary
+   * samples of the grid are outside.
+   */
+  void sampleInsideTile (Parameters& params, const InsideCallback& isInside,
+                         const glm::uvec3& tile)
+  {
+    const glm::uvec3& numSamples = params.grid.numSamples ();
+    const glm::uvec3  begin = tile * tileSize;
+    const glm::uvec3  end = glm::min (begin + glm::uvec3 (tileSize), numSamples);
+    const glm::vec3   minPos = params.grid.samplePos (begin.x, begin.y, begin.z);
+    const glm::vec3   maxPos = params.grid.samplePos (end.x - 1, end.y - 1, end.z - 1);
+    const glm::vec3   center = 0.5f * (minPos + maxPos);
+    const float       halfDiagonal = 0.5f * glm::distance (minPos, maxPos) + Util::epsilon ();
+    const bool        isFar = glm::abs (params.getDistance (center, halfDiagonal)) >= halfDiagonal;
+    const bool        isCenterInside = isFar && isInside (center);
+
+    for (unsigned int z = begin.z; z < end.z; z++)
     {
-      threads.at (i).join ();
+      for (unsigned int y = begin.y; y < end.y; y++)
+      {
+        for (unsigned int x = begin.x; x < end.x; x++)
+        {
+          const bool isBoundary = x == 0 || y == 0 || z == 0 || x == numSamples.x - 1 ||
+                                  y == numSamples.y - 1 || z == numSamples.z - 1;
+          bool inside = false;
+
+          if (isBoundary == false)
+          {
+            inside = isFar ? isCenterInside : isInside (params.grid.samplePos (x, y, z));
+          }
+          params.grid.sample (params.grid.sampleIndex (x, y, z),
+                              inside ? markInside : markOutside);
+        }
+      }
     }
   }
 
+  bool sampleInside (Parameters& params, const InsideCallback& isInside)
+  {
+    PROFILE_ZONE ("isosurface/sample-inside")
+    const glm::uvec3 numTiles = ::numTiles (params);
+
+    return ThreadPool::global ().parallelFor (
+      numTiles.x * numTiles.y * numTiles.z, 1,
+      [&params, &isInside, &numTiles](unsigned int t, unsigned int) {
+        const glm::uvec3 tile (t % numTiles.x, (t / numTiles.x) % numTiles.y,
+                               t / (numTiles.x * numTiles.y));
+        sampleInsideTile (params, isInside, tile);
+        params.finishTasks (1);
+      },
+      params.token);
+  }
+
   bool isIntersecting (float s1, float s2)
   {
     return (s1 < 0.0f && s2 >= 0.0f) || (s1 >= 0.0f && s2 < 0.0f);
@@ -187,7 +471,8 @@ namespace
 
   void markSamplePositions (Parameters& params)
   {
-    std::vector<float>& samples = params.grid.samples ();
+    PROFILE_ZONE ("isosurface/mark-sample-positions")
+    IsosurfaceExtractionGrid& grid = params.grid;
 
     for (unsigned int z = 0; z < params.grid.numCubes ().z; z++)
     {
@@ -204,10 +489,10 @@ namespace
             params.grid.sampleIndex (cubeIndex, 6), params.grid.sampleIndex (cubeIndex, 7)};
 
           const float cubeSamples[] = {
-            samples[cubeSampleIndices[0]], samples[cubeSampleIndices[1]],
-            samples[cubeSampleIndices[2]], samples[cubeSampleIndices[3]],
-            samples[cubeSampleIndices[4]], samples[cubeSampleIndices[5]],
-            samples[cubeSampleIndices[6]], samples[cubeSampleIndices[7]]};
+            grid.sample (cubeSampleIndices[0]), grid.sample (cubeSampleIndices[1]),
+            grid.sample (cubeSampleIndices[2]), grid.sample (cubeSampleIndices[3]),
+            grid.sample (cubeSampleIndices[4]), grid.sample (cubeSampleIndices[5]),
+            grid.sample (cubeSampleIndices[6]), grid.sample (cubeSampleIndices[7])};
 
           for (unsigned int edge = 0; edge < 12; edge++)
           {
@@ -220,11 +505,11 @@ namespace
               {
                 if (cubeSamples[i] == markInside)
                 {
-                  samples[cubeSampleIndices[i]] = markInsideToSample;
+                  grid.sample (cubeSampleIndices[i], markInsideToSample);
                 }
                 else if (cubeSamples[i] == markOutside)
                 {
-                  samples[cubeSampleIndices[i]] = markOutsideToSample;
+                  grid.sample (cubeSampleIndices[i], markOutsideToSample);
                 }
               }
               break;
@@ -234,33 +519,335 @@ namespace
       }
     }
   }
+
+  // samples the signs of all samples and the distances of the samples near the surface
+  bool sampleSigned (Parameters& params)
+  {
+    const glm::uvec3 numTiles = ::numTiles (params);
+
+    params.numTasks = params.grid.numSamples ().y + (numTiles.x * numTiles.y * numTiles.z);
+
+    if (sampleIntersections (params) == false)
+    {
+      return false;
+    }
+    markSamplePositions (params);
+
+    return params.isCancelled () == false && sampleDistances (params);
+  }
+
+  bool sampleSigned (Parameters& params, const InsideCallback& isInside)
+  {
+    const glm::uvec3 numTiles = ::numTiles (params);
+
+    params.numTasks = 2 * numTiles.x * numTiles.y * numTiles.z;
+
+    if (sampleInside (params, isInside) == false)
+    {
+      return false;
+    }
+    markSamplePositions (params);
+
+    return params.isCancelled () == false && sampleDistances (params);
+  }
+
+  // samples that are not adjacent to the surface are set to plus or minus the resolution
+  void resolveMarks (IsosurfaceExtractionGrid& grid)
+  {
+    for (unsigned int i = 0; i < grid.totalNumSamples (); i++)
+    {
+      const float sample = grid.sample (i);
+
+      if (sample == markInside)
+      {
+        grid.sample (i, -grid.resolution ());
+      }
+      else if (sample == markOutside)
+      {
+        grid.sample (i, grid.resolution ());
+      }
+    }
+  }
+}
+
+bool IsosurfaceExtraction::extract (const DistanceCallback& getDistance, const PrimAABox& bounds,
+                                    float resolution, DynamicMesh& mesh,
+                                    const ProgressCallback&  progress,
+                                    const CancellationToken* token)
+{
+  IsosurfaceExtractionGrid grid (bounds, resolution);
+  Parameters               params (getDistance, nullptr, progress, token, grid);
+
+  if (params.hasSamples ())
+  {
+    const glm::uvec3 numTiles = ::numTiles (params);
+
+    params.numTasks = numTiles.x * numTiles.y * numTiles.z;
+
+    if (sampleDistances (params) == false)
+    {
+      return false;
+    }
+    params.grid.makeMesh (mesh);
+  }
+  return true;
+}
+
+/* The half behind the plane is cut off a few samples behind the plane, such that the surface is
+ * closed and crosses the plane like the full surface.  Bounds are only clipped by planes that are
+ * orthogonal to an axis.
+ */
+bool IsosurfaceExtraction::extractSymmetric (const DistanceCallback& getDistance,
+                                             const PrimAABox& bounds, float resolution,
+                                             const PrimPlane& plane, DynamicMesh& mesh,
+                                             const ProgressCallback&  progress,
+                                             const CancellationToken* token)
+{
+  const float margin = 2.0f * resolution;
+
+  const DistanceCallback getHalfDistance = [&getDistance, &plane, margin](const glm::vec3& pos,
+                                                                          float upperBound) {
+    const float cut = -margin - plane.distance (pos);
+
+    return cut >= upperBound ? upperBound : glm::max (cut, getDistance (pos, upperBound));
+  };
+
+  glm::vec3 min = bounds.minimum ();
+  glm::vec3 max = bounds.maximum ();
+
+  for (unsigned int d = 0; d < 3; d++)
+  {
+    if (plane.normal ()[d] >= 1.0f - Util::epsilon ())
+    {
+      min[d] = glm::max (min[d], plane.point ()[d] - margin);
+    }
+    else if (plane.normal ()[d] <= -1.0f + Util::epsilon ())
+    {
+      max[d] = glm::min (max[d], plane.point ()[d] + margin);
+    }
+  }
+
+  if (glm::any (glm::greaterThan (min, max)))
+  {
+    mesh.reset ();
+    return true;
+  }
+  else if (IsosurfaceExtraction::extract (getHalfDistance, PrimAABox (min, max), resolution, mesh,
+                                          progress, token) == false)
+  {
+    return false;
+  }
+  else if (mesh.isEmpty () == false && mesh.mirror (plane) == false)
+  {
+    // falls back to the full surface if the half cannot be mirrored
+    return IsosurfaceExtraction::extract (getDistance, bounds, resolution, mesh, nullptr, token);
+  }
+  return true;
+}
+
+bool IsosurfaceExtraction::sample (const DistanceCallback& getDistance,
+                                   IsosurfaceExtractionGrid& grid, const PrimAABox& region,
+                                   const ProgressCallback& progress, const CancellationToken* token)
+{
+  Parameters params (getDistance, nullptr, progress, token, grid);
+
+  if (params.hasSamples ())
+  {
+    glm::uvec3 tileBegin, tileEnd;
+    tileRange (params, region, tileBegin, tileEnd);
+
+    params.numTasks = numTiles (tileBegin, tileEnd);
+
+    resetTiles (params, tileBegin, tileEnd);
+    return sampleDistances (params, tileBegin, tileEnd);
+  }
+  return true;
 }
 
-void IsosurfaceExtraction::extract (const DistanceCallback& getDistance, const PrimAABox& bounds,
-                                    float resolution, DynamicMesh& mesh)
+bool IsosurfaceExtraction::update (const DistanceCallback& getDistance,
+                                   IsosurfaceExtractionGrid& grid,
+                                   const std::vector<PrimAABox>& regions, DynamicMesh& mesh,
+                                   const ProgressCallback& progress, const CancellationToken* token)
 {
-  Parameters                params (getDistance, nullptr, bounds, resolution);
-  IsosurfaceExtractionGrid& grid = params.grid;
+  Parameters params (getDistance, nullptr, progress, token, grid);
 
-  if (grid.numSamples ().x > 0 && grid.numSamples ().y > 0 && grid.numSamples ().z > 0)
+  if (params.hasSamples ())
   {
-    sampleDistances (params);
-    grid.makeMesh (mesh);
+    std::vector<glm::uvec3> tileRanges;
+
+    for (const PrimAABox& region : regions)
+    {
+      glm::uvec3 tileBegin, tileEnd;
+      tileRange (params, region, tileBegin, tileEnd);
+
+      tileRanges.push_back (tileBegin);
+      tileRanges.push_back (tileEnd);
+      params.numTasks += numTiles (tileBegin, tileEnd);
+    }
+
+    for (std::size_t i = 0; i < tileRanges.size (); i += 2)
+    {
+      resetTiles (params, tileRanges[i], tileRanges[i + 1]);
+
+      if (sampleDistances (params, tileRanges[i], tileRanges[i + 1]) == false)
+      {
+        return false;
+      }
+    }
+
+    // the mesh is only modified once sampling can no longer be cancelled
+    for (std::size_t i = 0; i < tileRanges.size (); i += 2)
+    {
+      grid.updateMesh (tileRanges[i] * tileSize,
+                       glm::min (tileRanges[i + 1] * tileSize, grid.numSamples ()), mesh);
+    }
   }
+  return true;
 }
 
-void IsosurfaceExtraction::extract (const DistanceCallback&     getDistance,
+bool IsosurfaceExtraction::extract (const DistanceCallback&     getDistance,
                                     const IntersectionCallback& getIntersection,
-                                    const PrimAABox& bounds, float resolution, DynamicMesh& mesh)
+                                    const PrimAABox& bounds, float resolution, DynamicMesh& mesh,
+                                    const ProgressCallback&  progress,
+                                    const CancellationToken* token)
 {
-  Parameters                params (getDistance, &getIntersection, bounds, resolution);
-  IsosurfaceExtractionGrid& grid = params.grid;
+  const PacketIntersectionCallback getPacketIntersection =
+    [&getIntersection](const PrimRay* rays, unsigned int numRays, ::Intersection* intersections,
+                       Intersection* results) {
+      for (unsigned int i = 0; i < numRays; i++)
+      {
+        results[i] = getIntersection (rays[i], intersections[i]);
+      }
+    };
+  return IsosurfaceExtraction::extract (getDistance, getPacketIntersection, bounds, resolution,
+                                        mesh, progress, token);
+}
 
-  if (grid.numSamples ().x > 0 && grid.numSamples ().y > 0 && grid.numSamples ().z > 0)
+bool IsosurfaceExtraction::extract (const DistanceCallback&           getDistance,
+                                    const PacketIntersectionCallback& getIntersection,
+                                    const PrimAABox& bounds, float resolution, DynamicMesh& mesh,
+                                    const ProgressCallback&  progress,
+                                    const CancellationToken* token)
+{
+  IsosurfaceExtractionGrid grid (bounds, resolution);
+  Parameters               params (getDistance, &getIntersection, progress, token, grid);
+
+  if (params.hasSamples ())
   {
-    sampleIntersections (params);
-    markSamplePositions (params);
-    sampleDistances (params);
-    grid.makeMesh (mesh);
+    if (sampleSigned (params) == false)
+    {
+      return false;
+    }
+    params.grid.makeMesh (mesh);
+  }
+  return true;
+}
+
+bool IsosurfaceExtraction::sample (const DistanceCallback&           getDistance,
+                                   const PacketIntersectionCallback& getIntersection,
+                                   IsosurfaceExtractionGrid& grid, const ProgressCallback& progress,
+                                   const CancellationToken* token)
+{
+  Parameters params (getDistance, &getIntersection, progress, token, grid);
+
+  if (params.hasSamples ())
+  {
+    if (sampleSigned (params) == false)
+    {
+      return false;
+    }
+    resolveMarks (grid);
+  }
+  return true;
+}
+
+bool IsosurfaceExtraction::sample (const DistanceCallback& getDistance,
+                                   const InsideCallback& isInside, IsosurfaceExtractionGrid& grid,
+                                   const ProgressCallback&  progress,
+                                   const CancellationToken* token)
+{
+  Parameters params (getDistance, nullptr, progress, token, grid);
+
+  params.isClassified = true;
+
+  if (params.hasSamples ())
+  {
+    if (sampleSigned (params, isInside) == false)
+    {
+      return false;
+    }
+    resolveMarks (grid);
+  }
+  return true;
+}
+
+/* Each edge of the grid that crosses the surface yields a quad of two faces.  A surface of area
+ * `A` crosses about `1.5 A / r^2` edges of a grid with resolution `r`, which is the mean of
+ * `|n.x| + |n.y| + |n.z|` over all unit normals `n` divided by the area of a grid face.
+ */
+void IsosurfaceExtraction::brickRange (const IsosurfaceExtractionGrid& grid, unsigned int i,
+                                       unsigned int n, glm::uvec3& begin, glm::uvec3& end)
+{
+  assert (i < n);
+
+  const unsigned int numSlabs = (grid.numSamples ().z + tileSize - 1) / tileSize;
+  const unsigned int firstSlab = (unsigned int) ((std::uint64_t (numSlabs) * i) / n);
+  const unsigned int endSlab = (unsigned int) ((std::uint64_t (numSlabs) * (i + 1)) / n);
+
+  begin = glm::uvec3 (0, 0, glm::min (firstSlab * tileSize, grid.numSamples ().z));
+  end = glm::uvec3 (grid.numSamples ().x, grid.numSamples ().y,
+                    glm::min (endSlab * tileSize, grid.numSamples ().z));
+}
+
+bool IsosurfaceExtraction::sampleBrick (const DistanceCallback& getDistance,
+                                        IsosurfaceExtractionGrid& grid, unsigned int i,
+                                        unsigned int n, const ProgressCallback& progress,
+                                        const CancellationToken* token)
+{
+  Parameters params (getDistance, nullptr, progress, token, grid);
+
+  if (params.hasSamples ())
+  {
+    glm::uvec3 begin, end;
+    IsosurfaceExtraction::brickRange (grid, i, n, begin, end);
+
+    const glm::uvec3 tileBegin = begin / tileSize;
+    const glm::uvec3 tileEnd = (end + glm::uvec3 (tileSize - 1)) / tileSize;
+
+    params.numTasks = numTiles (tileBegin, tileEnd);
+
+    return sampleDistances (params, tileBegin, tileEnd);
+  }
+  return true;
+}
+
+bool IsosurfaceExtraction::resolutionForFaces (const Extraction& extract, const PrimAABox& bounds,
+                                               unsigned int numFaces, float& resolution)
+{
+  assert (numFaces > 0);
+
+  constexpr float facesPerArea = 3.0f;
+  constexpr float coarseSamples = 32.0f;
+
+  const glm::vec3 extent = bounds.maximum () - bounds.minimum ();
+  const float     maxExtent = glm::max (extent.x, glm::max (extent.y, extent.z));
+  const float     coarseResolution = maxExtent / coarseSamples;
+  DynamicMesh     mesh;
+
+  if (coarseResolution <= 0.0f || extract (coarseResolution, mesh) == false)
+  {
+    return false;
+  }
+
+  float area = 0.0f;
+  mesh.forEachFace ([&mesh, &area](unsigned int i) {
+    area += 0.5f * glm::length (mesh.face (i).cross ());
+  });
+
+  if (area <= 0.0f)
+  {
+    return false;
   }
+  resolution = glm::sqrt (facesPerArea * area / float(numFaces));
+  return true;
 }
@@ -7,10 +7,14 @@
 
 #include <functional>
 #include <glm/fwd.hpp>
+#include <vector>
 
+class CancellationToken;
 class DynamicMesh;
 class Intersection;
+class IsosurfaceExtractionGrid;
 class PrimAABox;
+class PrimPlane;
 class PrimRay;
 
 namespace IsosurfaceExtraction
@@ -22,12 +26,86 @@ namespace IsosurfaceExtraction
     Continue
   };
 
-  typedef std::function<float(const glm::vec3&)>                        DistanceCallback;
+  // distance callbacks may return the given upper bound if the actual distance is larger
+  typedef std::function<float(const glm::vec3&, float)>                 DistanceCallback;
+  typedef std::function<bool(const glm::vec3&)>                         InsideCallback;
   typedef std::function<Intersection (const PrimRay&, ::Intersection&)> IntersectionCallback;
+  typedef std::function<void(const PrimRay*, unsigned int, ::Intersection*, Intersection*)>
+    PacketIntersectionCallback;
 
-  void extract (const DistanceCallback&, const IntersectionCallback&, const PrimAABox&, float,
-                DynamicMesh&);
-  void extract (const DistanceCallback&, const PrimAABox&, float, DynamicMesh&);
+  // progress callbacks receive the finished fraction of sampling and may be called by any thread
+  typedef std::function<void(float)> ProgressCallback;
+
+  // extracts a surface at the given resolution
+  typedef std::function<bool(float, DynamicMesh&)> Extraction;
+
+  /* Callbacks are called by multiple threads.  Extractions return `false` without modifying the
+   * mesh if they have been cancelled.
+   */
+  bool extract (const DistanceCallback&, const IntersectionCallback&, const PrimAABox&, float,
+                DynamicMesh&, const ProgressCallback& = nullptr,
+                const CancellationToken* = nullptr);
+  bool extract (const DistanceCallback&, const PacketIntersectionCallback&, const PrimAABox&,
+                float, DynamicMesh&, const ProgressCallback& = nullptr,
+                const CancellationToken* = nullptr);
+  bool extract (const DistanceCallback&, const PrimAABox&, float, DynamicMesh&,
+                const ProgressCallback& = nullptr, const CancellationToken* = nullptr);
+
+  /* Extracts a surface that is symmetric to a plane by only sampling the half in front of the
+   * plane, which is mirrored by `DynamicMesh::mirror`.  The result is exactly symmetric and
+   * its vertices are paired with their reflections.
+   */
+  bool extractSymmetric (const DistanceCallback&, const PrimAABox&, float, const PrimPlane&,
+                         DynamicMesh&, const ProgressCallback& = nullptr,
+                         const CancellationToken* = nullptr);
+
+  /* Samples signed distances on a grid without extracting a mesh.  Distances are exact near the
+   * surface.  Samples that are not adjacent to the surface are set to plus or minus the
+   * resolution of the grid.
+   */
+  bool sample (const DistanceCallback&, const PacketIntersectionCallback&,
+               IsosurfaceExtractionGrid&, const ProgressCallback& = nullptr,
+               const CancellationToken* = nullptr);
+
+  /* Like the above, but classifies samples as inside or outside by a callback instead of casting
+   * rays along the columns of the grid.  Each sample is classified independently, and tiles that
+   * are far from the surface are classified by their centers.
+   */
+  bool sample (const DistanceCallback&, const InsideCallback&, IsosurfaceExtractionGrid&,
+               const ProgressCallback& = nullptr, const CancellationToken* = nullptr);
+
+  /* Samples the distances of the grid's tiles that intersect a region, such that a grid can be
+   * updated after the distances inside the region have changed.  Other samples are not modified.
+   * The samples of the region are undefined if the sampling has been cancelled.
+   */
+  bool sample (const DistanceCallback&, IsosurfaceExtractionGrid&, const PrimAABox&,
+               const ProgressCallback& = nullptr, const CancellationToken* = nullptr);
+
+  /* Samples the distances of the grid's tiles that intersect the given regions and updates the
+   * vertices and faces of a mesh around them (cf. `IsosurfaceExtractionGrid::updateMesh`).  Tiles
+   * are sampled in full, such that the mesh is stitched to unchanged samples.  The mesh is not
+   * modified if the update has been cancelled.
+   */
+  bool update (const DistanceCallback&, IsosurfaceExtractionGrid&, const std::vector<PrimAABox>&,
+               DynamicMesh&, const ProgressCallback& = nullptr,
+               const CancellationToken* = nullptr);
+
+  /* Bricks split the tiles of a grid into slabs along the z-axis, such that a surface can be
+   * sampled by several processes.  Tiles are sampled independently of each other, so bricks do not
+   * need to overlap: a grid whose bricks have been sampled separately and gathered (cf.
+   * `IsosurfaceExtractionGrid::readSamples`) makes the same mesh as `extract`.  Returns the
+   * sample range `[begin, end)` of brick `i` of `n`, which is empty if there are fewer slabs.
+   */
+  void brickRange (const IsosurfaceExtractionGrid&, unsigned int, unsigned int, glm::uvec3&,
+                   glm::uvec3&);
+  bool sampleBrick (const DistanceCallback&, IsosurfaceExtractionGrid&, unsigned int, unsigned int,
+                    const ProgressCallback& = nullptr, const CancellationToken* = nullptr);
+
+  /* Estimates the resolution at which a surface within the given bounds is extracted with about
+   * the given number of faces.  The area of the surface is measured on a quick extraction at a
+   * coarse resolution.  Returns `false` if the surface is empty at that resolution.
+   */
+  bool resolutionForFaces (const Extraction&, const PrimAABox&, unsigned int, float&);
 };
 
 #endif
@@ -2,11 +2,20 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <glm/gtx/norm.hpp>
+#include <istream>
+#include <ostream>
+#include <vector>
 #include "dynamic/mesh.hpp"
 #include "isosurface-extraction/grid.hpp"
 #include "mesh.hpp"
 #include "primitive/aabox.hpp"
+#include "profiler.hpp"
+#include "thread-pool.hpp"
 #include "util.hpp"
 
 /* vertex layout:          edge layout:          face layout:
@@ -25,7 +34,15 @@
  */
 namespace
 {
-  static const glm::vec3 invalidVec3 = glm::vec3 (Util::minFloat ());
+  typedef IsosurfaceExtractionGrid::SampleFormat SampleFormat;
+
+  std::atomic<SampleFormat> defaultFormat (SampleFormat::Float32);
+
+  // slices `z - 1`, `z` and `z + 1` of cubes are needed to make the vertices and faces of slice `z`
+  constexpr unsigned int numCubeSlices = 3;
+
+  // number of rows of cubes that are processed by a single thread at once
+  constexpr unsigned int rowsPerChunk = 4;
 
   static bool nonManifoldConfig[256] = {
     false, false, false, false, false, false, false, false, false, false, false, false, false,
@@ -325,18 +342,24 @@ namespace
     return (s1 < 0.0f && s2 >= 0.0f) || (s1 >= 0.0f && s2 < 0.0f);
   }
 
+  // number of steps of the quantized position of a cube's vertex along each axis
+  constexpr float vertexSteps = 65535.0f;
+
   struct Cube
   {
-    unsigned char               configuration;
-    glm::vec3                   vertex;
-    unsigned char               numVertexIndicesInMesh;
-    std::array<unsigned int, 3> vertexIndicesInMesh;
-    bool                        nonManifold;
+    std::array<unsigned int, 3>  vertexIndicesInMesh;
+    std::array<unsigned int, 6>  faceIndicesInMesh; // faces of the edges at the cube's first sample
+    std::array<std::uint16_t, 3> vertex; // position within the cube in steps of `vertexSteps`
+    unsigned char                configuration;
+    unsigned char                numVertexIndicesInMesh : 3;
+    unsigned char                numFaceIndicesInMesh : 3;
+    bool                         nonManifold : 1;
 
     Cube ()
-      : configuration (0)
-      , vertex (invalidVec3)
+      : vertex ({{0, 0, 0}})
+      , configuration (0)
       , numVertexIndicesInMesh (0)
+      , numFaceIndicesInMesh (0)
       , nonManifold (false)
     {
     }
@@ -387,23 +410,263 @@ namespace
       DILAY_IMPOSSIBLE
     }
   };
+
+  // width of the band around the surface (in samples), to which narrow formats clamp samples
+  constexpr float narrowBand = 2.0f;
+
+  constexpr unsigned char numExactValues = 5;
+
+  // index of a value that is stored exactly or `numExactValues`
+  unsigned char exactIndex (float value)
+  {
+    const float exactValues[numExactValues] = {
+      Util::maxFloat (), IsosurfaceExtractionGrid::markInside,
+      IsosurfaceExtractionGrid::markOutside, IsosurfaceExtractionGrid::markInsideToSample,
+      IsosurfaceExtractionGrid::markOutsideToSample};
+
+    for (unsigned char i = 0; i < numExactValues; i++)
+    {
+      if (value == exactValues[i])
+      {
+        return i;
+      }
+    }
+    return numExactValues;
+  }
+
+  float exactValue (unsigned char index)
+  {
+    switch (index)
+    {
+      case 0:
+        return Util::maxFloat ();
+      case 1:
+        return IsosurfaceExtractionGrid::markInside;
+      case 2:
+        return IsosurfaceExtractionGrid::markOutside;
+      case 3:
+        return IsosurfaceExtractionGrid::markInsideToSample;
+      case 4:
+        return IsosurfaceExtractionGrid::markOutsideToSample;
+      default:
+        DILAY_IMPOSSIBLE
+    }
+  }
+
+  /* Half-precision floats that keep the sign of their value: values that are too large are
+   * clamped to the largest half and negative values that are too small are rounded to the
+   * smallest negative half.  Exact values are encoded as NaNs.
+   */
+  std::uint16_t toHalf (float value)
+  {
+    const unsigned char index = exactIndex (value);
+
+    if (index < numExactValues)
+    {
+      return std::uint16_t (0x7c01 + index);
+    }
+
+    std::uint32_t bits;
+    std::memcpy (&bits, &value, sizeof (float));
+
+    const std::uint16_t sign = std::uint16_t ((bits >> 16) & 0x8000);
+    const std::uint32_t abs = bits & 0x7fffffff;
+
+    assert (Util::isNaN (value) == false);
+    if (abs >= 0x477ff000)
+    {
+      return std::uint16_t (sign | 0x7bff);
+    }
+    else if (abs < 0x38800000)
+    {
+      float absValue;
+      std::memcpy (&absValue, &abs, sizeof (float));
+
+      const std::uint16_t mantissa = std::uint16_t (std::lround (absValue * 16777216.0f));
+      return std::uint16_t (sign | (value < 0.0f && mantissa == 0 ? 1 : mantissa));
+    }
+    else
+    {
+      const std::uint32_t mantissa = abs & 0x7fffff;
+      const std::uint32_t remainder = mantissa & 0x1fff;
+      std::uint16_t       half = std::uint16_t ((((abs >> 23) - 112) << 10) | (mantissa >> 13));
+
+      if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+      {
+        half++;
+      }
+      return std::uint16_t (sign | half);
+    }
+  }
+
+  float fromHalf (std::uint16_t half)
+  {
+    const std::uint32_t sign = std::uint32_t (half & 0x8000) << 16;
+    const std::uint32_t exponent = (half >> 10) & 0x1f;
+    const std::uint32_t mantissa = half & 0x3ff;
+
+    if (exponent == 0x1f)
+    {
+      assert (mantissa > 0 && mantissa <= numExactValues);
+      return exactValue ((unsigned char) (mantissa - 1));
+    }
+    else if (exponent == 0)
+    {
+      const float value = std::ldexp (float(mantissa), -24);
+      return sign ? -value : value;
+    }
+    else
+    {
+      const std::uint32_t bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+      float               value;
+
+      std::memcpy (&value, &bits, sizeof (float));
+      return value;
+    }
+  }
+
+  /* Signed integers of `T` that map `[-band, band]` linearly.  The smallest codes are reserved for
+   * exact values.  Negative values that are rounded to zero are stored as the smallest negative
+   * code, such that signs are kept.
+   */
+  template <typename T> struct NarrowCode
+  {
+    static constexpr int minCode = -(1 << (8 * sizeof (T) - 1));
+    static constexpr int maxCode = -minCode - numExactValues;
+
+    static T encode (float value, float band)
+    {
+      const unsigned char index = exactIndex (value);
+
+      if (index < numExactValues)
+      {
+        return T (minCode + index);
+      }
+      else
+      {
+        const float scaled = glm::clamp (value / band, -1.0f, 1.0f) * float(maxCode);
+        const int   code = int(std::lround (scaled));
+
+        return T (value < 0.0f && code == 0 ? -1 : code);
+      }
+    }
+
+    static float decode (T code, float band)
+    {
+      if (code < -maxCode)
+      {
+        return exactValue ((unsigned char) (code - minCode));
+      }
+      else
+      {
+        return float(code) * band / float(maxCode);
+      }
+    }
+  };
+
+  // samples in one of the formats of `IsosurfaceExtractionGrid::SampleFormat`
+  class Samples
+  {
+  public:
+    Samples ()
+      : format (SampleFormat::Float32)
+      , band (0.0f)
+    {
+    }
+
+    Samples (SampleFormat f, unsigned int n, float b)
+      : format (f)
+      , band (b)
+    {
+      switch (this->format)
+      {
+        case SampleFormat::Float32:
+          this->floats.resize (n, Util::maxFloat ());
+          break;
+        case SampleFormat::Float16:
+          this->halves.resize (n, toHalf (Util::maxFloat ()));
+          break;
+        case SampleFormat::Narrow16:
+          this->halves.resize (n, std::uint16_t (NarrowCode<std::int16_t>::encode (
+                                    Util::maxFloat (), this->band)));
+          break;
+        case SampleFormat::Narrow8:
+          this->bytes.resize (n, NarrowCode<std::int8_t>::encode (Util::maxFloat (), this->band));
+          break;
+      }
+    }
+
+    SampleFormat sampleFormat () const { return this->format; }
+
+    float get (unsigned int i) const
+    {
+      switch (this->format)
+      {
+        case SampleFormat::Float32:
+          return this->floats[i];
+        case SampleFormat::Float16:
+          return fromHalf (this->halves[i]);
+        case SampleFormat::Narrow16:
+          return NarrowCode<std::int16_t>::decode (std::int16_t (this->halves[i]), this->band);
+        case SampleFormat::Narrow8:
+          return NarrowCode<std::int8_t>::decode (this->bytes[i], this->band);
+      }
+      DILAY_IMPOSSIBLE
+    }
+
+    void set (unsigned int i, float value)
+    {
+      switch (this->format)
+      {
+        case SampleFormat::Float32:
+          this->floats[i] = value;
+          break;
+        case SampleFormat::Float16:
+          this->halves[i] = toHalf (value);
+          break;
+        case SampleFormat::Narrow16:
+          this->halves[i] = std::uint16_t (NarrowCode<std::int16_t>::encode (value, this->band));
+          break;
+        case SampleFormat::Narrow8:
+          this->bytes[i] = NarrowCode<std::int8_t>::encode (value, this->band);
+          break;
+      }
+    }
+
+  private:
+    SampleFormat               format;
+    float                      band;
+    std::vector<float>         floats;
+    std::vector<std::uint16_t> halves;
+    std::vector<std::int8_t>   bytes;
+  };
 }
 
 const unsigned char IsosurfaceExtractionGrid::vertexIndicesByEdge[12][2] = {
   {0, 1}, {0, 2}, {0, 4}, {2, 3}, {1, 3}, {1, 5}, {4, 5}, {4, 6}, {2, 6}, {6, 7}, {5, 7}, {3, 7}};
 
+const float IsosurfaceExtractionGrid::markInside = -0.5f;
+const float IsosurfaceExtractionGrid::markOutside = 0.5f;
+const float IsosurfaceExtractionGrid::markInsideToSample = -0.6f;
+const float IsosurfaceExtractionGrid::markOutsideToSample = 0.6f;
+
 struct IsosurfaceExtractionGrid::Impl
 {
-  float              resolution;
-  glm::vec3          sampleMin;
-  glm::vec3          sampleMax;
-  glm::uvec3         numSamples;
-  std::vector<float> samples;
-  glm::uvec3         numCubes;
-  std::vector<Cube>  cubes;
+  float             resolution;
+  glm::vec3         sampleMin;
+  glm::vec3         sampleMax;
+  glm::uvec3        numSamples;
+  Samples           samples;
+  glm::uvec3        numCubes;
+  std::vector<Cube> cubes; // window of `numCubeSlices` slices of cubes along the z-axis
+  bool              hasAllCubes; // all cubes are kept once the mesh has been updated
+
+  // vertex indices of the faces of each row of the current slice
+  std::vector<std::vector<unsigned int>> rowFaces;
 
   Impl (const PrimAABox& bounds, float r)
     : resolution (r)
+    , hasAllCubes (false)
   {
     const glm::vec3 min = bounds.minimum () - glm::vec3 (Util::epsilon () + r);
     const glm::vec3 max = bounds.maximum () + glm::vec3 (Util::epsilon () + r);
@@ -412,14 +675,24 @@ struct IsosurfaceExtractionGrid::Impl
     this->numSamples = glm::vec3 (1.0f) + glm::ceil ((max - min) / glm::vec3 (r));
     this->numCubes = this->numSamples - glm::uvec3 (1);
 
-    const unsigned int totalNumSamples =
-      this->numSamples.x * this->numSamples.y * this->numSamples.z;
-    const unsigned int totalNumCubes = this->numCubes.x * this->numCubes.y * this->numCubes.z;
+    const unsigned int numCubesPerSlice = this->numCubes.x * this->numCubes.y;
 
-    this->samples.resize (totalNumSamples, Util::maxFloat ());
-    this->cubes.resize (totalNumCubes);
+    this->samples = Samples (defaultFormat, this->totalNumSamples (), narrowBand * r);
+    this->cubes.resize (numCubeSlices * numCubesPerSlice);
+    this->rowFaces.resize (this->numCubes.y);
   }
 
+  SampleFormat sampleFormat () const { return this->samples.sampleFormat (); }
+
+  unsigned int totalNumSamples () const
+  {
+    return this->numSamples.x * this->numSamples.y * this->numSamples.z;
+  }
+
+  float sample (unsigned int i) const { return this->samples.get (i); }
+
+  void sample (unsigned int i, float value) { this->samples.set (i, value); }
+
   glm::vec3 samplePos (unsigned int x, unsigned int y, unsigned int z) const
   {
     assert (x < (unsigned int) this->numSamples.x);
@@ -489,16 +762,76 @@ struct IsosurfaceExtractionGrid::Impl
     return (z * this->numCubes.x * this->numCubes.y) + (y * this->numCubes.x) + x;
   }
 
-  unsigned int cubeVertexIndex (unsigned int cubeIndex, unsigned char edge) const
+  Cube& cube (unsigned int x, unsigned int y, unsigned int z)
   {
-    return this->cubes[cubeIndex].vertexIndex (edge);
+    assert (x < this->numCubes.x);
+    assert (y < this->numCubes.y);
+    assert (z < this->numCubes.z);
+
+    if (this->hasAllCubes)
+    {
+      return this->cubes[this->cubeIndex (x, y, z)];
+    }
+    else
+    {
+      const unsigned int slice = z % numCubeSlices;
+      return this->cubes[(slice * this->numCubes.x * this->numCubes.y) +
+                         (y * this->numCubes.x) + x];
+    }
   }
 
-  void setCubeVertex (unsigned int cubeIndex)
+  // calls `f (x, y, z)` for each cube of `[begin, end)`
+  template <typename F>
+  void forEachCube (const glm::uvec3& begin, const glm::uvec3& end, const F& f)
   {
-    glm::vec3    vertex = glm::vec3 (0.0f);
-    unsigned int numCrossedEdges = 0;
-    Cube&        cube = this->cubes[cubeIndex];
+    for (unsigned int z = begin.z; z < end.z; z++)
+    {
+      for (unsigned int y = begin.y; y < end.y; y++)
+      {
+        for (unsigned int x = begin.x; x < end.x; x++)
+        {
+          f (x, y, z);
+        }
+      }
+    }
+  }
+
+  // same as `forEachCube` but rows of cubes are processed in parallel
+  template <typename F>
+  void forEachCubeInParallel (const glm::uvec3& begin, const glm::uvec3& end, const F& f)
+  {
+    const unsigned int numRows = end.y - begin.y;
+
+    ThreadPool::global ().parallelFor (
+      numRows * (end.z - begin.z), rowsPerChunk,
+      [&begin, &end, &f, numRows](unsigned int rowBegin, unsigned int rowEnd) {
+        for (unsigned int row = rowBegin; row < rowEnd; row++)
+        {
+          const unsigned int y = begin.y + (row % numRows);
+          const unsigned int z = begin.z + (row / numRows);
+
+          for (unsigned int x = begin.x; x < end.x; x++)
+          {
+            f (x, y, z);
+          }
+        }
+      });
+  }
+
+  unsigned int cubeVertexIndex (unsigned int x, unsigned int y, unsigned int z,
+                                unsigned char edge)
+  {
+    return this->cube (x, y, z).vertexIndex (edge);
+  }
+
+  void setCubeVertex (unsigned int x, unsigned int y, unsigned int z)
+  {
+    const unsigned int cubeIndex = this->cubeIndex (x, y, z);
+    glm::vec3          vertex = glm::vec3 (0.0f);
+    unsigned int       numCrossedEdges = 0;
+    Cube&              cube = this->cube (x, y, z);
+
+    cube = Cube ();
 
     const unsigned int indices[] = {
       this->sampleIndex (cubeIndex, 0), this->sampleIndex (cubeIndex, 1),
@@ -506,10 +839,10 @@ struct IsosurfaceExtractionGrid::Impl
       this->sampleIndex (cubeIndex, 4), this->sampleIndex (cubeIndex, 5),
       this->sampleIndex (cubeIndex, 6), this->sampleIndex (cubeIndex, 7)};
 
-    const float samples[] = {this->samples[indices[0]], this->samples[indices[1]],
-                             this->samples[indices[2]], this->samples[indices[3]],
-                             this->samples[indices[4]], this->samples[indices[5]],
-                             this->samples[indices[6]], this->samples[indices[7]]};
+    const float samples[] = {this->sample (indices[0]), this->sample (indices[1]),
+                             this->sample (indices[2]), this->sample (indices[3]),
+                             this->sample (indices[4]), this->sample (indices[5]),
+                             this->sample (indices[6]), this->sample (indices[7])};
 
     const glm::vec3 positions[] = {this->samplePos (indices[0]), this->samplePos (indices[1]),
                                    this->samplePos (indices[2]), this->samplePos (indices[3]),
@@ -568,7 +901,12 @@ struct IsosurfaceExtractionGrid::Impl
 
     if (numCrossedEdges > 0)
     {
-      cube.vertex = vertex / float(numCrossedEdges);
+      const glm::vec3 average = vertex / float(numCrossedEdges);
+      const glm::vec3 offset = (average - positions[0]) / this->resolution;
+      const glm::vec3 steps = glm::clamp (offset, glm::vec3 (0.0f), glm::vec3 (1.0f)) * vertexSteps;
+
+      cube.vertex = {{std::uint16_t (std::lround (steps.x)), std::uint16_t (std::lround (steps.y)),
+                      std::uint16_t (std::lround (steps.z))}};
     }
     else
     {
@@ -576,55 +914,52 @@ struct IsosurfaceExtractionGrid::Impl
     }
   }
 
-  void setCubeVertices ()
+  void setCubeVertices (unsigned int z)
   {
-    for (unsigned int z = 0; z < this->numCubes.z; z++)
-    {
-      for (unsigned int y = 0; y < this->numCubes.y; y++)
-      {
-        for (unsigned int x = 0; x < this->numCubes.x; x++)
-        {
-          this->setCubeVertex (this->cubeIndex (x, y, z));
-        }
-      }
-    }
+    ThreadPool::global ().parallelFor (this->numCubes.y, rowsPerChunk,
+                                       [this, z](unsigned int yBegin, unsigned int yEnd) {
+                                         for (unsigned int y = yBegin; y < yEnd; y++)
+                                         {
+                                           for (unsigned int x = 0; x < this->numCubes.x; x++)
+                                           {
+                                             this->setCubeVertex (x, y, z);
+                                           }
+                                         }
+                                       });
 
 #ifndef NDEBUG
-    for (unsigned int z = 0; z < this->numCubes.z; z++)
+    for (unsigned int y = 0; y < this->numCubes.y; y++)
     {
-      for (unsigned int y = 0; y < this->numCubes.y; y++)
+      for (unsigned int x = 0; x < this->numCubes.x; x++)
       {
-        for (unsigned int x = 0; x < this->numCubes.x; x++)
-        {
-          unsigned char config = this->cubes[this->cubeIndex (x, y, z)].configuration;
+        unsigned char config = this->cube (x, y, z).configuration;
 
-          if (x > 0)
-          {
-            unsigned char left = this->cubes[this->cubeIndex (x - 1, y, z)].configuration;
+        if (x > 0)
+        {
+          unsigned char left = this->cube (x - 1, y, z).configuration;
 
-            assert (((config & (1 << 0)) == 0) == ((left & (1 << 1)) == 0));
-            assert (((config & (1 << 2)) == 0) == ((left & (1 << 3)) == 0));
-            assert (((config & (1 << 4)) == 0) == ((left & (1 << 5)) == 0));
-            assert (((config & (1 << 6)) == 0) == ((left & (1 << 7)) == 0));
-          }
-          if (y > 0)
-          {
-            unsigned char below = this->cubes[this->cubeIndex (x, y - 1, z)].configuration;
+          assert (((config & (1 << 0)) == 0) == ((left & (1 << 1)) == 0));
+          assert (((config & (1 << 2)) == 0) == ((left & (1 << 3)) == 0));
+          assert (((config & (1 << 4)) == 0) == ((left & (1 << 5)) == 0));
+          assert (((config & (1 << 6)) == 0) == ((left & (1 << 7)) == 0));
+        }
+        if (y > 0)
+        {
+          unsigned char below = this->cube (x, y - 1, z).configuration;
 
-            assert (((config & (1 << 0)) == 0) == ((below & (1 << 2)) == 0));
-            assert (((config & (1 << 1)) == 0) == ((below & (1 << 3)) == 0));
-            assert (((config & (1 << 4)) == 0) == ((below & (1 << 6)) == 0));
-            assert (((config & (1 << 5)) == 0) == ((below & (1 << 7)) == 0));
-          }
-          if (z > 0)
-          {
-            unsigned char behind = this->cubes[this->cubeIndex (x, y, z - 1)].configuration;
+          assert (((config & (1 << 0)) == 0) == ((below & (1 << 2)) == 0));
+          assert (((config & (1 << 1)) == 0) == ((below & (1 << 3)) == 0));
+          assert (((config & (1 << 4)) == 0) == ((below & (1 << 6)) == 0));
+          assert (((config & (1 << 5)) == 0) == ((below & (1 << 7)) == 0));
+        }
+        if (z > 0)
+        {
+          unsigned char behind = this->cube (x, y, z - 1).configuration;
 
-            assert (((config & (1 << 0)) == 0) == ((behind & (1 << 4)) == 0));
-            assert (((config & (1 << 1)) == 0) == ((behind & (1 << 5)) == 0));
-            assert (((config & (1 << 2)) == 0) == ((behind & (1 << 6)) == 0));
-            assert (((config & (1 << 3)) == 0) == ((behind & (1 << 7)) == 0));
-          }
+          assert (((config & (1 << 0)) == 0) == ((behind & (1 << 4)) == 0));
+          assert (((config & (1 << 1)) == 0) == ((behind & (1 << 5)) == 0));
+          assert (((config & (1 << 2)) == 0) == ((behind & (1 << 6)) == 0));
+          assert (((config & (1 << 3)) == 0) == ((behind & (1 << 7)) == 0));
         }
       }
     }
@@ -638,9 +973,9 @@ struct IsosurfaceExtractionGrid::Impl
     assert (dim == -3 || dim == -2 || dim == -1 || dim == 1 || dim == 2 || dim == 3);
     unused (cube);
 
-    Cube& other = this->cubes[this->cubeIndex (dim == -1 ? x - 1 : (dim == 1 ? x + 1 : x),
-                                               dim == -2 ? y - 1 : (dim == 2 ? y + 1 : y),
-                                               dim == -3 ? z - 1 : (dim == 3 ? z + 1 : z))];
+    Cube& other = this->cube (dim == -1 ? x - 1 : (dim == 1 ? x + 1 : x),
+                              dim == -2 ? y - 1 : (dim == 2 ? y + 1 : y),
+                              dim == -3 ? z - 1 : (dim == 3 ? z + 1 : z));
     if (other.nonManifoldConfig ())
     {
       const unsigned char otherAmbiguousFace = other.getAmbiguousFaceOfNonManifoldConfig ();
@@ -662,7 +997,7 @@ struct IsosurfaceExtractionGrid::Impl
 
   void resolveNonManifold (unsigned int x, unsigned int y, unsigned int z)
   {
-    Cube& cube = this->cubes[this->cubeIndex (x, y, z)];
+    Cube& cube = this->cube (x, y, z);
 
     if (cube.nonManifoldConfig ())
     {
@@ -686,28 +1021,38 @@ struct IsosurfaceExtractionGrid::Impl
     }
   }
 
-  void resolveNonManifolds ()
+  void resolveNonManifolds (unsigned int z)
   {
-    for (unsigned int z = 0; z < this->numCubes.z; z++)
-    {
-      for (unsigned int y = 0; y < this->numCubes.y; y++)
-      {
-        for (unsigned int x = 0; x < this->numCubes.x; x++)
-        {
-          this->resolveNonManifold (x, y, z);
-        }
-      }
-    }
+    ThreadPool::global ().parallelFor (this->numCubes.y, rowsPerChunk,
+                                       [this, z](unsigned int yBegin, unsigned int yEnd) {
+                                         for (unsigned int y = yBegin; y < yEnd; y++)
+                                         {
+                                           for (unsigned int x = 0; x < this->numCubes.x; x++)
+                                           {
+                                             this->resolveNonManifold (x, y, z);
+                                           }
+                                         }
+                                       });
   }
 
-  void addCubeVerticesToMesh (Cube& cube, DynamicMesh& mesh)
+  glm::vec3 cubeVertex (const Cube& cube, unsigned int x, unsigned int y, unsigned int z) const
   {
+    const glm::vec3 offset (float(cube.vertex[0]), float(cube.vertex[1]), float(cube.vertex[2]));
+
+    return this->samplePos (x, y, z) + (offset * (this->resolution / vertexSteps));
+  }
+
+  void addCubeVerticesToMesh (unsigned int x, unsigned int y, unsigned int z, DynamicMesh& mesh)
+  {
+    Cube&           cube = this->cube (x, y, z);
+    const glm::vec3 vertex = this->cubeVertex (cube, x, y, z);
+
     cube.numVertexIndicesInMesh =
       cube.collapseNonManifoldConfig () ? 1 : numVertices (cube.configuration);
 
     for (unsigned char i = 0; i < cube.numVertexIndicesInMesh; i++)
     {
-      cube.vertexIndicesInMesh[i] = mesh.addVertex (cube.vertex, glm::vec3 (0.0f));
+      cube.vertexIndicesInMesh[i] = mesh.addVertex (vertex, glm::vec3 (0.0f));
     }
 #ifndef NDEBUG
     for (unsigned char i = cube.numVertexIndicesInMesh; i < cube.vertexIndicesInMesh.size (); i++)
@@ -717,30 +1062,28 @@ struct IsosurfaceExtractionGrid::Impl
 #endif
   }
 
-  void addQuadToMesh (DynamicMesh& mesh, unsigned int i, unsigned int iu, unsigned int iv,
-                      unsigned int iuv)
+  void addQuad (const DynamicMesh& mesh, std::vector<unsigned int>& faces, unsigned int i,
+                unsigned int iu, unsigned int iv, unsigned int iuv)
   {
     if (glm::distance2 (mesh.vertex (i), mesh.vertex (iuv)) <=
         glm::distance2 (mesh.vertex (iu), mesh.vertex (iv)))
     {
-      mesh.addFace (i, iu, iuv);
-      mesh.addFace (i, iuv, iv);
+      faces.insert (faces.end (), {i, iu, iuv, i, iuv, iv});
     }
     else
     {
-      mesh.addFace (iu, iuv, iv);
-      mesh.addFace (iu, iv, i);
+      faces.insert (faces.end (), {iu, iuv, iv, iu, iv, i});
     }
   }
 
-  void makeFaces (DynamicMesh& mesh, unsigned char edge, unsigned int x, unsigned int y,
-                  unsigned int z)
+  void makeFaces (const DynamicMesh& mesh, std::vector<unsigned int>& faces, unsigned char edge,
+                  unsigned int x, unsigned int y, unsigned int z)
   {
     assert (edge == 0 || edge == 1 || edge == 2);
 
-    const float s1 = this->samples[this->sampleIndex (x, y, z)];
-    const float s2 = this->samples[this->sampleIndex (edge == 0 ? x + 1 : x, edge == 1 ? y + 1 : y,
-                                                      edge == 2 ? z + 1 : z)];
+    const float s1 = this->sample (this->sampleIndex (x, y, z));
+    const float s2 = this->sample (this->sampleIndex (edge == 0 ? x + 1 : x, edge == 1 ? y + 1 : y,
+                                                      edge == 2 ? z + 1 : z));
 
     if (isIntersecting (s1, s2))
     {
@@ -748,24 +1091,24 @@ struct IsosurfaceExtractionGrid::Impl
 
       if (edge == 0)
       {
-        i = this->cubeVertexIndex (this->cubeIndex (x, y, z), 0);
-        iu = this->cubeVertexIndex (this->cubeIndex (x, y - 1, z), 3);
-        iuv = this->cubeVertexIndex (this->cubeIndex (x, y - 1, z - 1), 9);
-        iv = this->cubeVertexIndex (this->cubeIndex (x, y, z - 1), 6);
+        i = this->cubeVertexIndex (x, y, z, 0);
+        iu = this->cubeVertexIndex (x, y - 1, z, 3);
+        iuv = this->cubeVertexIndex (x, y - 1, z - 1, 9);
+        iv = this->cubeVertexIndex (x, y, z - 1, 6);
       }
       else if (edge == 1)
       {
-        i = this->cubeVertexIndex (this->cubeIndex (x, y, z), 1);
-        iu = this->cubeVertexIndex (this->cubeIndex (x, y, z - 1), 7);
-        iuv = this->cubeVertexIndex (this->cubeIndex (x - 1, y, z - 1), 10);
-        iv = this->cubeVertexIndex (this->cubeIndex (x - 1, y, z), 4);
+        i = this->cubeVertexIndex (x, y, z, 1);
+        iu = this->cubeVertexIndex (x, y, z - 1, 7);
+        iuv = this->cubeVertexIndex (x - 1, y, z - 1, 10);
+        iv = this->cubeVertexIndex (x - 1, y, z, 4);
       }
       else if (edge == 2)
       {
-        i = this->cubeVertexIndex (this->cubeIndex (x, y, z), 2);
-        iu = this->cubeVertexIndex (this->cubeIndex (x - 1, y, z), 5);
-        iuv = this->cubeVertexIndex (this->cubeIndex (x - 1, y - 1, z), 11);
-        iv = this->cubeVertexIndex (this->cubeIndex (x, y - 1, z), 8);
+        i = this->cubeVertexIndex (x, y, z, 2);
+        iu = this->cubeVertexIndex (x - 1, y, z, 5);
+        iuv = this->cubeVertexIndex (x - 1, y - 1, z, 11);
+        iv = this->cubeVertexIndex (x, y - 1, z, 8);
       }
       else
       {
@@ -777,74 +1120,260 @@ struct IsosurfaceExtractionGrid::Impl
         std::swap (iu, iv);
       }
 
-      this->addQuadToMesh (mesh, i, iu, iv, iuv);
+      this->addQuad (mesh, faces, i, iu, iv, iuv);
     }
   }
 
-  void makeFaces (DynamicMesh& mesh, unsigned int x, unsigned int y, unsigned int z)
+  void makeFaces (const DynamicMesh& mesh, std::vector<unsigned int>& faces, unsigned int x,
+                  unsigned int y, unsigned int z)
   {
     if (y > 0 && z > 0)
     {
-      this->makeFaces (mesh, 0, x, y, z);
+      this->makeFaces (mesh, faces, 0, x, y, z);
     }
     if (x > 0 && z > 0)
     {
-      this->makeFaces (mesh, 1, x, y, z);
+      this->makeFaces (mesh, faces, 1, x, y, z);
     }
     if (x > 0 && y > 0)
     {
-      this->makeFaces (mesh, 2, x, y, z);
+      this->makeFaces (mesh, faces, 2, x, y, z);
     }
   }
 
-  void makeMesh (DynamicMesh& mesh)
+  // faces are collected per row in parallel and added to the mesh in the order of the rows
+  void makeFaces (DynamicMesh& mesh, unsigned int z)
   {
-    this->setCubeVertices ();
-    this->resolveNonManifolds ();
-
-    mesh.reset ();
-    for (Cube& cube : this->cubes)
+    ThreadPool::global ().parallelFor (this->numCubes.y, rowsPerChunk,
+                                       [this, &mesh, z](unsigned int yBegin, unsigned int yEnd) {
+                                         for (unsigned int y = yBegin; y < yEnd; y++)
+                                         {
+                                           std::vector<unsigned int>& faces = this->rowFaces[y];
+
+                                           faces.clear ();
+                                           for (unsigned int x = 0; x < this->numCubes.x; x++)
+                                           {
+                                             this->makeFaces (mesh, faces, x, y, z);
+                                           }
+                                         }
+                                       });
+
+    for (const std::vector<unsigned int>& faces : this->rowFaces)
     {
-      this->addCubeVerticesToMesh (cube, mesh);
+      for (std::size_t i = 0; i < faces.size (); i += 3)
+      {
+        mesh.addFace (faces[i + 0], faces[i + 1], faces[i + 2]);
+      }
     }
+  }
+
+  // slices are processed one after another: the vertices of a slice depend on the cubes of the
+  // adjacent slices and its faces on the vertices of the previous slice
+  void makeMesh (DynamicMesh& mesh)
+  {
+    PROFILE_ZONE ("isosurface/make-mesh")
+    this->hasAllCubes = false;
+    this->cubes.resize (numCubeSlices * this->numCubes.x * this->numCubes.y);
+    mesh.reset ();
+    this->setCubeVertices (0);
 
     for (unsigned int z = 0; z < this->numCubes.z; z++)
     {
+      if (z + 1 < this->numCubes.z)
+      {
+        this->setCubeVertices (z + 1);
+      }
+      this->resolveNonManifolds (z);
+
       for (unsigned int y = 0; y < this->numCubes.y; y++)
       {
         for (unsigned int x = 0; x < this->numCubes.x; x++)
         {
-          this->makeFaces (mesh, x, y, z);
+          this->addCubeVerticesToMesh (x, y, z, mesh);
         }
       }
+      this->makeFaces (mesh, z);
     }
     mesh.setAllNormals ();
+    mesh.optimizeLayout ();
 
-#ifndef NDEBUG
-    std::vector<unsigned int> vertexIndexMap, faceIndexMap;
-    assert (mesh.numFaces () == 0 || mesh.pruneAndCheckConsistency (&vertexIndexMap, nullptr));
+    assert (mesh.numFaces () == 0 || mesh.pruneAndCheckConsistency ());
+  }
+
+  void sampleRange (const PrimAABox& box, glm::uvec3& begin, glm::uvec3& end) const
+  {
+    const glm::vec3 maxSample = glm::vec3 (this->numSamples - glm::uvec3 (1));
+    const glm::vec3 first = glm::floor ((box.minimum () - this->sampleMin) / this->resolution);
+    const glm::vec3 last = glm::ceil ((box.maximum () - this->sampleMin) / this->resolution);
 
-    for (Cube& c : this->cubes)
+    begin = glm::uvec3 (glm::clamp (first - 1.0f, glm::vec3 (0.0f), maxSample));
+    end = glm::uvec3 (glm::clamp (last + 1.0f, glm::vec3 (0.0f), maxSample)) + glm::uvec3 (1);
+  }
+
+  /* Vertices belong to their cubes and faces to the cubes of the first samples of their edges.
+   * The cubes of changed samples and their neighbours, whose resolution of non-manifold
+   * configurations depends on them, are made again.  The faces that share a vertex with them are
+   * owned by these cubes and by the cubes after them, which therefore make their faces again.
+   */
+  void updateMesh (const glm::uvec3& sampleBegin, const glm::uvec3& sampleEnd, DynamicMesh& mesh)
+  {
+    PROFILE_ZONE ("isosurface/update-mesh")
+    glm::uvec3 begin, end;
+
+    if (this->hasAllCubes)
     {
-      if (vertexIndexMap.empty () == false)
+      begin = glm::uvec3 (glm::max (glm::ivec3 (sampleBegin) - glm::ivec3 (2), glm::ivec3 (0)));
+      end = glm::min (sampleEnd + glm::uvec3 (1), this->numCubes);
+    }
+    else
+    {
+      this->cubes.assign (this->numCubes.x * this->numCubes.y * this->numCubes.z, Cube ());
+      this->hasAllCubes = true;
+      mesh.reset ();
+
+      begin = glm::uvec3 (0);
+      end = this->numCubes;
+    }
+
+    if (glm::any (glm::greaterThanEqual (begin, end)))
+    {
+      return;
+    }
+    const glm::uvec3 facesEnd = glm::min (end + glm::uvec3 (1), this->numCubes);
+    const glm::uvec3 normalsBegin =
+      glm::uvec3 (glm::max (glm::ivec3 (begin) - glm::ivec3 (1), glm::ivec3 (0)));
+
+    std::vector<unsigned int> vertices;
+    this->forEachCube (begin, facesEnd, [this, &mesh](unsigned int x, unsigned int y,
+                                                      unsigned int z) {
+      Cube& cube = this->cube (x, y, z);
+      for (unsigned char i = 0; i < cube.numFaceIndicesInMesh; i++)
       {
-        for (unsigned char i = 0; i < c.numVertexIndicesInMesh; i++)
+        mesh.deleteFace (cube.faceIndicesInMesh[i]);
+      }
+      cube.numFaceIndicesInMesh = 0;
+    });
+    this->forEachCube (begin, end, [this, &vertices](unsigned int x, unsigned int y,
+                                                     unsigned int z) {
+      const Cube& cube = this->cube (x, y, z);
+      vertices.insert (vertices.end (), cube.vertexIndicesInMesh.begin (),
+                       cube.vertexIndicesInMesh.begin () + cube.numVertexIndicesInMesh);
+    });
+    mesh.deleteVertices (vertices);
+
+    this->forEachCubeInParallel (begin, end,
+                                 [this](unsigned int x, unsigned int y, unsigned int z) {
+                                   this->setCubeVertex (x, y, z);
+                                 });
+    this->forEachCubeInParallel (begin, end,
+                                 [this](unsigned int x, unsigned int y, unsigned int z) {
+                                   this->resolveNonManifold (x, y, z);
+                                 });
+    this->forEachCube (begin, end, [this, &mesh](unsigned int x, unsigned int y, unsigned int z) {
+      this->addCubeVerticesToMesh (x, y, z, mesh);
+    });
+
+    std::vector<unsigned int> faces;
+    this->forEachCube (begin, facesEnd, [this, &mesh, &faces](unsigned int x, unsigned int y,
+                                                              unsigned int z) {
+      Cube& cube = this->cube (x, y, z);
+
+      faces.clear ();
+      this->makeFaces (mesh, faces, x, y, z);
+
+      assert (faces.size () <= 3 * cube.faceIndicesInMesh.size ());
+      for (std::size_t i = 0; i < faces.size (); i += 3)
+      {
+        cube.faceIndicesInMesh[cube.numFaceIndicesInMesh++] =
+          mesh.addFace (faces[i + 0], faces[i + 1], faces[i + 2]);
+      }
+    });
+    this->forEachCube (normalsBegin, facesEnd, [this, &mesh](unsigned int x, unsigned int y,
+                                                             unsigned int z) {
+      const Cube& cube = this->cube (x, y, z);
+      for (unsigned char i = 0; i < cube.numVertexIndicesInMesh; i++)
+      {
+        mesh.setVertexNormal (cube.vertexIndicesInMesh[i]);
+      }
+    });
+  }
+
+  void writeSamples (std::ostream& stream, const glm::uvec3& begin, const glm::uvec3& end) const
+  {
+    assert (glm::all (glm::lessThanEqual (begin, end)));
+    assert (glm::all (glm::lessThanEqual (end, this->numSamples)));
+
+    const std::uint32_t   header[] = {this->numSamples.x, this->numSamples.y, this->numSamples.z,
+                                      begin.x,            begin.y,            begin.z,
+                                      end.x,              end.y,              end.z};
+    std::vector<float>    row (end.x - begin.x);
+    const std::streamsize rowSize = std::streamsize (row.size () * sizeof (float));
+
+    stream.write (reinterpret_cast<const char*> (header), std::streamsize (sizeof (header)));
+    stream.write (reinterpret_cast<const char*> (&this->resolution), sizeof (float));
+
+    for (unsigned int z = begin.z; z < end.z; z++)
+    {
+      for (unsigned int y = begin.y; y < end.y; y++)
+      {
+        for (unsigned int x = begin.x; x < end.x; x++)
         {
-          c.vertexIndicesInMesh[i] = vertexIndexMap[c.vertexIndicesInMesh[i]];
-          assert (c.vertexIndicesInMesh[i] != Util::invalidIndex ());
+          row[x - begin.x] = this->sample (this->sampleIndex (x, y, z));
         }
+        stream.write (reinterpret_cast<const char*> (row.data ()), rowSize);
       }
     }
-#endif
-    mesh.bufferData ();
+  }
+
+  bool readSamples (std::istream& stream, const glm::uvec3& begin, const glm::uvec3& end)
+  {
+    const std::uint32_t   expected[] = {this->numSamples.x, this->numSamples.y, this->numSamples.z,
+                                        begin.x,            begin.y,            begin.z,
+                                        end.x,              end.y,              end.z};
+    std::uint32_t         header[9];
+    float                 resolution;
+    std::vector<float>    row (end.x - begin.x);
+    const std::streamsize rowSize = std::streamsize (row.size () * sizeof (float));
+
+    if (stream.read (reinterpret_cast<char*> (header), sizeof (header)).fail () ||
+        stream.read (reinterpret_cast<char*> (&resolution), sizeof (float)).fail () ||
+        std::memcmp (header, expected, sizeof (header)) != 0 || resolution != this->resolution)
+    {
+      return false;
+    }
+    for (unsigned int z = begin.z; z < end.z; z++)
+    {
+      for (unsigned int y = begin.y; y < end.y; y++)
+      {
+        if (stream.read (reinterpret_cast<char*> (row.data ()), rowSize).fail ())
+        {
+          return false;
+        }
+        for (unsigned int x = begin.x; x < end.x; x++)
+        {
+          this->sample (this->sampleIndex (x, y, z), row[x - begin.x]);
+        }
+      }
+    }
+    return true;
   }
 };
 
+IsosurfaceExtractionGrid::SampleFormat IsosurfaceExtractionGrid::defaultSampleFormat ()
+{
+  return defaultFormat;
+}
+
+void IsosurfaceExtractionGrid::defaultSampleFormat (SampleFormat format) { defaultFormat = format; }
+
 DELEGATE2_BIG4_COPY (IsosurfaceExtractionGrid, const PrimAABox&, float)
 GETTER_CONST (float, IsosurfaceExtractionGrid, resolution)
+DELEGATE_CONST (IsosurfaceExtractionGrid::SampleFormat, IsosurfaceExtractionGrid, sampleFormat)
 GETTER_CONST (const glm::uvec3&, IsosurfaceExtractionGrid, numSamples)
 GETTER_CONST (const glm::uvec3&, IsosurfaceExtractionGrid, numCubes)
-GETTER (std::vector<float>&, IsosurfaceExtractionGrid, samples)
+DELEGATE_CONST (unsigned int, IsosurfaceExtractionGrid, totalNumSamples)
+DELEGATE1_CONST (float, IsosurfaceExtractionGrid, sample, unsigned int)
+DELEGATE2 (void, IsosurfaceExtractionGrid, sample, unsigned int, float)
 DELEGATE3_CONST (glm::vec3, IsosurfaceExtractionGrid, samplePos, unsigned int, unsigned int,
                  unsigned int)
 DELEGATE1_CONST (glm::vec3, IsosurfaceExtractionGrid, samplePos, unsigned int)
@@ -854,3 +1383,11 @@ DELEGATE2_CONST (unsigned int, IsosurfaceExtractionGrid, sampleIndex, unsigned i
 DELEGATE3_CONST (unsigned int, IsosurfaceExtractionGrid, cubeIndex, unsigned int, unsigned int,
                  unsigned int)
 DELEGATE1 (void, IsosurfaceExtractionGrid, makeMesh, DynamicMesh&)
+DELEGATE3_CONST (void, IsosurfaceExtractionGrid, sampleRange, const PrimAABox&, glm::uvec3&,
+                 glm::uvec3&)
+DELEGATE3 (void, IsosurfaceExtractionGrid, updateMesh, const glm::uvec3&, const glm::uvec3&,
+           DynamicMesh&)
+DELEGATE3_CONST (void, IsosurfaceExtractionGrid, writeSamples, std::ostream&, const glm::uvec3&,
+                 const glm::uvec3&)
+DELEGATE3 (bool, IsosurfaceExtractionGrid, readSamples, std::istream&, const glm::uvec3&,
+           const glm::uvec3&)
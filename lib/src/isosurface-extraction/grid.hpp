@@ -6,7 +6,7 @@
 #define DILAY_ISOSURFACE_EXTRACTION_GRID
 
 #include <glm/glm.hpp>
-#include <vector>
+#include <iosfwd>
 #include "macro.hpp"
 
 class DynamicMesh;
@@ -15,14 +15,41 @@ class PrimAABox;
 class IsosurfaceExtractionGrid
 {
 public:
+  /* Formats of samples: `Float16` rounds samples to half precision.  Narrow formats store samples
+   * with 16 or 8 bits and clamp them to a narrow band around the surface, which keeps the signs of
+   * all samples and the distances that place vertices.
+   */
+  enum class SampleFormat
+  {
+    Float32,
+    Float16,
+    Narrow16,
+    Narrow8
+  };
+
   static const unsigned char vertexIndicesByEdge[12][2];
 
+  // marks of samples, which all formats store exactly, as well as `Util::maxFloat ()`
+  static const float markInside;
+  static const float markOutside;
+  static const float markInsideToSample;
+  static const float markOutsideToSample;
+
+  // format of subsequently constructed grids, which is `Float32` by default
+  static SampleFormat defaultSampleFormat ();
+  static void         defaultSampleFormat (SampleFormat);
+
   DECLARE_BIG4_EXPLICIT_COPY (IsosurfaceExtractionGrid, const PrimAABox&, float)
 
-  float               resolution () const;
-  const glm::uvec3&   numSamples () const;
-  const glm::uvec3&   numCubes () const;
-  std::vector<float>& samples ();
+  float             resolution () const;
+  SampleFormat      sampleFormat () const;
+  const glm::uvec3& numSamples () const;
+  const glm::uvec3& numCubes () const;
+  unsigned int      totalNumSamples () const;
+
+  // samples are stored in the grid's format and read back as float
+  float sample (unsigned int) const;
+  void  sample (unsigned int, float);
 
   glm::vec3    samplePos (unsigned int, unsigned int, unsigned int) const;
   glm::vec3    samplePos (unsigned int) const;
@@ -32,6 +59,23 @@ public:
 
   void makeMesh (DynamicMesh&);
 
+  // range `[begin, end)` of the samples within a box and of their adjacent samples
+  void sampleRange (const PrimAABox&, glm::uvec3&, glm::uvec3&) const;
+
+  /* Updates a mesh, which has been made by the last update of the grid, after the samples of
+   * `[begin, end)` have changed.  Only the vertices and faces around these samples are made
+   * again.  The first update makes the whole mesh.  The mesh must not be pruned between updates,
+   * since pruning changes the indices of its vertices and faces.
+   */
+  void updateMesh (const glm::uvec3&, const glm::uvec3&, DynamicMesh&);
+
+  /* Writes the samples of `[begin, end)` in the byte order of the host, preceded by the
+   * dimensions of the grid and by the range.  Reading them into another grid fails unless its
+   * dimensions and the range match.
+   */
+  void writeSamples (std::ostream&, const glm::uvec3&, const glm::uvec3&) const;
+  bool readSamples (std::istream&, const glm::uvec3&, const glm::uvec3&);
+
 private:
   IMPLEMENTATION
 };
@@ -5,111 +5,203 @@
 #include <QDomNode>
 #include <QFile>
 #include <QTextStream>
+#include <algorithm>
+#include <deque>
 #include <glm/glm.hpp>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 #include "color.hpp"
 #include "kvstore.hpp"
 #include "util.hpp"
 #include "variant.hpp"
 #include "xml-conversion.hpp"
 
+namespace
+{
+  std::string fullPath (const std::string& root, const std::string& suffix)
+  {
+    assert (suffix.back () != '/');
+
+    if (suffix.front () == '/')
+    {
+      assert (suffix.find ("/" + root + "/") == 0);
+      return suffix;
+    }
+    else
+    {
+      return "/" + root + "/" + suffix;
+    }
+  }
+
+  // paths are registered by any thread and are never unregistered
+  struct Registry
+  {
+    std::mutex                                    mutex;
+    std::unordered_map<std::string, KVStore::Key> keys;
+    std::deque<std::string>                       paths;
+  };
+
+  Registry& registry ()
+  {
+    static Registry r;
+    return r;
+  }
+
+  KVStore::Key registerPath (const std::string& path)
+  {
+    Registry&                   r = registry ();
+    std::lock_guard<std::mutex> lock (r.mutex);
+
+    const auto result = r.keys.emplace (path, KVStore::Key (r.paths.size ()));
+    if (result.second)
+    {
+      r.paths.push_back (path);
+    }
+    return result.first->second;
+  }
+
+  std::string registeredPath (KVStore::Key key)
+  {
+    Registry&                   r = registry ();
+    std::lock_guard<std::mutex> lock (r.mutex);
+
+    assert (key < r.paths.size ());
+    return r.paths[key];
+  }
+}
+
 struct KVStore::Impl
 {
   typedef Variant<float, int, bool, glm::vec3, glm::ivec2, Color> Value;
-  typedef std::unordered_map<std::string, Value>                  Map;
+  typedef std::pair<unsigned int, Subscriber>                     IdentifiedSubscriber;
 
-  const std::string root;
-  Map               map;
+  const std::string                 root;
+  std::deque<Value>                 values;
+  std::vector<IdentifiedSubscriber> subscribers;
+  unsigned int                      nextSubscriberId;
 
   Impl (const std::string& r)
     : root (r)
+    , nextSubscriberId (0)
   {
     assert (this->root.find ('/') == std::string::npos);
   }
 
-  std::string path (const std::string& suffix) const
+  static Key key (const std::string& r, const std::string& p)
   {
-    assert (suffix.back () != '/');
+    return registerPath (fullPath (r, p));
+  }
 
-    if (suffix.front () == '/')
+  Key key (const std::string& p) const { return Impl::key (this->root, p); }
+
+  const Value* find (Key k) const
+  {
+    return k < this->values.size () && this->values[k].isSet () ? &this->values[k] : nullptr;
+  }
+
+  template <class T> const T& get (Key k) const
+  {
+    const Value* value = this->find (k);
+
+    if (value == nullptr)
     {
-      assert (suffix.find ("/" + this->root + "/") == 0);
-      return suffix;
+      throw (std::runtime_error ("Can not find path '" + registeredPath (k) + "' in kv-store"));
     }
     else
     {
-      return "/" + this->root + "/" + suffix;
+      return value->get<T> ();
     }
   }
 
   template <class T> const T& get (const std::string& p) const
   {
-    Map::const_iterator value = this->map.find (this->path (p));
+    return this->get<T> (this->key (p));
+  }
 
-    if (value == this->map.end ())
-    {
-      throw (std::runtime_error ("Can not find path '" + this->path (p) + "' in kv-store"));
-    }
-    else
-    {
-      return value->second.get<T> ();
-    }
+  template <class T> const T& get (Key k, const T& defaultV) const
+  {
+    const Value* value = this->find (k);
+
+    return value == nullptr ? defaultV : value->get<T> ();
   }
 
   template <class T> const T& get (const std::string& p, const T& defaultV) const
   {
-    Map::const_iterator value = this->map.find (this->path (p));
+    return this->get<T> (this->key (p), defaultV);
+  }
 
-    if (value == this->map.end ())
+  // growing the table at its end keeps references to values valid
+  template <class T> void set (Key k, const T& t)
+  {
+    if (k >= this->values.size ())
     {
-      return defaultV;
+      this->values.resize (k + 1);
     }
-    else
+    this->values[k].set<T> (t);
+    this->notify (k);
+  }
+
+  template <class T> void set (const std::string& p, const T& t)
+  {
+    this->set<T> (this->key (p), t);
+  }
+
+  void notify (Key k) const
+  {
+    for (const IdentifiedSubscriber& s : this->subscribers)
     {
-      return value->second.get<T> ();
+      s.second (k);
     }
   }
 
-  template <class T> void set (const std::string& p, const T& t)
+  unsigned int subscribe (const Subscriber& subscriber)
   {
-    this->remove (p);
+    this->subscribers.emplace_back (this->nextSubscriberId, subscriber);
+    return this->nextSubscriberId++;
+  }
 
-    Value value;
-    value.set<T> (t);
-    this->map.emplace (this->path (p), value);
+  void unsubscribe (unsigned int id)
+  {
+    this->subscribers.erase (std::remove_if (this->subscribers.begin (), this->subscribers.end (),
+                                             [id](const IdentifiedSubscriber& s) {
+                                               return s.first == id;
+                                             }),
+                             this->subscribers.end ());
   }
 
+  /* Values are parsed by locale-independent conversions of `QString`, so the global locale is
+   * not changed and files may be loaded while another thread initializes the application.
+   */
   void fromFile (const std::string& fileName)
   {
-    Util::withCLocale<void> ([this, &fileName]() {
-      QFile file (fileName.c_str ());
+    QFile file (fileName.c_str ());
 
-      if (file.open (QIODevice::ReadOnly | QIODevice::Text) == false)
-      {
-        throw (std::runtime_error ("Can not open kv-store file '" + fileName + "'"));
-      }
-      QDomDocument doc (fileName.c_str ());
-      QString      errorMsg;
-      int          errorLine = -1;
-      int          errorColumn = -1;
-      if (doc.setContent (&file, &errorMsg, &errorLine, &errorColumn) == false)
-      {
-        file.close ();
-        throw (std::runtime_error (
-          "Error while loading kv-store file '" + fileName + "': " + errorMsg.toStdString () +
-          " (" + std::to_string (errorLine) + "," + std::to_string (errorColumn) + ")"));
-      }
+    if (file.open (QIODevice::ReadOnly | QIODevice::Text) == false)
+    {
+      throw (std::runtime_error ("Can not open kv-store file '" + fileName + "'"));
+    }
+    QDomDocument doc (fileName.c_str ());
+    QString      errorMsg;
+    int          errorLine = -1;
+    int          errorColumn = -1;
+    if (doc.setContent (&file, &errorMsg, &errorLine, &errorColumn) == false)
+    {
       file.close ();
-      try
-      {
-        this->loadNode ("", doc);
-      }
-      catch (std::runtime_error& e)
-      {
-        throw (std::runtime_error ("Error while parsing kv-store file '" + fileName +
-                                   "': " + e.what ()));
-      }
-    });
+      throw (std::runtime_error (
+        "Error while loading kv-store file '" + fileName + "': " + errorMsg.toStdString () +
+        " (" + std::to_string (errorLine) + "," + std::to_string (errorColumn) + ")"));
+    }
+    file.close ();
+    try
+    {
+      this->loadNode ("", doc);
+    }
+    catch (std::runtime_error& e)
+    {
+      throw (std::runtime_error ("Error while parsing kv-store file '" + fileName +
+                                 "': " + e.what ()));
+    }
   }
 
   void loadNode (const QString& prefix, QDomNode& node)
@@ -193,13 +285,15 @@ struct KVStore::Impl
     Util::withCLocale<void> ([this, &fileName]() {
       QDomDocument doc;
 
-      for (auto& c : this->map)
+      for (Key k = 0; k < this->values.size (); k++)
       {
-        const std::string& key = c.first;
-        const Value&       value = c.second;
-        QStringList        path = QString (key.c_str ()).split ("/", QString::SkipEmptyParts);
+        if (this->values[k].isSet ())
+        {
+          const std::string key = registeredPath (k);
+          QStringList       path = QString (key.c_str ()).split ("/", QString::SkipEmptyParts);
 
-        this->appendAsDomChild (doc, doc, path, value);
+          this->appendAsDomChild (doc, doc, path, this->values[k]);
+        }
       }
       if (doc.isNull () == false)
       {
@@ -275,12 +369,40 @@ struct KVStore::Impl
     }
   }
 
-  void remove (const std::string& p) { this->map.erase (this->path (p)); }
+  void remove (const std::string& p)
+  {
+    const Key k = this->key (p);
 
-  void reset () { this->map.clear (); }
+    if (this->find (k))
+    {
+      this->values[k].release ();
+      this->notify (k);
+    }
+  }
+
+  void reset ()
+  {
+    for (Key k = 0; k < this->values.size (); k++)
+    {
+      if (this->values[k].isSet ())
+      {
+        this->values[k].release ();
+        this->notify (k);
+      }
+    }
+  }
 };
 
 DELEGATE1_BIG2 (KVStore, const std::string&)
+
+KVStore::Key KVStore::key (const std::string& root, const std::string& path)
+{
+  return Impl::key (root, path);
+}
+
+DELEGATE1_CONST (KVStore::Key, KVStore, key, const std::string&);
+DELEGATE1 (unsigned int, KVStore, subscribe, const KVStore::Subscriber&);
+DELEGATE1 (void, KVStore, unsubscribe, unsigned int);
 DELEGATE1 (void, KVStore, fromFile, const std::string&);
 DELEGATE1_CONST (void, KVStore, toFile, const std::string&);
 DELEGATE1 (void, KVStore, remove, const std::string&);
@@ -301,21 +423,51 @@ template <class T> void KVStore::set (const std::string& path, const T& value)
   return this->impl->set<T> (path, value);
 }
 
+template <class T> const T& KVStore::get (Key key) const { return this->impl->get<T> (key); }
+
+template <class T> const T& KVStore::get (Key key, const T& defaultV) const
+{
+  return this->impl->get<T> (key, defaultV);
+}
+
+template <class T> void KVStore::set (Key key, const T& value)
+{
+  return this->impl->set<T> (key, value);
+}
+
 template const float&      KVStore::get<float> (const std::string&) const;
 template const float&      KVStore::get<float> (const std::string&, const float&) const;
 template void              KVStore::set<float> (const std::string&, const float&);
+template const float&      KVStore::get<float> (KVStore::Key) const;
+template const float&      KVStore::get<float> (KVStore::Key, const float&) const;
+template void              KVStore::set<float> (KVStore::Key, const float&);
 template const int&        KVStore::get<int> (const std::string&) const;
 template const int&        KVStore::get<int> (const std::string&, const int&) const;
 template void              KVStore::set<int> (const std::string&, const int&);
+template const int&        KVStore::get<int> (KVStore::Key) const;
+template const int&        KVStore::get<int> (KVStore::Key, const int&) const;
+template void              KVStore::set<int> (KVStore::Key, const int&);
 template const bool&       KVStore::get<bool> (const std::string&) const;
 template const bool&       KVStore::get<bool> (const std::string&, const bool&) const;
 template void              KVStore::set<bool> (const std::string&, const bool&);
+template const bool&       KVStore::get<bool> (KVStore::Key) const;
+template const bool&       KVStore::get<bool> (KVStore::Key, const bool&) const;
+template void              KVStore::set<bool> (KVStore::Key, const bool&);
 template const Color&      KVStore::get<Color> (const std::string&) const;
 template const Color&      KVStore::get<Color> (const std::string&, const Color&) const;
 template void              KVStore::set<Color> (const std::string&, const Color&);
+template const Color&      KVStore::get<Color> (KVStore::Key) const;
+template const Color&      KVStore::get<Color> (KVStore::Key, const Color&) const;
+template void              KVStore::set<Color> (KVStore::Key, const Color&);
 template const glm::vec3&  KVStore::get<glm::vec3> (const std::string&) const;
 template const glm::vec3&  KVStore::get<glm::vec3> (const std::string&, const glm::vec3&) const;
 template void              KVStore::set<glm::vec3> (const std::string&, const glm::vec3&);
+template const glm::vec3&  KVStore::get<glm::vec3> (KVStore::Key) const;
+template const glm::vec3&  KVStore::get<glm::vec3> (KVStore::Key, const glm::vec3&) const;
+template void              KVStore::set<glm::vec3> (KVStore::Key, const glm::vec3&);
 template const glm::ivec2& KVStore::get<glm::ivec2> (const std::string&) const;
 template const glm::ivec2& KVStore::get<glm::ivec2> (const std::string&, const glm::ivec2&) const;
 template void              KVStore::set<glm::ivec2> (const std::string&, const glm::ivec2&);
+template const glm::ivec2& KVStore::get<glm::ivec2> (KVStore::Key) const;
+template const glm::ivec2& KVStore::get<glm::ivec2> (KVStore::Key, const glm::ivec2&) const;
+template void              KVStore::set<glm::ivec2> (KVStore::Key, const glm::ivec2&);
@@ -5,17 +5,35 @@
 #ifndef DILAY_KVSTORE
 #define DILAY_KVSTORE
 
+#include <functional>
 #include <string>
 #include "macro.hpp"
 
+/* Values are stored in a flat table that is indexed by keys.  A key is registered once per path
+ * and is shared by all stores, such that it can be resolved before any store exists.  Accessing
+ * values by path resolves the path on each call.  Subscribers are notified of each key whose
+ * value is set or removed.
+ */
 class KVStore
 {
 public:
+  typedef unsigned int             Key;
+  typedef std::function<void(Key)> Subscriber;
+
   DECLARE_BIG2 (KVStore, const std::string&)
 
+  static Key key (const std::string&, const std::string&);
+  Key        key (const std::string&) const;
+
   template <class T> const T& get (const std::string&) const;
   template <class T> const T& get (const std::string&, const T&) const;
   template <class T> void     set (const std::string&, const T&);
+  template <class T> const T& get (Key) const;
+  template <class T> const T& get (Key, const T&) const;
+  template <class T> void     set (Key, const T&);
+
+  unsigned int subscribe (const Subscriber&);
+  void         unsubscribe (unsigned int);
 
   void fromFile (const std::string&);
   void toFile (const std::string&) const;
@@ -0,0 +1,232 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <atomic>
+#include <fstream>
+#include <glm/glm.hpp>
+#include "latency-profiler.hpp"
+#include "util.hpp"
+
+namespace
+{
+  constexpr unsigned int numStages = 8;
+
+  // bucket 0 counts durations below 1µs, bucket `b` durations in [2^(b-1), 2^b) µs
+  constexpr unsigned int numBuckets = 26;
+
+  unsigned int stageIndex (LatencyStage stage) { return static_cast<unsigned int> (stage); }
+
+  const char* stageName (unsigned int index)
+  {
+    switch (LatencyStage (index))
+    {
+      case LatencyStage::Input:
+        return "Input";
+      case LatencyStage::Intersection:
+        return "Intersection";
+      case LatencyStage::Domain:
+        return "Domain";
+      case LatencyStage::Subdivide:
+        return "Subdivide";
+      case LatencyStage::Deform:
+        return "Deform";
+      case LatencyStage::Finalize:
+        return "Finalize";
+      case LatencyStage::BufferUpload:
+        return "Buffer upload";
+      case LatencyStage::Paint:
+        return "Paint";
+      default:
+        DILAY_IMPOSSIBLE
+    }
+  }
+
+  unsigned int bucketIndex (unsigned long long micros)
+  {
+    unsigned int b = 0;
+    while (micros > 0 && b < numBuckets - 1)
+    {
+      micros >>= 1;
+      b++;
+    }
+    return b;
+  }
+
+  float bucketUpperBound (unsigned int b) { return float(1ull << b) * 1.0e-3f; }
+
+  struct Histogram
+  {
+    std::atomic<unsigned int>       counts[numBuckets];
+    std::atomic<unsigned long long> sum;
+    std::atomic<unsigned long long> maximum;
+
+    Histogram () { this->reset (); }
+
+    void reset ()
+    {
+      for (std::atomic<unsigned int>& c : this->counts)
+      {
+        c.store (0, std::memory_order_relaxed);
+      }
+      this->sum.store (0, std::memory_order_relaxed);
+      this->maximum.store (0, std::memory_order_relaxed);
+    }
+
+    void add (unsigned long long micros)
+    {
+      this->counts[bucketIndex (micros)].fetch_add (1, std::memory_order_relaxed);
+      this->sum.fetch_add (micros, std::memory_order_relaxed);
+
+      unsigned long long max = this->maximum.load (std::memory_order_relaxed);
+      while (micros > max &&
+             this->maximum.compare_exchange_weak (max, micros, std::memory_order_relaxed) == false)
+      {
+      }
+    }
+
+    // a snapshot of the counts, which might be concurrently incremented
+    unsigned int load (unsigned int* counts) const
+    {
+      unsigned int total = 0;
+      for (unsigned int b = 0; b < numBuckets; b++)
+      {
+        counts[b] = this->counts[b].load (std::memory_order_relaxed);
+        total += counts[b];
+      }
+      return total;
+    }
+
+    float percentile (const unsigned int* counts, unsigned int total, float p, float max) const
+    {
+      const unsigned int rank = glm::max (1u, (unsigned int) (glm::ceil (p * float(total))));
+      unsigned int       accumulated = 0;
+
+      for (unsigned int b = 0; b < numBuckets; b++)
+      {
+        accumulated += counts[b];
+        if (accumulated >= rank)
+        {
+          return glm::min (bucketUpperBound (b), max);
+        }
+      }
+      return max;
+    }
+
+    LatencySummary summary (const unsigned int* counts, unsigned int total) const
+    {
+      LatencySummary s;
+
+      s.count = total;
+      s.maximum = float(this->maximum.load (std::memory_order_relaxed)) * 1.0e-3f;
+
+      if (total > 0)
+      {
+        s.mean = float(this->sum.load (std::memory_order_relaxed)) * 1.0e-3f / float(total);
+        s.median = this->percentile (counts, total, 0.5f, s.maximum);
+        s.percentile95 = this->percentile (counts, total, 0.95f, s.maximum);
+      }
+      else
+      {
+        s.mean = 0.0f;
+        s.median = 0.0f;
+        s.percentile95 = 0.0f;
+      }
+      return s;
+    }
+  };
+
+  std::atomic<bool> isProfilerEnabled (false);
+  Histogram         histograms[numStages];
+}
+
+namespace LatencyProfiler
+{
+  bool isEnabled () { return isProfilerEnabled.load (std::memory_order_relaxed); }
+
+  void enable (bool value) { isProfilerEnabled.store (value, std::memory_order_relaxed); }
+
+  void record (LatencyStage stage, const Clock::duration& duration)
+  {
+    if (isEnabled ())
+    {
+      const auto micros = std::chrono::duration_cast<std::chrono::microseconds> (duration).count ();
+
+      histograms[stageIndex (stage)].add (micros > 0 ? (unsigned long long) (micros) : 0);
+    }
+  }
+
+  void reset ()
+  {
+    for (Histogram& h : histograms)
+    {
+      h.reset ();
+    }
+  }
+
+  void forEachStage (const StageCallback& f)
+  {
+    unsigned int counts[numBuckets];
+
+    for (unsigned int i = 0; i < numStages; i++)
+    {
+      const unsigned int total = histograms[i].load (counts);
+      f (stageName (i), histograms[i].summary (counts, total));
+    }
+  }
+
+  bool dump (const std::string& fileName)
+  {
+    std::ofstream file (fileName);
+    unsigned int  counts[numBuckets];
+
+    if (file.is_open () == false)
+    {
+      return false;
+    }
+
+    file << "{\n  \"stages\": [";
+    for (unsigned int i = 0; i < numStages; i++)
+    {
+      const unsigned int   total = histograms[i].load (counts);
+      const LatencySummary s = histograms[i].summary (counts, total);
+
+      file << (i == 0 ? "\n" : ",\n") << "    {\n"
+           << "      \"name\": \"" << stageName (i) << "\",\n"
+           << "      \"count\": " << s.count << ",\n"
+           << "      \"mean-ms\": " << s.mean << ",\n"
+           << "      \"median-ms\": " << s.median << ",\n"
+           << "      \"p95-ms\": " << s.percentile95 << ",\n"
+           << "      \"max-ms\": " << s.maximum << ",\n"
+           << "      \"histogram\": [";
+
+      for (unsigned int b = 0; b < numBuckets; b++)
+      {
+        file << (b == 0 ? "" : ", ") << "{\"upper-ms\": " << bucketUpperBound (b)
+             << ", \"count\": " << counts[b] << "}";
+      }
+      file << "]\n    }";
+    }
+    file << "\n  ]\n}\n";
+
+    return file.good ();
+  }
+}
+
+LatencyTimer::LatencyTimer (LatencyStage s)
+  : stage (s)
+  , isEnabled (LatencyProfiler::isEnabled ())
+{
+  if (this->isEnabled)
+  {
+    this->start = LatencyProfiler::Clock::now ();
+  }
+}
+
+LatencyTimer::~LatencyTimer ()
+{
+  if (this->isEnabled)
+  {
+    LatencyProfiler::record (this->stage, LatencyProfiler::Clock::now () - this->start);
+  }
+}
@@ -0,0 +1,71 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_LATENCY_PROFILER
+#define DILAY_LATENCY_PROFILER
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include "macro.hpp"
+
+/* Stages of handling input.  `Input` spans from the creation of a pointing event until the end of
+ * the first frame that is painted after it has been handled.  Stages may nest, e.g. `Finalize` is
+ * also measured within `Subdivide`.
+ */
+enum class LatencyStage
+{
+  Input,
+  Intersection,
+  Domain,
+  Subdivide,
+  Deform,
+  Finalize,
+  BufferUpload,
+  Paint
+};
+
+// durations in milliseconds, percentiles are estimated from histogram buckets
+struct LatencySummary
+{
+  unsigned int count;
+  float        mean;
+  float        median;
+  float        percentile95;
+  float        maximum;
+};
+
+/* Histograms of the durations of each stage.  Durations are recorded without locks, such that
+ * stages may be measured on any thread.  Nothing is recorded unless the profiler is enabled.
+ */
+namespace LatencyProfiler
+{
+  typedef std::chrono::steady_clock                                Clock;
+  typedef std::function<void(const char*, const LatencySummary&)> StageCallback;
+
+  bool isEnabled ();
+  void enable (bool);
+  void record (LatencyStage, const Clock::duration&);
+  void reset ();
+  void forEachStage (const StageCallback&);
+
+  // writes the summaries and histograms of all stages as JSON, returns `false` on failure
+  bool dump (const std::string&);
+}
+
+// measures its own lifetime as a stage
+class LatencyTimer
+{
+public:
+  explicit LatencyTimer (LatencyStage);
+  DELETE_COPYMOVEASSIGN (LatencyTimer)
+  ~LatencyTimer ();
+
+private:
+  const LatencyStage                 stage;
+  const bool                         isEnabled;
+  LatencyProfiler::Clock::time_point start;
+};
+
+#endif
@@ -1,15 +1,51 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
 #include <cstdarg>
 #include <cstdio>
+#include <cstdlib>
 #include <ctime>
+#include <mutex>
 #include <string>
+#include <thread>
 #include "log.hpp"
 #include "util.hpp"
 
 namespace
 {
-  static std::FILE*  fileHandle = nullptr;
-  static std::string filePath;
-  static std::time_t startTime;
+  constexpr unsigned int numSlots = 256;
+  constexpr unsigned int messageSize = 480;
+  constexpr unsigned int maxMessagesPerSecond = 20;
+
+  static_assert ((numSlots & (numSlots - 1)) == 0, "number of slots must be a power of two");
+
+  // the sequence of a slot tells producers and the consumer whose turn it is
+  struct Slot
+  {
+    std::atomic<unsigned int> sequence;
+    Log::Level                level;
+    const char*               file;
+    unsigned int              line;
+    unsigned int              seconds;
+    unsigned int              suppressed;
+    char                      message[messageSize];
+  };
+
+  static std::atomic<std::FILE*> fileHandle (nullptr);
+  static std::string             filePath;
+  static const std::time_t       startTime = std::time (nullptr);
+
+  static Slot                      slots[numSlots];
+  static std::atomic<unsigned int> enqueuePosition (0);
+  static std::atomic<unsigned int> dequeuePosition (0);
+  static std::atomic<unsigned int> numDropped (0);
+
+  static std::once_flag          workerFlag;
+  static std::thread             worker;
+  static std::atomic<bool>       isRunning (false);
+  static std::mutex              wakeMutex;
+  static std::condition_variable wakeCondition;
 
   const char* levelToString (Log::Level level)
   {
@@ -25,14 +61,201 @@ namespace
     return nullptr;
   }
 
+  unsigned int secondsSinceStart ()
+  {
+    return (unsigned int) std::difftime (std::time (nullptr), startTime);
+  }
+
+  void write (const Slot& slot)
+  {
+    const char* level = levelToString (slot.level);
+    std::FILE*  file = fileHandle;
+
+    if (file)
+    {
+      std::fprintf (file, "%09u [%s] %s (%u): %s\n", slot.seconds, level, slot.file, slot.line,
+                    slot.message);
+      if (slot.suppressed > 0)
+      {
+        std::fprintf (file, "%09u [%s] %s (%u): suppressed %u similar messages\n", slot.seconds,
+                      level, slot.file, slot.line, slot.suppressed);
+      }
+    }
+
+    if (slot.level != Log::Level::Info)
+    {
+      std::fprintf (stderr, "%09u [%s] %s (%u): %s\n", slot.seconds, level, slot.file, slot.line,
+                    slot.message);
+    }
+  }
+
+  void writeDropped ()
+  {
+    const unsigned int n = numDropped.exchange (0);
+    std::FILE*         file = fileHandle;
+
+    if (n > 0 && file)
+    {
+      std::fprintf (file, "%09u [WARNING] dropped %u messages\n", secondsSinceStart (), n);
+    }
+  }
+
+  // called by the worker only, which is the single consumer of the queue
+  bool dequeue ()
+  {
+    const unsigned int position = dequeuePosition.load (std::memory_order_relaxed);
+    Slot&              slot = slots[position & (numSlots - 1)];
+
+    if (slot.sequence.load (std::memory_order_acquire) != position + 1)
+    {
+      return false;
+    }
+    writeDropped ();
+    write (slot);
+
+    slot.sequence.store (position + numSlots, std::memory_order_release);
+    dequeuePosition.store (position + 1, std::memory_order_release);
+    return true;
+  }
+
+  void work ()
+  {
+    while (true)
+    {
+      bool hasWritten = false;
+      while (dequeue ())
+      {
+        hasWritten = true;
+      }
+
+      std::FILE* file = fileHandle;
+      if (hasWritten && file)
+      {
+        std::fflush (file);
+      }
+
+      if (isRunning == false && enqueuePosition == dequeuePosition)
+      {
+        break;
+      }
+
+      std::unique_lock<std::mutex> lock (wakeMutex);
+      wakeCondition.wait_for (lock, std::chrono::milliseconds (50));
+    }
+  }
+
   void shutdown ()
   {
-    if (fileHandle)
+    isRunning = false;
+    wakeCondition.notify_one ();
+
+    if (worker.joinable ())
     {
-      std::fclose (fileHandle);
+      worker.join ();
+    }
+
+    std::FILE* file = fileHandle.exchange (nullptr);
+    if (file)
+    {
+      std::fclose (file);
       std::remove (filePath.c_str ());
     }
   }
+
+  void startWorker ()
+  {
+    std::call_once (workerFlag, []() {
+      for (unsigned int i = 0; i < numSlots; i++)
+      {
+        slots[i].sequence = i;
+      }
+      isRunning = true;
+      worker = std::thread (work);
+      std::atexit (shutdown);
+    });
+  }
+
+  // claims a slot without blocking, or returns `nullptr` if the queue is full
+  Slot* claim (unsigned int& position)
+  {
+    position = enqueuePosition.load (std::memory_order_relaxed);
+
+    while (true)
+    {
+      Slot&              slot = slots[position & (numSlots - 1)];
+      const unsigned int sequence = slot.sequence.load (std::memory_order_acquire);
+      const int          diff = int(sequence - position);
+
+      if (diff == 0)
+      {
+        if (enqueuePosition.compare_exchange_weak (position, position + 1,
+                                                   std::memory_order_relaxed))
+        {
+          return &slot;
+        }
+      }
+      else if (diff < 0)
+      {
+        return nullptr;
+      }
+      else
+      {
+        position = enqueuePosition.load (std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // call sites are limited approximately, since concurrent callers may race on a new second
+  bool isLimited (Log::CallSite& site, unsigned int seconds)
+  {
+    if (site.second.exchange (seconds) != seconds)
+    {
+      site.count = 0;
+    }
+    if (site.count.fetch_add (1) >= maxMessagesPerSecond)
+    {
+      site.suppressed++;
+      return true;
+    }
+    return false;
+  }
+
+  void logV (Log::CallSite* site, Log::Level level, const char* file, unsigned int line,
+             const char* format, va_list args)
+  {
+    const unsigned int seconds = secondsSinceStart ();
+
+    if (level != Log::Level::Panic && site && isLimited (*site, seconds))
+    {
+      return;
+    }
+
+    startWorker ();
+
+    unsigned int position;
+    Slot*        slot = claim (position);
+
+    if (slot == nullptr)
+    {
+      numDropped++;
+      return;
+    }
+
+    slot->level = level;
+    slot->file = file;
+    slot->line = line;
+    slot->seconds = seconds;
+    slot->suppressed = site ? site->suppressed.exchange (0) : 0;
+    std::vsnprintf (slot->message, messageSize, format, args);
+    slot->sequence.store (position + 1, std::memory_order_release);
+
+    wakeCondition.notify_one ();
+
+    if (level == Log::Level::Panic)
+    {
+      Log::flush ();
+    }
+  }
 }
 
 namespace Log
@@ -41,13 +264,13 @@ namespace Log
   {
     assert (fileHandle == nullptr);
 
-    fileHandle = std::fopen (path.c_str (), "w");
+    std::FILE* file = std::fopen (path.c_str (), "w");
 
-    if (fileHandle)
+    if (file)
     {
       filePath = path;
-      startTime = std::time (nullptr);
-      std::atexit (shutdown);
+      fileHandle = file;
+      startWorker ();
     }
     else
     {
@@ -57,31 +280,31 @@ namespace Log
 
   void log (Log::Level level, const char* file, unsigned int line, const char* format, ...)
   {
-    const unsigned int secDiff = (unsigned int) std::difftime (std::time (nullptr), startTime);
-
-    va_list args1;
-    va_list args2;
-
-    va_start (args1, format);
-    va_copy (args2, args1);
-
-    std::vector<char> buffer (1 + std::vsnprintf (nullptr, 0, format, args1));
-    va_end (args1);
+    va_list args;
+    va_start (args, format);
+    logV (nullptr, level, file, line, format, args);
+    va_end (args);
+  }
 
-    std::vsnprintf (buffer.data (), buffer.size (), format, args2);
-    va_end (args2);
+  void log (CallSite& site, Log::Level level, const char* file, unsigned int line,
+            const char* format, ...)
+  {
+    va_list args;
+    va_start (args, format);
+    logV (&site, level, file, line, format, args);
+    va_end (args);
+  }
 
-    if (fileHandle)
-    {
-      std::fprintf (fileHandle, "%09u [%s] %s (%u): %s\n", secDiff, levelToString (level), file,
-                    line, buffer.data ());
-      std::fflush (fileHandle);
-    }
+  void flush ()
+  {
+    const unsigned int target = enqueuePosition.load ();
+    const auto         deadline = std::chrono::steady_clock::now () + std::chrono::seconds (1);
 
-    if (level != Log::Level::Info)
+    while (isRunning && int(dequeuePosition.load (std::memory_order_acquire) - target) < 0 &&
+           std::chrono::steady_clock::now () < deadline)
     {
-      std::fprintf (stderr, "%09u [%s] %s (%u): %s\n", secDiff, levelToString (level), file, line,
-                    buffer.data ());
+      wakeCondition.notify_one ();
+      std::this_thread::yield ();
     }
   }
 }
@@ -5,8 +5,13 @@
 #ifndef DILAY_LOG
 #define DILAY_LOG
 
+#include <atomic>
 #include <string>
 
+/* Messages are formatted by the calling thread into a slot of a bounded lock-free queue, and are
+ * written by a background thread.  Messages are dropped if the queue is full, which is reported
+ * with the next written message.  Panics are written before `log` returns.
+ */
 namespace Log
 {
   enum class Level
@@ -16,8 +21,28 @@ namespace Log
     Panic
   };
 
+  /* Limits the number of messages of a single call site per second.  Messages beyond the limit
+   * are suppressed and counted, which is reported with the next message of the call site.
+   */
+  struct CallSite
+  {
+    std::atomic<unsigned int> second;
+    std::atomic<unsigned int> count;
+    std::atomic<unsigned int> suppressed;
+
+    CallSite ()
+      : second (0)
+      , count (0)
+      , suppressed (0)
+    {
+    }
+  };
+
   void initialize (const std::string&);
   void log (Level, const char*, unsigned int, const char*, ...);
+  void log (CallSite&, Level, const char*, unsigned int, const char*, ...);
+  // blocks until all queued messages have been written
+  void flush ();
 }
 
 #endif
@@ -0,0 +1,115 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <chrono>
+#include "dynamic/mesh.hpp"
+#include "maintenance.hpp"
+#include "scene.hpp"
+
+namespace
+{
+  typedef std::chrono::steady_clock Clock;
+
+  enum class Stage
+  {
+    Sanitize,
+    Rebalance,
+    Proxies,
+    Finished
+  };
+}
+
+struct Maintenance::Impl
+{
+  Scene&       scene;
+  Stage        stage;
+  unsigned int meshIndex;
+
+  Impl (Scene& s)
+    : scene (s)
+    , stage (Stage::Finished)
+    , meshIndex (0)
+  {
+  }
+
+  bool isRunning () const { return this->stage != Stage::Finished; }
+
+  void start ()
+  {
+    this->stage = Stage::Sanitize;
+    this->meshIndex = 0;
+  }
+
+  void stop () { this->stage = Stage::Finished; }
+
+  // meshes are looked up by their index in each step, since the scene may change between slices
+  DynamicMesh* mesh (unsigned int index)
+  {
+    DynamicMesh* found = nullptr;
+    unsigned int i = 0;
+
+    this->scene.forEachMesh ([&found, &i, index](DynamicMesh& mesh) {
+      if (i++ == index)
+      {
+        found = &mesh;
+      }
+    });
+    return found;
+  }
+
+  void step ()
+  {
+    switch (this->stage)
+    {
+      case Stage::Sanitize:
+      case Stage::Rebalance:
+      {
+        DynamicMesh* m = this->mesh (this->meshIndex);
+
+        if (m == nullptr)
+        {
+          this->stage = this->stage == Stage::Sanitize ? Stage::Rebalance : Stage::Proxies;
+          this->meshIndex = 0;
+        }
+        else
+        {
+          if (this->stage == Stage::Sanitize)
+          {
+            m->sanitize ();
+          }
+          else
+          {
+            m->rebalanceOctree ();
+          }
+          this->meshIndex++;
+        }
+        break;
+      }
+      case Stage::Proxies:
+        this->scene.updateProxies ();
+        this->stage = Stage::Finished;
+        break;
+
+      case Stage::Finished:
+        break;
+    }
+  }
+
+  bool runSlice (unsigned int milliseconds)
+  {
+    const Clock::time_point end = Clock::now () + std::chrono::milliseconds (milliseconds);
+
+    while (this->isRunning () && Clock::now () < end)
+    {
+      this->step ();
+    }
+    return this->isRunning ();
+  }
+};
+
+DELEGATE1_BIG2 (Maintenance, Scene&)
+DELEGATE_CONST (bool, Maintenance, isRunning)
+DELEGATE (void, Maintenance, start)
+DELEGATE (void, Maintenance, stop)
+DELEGATE1 (bool, Maintenance, runSlice, unsigned int)
@@ -0,0 +1,33 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_MAINTENANCE
+#define DILAY_MAINTENANCE
+
+#include "macro.hpp"
+
+class Scene;
+
+/* Housekeeping of the meshes of a scene while the user is idle: octrees are sanitized and
+ * rebalanced one mesh per step, and proxies are updated at the end of a round.  Steps are run in
+ * time slices, such that events are handled between two slices.  Housekeeping that changes the
+ * indices of vertices or faces (e.g. pruning) is not done, since recorded history refers to them.
+ */
+class Maintenance
+{
+public:
+  DECLARE_BIG2 (Maintenance, Scene&)
+
+  bool isRunning () const;
+  // starts a new round of housekeeping
+  void start ();
+  void stop ();
+  // runs steps for about the given milliseconds and returns whether the round is unfinished
+  bool runSlice (unsigned int);
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -0,0 +1,142 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QTemporaryFile>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include "mapped-memory.hpp"
+#include "util.hpp"
+
+namespace
+{
+  constexpr std::size_t pageSize = 1 << 12;
+  constexpr std::size_t segmentSize = 1 << 26;
+
+  std::atomic<bool> isMappingEnabled (false);
+  std::atomic<bool> isArenaUsed (false);
+
+  std::size_t pageAligned (std::size_t size) { return (size + pageSize - 1) & ~(pageSize - 1); }
+
+  /* Segments of `segmentSize` bytes, each of which maps its own temporary file.  Blocks are taken
+   * from the most recent segment, and freed blocks are kept in lists by their size.  Segments are
+   * never unmapped before the arena is destroyed.
+   */
+  class Arena
+  {
+  public:
+    Arena ()
+      : current (nullptr)
+      , remaining (0)
+    {
+    }
+
+    void* allocate (std::size_t size)
+    {
+      std::lock_guard<std::mutex> lock (this->mutex);
+
+      std::vector<void*>& freeBlocks = this->freeBlocks[size];
+      if (freeBlocks.empty () == false)
+      {
+        void* block = freeBlocks.back ();
+        freeBlocks.pop_back ();
+        return block;
+      }
+      else if (size > this->remaining && this->addSegment () == false)
+      {
+        return nullptr;
+      }
+      void* block = this->current;
+      this->current += size;
+      this->remaining -= size;
+      return block;
+    }
+
+    bool deallocate (void* pointer, std::size_t size)
+    {
+      std::lock_guard<std::mutex> lock (this->mutex);
+
+      const char* p = static_cast<const char*> (pointer);
+      const auto  it = this->segments.upper_bound (p);
+
+      if (it == this->segments.begin () || p >= std::prev (it)->first + segmentSize)
+      {
+        return false;
+      }
+      this->freeBlocks[size].push_back (pointer);
+      return true;
+    }
+
+  private:
+    std::mutex                                             mutex;
+    std::map<const char*, std::unique_ptr<QTemporaryFile>> segments;
+    std::unordered_map<std::size_t, std::vector<void*>>    freeBlocks;
+    char*                                                  current;
+    std::size_t                                            remaining;
+
+    bool addSegment ()
+    {
+      std::unique_ptr<QTemporaryFile> file (new QTemporaryFile);
+
+      if (file->open () == false || file->resize (segmentSize) == false)
+      {
+        DILAY_WARN ("Could not create temporary file for mapped memory");
+        return false;
+      }
+
+      uchar* data = file->map (0, segmentSize);
+      if (data == nullptr)
+      {
+        DILAY_WARN ("Could not map temporary file %s", file->fileName ().toStdString ().c_str ());
+        return false;
+      }
+      this->current = reinterpret_cast<char*> (data);
+      this->remaining = segmentSize;
+      this->segments.emplace (this->current, std::move (file));
+      return true;
+    }
+  };
+
+  // leaked, such that static meshes can still deallocate their blocks when they are destroyed
+  Arena& arena ()
+  {
+    static Arena* arena = new Arena;
+    return *arena;
+  }
+}
+
+namespace MappedMemory
+{
+  bool isEnabled () { return isMappingEnabled; }
+
+  void enable (bool value) { isMappingEnabled = value; }
+
+  void* allocate (std::size_t size)
+  {
+    if (isMappingEnabled && size >= pageSize && size <= segmentSize)
+    {
+      isArenaUsed = true;
+
+      void* block = arena ().allocate (pageAligned (size));
+      if (block)
+      {
+        return block;
+      }
+    }
+    return ::operator new (size);
+  }
+
+  // blocks are looked up in the arena even if mapping has been disabled since their allocation
+  void deallocate (void* pointer, std::size_t size)
+  {
+    if (isArenaUsed == false || size < pageSize || size > segmentSize ||
+        arena ().deallocate (pointer, pageAligned (size)) == false)
+    {
+      ::operator delete (pointer);
+    }
+  }
+}
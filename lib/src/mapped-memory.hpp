@@ -0,0 +1,48 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_MAPPED_MEMORY
+#define DILAY_MAPPED_MEMORY
+
+#include <cstddef>
+#include <vector>
+
+/* Memory that is mapped from temporary files, such that the operating system pages it out to
+ * these files instead of the swap space once physical memory runs short, and pages it in again
+ * when it is accessed.  Blocks are aligned to pages.  Blocks smaller than a page, as well as all
+ * blocks while mapping is disabled, are allocated on the heap.  Mapping is disabled by default.
+ */
+namespace MappedMemory
+{
+  bool  isEnabled ();
+  // only affects subsequent allocations
+  void  enable (bool);
+  void* allocate (std::size_t);
+  void  deallocate (void*, std::size_t);
+}
+
+template <typename T> class MappedAllocator
+{
+public:
+  typedef T value_type;
+
+  MappedAllocator () = default;
+
+  template <typename U> MappedAllocator (const MappedAllocator<U>&) {}
+
+  T* allocate (std::size_t n) { return static_cast<T*> (MappedMemory::allocate (n * sizeof (T))); }
+
+  void deallocate (T* pointer, std::size_t n)
+  {
+    MappedMemory::deallocate (pointer, n * sizeof (T));
+  }
+
+  template <typename U> bool operator== (const MappedAllocator<U>&) const { return true; }
+
+  template <typename U> bool operator!= (const MappedAllocator<U>&) const { return false; }
+};
+
+template <typename T> using MappedVector = std::vector<T, MappedAllocator<T>>;
+
+#endif
@@ -7,6 +7,9 @@
 
 #include <cassert>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 template <typename T> class Maybe
 {
@@ -110,4 +113,143 @@ private:
   std::unique_ptr<T> value;
 };
 
+/* Like `Maybe` but with the value stored inline instead of on the heap, such that setting a
+ * value does not allocate.  Meant for small values that are set frequently, e.g. per event.
+ */
+template <typename T> class InlineMaybe
+{
+  static_assert (std::is_pointer<T>::value == false, "InlineMaybe does not support pointers");
+  static_assert (std::is_reference<T>::value == false, "InlineMaybe does not support references");
+
+public:
+  InlineMaybe ()
+    : _hasValue (false)
+  {
+  }
+
+  InlineMaybe (const T& v)
+    : _hasValue (false)
+  {
+    this->emplace (v);
+  }
+
+  InlineMaybe (const InlineMaybe<T>& o)
+    : _hasValue (false)
+  {
+    if (o.hasValue ())
+    {
+      this->emplace (*o);
+    }
+  }
+
+  InlineMaybe (InlineMaybe<T>&& o)
+    : _hasValue (false)
+  {
+    if (o.hasValue ())
+    {
+      this->emplace (std::move (*o));
+    }
+  }
+
+  template <typename... Args> static InlineMaybe<T> make (Args&&... args)
+  {
+    InlineMaybe<T> m;
+    m.emplace (std::forward<Args> (args)...);
+    return m;
+  }
+
+  ~InlineMaybe () { this->reset (); }
+
+  InlineMaybe<T>& operator= (const T& v)
+  {
+    if (this->get () != &v)
+    {
+      this->emplace (v);
+    }
+    return *this;
+  }
+
+  InlineMaybe<T>& operator= (const InlineMaybe<T>& o)
+  {
+    if (this != &o)
+    {
+      if (o.hasValue ())
+      {
+        this->emplace (*o);
+      }
+      else
+      {
+        this->reset ();
+      }
+    }
+    return *this;
+  }
+
+  InlineMaybe<T>& operator= (InlineMaybe<T>&& o)
+  {
+    if (this != &o)
+    {
+      if (o.hasValue ())
+      {
+        this->emplace (std::move (*o));
+      }
+      else
+      {
+        this->reset ();
+      }
+    }
+    return *this;
+  }
+
+  explicit operator bool () const { return this->hasValue (); }
+
+  bool operator== (bool v) const { return this->operator bool () == v; }
+
+  T& operator* ()
+  {
+    assert (this->hasValue ());
+    return *this->get ();
+  }
+
+  const T& operator* () const
+  {
+    assert (this->hasValue ());
+    return *this->get ();
+  }
+
+  T* operator-> () { return this->get (); }
+
+  const T* operator-> () const { return this->get (); }
+
+  T* get () { return this->_hasValue ? reinterpret_cast<T*> (&this->storage) : nullptr; }
+
+  const T* get () const
+  {
+    return this->_hasValue ? reinterpret_cast<const T*> (&this->storage) : nullptr;
+  }
+
+  bool hasValue () const { return this->_hasValue; }
+
+  template <typename... Args> T& emplace (Args&&... args)
+  {
+    this->reset ();
+    new (&this->storage) T (std::forward<Args> (args)...);
+    this->_hasValue = true;
+    return **this;
+  }
+
+  void reset ()
+  {
+    if (this->_hasValue)
+    {
+      this->get ()->~T ();
+      this->_hasValue = false;
+    }
+  }
+
+private:
+  typename std::aligned_storage<sizeof (T), alignof (T)>::type storage;
+  bool                                                          _hasValue;
+};
+
 #endif
@@ -0,0 +1,63 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include "memory-report.hpp"
+#include "util.hpp"
+
+MemoryReport::MemoryReport ()
+{
+  for (std::size_t& b : this->_bytes)
+  {
+    b = 0;
+  }
+}
+
+const char* MemoryReport::name (MemoryCategory category)
+{
+  switch (category)
+  {
+    case MemoryCategory::MeshData:
+      return "Mesh data";
+    case MemoryCategory::GpuBuffers:
+      return "GPU buffers";
+    case MemoryCategory::Topology:
+      return "Topology";
+    case MemoryCategory::Octree:
+      return "Octree";
+    case MemoryCategory::FaceSets:
+      return "Face sets";
+    case MemoryCategory::History:
+      return "History";
+  }
+  DILAY_IMPOSSIBLE
+}
+
+void MemoryReport::add (MemoryCategory category, std::size_t bytes)
+{
+  this->_bytes[(unsigned int) (category)] += bytes;
+}
+
+std::size_t MemoryReport::bytes (MemoryCategory category) const
+{
+  return this->_bytes[(unsigned int) (category)];
+}
+
+std::size_t MemoryReport::total () const
+{
+  std::size_t sum = 0;
+  for (std::size_t b : this->_bytes)
+  {
+    sum += b;
+  }
+  return sum;
+}
+
+void MemoryReport::forEachCategory (
+  const std::function<void(MemoryCategory, std::size_t)>& f) const
+{
+  for (unsigned int i = 0; i < MemoryReport::numCategories; i++)
+  {
+    f (MemoryCategory (i), this->_bytes[i]);
+  }
+}
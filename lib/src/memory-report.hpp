@@ -0,0 +1,42 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_MEMORY_REPORT
+#define DILAY_MEMORY_REPORT
+
+#include <cstddef>
+#include <functional>
+
+enum class MemoryCategory
+{
+  MeshData,   // vertices, indices and normals of meshes in main memory
+  GpuBuffers, // OpenGL buffers of meshes
+  Topology,   // adjacency and per-vertex and per-face data of dynamic meshes
+  Octree,     // octree nodes and precomputed triangles of dynamic meshes
+  FaceSets,   // temporary sets of faces of sculpt actions
+  History     // in-memory deltas and copies of undo snapshots
+};
+
+/* Sums the bytes that objects report to each category.  Reports count the capacity of their
+ * containers, and storage that is shared among copies of a mesh is divided among them.
+ */
+class MemoryReport
+{
+public:
+  static constexpr unsigned int numCategories = 6;
+
+  MemoryReport ();
+
+  static const char* name (MemoryCategory);
+
+  void        add (MemoryCategory, std::size_t);
+  std::size_t bytes (MemoryCategory) const;
+  std::size_t total () const;
+  void        forEachCategory (const std::function<void(MemoryCategory, std::size_t)>&) const;
+
+private:
+  std::size_t _bytes[numCategories];
+};
+
+#endif
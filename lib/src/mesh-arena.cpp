@@ -0,0 +1,398 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <iterator>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "camera.hpp"
+#include "mesh-arena.hpp"
+#include "mesh-instances.hpp"
+#include "mesh.hpp"
+#include "opengl-buffer-id.hpp"
+#include "opengl.hpp"
+#include "render-mode.hpp"
+#include "renderer.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // normals are encoded as two 16-bit integers, cf. `Mesh::writeBufferData`
+  constexpr unsigned int normalSize = 2 * sizeof (std::int16_t);
+  constexpr unsigned int minCapacity = 1 << 16;
+  constexpr unsigned int minStableFrames = 2;
+
+  // first-fit allocator of ranges of `[0, capacity)`, which merges freed ranges with neighbours
+  class FreeList
+  {
+  public:
+    FreeList ()
+      : _capacity (0)
+    {
+    }
+
+    unsigned int capacity () const { return this->_capacity; }
+
+    void reset (unsigned int capacity)
+    {
+      this->ranges.clear ();
+      this->_capacity = capacity;
+
+      if (capacity > 0)
+      {
+        this->ranges.emplace (0, capacity);
+      }
+    }
+
+    bool allocate (unsigned int size, unsigned int& offset)
+    {
+      for (auto it = this->ranges.begin (); it != this->ranges.end (); ++it)
+      {
+        if (it->second >= size)
+        {
+          const unsigned int remaining = it->second - size;
+
+          offset = it->first;
+          this->ranges.erase (it);
+
+          if (remaining > 0)
+          {
+            this->ranges.emplace (offset + size, remaining);
+          }
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void free (unsigned int offset, unsigned int size)
+    {
+      if (size == 0)
+      {
+        return;
+      }
+
+      auto next = this->ranges.lower_bound (offset);
+
+      if (next != this->ranges.end () && offset + size == next->first)
+      {
+        size += next->second;
+        next = this->ranges.erase (next);
+      }
+      if (next != this->ranges.begin ())
+      {
+        auto prev = std::prev (next);
+
+        if (prev->first + prev->second == offset)
+        {
+          prev->second += size;
+          return;
+        }
+      }
+      this->ranges.emplace (offset, size);
+    }
+
+  private:
+    std::map<unsigned int, unsigned int> ranges;  // offsets and sizes of free ranges
+    unsigned int                         _capacity;
+  };
+
+  // OpenGL buffer of elements of `elementSize` bytes
+  struct ArenaBuffer
+  {
+    OpenGLBufferId     id;
+    const unsigned int elementSize;
+
+    ArenaBuffer (unsigned int s)
+      : elementSize (s)
+    {
+    }
+
+    void allocate (unsigned int capacity)
+    {
+      this->id.reset ();
+      this->id.allocate ();
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->id.id ());
+      OpenGL::glBufferData (OpenGL::ArrayBuffer (), capacity * this->elementSize, nullptr,
+                            OpenGL::StaticDraw ());
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+    }
+
+    void write (unsigned int offset, unsigned int n, const void* data)
+    {
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->id.id ());
+      OpenGL::glBufferSubData (OpenGL::ArrayBuffer (), offset * this->elementSize,
+                               n * this->elementSize, data);
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+    }
+  };
+
+  struct Slot
+  {
+    unsigned int revision;
+    unsigned int frame;  // most recent frame in which the mesh has been added
+    unsigned int numStableFrames;
+    bool         isAllocated;
+    unsigned int firstVertex;
+    unsigned int numVertices;
+    unsigned int firstIndex;
+    unsigned int numIndices;
+  };
+
+  // layout of GL_DRAW_INDIRECT_BUFFER
+  struct DrawCommand
+  {
+    std::uint32_t count;
+    std::uint32_t instanceCount;
+    std::uint32_t firstIndex;
+    std::int32_t  baseVertex;
+    std::uint32_t baseInstance;
+  };
+}
+
+struct MeshArena::Impl
+{
+  ArenaBuffer                           vertices;
+  ArenaBuffer                           normals;
+  ArenaBuffer                           indices;
+  FreeList                              vertexRanges;
+  FreeList                              indexRanges;
+  std::unordered_map<const Mesh*, Slot> slots;
+  std::vector<const Mesh*>              draws;
+  MeshInstances                         instances;
+  OpenGLBufferId                        commandsId;
+  std::vector<DrawCommand>              commands;
+  unsigned int                          frame;
+
+  Impl ()
+    : vertices (sizeof (glm::vec3))
+    , normals (normalSize)
+    , indices (sizeof (unsigned int))
+    , frame (0)
+  {
+  }
+
+  static bool isSupported () { return OpenGL::hasMultiDrawIndirect () && OpenGL::hasInstancing (); }
+
+  bool add (const Mesh& mesh)
+  {
+    assert (Impl::isSupported ());
+
+    Slot&              slot = this->slots[&mesh];
+    const unsigned int revision = mesh.revision ();
+
+    slot.frame = this->frame;
+
+    if (slot.revision != revision)
+    {
+      this->release (slot);
+      slot.revision = revision;
+      slot.numStableFrames = 0;
+      return false;
+    }
+    else if (slot.numStableFrames < minStableFrames)
+    {
+      slot.numStableFrames++;
+
+      if (slot.numStableFrames < minStableFrames)
+      {
+        return false;
+      }
+    }
+
+    if (mesh.numIndices () == 0)
+    {
+      return true;
+    }
+    else if (slot.isAllocated == false && this->allocate (slot, mesh) == false)
+    {
+      this->grow (mesh);
+
+      const bool allocated = this->allocate (slot, mesh);
+      assert (allocated);
+      unused (allocated);
+    }
+    this->draws.push_back (&mesh);
+    return true;
+  }
+
+  bool allocate (Slot& slot, const Mesh& mesh)
+  {
+    const unsigned int numVertices = mesh.numVertices ();
+    const unsigned int numIndices = mesh.numIndices ();
+    unsigned int       firstVertex, firstIndex;
+
+    if (this->vertexRanges.allocate (numVertices, firstVertex) == false)
+    {
+      return false;
+    }
+    else if (this->indexRanges.allocate (numIndices, firstIndex) == false)
+    {
+      this->vertexRanges.free (firstVertex, numVertices);
+      return false;
+    }
+
+    slot.isAllocated = true;
+    slot.firstVertex = firstVertex;
+    slot.numVertices = numVertices;
+    slot.firstIndex = firstIndex;
+    slot.numIndices = numIndices;
+
+    std::vector<char>         vertexData (numVertices * this->vertices.elementSize);
+    std::vector<char>         normalData (numVertices * this->normals.elementSize);
+    std::vector<unsigned int> indexData (numIndices);
+
+    mesh.writeBufferData (vertexData.data (), normalData.data (), indexData.data ());
+
+    this->vertices.write (firstVertex, numVertices, vertexData.data ());
+    this->normals.write (firstVertex, numVertices, normalData.data ());
+    this->indices.write (firstIndex, numIndices, indexData.data ());
+    return true;
+  }
+
+  void release (Slot& slot)
+  {
+    if (slot.isAllocated)
+    {
+      this->vertexRanges.free (slot.firstVertex, slot.numVertices);
+      this->indexRanges.free (slot.firstIndex, slot.numIndices);
+      slot.isAllocated = false;
+    }
+  }
+
+  // reallocates all buffers with at least twice their capacity and writes the drawn meshes again
+  void grow (const Mesh& mesh)
+  {
+    unsigned int numVertices = mesh.numVertices ();
+    unsigned int numIndices = mesh.numIndices ();
+
+    for (const Mesh* m : this->draws)
+    {
+      numVertices += m->numVertices ();
+      numIndices += m->numIndices ();
+    }
+
+    const unsigned int vertexCapacity =
+      glm::max (minCapacity, glm::max (2 * this->vertexRanges.capacity (), numVertices));
+    const unsigned int indexCapacity =
+      glm::max (minCapacity, glm::max (2 * this->indexRanges.capacity (), numIndices));
+
+    this->vertices.allocate (vertexCapacity);
+    this->normals.allocate (vertexCapacity);
+    this->indices.allocate (indexCapacity);
+    this->vertexRanges.reset (vertexCapacity);
+    this->indexRanges.reset (indexCapacity);
+
+    for (auto& s : this->slots)
+    {
+      s.second.isAllocated = false;
+    }
+    for (const Mesh* m : this->draws)
+    {
+      const bool allocated = this->allocate (this->slots.at (m), *m);
+      assert (allocated);
+      unused (allocated);
+    }
+  }
+
+  void render (Camera& camera, const RenderMode& mode)
+  {
+    for (auto it = this->slots.begin (); it != this->slots.end ();)
+    {
+      if (it->second.frame != this->frame)
+      {
+        this->release (it->second);
+        it = this->slots.erase (it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+    this->frame++;
+
+    if (this->draws.empty ())
+    {
+      return;
+    }
+
+    this->instances.reset ();
+    this->commands.clear ();
+
+    for (const Mesh* mesh : this->draws)
+    {
+      const Slot& slot = this->slots.at (mesh);
+
+      this->commands.push_back (DrawCommand{slot.numIndices, 1, slot.firstIndex,
+                                            std::int32_t (slot.firstVertex),
+                                            this->instances.numInstances ()});
+      this->instances.add (mesh->position (), mesh->scaling (), mesh->rotationMatrix (),
+                           mesh->color ());
+    }
+    this->draws.clear ();
+    this->instances.bufferAttributes ();
+
+    if (this->commandsId.isValid () == false)
+    {
+      this->commandsId.allocate ();
+    }
+    OpenGL::glBindBuffer (OpenGL::DrawIndirectBuffer (), this->commandsId.id ());
+    OpenGL::glBufferData (OpenGL::DrawIndirectBuffer (),
+                          this->commands.size () * sizeof (DrawCommand), this->commands.data (),
+                          OpenGL::StreamDraw ());
+
+    RenderMode instancedMode (mode);
+    instancedMode.renderWireframe (false);
+    instancedMode.instancing (true);
+
+    camera.renderer ().setProgram (instancedMode);
+    camera.setModelViewProjection (glm::mat4x4 (1.0f), glm::mat3x3 (1.0f), false);
+
+    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->vertices.id.id ());
+    OpenGL::glEnableVertexAttribArray (OpenGL::PositionIndex);
+    OpenGL::glVertexAttribPointer (OpenGL::PositionIndex, 3, OpenGL::Float (), false, 0, nullptr);
+
+    if (instancedMode.smoothShading ())
+    {
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->normals.id.id ());
+      OpenGL::glEnableVertexAttribArray (OpenGL::NormalIndex);
+      OpenGL::glVertexAttribPointer (OpenGL::NormalIndex, 2, OpenGL::Short (), true, 0, nullptr);
+    }
+    else
+    {
+      OpenGL::glDisableVertexAttribArray (OpenGL::NormalIndex);
+    }
+    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+    this->instances.enableAttributes ();
+
+    OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), this->indices.id.id ());
+    OpenGL::glMultiDrawElementsIndirect (OpenGL::Triangles (), OpenGL::UnsignedInt (), nullptr,
+                                         this->commands.size (), 0);
+
+    this->instances.disableAttributes ();
+    OpenGL::glDisableVertexAttribArray (OpenGL::PositionIndex);
+    OpenGL::glDisableVertexAttribArray (OpenGL::NormalIndex);
+    OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), 0);
+    OpenGL::glBindBuffer (OpenGL::DrawIndirectBuffer (), 0);
+  }
+
+  void reset ()
+  {
+    this->vertices.id.reset ();
+    this->normals.id.reset ();
+    this->indices.id.reset ();
+    this->vertexRanges.reset (0);
+    this->indexRanges.reset (0);
+    this->slots.clear ();
+    this->draws.clear ();
+  }
+};
+
+DELEGATE_BIG2 (MeshArena)
+DELEGATE_STATIC (bool, MeshArena, isSupported)
+DELEGATE1 (bool, MeshArena, add, const Mesh&)
+DELEGATE2 (void, MeshArena, render, Camera&, const RenderMode&)
+DELEGATE (void, MeshArena, reset)
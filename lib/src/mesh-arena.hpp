@@ -0,0 +1,39 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_MESH_ARENA
+#define DILAY_MESH_ARENA
+
+#include "macro.hpp"
+
+class Camera;
+class Mesh;
+class RenderMode;
+
+/* Vertices, normals and indices of many meshes in shared OpenGL buffers, whose ranges are
+ * allocated from free lists.  The meshes that are added while a frame is rendered are drawn by a
+ * single `glMultiDrawElementsIndirect`, whose commands select the model matrices and colors of
+ * their meshes as per-instance attributes by their base instances.  Meshes are only written to
+ * the buffers if their revision changes, and meshes that are modified in consecutive frames are
+ * left to be rendered on their own.
+ */
+class MeshArena
+{
+public:
+  DECLARE_BIG2 (MeshArena)
+
+  // whether multi-draw-indirect and instancing are supported by the OpenGL context
+  static bool isSupported ();
+
+  // returns `false` if the mesh must be rendered on its own
+  bool add (const Mesh&);
+  // draws and removes the added meshes, and frees the ranges of meshes that have not been added
+  void render (Camera&, const RenderMode&);
+  void reset ();
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -0,0 +1,290 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <utility>
+#include "dynamic/mesh.hpp"
+#include "intersection.hpp"
+#include "mesh-bvh.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/ray.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // bounds are empty if their minimum exceeds their maximum
+  struct Bounds
+  {
+    glm::vec3 minimum;
+    glm::vec3 maximum;
+
+    Bounds ()
+      : minimum (Util::maxFloat ())
+      , maximum (-Util::maxFloat ())
+    {
+    }
+
+    bool isEmpty () const { return this->minimum.x > this->maximum.x; }
+
+    glm::vec3 center () const
+    {
+      return this->isEmpty () ? glm::vec3 (0.0f) : 0.5f * (this->minimum + this->maximum);
+    }
+
+    void extend (const Bounds& other)
+    {
+      this->minimum = glm::min (this->minimum, other.minimum);
+      this->maximum = glm::max (this->maximum, other.maximum);
+    }
+
+    bool intersects (const PrimRay& ray, float& t) const
+    {
+      if (this->isEmpty ())
+      {
+        return false;
+      }
+      else if (IntersectionUtil::intersects (ray, PrimAABox (this->minimum, this->maximum), &t))
+      {
+        t = ray.isLine () ? -Util::maxFloat () : glm::max (0.0f, t);
+        return true;
+      }
+      else
+      {
+        return false;
+      }
+    }
+  };
+
+  struct Leaf
+  {
+    DynamicMesh* mesh;
+    unsigned int revision;
+    Bounds       bounds;
+
+    Leaf (DynamicMesh& m)
+      : mesh (&m)
+    {
+      this->refresh ();
+    }
+
+    void refresh ()
+    {
+      this->revision = this->mesh->revision ();
+      this->bounds = Bounds ();
+
+      if (this->mesh->isEmpty () == false)
+      {
+        const PrimAABox box = this->mesh->bounds ();
+        this->bounds.minimum = box.minimum ();
+        this->bounds.maximum = box.maximum ();
+      }
+    }
+  };
+
+  // children of a node have larger indices than their parent
+  struct Node
+  {
+    Bounds       bounds;
+    unsigned int leaf;
+    unsigned int left;
+    unsigned int right;
+
+    Node ()
+      : leaf (Util::invalidIndex ())
+      , left (Util::invalidIndex ())
+      , right (Util::invalidIndex ())
+    {
+    }
+
+    bool isLeaf () const { return this->leaf != Util::invalidIndex (); }
+  };
+}
+
+struct MeshBvh::Impl
+{
+  std::vector<Leaf>                                   leaves;
+  std::vector<Node>                                   nodes;
+  std::vector<unsigned int>                           order;
+  mutable std::vector<std::pair<float, unsigned int>> stack;
+
+  void update (const std::vector<DynamicMesh*>& meshes)
+  {
+    if (this->hasSameMeshes (meshes))
+    {
+      bool isRefitted = false;
+
+      for (Leaf& leaf : this->leaves)
+      {
+        if (leaf.revision != leaf.mesh->revision ())
+        {
+          leaf.refresh ();
+          isRefitted = true;
+        }
+      }
+      if (isRefitted)
+      {
+        this->refit ();
+      }
+    }
+    else
+    {
+      this->leaves.clear ();
+      this->nodes.clear ();
+      this->order.clear ();
+
+      for (unsigned int i = 0; i < meshes.size (); i++)
+      {
+        this->leaves.emplace_back (*meshes[i]);
+        this->order.push_back (i);
+      }
+      if (this->leaves.empty () == false)
+      {
+        this->build (0, this->order.size ());
+        this->refit ();
+      }
+    }
+  }
+
+  bool hasSameMeshes (const std::vector<DynamicMesh*>& meshes) const
+  {
+    if (meshes.size () != this->leaves.size ())
+    {
+      return false;
+    }
+    for (unsigned int i = 0; i < meshes.size (); i++)
+    {
+      if (meshes[i] != this->leaves[i].mesh)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // splits at the median of the leaves' centers along the dimension of their largest extent
+  unsigned int build (unsigned int begin, unsigned int end)
+  {
+    assert (begin < end);
+
+    const unsigned int n = this->nodes.size ();
+    this->nodes.emplace_back ();
+
+    if (end - begin == 1)
+    {
+      this->nodes[n].leaf = this->order[begin];
+    }
+    else
+    {
+      Bounds centers;
+      for (unsigned int i = begin; i < end; i++)
+      {
+        const glm::vec3 c = this->leaves[this->order[i]].bounds.center ();
+        centers.minimum = glm::min (centers.minimum, c);
+        centers.maximum = glm::max (centers.maximum, c);
+      }
+
+      const glm::vec3    extent = centers.maximum - centers.minimum;
+      const unsigned int dim =
+        extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+      const unsigned int mid = begin + ((end - begin) / 2);
+
+      std::nth_element (this->order.begin () + begin, this->order.begin () + mid,
+                        this->order.begin () + end, [this, dim](unsigned int a, unsigned int b) {
+                          return this->leaves[a].bounds.center ()[dim] <
+                                 this->leaves[b].bounds.center ()[dim];
+                        });
+
+      const unsigned int left = this->build (begin, mid);
+      const unsigned int right = this->build (mid, end);
+
+      this->nodes[n].left = left;
+      this->nodes[n].right = right;
+    }
+    return n;
+  }
+
+  void refit ()
+  {
+    for (unsigned int i = this->nodes.size (); i > 0; i--)
+    {
+      Node& node = this->nodes[i - 1];
+
+      if (node.isLeaf ())
+      {
+        node.bounds = this->leaves[node.leaf].bounds;
+      }
+      else
+      {
+        node.bounds = this->nodes[node.left].bounds;
+        node.bounds.extend (this->nodes[node.right].bounds);
+      }
+    }
+  }
+
+  void intersects (const PrimRay& ray, float upperBound, const IntersectionCallback& f) const
+  {
+    float distance = upperBound;
+    float t;
+
+    this->stack.clear ();
+    if (this->nodes.empty () == false && this->nodes[0].bounds.intersects (ray, t))
+    {
+      this->stack.emplace_back (t, 0);
+    }
+
+    while (this->stack.empty () == false)
+    {
+      const std::pair<float, unsigned int> entry = this->stack.back ();
+      this->stack.pop_back ();
+
+      if (entry.first >= distance)
+      {
+        continue;
+      }
+
+      const Node& node = this->nodes[entry.second];
+      if (node.isLeaf ())
+      {
+        distance = glm::min (distance, f (*this->leaves[node.leaf].mesh));
+      }
+      else
+      {
+        float      tLeft;
+        float      tRight;
+        const bool hitsLeft = this->nodes[node.left].bounds.intersects (ray, tLeft);
+        const bool hitsRight = this->nodes[node.right].bounds.intersects (ray, tRight);
+
+        // the nearer child is pushed last, such that it is visited first
+        if (hitsLeft && hitsRight && tLeft < tRight)
+        {
+          this->stack.emplace_back (tRight, node.right);
+          this->stack.emplace_back (tLeft, node.left);
+        }
+        else
+        {
+          if (hitsLeft)
+          {
+            this->stack.emplace_back (tLeft, node.left);
+          }
+          if (hitsRight)
+          {
+            this->stack.emplace_back (tRight, node.right);
+          }
+        }
+      }
+    }
+  }
+
+  void intersects (const PrimRay& ray, const IntersectionCallback& f) const
+  {
+    this->intersects (ray, Util::maxFloat (), f);
+  }
+};
+
+DELEGATE_BIG2 (MeshBvh)
+DELEGATE1 (void, MeshBvh, update, const std::vector<DynamicMesh*>&)
+DELEGATE2_CONST (void, MeshBvh, intersects, const PrimRay&, const MeshBvh::IntersectionCallback&)
+DELEGATE3_CONST (void, MeshBvh, intersects, const PrimRay&, float,
+                 const MeshBvh::IntersectionCallback&)
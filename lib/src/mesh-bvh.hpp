@@ -0,0 +1,41 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_MESH_BVH
+#define DILAY_MESH_BVH
+
+#include <functional>
+#include <vector>
+#include "macro.hpp"
+
+class DynamicMesh;
+class PrimRay;
+
+/* Bounding volume hierarchy over the bounds of dynamic meshes.  The hierarchy is rebuilt if meshes
+ * are added or removed, and refitted if the revision of a mesh changes, e.g. after it has been
+ * sculpted or transformed.
+ */
+class MeshBvh
+{
+public:
+  DECLARE_BIG2 (MeshBvh)
+
+  // returns the distance of the nearest intersection found so far
+  typedef std::function<float(DynamicMesh&)> IntersectionCallback;
+
+  void update (const std::vector<DynamicMesh*>&);
+
+  /* Calls the callback with each mesh whose bounds are intersected by the ray, in near-to-far
+   * order.  Meshes whose bounds are farther away than the nearest intersection are skipped.
+   */
+  void intersects (const PrimRay&, const IntersectionCallback&) const;
+
+  // meshes whose bounds are farther away than the given upper bound are skipped as well
+  void intersects (const PrimRay&, float, const IntersectionCallback&) const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -0,0 +1,170 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include "color.hpp"
+#include "mesh-instances.hpp"
+#include "mesh.hpp"
+#include "opengl-buffer-id.hpp"
+#include "opengl.hpp"
+
+namespace
+{
+  struct Instance
+  {
+    glm::vec3   position;
+    glm::vec3   scaling;
+    glm::mat4x4 rotation;
+    Color       color;
+  };
+
+  // per-instance attributes as they are stored in the OpenGL buffer
+  struct InstanceAttributes
+  {
+    glm::mat4x4 model;
+    glm::mat3x3 modelNormal;
+    glm::vec3   color;
+  };
+
+  static_assert (sizeof (InstanceAttributes) == 28 * sizeof (float), "Unexpected memory layout");
+
+  const void* attributeOffset (std::size_t offset)
+  {
+    return reinterpret_cast<const void*> (std::uintptr_t (offset));
+  }
+}
+
+struct MeshInstances::Impl
+{
+  MeshInstances*                  self;
+  std::vector<Instance>           instances;
+  std::vector<InstanceAttributes> attributes;
+  OpenGLBufferId                  bufferId;
+
+  Impl (MeshInstances* s)
+    : self (s)
+  {
+  }
+
+  unsigned int numInstances () const { return this->instances.size (); }
+
+  void add (const glm::vec3& position, float radius, const Color& color)
+  {
+    this->add (position, glm::vec3 (radius), glm::mat4x4 (1.0f), color);
+  }
+
+  void add (const glm::vec3& position, const glm::vec3& scaling, const glm::mat4x4& rotation,
+            const Color& color)
+  {
+    this->instances.push_back (Instance{position, scaling, rotation, color});
+  }
+
+  void render (Camera& camera, Mesh& mesh)
+  {
+    if (this->instances.empty ())
+    {
+      return;
+    }
+    else if (OpenGL::hasInstancing ())
+    {
+      this->bufferAttributes ();
+      mesh.renderInstances (camera, *this->self);
+    }
+    else
+    {
+      for (const Instance& instance : this->instances)
+      {
+        mesh.position (instance.position);
+        mesh.scaling (instance.scaling);
+        mesh.rotationMatrix (instance.rotation);
+        mesh.color (instance.color);
+        mesh.render (camera);
+      }
+    }
+  }
+
+  void bufferAttributes ()
+  {
+    this->attributes.clear ();
+    this->attributes.reserve (this->instances.size ());
+
+    for (const Instance& instance : this->instances)
+    {
+      const glm::mat4x4 model = glm::translate (glm::mat4x4 (1.0f), instance.position) *
+                                instance.rotation *
+                                glm::scale (glm::mat4x4 (1.0f), instance.scaling);
+
+      this->attributes.push_back (InstanceAttributes{
+        model, glm::inverseTranspose (glm::mat3x3 (model)), instance.color.vec3 ()});
+    }
+
+    if (this->bufferId.isValid () == false)
+    {
+      this->bufferId.allocate ();
+    }
+    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->bufferId.id ());
+    OpenGL::glBufferData (OpenGL::ArrayBuffer (),
+                          this->attributes.size () * sizeof (InstanceAttributes),
+                          this->attributes.data (), OpenGL::StreamDraw ());
+    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+  }
+
+  static void enableAttribute (unsigned int index, int size, const void* offset)
+  {
+    OpenGL::glEnableVertexAttribArray (index);
+    OpenGL::glVertexAttribPointer (index, size, OpenGL::Float (), false,
+                                   sizeof (InstanceAttributes), offset);
+    OpenGL::glVertexAttribDivisor (index, 1);
+  }
+
+  void enableAttributes () const
+  {
+    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->bufferId.id ());
+
+    for (unsigned int i = 0; i < 4; i++)
+    {
+      const std::size_t column = i * sizeof (glm::vec4);
+
+      Impl::enableAttribute (OpenGL::InstanceModelIndex + i, 4,
+                             attributeOffset (offsetof (InstanceAttributes, model) + column));
+    }
+    for (unsigned int i = 0; i < 3; i++)
+    {
+      const std::size_t column = i * sizeof (glm::vec3);
+
+      Impl::enableAttribute (OpenGL::InstanceModelNormalIndex + i, 3,
+                             attributeOffset (offsetof (InstanceAttributes, modelNormal) + column));
+    }
+    Impl::enableAttribute (OpenGL::InstanceColorIndex, 3,
+                           attributeOffset (offsetof (InstanceAttributes, color)));
+    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+  }
+
+  void disableAttributes () const
+  {
+    for (unsigned int i = OpenGL::InstanceModelIndex; i <= OpenGL::InstanceColorIndex; i++)
+    {
+      OpenGL::glVertexAttribDivisor (i, 0);
+      OpenGL::glDisableVertexAttribArray (i);
+    }
+  }
+
+  void reset () { this->instances.clear (); }
+};
+
+DELEGATE_BIG6_SELF (MeshInstances)
+DELEGATE_CONST (unsigned int, MeshInstances, numInstances)
+DELEGATE3 (void, MeshInstances, add, const glm::vec3&, float, const Color&)
+DELEGATE4 (void, MeshInstances, add, const glm::vec3&, const glm::vec3&, const glm::mat4x4&,
+           const Color&)
+DELEGATE2 (void, MeshInstances, render, Camera&, Mesh&)
+DELEGATE (void, MeshInstances, bufferAttributes)
+DELEGATE_CONST (void, MeshInstances, enableAttributes)
+DELEGATE_CONST (void, MeshInstances, disableAttributes)
+DELEGATE (void, MeshInstances, reset)
@@ -0,0 +1,39 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_MESH_INSTANCES
+#define DILAY_MESH_INSTANCES
+
+#include <glm/fwd.hpp>
+#include "macro.hpp"
+
+class Camera;
+class Color;
+class Mesh;
+
+/* Instances of a mesh that are rendered by a single instanced draw call.  If instancing is not
+ * supported, each instance is rendered on its own.  Copies have no OpenGL buffer.
+ */
+class MeshInstances
+{
+public:
+  DECLARE_BIG6 (MeshInstances)
+
+  unsigned int numInstances () const;
+  void         add (const glm::vec3&, float, const Color&);
+  void         add (const glm::vec3&, const glm::vec3&, const glm::mat4x4&, const Color&);
+  void         render (Camera&, Mesh&);
+  void         reset ();
+
+  // writes the per-instance attributes to their OpenGL buffer, which is done by `render`
+  void bufferAttributes ();
+  // sets up the per-instance attributes of `Mesh::renderInstances`
+  void enableAttributes () const;
+  void disableAttributes () const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
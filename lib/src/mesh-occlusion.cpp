@@ -0,0 +1,203 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include "camera.hpp"
+#include "config.hpp"
+#include "dynamic/mesh.hpp"
+#include "mesh-occlusion.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "opengl.hpp"
+#include "primitive/aabox.hpp"
+#include "util.hpp"
+
+namespace
+{
+  struct Query
+  {
+    unsigned int id;
+    unsigned int frame;
+    bool         isPending;
+    bool         isOccluded;
+  };
+}
+
+struct MeshOcclusion::Impl
+{
+  MeshOcclusion*                                self;
+  std::unordered_map<const DynamicMesh*, Query> queries;
+  Mesh                                          box;
+  bool                                          isBuffered;
+  unsigned int                                  frame;
+  bool                                          isEnabled;
+  unsigned int                                  minFaces;
+  float                                         nearClipping;
+
+  Impl (MeshOcclusion* s, const Config& config)
+    : self (s)
+    , box (MeshUtil::cube (0))
+    , isBuffered (false)
+    , frame (0)
+  {
+    this->box.renderMode ().constantShading (true);
+    this->runFromConfig (config);
+  }
+
+  ~Impl () { this->reset (); }
+
+  void reset ()
+  {
+    for (auto& q : this->queries)
+    {
+      OpenGL::glDeleteQueries (1, &q.second.id);
+    }
+    this->queries.clear ();
+  }
+
+  bool isOccluded (const DynamicMesh& mesh)
+  {
+    auto it = this->queries.find (&mesh);
+
+    if (it == this->queries.end ())
+    {
+      return false;
+    }
+
+    Query& query = it->second;
+
+    if (query.isPending)
+    {
+      int isAvailable = 0;
+      OpenGL::glGetQueryObjectiv (query.id, OpenGL::QueryResultAvailable (), &isAvailable);
+
+      if (isAvailable)
+      {
+        int numSamples = 0;
+        OpenGL::glGetQueryObjectiv (query.id, OpenGL::QueryResult (), &numSamples);
+
+        query.isOccluded = numSamples == 0;
+        query.isPending = false;
+      }
+    }
+    return query.isOccluded;
+  }
+
+  // world space bounds of the transformed object space bounds of a mesh
+  PrimAABox worldBounds (const DynamicMesh& mesh) const
+  {
+    const PrimAABox bounds = mesh.bounds ();
+    const glm::mat4 model = mesh.mesh ().modelMatrix ();
+    glm::vec3       min (Util::maxFloat ());
+    glm::vec3       max (-Util::maxFloat ());
+
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      const glm::vec3 corner ((i & 1) ? bounds.maximum ().x : bounds.minimum ().x,
+                              (i & 2) ? bounds.maximum ().y : bounds.minimum ().y,
+                              (i & 4) ? bounds.maximum ().z : bounds.minimum ().z);
+      const glm::vec3 world = glm::vec3 (model * glm::vec4 (corner, 1.0f));
+
+      min = glm::min (min, world);
+      max = glm::max (max, world);
+    }
+    return PrimAABox (min, max);
+  }
+
+  // the box of a mesh is not rendered if the camera is inside, in which case it is not occluded
+  bool isTestable (const Camera& camera, const PrimAABox& bounds) const
+  {
+    const glm::vec3 margin (2.0f * this->nearClipping);
+    const glm::vec3 pos = camera.position ();
+
+    return glm::any (glm::lessThan (pos, bounds.minimum () - margin)) ||
+           glm::any (glm::greaterThan (pos, bounds.maximum () + margin));
+  }
+
+  void test (Camera& camera, const std::vector<const DynamicMesh*>& meshes)
+  {
+    this->frame++;
+
+    if (this->isEnabled == false || meshes.size () < 2)
+    {
+      this->reset ();
+      return;
+    }
+
+    if (this->isBuffered == false)
+    {
+      this->box.bufferData ();
+      this->isBuffered = true;
+    }
+
+    OpenGL::glColorMask (false, false, false, false);
+    OpenGL::glDepthMask (false);
+
+    for (const DynamicMesh* mesh : meshes)
+    {
+      if (mesh->numFaces () < this->minFaces || mesh->isEmpty ())
+      {
+        continue;
+      }
+
+      auto it = this->queries.find (mesh);
+      if (it == this->queries.end ())
+      {
+        Query query{0, 0, false, false};
+        OpenGL::glGenQueries (1, &query.id);
+        it = this->queries.emplace (mesh, query).first;
+      }
+
+      Query&          query = it->second;
+      const PrimAABox bounds = this->worldBounds (*mesh);
+
+      query.frame = this->frame;
+
+      if (this->isTestable (camera, bounds) == false)
+      {
+        query.isOccluded = false;
+      }
+      else if (query.isPending == false)
+      {
+        this->box.position (bounds.center ());
+        this->box.scaling (2.0f * bounds.halfWidth ());
+
+        OpenGL::glBeginQuery (OpenGL::SamplesPassed (), query.id);
+        this->box.render (camera);
+        OpenGL::glEndQuery (OpenGL::SamplesPassed ());
+
+        query.isPending = true;
+      }
+    }
+
+    OpenGL::glColorMask (true, true, true, true);
+    OpenGL::glDepthMask (true);
+
+    for (auto it = this->queries.begin (); it != this->queries.end ();)
+    {
+      if (it->second.frame != this->frame)
+      {
+        OpenGL::glDeleteQueries (1, &it->second.id);
+        it = this->queries.erase (it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+
+  void runFromConfig (const Config& config)
+  {
+    this->isEnabled = config.get<bool> ("editor/mesh/occlusion/enabled");
+    this->minFaces = config.get<int> ("editor/mesh/occlusion/min-faces");
+    this->nearClipping = config.get<float> ("editor/camera/near-clipping");
+  }
+};
+
+DELEGATE1_BIG2_SELF (MeshOcclusion, const Config&)
+DELEGATE1 (bool, MeshOcclusion, isOccluded, const DynamicMesh&)
+DELEGATE2 (void, MeshOcclusion, test, Camera&, const std::vector<const DynamicMesh*>&)
+DELEGATE1 (void, MeshOcclusion, runFromConfig, const Config&)
@@ -0,0 +1,35 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_MESH_OCCLUSION
+#define DILAY_MESH_OCCLUSION
+
+#include <vector>
+#include "configurable.hpp"
+#include "macro.hpp"
+
+class Camera;
+class DynamicMesh;
+
+/* Occlusion culling of dynamic meshes with many faces.  After the visible meshes are rendered, the
+ * bounding box of each mesh is tested against the depth buffer by an occlusion query.  Results are
+ * read one frame later without waiting for them, such that a mesh is skipped if its box was hidden
+ * in the previous frame.  Meshes whose query is still pending keep their previous result.
+ */
+class MeshOcclusion : public Configurable
+{
+public:
+  DECLARE_BIG2 (MeshOcclusion, const Config&)
+
+  bool isOccluded (const DynamicMesh&);
+  // queries the occlusion of the given meshes and drops the queries of all other meshes
+  void test (Camera&, const std::vector<const DynamicMesh*>&);
+
+private:
+  IMPLEMENTATION
+
+  void runFromConfig (const Config&);
+};
+
+#endif
@@ -0,0 +1,73 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cassert>
+#include <glm/glm.hpp>
+#include "mesh-primitives.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "render-mode.hpp"
+#include "util.hpp"
+
+namespace
+{
+  constexpr unsigned int numPrimitives = 5;
+
+  Mesh create (MeshPrimitive primitive)
+  {
+    Mesh mesh;
+
+    switch (primitive)
+    {
+      case MeshPrimitive::SketchSphere:
+        mesh = MeshUtil::icosphere (3);
+        break;
+
+      case MeshPrimitive::SketchBone:
+        mesh = MeshUtil::cone (16);
+        mesh.renderMode ().flatShading (true);
+        mesh.position (glm::vec3 (0.0f, 0.5f, 0.0f));
+        mesh.normalize ();
+        break;
+
+      case MeshPrimitive::CursorSphere:
+        mesh = MeshUtil::icosphere (2);
+        mesh.renderMode ().constantShading (true);
+        break;
+
+      case MeshPrimitive::AxisCone:
+        mesh = MeshUtil::cone (10);
+        mesh.renderMode ().constantShading (true);
+        mesh.renderMode ().cameraRotationOnly (true);
+        break;
+
+      case MeshPrimitive::AxisCylinder:
+        mesh = MeshUtil::cylinder (10);
+        mesh.renderMode ().constantShading (true);
+        mesh.renderMode ().cameraRotationOnly (true);
+        break;
+    }
+    return mesh;
+  }
+}
+
+namespace MeshPrimitives
+{
+  std::shared_ptr<Mesh> get (MeshPrimitive primitive)
+  {
+    static std::weak_ptr<Mesh> primitives[numPrimitives];
+
+    const unsigned int index = (unsigned int) (primitive);
+    assert (index < numPrimitives);
+
+    std::shared_ptr<Mesh> mesh = primitives[index].lock ();
+    if (mesh == nullptr)
+    {
+      mesh = std::make_shared<Mesh> (create (primitive));
+      mesh->bufferData ();
+      primitives[index] = mesh;
+    }
+    return mesh;
+  }
+}
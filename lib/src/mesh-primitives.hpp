@@ -0,0 +1,32 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_MESH_PRIMITIVES
+#define DILAY_MESH_PRIMITIVES
+
+#include <memory>
+
+class Mesh;
+
+enum class MeshPrimitive
+{
+  SketchSphere,
+  SketchBone,
+  CursorSphere,
+  AxisCone,
+  AxisCylinder
+};
+
+/* Primitive meshes that are shared by all of their users, such that their geometry is buffered
+ * once.  A mesh is created on its first request and is destroyed along with its OpenGL buffers
+ * when its last user releases it.  The geometry and render mode of a primitive never change,
+ * whereas users set its transformation and color before rendering it.  Primitives must only be
+ * requested by the thread that owns the OpenGL context.
+ */
+namespace MeshPrimitives
+{
+  std::shared_ptr<Mesh> get (MeshPrimitive);
+}
+
+#endif
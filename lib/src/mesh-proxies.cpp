@@ -0,0 +1,243 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <atomic>
+#include <glm/glm.hpp>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include "camera.hpp"
+#include "config.hpp"
+#include "dynamic/mesh-version.hpp"
+#include "dynamic/mesh.hpp"
+#include "mesh-proxies.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "primitive/aabox.hpp"
+#include "thread-pool.hpp"
+#include "tool/sculpt/util/action.hpp"
+
+namespace
+{
+  struct Proxy
+  {
+    unsigned int revision;
+    Mesh         mesh;
+    bool         isBuffered;
+    glm::vec3    center;
+    float        radius;
+  };
+
+  typedef std::pair<const DynamicMesh*, Proxy>     BuiltProxy;
+  typedef std::shared_ptr<const DynamicMeshVersion> Version;
+
+  struct Job
+  {
+    const DynamicMesh* key;
+    Version            version;
+  };
+}
+
+struct MeshProxies::Impl
+{
+  MeshProxies*                                  self;
+  std::unordered_map<const DynamicMesh*, Proxy> proxies;
+  std::thread                                   thread;
+  std::atomic<bool>                             isBuilt;
+  CancellationToken                             token;
+  std::vector<Job>                              jobs;
+  std::vector<BuiltProxy>                       built;
+  std::mutex                                    releasedMutex;
+  std::vector<Version>                          released;
+  unsigned int                                  minFaces;
+  unsigned int                                  maxFaces;
+  float                                         distantSize;
+
+  Impl (MeshProxies* s, const Config& config)
+    : self (s)
+    , isBuilt (false)
+  {
+    this->runFromConfig (config);
+  }
+
+  ~Impl () { this->cancel (); }
+
+  bool isRunning () const { return this->thread.joinable (); }
+
+  /* The thread hands versions it has read back instead of dropping them, since meshes modify
+   * chunks in place once they are no longer shared (cf. `Mesh::mutableChunk`).  Only dropping
+   * them on this thread orders the thread's reads before those modifications.
+   */
+  void release (Version&& version)
+  {
+    std::lock_guard<std::mutex> lock (this->releasedMutex);
+    this->released.push_back (std::move (version));
+  }
+
+  void dropReleased ()
+  {
+    std::vector<Version> versions;
+    {
+      std::lock_guard<std::mutex> lock (this->releasedMutex);
+      versions.swap (this->released);
+    }
+  }
+
+  // adopts the proxies of a finished build
+  void collect ()
+  {
+    this->dropReleased ();
+
+    if (this->isRunning () && this->isBuilt)
+    {
+      this->thread.join ();
+
+      for (BuiltProxy& b : this->built)
+      {
+        this->proxies[b.first] = std::move (b.second);
+      }
+      this->jobs.clear ();
+      this->built.clear ();
+    }
+  }
+
+  void update (const std::vector<const DynamicMesh*>& meshes)
+  {
+    this->collect ();
+
+    if (this->isRunning ())
+    {
+      return;
+    }
+
+    std::unordered_map<const DynamicMesh*, Proxy> current;
+    for (const DynamicMesh* mesh : meshes)
+    {
+      auto it = this->proxies.find (mesh);
+
+      if (it != this->proxies.end ())
+      {
+        current.emplace (mesh, std::move (it->second));
+      }
+    }
+    this->proxies = std::move (current);
+
+    for (const DynamicMesh* mesh : meshes)
+    {
+      auto it = this->proxies.find (mesh);
+
+      if (mesh->numFaces () >= this->minFaces &&
+          (it == this->proxies.end () || it->second.revision != mesh->revision ()))
+      {
+        this->jobs.push_back (Job{mesh, mesh->version ()});
+      }
+    }
+
+    if (this->jobs.empty () == false)
+    {
+      this->isBuilt = false;
+      this->token.reset ();
+
+      // the thread only touches `jobs` and `built` until it sets `isBuilt`
+      this->thread = std::thread ([this]() {
+        for (Job& job : this->jobs)
+        {
+          if (this->token.isCancelled ())
+          {
+            break;
+          }
+
+          const unsigned int revision = job.version->revision;
+          DynamicMesh        mesh (MeshUtil::compact (job.version->mesh,
+                                                      job.version->freeVertexIndices,
+                                                      job.version->freeFaceIndices));
+          this->release (std::move (job.version));
+
+          if (ToolSculptAction::simplifyMesh (mesh, this->maxFaces, this->token))
+          {
+            mesh.prune ();
+
+            Proxy proxy;
+            proxy.revision = revision;
+            proxy.mesh = mesh.mesh ();
+            proxy.isBuffered = false;
+
+            const PrimAABox bounds = proxy.mesh.bounds ();
+            proxy.center = bounds.center ();
+            proxy.radius = glm::length (bounds.halfWidth ());
+
+            this->built.emplace_back (job.key, std::move (proxy));
+          }
+        }
+        this->isBuilt = true;
+      });
+    }
+  }
+
+  bool isDistant (const Camera& camera, const Proxy& proxy, const Mesh& mesh) const
+  {
+    const glm::vec3 scaling = mesh.scaling ();
+    const glm::vec3 center = glm::vec3 (mesh.modelMatrix () * glm::vec4 (proxy.center, 1.0f));
+    const float     radius = proxy.radius * glm::max (scaling.x, glm::max (scaling.y, scaling.z));
+
+    return radius < this->distantSize * glm::distance (camera.position (), center);
+  }
+
+  bool render (Camera& camera, const DynamicMesh& mesh, bool isNavigating)
+  {
+    this->collect ();
+
+    auto it = this->proxies.find (&mesh);
+
+    if (it == this->proxies.end () || it->second.revision != mesh.revision ())
+    {
+      return false;
+    }
+
+    Proxy& proxy = it->second;
+
+    if (isNavigating || this->isDistant (camera, proxy, mesh.mesh ()))
+    {
+      if (proxy.isBuffered == false)
+      {
+        proxy.mesh.bufferData ();
+        proxy.isBuffered = true;
+      }
+      proxy.mesh.copyNonGeometry (mesh.mesh ());
+      proxy.mesh.render (camera);
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  void cancel ()
+  {
+    if (this->isRunning ())
+    {
+      this->token.cancel ();
+      this->thread.join ();
+      this->jobs.clear ();
+      this->built.clear ();
+    }
+    this->dropReleased ();
+  }
+
+  void runFromConfig (const Config& config)
+  {
+    this->minFaces = config.get<int> ("editor/mesh/proxy/min-faces");
+    this->maxFaces = config.get<int> ("editor/mesh/proxy/max-faces");
+    this->distantSize = config.get<float> ("editor/mesh/proxy/distant-size");
+  }
+};
+
+DELEGATE1_BIG2_SELF (MeshProxies, const Config&)
+DELEGATE1 (void, MeshProxies, update, const std::vector<const DynamicMesh*>&)
+DELEGATE3 (bool, MeshProxies, render, Camera&, const DynamicMesh&, bool)
+DELEGATE (void, MeshProxies, cancel)
+DELEGATE1 (void, MeshProxies, runFromConfig, const Config&)
@@ -0,0 +1,36 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_MESH_PROXIES
+#define DILAY_MESH_PROXIES
+
+#include <vector>
+#include "configurable.hpp"
+#include "macro.hpp"
+
+class Camera;
+class DynamicMesh;
+
+/* Simplified proxies of dynamic meshes with many faces.  A proxy is rendered instead of its mesh
+ * while the camera moves or if the mesh is far away.  Proxies are built by collapsing edges on a
+ * background thread and are only rendered as long as the revision of their mesh is unchanged.
+ */
+class MeshProxies : public Configurable
+{
+public:
+  DECLARE_BIG2 (MeshProxies, const Config&)
+
+  // starts building the missing or outdated proxies of the given meshes, unless a build is running
+  void update (const std::vector<const DynamicMesh*>&);
+  // returns `false` if the mesh has no up-to-date proxy or if its proxy is not to be rendered
+  bool render (Camera&, const DynamicMesh&, bool);
+  void cancel ();
+
+private:
+  IMPLEMENTATION
+
+  void runFromConfig (const Config&);
+};
+
+#endif
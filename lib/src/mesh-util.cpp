@@ -3,117 +3,230 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
-#include <unordered_map>
+#include <tuple>
 #include <vector>
-#include "hash.hpp"
+#include "edge-map.hpp"
 #include "intersection.hpp"
 #include "mesh-util.hpp"
 #include "mesh.hpp"
+#include "parallel.hpp"
+#include "primitive/aabox.hpp"
 #include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
+#include "thread-pool.hpp"
 #include "util.hpp"
 
 namespace
 {
-  struct VertexCache
+  // number of faces that are processed by a single task
+  constexpr unsigned int facesPerChunk = 16384;
+
+  // number of corners that are hashed by a single task, and number of buckets they are hashed to
+  constexpr unsigned int cornersPerChunk = 65536;
+  constexpr unsigned int numWeldBuckets = 4096;
+
+  // bits of a position, where negative zeros are positive
+  glm::uvec3 positionBits (const glm::vec3& position)
   {
-    typedef std::function<unsigned int(unsigned int, unsigned int)> MakeNewVertex;
+    const glm::vec3 p = position + glm::vec3 (0.0f);
+    glm::uvec3      bits;
 
-    std::unordered_map<ui_pair, unsigned int> cache;
+    std::memcpy (&bits, &p, sizeof (p));
+    return bits;
+  }
 
-    unsigned int lookup (unsigned int i1, unsigned int i2, const MakeNewVertex& f)
-    {
-      const ui_pair key = std::make_pair (glm::min (i1, i2), glm::max (i1, i2));
+  unsigned int weldBucket (const glm::vec3& position)
+  {
+    const glm::uvec3   bits = positionBits (position);
+    const unsigned int h = (bits.x * 73856093u) ^ (bits.y * 19349663u) ^ (bits.z * 83492791u);
+
+    return (h ^ (h >> 16)) % numWeldBuckets;
+  }
 
-      const auto it = this->cache.find (key);
-      if (it == this->cache.end ())
+  /* Roots of a forest whose parents are updated concurrently.  Each parent has a smaller index than
+   * its child, such that paths can be halved by any thread without creating cycles.
+   */
+  unsigned int findRoot (std::vector<std::atomic<unsigned int>>& parents, unsigned int i)
+  {
+    while (true)
+    {
+      unsigned int parent = parents[i].load ();
+      if (parent == i)
       {
-        const unsigned int n = f (i1, i2);
-        this->cache.emplace (key, n);
-        return n;
+        return i;
       }
-      else
+      const unsigned int grandParent = parents[parent].load ();
+      if (grandParent != parent)
       {
-        return it->second;
+        parents[i].compare_exchange_weak (parent, grandParent);
       }
+      i = grandParent;
     }
-  };
+  }
 
-  struct EdgeMap
+  void unite (std::vector<std::atomic<unsigned int>>& parents, unsigned int i1, unsigned int i2)
   {
-    EdgeMap (unsigned int numVertices) { this->elements.resize (numVertices - 1); }
-
-    unsigned int* find (unsigned int i1, unsigned int i2)
+    while (true)
     {
-      const unsigned int minI = glm::min (i1, i2);
-      const unsigned int maxI = glm::max (i1, i2);
+      const unsigned int r1 = findRoot (parents, i1);
+      const unsigned int r2 = findRoot (parents, i2);
 
-      if (minI < this->elements.size ())
+      if (r1 == r2)
       {
-        return this->findInSequence (elements[minI], maxI);
+        return;
       }
-      else
+      unsigned int expected = glm::max (r1, r2);
+      if (parents[glm::max (r1, r2)].compare_exchange_strong (expected, glm::min (r1, r2)))
       {
-        return nullptr;
+        return;
       }
     }
+  }
 
-    void add (unsigned int i1, unsigned int i2, const unsigned int& element)
+  /* Vertices of a polyhedron whose faces are subdivided into lattices of `n` segments per edge.
+   * Corners come first, followed by the inner vertices of each edge, which are ordered from its
+   * smaller corner, and then by the inner vertices of each face.  Thus the vertex of each point
+   * of a lattice is known in closed form and faces can be subdivided independently.
+   */
+  struct SubdivisionLattice
+  {
+    typedef std::pair<unsigned int, unsigned int> Edge;
+
+    const unsigned int n;
+    const unsigned int numCorners;
+    const unsigned int numInnerFaceVertices;
+    std::vector<Edge>  edges;
+    EdgeMap            edgeIndices;
+
+    SubdivisionLattice (unsigned int s, const std::vector<unsigned int>& faces,
+                        unsigned int cornersPerFace, unsigned int c, unsigned int innerFaceVertices)
+      : n (s)
+      , numCorners (c)
+      , numInnerFaceVertices (innerFaceVertices)
     {
-      const unsigned int minI = glm::min (i1, i2);
-      const unsigned int maxI = glm::max (i1, i2);
+      for (unsigned int f = 0; f < faces.size (); f += cornersPerFace)
+      {
+        for (unsigned int i = 0; i < cornersPerFace; i++)
+        {
+          const unsigned int c1 = faces[f + i];
+          const unsigned int c2 = faces[f + ((i + 1) % cornersPerFace)];
+          bool               isNew;
+
+          this->edgeIndices.findOrInsert (c1, c2, this->edges.size (), isNew);
+          if (isNew)
+          {
+            this->edges.emplace_back (glm::min (c1, c2), glm::max (c1, c2));
+          }
+        }
+      }
+    }
 
-      assert (minI < this->elements.size ());
-      assert (this->findInSequence (this->elements[minI], maxI) == nullptr);
+    unsigned int numVertices (unsigned int numFaces) const
+    {
+      return this->numCorners + (this->edges.size () * (this->n - 1)) +
+             (numFaces * this->numInnerFaceVertices);
+    }
 
-      if (this->elements[minI].empty ())
+    // vertex `k` of `[0, n]` of the edge from `c1` to `c2`
+    unsigned int edgeVertex (unsigned int c1, unsigned int c2, unsigned int k) const
+    {
+      if (k == 0)
+      {
+        return c1;
+      }
+      else if (k == this->n)
+      {
+        return c2;
+      }
+      else
       {
-        this->elements[minI].reserve (6);
+        const unsigned int e = this->edgeIndices.find (c1, c2);
+        return this->numCorners + (e * (this->n - 1)) + (c1 < c2 ? k : this->n - k) - 1;
       }
-      this->elements[minI].push_back (std::make_pair (maxI, element));
     }
 
-    void increase (unsigned int i1, unsigned int i2)
+    // inner vertex `k` of face `f`
+    unsigned int faceVertex (unsigned int f, unsigned int k) const
     {
-      const unsigned int minI = glm::min (i1, i2);
-      const unsigned int maxI = glm::max (i1, i2);
-
-      assert (minI < this->elements.size ());
+      return this->numCorners + (this->edges.size () * (this->n - 1)) +
+             (f * this->numInnerFaceVertices) + k;
+    }
 
-      unsigned int* value = this->findInSequence (this->elements[minI], maxI);
-      if (value)
+    // vertex of point `(i, j)` of triangle `(c1, c2, c3)`, where `i` runs to `c2` and `j` to `c3`
+    unsigned int triangleVertex (unsigned int f, unsigned int c1, unsigned int c2, unsigned int c3,
+                                 unsigned int i, unsigned int j) const
+    {
+      if (j == 0)
       {
-        (*value)++;
+        return this->edgeVertex (c1, c2, i);
+      }
+      else if (i == 0)
+      {
+        return this->edgeVertex (c1, c3, j);
+      }
+      else if (i + j == this->n)
+      {
+        return this->edgeVertex (c2, c3, j);
       }
       else
       {
-        if (this->elements[minI].empty ())
-        {
-          this->elements[minI].reserve (6);
-        }
-        this->elements[minI].push_back (std::make_pair (maxI, 1));
+        const unsigned int row = ((j - 1) * (this->n - 1)) - (((j - 1) * j) / 2);
+        return this->faceVertex (f, row + i - 1);
       }
     }
 
-    unsigned int* findInSequence (std::vector<std::pair<unsigned int, unsigned int>>& sequence,
-                                  unsigned int                                        i)
+    // vertex of point `(x, y)` of quad `(c1, c2, c3, c4)`, where `x` runs to `c2` and `y` to `c4`
+    unsigned int quadVertex (unsigned int f, unsigned int c1, unsigned int c2, unsigned int c3,
+                             unsigned int c4, unsigned int x, unsigned int y) const
     {
-      for (auto& p : sequence)
+      if (y == 0)
       {
-        if (p.first == i)
-        {
-          return &p.second;
-        }
+        return this->edgeVertex (c1, c2, x);
+      }
+      else if (x == 0)
+      {
+        return this->edgeVertex (c1, c4, y);
+      }
+      else if (x == this->n)
+      {
+        return this->edgeVertex (c2, c3, y);
+      }
+      else if (y == this->n)
+      {
+        return this->edgeVertex (c4, c3, x);
+      }
+      else
+      {
+        return this->faceVertex (f, ((y - 1) * (this->n - 1)) + x - 1);
       }
-      return nullptr;
     }
-
-    std::vector<std::vector<std::pair<unsigned int, unsigned int>>> elements;
   };
 
+  Mesh toMesh (const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& normals,
+               const std::vector<unsigned int>& indices)
+  {
+    Mesh mesh;
+
+    mesh.reserveVertices (vertices.size ());
+    mesh.reserveIndices (indices.size ());
+
+    for (unsigned int i = 0; i < vertices.size (); i++)
+    {
+      mesh.addVertex (vertices[i], normals[i]);
+    }
+    for (unsigned int i : indices)
+    {
+      mesh.addIndex (i);
+    }
+    return mesh;
+  }
+
   Mesh& withDefaultNormals (Mesh& mesh)
   {
     for (unsigned int i = 0; i < mesh.numVertices (); i++)
@@ -122,6 +235,144 @@ namespace
     }
     return mesh;
   }
+
+  // interleaves the lower 10 bits of a number with two zero bits each
+  uint32_t spreadBits (uint32_t x)
+  {
+    x &= 0x3ff;
+    x = (x | (x << 16)) & 0x30000ff;
+    x = (x | (x << 8)) & 0x300f00f;
+    x = (x | (x << 4)) & 0x30c30c3;
+    x = (x | (x << 2)) & 0x9249249;
+    return x;
+  }
+
+  // Morton code of a normalized position in [0,1]^3 on a grid of 1024^3 cells
+  uint32_t mortonCode (const glm::vec3& position)
+  {
+    const glm::uvec3 cell =
+      glm::uvec3 (glm::clamp (position * 1024.0f, glm::vec3 (0.0f), glm::vec3 (1023.0f)));
+
+    return spreadBits (cell.x) | (spreadBits (cell.y) << 1) | (spreadBits (cell.z) << 2);
+  }
+
+  // number of vertices in the post-transform cache that faces are ordered for
+  constexpr unsigned int vertexCacheSize = 16;
+
+  /* Orders faces for a vertex cache by Tipsify (Sander et al.: Fast Triangle Reordering for
+   * Vertex Locality and Reduced Overdraw, 2007).  Faces are emitted in fans around vertices that
+   * are likely to be still cached.  At dead ends it continues with recently used vertices, and
+   * then with the next vertex in index order, so that the order of the vertices is kept at large.
+   */
+  std::vector<unsigned int> tipsify (const std::vector<unsigned int>& indices,
+                                     unsigned int                     numVertices)
+  {
+    const unsigned int numFaces = indices.size () / 3;
+
+    // faces of each vertex
+    std::vector<unsigned int> offsets (numVertices + 1, 0);
+    std::vector<unsigned int> adjacentFaces (indices.size ());
+
+    for (unsigned int i : indices)
+    {
+      offsets[i + 1]++;
+    }
+    for (unsigned int v = 0; v < numVertices; v++)
+    {
+      offsets[v + 1] += offsets[v];
+    }
+    {
+      std::vector<unsigned int> next (offsets.begin (), offsets.end () - 1);
+      for (unsigned int i = 0; i < indices.size (); i++)
+      {
+        adjacentFaces[next[indices[i]]++] = i / 3;
+      }
+    }
+
+    std::vector<unsigned int> numLiveFaces (numVertices);
+    for (unsigned int v = 0; v < numVertices; v++)
+    {
+      numLiveFaces[v] = offsets[v + 1] - offsets[v];
+    }
+
+    std::vector<unsigned int>  cacheTimes (numVertices, 0);
+    std::vector<unsigned char> isEmitted (numFaces, 0);
+    std::vector<unsigned int>  deadEnds;
+    std::vector<unsigned int>  candidates;
+    std::vector<unsigned int>  order;
+    unsigned int               time = vertexCacheSize + 1;
+    unsigned int               cursor = 0;
+    unsigned int               fan = numVertices > 0 ? 0 : Util::invalidIndex ();
+
+    order.reserve (numFaces);
+
+    while (fan != Util::invalidIndex ())
+    {
+      candidates.clear ();
+      for (unsigned int a = offsets[fan]; a < offsets[fan + 1]; a++)
+      {
+        const unsigned int f = adjacentFaces[a];
+
+        if (isEmitted[f] == 0)
+        {
+          isEmitted[f] = 1;
+          order.push_back (f);
+
+          for (unsigned int i = 3 * f; i < (3 * f) + 3; i++)
+          {
+            const unsigned int v = indices[i];
+
+            deadEnds.push_back (v);
+            candidates.push_back (v);
+            numLiveFaces[v]--;
+
+            if (time - cacheTimes[v] > vertexCacheSize)
+            {
+              cacheTimes[v] = time++;
+            }
+          }
+        }
+      }
+
+      // prefers the vertex that entered the cache first among those whose fans still fit in it
+      int bestPriority = -1;
+      fan = Util::invalidIndex ();
+
+      for (unsigned int v : candidates)
+      {
+        if (numLiveFaces[v] > 0)
+        {
+          const unsigned int age = time - cacheTimes[v];
+          const int          priority =
+            age + (2 * numLiveFaces[v]) <= vertexCacheSize ? int(age) : 0;
+
+          if (priority > bestPriority)
+          {
+            bestPriority = priority;
+            fan = v;
+          }
+        }
+      }
+      while (fan == Util::invalidIndex () && deadEnds.empty () == false)
+      {
+        if (numLiveFaces[deadEnds.back ()] > 0)
+        {
+          fan = deadEnds.back ();
+        }
+        deadEnds.pop_back ();
+      }
+      while (fan == Util::invalidIndex () && cursor < numVertices)
+      {
+        if (numLiveFaces[cursor] > 0)
+        {
+          fan = cursor;
+        }
+        cursor++;
+      }
+    }
+    assert (order.size () == numFaces);
+    return order;
+  }
 }
 
 void MeshUtil::addFace (Mesh& mesh, unsigned int i1, unsigned int i2, unsigned int i3)
@@ -142,97 +393,88 @@ void MeshUtil::addFace (Mesh& mesh, unsigned int i1, unsigned int i2, unsigned i
   mesh.addIndex (i3);
 }
 
+/* Faces of the cube are subdivided into lattices of `4^numSubdivisions` quads, whose positions are
+ * interpolated in closed form.  Each quad is split along the diagonal through the center of the
+ * quad it would have been subdivided from recursively.
+ */
 Mesh MeshUtil::cube (unsigned int numSubdivisions)
 {
-  Mesh        mesh;
-  VertexCache vertexCache;
-
-  const auto addStartVertex = [&mesh](const glm::vec3& v) -> unsigned int {
-    return mesh.addVertex (v, glm::normalize (v));
-  };
-
-  const auto addRefinedVertex = [&mesh](unsigned int i1, unsigned int i2) -> unsigned int {
-    return mesh.addVertex (Util::midpoint (mesh.vertex (i1), mesh.vertex (i2)));
-  };
-
-  std::function<void(unsigned int, unsigned int, unsigned int, unsigned int, unsigned int)>
-    subdivide = [&mesh, &subdivide, &addRefinedVertex,
-                 &vertexCache](unsigned int s, unsigned int i1, unsigned int i2, unsigned int i3,
-                               unsigned int i4) -> void {
-    if (s == 0)
+  const std::vector<glm::vec3> corners = {
+    glm::vec3 (-0.5f, -0.5f, -0.5f), glm::vec3 (-0.5f, -0.5f, +0.5f),
+    glm::vec3 (-0.5f, +0.5f, -0.5f), glm::vec3 (-0.5f, +0.5f, +0.5f),
+    glm::vec3 (+0.5f, -0.5f, -0.5f), glm::vec3 (+0.5f, -0.5f, +0.5f),
+    glm::vec3 (+0.5f, +0.5f, -0.5f), glm::vec3 (+0.5f, +0.5f, +0.5f)};
+  const std::vector<unsigned int> faces = {0, 1, 3, 2, 1, 5, 7, 3, 5, 4, 6, 7,
+                                           4, 0, 2, 6, 3, 7, 6, 2, 0, 4, 5, 1};
+
+  const unsigned int       n = 1 << numSubdivisions;
+  const unsigned int       numFaces = faces.size () / 4;
+  const SubdivisionLattice lattice (n, faces, 4, corners.size (), (n - 1) * (n - 1));
+
+  std::vector<glm::vec3>    vertices (lattice.numVertices (numFaces));
+  std::vector<glm::vec3>    normals (vertices.size ());
+  std::vector<unsigned int> indices (6 * n * n * numFaces);
+
+  const auto subdivideEdge = [&](unsigned int e) {
+    const unsigned int c1 = lattice.edges[e].first;
+    const unsigned int c2 = lattice.edges[e].second;
+
+    for (unsigned int k = 1; k < n; k++)
     {
-      MeshUtil::addFace (mesh, i1, i2, i3);
-      MeshUtil::addFace (mesh, i1, i3, i4);
-    }
-    else
-    {
-      const glm::vec3    v1 = mesh.vertex (i1);
-      const glm::vec3    v2 = mesh.vertex (i2);
-      const glm::vec3    v3 = mesh.vertex (i3);
-      const glm::vec3    v4 = mesh.vertex (i4);
-      const unsigned int iC = mesh.addVertex ((v1 + v2 + v3 + v4) / 4.0f);
-      const unsigned int i12 = vertexCache.lookup (i1, i2, addRefinedVertex);
-      const unsigned int i23 = vertexCache.lookup (i2, i3, addRefinedVertex);
-      const unsigned int i34 = vertexCache.lookup (i3, i4, addRefinedVertex);
-      const unsigned int i41 = vertexCache.lookup (i4, i1, addRefinedVertex);
-
-      subdivide (s - 1, i1, i12, iC, i41);
-      subdivide (s - 1, i2, i23, iC, i12);
-      subdivide (s - 1, i3, i34, iC, i23);
-      subdivide (s - 1, i4, i41, iC, i34);
+      vertices[lattice.edgeVertex (c1, c2, k)] =
+        corners[c1] + ((float(k) / float(n)) * (corners[c2] - corners[c1]));
     }
   };
 
-  addStartVertex (glm::vec3 (-0.5f, -0.5f, -0.5f));
-  addStartVertex (glm::vec3 (-0.5f, -0.5f, +0.5f));
-  addStartVertex (glm::vec3 (-0.5f, +0.5f, -0.5f));
-  addStartVertex (glm::vec3 (-0.5f, +0.5f, +0.5f));
-  addStartVertex (glm::vec3 (+0.5f, -0.5f, -0.5f));
-  addStartVertex (glm::vec3 (+0.5f, -0.5f, +0.5f));
-  addStartVertex (glm::vec3 (+0.5f, +0.5f, -0.5f));
-  addStartVertex (glm::vec3 (+0.5f, +0.5f, +0.5f));
-
-  subdivide (numSubdivisions, 0, 1, 3, 2);
-  subdivide (numSubdivisions, 1, 5, 7, 3);
-  subdivide (numSubdivisions, 5, 4, 6, 7);
-  subdivide (numSubdivisions, 4, 0, 2, 6);
-  subdivide (numSubdivisions, 3, 7, 6, 2);
-  subdivide (numSubdivisions, 0, 4, 5, 1);
+  const auto subdivideFace = [&](unsigned int f) {
+    const unsigned int* c = &faces[4 * f];
+    const glm::vec3     dx = (corners[c[1]] - corners[c[0]]) / float(n);
+    const glm::vec3     dy = (corners[c[3]] - corners[c[0]]) / float(n);
+    unsigned int        i = 6 * n * n * f;
 
-  for (unsigned int i = 0; i < mesh.numVertices (); i++)
-  {
-    const glm::vec3& vertex = mesh.vertex (i);
-    glm::vec3        normal = glm::vec3 (0.0f);
-
-    if (Util::almostEqual (vertex.x, 0.5f))
-    {
-      normal.x = 1.0f;
-    }
-    else if (Util::almostEqual (vertex.x, -0.5f))
+    for (unsigned int y = 0; y < n; y++)
     {
-      normal.x = -1.0f;
-    }
+      for (unsigned int x = 0; x < n; x++)
+      {
+        const unsigned int quad[] = {lattice.quadVertex (f, c[0], c[1], c[2], c[3], x, y),
+                                     lattice.quadVertex (f, c[0], c[1], c[2], c[3], x + 1, y),
+                                     lattice.quadVertex (f, c[0], c[1], c[2], c[3], x + 1, y + 1),
+                                     lattice.quadVertex (f, c[0], c[1], c[2], c[3], x, y + 1)};
+        const unsigned int first = (n == 1 || x % 2 == y % 2) ? 0 : 1;
 
-    if (Util::almostEqual (vertex.y, 0.5f))
-    {
-      normal.y = 1.0f;
-    }
-    else if (Util::almostEqual (vertex.y, -0.5f))
-    {
-      normal.y = -1.0f;
+        if (x > 0 && y > 0)
+        {
+          vertices[quad[0]] = corners[c[0]] + (float(x) * dx) + (float(y) * dy);
+        }
+        for (unsigned int k : {0, 1, 2, 0, 2, 3})
+        {
+          indices[i++] = quad[(first + k) % 4];
+        }
+      }
     }
+  };
 
-    if (Util::almostEqual (vertex.z, 0.5f))
-    {
-      normal.z = 1.0f;
-    }
-    else if (Util::almostEqual (vertex.z, -0.5f))
+  std::copy (corners.begin (), corners.end (), vertices.begin ());
+  Parallel::forEach (lattice.edges.size (), subdivideEdge, 1);
+  Parallel::forEach (numFaces, subdivideFace, 1);
+
+  Parallel::forEach (vertices.size (), [&vertices, &normals](unsigned int i) {
+    glm::vec3 normal (0.0f);
+
+    for (unsigned int d = 0; d < 3; d++)
     {
-      normal.z = -1.0f;
+      if (Util::almostEqual (vertices[i][d], 0.5f))
+      {
+        normal[d] = 1.0f;
+      }
+      else if (Util::almostEqual (vertices[i][d], -0.5f))
+      {
+        normal[d] = -1.0f;
+      }
     }
-    mesh.normal (i, glm::normalize (normal));
-  }
-  return mesh;
+    normals[i] = glm::normalize (normal);
+  });
+  return toMesh (vertices, normals, indices);
 }
 
 Mesh MeshUtil::sphere (unsigned int rings, unsigned int sectors)
@@ -288,83 +530,111 @@ Mesh MeshUtil::sphere (unsigned int rings, unsigned int sectors)
   return withDefaultNormals (mesh);
 }
 
+/* Faces of the icosahedron are subdivided into lattices of `4^numSubdivisions` triangles.  Level
+ * by level, each new vertex is the normalized midpoint of its two neighbors of the previous level,
+ * as if triangles were subdivided recursively.  Edges are subdivided first, after which each face
+ * is subdivided independently.
+ */
 Mesh MeshUtil::icosphere (unsigned int numSubdivisions)
 {
-  Mesh        mesh;
-  VertexCache vertexCache;
-
-  const auto addStartVertex = [&mesh](const glm::vec3& v) -> unsigned int {
-    return mesh.addVertex (glm::normalize (v), glm::normalize (v));
+  const float                  t = (1.0f + glm::sqrt (5.0f)) * 0.5f;
+  const std::vector<glm::vec3> corners = {
+    glm::vec3 (-1.0f, +t, 0.0f), glm::vec3 (+1.0f, +t, 0.0f), glm::vec3 (-1.0f, -t, 0.0f),
+    glm::vec3 (+1.0f, -t, 0.0f), glm::vec3 (0.0f, -1.0f, +t), glm::vec3 (0.0f, +1.0f, +t),
+    glm::vec3 (0.0f, -1.0f, -t), glm::vec3 (0.0f, +1.0f, -t), glm::vec3 (+t, 0.0f, -1.0f),
+    glm::vec3 (+t, 0.0f, +1.0f), glm::vec3 (-t, 0.0f, -1.0f), glm::vec3 (-t, 0.0f, +1.0f)};
+  const std::vector<unsigned int> faces = {
+    0, 11, 5, 0, 5,  1, 0,  1,  7, 0,  7, 10, 0, 10, 11, 1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6,
+    7, 1,  8, 3, 9,  4, 3,  4,  2, 3,  2, 6,  3, 6,  8,  3, 8, 9, 4, 9,  5, 2,  4,  11, 6, 2, 10,
+    8, 6,  7, 9, 8,  1};
+
+  const unsigned int       n = 1 << numSubdivisions;
+  const unsigned int       numFaces = faces.size () / 3;
+  const SubdivisionLattice lattice (n, faces, 3, corners.size (), ((n - 1) * (n - 2)) / 2);
+
+  std::vector<glm::vec3>    vertices (lattice.numVertices (numFaces));
+  std::vector<glm::vec3>    normals (vertices.size ());
+  std::vector<unsigned int> indices (3 * n * n * numFaces);
+
+  const auto midpoint = [&vertices](unsigned int i1, unsigned int i2) {
+    return glm::normalize (Util::midpoint (vertices[i1], vertices[i2]));
   };
 
-  const auto addRefinedVertex = [&mesh](unsigned int i1, unsigned int i2) -> unsigned int {
-    const glm::vec3 pos = glm::normalize (Util::midpoint (mesh.vertex (i1), mesh.vertex (i2)));
-    const glm::vec3 normal = glm::normalize (pos);
-    return mesh.addVertex (pos, normal);
-  };
+  const auto subdivideEdge = [&](unsigned int e) {
+    const unsigned int c1 = lattice.edges[e].first;
+    const unsigned int c2 = lattice.edges[e].second;
 
-  std::function<void(unsigned int, unsigned int, unsigned int, unsigned int)> subdivide =
-    [&mesh, &subdivide, &addRefinedVertex, &vertexCache](unsigned int s, unsigned int i1,
-                                                         unsigned int i2, unsigned int i3) -> void {
-    if (s == 0)
+    for (unsigned int h = n / 2; h > 0; h /= 2)
     {
-      MeshUtil::addFace (mesh, i1, i2, i3);
+      for (unsigned int k = h; k < n; k += 2 * h)
+      {
+        vertices[lattice.edgeVertex (c1, c2, k)] =
+          midpoint (lattice.edgeVertex (c1, c2, k - h), lattice.edgeVertex (c1, c2, k + h));
+      }
     }
-    else
+  };
+
+  const auto subdivideFace = [&](unsigned int f) {
+    const unsigned int* c = &faces[3 * f];
+    const auto          vertex = [&](unsigned int i, unsigned int j) {
+      return lattice.triangleVertex (f, c[0], c[1], c[2], i, j);
+    };
+    unsigned int index = 3 * n * n * f;
+
+    for (unsigned int h = n / 2; h > 0; h /= 2)
     {
-      const unsigned int i12 = vertexCache.lookup (i1, i2, addRefinedVertex);
-      const unsigned int i23 = vertexCache.lookup (i2, i3, addRefinedVertex);
-      const unsigned int i31 = vertexCache.lookup (i3, i1, addRefinedVertex);
+      for (unsigned int j = h; j < n; j += h)
+      {
+        for (unsigned int i = h; i + j < n; i += h)
+        {
+          const bool isOddI = (i / h) % 2 == 1;
+          const bool isOddJ = (j / h) % 2 == 1;
 
-      subdivide (s - 1, i1, i12, i31);
-      subdivide (s - 1, i2, i23, i12);
-      subdivide (s - 1, i3, i31, i23);
-      subdivide (s - 1, i12, i23, i31);
+          if (isOddI && isOddJ)
+          {
+            vertices[vertex (i, j)] = midpoint (vertex (i + h, j - h), vertex (i - h, j + h));
+          }
+          else if (isOddI)
+          {
+            vertices[vertex (i, j)] = midpoint (vertex (i - h, j), vertex (i + h, j));
+          }
+          else if (isOddJ)
+          {
+            vertices[vertex (i, j)] = midpoint (vertex (i, j - h), vertex (i, j + h));
+          }
+        }
+      }
+    }
+    for (unsigned int j = 0; j < n; j++)
+    {
+      for (unsigned int i = 0; i + j < n; i++)
+      {
+        for (unsigned int v : {vertex (i, j), vertex (i + 1, j), vertex (i, j + 1)})
+        {
+          indices[index++] = v;
+        }
+        if (i + j + 1 < n)
+        {
+          for (unsigned int v : {vertex (i + 1, j), vertex (i + 1, j + 1), vertex (i, j + 1)})
+          {
+            indices[index++] = v;
+          }
+        }
+      }
     }
   };
 
-  const float t = (1.0f + glm::sqrt (5.0f)) * 0.5f;
-
-  addStartVertex (glm::vec3 (-1.0f, +t, 0.0f));
-  addStartVertex (glm::vec3 (+1.0f, +t, 0.0f));
-  addStartVertex (glm::vec3 (-1.0f, -t, 0.0f));
-  addStartVertex (glm::vec3 (+1.0f, -t, 0.0f));
-
-  addStartVertex (glm::vec3 (0.0f, -1.0f, +t));
-  addStartVertex (glm::vec3 (0.0f, +1.0f, +t));
-  addStartVertex (glm::vec3 (0.0f, -1.0f, -t));
-  addStartVertex (glm::vec3 (0.0f, +1.0f, -t));
-
-  addStartVertex (glm::vec3 (+t, 0.0f, -1.0f));
-  addStartVertex (glm::vec3 (+t, 0.0f, +1.0f));
-  addStartVertex (glm::vec3 (-t, 0.0f, -1.0f));
-  addStartVertex (glm::vec3 (-t, 0.0f, +1.0f));
-
-  subdivide (numSubdivisions, 0, 11, 5);
-  subdivide (numSubdivisions, 0, 5, 1);
-  subdivide (numSubdivisions, 0, 1, 7);
-  subdivide (numSubdivisions, 0, 7, 10);
-  subdivide (numSubdivisions, 0, 10, 11);
-
-  subdivide (numSubdivisions, 1, 5, 9);
-  subdivide (numSubdivisions, 5, 11, 4);
-  subdivide (numSubdivisions, 11, 10, 2);
-  subdivide (numSubdivisions, 10, 7, 6);
-  subdivide (numSubdivisions, 7, 1, 8);
-
-  subdivide (numSubdivisions, 3, 9, 4);
-  subdivide (numSubdivisions, 3, 4, 2);
-  subdivide (numSubdivisions, 3, 2, 6);
-  subdivide (numSubdivisions, 3, 6, 8);
-  subdivide (numSubdivisions, 3, 8, 9);
-
-  subdivide (numSubdivisions, 4, 9, 5);
-  subdivide (numSubdivisions, 2, 4, 11);
-  subdivide (numSubdivisions, 6, 2, 10);
-  subdivide (numSubdivisions, 8, 6, 7);
-  subdivide (numSubdivisions, 9, 8, 1);
+  for (unsigned int i = 0; i < corners.size (); i++)
+  {
+    vertices[i] = glm::normalize (corners[i]);
+  }
+  Parallel::forEach (lattice.edges.size (), subdivideEdge, 1);
+  Parallel::forEach (numFaces, subdivideFace, 1);
+  Parallel::forEach (vertices.size (), [&vertices, &normals](unsigned int i) {
+    normals[i] = glm::normalize (vertices[i]);
+  });
 
-  return mesh;
+  return toMesh (vertices, normals, indices);
 }
 
 Mesh MeshUtil::cone (unsigned int numBaseVertices)
@@ -454,7 +724,7 @@ Mesh MeshUtil::mirror (const Mesh& mesh, const PrimPlane& plane)
   std::vector<Side>       sides;
   std::vector<BorderFlag> borderFlags;
   std::vector<ui_pair>    newIndices;
-  EdgeMap                 newBorderVertices (mesh.numVertices ());
+  EdgeMap                 newBorderVertices;
 
   auto updateBorderFlag = [&borderFlags](unsigned int i, Side side) {
     BorderFlag& current = borderFlags[i];
@@ -488,11 +758,11 @@ Mesh MeshUtil::mirror (const Mesh& mesh, const PrimPlane& plane)
 
   auto newBorderVertex = [&mesh, &plane, &newBorderVertices, &m](unsigned int i1,
                                                                  unsigned int i2) -> unsigned int {
-    const unsigned int* existentIndex = newBorderVertices.find (i1, i2);
+    const unsigned int existentIndex = newBorderVertices.find (i1, i2);
 
-    if (existentIndex)
+    if (existentIndex != Util::invalidIndex ())
     {
-      return *existentIndex;
+      return existentIndex;
     }
     else
     {
@@ -513,7 +783,7 @@ Mesh MeshUtil::mirror (const Mesh& mesh, const PrimPlane& plane)
       }
       const unsigned int newIndex = m.addVertex (position);
 
-      newBorderVertices.add (i1, i2, newIndex);
+      newBorderVertices.insert (i1, i2, newIndex);
       return newIndex;
     }
   };
@@ -747,54 +1017,644 @@ Mesh MeshUtil::mirror (const Mesh& mesh, const PrimPlane& plane)
   return m;
 }
 
+/* Each face writes its half-edges into a sorted run of its chunk, and the runs are merged
+ * pairwise.  A mesh is consistent if each half-edge is unique and has an opposite half-edge,
+ * i.e., each edge is shared by exactly two consistently oriented faces.  Since each face has a
+ * single half-edge that starts at each of its vertices, the number of faces that are adjacent to
+ * a vertex is the length of its run of half-edges.
+ */
 bool MeshUtil::checkConsistency (const Mesh& mesh)
 {
-  if (mesh.numVertices () == 0)
+  const unsigned int numVertices = mesh.numVertices ();
+  const unsigned int numFaces = mesh.numIndices () / 3;
+
+  if (numVertices == 0)
   {
     DILAY_WARN ("empty mesh");
     return false;
   }
-  EdgeMap                   numEdgeAdjacentFaces (mesh.numVertices ());
-  std::vector<unsigned int> numVertexAdjacentFaces;
-  numVertexAdjacentFaces.resize (mesh.numVertices (), 0);
+
+  std::vector<std::uint64_t> halfEdges (3 * numFaces);
+  std::vector<unsigned int>  invalid ((numFaces + facesPerChunk - 1) / facesPerChunk,
+                                     Util::invalidIndex ());
+
+  const auto source = [&halfEdges](unsigned int h) { return (unsigned int) (halfEdges[h] >> 32); };
+  const auto target = [&halfEdges](unsigned int h) { return (unsigned int) (halfEdges[h]); };
+
+  const auto checkFace = [&mesh, numVertices](unsigned int f, bool warn) {
+    const unsigned int i1 = mesh.index ((3 * f) + 0);
+    const unsigned int i2 = mesh.index ((3 * f) + 1);
+    const unsigned int i3 = mesh.index ((3 * f) + 2);
+
+    if (i1 >= numVertices || i2 >= numVertices || i3 >= numVertices || i1 == i2 || i1 == i3 ||
+        i2 == i3)
+    {
+      if (warn)
+      {
+        DILAY_WARN ("inconsistent face %u with vertices (%u,%u,%u)", f, i1, i2, i3);
+      }
+      return false;
+    }
+    return true;
+  };
+
+  const auto checkHalfEdge = [&](unsigned int h, bool warn) {
+    const unsigned int s = source (h);
+    const unsigned int t = target (h);
+
+    if (h == 0 ? s != 0 : (s != source (h - 1) && s != source (h - 1) + 1))
+    {
+      if (warn)
+      {
+        const unsigned int v = h == 0 ? 0 : source (h - 1) + 1;
+        DILAY_WARN ("inconsistent vertex %u with 0 adjacent faces", v);
+      }
+      return false;
+    }
+    else if (h + 1 == halfEdges.size () && s + 1 != numVertices)
+    {
+      if (warn)
+      {
+        DILAY_WARN ("inconsistent vertex %u with 0 adjacent faces", s + 1);
+      }
+      return false;
+    }
+    else if ((h == 0 || s != source (h - 1)) && (h + 2 >= halfEdges.size () || s != source (h + 2)))
+    {
+      if (warn)
+      {
+        const unsigned int n = h + 1 < halfEdges.size () && s == source (h + 1) ? 2 : 1;
+        DILAY_WARN ("inconsistent vertex %u with %u adjacent faces", s, n);
+      }
+      return false;
+    }
+    else if (h + 1 < halfEdges.size () && halfEdges[h] == halfEdges[h + 1])
+    {
+      if (warn)
+      {
+        DILAY_WARN ("inconsistent edge (%u,%u) with more than 2 adjacent faces", s, t);
+      }
+      return false;
+    }
+    else if (std::binary_search (halfEdges.begin (), halfEdges.end (),
+                                 (std::uint64_t (t) << 32) | s) == false)
+    {
+      if (warn)
+      {
+        DILAY_WARN ("inconsistent edge (%u,%u) without opposite half-edge", s, t);
+      }
+      return false;
+    }
+    return true;
+  };
+
+  // returns the first invalid element of all chunks after warning about it
+  const auto report = [&invalid](const std::function<bool(unsigned int, bool)>& check) {
+    for (unsigned int i : invalid)
+    {
+      if (i != Util::invalidIndex ())
+      {
+        check (i, true);
+        return false;
+      }
+    }
+    return true;
+  };
+
+  ThreadPool::global ().parallelFor (
+    numFaces, facesPerChunk, [&](unsigned int first, unsigned int last) {
+      for (unsigned int f = first; f < last; f++)
+      {
+        if (checkFace (f, false) == false)
+        {
+          invalid[first / facesPerChunk] = f;
+          return;
+        }
+        for (unsigned int k = 0; k < 3; k++)
+        {
+          const std::uint64_t s = mesh.index ((3 * f) + k);
+          const std::uint64_t t = mesh.index ((3 * f) + ((k + 1) % 3));
+
+          halfEdges[(3 * f) + k] = (s << 32) | t;
+        }
+      }
+      std::sort (halfEdges.begin () + (3 * first), halfEdges.begin () + (3 * last));
+    });
+
+  if (report (checkFace) == false)
+  {
+    return false;
+  }
+
+  const unsigned int numHalfEdges = halfEdges.size ();
+  for (unsigned int width = 3 * facesPerChunk; width < numHalfEdges; width *= 2)
+  {
+    const unsigned int numMerges = (numHalfEdges + (2 * width) - 1) / (2 * width);
+
+    ThreadPool::global ().parallelFor (numMerges, 1, [&](unsigned int first, unsigned int last) {
+      for (unsigned int m = first; m < last; m++)
+      {
+        const unsigned int begin = 2 * m * width;
+        const unsigned int mid = glm::min (begin + width, numHalfEdges);
+        const unsigned int end = glm::min (begin + (2 * width), numHalfEdges);
+
+        std::inplace_merge (halfEdges.begin () + begin, halfEdges.begin () + mid,
+                            halfEdges.begin () + end);
+      }
+    });
+  }
+
+  if (numHalfEdges == 0)
+  {
+    DILAY_WARN ("inconsistent vertex 0 with 0 adjacent faces");
+    return false;
+  }
+
+  invalid.assign ((numHalfEdges + (3 * facesPerChunk) - 1) / (3 * facesPerChunk),
+                  Util::invalidIndex ());
+
+  ThreadPool::global ().parallelFor (
+    numHalfEdges, 3 * facesPerChunk, [&](unsigned int first, unsigned int last) {
+      for (unsigned int h = first; h < last; h++)
+      {
+        if (checkHalfEdge (h, false) == false)
+        {
+          invalid[first / (3 * facesPerChunk)] = h;
+          return;
+        }
+      }
+    });
+
+  return report (checkHalfEdge);
+}
+
+void MeshUtil::setNormals (Mesh& mesh)
+{
+  std::vector<glm::vec3> normals (mesh.numVertices (), glm::vec3 (0.0f));
 
   for (unsigned int i = 0; i < mesh.numIndices (); i += 3)
   {
     const unsigned int i1 = mesh.index (i + 0);
     const unsigned int i2 = mesh.index (i + 1);
     const unsigned int i3 = mesh.index (i + 2);
+    const glm::vec3    n = glm::cross (mesh.vertex (i2) - mesh.vertex (i1),
+                                       mesh.vertex (i3) - mesh.vertex (i1));
+
+    normals[i1] += n;
+    normals[i2] += n;
+    normals[i3] += n;
+  }
+
+  for (unsigned int i = 0; i < mesh.numVertices (); i++)
+  {
+    const float length = glm::length (normals[i]);
 
-    numVertexAdjacentFaces[i1]++;
-    numVertexAdjacentFaces[i2]++;
-    numVertexAdjacentFaces[i3]++;
+    mesh.normal (i, length > Util::epsilon () ? normals[i] / length : glm::vec3 (0.0f));
+  }
+}
+
+Mesh MeshUtil::compact (const Mesh& mesh, const std::vector<unsigned int>& freeVertexIndices,
+                        const std::vector<unsigned int>& freeFaceIndices)
+{
+  std::vector<unsigned int>  vertexIndexMap (mesh.numVertices (), 0);
+  std::vector<unsigned char> isFreeFace (mesh.numIndices () / 3, 0);
+  Mesh                       m;
 
-    numEdgeAdjacentFaces.increase (i1, i2);
-    numEdgeAdjacentFaces.increase (i1, i3);
-    numEdgeAdjacentFaces.increase (i2, i3);
+  m.copyNonGeometry (mesh);
+
+  for (unsigned int i : freeVertexIndices)
+  {
+    vertexIndexMap[i] = Util::invalidIndex ();
+  }
+  for (unsigned int i : freeFaceIndices)
+  {
+    isFreeFace[i] = 1;
   }
 
-  for (unsigned int v = 0; v < numVertexAdjacentFaces.size (); v++)
+  m.reserveVertices (mesh.numVertices () - freeVertexIndices.size ());
+  for (unsigned int i = 0; i < mesh.numVertices (); i++)
   {
-    if (numVertexAdjacentFaces[v] < 3)
+    if (vertexIndexMap[i] != Util::invalidIndex ())
     {
-      DILAY_WARN ("inconsistent vertex %u with %u adjacent faces", v, numVertexAdjacentFaces[v]);
-      return false;
+      vertexIndexMap[i] = m.addVertex (mesh.vertex (i), mesh.normal (i));
     }
   }
 
-  for (unsigned int i = 0; i < numEdgeAdjacentFaces.elements.size (); i++)
+  m.reserveIndices (mesh.numIndices () - (3 * freeFaceIndices.size ()));
+  for (unsigned int f = 0; f < isFreeFace.size (); f++)
   {
-    for (const auto& pair : numEdgeAdjacentFaces.elements[i])
+    if (isFreeFace[f] == 0)
     {
-      const unsigned int j = pair.first;
-      const unsigned int value = pair.second;
+      for (unsigned int i = 3 * f; i < (3 * f) + 3; i++)
+      {
+        assert (vertexIndexMap[mesh.index (i)] != Util::invalidIndex ());
+        m.addIndex (vertexIndexMap[mesh.index (i)]);
+      }
+    }
+  }
+  return m;
+}
 
-      if (value != 2)
+std::vector<Mesh> MeshUtil::components (const Mesh& mesh)
+{
+  const unsigned int numVertices = mesh.numVertices ();
+  const unsigned int numFaces = mesh.numIndices () / 3;
+
+  std::vector<std::atomic<unsigned int>> parents (numVertices);
+  std::vector<unsigned int>              roots (numVertices);
+
+  ThreadPool::global ().parallelFor (
+    numVertices, facesPerChunk, [&](unsigned int first, unsigned int last) {
+      for (unsigned int i = first; i < last; i++)
       {
-        DILAY_WARN ("inconsistent edge (%u,%u) with %u adjacent faces", i, j, value);
-        return false;
+        parents[i].store (i);
+      }
+    });
+  ThreadPool::global ().parallelFor (
+    numFaces, facesPerChunk, [&](unsigned int first, unsigned int last) {
+      for (unsigned int f = first; f < last; f++)
+      {
+        unite (parents, mesh.index ((3 * f) + 0), mesh.index ((3 * f) + 1));
+        unite (parents, mesh.index ((3 * f) + 0), mesh.index ((3 * f) + 2));
+      }
+    });
+  ThreadPool::global ().parallelFor (
+    numVertices, facesPerChunk, [&](unsigned int first, unsigned int last) {
+      for (unsigned int i = first; i < last; i++)
+      {
+        roots[i] = findRoot (parents, i);
+      }
+    });
+
+  // the root of a component is its vertex with the smallest index, which is labelled first
+  std::vector<unsigned int>  labels (numVertices);
+  std::vector<unsigned int>  indexMap (numVertices);
+  std::vector<unsigned char> isUsed (numVertices, 0);
+  std::vector<unsigned int>  numComponentVertices;
+  std::vector<unsigned int>  numComponentFaces;
+
+  for (unsigned int i = 0; i < mesh.numIndices (); i++)
+  {
+    isUsed[mesh.index (i)] = 1;
+  }
+  for (unsigned int i = 0; i < numVertices; i++)
+  {
+    if (isUsed[i] == 0)
+    {
+      labels[i] = Util::invalidIndex ();
+    }
+    else
+    {
+      if (roots[i] == i)
+      {
+        labels[i] = numComponentVertices.size ();
+        numComponentVertices.push_back (0);
+        numComponentFaces.push_back (0);
+      }
+      else
+      {
+        labels[i] = labels[roots[i]];
+      }
+      indexMap[i] = numComponentVertices[labels[i]]++;
+    }
+  }
+  for (unsigned int f = 0; f < numFaces; f++)
+  {
+    numComponentFaces[labels[mesh.index (3 * f)]]++;
+  }
+
+  std::vector<Mesh> components (numComponentVertices.size ());
+  for (unsigned int c = 0; c < components.size (); c++)
+  {
+    components[c].copyNonGeometry (mesh);
+    components[c].reserveVertices (numComponentVertices[c]);
+    components[c].reserveIndices (3 * numComponentFaces[c]);
+  }
+  for (unsigned int i = 0; i < numVertices; i++)
+  {
+    if (labels[i] != Util::invalidIndex ())
+    {
+      components[labels[i]].addVertex (mesh.vertex (i), mesh.normal (i));
+    }
+  }
+  for (unsigned int i = 0; i < mesh.numIndices (); i++)
+  {
+    components[labels[mesh.index (i)]].addIndex (indexMap[mesh.index (i)]);
+  }
+  return components;
+}
+
+Mesh MeshUtil::subdivide (const Mesh& mesh)
+{
+  const unsigned int numVertices = mesh.numVertices ();
+  const unsigned int numFaces = mesh.numIndices () / 3;
+
+  if (numFaces == 0)
+  {
+    return mesh;
+  }
+
+  // an edge with a single adjacent face has no second opposite vertex
+  struct Edge
+  {
+    unsigned int i1, i2;
+    unsigned int opposite1, opposite2;
+  };
+
+  EdgeMap                   edgeMap;
+  std::vector<Edge>         edges;
+  std::vector<unsigned int> faceEdges (3 * numFaces);
+
+  edgeMap.reserve ((3 * numFaces) / 2);
+  edges.reserve ((3 * numFaces) / 2);
+  for (unsigned int f = 0; f < numFaces; f++)
+  {
+    for (unsigned int j = 0; j < 3; j++)
+    {
+      const unsigned int i1 = mesh.index ((3 * f) + j);
+      const unsigned int i2 = mesh.index ((3 * f) + ((j + 1) % 3));
+      const unsigned int opposite = mesh.index ((3 * f) + ((j + 2) % 3));
+
+      bool               inserted;
+      const unsigned int e = edgeMap.findOrInsert (i1, i2, edges.size (), inserted);
+
+      if (inserted)
+      {
+        edges.push_back (Edge{i1, i2, opposite, Util::invalidIndex ()});
+      }
+      else
+      {
+        edges[e].opposite2 = opposite;
+      }
+      faceEdges[(3 * f) + j] = e;
+    }
+  }
+
+  // border vertices are only smoothed along the border
+  std::vector<glm::vec3>    neighbourSums (numVertices, glm::vec3 (0.0f));
+  std::vector<glm::vec3>    borderSums (numVertices, glm::vec3 (0.0f));
+  std::vector<unsigned int> valences (numVertices, 0);
+  std::vector<unsigned int> borderValences (numVertices, 0);
+
+  for (const Edge& e : edges)
+  {
+    neighbourSums[e.i1] += mesh.vertex (e.i2);
+    neighbourSums[e.i2] += mesh.vertex (e.i1);
+    valences[e.i1]++;
+    valences[e.i2]++;
+
+    if (e.opposite2 == Util::invalidIndex ())
+    {
+      borderSums[e.i1] += mesh.vertex (e.i2);
+      borderSums[e.i2] += mesh.vertex (e.i1);
+      borderValences[e.i1]++;
+      borderValences[e.i2]++;
+    }
+  }
+
+  std::vector<glm::vec3> positions (numVertices + edges.size ());
+
+  ThreadPool::global ().parallelFor (
+    numVertices, facesPerChunk, [&](unsigned int first, unsigned int last) {
+      for (unsigned int i = first; i < last; i++)
+      {
+        const glm::vec3& v = mesh.vertex (i);
+
+        if (borderValences[i] == 2)
+        {
+          positions[i] = (0.75f * v) + (0.125f * borderSums[i]);
+        }
+        else if (borderValences[i] > 0 || valences[i] < 3)
+        {
+          positions[i] = v;
+        }
+        else
+        {
+          const float n = (float) valences[i];
+          const float c = 0.375f + (0.25f * glm::cos (2.0f * glm::pi<float> () / n));
+          const float beta = (0.625f - (c * c)) / n;
+
+          positions[i] = ((1.0f - (n * beta)) * v) + (beta * neighbourSums[i]);
+        }
+      }
+    });
+
+  ThreadPool::global ().parallelFor (
+    edges.size (), facesPerChunk, [&](unsigned int first, unsigned int last) {
+      for (unsigned int i = first; i < last; i++)
+      {
+        const Edge&     e = edges[i];
+        const glm::vec3 v = mesh.vertex (e.i1) + mesh.vertex (e.i2);
+
+        if (e.opposite2 == Util::invalidIndex ())
+        {
+          positions[numVertices + i] = 0.5f * v;
+        }
+        else
+        {
+          positions[numVertices + i] =
+            (0.375f * v) + (0.125f * (mesh.vertex (e.opposite1) + mesh.vertex (e.opposite2)));
+        }
+      }
+    });
+
+  Mesh m;
+  m.copyNonGeometry (mesh);
+  m.reserveVertices (positions.size ());
+  m.reserveIndices (4 * mesh.numIndices ());
+
+  for (const glm::vec3& p : positions)
+  {
+    m.addVertex (p);
+  }
+  for (unsigned int f = 0; f < numFaces; f++)
+  {
+    const unsigned int i1 = mesh.index ((3 * f) + 0);
+    const unsigned int i2 = mesh.index ((3 * f) + 1);
+    const unsigned int i3 = mesh.index ((3 * f) + 2);
+    const unsigned int e12 = numVertices + faceEdges[(3 * f) + 0];
+    const unsigned int e23 = numVertices + faceEdges[(3 * f) + 1];
+    const unsigned int e31 = numVertices + faceEdges[(3 * f) + 2];
+
+    MeshUtil::addFace (m, i1, e12, e31);
+    MeshUtil::addFace (m, e12, i2, e23);
+    MeshUtil::addFace (m, e31, e23, i3);
+    MeshUtil::addFace (m, e12, e23, e31);
+  }
+  MeshUtil::setNormals (m);
+  return m;
+}
+
+Mesh MeshUtil::optimizeLayout (const Mesh& mesh)
+{
+  const unsigned int numFaces = mesh.numIndices () / 3;
+
+  if (numFaces == 0)
+  {
+    return mesh;
+  }
+
+  const PrimAABox bounds = mesh.bounds ();
+  const glm::vec3 extent = glm::max (bounds.maximum () - bounds.minimum (),
+                                     glm::vec3 (Util::epsilon ()));
+
+  std::vector<std::pair<uint32_t, unsigned int>> codes (numFaces);
+  ThreadPool::global ().parallelFor (numFaces, facesPerChunk,
+                                     [&mesh, &bounds, &extent, &codes](unsigned int begin,
+                                                                       unsigned int end) {
+                                       for (unsigned int f = begin; f < end; f++)
+                                       {
+                                         const glm::vec3 center =
+                                           (mesh.vertex (mesh.index (3 * f)) +
+                                            mesh.vertex (mesh.index ((3 * f) + 1)) +
+                                            mesh.vertex (mesh.index ((3 * f) + 2))) /
+                                           3.0f;
+                                         codes[f] = std::make_pair (
+                                           mortonCode ((center - bounds.minimum ()) / extent), f);
+                                       }
+                                     });
+  Parallel::sort (codes, std::less<std::pair<uint32_t, unsigned int>> ());
+
+  // vertices are numbered by their first use along the curve, which `tipsify` follows at large
+  std::vector<unsigned int> curveIndexMap (mesh.numVertices (), Util::invalidIndex ());
+  std::vector<unsigned int> curveVertices;
+  std::vector<unsigned int> curveIndices;
+
+  curveIndices.reserve (3 * numFaces);
+  for (const auto& code : codes)
+  {
+    for (unsigned int i = 3 * code.second; i < (3 * code.second) + 3; i++)
+    {
+      const unsigned int v = mesh.index (i);
+
+      if (curveIndexMap[v] == Util::invalidIndex ())
+      {
+        curveIndexMap[v] = curveVertices.size ();
+        curveVertices.push_back (v);
+      }
+      curveIndices.push_back (curveIndexMap[v]);
+    }
+  }
+
+  const std::vector<unsigned int> order = tipsify (curveIndices, curveVertices.size ());
+  std::vector<unsigned int>       indexMap (curveVertices.size (), Util::invalidIndex ());
+  Mesh                            m;
+
+  m.copyNonGeometry (mesh);
+  m.reserveVertices (curveVertices.size ());
+  m.reserveIndices (3 * numFaces);
+
+  for (unsigned int f : order)
+  {
+    for (unsigned int i = 3 * f; i < (3 * f) + 3; i++)
+    {
+      const unsigned int v = curveIndices[i];
+
+      if (indexMap[v] == Util::invalidIndex ())
+      {
+        indexMap[v] = m.addVertex (mesh.vertex (curveVertices[v]), mesh.normal (curveVertices[v]));
+      }
+      m.addIndex (indexMap[v]);
+    }
+  }
+  return m;
+}
+
+/* Corners are sorted into buckets by a hash of their positions, which keeps them in order within
+ * each bucket.  The buckets are then sorted by position in parallel, such that each corner is
+ * represented by the first corner at its position.  Vertices are numbered by their first use.
+ */
+Mesh MeshUtil::weld (const std::vector<glm::vec3>& corners)
+{
+  const unsigned int        numCorners = corners.size () - (corners.size () % 3);
+  const unsigned int        numChunks = (numCorners + cornersPerChunk - 1) / cornersPerChunk;
+  std::vector<unsigned int> buckets (numCorners);
+  std::vector<unsigned int> offsets (numChunks * numWeldBuckets, 0);
+  std::vector<unsigned int> bucketBegins (numWeldBuckets + 1);
+  std::vector<unsigned int> sorted (numCorners);
+  std::vector<unsigned int> representatives (numCorners);
+
+  ThreadPool::global ().parallelFor (
+    numCorners, cornersPerChunk, [&](unsigned int first, unsigned int last) {
+      unsigned int* counts = &offsets[(first / cornersPerChunk) * numWeldBuckets];
+
+      for (unsigned int c = first; c < last; c++)
+      {
+        buckets[c] = weldBucket (corners[c]);
+        counts[buckets[c]]++;
+      }
+    });
+
+  unsigned int offset = 0;
+  for (unsigned int b = 0; b < numWeldBuckets; b++)
+  {
+    bucketBegins[b] = offset;
+    for (unsigned int k = 0; k < numChunks; k++)
+    {
+      const unsigned int count = offsets[(k * numWeldBuckets) + b];
+
+      offsets[(k * numWeldBuckets) + b] = offset;
+      offset += count;
+    }
+  }
+  bucketBegins[numWeldBuckets] = offset;
+
+  ThreadPool::global ().parallelFor (
+    numCorners, cornersPerChunk, [&](unsigned int first, unsigned int last) {
+      unsigned int* chunkOffsets = &offsets[(first / cornersPerChunk) * numWeldBuckets];
+
+      for (unsigned int c = first; c < last; c++)
+      {
+        sorted[chunkOffsets[buckets[c]]++] = c;
+      }
+    });
+
+  ThreadPool::global ().parallelFor (numWeldBuckets, 1, [&](unsigned int first, unsigned int last) {
+    for (unsigned int b = first; b < last; b++)
+    {
+      const auto begin = sorted.begin () + bucketBegins[b];
+      const auto end = sorted.begin () + bucketBegins[b + 1];
+
+      std::sort (begin, end, [&corners](unsigned int i, unsigned int j) {
+        const glm::uvec3 bi = positionBits (corners[i]);
+        const glm::uvec3 bj = positionBits (corners[j]);
+
+        return std::tie (bi.x, bi.y, bi.z, i) < std::tie (bj.x, bj.y, bj.z, j);
+      });
+
+      for (auto it = begin; it != end; ++it)
+      {
+        const bool isWelded =
+          it != begin && positionBits (corners[*it]) == positionBits (corners[*(it - 1)]);
+
+        representatives[*it] = isWelded ? representatives[*(it - 1)] : *it;
+      }
+    }
+  });
+
+  Mesh                       mesh;
+  std::vector<unsigned int>& vertexIndices = buckets;
+
+  std::fill (vertexIndices.begin (), vertexIndices.end (), Util::invalidIndex ());
+  mesh.reserveIndices (numCorners);
+
+  for (unsigned int f = 0; f < numCorners / 3; f++)
+  {
+    const unsigned int r1 = representatives[(3 * f) + 0];
+    const unsigned int r2 = representatives[(3 * f) + 1];
+    const unsigned int r3 = representatives[(3 * f) + 2];
+
+    if (r1 != r2 && r1 != r3 && r2 != r3)
+    {
+      for (unsigned int r : {r1, r2, r3})
+      {
+        if (vertexIndices[r] == Util::invalidIndex ())
+        {
+          vertexIndices[r] = mesh.addVertex (corners[r]);
+        }
+        mesh.addIndex (vertexIndices[r]);
       }
     }
   }
-  return true;
+  return mesh;
 }
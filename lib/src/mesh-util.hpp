@@ -5,6 +5,9 @@
 #ifndef DILAY_MESH_UTIL
 #define DILAY_MESH_UTIL
 
+#include <glm/fwd.hpp>
+#include <vector>
+
 class Mesh;
 class PrimPlane;
 
@@ -21,6 +24,22 @@ namespace MeshUtil
 
   Mesh mirror (const Mesh&, const PrimPlane&);
   bool checkConsistency (const Mesh&);
+  // sets the normal of each vertex to the area-weighted average of its adjacent face normals
+  void setNormals (Mesh&);
+  // copies a mesh without the given free vertices and faces, cf. `DynamicMesh::prune`
+  Mesh compact (const Mesh&, const std::vector<unsigned int>&, const std::vector<unsigned int>&);
+  // splits a mesh into its connected components, which are ordered by their smallest vertex
+  std::vector<Mesh> components (const Mesh&);
+  // splits each face into four faces and smooths the result by Loop's scheme
+  Mesh subdivide (const Mesh&);
+  /* Orders faces along a space-filling curve and then for the vertex cache of the GPU, and
+   * numbers vertices by their first use.  Vertices without faces are dropped.
+   */
+  Mesh optimizeLayout (const Mesh&);
+  /* Makes a mesh of a triangle soup, i.e., three corners per face, by welding corners at equal
+   * positions.  Faces that degenerate are dropped.
+   */
+  Mesh weld (const std::vector<glm::vec3>&);
 };
 
 #endif
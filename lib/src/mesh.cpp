@@ -2,118 +2,1004 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include "camera.hpp"
 #include "color.hpp"
+#include "mapped-memory.hpp"
+#include "memory-report.hpp"
+#include "mesh-instances.hpp"
 #include "mesh.hpp"
 #include "opengl-buffer-id.hpp"
+#include "opengl-upload.hpp"
 #include "opengl.hpp"
 #include "primitive/aabox.hpp"
 #include "render-mode.hpp"
 #include "renderer.hpp"
+#include "thread-pool.hpp"
 #include "util.hpp"
 
 namespace
 {
   static_assert (sizeof (glm::vec3) == 3 * sizeof (float), "Unexpected memory layout");
 
-  template <typename T> struct BufferedData
+  constexpr unsigned int numStreamRegions = 3;
+
+  // revisions are unique among all meshes, such that a revision identifies the data of a mesh
+  unsigned int nextRevision ()
+  {
+    static std::atomic<unsigned int> revision (0);
+    return ++revision;
+  }
+
+  struct BufferRegion
+  {
+    unsigned int  version;     // modifications up to `version` have been written to the region
+    unsigned int  lowerChunk;  // range of chunks that have been modified since
+    unsigned int  upperChunk;
+    mutable void* fence;       // set when the region has been used for rendering
+
+    BufferRegion ()
+      : version (0)
+      , fence (nullptr)
+    {
+      this->resetChunks ();
+    }
+
+    void resetChunks ()
+    {
+      this->lowerChunk = Util::maxUnsignedInt ();
+      this->upperChunk = 0;
+    }
+
+    void addChunk (unsigned int chunk)
+    {
+      this->lowerChunk = glm::min (this->lowerChunk, chunk);
+      this->upperChunk = glm::max (this->upperChunk, chunk);
+    }
+  };
+
+  /* OpenGL buffer of `BufferedData`.  If persistently mapped buffers are supported, the buffer
+   * consists of `numStreamRegions` regions that are written in turn, so that a region is only
+   * written once the GPU has finished rendering from it.  Otherwise there is a single region that
+   * is written with `glBufferSubData`.  Copies have no OpenGL buffer, cf. `OpenGLBufferId`.
+   * Large buffers are initially written by `OpenGLUploader`, and the buffer is not rendered from
+   * before its upload is complete.
+   */
+  struct BufferStorage
   {
     OpenGLBufferId id;
-    std::vector<T> data;
-    unsigned int   dataLowerBound;
-    unsigned int   dataUpperBound;
-    unsigned int   bufferSize;
+    unsigned int   regionSize;
+    unsigned int   numRegions;
+    unsigned int   current;
+    char*          mapped;
+    BufferRegion   regions[numStreamRegions];
 
-    BufferedData () { this->reset (); }
+    std::shared_ptr<OpenGLUpload> upload;
+
+    BufferStorage () { this->init (); }
+    BufferStorage (const BufferStorage&)
+      : BufferStorage ()
+    {
+    }
+
+    BufferStorage& operator= (const BufferStorage&)
+    {
+      this->reset ();
+      return *this;
+    }
+
+    ~BufferStorage () { this->reset (); }
+
+    void init ()
+    {
+      this->regionSize = 0;
+      this->numRegions = 1;
+      this->current = 0;
+      this->mapped = nullptr;
+
+      for (BufferRegion& region : this->regions)
+      {
+        region = BufferRegion ();
+      }
+    }
 
     void reset ()
     {
+      this->finishUpload ();
+
+      for (BufferRegion& region : this->regions)
+      {
+        OpenGL::safeDeleteSync (region.fence);
+      }
       this->id.reset ();
-      this->data.clear ();
-      this->resetBounds ();
-      this->bufferSize = 0;
+      this->init ();
+    }
+
+    bool isAllocated () const
+    {
+      return this->id.isValid () && (this->numRegions == 1 || this->mapped != nullptr);
+    }
+
+    bool isUploading () const { return this->upload && this->upload->isComplete () == false; }
+
+    // waits for a pending upload and takes over its mapping
+    void finishUpload ()
+    {
+      if (this->upload)
+      {
+        char* uploadMapped = this->upload->wait ();
+
+        if (this->numRegions > 1)
+        {
+          this->mapped = uploadMapped;
+        }
+        this->upload.reset ();
+      }
+    }
+
+    BufferRegion& currentRegion () { return this->regions[this->current]; }
+
+    unsigned int currentOffset () const { return this->current * this->regionSize; }
+
+    std::size_t numBytes () const
+    {
+      if (this->id.isValid () == false)
+      {
+        return 0;
+      }
+      else if (this->numRegions == 1)
+      {
+        return this->regionSize;
+      }
+      else
+      {
+        return this->numRegions * std::size_t (glm::max (1u, this->regionSize));
+      }
+    }
+
+    void allocate (unsigned int target, unsigned int size)
+    {
+      this->reset ();
+      this->id.allocate ();
+      this->regionSize = size;
+      OpenGL::glBindBuffer (target, this->id.id ());
+
+      if (OpenGL::hasBufferStorage ())
+      {
+        const unsigned int flags =
+          OpenGL::MapWriteBit () | OpenGL::MapPersistentBit () | OpenGL::MapCoherentBit ();
+
+        const unsigned int storageSize = numStreamRegions * glm::max (1u, size);
+
+        this->numRegions = numStreamRegions;
+        OpenGL::glBufferStorage (target, storageSize, nullptr, flags);
+        this->mapped =
+          static_cast<char*> (OpenGL::glMapBufferRange (target, 0, storageSize, flags));
+
+        if (this->mapped == nullptr)
+        {
+          DILAY_PANIC ("could not map OpenGL buffer")
+        }
+      }
+      else
+      {
+        OpenGL::glBufferData (target, size, nullptr, OpenGL::StaticDraw ());
+      }
+    }
+
+    // allocates and writes the buffer in the background, or returns `false` if it is too small
+    bool allocateInBackground (unsigned int size, OpenGLUpload::Fill&& fill)
+    {
+      if (OpenGLUploader::handles (size) == false)
+      {
+        return false;
+      }
+      this->reset ();
+      this->id.allocate ();
+      this->regionSize = size;
+      this->numRegions = OpenGL::hasBufferStorage () ? numStreamRegions : 1;
+      this->upload =
+        OpenGLUploader::upload (this->id.id (), size, this->numRegions, std::move (fill));
+      return true;
+    }
+
+    // makes the next region current and waits until it is no longer used for rendering
+    void nextRegion (unsigned int target)
+    {
+      this->current = (this->current + 1) % this->numRegions;
+
+      BufferRegion& region = this->currentRegion ();
+      OpenGL::waitSync (region.fence);
+      OpenGL::safeDeleteSync (region.fence);
+      OpenGL::glBindBuffer (target, this->id.id ());
+    }
+
+    void write (unsigned int target, unsigned int offset, unsigned int size, const void* data)
+    {
+      assert (offset + size <= this->regionSize);
+
+      if (this->mapped)
+      {
+        std::memcpy (this->mapped + this->currentOffset () + offset, data, size);
+      }
+      else
+      {
+        OpenGL::glBufferSubData (target, offset, size, data);
+      }
+    }
+
+    // must be called after rendering from the current region
+    void fence () const
+    {
+      if (this->numRegions > 1)
+      {
+        const BufferRegion& region = this->regions[this->current];
+
+        OpenGL::safeDeleteSync (region.fence);
+        region.fence = OpenGL::glFenceSync (OpenGL::SyncGpuCommandsComplete (), 0);
+      }
+    }
+  };
+
+  /* OpenGL vertex array object of a mesh.  Its attribute state is only set up again if the
+   * buffers have been reallocated or if other regions or attributes are rendered than before.
+   * Copies have no vertex array object.
+   */
+  struct VertexArray
+  {
+    unsigned int id;
+    bool         isSetUp;
+    const void*  vertexOffset;
+    const void*  normalOffset;
+    bool         withNormals;
+
+    VertexArray ()
+      : id (0)
+      , isSetUp (false)
+      , vertexOffset (nullptr)
+      , normalOffset (nullptr)
+      , withNormals (false)
+    {
+    }
+
+    VertexArray (const VertexArray&)
+      : VertexArray ()
+    {
+    }
+
+    VertexArray& operator= (const VertexArray&)
+    {
+      this->reset ();
+      return *this;
+    }
+
+    ~VertexArray () { this->reset (); }
+
+    void invalidate () { this->isSetUp = false; }
+
+    void reset ()
+    {
+      OpenGL::safeDeleteVertexArray (this->id);
+      this->invalidate ();
+    }
+
+    // binds the vertex array and returns `true` if its attribute state must be set up
+    bool bind (const void* vOffset, const void* nOffset, bool n)
+    {
+      if (this->id == 0)
+      {
+        OpenGL::glGenVertexArrays (1, &this->id);
+        this->invalidate ();
+      }
+      OpenGL::glBindVertexArray (this->id);
+
+      if (this->isSetUp && this->vertexOffset == vOffset && this->withNormals == n &&
+          (n == false || this->normalOffset == nOffset))
+      {
+        return false;
+      }
+      else
+      {
+        this->isSetUp = true;
+        this->vertexOffset = vOffset;
+        this->normalOffset = nOffset;
+        this->withNormals = n;
+        return true;
+      }
+    }
+  };
+
+  /* Elements that are stored in chunks of `chunkSize` elements.  Copies share their chunks until
+   * a chunk is modified, such that copying and then modifying a few elements only duplicates the
+   * affected chunks.
+   */
+  template <typename T, unsigned int chunkSize> class SharedChunks
+  {
+  public:
+    typedef MappedVector<T> Chunk;
+
+    SharedChunks ()
+      : _size (0)
+    {
+    }
+
+    unsigned int size () const { return this->_size; }
+
+    unsigned int numChunks () const { return this->chunks.size (); }
+
+    const Chunk& chunk (unsigned int c) const
+    {
+      assert (c < this->numChunks ());
+      return *this->chunks[c];
+    }
+
+    const T& get (unsigned int i) const
+    {
+      assert (i < this->_size);
+      return (*this->chunks[i / chunkSize])[i % chunkSize];
+    }
+
+    void set (unsigned int i, const T& value)
+    {
+      assert (i < this->_size);
+      this->mutableChunk (i / chunkSize)[i % chunkSize] = value;
+    }
+
+    void push_back (const T& value)
+    {
+      if (this->_size % chunkSize == 0)
+      {
+        this->chunks.push_back (std::make_shared<Chunk> ());
+        this->chunks.back ()->reserve (chunkSize);
+      }
+      this->mutableChunk (this->numChunks () - 1).push_back (value);
+      this->_size++;
+    }
+
+    void shrink (unsigned int n)
+    {
+      assert (n <= this->_size);
+
+      this->chunks.resize ((n + chunkSize - 1) / chunkSize);
+      if (n % chunkSize != 0)
+      {
+        this->mutableChunk (this->numChunks () - 1).resize (n % chunkSize);
+      }
+      this->_size = n;
+    }
+
+    void reserve (unsigned int n) { this->chunks.reserve ((n + chunkSize - 1) / chunkSize); }
+
+    // replaces each element of chunk `c` by `f (element)`, so distinct chunks may run in parallel
+    template <typename F> void transformChunk (unsigned int c, const F& f)
+    {
+      for (T& value : this->mutableChunk (c))
+      {
+        value = f (static_cast<const T&> (value));
+      }
+    }
+
+    void clear ()
+    {
+      this->chunks.clear ();
+      this->_size = 0;
+    }
+
+    // chunks that are shared with copies are divided among them
+    std::size_t numBytes () const
+    {
+      std::size_t n = this->chunks.capacity () * sizeof (std::shared_ptr<Chunk>);
+
+      for (const std::shared_ptr<Chunk>& chunk : this->chunks)
+      {
+        n += (chunk->capacity () * sizeof (T)) / std::size_t (chunk.use_count ());
+      }
+      return n;
+    }
+
+  private:
+    std::vector<std::shared_ptr<Chunk>> chunks;
+    unsigned int                        _size;
+
+    // duplicates a chunk before its first modification if it is shared with a copy
+    Chunk& mutableChunk (unsigned int c)
+    {
+      assert (c < this->numChunks ());
+
+      if (this->chunks[c].use_count () > 1)
+      {
+        this->chunks[c] = std::make_shared<Chunk> (*this->chunks[c]);
+      }
+      return *this->chunks[c];
+    }
+  };
+
+  // writes elements to OpenGL buffers as they are
+  template <typename T> struct PlainFormat
+  {
+    unsigned int elementSize () const { return sizeof (T); }
+
+    const void* encode (const MappedVector<T>& elements, std::vector<char>&) const
+    {
+      return elements.data ();
+    }
+  };
+
+  /* Writes unit vectors in octahedral encoding as two normalized 16-bit integers, which are
+   * decoded by `DECODE_NORMAL` in the shaders.
+   */
+  struct OctahedralFormat
+  {
+    unsigned int elementSize () const { return 2 * sizeof (std::int16_t); }
+
+    static std::int16_t quantize (float v)
+    {
+      return std::int16_t (glm::round (glm::clamp (v, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    const void* encode (const MappedVector<glm::vec3>& elements, std::vector<char>& buffer) const
+    {
+      buffer.resize (elements.size () * this->elementSize ());
+
+      std::int16_t* encoded = reinterpret_cast<std::int16_t*> (buffer.data ());
+
+      for (unsigned int i = 0; i < elements.size (); i++)
+      {
+        const glm::vec3& n = elements[i];
+        const float      l1 = glm::abs (n.x) + glm::abs (n.y) + glm::abs (n.z);
+        glm::vec2        e = l1 > 0.0f ? glm::vec2 (n.x, n.y) / l1 : glm::vec2 (0.0f);
+
+        if (n.z < 0.0f)
+        {
+          e = (1.0f - glm::abs (glm::vec2 (e.y, e.x))) *
+              glm::vec2 (e.x >= 0.0f ? 1.0f : -1.0f, e.y >= 0.0f ? 1.0f : -1.0f);
+        }
+        encoded[(2 * i) + 0] = quantize (e.x);
+        encoded[(2 * i) + 1] = quantize (e.y);
+      }
+      return buffer.data ();
+    }
+  };
+
+  // writes indices as 16-bit integers if `isShort` is set
+  struct IndexFormat
+  {
+    bool isShort;
+
+    IndexFormat ()
+      : isShort (false)
+    {
+    }
+
+    unsigned int elementSize () const
+    {
+      return this->isShort ? sizeof (std::uint16_t) : sizeof (unsigned int);
+    }
+
+    unsigned int type () const
+    {
+      return this->isShort ? OpenGL::UnsignedShort () : OpenGL::UnsignedInt ();
     }
 
-    void resetBounds ()
+    const void* encode (const MappedVector<unsigned int>& elements,
+                        std::vector<char>&                buffer) const
+    {
+      if (this->isShort)
+      {
+        buffer.resize (elements.size () * this->elementSize ());
+
+        std::uint16_t* encoded = reinterpret_cast<std::uint16_t*> (buffer.data ());
+
+        for (unsigned int i = 0; i < elements.size (); i++)
+        {
+          assert (elements[i] <= Util::maxUnsignedShort ());
+          encoded[i] = std::uint16_t (elements[i]);
+        }
+        return buffer.data ();
+      }
+      else
+      {
+        return elements.data ();
+      }
+    }
+  };
+
+  /* Data that is mirrored in an OpenGL buffer.  Modifications are tracked per chunk of
+   * `chunkSize` elements, so that only dirty chunks are written to the current region of the
+   * buffer.  Neighbouring dirty chunks that are separated by at most `maxChunkGap` clean chunks
+   * are written at once.  The data is stored in shared chunks of the same size, so copies of a
+   * mesh share unmodified chunks.  Elements are written to the buffer in the encoding of `Format`.
+   */
+  template <typename T, typename Format = PlainFormat<T>> struct BufferedData
+  {
+    static constexpr unsigned int chunkSize = 1024;
+    static constexpr unsigned int maxChunkGap = 4;
+
+    SharedChunks<T, chunkSize> data;
+    std::vector<unsigned int> chunkVersions;
+    unsigned int              version;
+    BufferStorage             storage;
+    Format                    format;
+    mutable bool              isRevised;  // modified since the last revision of the mesh
+
+    BufferedData () { this->reset (); }
+
+    void reset ()
     {
-      this->dataLowerBound = Util::maxUnsignedInt ();
-      this->dataUpperBound = 0;
+      this->isRevised = true;
+      this->data.clear ();
+      this->chunkVersions.clear ();
+      this->version = 1;
+      this->storage.reset ();
     }
 
     unsigned int numElements () const { return this->data.size (); }
 
+    unsigned int numChunks () const { return (this->numElements () + chunkSize - 1) / chunkSize; }
+
     void reserve (unsigned int size) { this->data.reserve (size); }
 
+    // the remaining elements are unchanged, so no chunk has to be written again
     void shrink (unsigned int n)
     {
       assert (n <= this->numElements ());
-      this->data.resize (n);
-      this->dataLowerBound = 0;
-      this->dataUpperBound = n > 0 ? n - 1 : 0;
+      this->data.shrink (n);
+      this->isRevised = true;
     }
 
-    void updateBounds (unsigned int index)
+    void markDirty (unsigned int index)
     {
-      this->dataLowerBound = glm::min (this->dataLowerBound, index);
-      this->dataUpperBound = glm::max (this->dataUpperBound, index);
+      const unsigned int chunk = index / chunkSize;
+
+      this->isRevised = true;
+
+      if (chunk >= this->chunkVersions.size ())
+      {
+        this->chunkVersions.resize (chunk + 1, 0);
+      }
+      this->chunkVersions[chunk] = this->version;
+
+      for (BufferRegion& region : this->storage.regions)
+      {
+        region.addChunk (chunk);
+      }
     }
 
     unsigned int add (const T& value)
     {
       this->data.push_back (value);
-      this->updateBounds (this->numElements () - 1);
+      this->markDirty (this->numElements () - 1);
       return this->numElements () - 1;
     }
 
     void set (unsigned int index, const T& value)
     {
       assert (index < this->numElements ());
-      this->data[index] = value;
-      this->updateBounds (index);
+      this->data.set (index, value);
+      this->markDirty (index);
+    }
+
+    /* Replaces each element by `f (element)`.  Chunks are marked dirty first and are then
+     * transformed in parallel.
+     */
+    template <typename F> void transform (const F& f)
+    {
+      for (unsigned int c = 0; c < this->numChunks (); c++)
+      {
+        this->markDirty (c * chunkSize);
+      }
+      ThreadPool::global ().parallelFor (this->numChunks (), 1,
+                                         [this, &f](unsigned int begin, unsigned int end) {
+                                           for (unsigned int c = begin; c < end; c++)
+                                           {
+                                             this->data.transformChunk (c, f);
+                                           }
+                                         });
     }
 
     const T& get (unsigned int index) const
     {
       assert (index < this->numElements ());
-      return this->data[index];
+      return this->data.get (index);
     }
 
-    void bufferData (unsigned int target)
+    // returns `true` if the chunk of an element has been modified since the last `bufferData`
+    bool isModified (unsigned int index) const
     {
-      if (this->id.isValid () == false)
+      const unsigned int chunk = index / chunkSize;
+
+      return chunk < this->chunkVersions.size () && this->chunkVersions[chunk] >= this->version;
+    }
+
+    bool isModified () const
+    {
+      for (unsigned int v : this->chunkVersions)
       {
-        this->id.allocate ();
-        this->bufferSize = 0;
+        if (v >= this->version)
+        {
+          return true;
+        }
       }
-      OpenGL::glBindBuffer (target, this->id.id ());
+      return false;
+    }
 
-      const unsigned int dataSize = this->numElements () * sizeof (T);
+    // writes the elements of chunks `[firstChunk, endChunk)`
+    void writeChunks (unsigned int target, unsigned int firstChunk, unsigned int endChunk)
+    {
+      const unsigned int elementSize = this->format.elementSize ();
+      std::vector<char>  buffer;
 
-      if (this->bufferSize == 0)
+      for (unsigned int c = firstChunk; c < glm::min (endChunk, this->numChunks ()); c++)
       {
-        OpenGL::glBufferData (target, dataSize, this->data.data (), OpenGL::StaticDraw ());
-        this->bufferSize = dataSize;
+        const MappedVector<T>& chunk = this->data.chunk (c);
+
+        if (chunk.empty () == false)
+        {
+          this->storage.write (target, c * chunkSize * elementSize, chunk.size () * elementSize,
+                               this->format.encode (chunk, buffer));
+        }
       }
-      else if (this->bufferSize < dataSize)
+    }
+
+    // writes all elements in the encoding of `format` to a copy of the chunks
+    OpenGLUpload::Fill fill () const
+    {
+      const SharedChunks<T, chunkSize> chunks (this->data);
+      const Format                     f (this->format);
+
+      return [chunks, f](char* buffer) {
+        const unsigned int elementSize = f.elementSize ();
+        std::vector<char>  encoded;
+
+        for (unsigned int c = 0; c < chunks.numChunks (); c++)
+        {
+          const MappedVector<T>& chunk = chunks.chunk (c);
+
+          if (chunk.empty () == false)
+          {
+            std::memcpy (buffer + (c * chunkSize * elementSize), f.encode (chunk, encoded),
+                         chunk.size () * elementSize);
+          }
+        }
+      };
+    }
+
+    void writeDirtyChunks (unsigned int target)
+    {
+      const BufferRegion& region = this->storage.currentRegion ();
+      const auto isDirty = [this, &region](unsigned int c) {
+        return this->chunkVersions[c] > region.version;
+      };
+      unsigned int chunk = region.lowerChunk;
+
+      while (chunk <= region.upperChunk)
+      {
+        if (isDirty (chunk) == false)
+        {
+          chunk++;
+        }
+        else
+        {
+          unsigned int endChunk = chunk + 1;
+
+          for (unsigned int c = endChunk; c <= region.upperChunk && c - endChunk <= maxChunkGap;
+               c++)
+          {
+            if (isDirty (c))
+            {
+              endChunk = c + 1;
+            }
+          }
+          this->writeChunks (target, chunk, endChunk);
+          chunk = endChunk;
+        }
+      }
+    }
+
+    /* Returns `true` if the OpenGL buffer has been reallocated.  A pending upload is only waited
+     * for if elements have been modified since.
+     */
+    bool bufferData (unsigned int target)
+    {
+      if (this->storage.isUploading () && this->isModified () == false)
+      {
+        return false;
+      }
+      this->storage.finishUpload ();
+
+      const unsigned int dataSize = this->numElements () * this->format.elementSize ();
+      const bool         reallocate =
+        this->storage.isAllocated () == false || this->storage.regionSize < dataSize;
+
+      if (reallocate)
+      {
+        const unsigned int regionSize = this->storage.regionSize;
+        bool               isWritten = false;
+
+        if (this->storage.isAllocated () == false)
+        {
+          isWritten = this->storage.allocateInBackground (dataSize, this->fill ());
+          if (isWritten == false)
+          {
+            this->storage.allocate (target, dataSize);
+          }
+        }
+        else
+        {
+          this->storage.allocate (target, regionSize + (100 * (dataSize - regionSize)));
+        }
+
+        if (this->numChunks () > 0)
+        {
+          for (BufferRegion& region : this->storage.regions)
+          {
+            region.addChunk (0);
+            region.addChunk (this->numChunks () - 1);
+          }
+        }
+        if (isWritten == false)
+        {
+          this->writeChunks (target, 0, this->numChunks ());
+        }
+      }
+      else
+      {
+        this->storage.nextRegion (target);
+        this->writeDirtyChunks (target);
+      }
+
+      BufferRegion& region = this->storage.currentRegion ();
+      region.version = this->version;
+      region.resetChunks ();
+      this->version++;
+      return reallocate;
+    }
+
+    unsigned int id () const { return this->storage.id.id (); }
+
+    bool isUploading () const { return this->storage.isUploading (); }
+
+    // offset of the current region
+    const void* offset () const
+    {
+      return reinterpret_cast<const void*> (std::uintptr_t (this->storage.currentOffset ()));
+    }
+
+    void fence () const { this->storage.fence (); }
+
+    void reportMemory (MemoryReport& report) const
+    {
+      report.add (MemoryCategory::MeshData,
+                  this->data.numBytes () +
+                    (this->chunkVersions.capacity () * sizeof (unsigned int)));
+      report.add (MemoryCategory::GpuBuffers, this->storage.numBytes ());
+    }
+  };
+
+  typedef BufferedData<unsigned int, IndexFormat>   IndexData;
+  typedef BufferedData<glm::vec3, OctahedralFormat> NormalData;
+
+  void setupNormalAttribute (const NormalData& normals)
+  {
+    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), normals.id ());
+    OpenGL::glEnableVertexAttribArray (OpenGL::NormalIndex);
+    OpenGL::glVertexAttribPointer (OpenGL::NormalIndex, 2, OpenGL::Short (), true, 0,
+                                   normals.offset ());
+  }
+
+  /* Non-indexed copy of the triangles of a mesh, in which each vertex knows its corner of its
+   * triangle.  It renders wireframes in a single pass if geometry shaders are not available.
+   * Updates only copy triangles whose indices, vertices or normals have been modified since the
+   * last `bufferData` of the mesh.
+   */
+  struct WireframeData
+  {
+    BufferedData<glm::vec3> vertices;
+    NormalData              normals;
+    BufferedData<float>     corners;
+    VertexArray             vertexArray;
+    bool                    isValid;
+
+    WireframeData () { this->reset (); }
+
+    void reset ()
+    {
+      this->vertices.reset ();
+      this->normals.reset ();
+      this->corners.reset ();
+      this->vertexArray.invalidate ();
+      this->isValid = false;
+    }
+
+    // must be called before the data of the mesh is buffered
+    void update (const BufferedData<glm::vec3>& meshVertices, const IndexData& meshIndices,
+                 const NormalData& meshNormals)
+    {
+      const unsigned int chunkSize = IndexData::chunkSize;
+      const unsigned int numIndices = meshIndices.numElements ();
+      const bool checkVertices = meshVertices.isModified () || meshNormals.isModified ();
+
+      if (this->isValid == false)
       {
-        const unsigned int newBufferSize = this->bufferSize + (100 * (dataSize - this->bufferSize));
+        this->vertices.shrink (0);
+        this->normals.shrink (0);
+        this->corners.shrink (0);
+      }
+      else if (this->corners.numElements () > numIndices)
+      {
+        this->vertices.shrink (numIndices);
+        this->normals.shrink (numIndices);
+        this->corners.shrink (numIndices);
+      }
+
+      for (unsigned int c = 0; c < meshIndices.numChunks (); c++)
+      {
+        const unsigned int first = c * chunkSize;
+        const unsigned int end = glm::min (first + chunkSize, numIndices);
+        const bool         isNew = end > this->corners.numElements ();
+
+        if (isNew || checkVertices || meshIndices.isModified (first))
+        {
+          for (unsigned int i = first; i < end; i++)
+          {
+            const unsigned int index = meshIndices.get (i);
+
+            if (i >= this->corners.numElements ())
+            {
+              this->vertices.add (meshVertices.get (index));
+              this->normals.add (meshNormals.get (index));
+              this->corners.add (float(i % 3));
+            }
+            else if (meshIndices.isModified (i) || meshVertices.isModified (index) ||
+                     meshNormals.isModified (index))
+            {
+              this->vertices.set (i, meshVertices.get (index));
+              this->normals.set (i, meshNormals.get (index));
+            }
+          }
+        }
+      }
+      this->isValid = true;
+    }
+
+    void bufferData ()
+    {
+      const bool v = this->vertices.bufferData (OpenGL::ArrayBuffer ());
+      const bool n = this->normals.bufferData (OpenGL::ArrayBuffer ());
+      const bool c = this->corners.bufferData (OpenGL::ArrayBuffer ());
+
+      if (v || n || c)
+      {
+        this->vertexArray.invalidate ();
+      }
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+    }
+
+    void setupAttributes (bool withNormals) const
+    {
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->vertices.id ());
+      OpenGL::glEnableVertexAttribArray (OpenGL::PositionIndex);
+      OpenGL::glVertexAttribPointer (OpenGL::PositionIndex, 3, OpenGL::Float (), false, 0,
+                                     this->vertices.offset ());
 
-        OpenGL::glBufferData (target, newBufferSize, nullptr, OpenGL::StaticDraw ());
-        OpenGL::glBufferSubData (target, 0, dataSize, this->data.data ());
-        this->bufferSize = newBufferSize;
+      if (withNormals)
+      {
+        setupNormalAttribute (this->normals);
+      }
+      else
+      {
+        OpenGL::glDisableVertexAttribArray (OpenGL::NormalIndex);
       }
-      else if (this->dataLowerBound <= this->dataUpperBound)
+
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->corners.id ());
+      OpenGL::glEnableVertexAttribArray (OpenGL::CornerIndex);
+      OpenGL::glVertexAttribPointer (OpenGL::CornerIndex, 1, OpenGL::Float (), false, 0,
+                                     this->corners.offset ());
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+    }
+
+    void fence () const
+    {
+      this->vertices.fence ();
+      this->normals.fence ();
+      this->corners.fence ();
+    }
+
+    bool isUploading () const
+    {
+      return this->vertices.isUploading () || this->normals.isUploading () ||
+             this->corners.isUploading ();
+    }
+
+    void reportMemory (MemoryReport& report) const
+    {
+      this->vertices.reportMemory (report);
+      this->normals.reportMemory (report);
+      this->corners.reportMemory (report);
+    }
+  };
+
+  /* Bounds of the vertices of a mesh, which are expanded by added and moved vertices.  Moving a
+   * vertex off the bounds or removing vertices invalidates them, in which case the next query
+   * recomputes them.  Queries may run on several threads at the same time, e.g. on a mesh that
+   * is shared by background extractions.  Copies do not share the mutex.
+   */
+  struct VertexBounds
+  {
+    bool       isValid;
+    glm::vec3  min;
+    glm::vec3  max;
+    std::mutex mutex;
+
+    VertexBounds () { this->reset (); }
+
+    VertexBounds (const VertexBounds& other)
+      : isValid (other.isValid)
+      , min (other.min)
+      , max (other.max)
+    {
+    }
+
+    VertexBounds& operator= (const VertexBounds& other)
+    {
+      this->isValid = other.isValid;
+      this->min = other.min;
+      this->max = other.max;
+      return *this;
+    }
+
+    void reset ()
+    {
+      this->isValid = true;
+      this->min = glm::vec3 (Util::maxFloat ());
+      this->max = glm::vec3 (Util::minFloat ());
+    }
+
+    void invalidate () { this->isValid = false; }
+
+    void add (const glm::vec3& v)
+    {
+      this->min = glm::min (this->min, v);
+      this->max = glm::max (this->max, v);
+    }
+
+    void move (const glm::vec3& from, const glm::vec3& to)
+    {
+      if (this->isValid)
       {
-        const unsigned int size = (this->dataUpperBound - this->dataLowerBound + 1) * sizeof (T);
+        if (glm::any (glm::equal (from, this->min)) || glm::any (glm::equal (from, this->max)))
+        {
+          this->isValid = false;
+        }
+        else
+        {
+          this->add (to);
+        }
+      }
+    }
+
+    PrimAABox get (const BufferedData<glm::vec3>& vertices)
+    {
+      std::lock_guard<std::mutex> lock (this->mutex);
 
-        OpenGL::glBufferSubData (target, this->dataLowerBound * sizeof (T), size,
-                                 &this->get (this->dataLowerBound));
+      if (this->isValid == false)
+      {
+        this->reset ();
+        for (unsigned int i = 0; i < vertices.numElements (); i++)
+        {
+          this->add (vertices.get (i));
+        }
       }
-      this->resetBounds ();
+      return PrimAABox (this->min, this->max);
     }
   };
 }
@@ -125,10 +1011,15 @@ struct Mesh::Impl
   glm::mat4x4                rotationMatrix;
   glm::mat4x4                translationMatrix;
   BufferedData<glm::vec3>    vertices;
-  BufferedData<unsigned int> indices;
-  BufferedData<glm::vec3>    normals;
+  IndexData                  indices;
+  NormalData                 normals;
+  mutable VertexArray        vertexArray;
+  mutable WireframeData      wireframe;
+  mutable VertexBounds       vertexBounds;
   Color                      color;
   Color                      wireframeColor;
+  bool                       deferNormals;
+  mutable unsigned int       _revision;
 
   RenderMode renderMode;
 
@@ -138,10 +1029,35 @@ struct Mesh::Impl
     , translationMatrix (glm::mat4x4 (1.0f))
     , color (Color::White ())
     , wireframeColor (Color::Black ())
+    , deferNormals (false)
+    , _revision (nextRevision ())
   {
     this->renderMode.smoothShading (true);
   }
 
+  unsigned int revision () const
+  {
+    if (this->vertices.isRevised || this->indices.isRevised || this->normals.isRevised)
+    {
+      this->vertices.isRevised = false;
+      this->indices.isRevised = false;
+      this->normals.isRevised = false;
+      this->_revision = nextRevision ();
+    }
+    return this->_revision;
+  }
+
+  void writeBufferData (char* v, char* n, unsigned int* i) const
+  {
+    this->vertices.fill () (v);
+    this->normals.fill () (n);
+
+    for (unsigned int k = 0; k < this->numIndices (); k++)
+    {
+      i[k] = this->indices.get (k);
+    }
+  }
+
   unsigned int numVertices () const { return this->vertices.numElements (); }
 
   unsigned int numIndices () const { return this->indices.numElements (); }
@@ -177,6 +1093,7 @@ struct Mesh::Impl
     assert (this->vertices.numElements () == this->normals.numElements ());
 
     this->vertices.add (v);
+    this->vertexBounds.add (v);
     return this->normals.add (n);
   }
 
@@ -190,6 +1107,7 @@ struct Mesh::Impl
   {
     this->vertices.shrink (n);
     this->normals.shrink (n);
+    this->vertexBounds.invalidate ();
   }
 
   void index (unsigned int i, unsigned int index) { this->indices.set (i, index); }
@@ -197,6 +1115,7 @@ struct Mesh::Impl
   void vertex (unsigned int i, const glm::vec3& v)
   {
     assert (Util::isNaN (v) == false);
+    this->vertexBounds.move (this->vertices.get (i), v);
     this->vertices.set (i, v);
   }
 
@@ -206,16 +1125,66 @@ struct Mesh::Impl
     this->normals.set (i, n);
   }
 
+  bool hasSinglePassWireframe () const
+  {
+    return this->renderMode.renderWireframe () && OpenGL::hasGeometryShader () == false;
+  }
+
+  // meshes are not rendered while their buffers are uploaded in the background
+  bool isUploading () const
+  {
+    return this->vertices.isUploading () || this->indices.isUploading () ||
+           (this->deferNormals == false && this->normals.isUploading ()) ||
+           this->wireframe.isUploading ();
+  }
+
+  // meshes are not buffered without an OpenGL context, e.g. when replaying strokes
   void bufferData ()
   {
-    this->vertices.bufferData (OpenGL::ArrayBuffer ());
-    this->indices.bufferData (OpenGL::ElementArrayBuffer ());
-    this->normals.bufferData (OpenGL::ArrayBuffer ());
+    if (OpenGL::isInitialized () == false)
+    {
+      return;
+    }
+    else if (this->wireframe.isValid && this->hasSinglePassWireframe ())
+    {
+      this->wireframe.update (this->vertices, this->indices, this->normals);
+      this->wireframe.bufferData ();
+    }
+    else if (this->wireframe.isValid)
+    {
+      this->wireframe.reset ();
+    }
+
+    const bool shortIndices = this->numVertices () <= Util::maxUnsignedShort () + 1;
+
+    if (shortIndices != this->indices.format.isShort)
+    {
+      this->indices.format.isShort = shortIndices;
+      this->indices.storage.reset ();
+    }
+
+    const bool v = this->vertices.bufferData (OpenGL::ArrayBuffer ());
+    const bool i = this->indices.bufferData (OpenGL::ElementArrayBuffer ());
+    const bool n =
+      this->deferNormals ? false : this->normals.bufferData (OpenGL::ArrayBuffer ());
+
+    if (v || i || n)
+    {
+      this->vertexArray.invalidate ();
+    }
 
     OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), 0);
     OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
   }
 
+  void reportMemory (MemoryReport& report) const
+  {
+    this->vertices.reportMemory (report);
+    this->indices.reportMemory (report);
+    this->normals.reportMemory (report);
+    this->wireframe.reportMemory (report);
+  }
+
   glm::mat4x4 modelMatrix () const
   {
     return this->translationMatrix * this->rotationMatrix * this->scalingMatrix;
@@ -231,37 +1200,71 @@ struct Mesh::Impl
     camera.setModelViewProjection (this->modelMatrix (), this->modelNormalMatrix (), noZoom);
   }
 
-  void renderBegin (Camera& camera) const
+  void setupAttributes (bool withNormals) const
   {
-    if (this->renderMode.renderWireframe () && OpenGL::hasGeometryShader () == false)
-    {
-      RenderMode nonWireframeRenderMode (this->renderMode);
-      nonWireframeRenderMode.renderWireframe (false);
+    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->vertices.id ());
+    OpenGL::glEnableVertexAttribArray (OpenGL::PositionIndex);
+    OpenGL::glVertexAttribPointer (OpenGL::PositionIndex, 3, OpenGL::Float (), false, 0,
+                                   this->vertices.offset ());
+
+    OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), this->indices.id ());
 
-      camera.renderer ().setProgram (nonWireframeRenderMode);
+    if (withNormals)
+    {
+      setupNormalAttribute (this->normals);
     }
     else
     {
-      camera.renderer ().setProgram (this->renderMode);
+      OpenGL::glDisableVertexAttribArray (OpenGL::NormalIndex);
+    }
+    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+  }
+
+  // while normals are deferred, smooth shading falls back to flat shading
+  RenderMode effectiveRenderMode () const
+  {
+    RenderMode mode (this->renderMode);
+
+    if (this->deferNormals && mode.smoothShading ())
+    {
+      mode.flatShading (true);
+    }
+    return mode;
+  }
+
+  void renderBegin (Camera& camera) const
+  {
+    RenderMode mode (this->effectiveRenderMode ());
+
+    if (mode.renderWireframe () && OpenGL::hasGeometryShader () == false)
+    {
+      mode.renderWireframe (false);
     }
+    this->renderBegin (camera, mode);
+  }
+
+  void setProgram (Camera& camera, const RenderMode& mode) const
+  {
+    camera.renderer ().setProgram (mode);
     camera.renderer ().setColor (this->color);
     camera.renderer ().setWireframeColor (this->wireframeColor);
 
     this->setModelMatrix (camera, this->renderMode.cameraRotationOnly ());
+  }
 
-    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->vertices.id.id ());
-    OpenGL::glEnableVertexAttribArray (OpenGL::PositionIndex);
-    OpenGL::glVertexAttribPointer (OpenGL::PositionIndex, 3, OpenGL::Float (), false, 0, 0);
-
-    OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), this->indices.id.id ());
+  void renderBegin (Camera& camera, const RenderMode& mode) const
+  {
+    this->setProgram (camera, mode);
 
-    if (this->renderMode.smoothShading ())
+    if (OpenGL::hasVertexArrayObject () == false)
     {
-      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->normals.id.id ());
-      OpenGL::glEnableVertexAttribArray (OpenGL::NormalIndex);
-      OpenGL::glVertexAttribPointer (OpenGL::NormalIndex, 3, OpenGL::Float (), false, 0, 0);
+      this->setupAttributes (mode.smoothShading ());
+    }
+    else if (this->vertexArray.bind (this->vertices.offset (), this->normals.offset (),
+                                     mode.smoothShading ()))
+    {
+      this->setupAttributes (mode.smoothShading ());
     }
-    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
 
     if (this->renderMode.noDepthTest ())
     {
@@ -271,38 +1274,193 @@ struct Mesh::Impl
 
   void renderEnd () const
   {
-    OpenGL::glDisableVertexAttribArray (OpenGL::PositionIndex);
-    OpenGL::glDisableVertexAttribArray (OpenGL::NormalIndex);
-    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
-    OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), 0);
+    if (OpenGL::hasVertexArrayObject ())
+    {
+      OpenGL::glBindVertexArray (0);
+    }
+    else
+    {
+      OpenGL::glDisableVertexAttribArray (OpenGL::PositionIndex);
+      OpenGL::glDisableVertexAttribArray (OpenGL::NormalIndex);
+      OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), 0);
+    }
     OpenGL::glEnable (OpenGL::DepthTest ());
+
+    this->vertices.fence ();
+    this->indices.fence ();
+    this->normals.fence ();
+  }
+
+  void renderWireframeBegin (Camera& camera) const
+  {
+    const RenderMode mode (this->effectiveRenderMode ());
+    const bool       withNormals = mode.smoothShading ();
+
+    assert (this->wireframe.isValid);
+    this->setProgram (camera, mode);
+
+    if (OpenGL::hasVertexArrayObject () == false)
+    {
+      this->wireframe.setupAttributes (withNormals);
+    }
+    else if (this->wireframe.vertexArray.bind (this->wireframe.vertices.offset (),
+                                               this->wireframe.normals.offset (), withNormals))
+    {
+      this->wireframe.setupAttributes (withNormals);
+    }
+
+    if (this->renderMode.noDepthTest ())
+    {
+      OpenGL::glDisable (OpenGL::DepthTest ());
+    }
+  }
+
+  void renderWireframeEnd () const
+  {
+    if (OpenGL::hasVertexArrayObject ())
+    {
+      OpenGL::glBindVertexArray (0);
+    }
+    else
+    {
+      OpenGL::glDisableVertexAttribArray (OpenGL::PositionIndex);
+      OpenGL::glDisableVertexAttribArray (OpenGL::NormalIndex);
+      OpenGL::glDisableVertexAttribArray (OpenGL::CornerIndex);
+    }
+    OpenGL::glEnable (OpenGL::DepthTest ());
+
+    this->wireframe.fence ();
+  }
+
+  /* Without geometry shaders, wireframes are rendered from the non-indexed `wireframe` data
+   * with `drawArrays`, which draws the same ranges as `drawElements`.
+   */
+  template <typename F, typename G>
+  void renderElements (Camera& camera, const F& drawElements, const G& drawArrays,
+                       const Color* color = nullptr) const
+  {
+    if (this->hasSinglePassWireframe () && this->wireframe.isValid == false)
+    {
+      this->wireframe.update (this->vertices, this->indices, this->normals);
+      this->wireframe.bufferData ();
+    }
+
+    if (this->isUploading ())
+    {
+      return;
+    }
+    else if (this->hasSinglePassWireframe ())
+    {
+      this->renderWireframeBegin (camera);
+      if (color)
+      {
+        camera.renderer ().setColor (*color);
+      }
+      drawArrays ();
+      this->renderWireframeEnd ();
+    }
+    else
+    {
+      this->renderBegin (camera);
+      if (color)
+      {
+        camera.renderer ().setColor (*color);
+      }
+      drawElements ();
+      this->renderEnd ();
+    }
   }
 
   void render (Camera& camera) const
   {
-    this->renderBegin (camera);
+    this->renderElements (
+      camera,
+      [this]() {
+        OpenGL::glDrawElements (OpenGL::Triangles (), this->numIndices (),
+                                this->indices.format.type (), this->indices.offset ());
+      },
+      [this]() { OpenGL::glDrawArrays (OpenGL::Triangles (), 0, this->numIndices ()); });
+  }
+
+  void renderRanges (Camera& camera, const std::vector<unsigned int>& firsts,
+                     const std::vector<unsigned int>& counts) const
+  {
+    this->renderRanges (camera, firsts, counts, nullptr);
+  }
 
-    OpenGL::glDrawElements (OpenGL::Triangles (), this->numIndices (), OpenGL::UnsignedInt (),
-                            nullptr);
+  void renderRanges (Camera& camera, const std::vector<unsigned int>& firsts,
+                     const std::vector<unsigned int>& counts, const Color& color) const
+  {
+    this->renderRanges (camera, firsts, counts, &color);
+  }
 
-    if (this->renderMode.renderWireframe () && OpenGL::hasGeometryShader () == false)
+  void renderRanges (Camera& camera, const std::vector<unsigned int>& firsts,
+                     const std::vector<unsigned int>& counts, const Color* color) const
+  {
+    assert (firsts.size () == counts.size ());
+
+    const std::uintptr_t     offset = std::uintptr_t (this->indices.offset ());
+    std::vector<const void*> rangeOffsets;
+    std::vector<int>         rangeFirsts;
+    std::vector<int>         rangeCounts;
+
+    rangeOffsets.reserve (firsts.size ());
+    rangeFirsts.reserve (firsts.size ());
+    rangeCounts.reserve (counts.size ());
+
+    for (unsigned int i = 0; i < firsts.size (); i++)
     {
-      camera.renderer ().setColor (this->wireframeColor);
-      OpenGL::glPolygonMode (OpenGL::FrontAndBack (), OpenGL::Line ());
+      assert (firsts[i] + counts[i] <= this->numIndices ());
 
-      OpenGL::glDrawElements (OpenGL::Triangles (), this->numIndices (), OpenGL::UnsignedInt (),
-                              nullptr);
+      rangeOffsets.push_back (
+        reinterpret_cast<const void*> (offset + (firsts[i] * this->indices.format.elementSize ())));
+      rangeFirsts.push_back (int(firsts[i]));
+      rangeCounts.push_back (int(counts[i]));
+    }
+
+    this->renderElements (
+      camera,
+      [this, &rangeOffsets, &rangeCounts]() {
+        OpenGL::glMultiDrawElements (OpenGL::Triangles (), rangeCounts.data (),
+                                     this->indices.format.type (), rangeOffsets.data (),
+                                     rangeCounts.size ());
+      },
+      [&rangeFirsts, &rangeCounts]() {
+        OpenGL::glMultiDrawArrays (OpenGL::Triangles (), rangeFirsts.data (), rangeCounts.data (),
+                                   rangeCounts.size ());
+      },
+      color);
+  }
 
-      OpenGL::glPolygonMode (OpenGL::FrontAndBack (), OpenGL::Fill ());
+  void renderInstances (Camera& camera, const MeshInstances& instances) const
+  {
+    if (this->isUploading ())
+    {
+      return;
     }
 
+    RenderMode instancedRenderMode (this->effectiveRenderMode ());
+    instancedRenderMode.renderWireframe (false);
+    instancedRenderMode.instancing (true);
+
+    this->renderBegin (camera, instancedRenderMode);
+    instances.enableAttributes ();
+    OpenGL::glDrawElementsInstanced (OpenGL::Triangles (), this->numIndices (),
+                                     this->indices.format.type (), this->indices.offset (),
+                                     instances.numInstances ());
+    instances.disableAttributes ();
     this->renderEnd ();
   }
 
   void renderLines (Camera& camera) const
   {
+    if (this->isUploading ())
+    {
+      return;
+    }
     this->renderBegin (camera);
-    OpenGL::glDrawElements (OpenGL::Lines (), this->numIndices (), OpenGL::UnsignedInt (), nullptr);
+    OpenGL::glDrawElements (OpenGL::Lines (), this->numIndices (), this->indices.format.type (),
+                            this->indices.offset ());
     this->renderEnd ();
   }
 
@@ -319,6 +1477,9 @@ struct Mesh::Impl
     this->vertices.reset ();
     this->indices.reset ();
     this->normals.reset ();
+    this->vertexBounds.reset ();
+    this->vertexArray.invalidate ();
+    this->wireframe.reset ();
   }
 
   void scale (const glm::vec3& v) { this->scalingMatrix = glm::scale (this->scalingMatrix, v); }
@@ -376,31 +1537,18 @@ struct Mesh::Impl
     const glm::mat4x4 model = this->modelMatrix ();
     const glm::mat3x3 modelNormal = this->modelNormalMatrix ();
 
-    for (unsigned int i = 0; i < this->numVertices (); i++)
-    {
-      this->vertex (i, Util::transformPosition (model, this->vertex (i)));
-      if (Util::isNotNull (this->normal (i)))
-      {
-        this->normal (i, glm::normalize (modelNormal * this->normal (i)));
-      }
-    }
+    this->vertices.transform (
+      [&model](const glm::vec3& v) { return Util::transformPosition (model, v); });
+    this->vertexBounds.invalidate ();
+    this->normals.transform ([&modelNormal](const glm::vec3& n) {
+      return Util::isNotNull (n) ? glm::normalize (modelNormal * n) : n;
+    });
     this->position (glm::vec3 (0.0f));
     this->scaling (glm::vec3 (1.0f));
     this->rotationMatrix = glm::mat4x4 (1.0f);
   }
 
-  PrimAABox bounds () const
-  {
-    glm::vec3 min = glm::vec3 (Util::maxFloat ());
-    glm::vec3 max = glm::vec3 (Util::minFloat ());
-
-    for (unsigned int i = 0; i < this->numVertices (); i++)
-    {
-      min = glm::min (min, this->vertices.get (i));
-      max = glm::max (max, this->vertices.get (i));
-    }
-    return PrimAABox (min, max);
-  }
+  PrimAABox bounds () const { return this->vertexBounds.get (this->vertices); }
 };
 
 DELEGATE_BIG6 (Mesh)
@@ -422,17 +1570,27 @@ DELEGATE2 (void, Mesh, index, unsigned int, unsigned int)
 DELEGATE2 (void, Mesh, vertex, unsigned int, const glm::vec3&)
 DELEGATE2 (void, Mesh, normal, unsigned int, const glm::vec3&)
 
+DELEGATE_CONST (unsigned int, Mesh, revision)
+DELEGATE3_CONST (void, Mesh, writeBufferData, char*, char*, unsigned int*)
 DELEGATE (void, Mesh, bufferData)
+DELEGATE1_CONST (void, Mesh, reportMemory, MemoryReport&)
 DELEGATE_CONST (glm::mat4x4, Mesh, modelMatrix)
 DELEGATE_CONST (glm::mat3x3, Mesh, modelNormalMatrix)
 DELEGATE1_CONST (void, Mesh, renderBegin, Camera&)
 DELEGATE_CONST (void, Mesh, renderEnd)
 DELEGATE1_CONST (void, Mesh, render, Camera&)
+DELEGATE3_CONST (void, Mesh, renderRanges, Camera&, const std::vector<unsigned int>&,
+                 const std::vector<unsigned int>&)
+DELEGATE4_CONST (void, Mesh, renderRanges, Camera&, const std::vector<unsigned int>&,
+                 const std::vector<unsigned int>&, const Color&)
 DELEGATE1_CONST (void, Mesh, renderLines, Camera&)
+DELEGATE2_CONST (void, Mesh, renderInstances, Camera&, const MeshInstances&)
 DELEGATE (void, Mesh, reset)
 DELEGATE (void, Mesh, resetGeometry)
 GETTER_CONST (const RenderMode&, Mesh, renderMode)
 GETTER (RenderMode&, Mesh, renderMode)
+GETTER_CONST (bool, Mesh, deferNormals)
+SETTER (bool, Mesh, deferNormals)
 
 DELEGATE1 (void, Mesh, scale, const glm::vec3&)
 DELEGATE1 (void, Mesh, scaling, const glm::vec3&)
@@ -6,10 +6,13 @@
 #define DILAY_MESH
 
 #include <glm/fwd.hpp>
+#include <vector>
 #include "macro.hpp"
 
 class Camera;
 class Color;
+class MemoryReport;
+class MeshInstances;
 class PrimAABox;
 class RenderFlags;
 class RenderMode;
@@ -36,18 +39,38 @@ public:
   void             vertex (unsigned int, const glm::vec3&);
   void             normal (unsigned int, const glm::vec3&);
 
+  // changes whenever vertices, indices or normals are modified, and is unique among all meshes
+  unsigned int      revision () const;
+  // writes vertices, octahedral normals and indices as they are buffered, cf. `MeshArena`
+  void              writeBufferData (char*, char*, unsigned int*) const;
   void              bufferData ();
+  // reports vertices, indices and normals, and the sizes of their OpenGL buffers
+  void              reportMemory (MemoryReport&) const;
   glm::mat4x4       modelMatrix () const;
   glm::mat3x3       modelNormalMatrix () const;
   void              renderBegin (Camera&) const;
   void              renderEnd () const;
   void              render (Camera&) const;
+  // renders the index ranges that are given by their first indices and their sizes
+  void              renderRanges (Camera&, const std::vector<unsigned int>&,
+                                  const std::vector<unsigned int>&) const;
+  // same as `renderRanges` but with a color other than the mesh's color
+  void              renderRanges (Camera&, const std::vector<unsigned int>&,
+                                  const std::vector<unsigned int>&, const Color&) const;
   void              renderLines (Camera&) const;
+  void              renderInstances (Camera&, const MeshInstances&) const;
   void              reset ();
   void              resetGeometry ();
   const RenderMode& renderMode () const;
   RenderMode&       renderMode ();
 
+  /* Deferred normals are not buffered, and smoothly shaded meshes are shaded flat instead, whose
+   * normals are derived per fragment.  Normals are still maintained and are buffered by the first
+   * `bufferData` after deferring is stopped.
+   */
+  bool deferNormals () const;
+  void deferNormals (bool);
+
   void               scale (const glm::vec3&);
   void               scaling (const glm::vec3&);
   glm::vec3          scaling () const;
@@ -0,0 +1,234 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QCoreApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QThread>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <glm/glm.hpp>
+#include <mutex>
+#include <vector>
+#include "log.hpp"
+#include "opengl-upload.hpp"
+#include "opengl.hpp"
+#include "profiler.hpp"
+
+struct OpenGLUpload::Impl
+{
+  const unsigned int      id;
+  const unsigned int      size;
+  const unsigned int      numRegions;
+  Fill                    fill;
+  char*                   mapped;
+  std::atomic<bool>       isDone;
+  std::mutex              mutex;
+  std::condition_variable condition;
+
+  Impl (unsigned int i, unsigned int s, unsigned int n, Fill&& f)
+    : id (i)
+    , size (s)
+    , numRegions (n)
+    , fill (std::move (f))
+    , mapped (nullptr)
+    , isDone (false)
+  {
+  }
+
+  bool isComplete () const { return this->isDone; }
+
+  /* Releases `fill` on the waiting thread, since it may hold the last extra references to chunks
+   * of a mesh, which the mesh modifies in place once they are no longer shared.
+   */
+  char* wait ()
+  {
+    std::unique_lock<std::mutex> lock (this->mutex);
+
+    this->condition.wait (lock, [this]() { return this->isComplete (); });
+    this->fill = nullptr;
+    return this->mapped;
+  }
+
+  // the buffer is only used by the main context once the commands of this context are complete
+  void run ()
+  {
+    PROFILE_ZONE ("opengl-upload")
+
+    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->id);
+
+    if (this->numRegions > 1)
+    {
+      const unsigned int flags =
+        OpenGL::MapWriteBit () | OpenGL::MapPersistentBit () | OpenGL::MapCoherentBit ();
+
+      const unsigned int storageSize = this->numRegions * glm::max (1u, this->size);
+
+      OpenGL::glBufferStorage (OpenGL::ArrayBuffer (), storageSize, nullptr, flags);
+      this->mapped = static_cast<char*> (
+        OpenGL::glMapBufferRange (OpenGL::ArrayBuffer (), 0, storageSize, flags));
+
+      if (this->mapped == nullptr)
+      {
+        DILAY_PANIC ("could not map OpenGL buffer")
+      }
+      this->fill (this->mapped);
+
+      void* fence = OpenGL::glFenceSync (OpenGL::SyncGpuCommandsComplete (), 0);
+      OpenGL::waitSync (fence);
+      OpenGL::safeDeleteSync (fence);
+    }
+    else
+    {
+      std::vector<char> data (this->size);
+
+      this->fill (data.data ());
+      OpenGL::glBufferData (OpenGL::ArrayBuffer (), this->size, data.data (),
+                            OpenGL::StaticDraw ());
+      OpenGL::glFinish ();
+    }
+    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+    {
+      std::lock_guard<std::mutex> lock (this->mutex);
+      this->isDone = true;
+    }
+    this->condition.notify_all ();
+  }
+};
+
+DELEGATE4_BIG2 (OpenGLUpload, unsigned int, unsigned int, unsigned int, OpenGLUpload::Fill&&)
+DELEGATE_CONST (bool, OpenGLUpload, isComplete)
+DELEGATE (char*, OpenGLUpload, wait)
+DELEGATE (void, OpenGLUpload, run)
+
+namespace
+{
+  class Worker : public QThread
+  {
+  public:
+    Worker (QOpenGLContext& shared, unsigned int m)
+      : minBytes (m)
+      , isStopped (false)
+    {
+      this->surface.setFormat (shared.format ());
+      this->surface.create ();
+
+      this->context.setFormat (shared.format ());
+      this->context.setShareContext (&shared);
+
+      if (this->context.create () == false)
+      {
+        DILAY_WARN ("could not create OpenGL context for background uploads")
+      }
+      this->context.moveToThread (this);
+    }
+
+    bool isValid () const { return this->context.isValid (); }
+
+    void push (const std::shared_ptr<OpenGLUpload>& upload)
+    {
+      {
+        std::lock_guard<std::mutex> lock (this->mutex);
+        this->queue.push_back (upload);
+      }
+      this->condition.notify_one ();
+    }
+
+    void stop ()
+    {
+      {
+        std::lock_guard<std::mutex> lock (this->mutex);
+        this->isStopped = true;
+      }
+      this->condition.notify_one ();
+      this->wait ();
+    }
+
+    const unsigned int minBytes;
+
+  protected:
+    // pending uploads are completed before the thread stops
+    void run () override
+    {
+      this->context.makeCurrent (&this->surface);
+      OpenGL::initializeSharedFunctions ();
+
+      while (true)
+      {
+        std::shared_ptr<OpenGLUpload> upload;
+        {
+          std::unique_lock<std::mutex> lock (this->mutex);
+
+          this->condition.wait (lock, [this]() {
+            return this->isStopped || this->queue.empty () == false;
+          });
+
+          if (this->queue.empty ())
+          {
+            break;
+          }
+          upload = this->queue.front ();
+          this->queue.pop_front ();
+        }
+        upload->run ();
+      }
+      this->context.doneCurrent ();
+      this->context.moveToThread (QCoreApplication::instance ()->thread ());
+    }
+
+  private:
+    QOffscreenSurface                         surface;
+    QOpenGLContext                            context;
+    std::mutex                                mutex;
+    std::condition_variable                   condition;
+    std::deque<std::shared_ptr<OpenGLUpload>> queue;
+    bool                                      isStopped;
+  };
+
+  static std::unique_ptr<Worker> worker;
+}
+
+namespace OpenGLUploader
+{
+  void start (QOpenGLContext& shared, unsigned int minBytes)
+  {
+    assert (OpenGL::isInitialized ());
+
+    OpenGLUploader::stop ();
+    worker.reset (new Worker (shared, minBytes));
+
+    if (worker->isValid ())
+    {
+      worker->start ();
+    }
+    else
+    {
+      worker.reset ();
+    }
+  }
+
+  void stop ()
+  {
+    if (worker)
+    {
+      worker->stop ();
+      worker.reset ();
+    }
+  }
+
+  bool isRunning () { return bool(worker); }
+
+  bool handles (unsigned int numBytes) { return worker && numBytes >= worker->minBytes; }
+
+  std::shared_ptr<OpenGLUpload> upload (unsigned int id, unsigned int size,
+                                        unsigned int numRegions, OpenGLUpload::Fill&& fill)
+  {
+    assert (worker);
+
+    auto upload = std::make_shared<OpenGLUpload> (id, size, numRegions, std::move (fill));
+    worker->push (upload);
+    return upload;
+  }
+}
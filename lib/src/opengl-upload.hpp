@@ -0,0 +1,58 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_OPENGL_UPLOAD
+#define DILAY_OPENGL_UPLOAD
+
+#include <functional>
+#include <memory>
+#include "macro.hpp"
+
+class QOpenGLContext;
+
+/* Initial data of an OpenGL buffer, which is allocated and written by the background thread of
+ * `OpenGLUploader`.  The buffer must not be used by the main context before the upload is
+ * complete.  The buffer consists of `numRegions` persistently mapped regions of `size` bytes if
+ * `numRegions > 1`, of which the first one is written.
+ */
+class OpenGLUpload
+{
+public:
+  // writes `size` bytes, which runs on the background thread
+  typedef std::function<void(char*)> Fill;
+
+  DECLARE_BIG2 (OpenGLUpload, unsigned int, unsigned int, unsigned int, Fill&&)
+
+  // whether the buffer may be used by the main context, which does not block
+  bool  isComplete () const;
+  // waits on the main thread until the upload is complete and returns its mapping or `nullptr`
+  char* wait ();
+  // called by the background thread, whose context must be current
+  void  run ();
+
+private:
+  IMPLEMENTATION
+};
+
+/* Background thread with an OpenGL context that shares its objects with the main context, such
+ * that uploading large buffers does not block rendering.  Buffer names are generated by the main
+ * context and are rendered from once their upload is complete.  The shared context has the
+ * format of the main context and resolves its own functions, cf.
+ * `OpenGL::initializeSharedFunctions`.
+ */
+namespace OpenGLUploader
+{
+  // must be called from the main thread after `OpenGL::initializeFunctions`
+  void start (QOpenGLContext&, unsigned int);
+  // completes all pending uploads
+  void stop ();
+  bool isRunning ();
+  // whether buffers of a given size are uploaded in the background
+  bool handles (unsigned int);
+
+  std::shared_ptr<OpenGLUpload> upload (unsigned int, unsigned int, unsigned int,
+                                        OpenGLUpload::Fill&&);
+}
+
+#endif
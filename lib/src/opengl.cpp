@@ -2,14 +2,21 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QOpenGLContext>
 #include <QOpenGLExtensions>
 #include <QOpenGLFunctions_2_1>
+#include <QStandardPaths>
+#include <cstring>
 #include <glm/glm.hpp>
 #include <iostream>
 #include <memory>
 #include "log.hpp"
 #include "opengl.hpp"
+#include "profiler.hpp"
 #include "shader.hpp"
 #include "util.hpp"
 
@@ -39,9 +46,260 @@ namespace OpenGL
   static_assert (sizeof (int) >= 4, "type does not meet size required by OpenGL");
   static_assert (sizeof (float) >= 4, "type does not meet size required by OpenGL");
 
-  static QOpenGLFunctions_2_1*                                  fun = nullptr;
+  // each thread with a current context resolves its own functions, cf. `initializeSharedFunctions`
+  static thread_local QOpenGLFunctions_2_1*                     fun = nullptr;
   static std::unique_ptr<QOpenGLExtension_EXT_geometry_shader4> gsFun;
 
+  template <typename T> static bool resolve (T& function, const char* name)
+  {
+    function = reinterpret_cast<T> (QOpenGLContext::currentContext ()->getProcAddress (name));
+    return function != nullptr;
+  }
+
+  // functions of GL_ARB_buffer_storage, GL_ARB_map_buffer_range and GL_ARB_sync
+  struct BufferStorageFunctions
+  {
+    typedef void (QOPENGLF_APIENTRYP BufferStorage) (GLenum, GLsizeiptr, const void*, GLbitfield);
+    typedef GLenum (QOPENGLF_APIENTRYP ClientWaitSync) (GLsync, GLbitfield, GLuint64);
+    typedef void (QOPENGLF_APIENTRYP DeleteSync) (GLsync);
+    typedef GLsync (QOPENGLF_APIENTRYP FenceSync) (GLenum, GLbitfield);
+    typedef void* (QOPENGLF_APIENTRYP MapBufferRange) (GLenum, GLintptr, GLsizeiptr, GLbitfield);
+
+    BufferStorage  glBufferStorage;
+    ClientWaitSync glClientWaitSync;
+    DeleteSync     glDeleteSync;
+    FenceSync      glFenceSync;
+    MapBufferRange glMapBufferRange;
+
+    bool initialize ()
+    {
+      return resolve (this->glBufferStorage, "glBufferStorage") &&
+             resolve (this->glClientWaitSync, "glClientWaitSync") &&
+             resolve (this->glDeleteSync, "glDeleteSync") &&
+             resolve (this->glFenceSync, "glFenceSync") &&
+             resolve (this->glMapBufferRange, "glMapBufferRange");
+    }
+  };
+  static thread_local std::unique_ptr<BufferStorageFunctions> bsFun;
+
+  // functions of GL_ARB_draw_instanced and GL_ARB_instanced_arrays
+  struct InstancingFunctions
+  {
+    typedef void (QOPENGLF_APIENTRYP DrawElementsInstanced) (GLenum, GLsizei, GLenum, const void*,
+                                                             GLsizei);
+    typedef void (QOPENGLF_APIENTRYP VertexAttribDivisor) (GLuint, GLuint);
+
+    DrawElementsInstanced glDrawElementsInstanced;
+    VertexAttribDivisor   glVertexAttribDivisor;
+
+    bool initialize ()
+    {
+      return resolve (this->glDrawElementsInstanced, "glDrawElementsInstancedARB") &&
+             resolve (this->glVertexAttribDivisor, "glVertexAttribDivisorARB");
+    }
+  };
+  static std::unique_ptr<InstancingFunctions> inFun;
+
+  // functions of GL_ARB_vertex_array_object
+  struct VertexArrayFunctions
+  {
+    typedef void (QOPENGLF_APIENTRYP BindVertexArray) (GLuint);
+    typedef void (QOPENGLF_APIENTRYP DeleteVertexArrays) (GLsizei, const GLuint*);
+    typedef void (QOPENGLF_APIENTRYP GenVertexArrays) (GLsizei, GLuint*);
+
+    BindVertexArray    glBindVertexArray;
+    DeleteVertexArrays glDeleteVertexArrays;
+    GenVertexArrays    glGenVertexArrays;
+
+    bool initialize ()
+    {
+      return resolve (this->glBindVertexArray, "glBindVertexArray") &&
+             resolve (this->glDeleteVertexArrays, "glDeleteVertexArrays") &&
+             resolve (this->glGenVertexArrays, "glGenVertexArrays");
+    }
+  };
+  static std::unique_ptr<VertexArrayFunctions> vaFun;
+
+  // functions of GL_ARB_uniform_buffer_object
+  struct UniformBufferFunctions
+  {
+    typedef void (QOPENGLF_APIENTRYP BindBufferBase) (GLenum, GLuint, GLuint);
+    typedef GLuint (QOPENGLF_APIENTRYP GetUniformBlockIndex) (GLuint, const GLchar*);
+    typedef void (QOPENGLF_APIENTRYP UniformBlockBinding) (GLuint, GLuint, GLuint);
+
+    BindBufferBase       glBindBufferBase;
+    GetUniformBlockIndex glGetUniformBlockIndex;
+    UniformBlockBinding  glUniformBlockBinding;
+
+    bool initialize ()
+    {
+      return resolve (this->glBindBufferBase, "glBindBufferBase") &&
+             resolve (this->glGetUniformBlockIndex, "glGetUniformBlockIndex") &&
+             resolve (this->glUniformBlockBinding, "glUniformBlockBinding");
+    }
+  };
+  static std::unique_ptr<UniformBufferFunctions> ubFun;
+
+  // functions of GL_ARB_timer_query
+  struct TimerQueryFunctions
+  {
+    typedef void (QOPENGLF_APIENTRYP GetQueryObjectui64v) (GLuint, GLenum, GLuint64*);
+    typedef void (QOPENGLF_APIENTRYP QueryCounter) (GLuint, GLenum);
+
+    GetQueryObjectui64v glGetQueryObjectui64v;
+    QueryCounter        glQueryCounter;
+
+    bool initialize ()
+    {
+      return resolve (this->glGetQueryObjectui64v, "glGetQueryObjectui64v") &&
+             resolve (this->glQueryCounter, "glQueryCounter");
+    }
+  };
+  static std::unique_ptr<TimerQueryFunctions> tqFun;
+
+  // functions of GL_ARB_multi_draw_indirect, which relies on GL_ARB_base_instance
+  struct MultiDrawIndirectFunctions
+  {
+    typedef void (QOPENGLF_APIENTRYP MultiDrawElementsIndirect) (GLenum, GLenum, const void*,
+                                                                 GLsizei, GLsizei);
+
+    MultiDrawElementsIndirect glMultiDrawElementsIndirect;
+
+    bool initialize ()
+    {
+      return resolve (this->glMultiDrawElementsIndirect, "glMultiDrawElementsIndirect");
+    }
+  };
+  static std::unique_ptr<MultiDrawIndirectFunctions> mdFun;
+
+  // functions of GL_ARB_get_program_binary
+  struct ProgramBinaryFunctions
+  {
+    typedef void (QOPENGLF_APIENTRYP GetProgramBinary) (GLuint, GLsizei, GLsizei*, GLenum*, void*);
+    typedef void (QOPENGLF_APIENTRYP ProgramBinary) (GLuint, GLenum, const void*, GLsizei);
+    typedef void (QOPENGLF_APIENTRYP ProgramParameteri) (GLuint, GLenum, GLint);
+
+    GetProgramBinary  glGetProgramBinary;
+    ProgramBinary     glProgramBinary;
+    ProgramParameteri glProgramParameteri;
+
+    bool initialize ()
+    {
+      return resolve (this->glGetProgramBinary, "glGetProgramBinary") &&
+             resolve (this->glProgramBinary, "glProgramBinary") &&
+             resolve (this->glProgramParameteri, "glProgramParameteri");
+    }
+  };
+  static std::unique_ptr<ProgramBinaryFunctions> pbFun;
+
+  // functions of GL_KHR_debug
+  struct DebugOutputFunctions
+  {
+    typedef void (QOPENGLF_APIENTRYP DebugProc) (GLenum, GLenum, GLuint, GLenum, GLsizei,
+                                                 const GLchar*, const void*);
+    typedef void (QOPENGLF_APIENTRYP DebugMessageCallback) (DebugProc, const void*);
+    typedef void (QOPENGLF_APIENTRYP DebugMessageControl) (GLenum, GLenum, GLenum, GLsizei,
+                                                           const GLuint*, GLboolean);
+
+    DebugMessageCallback glDebugMessageCallback;
+    DebugMessageControl  glDebugMessageControl;
+
+    bool initialize ()
+    {
+      return resolve (this->glDebugMessageCallback, "glDebugMessageCallback") &&
+             resolve (this->glDebugMessageControl, "glDebugMessageControl");
+    }
+  };
+  static std::unique_ptr<DebugOutputFunctions> doFun;
+
+  static const char* debugSourceName (GLenum source)
+  {
+    switch (source)
+    {
+      case GL_DEBUG_SOURCE_API:
+        return "api";
+      case GL_DEBUG_SOURCE_WINDOW_SYSTEM:
+        return "window system";
+      case GL_DEBUG_SOURCE_SHADER_COMPILER:
+        return "shader compiler";
+      case GL_DEBUG_SOURCE_THIRD_PARTY:
+        return "third party";
+      case GL_DEBUG_SOURCE_APPLICATION:
+        return "application";
+      default:
+        return "other";
+    }
+  }
+
+  static const char* debugTypeName (GLenum type)
+  {
+    switch (type)
+    {
+      case GL_DEBUG_TYPE_ERROR:
+        return "error";
+      case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+        return "deprecated behavior";
+      case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+        return "undefined behavior";
+      case GL_DEBUG_TYPE_PORTABILITY:
+        return "portability";
+      case GL_DEBUG_TYPE_PERFORMANCE:
+        return "performance";
+      default:
+        return "other";
+    }
+  }
+
+  static int debugSeverityRank (GLenum severity)
+  {
+    switch (severity)
+    {
+      case GL_DEBUG_SEVERITY_HIGH:
+        return 3;
+      case GL_DEBUG_SEVERITY_MEDIUM:
+        return 2;
+      case GL_DEBUG_SEVERITY_LOW:
+        return 1;
+      default:
+        return 0;
+    }
+  }
+
+  /* Messages are reported synchronously, such that their marks in the profiler are placed on the
+   * thread and at the time of the call that caused them.
+   */
+  static void QOPENGLF_APIENTRY debugMessage (GLenum source, GLenum type, GLuint id,
+                                              GLenum severity, GLsizei, const GLchar* message,
+                                              const void*)
+  {
+    switch (type)
+    {
+      case GL_DEBUG_TYPE_ERROR:
+        PROFILE_MARK ("opengl/error")
+        break;
+      case GL_DEBUG_TYPE_PERFORMANCE:
+        PROFILE_MARK ("opengl/performance")
+        break;
+      default:
+        PROFILE_MARK ("opengl/other")
+        break;
+    }
+
+    if (debugSeverityRank (severity) >= 2)
+    {
+      DILAY_WARN ("OpenGL %s %s (%u): %s", debugSourceName (source), debugTypeName (type), id,
+                  message)
+    }
+    else
+    {
+      DILAY_INFO ("OpenGL %s %s (%u): %s", debugSourceName (source), debugTypeName (type), id,
+                  message)
+    }
+  }
+
+  // timeout of a single wait on a sync object in nanoseconds
+  static constexpr GLuint64 syncTimeout = 1000000;
+
   void setDefaultFormat ()
   {
     QSurfaceFormat format;
@@ -55,7 +313,16 @@ namespace OpenGL
     QSurfaceFormat::setDefaultFormat (format);
   }
 
-  void initializeFunctions (bool initGeometryShader)
+  void requestDebugContext ()
+  {
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat ();
+
+    format.setOption (QSurfaceFormat::DebugContext);
+    QSurfaceFormat::setDefaultFormat (format);
+  }
+
+  // resolves the functions of the current thread that both the main and shared contexts use
+  static void initializeThreadFunctions ()
   {
     fun = QOpenGLContext::currentContext ()->versionFunctions<QOpenGLFunctions_2_1> ();
     if (fun == nullptr)
@@ -64,6 +331,24 @@ namespace OpenGL
     }
     fun->initializeOpenGLFunctions ();
 
+    const QOpenGLContext* context = QOpenGLContext::currentContext ();
+    if (context->hasExtension (QByteArray ("GL_ARB_buffer_storage")) &&
+        context->hasExtension (QByteArray ("GL_ARB_map_buffer_range")) &&
+        context->hasExtension (QByteArray ("GL_ARB_sync")))
+    {
+      bsFun = std::make_unique<BufferStorageFunctions> ();
+      if (bsFun->initialize () == false)
+      {
+        DILAY_WARN ("could not initialize GL_ARB_buffer_storage extension")
+        bsFun.reset ();
+      }
+    }
+  }
+
+  void initializeFunctions (bool initGeometryShader)
+  {
+    initializeThreadFunctions ();
+
     if (initGeometryShader)
     {
       const bool support =
@@ -79,11 +364,122 @@ namespace OpenGL
       }
     }
 
+    const QOpenGLContext* context = QOpenGLContext::currentContext ();
+
+    if (context->hasExtension (QByteArray ("GL_ARB_draw_instanced")) &&
+        context->hasExtension (QByteArray ("GL_ARB_instanced_arrays")))
+    {
+      inFun = std::make_unique<InstancingFunctions> ();
+      if (inFun->initialize () == false)
+      {
+        DILAY_WARN ("could not initialize GL_ARB_instanced_arrays extension")
+        inFun.reset ();
+      }
+    }
+
+    if (context->hasExtension (QByteArray ("GL_ARB_vertex_array_object")))
+    {
+      vaFun = std::make_unique<VertexArrayFunctions> ();
+      if (vaFun->initialize () == false)
+      {
+        DILAY_WARN ("could not initialize GL_ARB_vertex_array_object extension")
+        vaFun.reset ();
+      }
+    }
+
+    if (context->hasExtension (QByteArray ("GL_ARB_uniform_buffer_object")))
+    {
+      ubFun = std::make_unique<UniformBufferFunctions> ();
+      if (ubFun->initialize () == false)
+      {
+        DILAY_WARN ("could not initialize GL_ARB_uniform_buffer_object extension")
+        ubFun.reset ();
+      }
+    }
+
+    if (context->hasExtension (QByteArray ("GL_ARB_timer_query")))
+    {
+      tqFun = std::make_unique<TimerQueryFunctions> ();
+      if (tqFun->initialize () == false)
+      {
+        DILAY_WARN ("could not initialize GL_ARB_timer_query extension")
+        tqFun.reset ();
+      }
+    }
+
+    if (context->hasExtension (QByteArray ("GL_ARB_multi_draw_indirect")) &&
+        context->hasExtension (QByteArray ("GL_ARB_base_instance")))
+    {
+      mdFun = std::make_unique<MultiDrawIndirectFunctions> ();
+      if (mdFun->initialize () == false)
+      {
+        DILAY_WARN ("could not initialize GL_ARB_multi_draw_indirect extension")
+        mdFun.reset ();
+      }
+    }
+
+    if (context->hasExtension (QByteArray ("GL_ARB_get_program_binary")))
+    {
+      pbFun = std::make_unique<ProgramBinaryFunctions> ();
+      if (pbFun->initialize () == false)
+      {
+        DILAY_WARN ("could not initialize GL_ARB_get_program_binary extension")
+        pbFun.reset ();
+      }
+    }
+
     DILAY_INFO ("OpenGL version: %s", fun->glGetString (GL_VERSION));
     DILAY_INFO ("OpenGL vendor: %s", fun->glGetString (GL_VENDOR));
     DILAY_INFO ("OpenGL renderer: %s", fun->glGetString (GL_RENDERER));
     DILAY_INFO ("OpenGL GLSL version: %s", fun->glGetString (GL_SHADING_LANGUAGE_VERSION));
     DILAY_INFO ("OpenGL supports GL_EXT_geometry_shader4: %i", gsFun != nullptr);
+    DILAY_INFO ("OpenGL supports GL_ARB_buffer_storage: %i", bsFun != nullptr);
+    DILAY_INFO ("OpenGL supports GL_ARB_instanced_arrays: %i", inFun != nullptr);
+    DILAY_INFO ("OpenGL supports GL_ARB_vertex_array_object: %i", vaFun != nullptr);
+    DILAY_INFO ("OpenGL supports GL_ARB_uniform_buffer_object: %i", ubFun != nullptr);
+    DILAY_INFO ("OpenGL supports GL_ARB_timer_query: %i", tqFun != nullptr);
+    DILAY_INFO ("OpenGL supports GL_ARB_multi_draw_indirect: %i", mdFun != nullptr);
+    DILAY_INFO ("OpenGL supports GL_ARB_get_program_binary: %i", pbFun != nullptr);
+  }
+
+  void initializeSharedFunctions ()
+  {
+    assert (QOpenGLContext::currentContext ()->shareContext ());
+    initializeThreadFunctions ();
+  }
+
+  void initializeDebugOutput (int minSeverity)
+  {
+    const QOpenGLContext* context = QOpenGLContext::currentContext ();
+
+    if (context->hasExtension (QByteArray ("GL_KHR_debug")) == false)
+    {
+      DILAY_WARN ("OpenGL debug output requires GL_KHR_debug extension")
+      return;
+    }
+
+    doFun = std::make_unique<DebugOutputFunctions> ();
+    if (doFun->initialize () == false)
+    {
+      DILAY_WARN ("could not initialize GL_KHR_debug extension")
+      doFun.reset ();
+      return;
+    }
+
+    for (GLenum severity : {GL_DEBUG_SEVERITY_NOTIFICATION, GL_DEBUG_SEVERITY_LOW,
+                            GL_DEBUG_SEVERITY_MEDIUM, GL_DEBUG_SEVERITY_HIGH})
+    {
+      const bool isEnabled = debugSeverityRank (severity) >= minSeverity;
+
+      doFun->glDebugMessageControl (GL_DONT_CARE, GL_DONT_CARE, severity, 0, nullptr,
+                                    isEnabled ? GL_TRUE : GL_FALSE);
+    }
+    doFun->glDebugMessageCallback (debugMessage, nullptr);
+    fun->glEnable (GL_DEBUG_OUTPUT);
+    fun->glEnable (GL_DEBUG_OUTPUT_SYNCHRONOUS);
+
+    const bool isDebugContext = context->format ().testOption (QSurfaceFormat::DebugContext);
+    DILAY_INFO ("OpenGL debug output enabled, debug context: %i", isDebugContext);
   }
 
   DELEGATE_GL_CONSTANT (Always, GL_ALWAYS);
@@ -92,13 +488,16 @@ namespace OpenGL
   DELEGATE_GL_CONSTANT (Blend, GL_BLEND);
   DELEGATE_GL_CONSTANT (BufferSize, GL_BUFFER_SIZE);
   DELEGATE_GL_CONSTANT (ColorBufferBit, GL_COLOR_BUFFER_BIT);
+  DELEGATE_GL_CONSTANT (ConstantAlpha, GL_CONSTANT_ALPHA);
   DELEGATE_GL_CONSTANT (CullFace, GL_CULL_FACE);
   DELEGATE_GL_CONSTANT (CW, GL_CW);
   DELEGATE_GL_CONSTANT (CCW, GL_CCW);
   DELEGATE_GL_CONSTANT (Decr, GL_DECR);
   DELEGATE_GL_CONSTANT (DecrWrap, GL_DECR_WRAP);
   DELEGATE_GL_CONSTANT (DepthBufferBit, GL_DEPTH_BUFFER_BIT);
+  DELEGATE_GL_CONSTANT (DepthComponent, GL_DEPTH_COMPONENT);
   DELEGATE_GL_CONSTANT (DepthTest, GL_DEPTH_TEST);
+  DELEGATE_GL_CONSTANT (DrawIndirectBuffer, GL_DRAW_INDIRECT_BUFFER);
   DELEGATE_GL_CONSTANT (DstColor, GL_DST_COLOR);
   DELEGATE_GL_CONSTANT (ElementArrayBuffer, GL_ELEMENT_ARRAY_BUFFER);
   DELEGATE_GL_CONSTANT (Equal, GL_EQUAL);
@@ -108,24 +507,45 @@ namespace OpenGL
   DELEGATE_GL_CONSTANT (FrontAndBack, GL_FRONT_AND_BACK);
   DELEGATE_GL_CONSTANT (FuncAdd, GL_FUNC_ADD);
   DELEGATE_GL_CONSTANT (Greater, GL_GREATER);
+  DELEGATE_GL_CONSTANT (InvalidIndex, GL_INVALID_INDEX);
   DELEGATE_GL_CONSTANT (Incr, GL_INCR);
   DELEGATE_GL_CONSTANT (IncrWrap, GL_INCR_WRAP);
   DELEGATE_GL_CONSTANT (Invert, GL_INVERT);
   DELEGATE_GL_CONSTANT (Keep, GL_KEEP);
   DELEGATE_GL_CONSTANT (LEqual, GL_LEQUAL);
   DELEGATE_GL_CONSTANT (Line, GL_LINE);
+  DELEGATE_GL_CONSTANT (Linear, GL_LINEAR);
   DELEGATE_GL_CONSTANT (Lines, GL_LINES);
+  DELEGATE_GL_CONSTANT (MapCoherentBit, GL_MAP_COHERENT_BIT);
+  DELEGATE_GL_CONSTANT (MapPersistentBit, GL_MAP_PERSISTENT_BIT);
+  DELEGATE_GL_CONSTANT (MapWriteBit, GL_MAP_WRITE_BIT);
+  DELEGATE_GL_CONSTANT (Nearest, GL_NEAREST);
   DELEGATE_GL_CONSTANT (Never, GL_NEVER);
+  DELEGATE_GL_CONSTANT (OneMinusConstantAlpha, GL_ONE_MINUS_CONSTANT_ALPHA);
+  DELEGATE_GL_CONSTANT (PixelPackBuffer, GL_PIXEL_PACK_BUFFER);
   DELEGATE_GL_CONSTANT (PolygonOffsetFill, GL_POLYGON_OFFSET_FILL);
+  DELEGATE_GL_CONSTANT (QueryResult, GL_QUERY_RESULT);
+  DELEGATE_GL_CONSTANT (QueryResultAvailable, GL_QUERY_RESULT_AVAILABLE);
+  DELEGATE_GL_CONSTANT (ReadOnly, GL_READ_ONLY);
   DELEGATE_GL_CONSTANT (Replace, GL_REPLACE);
+  DELEGATE_GL_CONSTANT (SamplesPassed, GL_SAMPLES_PASSED);
+  DELEGATE_GL_CONSTANT (Short, GL_SHORT);
   DELEGATE_GL_CONSTANT (StaticDraw, GL_STATIC_DRAW);
   DELEGATE_GL_CONSTANT (StencilBufferBit, GL_STENCIL_BUFFER_BIT);
   DELEGATE_GL_CONSTANT (StencilTest, GL_STENCIL_TEST);
+  DELEGATE_GL_CONSTANT (StreamDraw, GL_STREAM_DRAW);
+  DELEGATE_GL_CONSTANT (StreamRead, GL_STREAM_READ);
+  DELEGATE_GL_CONSTANT (SyncGpuCommandsComplete, GL_SYNC_GPU_COMMANDS_COMPLETE);
+  DELEGATE_GL_CONSTANT (Timestamp, GL_TIMESTAMP);
   DELEGATE_GL_CONSTANT (Triangles, GL_TRIANGLES);
+  DELEGATE_GL_CONSTANT (UniformBuffer, GL_UNIFORM_BUFFER);
   DELEGATE_GL_CONSTANT (UnsignedInt, GL_UNSIGNED_INT);
+  DELEGATE_GL_CONSTANT (UnsignedShort, GL_UNSIGNED_SHORT);
   DELEGATE_GL_CONSTANT (Zero, GL_ZERO);
 
+  DELEGATE2_GL (void, glBeginQuery, unsigned int, unsigned int)
   DELEGATE2_GL (void, glBindBuffer, unsigned int, unsigned int)
+  DELEGATE4_GL (void, glBlendColor, float, float, float, float)
   DELEGATE1_GL (void, glBlendEquation, unsigned int)
   DELEGATE2_GL (void, glBlendFunc, unsigned int, unsigned int)
   DELEGATE4_GL (void, glBufferData, unsigned int, unsigned int, const void*, unsigned int)
@@ -139,15 +559,25 @@ namespace OpenGL
   DELEGATE1_GL (void, glDepthMask, bool)
   DELEGATE1_GL (void, glDisable, unsigned int)
   DELEGATE1_GL (void, glDisableVertexAttribArray, unsigned int)
+  DELEGATE3_GL (void, glDrawArrays, unsigned int, int, unsigned int)
+  DELEGATE2_GL (void, glDeleteQueries, unsigned int, const unsigned int*)
   DELEGATE4_GL (void, glDrawElements, unsigned int, unsigned int, unsigned int, const void*)
   DELEGATE1_GL (void, glEnable, unsigned int)
   DELEGATE1_GL (void, glEnableVertexAttribArray, unsigned int)
+  DELEGATE1_GL (void, glEndQuery, unsigned int)
+  DELEGATE_GL (void, glFinish)
   DELEGATE1_GL (void, glFrontFace, unsigned int)
   DELEGATE2_GL (void, glGenBuffers, unsigned int, unsigned int*)
+  DELEGATE2_GL (void, glGenQueries, unsigned int, unsigned int*)
   DELEGATE3_GL (void, glGetBufferParameteriv, unsigned int, unsigned int, int*)
+  DELEGATE3_GL (void, glGetQueryObjectiv, unsigned int, unsigned int, int*)
   DELEGATE2_GL (int, glGetUniformLocation, unsigned int, const char*)
   DELEGATE1_GL (bool, glIsBuffer, unsigned int)
   DELEGATE1_GL (bool, glIsProgram, unsigned int)
+  DELEGATE2_GL (void*, glMapBuffer, unsigned int, unsigned int)
+  DELEGATE4_GL (void, glMultiDrawArrays, unsigned int, const int*, const int*, unsigned int)
+  DELEGATE5_GL (void, glMultiDrawElements, unsigned int, const int*, unsigned int,
+                const void* const*, unsigned int)
   DELEGATE2_GL (void, glPolygonMode, unsigned int, unsigned int)
   DELEGATE2_GL (void, glPolygonOffset, float, float)
   DELEGATE3_GL (void, glStencilFunc, unsigned int, int, unsigned int)
@@ -155,13 +585,131 @@ namespace OpenGL
   DELEGATE2_GL (void, glUniform1f, int, float)
   DELEGATE4_GL (void, glUniformMatrix3fv, int, unsigned int, bool, const float*)
   DELEGATE4_GL (void, glUniformMatrix4fv, int, unsigned int, bool, const float*)
+  DELEGATE1_GL (bool, glUnmapBuffer, unsigned int)
   DELEGATE1_GL (void, glUseProgram, unsigned int)
   DELEGATE6_GL (void, glVertexAttribPointer, unsigned int, int, unsigned int, bool, unsigned int,
                 const void*)
   DELEGATE4_GL (void, glViewport, unsigned int, unsigned int, unsigned int, unsigned int)
 
+  void glReadPixels (int x, int y, unsigned int width, unsigned int height, unsigned int format,
+                     unsigned int type, void* data)
+  {
+    fun->glReadPixels (x, y, width, height, format, type, data);
+  }
+
+  void glBufferStorage (unsigned int target, unsigned int size, const void* data,
+                        unsigned int flags)
+  {
+    assert (bsFun);
+    bsFun->glBufferStorage (target, size, data, flags);
+  }
+
+  unsigned int glClientWaitSync (void* sync, unsigned int flags, unsigned long long timeout)
+  {
+    assert (bsFun);
+    return bsFun->glClientWaitSync (static_cast<GLsync> (sync), flags, timeout);
+  }
+
+  void glDeleteSync (void* sync)
+  {
+    assert (bsFun);
+    bsFun->glDeleteSync (static_cast<GLsync> (sync));
+  }
+
+  void* glFenceSync (unsigned int condition, unsigned int flags)
+  {
+    assert (bsFun);
+    return bsFun->glFenceSync (condition, flags);
+  }
+
+  void* glMapBufferRange (unsigned int target, unsigned int offset, unsigned int length,
+                          unsigned int access)
+  {
+    assert (bsFun);
+    return bsFun->glMapBufferRange (target, offset, length, access);
+  }
+
+  void glBindBufferBase (unsigned int target, unsigned int index, unsigned int buffer)
+  {
+    assert (ubFun);
+    ubFun->glBindBufferBase (target, index, buffer);
+  }
+
+  void glBindVertexArray (unsigned int id)
+  {
+    assert (vaFun);
+    vaFun->glBindVertexArray (id);
+  }
+
+  void glDrawElementsInstanced (unsigned int mode, unsigned int count, unsigned int type,
+                                const void* indices, unsigned int primcount)
+  {
+    assert (inFun);
+    inFun->glDrawElementsInstanced (mode, count, type, indices, primcount);
+  }
+
+  void glGenVertexArrays (unsigned int n, unsigned int* ids)
+  {
+    assert (vaFun);
+    vaFun->glGenVertexArrays (n, ids);
+  }
+
+  void glGetQueryObjectui64v (unsigned int id, unsigned int name, unsigned long long* value)
+  {
+    assert (tqFun);
+
+    GLuint64 v = 0;
+    tqFun->glGetQueryObjectui64v (id, name, &v);
+    *value = v;
+  }
+
+  unsigned int glGetUniformBlockIndex (unsigned int program, const char* name)
+  {
+    assert (ubFun);
+    return ubFun->glGetUniformBlockIndex (program, name);
+  }
+
+  void glMultiDrawElementsIndirect (unsigned int mode, unsigned int type, const void* indirect,
+                                    unsigned int drawcount, unsigned int stride)
+  {
+    assert (mdFun);
+    mdFun->glMultiDrawElementsIndirect (mode, type, indirect, drawcount, stride);
+  }
+
+  void glQueryCounter (unsigned int id, unsigned int target)
+  {
+    assert (tqFun);
+    tqFun->glQueryCounter (id, target);
+  }
+
+  void glUniformBlockBinding (unsigned int program, unsigned int index, unsigned int binding)
+  {
+    assert (ubFun);
+    ubFun->glUniformBlockBinding (program, index, binding);
+  }
+
+  void glVertexAttribDivisor (unsigned int index, unsigned int divisor)
+  {
+    assert (inFun);
+    inFun->glVertexAttribDivisor (index, divisor);
+  }
+
+  bool isInitialized () { return fun != nullptr; }
+
   bool hasGeometryShader () { return bool(gsFun); }
 
+  bool hasBufferStorage () { return bool(bsFun); }
+
+  bool hasInstancing () { return bool(inFun); }
+
+  bool hasVertexArrayObject () { return bool(vaFun); }
+
+  bool hasUniformBufferObject () { return bool(ubFun); }
+
+  bool hasTimerQuery () { return bool(tqFun); }
+
+  bool hasMultiDrawIndirect () { return bool(mdFun); }
+
   void glUniformVec3 (unsigned int id, const glm::vec3& v) { fun->glUniform3f (id, v.x, v.y, v.z); }
   void glUniformVec4 (unsigned int id, const glm::vec4& v)
   {
@@ -177,6 +725,42 @@ namespace OpenGL
     id = 0;
   }
 
+  void safeDeleteVertexArray (unsigned int& id)
+  {
+    if (id > 0)
+    {
+      assert (vaFun);
+      vaFun->glDeleteVertexArrays (1, &id);
+    }
+    id = 0;
+  }
+
+  void safeDeleteSync (void*& sync)
+  {
+    if (sync != nullptr)
+    {
+      OpenGL::glDeleteSync (sync);
+    }
+    sync = nullptr;
+  }
+
+  void waitSync (void* sync)
+  {
+    if (sync != nullptr)
+    {
+      GLenum status;
+      do
+      {
+        status = OpenGL::glClientWaitSync (sync, GL_SYNC_FLUSH_COMMANDS_BIT, syncTimeout);
+      } while (status == GL_TIMEOUT_EXPIRED);
+
+      if (status == GL_WAIT_FAILED)
+      {
+        DILAY_WARN ("could not wait for sync object")
+      }
+    }
+  }
+
   void safeDeleteShader (unsigned int& id)
   {
     if (id > 0 && fun->glIsShader (id) == GL_TRUE)
@@ -204,9 +788,103 @@ namespace OpenGL
     id = 0;
   }
 
+  /* Binaries of linked programs are cached in files, which are named by a hash of the program's
+   * sources and of the driver, such that updated drivers do not load outdated binaries.
+   */
+  static QString programBinaryPath (const char* vertexShader, const char* fragmentShader,
+                                    bool loadGeometryShader)
+  {
+    const QString cacheDirName (QStandardPaths::writableLocation (QStandardPaths::CacheLocation));
+
+    if (cacheDirName.isEmpty ())
+    {
+      return QString ();
+    }
+    QCryptographicHash hash (QCryptographicHash::Sha1);
+
+    hash.addData (reinterpret_cast<const char*> (fun->glGetString (GL_VENDOR)));
+    hash.addData (reinterpret_cast<const char*> (fun->glGetString (GL_RENDERER)));
+    hash.addData (reinterpret_cast<const char*> (fun->glGetString (GL_VERSION)));
+    hash.addData (vertexShader);
+    hash.addData (fragmentShader);
+    hash.addData (loadGeometryShader ? Shader::geometryShader () : "");
+
+    const QString fileName = QString::fromLatin1 (hash.result ().toHex ()) + ".bin";
+
+    return QDir (cacheDirName).filePath ("shaders/" + fileName);
+  }
+
+  // returns `0` if there is no cached binary or if the driver rejects it
+  static GLuint loadProgramBinary (const QString& path)
+  {
+    QFile file (path);
+
+    if (path.isEmpty () || file.open (QIODevice::ReadOnly) == false)
+    {
+      return 0;
+    }
+    const QByteArray data = file.readAll ();
+    GLenum           format;
+
+    if (data.size () <= int(sizeof (format)))
+    {
+      return 0;
+    }
+    std::memcpy (&format, data.constData (), sizeof (format));
+
+    GLuint programId = fun->glCreateProgram ();
+    GLint  status;
+
+    pbFun->glProgramBinary (programId, format, data.constData () + sizeof (format),
+                            GLsizei (data.size () - int(sizeof (format))));
+    fun->glGetProgramiv (programId, GL_LINK_STATUS, &status);
+
+    if (status == GL_FALSE)
+    {
+      OpenGL::safeDeleteProgram (programId);
+      return 0;
+    }
+    return programId;
+  }
+
+  static void saveProgramBinary (GLuint programId, const QString& path)
+  {
+    GLint length = 0;
+    fun->glGetProgramiv (programId, GL_PROGRAM_BINARY_LENGTH, &length);
+
+    if (path.isEmpty () || length <= 0 || QDir ().mkpath (QFileInfo (path).path ()) == false)
+    {
+      return;
+    }
+    QByteArray data (int(sizeof (GLenum)) + length, '\0');
+    GLenum     format;
+
+    pbFun->glGetProgramBinary (programId, length, nullptr, &format,
+                               data.data () + sizeof (format));
+    std::memcpy (data.data (), &format, sizeof (format));
+
+    QFile file (path);
+    if (file.open (QIODevice::WriteOnly) == false || file.write (data) != data.size ())
+    {
+      DILAY_WARN ("could not write program binary '%s'", path.toStdString ().c_str ())
+    }
+  }
+
   unsigned int loadProgram (const char* vertexShader, const char* fragmentShader,
                             bool loadGeometryShader)
   {
+    const QString binaryPath =
+      pbFun ? programBinaryPath (vertexShader, fragmentShader, loadGeometryShader) : QString ();
+
+    if (pbFun)
+    {
+      const GLuint programId = loadProgramBinary (binaryPath);
+      if (programId != 0)
+      {
+        return programId;
+      }
+    }
+
     auto showInfoLog = [](GLuint id) {
       const int maxLogLength = 1000;
       char      logBuffer[maxLogLength];
@@ -255,7 +933,16 @@ namespace OpenGL
 
     fun->glBindAttribLocation (programId, OpenGL::PositionIndex, "position");
     fun->glBindAttribLocation (programId, OpenGL::NormalIndex, "normal");
+    fun->glBindAttribLocation (programId, OpenGL::InstanceModelIndex, "instanceModel");
+    fun->glBindAttribLocation (programId, OpenGL::InstanceModelNormalIndex,
+                               "instanceModelNormal");
+    fun->glBindAttribLocation (programId, OpenGL::InstanceColorIndex, "instanceColor");
+    fun->glBindAttribLocation (programId, OpenGL::CornerIndex, "corner");
 
+    if (pbFun)
+    {
+      pbFun->glProgramParameteri (programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     fun->glLinkProgram (programId);
 
     GLint status;
@@ -270,6 +957,11 @@ namespace OpenGL
     OpenGL::safeDeleteShader (vsId);
     OpenGL::safeDeleteShader (fsId);
     OpenGL::safeDeleteShader (gmId);
+
+    if (pbFun)
+    {
+      saveProgramBinary (programId, binaryPath);
+    }
     return programId;
   }
 
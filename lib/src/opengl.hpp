@@ -12,7 +12,17 @@ namespace OpenGL
 {
   // QT related
   void setDefaultFormat ();
+  // requests contexts with debug output, which must be done before a context is created
+  void requestDebugContext ();
   void initializeFunctions (bool);
+  // initializes the functions of a thread whose current context shares the main context's objects
+  void initializeSharedFunctions ();
+  /* Routes the messages of GL_KHR_debug, e.g. performance warnings about stalls, with at least the
+   * given severity (0: notification, 1: low, 2: medium, 3: high) to the log and the profiler.
+   */
+  void initializeDebugOutput (int);
+  // whether functions have been initialized, which is not the case without an OpenGL context
+  bool isInitialized ();
 
   // wrappers
   unsigned int Always ();
@@ -21,13 +31,16 @@ namespace OpenGL
   unsigned int Blend ();
   unsigned int BufferSize ();
   unsigned int ColorBufferBit ();
+  unsigned int ConstantAlpha ();
   unsigned int CullFace ();
   unsigned int CW ();
   unsigned int CCW ();
   unsigned int Decr ();
   unsigned int DecrWrap ();
   unsigned int DepthBufferBit ();
+  unsigned int DepthComponent ();
   unsigned int DepthTest ();
+  unsigned int DrawIndirectBuffer ();
   unsigned int DstColor ();
   unsigned int ElementArrayBuffer ();
   unsigned int Equal ();
@@ -39,66 +52,132 @@ namespace OpenGL
   unsigned int Greater ();
   unsigned int Incr ();
   unsigned int IncrWrap ();
+  unsigned int InvalidIndex ();
   unsigned int Invert ();
   unsigned int Keep ();
   unsigned int LEqual ();
   unsigned int Line ();
+  unsigned int Linear ();
   unsigned int Lines ();
+  unsigned int MapCoherentBit ();
+  unsigned int MapPersistentBit ();
+  unsigned int MapWriteBit ();
+  unsigned int Nearest ();
   unsigned int Never ();
+  unsigned int OneMinusConstantAlpha ();
+  unsigned int PixelPackBuffer ();
   unsigned int PolygonOffsetFill ();
+  unsigned int QueryResult ();
+  unsigned int QueryResultAvailable ();
+  unsigned int ReadOnly ();
   unsigned int Replace ();
+  unsigned int SamplesPassed ();
+  unsigned int Short ();
   unsigned int StaticDraw ();
   unsigned int StencilBufferBit ();
   unsigned int StencilTest ();
+  unsigned int StreamDraw ();
+  unsigned int StreamRead ();
+  unsigned int SyncGpuCommandsComplete ();
+  unsigned int Timestamp ();
   unsigned int Triangles ();
+  unsigned int UniformBuffer ();
   unsigned int UnsignedInt ();
+  unsigned int UnsignedShort ();
   unsigned int Zero ();
 
-  void glBindBuffer (unsigned int, unsigned int);
-  void glBlendEquation (unsigned int);
-  void glBlendFunc (unsigned int, unsigned);
-  void glBufferData (unsigned int, unsigned int, const void*, unsigned int);
-  void glBufferSubData (unsigned int, unsigned int, unsigned int, const void*);
-  void glClear (unsigned int);
-  void glClearColor (float, float, float, float);
-  void glClearStencil (int);
-  void glColorMask (bool, bool, bool, bool);
-  void glCullFace (unsigned int);
-  void glDepthFunc (unsigned int);
-  void glDepthMask (bool);
-  void glDisable (unsigned int);
-  void glDisableVertexAttribArray (unsigned int);
-  void glDrawElements (unsigned int, unsigned int, unsigned int, const void*);
-  void glEnable (unsigned int);
-  void glEnableVertexAttribArray (unsigned int);
-  void glFrontFace (unsigned int);
-  void glGenBuffers (unsigned int, unsigned int*);
-  void glGetBufferParameteriv (unsigned int, unsigned int, int*);
-  int  glGetUniformLocation (unsigned int, const char*);
-  bool glIsBuffer (unsigned int);
-  bool glIsProgram (unsigned int);
-  void glPolygonMode (unsigned int, unsigned int);
-  void glPolygonOffset (float, float);
-  void glStencilFunc (unsigned int, int, unsigned int);
-  void glStencilOp (unsigned int, unsigned int, unsigned int);
-  void glUniform1f (int, float);
-  void glUniformMatrix3fv (int, unsigned int, bool, const float*);
-  void glUniformMatrix4fv (int, unsigned int, bool, const float*);
-  void glUseProgram (unsigned int);
-  void glVertexAttribPointer (unsigned int, int, unsigned int, bool, unsigned int, const void*);
-  void glViewport (unsigned int, unsigned int, unsigned int, unsigned int);
+  void         glBeginQuery (unsigned int, unsigned int);
+  void         glBindBuffer (unsigned int, unsigned int);
+  void         glBindBufferBase (unsigned int, unsigned int, unsigned int);
+  void         glBindVertexArray (unsigned int);
+  void         glBlendColor (float, float, float, float);
+  void         glBlendEquation (unsigned int);
+  void         glBlendFunc (unsigned int, unsigned);
+  void         glBufferData (unsigned int, unsigned int, const void*, unsigned int);
+  void         glBufferStorage (unsigned int, unsigned int, const void*, unsigned int);
+  void         glBufferSubData (unsigned int, unsigned int, unsigned int, const void*);
+  void         glClear (unsigned int);
+  void         glClearColor (float, float, float, float);
+  void         glClearStencil (int);
+  unsigned int glClientWaitSync (void*, unsigned int, unsigned long long);
+  void         glColorMask (bool, bool, bool, bool);
+  void         glCullFace (unsigned int);
+  void         glDeleteQueries (unsigned int, const unsigned int*);
+  void         glDeleteSync (void*);
+  void         glDepthFunc (unsigned int);
+  void         glDepthMask (bool);
+  void         glDisable (unsigned int);
+  void         glDisableVertexAttribArray (unsigned int);
+  void         glDrawArrays (unsigned int, int, unsigned int);
+  void         glDrawElements (unsigned int, unsigned int, unsigned int, const void*);
+  void         glDrawElementsInstanced (unsigned int, unsigned int, unsigned int, const void*,
+                                        unsigned int);
+  void         glEnable (unsigned int);
+  void         glEnableVertexAttribArray (unsigned int);
+  void         glEndQuery (unsigned int);
+  void*        glFenceSync (unsigned int, unsigned int);
+  void         glFinish ();
+  void         glFrontFace (unsigned int);
+  void         glGenBuffers (unsigned int, unsigned int*);
+  void         glGenQueries (unsigned int, unsigned int*);
+  void         glGenVertexArrays (unsigned int, unsigned int*);
+  void         glGetBufferParameteriv (unsigned int, unsigned int, int*);
+  void         glGetQueryObjectiv (unsigned int, unsigned int, int*);
+  void         glGetQueryObjectui64v (unsigned int, unsigned int, unsigned long long*);
+  unsigned int glGetUniformBlockIndex (unsigned int, const char*);
+  int          glGetUniformLocation (unsigned int, const char*);
+  bool         glIsBuffer (unsigned int);
+  bool         glIsProgram (unsigned int);
+  void*        glMapBuffer (unsigned int, unsigned int);
+  void*        glMapBufferRange (unsigned int, unsigned int, unsigned int, unsigned int);
+  void         glMultiDrawArrays (unsigned int, const int*, const int*, unsigned int);
+  void         glMultiDrawElements (unsigned int, const int*, unsigned int, const void* const*,
+                                    unsigned int);
+  void         glMultiDrawElementsIndirect (unsigned int, unsigned int, const void*,
+                                            unsigned int, unsigned int);
+  void         glPolygonMode (unsigned int, unsigned int);
+  void         glPolygonOffset (float, float);
+  void         glQueryCounter (unsigned int, unsigned int);
+  void         glReadPixels (int, int, unsigned int, unsigned int, unsigned int, unsigned int,
+                             void*);
+  void         glStencilFunc (unsigned int, int, unsigned int);
+  void         glStencilOp (unsigned int, unsigned int, unsigned int);
+  void         glUniform1f (int, float);
+  void         glUniformBlockBinding (unsigned int, unsigned int, unsigned int);
+  void         glUniformMatrix3fv (int, unsigned int, bool, const float*);
+  void         glUniformMatrix4fv (int, unsigned int, bool, const float*);
+  bool         glUnmapBuffer (unsigned int);
+  void         glUseProgram (unsigned int);
+  void         glVertexAttribDivisor (unsigned int, unsigned int);
+  void         glVertexAttribPointer (unsigned int, int, unsigned int, bool, unsigned int,
+                                      const void*);
+  void         glViewport (unsigned int, unsigned int, unsigned int, unsigned int);
 
   // utilities
   enum VertexAttributIndex
   {
     PositionIndex = 0,
-    NormalIndex = 1
+    NormalIndex = 1,
+    InstanceModelIndex = 2,       // mat4x4: occupies indices 2 to 5
+    InstanceModelNormalIndex = 6, // mat3x3: occupies indices 6 to 8
+    InstanceColorIndex = 9,
+    CornerIndex = 10
   };
 
   bool         hasGeometryShader ();
+  bool         hasBufferStorage ();
+  bool         hasInstancing ();
+  bool         hasVertexArrayObject ();
+  bool         hasUniformBufferObject ();
+  bool         hasTimerQuery ();
+  // whether `glMultiDrawElementsIndirect` with base instances is supported
+  bool         hasMultiDrawIndirect ();
   void         glUniformVec3 (unsigned int, const glm::vec3&);
   void         glUniformVec4 (unsigned int, const glm::vec4&);
   void         safeDeleteBuffer (unsigned int&);
+  void         safeDeleteVertexArray (unsigned int&);
+  void         safeDeleteSync (void*&);
+  void         waitSync (void*);
   void         safeDeleteShader (unsigned int&);
   void         safeDeleteProgram (unsigned int&);
   unsigned int loadProgram (const char*, const char*, bool);
@@ -0,0 +1,137 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include <list>
+#include "color.hpp"
+#include "mesh.hpp"
+#include "overlay-batch.hpp"
+#include "render-mode.hpp"
+
+namespace
+{
+  struct Group
+  {
+    bool isLines;
+    bool depthTest;
+    Mesh mesh;
+
+    Group (bool l, bool d, const Color& color)
+      : isLines (l)
+      , depthTest (d)
+    {
+      this->mesh.color (color);
+      this->mesh.renderMode ().constantShading (true);
+      this->mesh.renderMode ().noDepthTest (d == false);
+    }
+
+    bool matches (bool l, bool d, const Color& color) const
+    {
+      return this->isLines == l && this->depthTest == d &&
+             this->mesh.color ().vec4 () == color.vec4 ();
+    }
+
+    bool isEmpty () const { return this->mesh.numIndices () == 0; }
+
+    void add (const glm::vec3& v) { this->mesh.addIndex (this->mesh.addVertex (v)); }
+  };
+}
+
+struct OverlayBatch::Impl
+{
+  // groups are kept across frames, such that their buffers are reused
+  std::list<Group> groups;
+
+  Group& group (bool isLines, bool depthTest, const Color& color)
+  {
+    for (Group& g : this->groups)
+    {
+      if (g.matches (isLines, depthTest, color))
+      {
+        return g;
+      }
+    }
+    this->groups.emplace_back (isLines, depthTest, color);
+    return this->groups.back ();
+  }
+
+  void line (const glm::vec3& v1, const glm::vec3& v2, const Color& color, bool depthTest)
+  {
+    Group& g = this->group (true, depthTest, color);
+
+    g.add (v1);
+    g.add (v2);
+  }
+
+  void triangle (const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& v3,
+                 const Color& color, bool depthTest)
+  {
+    Group& g = this->group (false, depthTest, color);
+
+    g.add (v1);
+    g.add (v2);
+    g.add (v3);
+  }
+
+  void box (const glm::vec3& min, const glm::vec3& max, const Color& color, bool depthTest)
+  {
+    const auto corner = [&min, &max](unsigned int i) {
+      return glm::vec3 ((i & 4) ? max.x : min.x, (i & 2) ? max.y : min.y,
+                        (i & 1) ? max.z : min.z);
+    };
+
+    // corners whose indices differ in a single bit share an edge
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      for (unsigned int bit = 1; bit < 8; bit <<= 1)
+      {
+        if ((i & bit) == 0)
+        {
+          this->line (corner (i), corner (i | bit), color, depthTest);
+        }
+      }
+    }
+  }
+
+  bool isEmpty () const
+  {
+    for (const Group& g : this->groups)
+    {
+      if (g.isEmpty () == false)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void flush (Camera& camera)
+  {
+    for (Group& g : this->groups)
+    {
+      if (g.isEmpty () == false)
+      {
+        g.mesh.bufferData ();
+        if (g.isLines)
+        {
+          g.mesh.renderLines (camera);
+        }
+        else
+        {
+          g.mesh.render (camera);
+        }
+        g.mesh.shrinkIndices (0);
+        g.mesh.shrinkVertices (0);
+      }
+    }
+  }
+};
+
+DELEGATE_BIG2 (OverlayBatch)
+DELEGATE4 (void, OverlayBatch, line, const glm::vec3&, const glm::vec3&, const Color&, bool)
+DELEGATE5 (void, OverlayBatch, triangle, const glm::vec3&, const glm::vec3&, const glm::vec3&,
+           const Color&, bool)
+DELEGATE4 (void, OverlayBatch, box, const glm::vec3&, const glm::vec3&, const Color&, bool)
+DELEGATE_CONST (bool, OverlayBatch, isEmpty)
+DELEGATE1 (void, OverlayBatch, flush, Camera&)
@@ -0,0 +1,35 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_OVERLAY_BATCH
+#define DILAY_OVERLAY_BATCH
+
+#include <glm/fwd.hpp>
+#include "macro.hpp"
+
+class Camera;
+class Color;
+
+/* Lines and triangles of overlays, which are given in world space while a frame is rendered.
+ * Flushing draws all lines and triangles of the same color and depth test by a single draw call,
+ * whose buffers are kept for the next frame.
+ */
+class OverlayBatch
+{
+public:
+  DECLARE_BIG2 (OverlayBatch)
+
+  void line (const glm::vec3&, const glm::vec3&, const Color&, bool = true);
+  void triangle (const glm::vec3&, const glm::vec3&, const glm::vec3&, const Color&, bool = true);
+  // edges of the axis-aligned box between a minimum and a maximum
+  void box (const glm::vec3&, const glm::vec3&, const Color&, bool = true);
+  bool isEmpty () const;
+  // draws and removes all lines and triangles
+  void flush (Camera&);
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -0,0 +1,181 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_PARALLEL
+#define DILAY_PARALLEL
+
+#include <algorithm>
+#include <vector>
+#include "thread-pool.hpp"
+#include "util.hpp"
+
+/* Algorithms on the global thread pool.  Chunks only depend on the chunk size and per-chunk
+ * results are combined in the order of the chunks, such that results are identical for any
+ * number of threads.  Small inputs, single threads and nested calls run serially.
+ */
+namespace Parallel
+{
+  constexpr unsigned int defaultChunkSize = 16384;
+
+  // calls `f (begin, end)` on chunks of `[0, n)`
+  template <typename F>
+  void forChunks (unsigned int n, const F& f, unsigned int chunkSize = defaultChunkSize)
+  {
+    ThreadPool::global ().parallelFor (n, chunkSize, f);
+  }
+
+  // calls `f (i)` for each `i` of `[0, n)`
+  template <typename F>
+  void forEach (unsigned int n, const F& f, unsigned int chunkSize = defaultChunkSize)
+  {
+    forChunks (n,
+               [&f](unsigned int begin, unsigned int end) {
+                 for (unsigned int i = begin; i < end; i++)
+                 {
+                   f (i);
+                 }
+               },
+               chunkSize);
+  }
+
+  // combines `f (0), ..., f (n - 1)` by an associative `combine`, where `identity` is neutral
+  template <typename T, typename F, typename C>
+  T reduce (unsigned int n, const T& identity, const F& f, const C& combine,
+            unsigned int chunkSize = defaultChunkSize)
+  {
+    std::vector<T> partials ((n + chunkSize - 1) / chunkSize, identity);
+
+    forChunks (n,
+               [&](unsigned int begin, unsigned int end) {
+                 T& partial = partials[begin / chunkSize];
+
+                 for (unsigned int i = begin; i < end; i++)
+                 {
+                   partial = combine (partial, f (i));
+                 }
+               },
+               chunkSize);
+
+    T result = identity;
+    for (const T& partial : partials)
+    {
+      result = combine (result, partial);
+    }
+    return result;
+  }
+
+  // replaces each element by the sum of its predecessors and returns the sum of all elements
+  template <typename T>
+  T exclusiveScan (std::vector<T>& v, unsigned int chunkSize = defaultChunkSize)
+  {
+    const unsigned int n = v.size ();
+    std::vector<T>     offsets ((n + chunkSize - 1) / chunkSize, T (0));
+
+    forChunks (n,
+               [&](unsigned int begin, unsigned int end) {
+                 T sum (0);
+                 for (unsigned int i = begin; i < end; i++)
+                 {
+                   sum += v[i];
+                 }
+                 offsets[begin / chunkSize] = sum;
+               },
+               chunkSize);
+
+    T total (0);
+    for (T& offset : offsets)
+    {
+      const T sum = offset;
+      offset = total;
+      total += sum;
+    }
+
+    forChunks (n,
+               [&](unsigned int begin, unsigned int end) {
+                 T sum = offsets[begin / chunkSize];
+                 for (unsigned int i = begin; i < end; i++)
+                 {
+                   const T value = v[i];
+                   v[i] = sum;
+                   sum += value;
+                 }
+               },
+               chunkSize);
+    return total;
+  }
+
+  /* Stable sort: chunks are sorted in parallel and merged pairwise, where the merges of each
+   * round are run in parallel.
+   */
+  template <typename T, typename Compare>
+  void sort (std::vector<T>& v, const Compare& compare, unsigned int chunkSize = defaultChunkSize)
+  {
+    const unsigned int n = v.size ();
+
+    forChunks (n,
+               [&v, &compare](unsigned int begin, unsigned int end) {
+                 std::stable_sort (v.begin () + begin, v.begin () + end, compare);
+               },
+               chunkSize);
+
+    for (unsigned int width = chunkSize; width < n; width *= 2)
+    {
+      const unsigned int numMerges = (n + (2 * width) - 1) / (2 * width);
+
+      forEach (numMerges,
+               [&v, &compare, n, width](unsigned int m) {
+                 const unsigned int begin = 2 * m * width;
+                 const unsigned int mid = std::min (begin + width, n);
+                 const unsigned int end = std::min (begin + (2 * width), n);
+
+                 std::inplace_merge (v.begin () + begin, v.begin () + mid, v.begin () + end,
+                                     compare);
+               },
+               1);
+    }
+  }
+
+  /* Removes the elements that satisfy a predicate while keeping the order of the others, unlike
+   * `Util::prune`.  The index map takes old indices to new indices or `Util::invalidIndex ()`.
+   */
+  template <typename T, typename P>
+  void prune (std::vector<T>& v, const P& p, std::vector<unsigned int>* indexMap = nullptr,
+              unsigned int chunkSize = defaultChunkSize)
+  {
+    const unsigned int         n = v.size ();
+    std::vector<unsigned char> isPruned (n);
+    std::vector<unsigned int>  newIndices (n);
+
+    forEach (n,
+             [&](unsigned int i) {
+               isPruned[i] = p (v[i]) ? 1 : 0;
+               newIndices[i] = isPruned[i] ? 0 : 1;
+             },
+             chunkSize);
+
+    const unsigned int numKept = exclusiveScan (newIndices, chunkSize);
+    std::vector<T>     kept (numKept);
+
+    forEach (n,
+             [&](unsigned int i) {
+               if (isPruned[i])
+               {
+                 newIndices[i] = Util::invalidIndex ();
+               }
+               else
+               {
+                 kept[newIndices[i]] = std::move (v[i]);
+               }
+             },
+             chunkSize);
+
+    v.swap (kept);
+    if (indexMap)
+    {
+      indexMap->swap (newIndices);
+    }
+  }
+}
+
+#endif
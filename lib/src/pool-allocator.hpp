@@ -0,0 +1,141 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_POOL_ALLOCATOR
+#define DILAY_POOL_ALLOCATOR
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "macro.hpp"
+
+/* Memory that is allocated in chunks, which are only returned to the heap at once when the pool
+ * is destroyed.  Freed blocks are kept in lists by their size and are reused by later allocations
+ * of the same size.  Blocks that exceed a chunk are allocated on the heap.  A pool must not be
+ * used by several threads at the same time.
+ */
+class MemoryPool
+{
+public:
+  MemoryPool ()
+    : current (nullptr)
+    , remaining (0)
+  {
+  }
+
+  DELETE_COPYMOVEASSIGN (MemoryPool)
+
+  void* allocate (std::size_t size)
+  {
+    const std::size_t sizeClass = MemoryPool::sizeClass (size);
+    const std::size_t blockSize = sizeClass * MemoryPool::alignment;
+
+    if (blockSize > MemoryPool::chunkSize)
+    {
+      return ::operator new (size);
+    }
+    else if (sizeClass < this->freeBlocks.size () && this->freeBlocks[sizeClass])
+    {
+      FreeBlock* block = this->freeBlocks[sizeClass];
+      this->freeBlocks[sizeClass] = block->next;
+      return block;
+    }
+    else
+    {
+      if (blockSize > this->remaining)
+      {
+        this->chunks.emplace_back (new char[MemoryPool::chunkSize]);
+        this->current = this->chunks.back ().get ();
+        this->remaining = MemoryPool::chunkSize;
+      }
+      void* block = this->current;
+      this->current += blockSize;
+      this->remaining -= blockSize;
+      return block;
+    }
+  }
+
+  void deallocate (void* pointer, std::size_t size)
+  {
+    const std::size_t sizeClass = MemoryPool::sizeClass (size);
+
+    if (sizeClass * MemoryPool::alignment > MemoryPool::chunkSize)
+    {
+      ::operator delete (pointer);
+    }
+    else
+    {
+      if (sizeClass >= this->freeBlocks.size ())
+      {
+        this->freeBlocks.resize (sizeClass + 1, nullptr);
+      }
+      FreeBlock* block = static_cast<FreeBlock*> (pointer);
+      block->next = this->freeBlocks[sizeClass];
+      this->freeBlocks[sizeClass] = block;
+    }
+  }
+
+private:
+  struct FreeBlock
+  {
+    FreeBlock* next;
+  };
+
+  static constexpr std::size_t alignment = alignof (std::max_align_t);
+  static constexpr std::size_t chunkSize = 1 << 16;
+
+  static_assert (sizeof (FreeBlock) <= alignment, "Unexpected memory layout");
+
+  static std::size_t sizeClass (std::size_t size)
+  {
+    return size == 0 ? 1 : (size + MemoryPool::alignment - 1) / MemoryPool::alignment;
+  }
+
+  std::vector<std::unique_ptr<char[]>> chunks;
+  std::vector<FreeBlock*>              freeBlocks;
+  char*                                current;
+  std::size_t                          remaining;
+};
+
+/* Allocates from a memory pool, which is created by the default constructor and is shared by all
+ * allocators that are copied or rebound from it.  The pool is destroyed along with the last of
+ * these allocators, such that a container of nodes frees its nodes at once.
+ */
+template <typename T> class PoolAllocator
+{
+public:
+  typedef T value_type;
+
+  PoolAllocator ()
+    : pool (std::make_shared<MemoryPool> ())
+  {
+  }
+
+  template <typename U>
+  PoolAllocator (const PoolAllocator<U>& o)
+    : pool (o.pool)
+  {
+  }
+
+  T* allocate (std::size_t n) { return static_cast<T*> (this->pool->allocate (n * sizeof (T))); }
+
+  void deallocate (T* pointer, std::size_t n) { this->pool->deallocate (pointer, n * sizeof (T)); }
+
+  template <typename U> bool operator== (const PoolAllocator<U>& o) const
+  {
+    return this->pool == o.pool;
+  }
+
+  template <typename U> bool operator!= (const PoolAllocator<U>& o) const
+  {
+    return this->pool != o.pool;
+  }
+
+private:
+  template <typename U> friend class PoolAllocator;
+
+  std::shared_ptr<MemoryPool> pool;
+};
+
+#endif
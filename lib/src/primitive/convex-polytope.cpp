@@ -0,0 +1,47 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include "primitive/aabox.hpp"
+#include "primitive/convex-polytope.hpp"
+#include "primitive/triangle.hpp"
+
+constexpr unsigned int PrimConvexPolytope::maxNumPlanes;
+
+void PrimConvexPolytope::addPlane (const PrimPlane& plane)
+{
+  assert (this->_planes.size () < PrimConvexPolytope::maxNumPlanes);
+  this->_planes.push_back (plane);
+}
+
+bool PrimConvexPolytope::contains (const glm::vec3& p) const
+{
+  for (const PrimPlane& plane : this->_planes)
+  {
+    if (plane.distance (p) > 0.0f)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PrimConvexPolytope::contains (const PrimAABox& box) const
+{
+  for (const PrimPlane& plane : this->_planes)
+  {
+    const float r = glm::dot (box.halfWidth (), glm::abs (plane.normal ()));
+
+    if (plane.distance (box.center ()) + r > 0.0f)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PrimConvexPolytope::contains (const PrimTriangle& tri) const
+{
+  return this->contains (tri.vertex1 ()) && this->contains (tri.vertex2 ()) &&
+         this->contains (tri.vertex3 ());
+}
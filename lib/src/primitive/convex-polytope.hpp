@@ -0,0 +1,33 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_PRIMITIVE_CONVEX_POLYTOPE
+#define DILAY_PRIMITIVE_CONVEX_POLYTOPE
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "primitive/plane.hpp"
+
+class PrimAABox;
+class PrimTriangle;
+
+// intersection of the half-spaces behind its planes, i.e. the normals of the planes point outwards
+class PrimConvexPolytope
+{
+public:
+  static constexpr unsigned int maxNumPlanes = 32;
+
+  const std::vector<PrimPlane>& planes () const { return this->_planes; }
+
+  void addPlane (const PrimPlane&);
+
+  bool contains (const glm::vec3&) const;
+  bool contains (const PrimAABox&) const;
+  bool contains (const PrimTriangle&) const;
+
+private:
+  std::vector<PrimPlane> _planes;
+};
+
+#endif
@@ -0,0 +1,257 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "profiler.hpp"
+#include "util.hpp"
+
+namespace
+{
+  typedef std::chrono::steady_clock Clock;
+
+  constexpr unsigned int ringSize = 1 << 16;
+  constexpr unsigned int nameWidth = 48;
+
+  struct Event
+  {
+    const char*   name;
+    std::uint64_t begin;
+    std::uint64_t end;
+  };
+
+  /* Only the owning thread adds events, whereas any thread may read them.  The mutex is
+   * therefore uncontended unless a trace is written.
+   */
+  struct ThreadBuffer
+  {
+    const unsigned int id;
+    std::mutex         mutex;
+    std::vector<Event> events;
+    std::uint64_t      numEvents;
+
+    ThreadBuffer (unsigned int i)
+      : id (i)
+      , events (ringSize)
+      , numEvents (0)
+    {
+    }
+
+    void add (const Event& event)
+    {
+      std::lock_guard<std::mutex> lock (this->mutex);
+
+      this->events[this->numEvents % ringSize] = event;
+      this->numEvents++;
+    }
+
+    template <typename T> void forEachEvent (const T& f)
+    {
+      std::lock_guard<std::mutex> lock (this->mutex);
+
+      const std::uint64_t first = this->numEvents > ringSize ? this->numEvents - ringSize : 0;
+      for (std::uint64_t i = first; i < this->numEvents; i++)
+      {
+        f (this->events[i % ringSize]);
+      }
+    }
+
+    void reset ()
+    {
+      std::lock_guard<std::mutex> lock (this->mutex);
+      this->numEvents = 0;
+    }
+  };
+
+  // buffers outlive their threads, such that zones of finished threads are kept
+  struct Registry
+  {
+    std::mutex                                 mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    const Clock::time_point                    epoch;
+    std::string                                fileName;
+
+    Registry ()
+      : epoch (Clock::now ())
+    {
+    }
+
+    template <typename T> void forEachBuffer (const T& f)
+    {
+      std::lock_guard<std::mutex> lock (this->mutex);
+
+      for (std::unique_ptr<ThreadBuffer>& buffer : this->buffers)
+      {
+        f (*buffer);
+      }
+    }
+  };
+
+  Registry& registry ()
+  {
+    static Registry r;
+    return r;
+  }
+
+  ThreadBuffer& threadBuffer ()
+  {
+    thread_local ThreadBuffer* buffer = nullptr;
+
+    if (buffer == nullptr)
+    {
+      Registry&                   r = registry ();
+      std::lock_guard<std::mutex> lock (r.mutex);
+
+      r.buffers.emplace_back (std::make_unique<ThreadBuffer> (r.buffers.size ()));
+      buffer = r.buffers.back ().get ();
+    }
+    return *buffer;
+  }
+
+  // nanoseconds since the registry has been created
+  std::uint64_t now ()
+  {
+    return std::uint64_t (
+      std::chrono::duration_cast<std::chrono::nanoseconds> (Clock::now () - registry ().epoch)
+        .count ());
+  }
+
+  void writeName (std::ostream& stream, const char* name)
+  {
+    stream << '"';
+    for (const char* c = name; *c != '\0'; c++)
+    {
+      if (*c == '"' || *c == '\\')
+      {
+        stream << '\\';
+      }
+      stream << *c;
+    }
+    stream << '"';
+  }
+
+  void writeAtExit ()
+  {
+    const std::string& fileName = registry ().fileName;
+
+    if (fileName.empty () == false && Profiler::toChromeTrace (fileName) == false)
+    {
+      std::cerr << "could not write profile to " << fileName << "\n";
+    }
+    Profiler::printSummary (std::cout);
+  }
+}
+
+namespace Profiler
+{
+  void initialize (const std::string& fileName)
+  {
+#ifdef DILAY_PROFILE
+    // the registry must be created before the handler is registered, such that it outlives it
+    registry ().fileName = fileName;
+    std::atexit (writeAtExit);
+#else
+    unused (fileName);
+#endif
+  }
+
+  void reset ()
+  {
+    registry ().forEachBuffer ([](ThreadBuffer& buffer) { buffer.reset (); });
+  }
+
+  void mark (const char* name)
+  {
+    const std::uint64_t time = now ();
+    threadBuffer ().add (Event{name, time, time});
+  }
+
+  void toChromeTrace (std::ostream& stream)
+  {
+    bool isFirst = true;
+
+    stream << "{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [";
+    stream << std::fixed << std::setprecision (3);
+
+    registry ().forEachBuffer ([&stream, &isFirst](ThreadBuffer& buffer) {
+      stream << (isFirst ? "\n" : ",\n") << "    {\"name\": \"thread_name\", \"ph\": \"M\", "
+             << "\"pid\": 1, \"tid\": " << buffer.id << ", \"args\": {\"name\": \"thread "
+             << buffer.id << "\"}}";
+      isFirst = false;
+
+      buffer.forEachEvent ([&stream, &buffer](const Event& e) {
+        stream << ",\n    {\"name\": ";
+        writeName (stream, e.name);
+        stream << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer.id
+               << ", \"ts\": " << double(e.begin) * 1.0e-3
+               << ", \"dur\": " << double(e.end - e.begin) * 1.0e-3 << "}";
+      });
+    });
+    stream << "\n  ]\n}\n";
+  }
+
+  bool toChromeTrace (const std::string& fileName)
+  {
+    std::ofstream file (fileName);
+
+    if (file.is_open ())
+    {
+      Profiler::toChromeTrace (file);
+      return file.good ();
+    }
+    return false;
+  }
+
+  void printSummary (std::ostream& stream)
+  {
+    struct Summary
+    {
+      unsigned int  numCalls;
+      std::uint64_t duration;
+    };
+    std::map<std::string, Summary> summaries;
+
+    registry ().forEachBuffer ([&summaries](ThreadBuffer& buffer) {
+      buffer.forEachEvent ([&summaries](const Event& e) {
+        Summary& s = summaries.emplace (e.name, Summary{0, 0}).first->second;
+        s.numCalls++;
+        s.duration += e.end - e.begin;
+      });
+    });
+
+    if (summaries.empty () == false)
+    {
+      const std::ios::fmtflags flags = stream.flags ();
+      const std::streamsize    precision = stream.precision ();
+
+      stream << "##### profile ######\n" << std::fixed << std::setprecision (3);
+      for (const auto& pair : summaries)
+      {
+        const double ms = double(pair.second.duration) * 1.0e-6;
+
+        stream << std::setw (nameWidth) << std::left << pair.first << std::right << ms << "ms ("
+               << pair.second.numCalls << " calls -> " << ms / double(pair.second.numCalls)
+               << "ms / call)\n";
+      }
+      stream.flags (flags);
+      stream.precision (precision);
+    }
+  }
+}
+
+ProfilerZone::ProfilerZone (const char* n)
+  : name (n)
+  , begin (now ())
+{
+}
+
+// zones of a thread end in reverse order of their beginnings, so traces nest them by time
+ProfilerZone::~ProfilerZone () { threadBuffer ().add (Event{this->name, this->begin, now ()}); }
@@ -0,0 +1,56 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_PROFILER
+#define DILAY_PROFILER
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include "macro.hpp"
+
+/* `PROFILE_ZONE (name)` measures the rest of its scope as a zone, whose name must be a string
+ * literal.  Zones nest and may be measured on any thread.  `PROFILE_MARK (name)` records a zone
+ * without duration, e.g. for an event that is reported by a driver.  Both are compiled to nothing
+ * unless Dilay is built with `DILAY_PROFILE`.
+ */
+#ifdef DILAY_PROFILE
+#define PROFILE_ZONE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT_IMPL (a, b)
+#define PROFILE_ZONE(name) ProfilerZone PROFILE_ZONE_CONCAT (profilerZone, __LINE__) (name);
+#define PROFILE_MARK(name) Profiler::mark (name);
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_MARK(name)
+#endif
+
+/* Each thread records its zones in a ring buffer of its own, which keeps the most recent zones.
+ * Traces are written in the Chrome trace event format, which is read by `chrome://tracing`,
+ * Perfetto, and Tracy's `import-chrome`.
+ */
+namespace Profiler
+{
+  // writes a trace to the given file and prints a summary when the application exits
+  void initialize (const std::string&);
+  void reset ();
+  void mark (const char*);
+  void toChromeTrace (std::ostream&);
+  bool toChromeTrace (const std::string&);
+  // prints the number of calls and the total duration of each zone
+  void printSummary (std::ostream&);
+}
+
+class ProfilerZone
+{
+public:
+  explicit ProfilerZone (const char*);
+  DELETE_COPYMOVEASSIGN (ProfilerZone)
+  ~ProfilerZone ();
+
+private:
+  const char*   name;
+  std::uint64_t begin;
+};
+
+#endif
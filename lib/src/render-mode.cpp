@@ -2,7 +2,9 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <cassert>
 #include <cstdlib>
+#include "opengl.hpp"
 #include "render-mode.hpp"
 #include "shader.hpp"
 #include "util.hpp"
@@ -13,6 +15,7 @@ RenderMode::RenderMode ()
   this->renderWireframe (false);
   this->cameraRotationOnly (false);
   this->noDepthTest (false);
+  this->instancing (false);
 }
 
 RenderMode::RenderMode (const RenderMode& other)
@@ -32,9 +35,51 @@ bool RenderMode::cameraRotationOnly () const { return this->flags.get<4> (); }
 
 bool RenderMode::noDepthTest () const { return this->flags.get<5> (); }
 
+bool RenderMode::instancing () const { return this->flags.get<6> (); }
+
 const char* RenderMode::vertexShader () const
 {
-  if (this->smoothShading ())
+  if (this->instancing ())
+  {
+    assert (this->renderWireframe () == false);
+
+    if (this->smoothShading ())
+    {
+      return Shader::smoothInstancedVertexShader ();
+    }
+    else if (this->flatShading ())
+    {
+      return Shader::flatInstancedVertexShader ();
+    }
+    else if (this->constantShading ())
+    {
+      return Shader::constantInstancedVertexShader ();
+    }
+    else
+    {
+      DILAY_IMPOSSIBLE
+    }
+  }
+  else if (this->renderWireframe () && OpenGL::hasGeometryShader () == false)
+  {
+    if (this->smoothShading ())
+    {
+      return Shader::smoothCornerVertexShader ();
+    }
+    else if (this->flatShading ())
+    {
+      return Shader::flatCornerVertexShader ();
+    }
+    else if (this->constantShading ())
+    {
+      return Shader::constantCornerVertexShader ();
+    }
+    else
+    {
+      DILAY_IMPOSSIBLE
+    }
+  }
+  else if (this->smoothShading ())
   {
     return Shader::smoothVertexShader ();
   }
@@ -54,7 +99,47 @@ const char* RenderMode::vertexShader () const
 
 const char* RenderMode::fragmentShader () const
 {
-  if (this->smoothShading ())
+  if (this->instancing ())
+  {
+    assert (this->renderWireframe () == false);
+
+    if (this->smoothShading ())
+    {
+      return Shader::smoothFragmentShader ();
+    }
+    else if (this->flatShading ())
+    {
+      return Shader::flatInstancedFragmentShader ();
+    }
+    else if (this->constantShading ())
+    {
+      return Shader::constantInstancedFragmentShader ();
+    }
+    else
+    {
+      DILAY_IMPOSSIBLE
+    }
+  }
+  else if (this->renderWireframe () && OpenGL::hasGeometryShader () == false)
+  {
+    if (this->smoothShading ())
+    {
+      return Shader::smoothCornerWireframeFragmentShader ();
+    }
+    else if (this->flatShading ())
+    {
+      return Shader::flatCornerWireframeFragmentShader ();
+    }
+    else if (this->constantShading ())
+    {
+      return Shader::constantWireframeFragmentShader ();
+    }
+    else
+    {
+      DILAY_IMPOSSIBLE
+    }
+  }
+  else if (this->smoothShading ())
   {
     return this->renderWireframe () ? Shader::smoothWireframeFragmentShader ()
                                     : Shader::smoothFragmentShader ();
@@ -110,3 +195,5 @@ void RenderMode::renderWireframe (bool v) { this->flags.set<3> (v); }
 void RenderMode::cameraRotationOnly (bool v) { this->flags.set<4> (v); }
 
 void RenderMode::noDepthTest (bool v) { this->flags.set<5> (v); }
+
+void RenderMode::instancing (bool v) { this->flags.set<6> (v); }
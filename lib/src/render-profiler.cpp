@@ -0,0 +1,303 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <chrono>
+#include <vector>
+#include "opengl.hpp"
+#include "render-profiler.hpp"
+#include "util.hpp"
+
+namespace
+{
+  typedef std::chrono::steady_clock Clock;
+
+  constexpr unsigned int numPhases = 6;
+  constexpr unsigned int numAveragedFrames = 60;
+
+  // number of frames whose queries may be pending at the same time
+  constexpr unsigned int numQueryFrames = 4;
+
+  unsigned int phaseIndex (RenderPhase phase) { return static_cast<unsigned int> (phase); }
+
+  const char* phaseName (unsigned int index)
+  {
+    switch (RenderPhase (index))
+    {
+      case RenderPhase::Meshes:
+        return "Meshes";
+      case RenderPhase::Sketches:
+        return "Sketches";
+      case RenderPhase::FloorPlane:
+        return "Floor plane";
+      case RenderPhase::Tool:
+        return "Tool";
+      case RenderPhase::Axis:
+        return "Axis";
+      case RenderPhase::Overlays:
+        return "Overlays";
+      default:
+        DILAY_IMPOSSIBLE
+    }
+  }
+
+  struct RollingAverage
+  {
+    std::vector<float> samples;
+    unsigned int       next;
+
+    RollingAverage ()
+      : next (0)
+    {
+    }
+
+    void add (float sample)
+    {
+      if (this->samples.size () < numAveragedFrames)
+      {
+        this->samples.push_back (sample);
+      }
+      else
+      {
+        this->samples[this->next] = sample;
+      }
+      this->next = (this->next + 1) % numAveragedFrames;
+    }
+
+    float average () const
+    {
+      float sum = 0.0f;
+      for (float s : this->samples)
+      {
+        sum += s;
+      }
+      return this->samples.empty () ? 0.0f : sum / float(this->samples.size ());
+    }
+
+    void reset ()
+    {
+      this->samples.clear ();
+      this->next = 0;
+    }
+  };
+
+  // timestamp queries at the beginning and end of each phase of a frame
+  struct QueryFrame
+  {
+    unsigned int ids[2 * numPhases];
+    bool         isMeasured[numPhases];
+    unsigned int lastId;
+    bool         isPending;
+
+    QueryFrame ()
+      : lastId (0)
+      , isPending (false)
+    {
+      for (unsigned int i = 0; i < 2 * numPhases; i++)
+      {
+        this->ids[i] = 0;
+      }
+      this->resetPhases ();
+    }
+
+    void resetPhases ()
+    {
+      for (unsigned int i = 0; i < numPhases; i++)
+      {
+        this->isMeasured[i] = false;
+      }
+    }
+  };
+}
+
+struct RenderProfiler::Impl
+{
+  bool              isEnabled;
+  bool              isMeasuring;
+  bool              hasQueries;
+  QueryFrame        frames[numQueryFrames];
+  unsigned int      currentFrame;
+  Clock::time_point phaseStarts[numPhases];
+  float             cpuTimes[numPhases];
+  bool              isCpuMeasured[numPhases];
+  RollingAverage    gpuAverages[numPhases];
+  RollingAverage    cpuAverages[numPhases];
+  float             recentGpuFrameTime;
+
+  Impl ()
+    : isEnabled (false)
+    , isMeasuring (false)
+    , hasQueries (false)
+    , currentFrame (0)
+    , recentGpuFrameTime (0.0f)
+  {
+  }
+
+  ~Impl ()
+  {
+    if (this->hasQueries)
+    {
+      for (QueryFrame& frame : this->frames)
+      {
+        OpenGL::glDeleteQueries (2 * numPhases, frame.ids);
+      }
+    }
+  }
+
+  QueryFrame& frame () { return this->frames[this->currentFrame]; }
+
+  void enable (bool value)
+  {
+    if (value != this->isEnabled)
+    {
+      this->isEnabled = value;
+
+      for (unsigned int i = 0; i < numPhases; i++)
+      {
+        this->gpuAverages[i].reset ();
+        this->cpuAverages[i].reset ();
+      }
+      for (QueryFrame& frame : this->frames)
+      {
+        frame.isPending = false;
+      }
+      this->recentGpuFrameTime = 0.0f;
+    }
+  }
+
+  // reads the results of a frame if they are available, otherwise they are dropped
+  void collect (QueryFrame& frame)
+  {
+    int isAvailable = 0;
+    OpenGL::glGetQueryObjectiv (frame.lastId, OpenGL::QueryResultAvailable (), &isAvailable);
+
+    if (isAvailable)
+    {
+      this->recentGpuFrameTime = 0.0f;
+
+      for (unsigned int i = 0; i < numPhases; i++)
+      {
+        if (frame.isMeasured[i])
+        {
+          unsigned long long begin = 0;
+          unsigned long long end = 0;
+
+          OpenGL::glGetQueryObjectui64v (frame.ids[(2 * i) + 0], OpenGL::QueryResult (), &begin);
+          OpenGL::glGetQueryObjectui64v (frame.ids[(2 * i) + 1], OpenGL::QueryResult (), &end);
+
+          const float time = end > begin ? float(end - begin) * 1.0e-6f : 0.0f;
+
+          this->gpuAverages[i].add (time);
+          this->recentGpuFrameTime += time;
+        }
+      }
+    }
+    frame.isPending = false;
+  }
+
+  void beginFrame ()
+  {
+    this->isMeasuring = this->isEnabled;
+
+    if (this->isMeasuring)
+    {
+      if (this->hasQueries == false && OpenGL::hasTimerQuery ())
+      {
+        for (QueryFrame& frame : this->frames)
+        {
+          OpenGL::glGenQueries (2 * numPhases, frame.ids);
+        }
+        this->hasQueries = true;
+      }
+
+      if (this->frame ().isPending)
+      {
+        this->collect (this->frame ());
+      }
+      this->frame ().resetPhases ();
+
+      for (unsigned int i = 0; i < numPhases; i++)
+      {
+        this->cpuTimes[i] = 0.0f;
+        this->isCpuMeasured[i] = false;
+      }
+    }
+  }
+
+  void endFrame ()
+  {
+    if (this->isMeasuring)
+    {
+      bool isPending = false;
+
+      for (unsigned int i = 0; i < numPhases; i++)
+      {
+        if (this->isCpuMeasured[i])
+        {
+          this->cpuAverages[i].add (this->cpuTimes[i]);
+        }
+        isPending = isPending || this->frame ().isMeasured[i];
+      }
+      this->frame ().isPending = this->hasQueries && isPending;
+      this->currentFrame = (this->currentFrame + 1) % numQueryFrames;
+      this->isMeasuring = false;
+    }
+  }
+
+  void beginPhase (RenderPhase phase)
+  {
+    if (this->isMeasuring)
+    {
+      const unsigned int i = phaseIndex (phase);
+
+      if (this->hasQueries)
+      {
+        OpenGL::glQueryCounter (this->frame ().ids[(2 * i) + 0], OpenGL::Timestamp ());
+      }
+      this->phaseStarts[i] = Clock::now ();
+    }
+  }
+
+  void endPhase (RenderPhase phase)
+  {
+    if (this->isMeasuring)
+    {
+      const unsigned int i = phaseIndex (phase);
+      const std::chrono::duration<float, std::milli> duration =
+        Clock::now () - this->phaseStarts[i];
+
+      this->cpuTimes[i] += duration.count ();
+      this->isCpuMeasured[i] = true;
+
+      if (this->hasQueries)
+      {
+        QueryFrame& frame = this->frame ();
+
+        OpenGL::glQueryCounter (frame.ids[(2 * i) + 1], OpenGL::Timestamp ());
+        frame.isMeasured[i] = true;
+        frame.lastId = frame.ids[(2 * i) + 1];
+      }
+    }
+  }
+
+  bool hasGpuTimes () const { return OpenGL::hasTimerQuery (); }
+
+  void forEachPhase (const PhaseCallback& f) const
+  {
+    for (unsigned int i = 0; i < numPhases; i++)
+    {
+      f (phaseName (i), this->gpuAverages[i].average (), this->cpuAverages[i].average ());
+    }
+  }
+};
+
+DELEGATE_BIG2 (RenderProfiler)
+GETTER_CONST (bool, RenderProfiler, isEnabled)
+DELEGATE1 (void, RenderProfiler, enable, bool)
+DELEGATE (void, RenderProfiler, beginFrame)
+DELEGATE (void, RenderProfiler, endFrame)
+DELEGATE1 (void, RenderProfiler, beginPhase, RenderPhase)
+DELEGATE1 (void, RenderProfiler, endPhase, RenderPhase)
+DELEGATE_CONST (bool, RenderProfiler, hasGpuTimes)
+DELEGATE1_CONST (void, RenderProfiler, forEachPhase, const RenderProfiler::PhaseCallback&)
+GETTER_CONST (float, RenderProfiler, recentGpuFrameTime)
@@ -0,0 +1,50 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_RENDER_PROFILER
+#define DILAY_RENDER_PROFILER
+
+#include <functional>
+#include "macro.hpp"
+
+enum class RenderPhase
+{
+  Meshes,
+  Sketches,
+  FloorPlane,
+  Tool,
+  Axis,
+  Overlays
+};
+
+/* Measures the GPU and CPU time of the phases of rendering a frame.  GPU times are measured with
+ * timestamp queries, whose results are collected some frames later, such that measuring never
+ * stalls rendering.  Times are averaged over the last frames.
+ */
+class RenderProfiler
+{
+public:
+  DECLARE_BIG2 (RenderProfiler)
+
+  typedef std::function<void(const char*, float, float)> PhaseCallback;
+
+  bool isEnabled () const;
+  void enable (bool);
+  void beginFrame ();
+  void endFrame ();
+  void beginPhase (RenderPhase);
+  void endPhase (RenderPhase);
+  bool hasGpuTimes () const;
+
+  // calls the callback with the name, the average GPU and CPU time in milliseconds of each phase
+  void forEachPhase (const PhaseCallback&) const;
+
+  // GPU time in milliseconds of the most recently collected frame, or 0 if there is none
+  float recentGpuFrameTime () const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
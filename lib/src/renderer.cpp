@@ -2,11 +2,15 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <cstring>
 #include <glm/glm.hpp>
 #include "color.hpp"
 #include "config.hpp"
+#include "opengl-buffer-id.hpp"
 #include "opengl.hpp"
+#include "overlay-batch.hpp"
 #include "render-mode.hpp"
+#include "render-profiler.hpp"
 #include "renderer.hpp"
 #include "util.hpp"
 
@@ -14,6 +18,9 @@ namespace
 {
   const unsigned int numLights = 2;
 
+  // binding point of the `LightUniforms` block, cf. `shader.cpp`
+  const unsigned int lightUniformsBinding = 0;
+
   struct LightIds
   {
     int directionId;
@@ -28,18 +35,49 @@ namespace
     }
   };
 
+  // value of a matrix uniform that has been uploaded to a program
+  struct UniformMatrix
+  {
+    bool  isSet;
+    float values[16];
+
+    UniformMatrix ()
+      : isSet (false)
+    {
+    }
+
+    // returns `false` if `m` equals the uploaded value
+    bool update (const float* m)
+    {
+      if (this->isSet && std::memcmp (this->values, m, sizeof (this->values)) == 0)
+      {
+        return false;
+      }
+      else
+      {
+        std::memcpy (this->values, m, sizeof (this->values));
+        this->isSet = true;
+        return true;
+      }
+    }
+  };
+
   struct ShaderIds
   {
-    unsigned int programId;
-    int          modelId;
-    int          modelNormalId;
-    int          viewId;
-    int          projectionId;
-    int          colorId;
-    int          wireframeColorId;
-    int          eyePointId;
-    int          barycentricId;
-    LightIds     lightIds[numLights];
+    unsigned int  programId;
+    int           modelId;
+    int           modelNormalId;
+    int           viewId;
+    int           projectionId;
+    int           colorId;
+    int           wireframeColorId;
+    int           eyePointId;
+    int           barycentricId;
+    LightIds      lightIds[numLights];
+    bool          hasLightUniformsBlock;
+    unsigned int  globalUniformsVersion; // version of the uploaded global uniforms
+    UniformMatrix view;
+    UniformMatrix projection;
 
     ShaderIds ()
       : programId (0)
@@ -51,6 +89,8 @@ namespace
       , wireframeColorId (0)
       , eyePointId (0)
       , barycentricId (0)
+      , hasLightUniformsBlock (false)
+      , globalUniformsVersion (0)
     {
     }
   };
@@ -67,19 +107,42 @@ namespace
     GlobalLightUniforms lightUniforms[numLights];
     glm::vec3           eyePoint;
   };
+
+  // std140 layout of the `LightUniforms` block
+  struct LightUniformsBlock
+  {
+    struct Light
+    {
+      glm::vec4 direction;
+      glm::vec3 color;
+      float     irradiance;
+    };
+
+    Light lights[numLights];
+  };
+
+  static_assert (sizeof (LightUniformsBlock) == numLights * 8 * sizeof (float),
+                 "Unexpected memory layout");
 };
 
 struct Renderer::Impl
 {
-  static const unsigned int numShaders = 6;
+  static const unsigned int numShaders = 9;
 
   ShaderIds      shaderIds[Impl::numShaders];
   ShaderIds*     activeShaderIndex;
   GlobalUniforms globalUniforms;
+  unsigned int   globalUniformsVersion;
+  OpenGLBufferId lightUniformsBufferId;
+  unsigned int   lightUniformsBufferVersion; // version of the buffered light uniforms
   Color          clearColor;
+  RenderProfiler profiler;
+  OverlayBatch   overlay;
 
   Impl (const Config& config)
     : activeShaderIndex (nullptr)
+    , globalUniformsVersion (1)
+    , lightUniformsBufferVersion (0)
   {
     this->runFromConfig (config);
   }
@@ -92,7 +155,7 @@ struct Renderer::Impl
     }
   }
 
-  void setupRendering ()
+  void setupRendering (bool clear)
   {
     OpenGL::glClearColor (this->clearColor.r (), this->clearColor.g (), this->clearColor.b (),
                           0.0f);
@@ -102,7 +165,47 @@ struct Renderer::Impl
     OpenGL::glCullFace (OpenGL::Back ());
     OpenGL::glEnable (OpenGL::DepthTest ());
     OpenGL::glDepthFunc (OpenGL::LEqual ());
-    OpenGL::glClear (OpenGL::ColorBufferBit () | OpenGL::DepthBufferBit ());
+    if (clear)
+    {
+      OpenGL::glClear (OpenGL::ColorBufferBit () | OpenGL::DepthBufferBit ());
+    }
+
+    // the active program may have been changed in between frames, e.g. by `QPainter`
+    this->activeShaderIndex = nullptr;
+
+    if (OpenGL::hasUniformBufferObject ())
+    {
+      this->bufferLightUniforms ();
+    }
+  }
+
+  void bufferLightUniforms ()
+  {
+    if (this->lightUniformsBufferId.isValid () == false)
+    {
+      this->lightUniformsBufferId.allocate ();
+    }
+
+    if (this->lightUniformsBufferVersion != this->globalUniformsVersion)
+    {
+      LightUniformsBlock block;
+      for (unsigned int i = 0; i < numLights; i++)
+      {
+        const GlobalLightUniforms& light = this->globalUniforms.lightUniforms[i];
+
+        block.lights[i].direction = glm::vec4 (light.direction, 0.0f);
+        block.lights[i].color = light.color.vec3 ();
+        block.lights[i].irradiance = light.irradiance;
+      }
+      OpenGL::glBindBuffer (OpenGL::UniformBuffer (), this->lightUniformsBufferId.id ());
+      OpenGL::glBufferData (OpenGL::UniformBuffer (), sizeof (LightUniformsBlock), &block,
+                            OpenGL::StreamDraw ());
+      OpenGL::glBindBuffer (OpenGL::UniformBuffer (), 0);
+
+      this->lightUniformsBufferVersion = this->globalUniformsVersion;
+    }
+    OpenGL::glBindBufferBase (OpenGL::UniformBuffer (), lightUniformsBinding,
+                              this->lightUniformsBufferId.id ());
   }
 
   void shutdownRendering ()
@@ -113,7 +216,28 @@ struct Renderer::Impl
 
   unsigned int shaderIndex (const RenderMode& renderMode)
   {
-    if (renderMode.smoothShading ())
+    if (renderMode.instancing ())
+    {
+      assert (renderMode.renderWireframe () == false);
+
+      if (renderMode.smoothShading ())
+      {
+        return 6;
+      }
+      else if (renderMode.flatShading ())
+      {
+        return 7;
+      }
+      else if (renderMode.constantShading ())
+      {
+        return 8;
+      }
+      else
+      {
+        DILAY_IMPOSSIBLE
+      }
+    }
+    else if (renderMode.smoothShading ())
     {
       return renderMode.renderWireframe () ? 0 : 1;
     }
@@ -131,12 +255,51 @@ struct Renderer::Impl
     }
   }
 
-  void initalizeProgram (const RenderMode& renderMode)
+  // inverse of `shaderIndex`
+  RenderMode renderModeOf (unsigned int index) const
   {
-    assert (renderMode.renderWireframe () == false || OpenGL::hasGeometryShader ());
+    assert (index < Impl::numShaders);
 
-    const unsigned int id = OpenGL::loadProgram (
-      renderMode.vertexShader (), renderMode.fragmentShader (), renderMode.renderWireframe ());
+    const unsigned int shading = index < 6 ? index / 2 : index - 6;
+    RenderMode         mode;
+
+    if (shading == 0)
+    {
+      mode.smoothShading (true);
+    }
+    else if (shading == 1)
+    {
+      mode.flatShading (true);
+    }
+    else
+    {
+      mode.constantShading (true);
+    }
+    mode.renderWireframe (index < 6 && index % 2 == 0);
+    mode.instancing (index >= 6);
+    return mode;
+  }
+
+  bool precompileProgram ()
+  {
+    const unsigned int numPrograms = OpenGL::hasInstancing () ? Impl::numShaders : 6;
+
+    for (unsigned int i = 0; i < numPrograms; i++)
+    {
+      if (this->shaderIds[i].programId == 0)
+      {
+        this->initalizeProgram (this->renderModeOf (i));
+        return i + 1 < numPrograms;
+      }
+    }
+    return false;
+  }
+
+  void initalizeProgram (const RenderMode& renderMode)
+  {
+    const unsigned int id =
+      OpenGL::loadProgram (renderMode.vertexShader (), renderMode.fragmentShader (),
+                           renderMode.renderWireframe () && OpenGL::hasGeometryShader ());
 
     unsigned int index = this->shaderIndex (renderMode);
     assert (this->shaderIds[index].programId == 0);
@@ -158,6 +321,17 @@ struct Renderer::Impl
     s->lightIds[1].directionId = OpenGL::glGetUniformLocation (id, "light2Direction");
     s->lightIds[1].colorId = OpenGL::glGetUniformLocation (id, "light2Color");
     s->lightIds[1].irradianceId = OpenGL::glGetUniformLocation (id, "light2Irradiance");
+
+    if (OpenGL::hasUniformBufferObject ())
+    {
+      const unsigned int block = OpenGL::glGetUniformBlockIndex (id, "LightUniforms");
+
+      if (block != OpenGL::InvalidIndex ())
+      {
+        OpenGL::glUniformBlockBinding (id, block, lightUniformsBinding);
+        s->hasLightUniformsBlock = true;
+      }
+    }
   }
 
   void setProgram (const RenderMode& renderMode)
@@ -170,19 +344,32 @@ struct Renderer::Impl
     }
     assert (this->shaderIds[index].programId);
 
-    this->activeShaderIndex = &this->shaderIds[index];
-    OpenGL::glUseProgram (this->activeShaderIndex->programId);
+    ShaderIds* shader = &this->shaderIds[index];
 
-    OpenGL::glUniformVec3 (this->activeShaderIndex->eyePointId, this->globalUniforms.eyePoint);
+    if (this->activeShaderIndex != shader)
+    {
+      this->activeShaderIndex = shader;
+      OpenGL::glUseProgram (shader->programId);
+    }
 
-    for (unsigned int i = 0; i < numLights; i++)
+    if (shader->globalUniformsVersion != this->globalUniformsVersion)
     {
-      OpenGL::glUniformVec3 (this->activeShaderIndex->lightIds[i].directionId,
-                             this->globalUniforms.lightUniforms[i].direction);
-      OpenGL::glUniformVec3 (this->activeShaderIndex->lightIds[i].colorId,
-                             this->globalUniforms.lightUniforms[i].color.vec3 ());
-      OpenGL::glUniform1f (this->activeShaderIndex->lightIds[i].irradianceId,
-                           this->globalUniforms.lightUniforms[i].irradiance);
+      shader->globalUniformsVersion = this->globalUniformsVersion;
+
+      OpenGL::glUniformVec3 (shader->eyePointId, this->globalUniforms.eyePoint);
+
+      // lights of programs with a `LightUniforms` block are buffered in `setupRendering`
+      if (shader->hasLightUniformsBlock == false)
+      {
+        for (unsigned int i = 0; i < numLights; i++)
+        {
+          const GlobalLightUniforms& light = this->globalUniforms.lightUniforms[i];
+
+          OpenGL::glUniformVec3 (shader->lightIds[i].directionId, light.direction);
+          OpenGL::glUniformVec3 (shader->lightIds[i].colorId, light.color.vec3 ());
+          OpenGL::glUniform1f (shader->lightIds[i].irradianceId, light.irradiance);
+        }
+      }
     }
   }
 
@@ -196,13 +383,21 @@ struct Renderer::Impl
   void setView (const float* view)
   {
     assert (this->activeShaderIndex);
-    OpenGL::glUniformMatrix4fv (this->activeShaderIndex->viewId, 1, false, view);
+
+    if (this->activeShaderIndex->view.update (view))
+    {
+      OpenGL::glUniformMatrix4fv (this->activeShaderIndex->viewId, 1, false, view);
+    }
   }
 
   void setProjection (const float* projection)
   {
     assert (this->activeShaderIndex);
-    OpenGL::glUniformMatrix4fv (this->activeShaderIndex->projectionId, 1, false, projection);
+
+    if (this->activeShaderIndex->projection.update (projection))
+    {
+      OpenGL::glUniformMatrix4fv (this->activeShaderIndex->projectionId, 1, false, projection);
+    }
   }
 
   void setColor (const Color& c, bool withOpacity)
@@ -233,24 +428,31 @@ struct Renderer::Impl
     }
   }
 
-  void setEyePoint (const glm::vec3& e) { this->globalUniforms.eyePoint = e; }
+  void setEyePoint (const glm::vec3& e)
+  {
+    this->globalUniforms.eyePoint = e;
+    this->globalUniformsVersion++;
+  }
 
   void setLightDirection (unsigned int i, const glm::vec3& d)
   {
     assert (i < numLights);
     this->globalUniforms.lightUniforms[i].direction = d;
+    this->globalUniformsVersion++;
   }
 
   void setLightColor (unsigned int i, const Color& c)
   {
     assert (i < numLights);
     this->globalUniforms.lightUniforms[i].color = c;
+    this->globalUniformsVersion++;
   }
 
   void setLightIrradiance (unsigned int i, float irr)
   {
     assert (i < numLights);
     this->globalUniforms.lightUniforms[i].irradiance = irr;
+    this->globalUniformsVersion++;
   }
 
   void runFromConfig (const Config& config)
@@ -271,7 +473,8 @@ struct Renderer::Impl
 
 DELEGATE1_BIG3 (Renderer, const Config&)
 
-DELEGATE (void, Renderer, setupRendering)
+DELEGATE1 (void, Renderer, setupRendering, bool)
+DELEGATE (bool, Renderer, precompileProgram)
 DELEGATE (void, Renderer, shutdownRendering)
 DELEGATE1 (void, Renderer, setProgram, const RenderMode&)
 DELEGATE2 (void, Renderer, setModel, const float*, const float*)
@@ -283,4 +486,6 @@ DELEGATE1 (void, Renderer, setEyePoint, const glm::vec3&)
 DELEGATE2 (void, Renderer, setLightDirection, unsigned int, const glm::vec3&)
 DELEGATE2 (void, Renderer, setLightColor, unsigned int, const Color&)
 DELEGATE2 (void, Renderer, setLightIrradiance, unsigned int, float)
+GETTER (RenderProfiler&, Renderer, profiler)
+GETTER (OverlayBatch&, Renderer, overlay)
 DELEGATE1 (void, Renderer, runFromConfig, const Config&)
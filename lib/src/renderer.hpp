@@ -11,14 +11,18 @@
 
 class Color;
 class Config;
+class OverlayBatch;
 class RenderMode;
+class RenderProfiler;
 
 class Renderer : public Configurable
 {
 public:
   DECLARE_BIG3 (Renderer, const Config&)
 
-  void setupRendering ();
+  void setupRendering (bool = true);
+  // compiles a program that has not been used yet, returns `false` if no program remains
+  bool precompileProgram ();
   void shutdownRendering ();
   void setProgram (const RenderMode&);
   void setModel (const float*, const float*);
@@ -31,6 +35,10 @@ public:
   void setLightColor (unsigned int, const Color&);
   void setLightIrradiance (unsigned int, float);
 
+  RenderProfiler& profiler ();
+  // lines and triangles of overlays, which are drawn when the batch is flushed
+  OverlayBatch&   overlay ();
+
 private:
   IMPLEMENTATION
 
@@ -0,0 +1,180 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QTimer>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "dynamic/mesh.hpp"
+#include "import-export.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "scene-loader.hpp"
+#include "scene.hpp"
+
+namespace
+{
+  // interval (in milliseconds) in which the stages of a load are polled
+  constexpr int pollInterval = 50;
+
+  enum class Stage
+  {
+    Parsing,
+    Parsed,
+    Built,
+    Failed
+  };
+}
+
+struct SceneLoader::Impl
+{
+  Scene&                                    scene;
+  const Config&                             config;
+  std::function<void()>                     update;
+  QTimer                                    timer;
+  std::thread                               thread;
+  std::atomic<Stage>                        stage;
+  bool                                      hasPreviews;
+  std::string                               fileName;
+  Callback                                  callback;
+  std::unique_ptr<ImportExportContents>     contents;
+  std::vector<Mesh>                         previews;
+  std::vector<std::unique_ptr<DynamicMesh>> dynamicMeshes;
+
+  Impl (Scene& s, const Config& c, const std::function<void()>& u)
+    : scene (s)
+    , config (c)
+    , update (u)
+    , stage (Stage::Parsing)
+    , hasPreviews (false)
+  {
+    this->timer.setInterval (pollInterval);
+    QObject::connect (&this->timer, &QTimer::timeout, [this]() { this->poll (); });
+  }
+
+  ~Impl () { this->cancel (); }
+
+  bool isRunning () const { return this->thread.joinable (); }
+
+  void load (const std::string& f, const Callback& c)
+  {
+    this->cancel ();
+
+    this->fileName = f;
+    this->callback = c;
+    this->stage = Stage::Parsing;
+    this->hasPreviews = false;
+    this->contents.reset (new ImportExportContents);
+
+    // each stage publishes its results by advancing `stage`, after which it does not touch them
+    this->thread = std::thread ([this]() {
+      if (this->contents->fromDlyFile (this->fileName) == false)
+      {
+        this->stage = Stage::Failed;
+        return;
+      }
+
+      for (unsigned int i = 0; i < this->contents->numMeshes (); i++)
+      {
+        this->previews.push_back (this->contents->mesh (i));
+        MeshUtil::setNormals (this->previews.back ());
+      }
+      this->stage = Stage::Parsed;
+
+      for (unsigned int i = 0; i < this->contents->numMeshes (); i++)
+      {
+        this->dynamicMeshes.emplace_back (new DynamicMesh (this->contents->dynamicMesh (i)));
+      }
+      this->stage = Stage::Built;
+    });
+    this->timer.start ();
+  }
+
+  void reset ()
+  {
+    this->timer.stop ();
+    this->scene.deletePreviewMeshes ();
+    this->contents.reset ();
+    this->previews.clear ();
+    this->dynamicMeshes.clear ();
+  }
+
+  void deliver (bool success)
+  {
+    if (success)
+    {
+      for (std::unique_ptr<DynamicMesh>& mesh : this->dynamicMeshes)
+      {
+        this->scene.newDynamicMesh (this->config, std::move (*mesh));
+      }
+      this->contents->addSketchesToScene (this->config, this->scene);
+
+      // imported files are not overwritten when the scene is saved
+      if (this->contents->isImportedFile () == false)
+      {
+        this->scene.fileName (this->fileName);
+      }
+    }
+
+    const Callback callback = this->callback;
+
+    this->reset ();
+    this->callback = nullptr;
+    callback (success);
+  }
+
+  void poll ()
+  {
+    const Stage stage = this->stage;
+
+    if (stage == Stage::Failed)
+    {
+      this->thread.join ();
+      this->deliver (false);
+      this->update ();
+    }
+    else if (stage == Stage::Built)
+    {
+      this->thread.join ();
+      this->deliver (true);
+      this->update ();
+    }
+    else if (stage == Stage::Parsed && this->hasPreviews == false)
+    {
+      for (const Mesh& mesh : this->previews)
+      {
+        this->scene.newPreviewMesh (this->config, mesh);
+      }
+      this->hasPreviews = true;
+      this->update ();
+    }
+  }
+
+  void cancel ()
+  {
+    if (this->isRunning ())
+    {
+      this->thread.join ();
+      this->reset ();
+      this->callback = nullptr;
+    }
+  }
+
+  void finish ()
+  {
+    if (this->isRunning ())
+    {
+      this->thread.join ();
+      this->deliver (this->stage == Stage::Built);
+      this->update ();
+    }
+  }
+};
+
+DELEGATE3_BIG2 (SceneLoader, Scene&, const Config&, const std::function<void()>&)
+DELEGATE_CONST (bool, SceneLoader, isRunning)
+DELEGATE2 (void, SceneLoader, load, const std::string&, const Callback&)
+DELEGATE (void, SceneLoader, cancel)
+DELEGATE (void, SceneLoader, finish)
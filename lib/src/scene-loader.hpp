@@ -0,0 +1,39 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_SCENE_LOADER
+#define DILAY_SCENE_LOADER
+
+#include <functional>
+#include <string>
+#include "macro.hpp"
+
+class Config;
+class Scene;
+
+/* Loads a file into a scene on a background thread.  Once the file has been parsed, its meshes
+ * are shown as preview meshes while their dynamic meshes, including their octrees, are built.
+ * The dynamic meshes then replace the previews, such that they can be picked and edited.  The
+ * calling thread polls the stages from its event loop and calls `update` whenever the scene has
+ * changed.
+ */
+class SceneLoader
+{
+public:
+  typedef std::function<void(bool)> Callback;
+
+  DECLARE_BIG2 (SceneLoader, Scene&, const Config&, const std::function<void()>&)
+
+  bool isRunning () const;
+  // cancels a running load, whose result is discarded
+  void load (const std::string&, const Callback&);
+  void cancel ();
+  // waits for a running load and delivers its result
+  void finish ();
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
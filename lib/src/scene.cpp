@@ -3,30 +3,68 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <list>
+#include <vector>
+#include "camera.hpp"
+#include "color.hpp"
 #include "config.hpp"
 #include "dynamic/mesh-intersection.hpp"
 #include "dynamic/mesh.hpp"
+#include "dynamic/octree.hpp"
 #include "import-export.hpp"
 #include "intersection.hpp"
+#include "mesh-arena.hpp"
+#include "mesh-bvh.hpp"
+#include "mesh-occlusion.hpp"
+#include "mesh-proxies.hpp"
+#include "mesh.hpp"
+#include "overlay-batch.hpp"
+#include "profiler.hpp"
 #include "render-mode.hpp"
+#include "render-profiler.hpp"
+#include "renderer.hpp"
 #include "scene.hpp"
 #include "sketch/bone-intersection.hpp"
 #include "sketch/mesh-intersection.hpp"
 #include "sketch/mesh.hpp"
 #include "sketch/node-intersection.hpp"
 #include "sketch/path-intersection.hpp"
+#include "slot-map.hpp"
 #include "util.hpp"
 
+namespace
+{
+  const Config::Key<Color> normalColorKey ("editor/mesh/color/normal");
+  const Config::Key<Color> wireframeColorKey ("editor/mesh/color/wireframe");
+}
+
 struct Scene::Impl
 {
-  Scene*                 self;
-  std::list<DynamicMesh> dynamicMeshes;
-  std::list<SketchMesh>  sketchMeshes;
-  RenderMode             commonRenderMode;
-  std::string            fileName;
+  Scene*                    self;
+  SlotMap<DynamicMesh>      dynamicMeshes;
+  SlotMap<SketchMesh>       sketchMeshes;
+  std::list<Mesh>           previewMeshes;
+  RenderMode                commonRenderMode;
+  std::string               fileName;
+  MeshProxies               proxies;
+  MeshOcclusion             occlusion;
+  MeshArena                 arena;
+  bool                      arenaIsEnabled;
+  unsigned int              arenaMaxFaces;
+  unsigned int              minCachedFaces;
+  bool                      isNavigating;
+  DynamicOctreeOverlay      _octreeOverlay;
+  MeshBvh                   bvh;
+  std::vector<DynamicMesh*> bvhMeshes;
 
   Impl (Scene* s, const Config& config)
     : self (s)
+    , proxies (config)
+    , occlusion (config)
+    , arenaIsEnabled (false)
+    , arenaMaxFaces (0)
+    , minCachedFaces (0)
+    , isNavigating (false)
+    , _octreeOverlay (DynamicOctreeOverlay::None)
   {
     this->runFromConfig (config);
 
@@ -35,33 +73,49 @@ struct Scene::Impl
 
   DynamicMesh& newDynamicMesh (const Config& config, const DynamicMesh& other)
   {
-    this->dynamicMeshes.emplace_back (other);
+    this->dynamicMeshes.emplace (other);
+    this->setupMesh (config, this->dynamicMeshes.back ());
+    return this->dynamicMeshes.back ();
+  }
+
+  DynamicMesh& newDynamicMesh (const Config& config, DynamicMesh&& other)
+  {
+    this->dynamicMeshes.emplace (std::move (other));
     this->setupMesh (config, this->dynamicMeshes.back ());
     return this->dynamicMeshes.back ();
   }
 
   DynamicMesh& newDynamicMesh (const Config& config, const Mesh& mesh)
   {
-    this->dynamicMeshes.emplace_back (mesh);
+    this->dynamicMeshes.emplace (mesh);
     this->setupMesh (config, this->dynamicMeshes.back ());
     return this->dynamicMeshes.back ();
   }
 
   SketchMesh& newSketchMesh (const Config& config, const SketchMesh& other)
   {
-    this->sketchMeshes.emplace_back (other);
+    this->sketchMeshes.emplace (other);
     this->setupMesh (config, this->sketchMeshes.back ());
     return this->sketchMeshes.back ();
   }
 
   SketchMesh& newSketchMesh (const Config& config, const SketchTree& tree)
   {
-    this->sketchMeshes.emplace_back ();
+    this->sketchMeshes.emplace ();
     this->sketchMeshes.back ().fromTree (tree);
     this->setupMesh (config, this->sketchMeshes.back ());
     return this->sketchMeshes.back ();
   }
 
+  void newPreviewMesh (const Config& config, const Mesh& mesh)
+  {
+    this->previewMeshes.emplace_back (mesh);
+    this->previewMeshes.back ().renderMode () = this->commonRenderMode;
+    this->previewMeshes.back ().color (config.get (normalColorKey));
+    this->previewMeshes.back ().wireframeColor (config.get (wireframeColorKey));
+    this->previewMeshes.back ().bufferData ();
+  }
+
   void setupMesh (const Config& config, DynamicMesh& mesh)
   {
     mesh.bufferData ();
@@ -75,49 +129,97 @@ struct Scene::Impl
     mesh.fromConfig (config);
   }
 
+  // the replacement takes the place of the mesh, such that the order of meshes is kept
+  DynamicMesh& replaceMesh (const Config& config, DynamicMesh& mesh, const DynamicMesh& other)
+  {
+    DynamicMesh& replaced = this->dynamicMeshes.replace (mesh, other);
+    this->setupMesh (config, replaced);
+    return replaced;
+  }
+
   void deleteMesh (DynamicMesh& mesh)
   {
-    for (auto it = this->dynamicMeshes.begin (); it != this->dynamicMeshes.end (); ++it)
-    {
-      if (&*it == &mesh)
-      {
-        this->dynamicMeshes.erase (it);
-        this->resetIfEmpty ();
-        return;
-      }
-    }
-    DILAY_IMPOSSIBLE
+    this->dynamicMeshes.erase (mesh);
+    this->resetIfEmpty ();
   }
 
   void deleteMesh (SketchMesh& mesh)
   {
-    for (auto it = this->sketchMeshes.begin (); it != this->sketchMeshes.end (); ++it)
-    {
-      if (&*it == &mesh)
-      {
-        this->sketchMeshes.erase (it);
-        this->resetIfEmpty ();
-        return;
-      }
-    }
-    DILAY_IMPOSSIBLE
+    this->sketchMeshes.erase (mesh);
+    this->resetIfEmpty ();
   }
 
   void deleteDynamicMeshes () { this->dynamicMeshes.clear (); }
 
   void deleteSketchMeshes () { this->sketchMeshes.clear (); }
 
+  void deletePreviewMeshes () { this->previewMeshes.clear (); }
+
   void deleteEmptyMeshes ()
   {
-    this->dynamicMeshes.remove_if ([](const auto& mesh) { return mesh.isEmpty (); });
-    this->sketchMeshes.remove_if ([](const auto& mesh) { return mesh.isEmpty (); });
+    this->dynamicMeshes.eraseIf ([](const auto& mesh) { return mesh.isEmpty (); });
+    this->sketchMeshes.eraseIf ([](const auto& mesh) { return mesh.isEmpty (); });
     this->resetIfEmpty ();
   }
 
-  void render (Camera& camera)
+  // whether a mesh is drawn like all others, such that it can be drawn from the arena
+  bool isArenaMesh (const DynamicMesh& mesh) const
+  {
+    const RenderMode& mode = mesh.renderMode ();
+
+    return this->arenaIsEnabled && MeshArena::isSupported () &&
+           mesh.numFaces () <= this->arenaMaxFaces && mesh.hasMask () == false &&
+           mesh.deferNormals () == false && mode.renderWireframe () == false &&
+           mode.noDepthTest () == false && mode.cameraRotationOnly () == false &&
+           mode.instancing () == false &&
+           mode.smoothShading () == this->commonRenderMode.smoothShading () &&
+           mode.flatShading () == this->commonRenderMode.flatShading () &&
+           mode.constantShading () == this->commonRenderMode.constantShading ();
+  }
+
+  void render (Camera& camera, const std::function<void()>& afterDynamicMeshes)
   {
-    this->forEachMesh ([&](DynamicMesh& m) { m.render (camera); });
+    PROFILE_ZONE ("render/scene")
+    RenderProfiler& profiler = camera.renderer ().profiler ();
+
+    std::vector<const DynamicMesh*> meshes;
+
+    profiler.beginPhase (RenderPhase::Meshes);
+    this->forEachMesh ([&](DynamicMesh& m) {
+      meshes.push_back (&m);
+
+      if (this->occlusion.isOccluded (m) == false &&
+          this->proxies.render (camera, m, this->isNavigating) == false)
+      {
+        if (this->isArenaMesh (m) == false || this->arena.add (m.mesh ()) == false)
+        {
+          m.render (camera);
+        }
+      }
+    });
+    if (MeshArena::isSupported ())
+    {
+      this->arena.render (camera, this->commonRenderMode);
+    }
+    this->occlusion.test (camera, meshes);
+    this->forEachMesh (
+      [this, &camera](DynamicMesh& m) { m.renderOctree (camera, this->_octreeOverlay); });
+    camera.renderer ().overlay ().flush (camera);
+
+    if (afterDynamicMeshes)
+    {
+      afterDynamicMeshes ();
+    }
+
+    for (const Mesh& m : this->previewMeshes)
+    {
+      m.render (camera);
+    }
+    profiler.endPhase (RenderPhase::Meshes);
+
+    profiler.beginPhase (RenderPhase::Sketches);
     this->forEachMesh ([&](SketchMesh& m) { m.render (camera); });
+    profiler.endPhase (RenderPhase::Sketches);
   }
 
   template <typename TMesh, typename TIntersection, typename... Ts>
@@ -129,9 +231,28 @@ struct Scene::Impl
     return intersection.isIntersection ();
   }
 
+  // the distance of an intersection that has been found before is an upper bound of the traversal
+  template <typename TIntersection>
+  bool intersectsDynamicMeshes (const PrimRay& ray, TIntersection& intersection)
+  {
+    const auto upperBound = [&intersection]() {
+      return intersection.isIntersection () ? intersection.distance () : Util::maxFloat ();
+    };
+
+    this->bvhMeshes.clear ();
+    this->forEachMesh ([this](DynamicMesh& m) { this->bvhMeshes.push_back (&m); });
+    this->bvh.update (this->bvhMeshes);
+
+    this->bvh.intersects (ray, upperBound (), [&ray, &intersection, &upperBound](DynamicMesh& m) {
+      m.intersects (ray, intersection);
+      return upperBound ();
+    });
+    return intersection.isIntersection ();
+  }
+
   bool intersects (const PrimRay& ray, DynamicMeshIntersection& intersection)
   {
-    return this->intersectsT<DynamicMesh> (ray, intersection);
+    return this->intersectsDynamicMeshes (ray, intersection);
   }
 
   bool intersects (const PrimRay& ray, SketchNodeIntersection& intersection,
@@ -161,22 +282,17 @@ struct Scene::Impl
     return this->intersectsT<SketchMesh> (ray, intersection);
   }
 
+  // sketch meshes are cheap to intersect, so their nearest hit is used to prune dynamic meshes
   bool intersects (const PrimRay& ray, Intersection& intersection)
   {
-    DynamicMeshIntersection dIntersection;
-    SketchMeshIntersection  sIntersection;
+    SketchMeshIntersection sIntersection;
 
-    if (this->intersects (ray, dIntersection))
-    {
-      intersection.update (dIntersection.distance (), dIntersection.position (),
-                           dIntersection.normal ());
-    }
     if (this->intersects (ray, sIntersection))
     {
       intersection.update (sIntersection.distance (), sIntersection.position (),
                            sIntersection.normal ());
     }
-    return intersection.isIntersection ();
+    return this->intersectsDynamicMeshes (ray, intersection);
   }
 
   void printStatistics () const
@@ -184,42 +300,43 @@ struct Scene::Impl
     this->forEachConstMesh ([](const DynamicMesh& mesh) { mesh.printStatistics (); });
   }
 
-  template <typename T> void forEachMeshT (std::list<T>& list, const std::function<void(T&)>& f)
+  void reportMemory (MemoryReport& report) const
   {
-    const unsigned int n = list.size ();
-    unsigned int       i = 0;
+    this->forEachConstMesh ([&report](const DynamicMesh& mesh) { mesh.reportMemory (report); });
 
-    for (T& mesh : list)
+    for (const Mesh& mesh : this->previewMeshes)
     {
-      if (i >= n)
-      {
-        break;
-      }
-      else
-      {
-        f (mesh);
-        i++;
-      }
+      mesh.reportMemory (report);
+    }
+  }
+
+  void updateProxies ()
+  {
+    std::vector<const DynamicMesh*> meshes;
+
+    this->forEachConstMesh ([&meshes](const DynamicMesh& mesh) { meshes.push_back (&mesh); });
+    this->proxies.update (meshes);
+  }
+
+  // meshes that are added by the callback are not visited
+  template <typename T> void forEachMeshT (SlotMap<T>& meshes, const std::function<void(T&)>& f)
+  {
+    const unsigned int n = meshes.size ();
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+      f (meshes[i]);
     }
   }
 
   template <typename T>
-  void forEachConstMeshT (const std::list<T>& list, const std::function<void(const T&)>& f) const
+  void forEachConstMeshT (const SlotMap<T>& meshes, const std::function<void(const T&)>& f) const
   {
-    const unsigned int n = list.size ();
-    unsigned int       i = 0;
+    const unsigned int n = meshes.size ();
 
-    for (const T& mesh : list)
+    for (unsigned int i = 0; i < n; i++)
     {
-      if (i >= n)
-      {
-        break;
-      }
-      else
-      {
-        f (mesh);
-        i++;
-      }
+      f (meshes[i]);
     }
   }
 
@@ -243,15 +360,11 @@ struct Scene::Impl
     this->forEachConstMeshT<SketchMesh> (this->sketchMeshes, f);
   }
 
-  void sanitizeMeshes ()
-  {
-    this->forEachMesh ([](DynamicMesh& mesh) { mesh.sanitize (); });
-  }
-
   void reset ()
   {
     this->deleteDynamicMeshes ();
     this->deleteSketchMeshes ();
+    this->deletePreviewMeshes ();
     this->fileName.clear ();
   }
 
@@ -267,6 +380,10 @@ struct Scene::Impl
   {
     this->commonRenderMode = mode;
     this->forEachMesh ([this](DynamicMesh& mesh) { mesh.renderMode () = this->commonRenderMode; });
+    for (Mesh& mesh : this->previewMeshes)
+    {
+      mesh.renderMode () = this->commonRenderMode;
+    }
     this->forEachMesh (
       [&mode](SketchMesh& mesh) { mesh.renderWireframe (mode.renderWireframe ()); });
   }
@@ -279,6 +396,14 @@ struct Scene::Impl
     this->setCommonRenderMode (this->commonRenderMode);
   }
 
+  DynamicOctreeOverlay octreeOverlay () const { return this->_octreeOverlay; }
+
+  void octreeOverlay (DynamicOctreeOverlay overlay) { this->_octreeOverlay = overlay; }
+
+  bool navigating () const { return this->isNavigating; }
+
+  void navigating (bool value) { this->isNavigating = value; }
+
   void toggleWireframe () { this->renderWireframe (!this->commonRenderMode.renderWireframe ()); }
 
   void toggleShading ()
@@ -314,7 +439,7 @@ struct Scene::Impl
     assert (this->hasFileName ());
 
     return Util::withCLocale<bool> ([this, isObjFile]() {
-      if (ImportExport::toDlyFile (this->fileName, *this->self, isObjFile))
+      if (ImportExport::toDlyFile (this->fileName, *this->self, isObjFile, this->minCachedFaces))
       {
         return true;
       }
@@ -351,23 +476,38 @@ struct Scene::Impl
   {
     this->forEachMesh ([&config](DynamicMesh& mesh) { mesh.fromConfig (config); });
     this->forEachMesh ([&config](SketchMesh& mesh) { mesh.fromConfig (config); });
+    this->proxies.fromConfig (config);
+    this->occlusion.fromConfig (config);
+
+    this->arenaIsEnabled = config.get<bool> ("editor/mesh/arena/enabled");
+    this->arenaMaxFaces = config.get<int> ("editor/mesh/arena/max-faces");
+    this->minCachedFaces = config.get<int> ("editor/mesh/file-cache/min-faces");
+
+    if (this->arenaIsEnabled == false)
+    {
+      this->arena.reset ();
+    }
   }
 };
 
 DELEGATE1_BIG3_SELF (Scene, const Config&)
 
 DELEGATE2 (DynamicMesh&, Scene, newDynamicMesh, const Config&, const DynamicMesh&)
+DELEGATE2 (DynamicMesh&, Scene, newDynamicMesh, const Config&, DynamicMesh&&)
 DELEGATE2 (DynamicMesh&, Scene, newDynamicMesh, const Config&, const Mesh&)
 DELEGATE2 (SketchMesh&, Scene, newSketchMesh, const Config&, const SketchMesh&)
 DELEGATE2 (SketchMesh&, Scene, newSketchMesh, const Config&, const SketchTree&)
+DELEGATE2 (void, Scene, newPreviewMesh, const Config&, const Mesh&)
 DELEGATE2 (void, Scene, setupMesh, const Config&, DynamicMesh&)
 DELEGATE2 (void, Scene, setupMesh, const Config&, SketchMesh&)
+DELEGATE3 (DynamicMesh&, Scene, replaceMesh, const Config&, DynamicMesh&, const DynamicMesh&)
 DELEGATE1 (void, Scene, deleteMesh, DynamicMesh&)
 DELEGATE1 (void, Scene, deleteMesh, SketchMesh&)
 DELEGATE (void, Scene, deleteDynamicMeshes)
 DELEGATE (void, Scene, deleteSketchMeshes)
+DELEGATE (void, Scene, deletePreviewMeshes)
 DELEGATE (void, Scene, deleteEmptyMeshes)
-DELEGATE1 (void, Scene, render, Camera&)
+DELEGATE2 (void, Scene, render, Camera&, const std::function<void()>&)
 DELEGATE2 (bool, Scene, intersects, const PrimRay&, DynamicMeshIntersection&)
 DELEGATE3 (bool, Scene, intersects, const PrimRay&, SketchNodeIntersection&, const SketchNode*)
 DELEGATE2 (bool, Scene, intersects, const PrimRay&, SketchBoneIntersection&)
@@ -376,23 +516,29 @@ DELEGATE3 (bool, Scene, intersects, const PrimRay&, SketchMeshIntersection&, uns
 DELEGATE2 (bool, Scene, intersects, const PrimRay&, SketchPathIntersection&)
 DELEGATE2 (bool, Scene, intersects, const PrimRay&, Intersection&)
 DELEGATE_CONST (void, Scene, printStatistics)
+DELEGATE1_CONST (void, Scene, reportMemory, MemoryReport&)
+DELEGATE (void, Scene, updateProxies)
 DELEGATE1 (void, Scene, forEachMesh, const std::function<void(DynamicMesh&)>&)
 DELEGATE1 (void, Scene, forEachMesh, const std::function<void(SketchMesh&)>&)
 DELEGATE1_CONST (void, Scene, forEachConstMesh, const std::function<void(const DynamicMesh&)>&)
 DELEGATE1_CONST (void, Scene, forEachConstMesh, const std::function<void(const SketchMesh&)>&)
-DELEGATE (void, Scene, sanitizeMeshes)
 DELEGATE (void, Scene, reset)
 GETTER_CONST (const RenderMode&, Scene, commonRenderMode)
 DELEGATE_CONST (bool, Scene, renderWireframe)
 DELEGATE1 (void, Scene, renderWireframe, bool)
+DELEGATE_CONST (bool, Scene, navigating)
+DELEGATE1 (void, Scene, navigating, bool)
 DELEGATE (void, Scene, toggleWireframe)
 DELEGATE (void, Scene, toggleShading)
+DELEGATE_CONST (DynamicOctreeOverlay, Scene, octreeOverlay)
+DELEGATE1 (void, Scene, octreeOverlay, DynamicOctreeOverlay)
 DELEGATE_CONST (bool, Scene, isEmpty)
 DELEGATE_CONST (unsigned int, Scene, numDynamicMeshes)
 DELEGATE_CONST (unsigned int, Scene, numSketchMeshes)
 DELEGATE_CONST (unsigned int, Scene, numFaces)
 DELEGATE_CONST (bool, Scene, hasFileName)
 GETTER_CONST (const std::string&, Scene, fileName)
+SETTER (const std::string&, Scene, fileName)
 DELEGATE1 (bool, Scene, toDlyFile, bool)
 DELEGATE2 (bool, Scene, toDlyFile, const std::string&, bool)
 DELEGATE2 (bool, Scene, fromDlyFile, const Config&, const std::string&)
@@ -13,7 +13,9 @@
 class Camera;
 class DynamicMesh;
 class DynamicMeshIntersection;
+enum class DynamicOctreeOverlay;
 class Intersection;
+class MemoryReport;
 class Mesh;
 class PrimRay;
 class RenderMode;
@@ -24,17 +26,24 @@ public:
   DECLARE_BIG3 (Scene, const Config&)
 
   DynamicMesh& newDynamicMesh (const Config&, const DynamicMesh&);
+  DynamicMesh& newDynamicMesh (const Config&, DynamicMesh&&);
   DynamicMesh& newDynamicMesh (const Config&, const Mesh&);
   SketchMesh&  newSketchMesh (const Config&, const SketchMesh&);
   SketchMesh&  newSketchMesh (const Config&, const SketchTree&);
+  // preview meshes are rendered but are neither intersected nor edited, e.g. while loading
+  void         newPreviewMesh (const Config&, const Mesh&);
   void         setupMesh (const Config&, DynamicMesh&);
   void         setupMesh (const Config&, SketchMesh&);
+  // replaces a mesh by a copy at the same position
+  DynamicMesh& replaceMesh (const Config&, DynamicMesh&, const DynamicMesh&);
   void         deleteMesh (DynamicMesh&);
   void         deleteMesh (SketchMesh&);
   void         deleteDynamicMeshes ();
   void         deleteSketchMeshes ();
+  void         deletePreviewMeshes ();
   void         deleteEmptyMeshes ();
-  void         render (Camera&);
+  // the callback is called once the dynamic meshes have been rendered
+  void         render (Camera&, const std::function<void()>&);
   bool         intersects (const PrimRay&, DynamicMeshIntersection&);
   bool         intersects (const PrimRay&, SketchNodeIntersection&, const SketchNode* = nullptr);
   bool         intersects (const PrimRay&, SketchBoneIntersection&);
@@ -43,23 +52,35 @@ public:
   bool         intersects (const PrimRay&, SketchPathIntersection&);
   bool         intersects (const PrimRay&, Intersection&);
   void         printStatistics () const;
+  // reports dynamic meshes and preview meshes, but neither sketches nor proxies
+  void         reportMemory (MemoryReport&) const;
+  // starts building proxies of meshes in the background, cf. `MeshProxies`
+  void         updateProxies ();
   void         forEachMesh (const std::function<void(DynamicMesh&)>&);
   void         forEachMesh (const std::function<void(SketchMesh&)>&);
   void         forEachConstMesh (const std::function<void(const DynamicMesh&)>&) const;
   void         forEachConstMesh (const std::function<void(const SketchMesh&)>&) const;
-  void         sanitizeMeshes ();
   void         reset ();
   const RenderMode&  commonRenderMode () const;
   bool               renderWireframe () const;
   void               renderWireframe (bool);
+  // proxies of meshes are rendered while navigating
+  bool               navigating () const;
+  void               navigating (bool);
   void               toggleWireframe ();
   void               toggleShading ();
+
+  // colors octree nodes of dynamic meshes, cf. `DynamicOctree::render`
+  DynamicOctreeOverlay octreeOverlay () const;
+  void                 octreeOverlay (DynamicOctreeOverlay);
+
   bool               isEmpty () const;
   unsigned int       numDynamicMeshes () const;
   unsigned int       numSketchMeshes () const;
   unsigned int       numFaces () const;
   bool               hasFileName () const;
   const std::string& fileName () const;
+  void               fileName (const std::string&);
   bool               toDlyFile (bool);
   bool               toDlyFile (const std::string&, bool);
   bool               fromDlyFile (const Config&, const std::string&);
@@ -4,33 +4,65 @@
  */
 #include "shader.hpp"
 
-#define SMOOTH_VERTEX_SHADER                                                                   \
+#define LIGHT_VERSION                                                                          \
   "#version 120                                                                            \n" \
+  "#extension GL_ARB_uniform_buffer_object: enable                                         \n"
+
+#define LIGHT_UNIFORMS                                                                         \
+  "#ifdef GL_ARB_uniform_buffer_object                                                     \n" \
+  "layout (std140) uniform LightUniforms {                                                 \n" \
+  "  vec3  light1Direction;                                                                \n" \
+  "  vec3  light1Color;                                                                    \n" \
+  "  float light1Irradiance;                                                               \n" \
+  "  vec3  light2Direction;                                                                \n" \
+  "  vec3  light2Color;                                                                    \n" \
+  "  float light2Irradiance;                                                               \n" \
+  "};                                                                                      \n" \
+  "#else                                                                                   \n" \
+  "uniform vec3  light1Direction;                                                          \n" \
+  "uniform vec3  light1Color;                                                              \n" \
+  "uniform float light1Irradiance;                                                         \n" \
+  "uniform vec3  light2Direction;                                                          \n" \
+  "uniform vec3  light2Color;                                                              \n" \
+  "uniform float light2Irradiance;                                                         \n" \
+  "#endif                                                                                  \n"
+
+// decodes normals in octahedral encoding, cf. `OctahedralFormat` in `mesh.cpp`
+#define DECODE_NORMAL                                                                          \
+  "vec3 decodeNormal (vec2 e) {                                                            \n" \
+  "  vec3 n = vec3 (e, 1.0 - abs (e.x) - abs (e.y));                                       \n" \
+  "  if (n.z < 0.0) {                                                                      \n" \
+  "    n.xy = (1.0 - abs (n.yx)) * vec2 (n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);\n" \
+  "  }                                                                                     \n" \
+  "  return normalize (n);                                                                 \n" \
+  "}                                                                                       \n"
+
+#define SMOOTH_VERTEX_SHADER(DECLARATIONS, FINAL)                                              \
+  LIGHT_VERSION                                                                                \
   "                                                                                        \n" \
   "uniform   mat4  model;                                                                  \n" \
   "uniform   mat3  modelNormal;                                                            \n" \
   "uniform   mat4  view;                                                                   \n" \
   "uniform   mat4  projection;                                                             \n" \
   "attribute vec3  position;                                                               \n" \
-  "attribute vec3  normal;                                                                 \n" \
+  "attribute vec2  normal;                                                                 \n" \
   "uniform   vec3  color;                                                                  \n" \
-  "uniform   vec3  light1Direction;                                                        \n" \
-  "uniform   vec3  light1Color;                                                            \n" \
-  "uniform   float light1Irradiance;                                                       \n" \
-  "uniform   vec3  light2Direction;                                                        \n" \
-  "uniform   vec3  light2Color;                                                            \n" \
-  "uniform   float light2Irradiance;                                                       \n" \
+  LIGHT_UNIFORMS                                                                               \
+  DECODE_NORMAL                                                                                \
   "                                                                                        \n" \
   "varying vec3 vsColor;                                                                   \n" \
+  DECLARATIONS                                                                                 \
   "                                                                                        \n" \
   "void main () {                                                                          \n" \
   "  gl_Position      = (projection * view * model) * vec4 (position, 1.0);                \n" \
-  "  vec3  viewNormal = vec3 (view * vec4 (normalize (modelNormal * normal), 0.0));        \n" \
+  "  vec3  normal3    = normalize (modelNormal * decodeNormal (normal));                   \n" \
+  "  vec3  viewNormal = vec3 (view * vec4 (normal3, 0.0));                                 \n" \
   "  float light1Diff = max (0.0, dot (-light1Direction, viewNormal));                     \n" \
   "  float light2Diff = max (0.0, dot (-light2Direction, viewNormal));                     \n" \
   "  vec3  light1     = light1Irradiance * light1Color * light1Diff;                       \n" \
   "  vec3  light2     = light2Irradiance * light2Color * light2Diff;                       \n" \
   "        vsColor    = color * (light1 + light2);                                         \n" \
+  FINAL                                                                                        \
   "}                                                                                       \n"
 
 #define SMOOTH_FRAGMENT_SHADER(COLOR, FINAL)                                                   \
@@ -46,7 +78,7 @@
   ", 1.0);                                                 \n" FINAL                           \
   "}                                                                                       \n"
 
-#define FLAT_VERTEX_SHADER                                                                     \
+#define FLAT_VERTEX_SHADER(DECLARATIONS, FINAL)                                                \
   "#version 120                                                                            \n" \
   "                                                                                        \n" \
   "uniform   mat4 model;                                                                   \n" \
@@ -55,24 +87,21 @@
   "attribute vec3 position;                                                                \n" \
   "                                                                                        \n" \
   "varying vec3 vsColor;                                                                   \n" \
+  DECLARATIONS                                                                                 \
   "                                                                                        \n" \
   "void main () {                                                                          \n" \
   "  gl_Position = (projection * view * model) * vec4 (position,1.0);                      \n" \
   "  vsColor     = vec3 (model * vec4 (position, 1.0));                                    \n" \
+  FINAL                                                                                        \
   "}                                                                                       \n"
 
 #define FLAT_FRAGMENT_SHADER(COLOR, FINAL)                                                     \
-  "#version 120                                                                            \n" \
+  LIGHT_VERSION                                                                                \
   "                                                                                        \n" \
   "uniform mat4  view;                                                                     \n" \
   "uniform vec3  color;                                                                    \n" \
   "uniform vec3  wireframeColor;                                                           \n" \
-  "uniform vec3  light1Direction;                                                          \n" \
-  "uniform vec3  light1Color;                                                              \n" \
-  "uniform float light1Irradiance;                                                         \n" \
-  "uniform vec3  light2Direction;                                                          \n" \
-  "uniform vec3  light2Color;                                                              \n" \
-  "uniform float light2Irradiance;                                                         \n" \
+  LIGHT_UNIFORMS                                                                               \
   "                                                                                        \n" \
   "varying vec3 " COLOR ";                                                                 \n" \
   "varying vec3 barycentric;                                                               \n" \
@@ -90,16 +119,18 @@
   "\n" FINAL                                                                                   \
   "}                                                                                       \n"
 
-#define CONSTANT_VERTEX_SHADER                                                                 \
+#define CONSTANT_VERTEX_SHADER(DECLARATIONS, FINAL)                                            \
   "#version 120                                                                            \n" \
   "                                                                                        \n" \
   "uniform   mat4 model;                                                                   \n" \
   "uniform   mat4 view;                                                                    \n" \
   "uniform   mat4 projection;                                                              \n" \
   "attribute vec3 position;                                                                \n" \
+  DECLARATIONS                                                                                 \
   "                                                                                        \n" \
   "void main(){                                                                            \n" \
   "  gl_Position = (projection * view * model) * vec4 (position,1.0);                      \n" \
+  FINAL                                                                                        \
   "}                                                                                       \n"
 
 #define CONSTANT_FRAGMENT_SHADER(FINAL)                                                        \
@@ -115,6 +146,96 @@
   "\n" FINAL                                                                                   \
   "}                                                                                       \n"
 
+#define SMOOTH_INSTANCED_VERTEX_SHADER                                                         \
+  LIGHT_VERSION                                                                                \
+  "                                                                                        \n" \
+  "uniform   mat4  view;                                                                   \n" \
+  "uniform   mat4  projection;                                                             \n" \
+  "attribute vec3  position;                                                               \n" \
+  "attribute vec2  normal;                                                                 \n" \
+  "attribute mat4  instanceModel;                                                          \n" \
+  "attribute mat3  instanceModelNormal;                                                    \n" \
+  "attribute vec3  instanceColor;                                                          \n" \
+  LIGHT_UNIFORMS                                                                               \
+  DECODE_NORMAL                                                                                \
+  "                                                                                        \n" \
+  "varying vec3 vsColor;                                                                   \n" \
+  "                                                                                        \n" \
+  "void main () {                                                                          \n" \
+  "  gl_Position      = (projection * view * instanceModel) * vec4 (position, 1.0);        \n" \
+  "  vec3  normal3    = normalize (instanceModelNormal * decodeNormal (normal));           \n" \
+  "  vec3  viewNormal = vec3 (view * vec4 (normal3, 0.0));                                 \n" \
+  "  float light1Diff = max (0.0, dot (-light1Direction, viewNormal));                     \n" \
+  "  float light2Diff = max (0.0, dot (-light2Direction, viewNormal));                     \n" \
+  "  vec3  light1     = light1Irradiance * light1Color * light1Diff;                       \n" \
+  "  vec3  light2     = light2Irradiance * light2Color * light2Diff;                       \n" \
+  "        vsColor    = instanceColor * (light1 + light2);                                 \n" \
+  "}                                                                                       \n"
+
+#define FLAT_INSTANCED_VERTEX_SHADER                                                           \
+  "#version 120                                                                            \n" \
+  "                                                                                        \n" \
+  "uniform   mat4 view;                                                                    \n" \
+  "uniform   mat4 projection;                                                              \n" \
+  "attribute vec3 position;                                                                \n" \
+  "attribute mat4 instanceModel;                                                           \n" \
+  "attribute vec3 instanceColor;                                                           \n" \
+  "                                                                                        \n" \
+  "varying vec3 vsColor;                                                                   \n" \
+  "varying vec3 vsInstanceColor;                                                           \n" \
+  "                                                                                        \n" \
+  "void main () {                                                                          \n" \
+  "  gl_Position     = (projection * view * instanceModel) * vec4 (position,1.0);          \n" \
+  "  vsColor         = vec3 (instanceModel * vec4 (position, 1.0));                        \n" \
+  "  vsInstanceColor = instanceColor;                                                      \n" \
+  "}                                                                                       \n"
+
+#define FLAT_INSTANCED_FRAGMENT_SHADER                                                         \
+  LIGHT_VERSION                                                                                \
+  "                                                                                        \n" \
+  "uniform mat4  view;                                                                     \n" \
+  LIGHT_UNIFORMS                                                                               \
+  "                                                                                        \n" \
+  "varying vec3 vsColor;                                                                   \n" \
+  "varying vec3 vsInstanceColor;                                                           \n" \
+  "                                                                                        \n" \
+  "void main () {                                                                          \n" \
+  "  vec3  normal     = normalize(cross(dFdx(vsColor),dFdy(vsColor)));                     \n" \
+  "  vec3  viewNormal = vec3 (view * vec4 (normal,0.0));                                   \n" \
+  "                                                                                        \n" \
+  "  float light1Diff = max (0.0, dot (-light1Direction, viewNormal));                     \n" \
+  "  float light2Diff = max (0.0, dot (-light2Direction, viewNormal));                     \n" \
+  "  vec3  light1     = light1Irradiance * light1Color * vec3 (light1Diff);                \n" \
+  "  vec3  light2     = light2Irradiance * light2Color * vec3 (light2Diff);                \n" \
+  "                                                                                        \n" \
+  "  gl_FragColor     = vec4 (vsInstanceColor * (light1 + light2), 1.0);                   \n" \
+  "}                                                                                       \n"
+
+#define CONSTANT_INSTANCED_VERTEX_SHADER                                                       \
+  "#version 120                                                                            \n" \
+  "                                                                                        \n" \
+  "uniform   mat4 view;                                                                    \n" \
+  "uniform   mat4 projection;                                                              \n" \
+  "attribute vec3 position;                                                                \n" \
+  "attribute mat4 instanceModel;                                                           \n" \
+  "attribute vec3 instanceColor;                                                           \n" \
+  "                                                                                        \n" \
+  "varying vec3 vsColor;                                                                   \n" \
+  "                                                                                        \n" \
+  "void main(){                                                                            \n" \
+  "  gl_Position = (projection * view * instanceModel) * vec4 (position,1.0);              \n" \
+  "  vsColor     = instanceColor;                                                          \n" \
+  "}                                                                                       \n"
+
+#define CONSTANT_INSTANCED_FRAGMENT_SHADER                                                     \
+  "#version 120                                                                            \n" \
+  "                                                                                        \n" \
+  "varying vec3 vsColor;                                                                   \n" \
+  "                                                                                        \n" \
+  "void main(){                                                                            \n" \
+  "  gl_FragColor = vec4 (vsColor, 1.0);                                                   \n" \
+  "}                                                                                       \n"
+
 #define ADD_WIREFRAME                                                                          \
   "vec3 barycDelta = fwidth (barycentric);                                                 \n" \
   "                                                                                        \n" \
@@ -123,6 +244,14 @@
   "                                                                                        \n" \
   "gl_FragColor.rgb = mix (wireframeColor, gl_FragColor.rgb, minEdgeFactor);               \n"
 
+// computes barycentric coordinates without `GEOMETRY_SHADER`, cf. `Mesh::render`
+#define CORNER_DECLARATIONS                                                                    \
+  "attribute float corner;                                                                 \n" \
+  "varying   vec3  barycentric;                                                            \n"
+
+#define CORNER_TO_BARYCENTRIC                                                                  \
+  "  barycentric = vec3 (equal (vec3 (corner), vec3 (0.0, 1.0, 2.0)));                     \n"
+
 #define GEOMETRY_SHADER                                                                        \
   "#extension GL_EXT_geometry_shader4: require                                             \n" \
   "                                                                                        \n" \
@@ -149,7 +278,7 @@
   "    EndPrimitive();                                                                     \n" \
   "}                                                                                       \n"
 
-const char* Shader::smoothVertexShader () { return SMOOTH_VERTEX_SHADER; }
+const char* Shader::smoothVertexShader () { return SMOOTH_VERTEX_SHADER ("", ""); }
 
 const char* Shader::smoothFragmentShader () { return SMOOTH_FRAGMENT_SHADER ("vsColor", ""); }
 
@@ -158,7 +287,17 @@ const char* Shader::smoothWireframeFragmentShader ()
   return SMOOTH_FRAGMENT_SHADER ("gsColor", ADD_WIREFRAME);
 }
 
-const char* Shader::flatVertexShader () { return FLAT_VERTEX_SHADER; }
+const char* Shader::smoothCornerVertexShader ()
+{
+  return SMOOTH_VERTEX_SHADER (CORNER_DECLARATIONS, CORNER_TO_BARYCENTRIC);
+}
+
+const char* Shader::smoothCornerWireframeFragmentShader ()
+{
+  return SMOOTH_FRAGMENT_SHADER ("vsColor", ADD_WIREFRAME);
+}
+
+const char* Shader::flatVertexShader () { return FLAT_VERTEX_SHADER ("", ""); }
 
 const char* Shader::flatFragmentShader () { return FLAT_FRAGMENT_SHADER ("vsColor", ""); }
 
@@ -167,7 +306,17 @@ const char* Shader::flatWireframeFragmentShader ()
   return FLAT_FRAGMENT_SHADER ("gsColor", ADD_WIREFRAME);
 }
 
-const char* Shader::constantVertexShader () { return CONSTANT_VERTEX_SHADER; }
+const char* Shader::flatCornerVertexShader ()
+{
+  return FLAT_VERTEX_SHADER (CORNER_DECLARATIONS, CORNER_TO_BARYCENTRIC);
+}
+
+const char* Shader::flatCornerWireframeFragmentShader ()
+{
+  return FLAT_FRAGMENT_SHADER ("vsColor", ADD_WIREFRAME);
+}
+
+const char* Shader::constantVertexShader () { return CONSTANT_VERTEX_SHADER ("", ""); }
 
 const char* Shader::constantFragmentShader () { return CONSTANT_FRAGMENT_SHADER (""); }
 
@@ -176,4 +325,22 @@ const char* Shader::constantWireframeFragmentShader ()
   return CONSTANT_FRAGMENT_SHADER (ADD_WIREFRAME);
 }
 
+const char* Shader::constantCornerVertexShader ()
+{
+  return CONSTANT_VERTEX_SHADER (CORNER_DECLARATIONS, CORNER_TO_BARYCENTRIC);
+}
+
+const char* Shader::smoothInstancedVertexShader () { return SMOOTH_INSTANCED_VERTEX_SHADER; }
+
+const char* Shader::flatInstancedVertexShader () { return FLAT_INSTANCED_VERTEX_SHADER; }
+
+const char* Shader::flatInstancedFragmentShader () { return FLAT_INSTANCED_FRAGMENT_SHADER; }
+
+const char* Shader::constantInstancedVertexShader () { return CONSTANT_INSTANCED_VERTEX_SHADER; }
+
+const char* Shader::constantInstancedFragmentShader ()
+{
+  return CONSTANT_INSTANCED_FRAGMENT_SHADER;
+}
+
 const char* Shader::geometryShader () { return GEOMETRY_SHADER; }
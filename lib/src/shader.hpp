@@ -10,14 +10,25 @@ namespace Shader
   const char* smoothVertexShader ();
   const char* smoothFragmentShader ();
   const char* smoothWireframeFragmentShader ();
+  const char* smoothCornerVertexShader ();
+  const char* smoothCornerWireframeFragmentShader ();
 
   const char* flatVertexShader ();
   const char* flatFragmentShader ();
   const char* flatWireframeFragmentShader ();
+  const char* flatCornerVertexShader ();
+  const char* flatCornerWireframeFragmentShader ();
 
   const char* constantVertexShader ();
   const char* constantFragmentShader ();
   const char* constantWireframeFragmentShader ();
+  const char* constantCornerVertexShader ();
+
+  const char* smoothInstancedVertexShader ();
+  const char* flatInstancedVertexShader ();
+  const char* flatInstancedFragmentShader ();
+  const char* constantInstancedVertexShader ();
+  const char* constantInstancedFragmentShader ();
   const char* geometryShader ();
 };
 
@@ -0,0 +1,333 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <utility>
+#include <vector>
+#include "intersection.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/ray.hpp"
+#include "sketch/bvh.hpp"
+#include "util.hpp"
+
+namespace
+{
+  constexpr unsigned int maxLeafItems = 4;
+  constexpr unsigned int minPendingItems = 32;
+
+  // bounds are empty if their minimum exceeds their maximum
+  struct Bounds
+  {
+    glm::vec3 minimum;
+    glm::vec3 maximum;
+
+    Bounds ()
+      : minimum (Util::maxFloat ())
+      , maximum (-Util::maxFloat ())
+    {
+    }
+
+    Bounds (const glm::vec3& min, const glm::vec3& max)
+      : minimum (min)
+      , maximum (max)
+    {
+    }
+
+    bool isEmpty () const { return this->minimum.x > this->maximum.x; }
+
+    glm::vec3 center () const { return 0.5f * (this->minimum + this->maximum); }
+
+    void extend (const Bounds& other)
+    {
+      this->minimum = glm::min (this->minimum, other.minimum);
+      this->maximum = glm::max (this->maximum, other.maximum);
+    }
+
+    bool contains (const glm::vec3& p) const
+    {
+      return glm::all (glm::greaterThanEqual (p, this->minimum)) &&
+             glm::all (glm::lessThanEqual (p, this->maximum));
+    }
+
+    bool intersects (const PrimRay& ray, float& t) const
+    {
+      if (this->isEmpty ())
+      {
+        return false;
+      }
+      else if (IntersectionUtil::intersects (ray, PrimAABox (this->minimum, this->maximum), &t))
+      {
+        t = ray.isLine () ? -Util::maxFloat () : glm::max (0.0f, t);
+        return true;
+      }
+      else
+      {
+        return false;
+      }
+    }
+  };
+
+  // children of a node have larger indices than their parent
+  struct Node
+  {
+    Bounds       bounds;
+    unsigned int begin;
+    unsigned int end;
+    unsigned int left;
+    unsigned int right;
+
+    Node (unsigned int b, unsigned int e)
+      : begin (b)
+      , end (e)
+      , left (Util::invalidIndex ())
+      , right (Util::invalidIndex ())
+    {
+    }
+
+    bool isLeaf () const { return this->left == Util::invalidIndex (); }
+  };
+}
+
+struct SketchBvh::Impl
+{
+  std::vector<Bounds>                                 items;
+  std::vector<Node>                                   nodes;
+  std::vector<unsigned int>                           order;
+  bool                                                isRefitRequired;
+  mutable std::vector<std::pair<float, unsigned int>> stack;
+
+  Impl ()
+    : isRefitRequired (false)
+  {
+  }
+
+  unsigned int numItems () const { return this->items.size (); }
+
+  unsigned int numPendingItems () const { return this->items.size () - this->order.size (); }
+
+  void reset ()
+  {
+    this->items.clear ();
+    this->nodes.clear ();
+    this->order.clear ();
+    this->isRefitRequired = false;
+  }
+
+  void add (const glm::vec3& min, const glm::vec3& max) { this->items.emplace_back (min, max); }
+
+  void bounds (unsigned int i, const glm::vec3& min, const glm::vec3& max)
+  {
+    this->items[i] = Bounds (min, max);
+    this->isRefitRequired = true;
+  }
+
+  void update ()
+  {
+    const unsigned int numPending = this->numPendingItems ();
+    const unsigned int maxPending = (unsigned int) (this->order.size () / 8);
+
+    if (numPending > 0 && numPending >= glm::max (minPendingItems, maxPending))
+    {
+      this->nodes.clear ();
+      this->order.clear ();
+
+      for (unsigned int i = 0; i < this->items.size (); i++)
+      {
+        this->order.push_back (i);
+      }
+      this->build (0, this->order.size ());
+      this->refit ();
+    }
+    else if (this->isRefitRequired)
+    {
+      this->refit ();
+    }
+  }
+
+  // splits at the median of the items' centers along the dimension of their largest extent
+  unsigned int build (unsigned int begin, unsigned int end)
+  {
+    assert (begin < end);
+
+    const unsigned int n = this->nodes.size ();
+    this->nodes.emplace_back (begin, end);
+
+    if (end - begin > maxLeafItems)
+    {
+      Bounds centers;
+      for (unsigned int i = begin; i < end; i++)
+      {
+        const glm::vec3 c = this->items[this->order[i]].center ();
+        centers.extend (Bounds (c, c));
+      }
+
+      const glm::vec3    extent = centers.maximum - centers.minimum;
+      const unsigned int dim =
+        extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+      const unsigned int mid = begin + ((end - begin) / 2);
+
+      std::nth_element (this->order.begin () + begin, this->order.begin () + mid,
+                        this->order.begin () + end, [this, dim](unsigned int a, unsigned int b) {
+                          return this->items[a].center ()[dim] < this->items[b].center ()[dim];
+                        });
+
+      const unsigned int left = this->build (begin, mid);
+      const unsigned int right = this->build (mid, end);
+
+      this->nodes[n].left = left;
+      this->nodes[n].right = right;
+    }
+    return n;
+  }
+
+  void refit ()
+  {
+    for (unsigned int i = this->nodes.size (); i > 0; i--)
+    {
+      Node& node = this->nodes[i - 1];
+
+      if (node.isLeaf ())
+      {
+        node.bounds = Bounds ();
+        for (unsigned int j = node.begin; j < node.end; j++)
+        {
+          node.bounds.extend (this->items[this->order[j]]);
+        }
+      }
+      else
+      {
+        node.bounds = this->nodes[node.left].bounds;
+        node.bounds.extend (this->nodes[node.right].bounds);
+      }
+    }
+    this->isRefitRequired = false;
+  }
+
+  void intersects (const PrimRay& ray, float upperBound, const RayCallback& f) const
+  {
+    assert (this->isRefitRequired == false);
+
+    float distance = upperBound;
+    float t;
+
+    this->stack.clear ();
+    if (this->nodes.empty () == false && this->nodes[0].bounds.intersects (ray, t))
+    {
+      this->stack.emplace_back (t, 0);
+    }
+
+    while (this->stack.empty () == false)
+    {
+      const std::pair<float, unsigned int> entry = this->stack.back ();
+      this->stack.pop_back ();
+
+      if (entry.first >= distance)
+      {
+        continue;
+      }
+
+      const Node& node = this->nodes[entry.second];
+      if (node.isLeaf ())
+      {
+        for (unsigned int i = node.begin; i < node.end; i++)
+        {
+          if (this->items[this->order[i]].intersects (ray, t) && t < distance)
+          {
+            distance = glm::min (distance, f (this->order[i]));
+          }
+        }
+      }
+      else
+      {
+        float      tLeft;
+        float      tRight;
+        const bool hitsLeft = this->nodes[node.left].bounds.intersects (ray, tLeft);
+        const bool hitsRight = this->nodes[node.right].bounds.intersects (ray, tRight);
+
+        // the nearer child is pushed last, such that it is visited first
+        if (hitsLeft && hitsRight && tLeft < tRight)
+        {
+          this->stack.emplace_back (tRight, node.right);
+          this->stack.emplace_back (tLeft, node.left);
+        }
+        else
+        {
+          if (hitsLeft)
+          {
+            this->stack.emplace_back (tLeft, node.left);
+          }
+          if (hitsRight)
+          {
+            this->stack.emplace_back (tRight, node.right);
+          }
+        }
+      }
+    }
+
+    for (unsigned int i = this->order.size (); i < this->items.size (); i++)
+    {
+      if (this->items[i].intersects (ray, t) && t < distance)
+      {
+        distance = glm::min (distance, f (i));
+      }
+    }
+  }
+
+  void contains (const glm::vec3& p, const PointCallback& f) const
+  {
+    assert (this->isRefitRequired == false);
+
+    this->stack.clear ();
+    if (this->nodes.empty () == false && this->nodes[0].bounds.contains (p))
+    {
+      this->stack.emplace_back (0.0f, 0);
+    }
+
+    while (this->stack.empty () == false)
+    {
+      const Node& node = this->nodes[this->stack.back ().second];
+      this->stack.pop_back ();
+
+      if (node.isLeaf ())
+      {
+        for (unsigned int i = node.begin; i < node.end; i++)
+        {
+          if (this->items[this->order[i]].contains (p))
+          {
+            f (this->order[i]);
+          }
+        }
+      }
+      else
+      {
+        if (this->nodes[node.left].bounds.contains (p))
+        {
+          this->stack.emplace_back (0.0f, node.left);
+        }
+        if (this->nodes[node.right].bounds.contains (p))
+        {
+          this->stack.emplace_back (0.0f, node.right);
+        }
+      }
+    }
+
+    for (unsigned int i = this->order.size (); i < this->items.size (); i++)
+    {
+      if (this->items[i].contains (p))
+      {
+        f (i);
+      }
+    }
+  }
+};
+
+DELEGATE_BIG2 (SketchBvh)
+DELEGATE_CONST (unsigned int, SketchBvh, numItems)
+DELEGATE (void, SketchBvh, reset)
+DELEGATE2 (void, SketchBvh, add, const glm::vec3&, const glm::vec3&)
+DELEGATE3 (void, SketchBvh, bounds, unsigned int, const glm::vec3&, const glm::vec3&)
+DELEGATE (void, SketchBvh, update)
+DELEGATE3_CONST (void, SketchBvh, intersects, const PrimRay&, float, const SketchBvh::RayCallback&)
+DELEGATE2_CONST (void, SketchBvh, contains, const glm::vec3&, const SketchBvh::PointCallback&)
@@ -0,0 +1,45 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_SKETCH_BVH
+#define DILAY_SKETCH_BVH
+
+#include <functional>
+#include <glm/fwd.hpp>
+#include "macro.hpp"
+
+class PrimRay;
+
+/* Bounding volume hierarchy over the axis-aligned bounds of sketch primitives, which are identified
+ * by the order in which they have been added.  Items that are added to a built hierarchy are tested
+ * linearly until there are enough of them to rebuild it.
+ */
+class SketchBvh
+{
+public:
+  // returns the distance of the nearest intersection so far, which bounds the remaining traversal
+  using RayCallback = std::function<float(unsigned int)>;
+  using PointCallback = std::function<void(unsigned int)>;
+
+  DECLARE_BIG2 (SketchBvh)
+
+  unsigned int numItems () const;
+  void         reset ();
+  void         add (const glm::vec3&, const glm::vec3&);
+  void         bounds (unsigned int, const glm::vec3&, const glm::vec3&);
+
+  // rebuilds the hierarchy if too many items are pending, and refits it if bounds have changed
+  void update ();
+
+  // calls back items whose bounds are intersected at a distance less than the given upper bound
+  void intersects (const PrimRay&, float, const RayCallback&) const;
+
+  // calls back items whose bounds contain a point
+  void contains (const glm::vec3&, const PointCallback&) const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
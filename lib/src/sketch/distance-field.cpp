@@ -0,0 +1,360 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include <vector>
+#include "distance.hpp"
+#include "primitive/cone-sphere.hpp"
+#include "sketch/distance-field.hpp"
+#include "sketch/mesh.hpp"
+#include "sketch/path.hpp"
+#include "util.hpp"
+
+namespace
+{
+  constexpr unsigned int maxCellsPerDimension = 16;
+
+  // spheres of a cell as structure of arrays
+  struct Spheres
+  {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> radius;
+
+    void add (const PrimSphere& sphere)
+    {
+      this->x.push_back (sphere.center ().x);
+      this->y.push_back (sphere.center ().y);
+      this->z.push_back (sphere.center ().z);
+      this->radius.push_back (sphere.radius ());
+    }
+  };
+
+  struct Cell
+  {
+    float        lowerBound; // of the distances of all points in the cell
+    unsigned int spheresBegin;
+    unsigned int spheresEnd;
+    unsigned int coneSpheresBegin;
+    unsigned int coneSpheresEnd;
+  };
+
+  PrimSphere boundingSphere (const PrimConeSphere& coneSphere)
+  {
+    const glm::vec3& c1 = coneSphere.sphere1 ().center ();
+    const glm::vec3& c2 = coneSphere.sphere2 ().center ();
+    const float      r1 = coneSphere.sphere1 ().radius ();
+    const float      r2 = coneSphere.sphere2 ().radius ();
+
+    return PrimSphere ((c1 + c2) * 0.5f,
+                       (0.5f * glm::distance (c1, c2)) + glm::max (r1, r2) + Util::epsilon ());
+  }
+
+  /* Cone sphere whose constants of `Distance::distance` are computed once instead of at each
+   * sample.  Cone spheres with the same radii are treated as cones with an angle of zero, and
+   * cone spheres without a cone as their first sphere.
+   */
+  struct PreparedConeSphere
+  {
+    glm::vec3 center1;
+    glm::vec3 direction;
+    float     radius1;
+    float     radius2;
+    float     length;
+    float     sideLength;
+    float     h1;
+    float     h2;
+    float     r1c;
+    float     r2c;
+    float     cosAlpha;
+    float     sinAlpha;
+    bool      hasCone;
+
+    PreparedConeSphere (const PrimConeSphere& c)
+      : center1 (c.sphere1 ().center ())
+      , direction (c.direction ())
+      , radius1 (c.sphere1 ().radius ())
+      , radius2 (c.sphere2 ().radius ())
+      , length (c.length ())
+      , sideLength (c.length ())
+      , h1 (0.0f)
+      , h2 (0.0f)
+      , r1c (c.sphere1 ().radius ())
+      , r2c (c.sphere1 ().radius ())
+      , cosAlpha (1.0f)
+      , sinAlpha (0.0f)
+      , hasCone (c.sameRadii () || c.hasCone ())
+    {
+      if (c.sameRadii ())
+      {
+        this->radius2 = this->radius1;
+      }
+      else if (c.hasCone ())
+      {
+        this->sideLength = c.coneSideLength ();
+        this->h1 = this->radius1 * c.delta () / this->length;
+        this->h2 = this->radius2 * c.delta () / this->length;
+        this->r1c = this->radius1 * this->sideLength / this->length;
+        this->r2c = this->radius2 * this->sideLength / this->length;
+        this->cosAlpha = c.cosAlpha ();
+        this->sinAlpha = c.sinAlpha ();
+      }
+    }
+
+    float distance (const glm::vec3& point) const
+    {
+      const glm::vec3 toP = point - this->center1;
+      const float     x = glm::dot (toP, this->direction);
+      const float     ySqr = glm::dot (toP, toP) - (x * x);
+      const float     y = Util::almostEqual (0.0f, ySqr) ? 0.0f : glm::sqrt (ySqr);
+      const float     l = this->length;
+
+      if (this->hasCone == false || x <= 0.0f)
+      {
+        return glm::sqrt ((x * x) + (y * y)) - this->radius1;
+      }
+      else if (x >= l + this->h2 && y <= this->r2c)
+      {
+        return glm::sqrt (((x - l) * (x - l)) + (y * y)) - this->radius2;
+      }
+      else
+      {
+        const float xn = ((x - this->h1) * this->cosAlpha) - ((y - this->r1c) * this->sinAlpha);
+        const float yn = ((x - this->h1) * this->sinAlpha) + ((y - this->r1c) * this->cosAlpha);
+
+        if (xn <= 0.0f)
+        {
+          return glm::sqrt ((x * x) + (y * y)) - this->radius1;
+        }
+        else if (xn >= this->sideLength)
+        {
+          return glm::sqrt (((x - l) * (x - l)) + (y * y)) - this->radius2;
+        }
+        else
+        {
+          return yn;
+        }
+      }
+    }
+  };
+}
+
+struct SketchDistanceField::Impl
+{
+  std::vector<PrimSphere>         spheres;
+  std::vector<PreparedConeSphere> coneSpheres;
+  std::vector<PrimSphere>         coneSphereBounds;
+  glm::vec3                       gridMin;
+  glm::vec3                       gridMax;
+  float                           cellSize;
+  glm::uvec3                      numCells;
+  std::vector<Cell>               cells; // the last cell holds all primitives for points outside
+  Spheres                         cellSpheres;
+  std::vector<unsigned int>       cellConeSpheres;
+
+  Impl (const SketchMesh& mesh)
+  {
+    const SketchFlatTree tree (mesh.tree ());
+
+    for (unsigned int i = 0; i < tree.numNodes (); i++)
+    {
+      if (tree.parent (i) == Util::invalidIndex ())
+      {
+        this->spheres.push_back (tree.data (i));
+      }
+      else
+      {
+        const PrimConeSphere coneSphere (tree.data (i), tree.data (tree.parent (i)));
+
+        this->coneSpheres.emplace_back (coneSphere);
+        this->coneSphereBounds.push_back (boundingSphere (coneSphere));
+      }
+    }
+    for (const SketchPath& p : mesh.paths ())
+    {
+      for (const PrimSphere& s : p.spheres ())
+      {
+        this->spheres.push_back (s);
+      }
+    }
+    this->setupCells (mesh);
+  }
+
+  /* A primitive is added to a cell if it may be the closest primitive of any point in the cell.
+   * Distances change at most by the distance between two points, so the distances at the center
+   * of the cell bound the distances of all points in the cell.  Samples whose upper bound does not
+   * exceed the lower bound of their cell are not evaluated.
+   */
+  void addCell (const glm::vec3& center, float halfDiagonal, std::vector<float>& sphereDistances,
+                std::vector<float>& coneSphereDistances)
+  {
+    float upperBound = Util::maxFloat ();
+
+    for (unsigned int i = 0; i < this->spheres.size (); i++)
+    {
+      sphereDistances[i] = Distance::distance (this->spheres[i], center);
+      upperBound = glm::min (upperBound, sphereDistances[i] + halfDiagonal);
+    }
+    for (unsigned int i = 0; i < this->coneSpheres.size (); i++)
+    {
+      coneSphereDistances[i] = this->coneSpheres[i].distance (center);
+      upperBound = glm::min (upperBound, coneSphereDistances[i] + halfDiagonal);
+    }
+
+    Cell cell;
+    cell.lowerBound = Util::maxFloat ();
+    for (float d : sphereDistances)
+    {
+      cell.lowerBound = glm::min (cell.lowerBound, d - halfDiagonal);
+    }
+    for (float d : coneSphereDistances)
+    {
+      cell.lowerBound = glm::min (cell.lowerBound, d - halfDiagonal);
+    }
+
+    cell.spheresBegin = this->cellSpheres.x.size ();
+    for (unsigned int i = 0; i < this->spheres.size (); i++)
+    {
+      if (sphereDistances[i] - halfDiagonal <= upperBound + Util::epsilon ())
+      {
+        this->cellSpheres.add (this->spheres[i]);
+      }
+    }
+    cell.spheresEnd = this->cellSpheres.x.size ();
+
+    cell.coneSpheresBegin = this->cellConeSpheres.size ();
+    for (unsigned int i = 0; i < this->coneSpheres.size (); i++)
+    {
+      if (coneSphereDistances[i] - halfDiagonal <= upperBound + Util::epsilon ())
+      {
+        this->cellConeSpheres.push_back (i);
+      }
+    }
+    cell.coneSpheresEnd = this->cellConeSpheres.size ();
+
+    this->cells.push_back (cell);
+  }
+
+  // the lower bound of points outside the grid is computed by `farFieldBound`
+  void addCellOfAllPrimitives ()
+  {
+    Cell cell;
+    cell.lowerBound = Util::minFloat ();
+    cell.spheresBegin = this->cellSpheres.x.size ();
+    for (const PrimSphere& sphere : this->spheres)
+    {
+      this->cellSpheres.add (sphere);
+    }
+    cell.spheresEnd = this->cellSpheres.x.size ();
+
+    cell.coneSpheresBegin = this->cellConeSpheres.size ();
+    for (unsigned int i = 0; i < this->coneSpheres.size (); i++)
+    {
+      this->cellConeSpheres.push_back (i);
+    }
+    cell.coneSpheresEnd = this->cellConeSpheres.size ();
+
+    this->cells.push_back (cell);
+  }
+
+  void setupCells (const SketchMesh& mesh)
+  {
+    glm::vec3 min, max;
+    mesh.minMax (min, max);
+
+    const glm::vec3 extent = glm::max (max - min, glm::vec3 (Util::epsilon ()));
+
+    this->gridMin = min;
+    this->gridMax = max;
+    this->cellSize =
+      glm::max (glm::max (extent.x, extent.y), extent.z) / float(maxCellsPerDimension);
+    this->numCells = glm::clamp (glm::uvec3 (glm::ceil (extent / this->cellSize)), glm::uvec3 (1),
+                                 glm::uvec3 (maxCellsPerDimension));
+
+    const float        halfDiagonal = 0.5f * glm::sqrt (3.0f) * this->cellSize;
+    std::vector<float> sphereDistances (this->spheres.size ());
+    std::vector<float> coneSphereDistances (this->coneSpheres.size ());
+
+    for (unsigned int z = 0; z < this->numCells.z; z++)
+    {
+      for (unsigned int y = 0; y < this->numCells.y; y++)
+      {
+        for (unsigned int x = 0; x < this->numCells.x; x++)
+        {
+          const glm::vec3 center =
+            this->gridMin + (glm::vec3 (float(x), float(y), float(z)) + glm::vec3 (0.5f)) *
+                              this->cellSize;
+
+          this->addCell (center, halfDiagonal, sphereDistances, coneSphereDistances);
+        }
+      }
+    }
+    this->addCellOfAllPrimitives ();
+  }
+
+  const Cell& cell (const glm::vec3& pos) const
+  {
+    const glm::vec3 p = glm::floor ((pos - this->gridMin) / this->cellSize);
+
+    if (glm::any (glm::lessThan (p, glm::vec3 (0.0f))) ||
+        glm::any (glm::greaterThanEqual (p, glm::vec3 (this->numCells))))
+    {
+      return this->cells.back ();
+    }
+    else
+    {
+      const glm::uvec3 c (p);
+      return this->cells[(c.z * this->numCells.x * this->numCells.y) + (c.y * this->numCells.x) +
+                         c.x];
+    }
+  }
+
+  // all primitives lie within the bounds of the grid, so its distance bounds their distances
+  float farFieldBound (const glm::vec3& pos) const
+  {
+    return glm::length (glm::max (glm::max (this->gridMin - pos, pos - this->gridMax),
+                                  glm::vec3 (0.0f)));
+  }
+
+  float distance (const glm::vec3& pos, float upperBound) const
+  {
+    const Cell& cell = this->cell (pos);
+    const float lowerBound = &cell == &this->cells.back () ? this->farFieldBound (pos)
+                                                           : cell.lowerBound;
+    if (lowerBound >= upperBound)
+    {
+      return upperBound;
+    }
+
+    const float* x = this->cellSpheres.x.data ();
+    const float* y = this->cellSpheres.y.data ();
+    const float* z = this->cellSpheres.z.data ();
+    const float* r = this->cellSpheres.radius.data ();
+
+    float distance = upperBound;
+    for (unsigned int i = cell.spheresBegin; i < cell.spheresEnd; i++)
+    {
+      const float dx = x[i] - pos.x;
+      const float dy = y[i] - pos.y;
+      const float dz = z[i] - pos.z;
+
+      distance = glm::min (distance, glm::sqrt ((dx * dx) + (dy * dy) + (dz * dz)) - r[i]);
+    }
+
+    for (unsigned int j = cell.coneSpheresBegin; j < cell.coneSpheresEnd; j++)
+    {
+      const unsigned int i = this->cellConeSpheres[j];
+
+      if (Distance::distance (this->coneSphereBounds[i], pos) < distance)
+      {
+        distance = glm::min (distance, this->coneSpheres[i].distance (pos));
+      }
+    }
+    return distance;
+  }
+};
+
+DELEGATE1_BIG2 (SketchDistanceField, const SketchMesh&)
+DELEGATE2_CONST (float, SketchDistanceField, distance, const glm::vec3&, float)
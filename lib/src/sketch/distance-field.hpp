@@ -0,0 +1,28 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_SKETCH_DISTANCE_FIELD
+#define DILAY_SKETCH_DISTANCE_FIELD
+
+#include <glm/fwd.hpp>
+#include "macro.hpp"
+#include "sketch/fwd.hpp"
+
+/* Signed distance to the spheres and bones of a sketch mesh.  The primitives are partitioned
+ * into the cells of a coarse grid, such that only primitives that may be closest to a point of a
+ * cell are considered when computing a distance.
+ */
+class SketchDistanceField
+{
+public:
+  DECLARE_BIG2 (SketchDistanceField, const SketchMesh&)
+
+  // returns the given upper bound if the actual distance is larger
+  float distance (const glm::vec3&, float) const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
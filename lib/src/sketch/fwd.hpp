@@ -16,6 +16,7 @@ class SketchMeshIntersection;
 class SketchPathIntersection;
 using SketchNode = TreeNode<PrimSphere>;
 using SketchTree = Tree<PrimSphere>;
+using SketchFlatTree = FlatTree<PrimSphere>;
 class SketchMesh;
 
 #endif
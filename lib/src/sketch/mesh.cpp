@@ -2,22 +2,25 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/norm.hpp>
 #include <glm/gtx/rotate_vector.hpp>
 #include "../mesh.hpp"
+#include "camera.hpp"
 #include "color.hpp"
 #include "config.hpp"
 #include "dimension.hpp"
 #include "distance.hpp"
-#include "mesh-util.hpp"
+#include "mesh-instances.hpp"
+#include "mesh-primitives.hpp"
 #include "primitive/aabox.hpp"
 #include "primitive/cone-sphere.hpp"
 #include "primitive/cone.hpp"
 #include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
 #include "primitive/sphere.hpp"
-#include "render-mode.hpp"
 #include "sketch/bone-intersection.hpp"
+#include "sketch/bvh.hpp"
 #include "sketch/mesh.hpp"
 #include "sketch/node-intersection.hpp"
 #include "sketch/path-intersection.hpp"
@@ -26,24 +29,65 @@
 
 namespace
 {
+  const Config::Key<Color> nodeColorKey ("editor/sketch/node/color");
+  const Config::Key<Color> bubbleColorKey ("editor/sketch/bubble/color");
+  const Config::Key<Color> sphereColorKey ("editor/sketch/sphere/color");
+  const Config::Key<float> bubbleMinSpacingKey ("editor/sketch/bubble/min-spacing");
+
   struct RenderConfig
   {
     bool  renderWireframe;
     Color nodeColor;
     Color bubbleColor;
     Color sphereColor;
+    // minimum distance between bubbles on the screen (in pixels)
+    float bubbleMinSpacing;
 
     RenderConfig ()
       : renderWireframe (false)
+      , bubbleMinSpacing (0.0f)
     {
     }
   };
 
+  bool isVisible (const Camera& camera, const glm::vec3& center, float radius)
+  {
+    return camera.isVisible (PrimAABox (center - glm::vec3 (radius), center + glm::vec3 (radius)),
+                             glm::mat4x4 (1.0f));
+  }
+
   bool almostEqual (const glm::vec3& a, const glm::vec3& b)
   {
     return glm::distance2 (a, b) <= Util::epsilon () * Util::epsilon ();
   }
 
+  float upperBound (const Intersection& intersection)
+  {
+    return intersection.isIntersection () ? intersection.distance () : Util::maxFloat ();
+  }
+
+  // the bounds of a node include its bone, i.e. the sphere of its parent
+  void nodeBounds (const SketchNode& node, glm::vec3& min, glm::vec3& max)
+  {
+    min = node.data ().center () - glm::vec3 (node.data ().radius ());
+    max = node.data ().center () + glm::vec3 (node.data ().radius ());
+
+    if (node.parent ())
+    {
+      const PrimSphere& parent = node.parent ()->data ();
+
+      min = glm::min (min, parent.center () - glm::vec3 (parent.radius ()));
+      max = glm::max (max, parent.center () + glm::vec3 (parent.radius ()));
+    }
+  }
+
+  // a sphere of a path is identified by the index of its path and its index within that path
+  struct PathSphere
+  {
+    unsigned int path;
+    unsigned int sphere;
+  };
+
   class PrimSphereIntersection : public Intersection
   {
   public:
@@ -78,24 +122,32 @@ namespace
 
 struct SketchMesh::Impl
 {
-  SketchMesh*  self;
-  SketchTree   tree;
-  SketchPaths  paths;
-  Mesh         sphereMesh;
-  Mesh         boneMesh;
-  RenderConfig renderConfig;
+  SketchMesh*   self;
+  SketchTree    tree;
+  SketchPaths   paths;
+  std::shared_ptr<Mesh> sphereMesh;
+  std::shared_ptr<Mesh> boneMesh;
+  MeshInstances         sphereInstances;
+  MeshInstances         boneInstances;
+  RenderConfig          renderConfig;
+
+  // hierarchies are rebuilt lazily once their nodes or paths have been changed
+  SketchBvh                treeBvh;
+  std::vector<SketchNode*> treeNodes;
+  bool                     isTreeBvhValid;
+  bool                     isTreeBvhFitted;
+  SketchBvh                pathBvh;
+  std::vector<PathSphere>  pathSpheres;
+  bool                     isPathBvhValid;
 
   Impl (SketchMesh* s)
     : self (s)
+    , sphereMesh (MeshPrimitives::get (MeshPrimitive::SketchSphere))
+    , boneMesh (MeshPrimitives::get (MeshPrimitive::SketchBone))
+    , isTreeBvhValid (false)
+    , isTreeBvhFitted (false)
+    , isPathBvhValid (false)
   {
-    this->sphereMesh = MeshUtil::icosphere (3);
-    this->sphereMesh.bufferData ();
-
-    this->boneMesh = MeshUtil::cone (16);
-    this->boneMesh.renderMode ().flatShading (true);
-    this->boneMesh.position (glm::vec3 (0.0f, 0.5f, 0.0f));
-    this->boneMesh.normalize ();
-    this->boneMesh.bufferData ();
   }
 
   Impl (const Impl& other)
@@ -105,40 +157,118 @@ struct SketchMesh::Impl
     , sphereMesh (other.sphereMesh)
     , boneMesh (other.boneMesh)
     , renderConfig (other.renderConfig)
+    , isTreeBvhValid (false)
+    , isTreeBvhFitted (false)
+    , isPathBvhValid (false)
   {
-    this->sphereMesh.bufferData ();
-    this->boneMesh.bufferData ();
   }
 
   bool isEmpty () const { return this->tree.hasRoot () == false && this->paths.empty (); }
 
-  void fromTree (const SketchTree& newTree) { this->tree = newTree; }
+  SketchTree& mutableTree ()
+  {
+    this->isTreeBvhValid = false;
+    return this->tree;
+  }
+
+  void fromTree (const SketchTree& newTree)
+  {
+    this->tree = newTree;
+    this->isTreeBvhValid = false;
+  }
+
+  void reset ()
+  {
+    this->tree.reset ();
+    this->isTreeBvhValid = false;
+  }
+
+  void updateTreeBvh ()
+  {
+    glm::vec3 min, max;
+
+    if (this->isTreeBvhValid == false)
+    {
+      this->treeBvh.reset ();
+      this->treeNodes.clear ();
+
+      if (this->tree.hasRoot ())
+      {
+        this->tree.root ().forEachNode ([this, &min, &max](SketchNode& node) {
+          nodeBounds (node, min, max);
+          this->treeBvh.add (min, max);
+          this->treeNodes.push_back (&node);
+        });
+      }
+      this->isTreeBvhValid = true;
+      this->isTreeBvhFitted = true;
+    }
+    else if (this->isTreeBvhFitted == false)
+    {
+      for (unsigned int i = 0; i < this->treeNodes.size (); i++)
+      {
+        nodeBounds (*this->treeNodes[i], min, max);
+        this->treeBvh.bounds (i, min, max);
+      }
+      this->isTreeBvhFitted = true;
+    }
+    this->treeBvh.update ();
+  }
+
+  void updatePathBvh ()
+  {
+    if (this->isPathBvhValid == false)
+    {
+      this->pathBvh.reset ();
+      this->pathSpheres.clear ();
+
+      for (unsigned int i = 0; i < this->paths.size (); i++)
+      {
+        for (unsigned int j = 0; j < this->paths[i].spheres ().size (); j++)
+        {
+          this->addPathSphereToBvh (i, j);
+        }
+      }
+      this->isPathBvhValid = true;
+    }
+    this->pathBvh.update ();
+  }
+
+  void addPathSphereToBvh (unsigned int path, unsigned int sphere)
+  {
+    const PrimSphere& s = this->paths[path].spheres ()[sphere];
+
+    const glm::vec3   r (s.radius ());
 
-  void reset () { this->tree.reset (); }
+    this->pathBvh.add (s.center () - r, s.center () + r);
+    this->pathSpheres.push_back (PathSphere{path, sphere});
+  }
 
   bool intersects (const PrimRay& ray, SketchNodeIntersection& intersection,
                    const SketchNode* exclude = nullptr)
   {
-    if (this->tree.hasRoot ())
-    {
-      this->tree.root ().forEachNode ([this, &ray, &intersection, exclude](SketchNode& node) {
-        float t;
+    this->updateTreeBvh ();
+    this->treeBvh.intersects (
+      ray, upperBound (intersection), [this, &ray, &intersection, exclude](unsigned int i) {
+        SketchNode& node = *this->treeNodes[i];
+        float       t;
         if (&node != exclude && IntersectionUtil::intersects (ray, node.data (), &t))
         {
           const glm::vec3 p = ray.pointAt (t);
           intersection.update (t, p, glm::normalize (p - node.data ().center ()), *this->self,
                                node);
         }
+        return upperBound (intersection);
       });
-    }
     return intersection.isIntersection ();
   }
 
   bool intersects (const PrimRay& ray, SketchBoneIntersection& intersection)
   {
-    if (this->tree.hasRoot ())
-    {
-      this->tree.root ().forEachNode ([this, &ray, &intersection](SketchNode& node) {
+    this->updateTreeBvh ();
+    this->treeBvh.intersects (
+      ray, upperBound (intersection), [this, &ray, &intersection](unsigned int i) {
+        SketchNode& node = *this->treeNodes[i];
         if (node.parent ())
         {
           const PrimConeSphere coneSphere (node.data (), node.parent ()->data ());
@@ -157,8 +287,33 @@ struct SketchMesh::Impl
             }
           }
         }
+        return upperBound (intersection);
+      });
+    return intersection.isIntersection ();
+  }
+
+  // only the first `numPaths` paths are intersected
+  bool intersects (const PrimRay& ray, SketchPathIntersection& intersection, unsigned int numPaths)
+  {
+    this->updatePathBvh ();
+    this->pathBvh.intersects (
+      ray, upperBound (intersection), [this, &ray, &intersection, numPaths](unsigned int i) {
+        const PathSphere& pathSphere = this->pathSpheres[i];
+
+        if (pathSphere.path < numPaths)
+        {
+          SketchPath&       path = this->paths[pathSphere.path];
+          const PrimSphere& s = path.spheres ()[pathSphere.sphere];
+          float             t;
+
+          if (IntersectionUtil::intersects (ray, s, &t))
+          {
+            intersection.update (t, ray.pointAt (t), glm::normalize (ray.pointAt (t) - s.center ()),
+                                 *this->self, path);
+          }
+        }
+        return upperBound (intersection);
       });
-    }
     return intersection.isIntersection ();
   }
 
@@ -179,37 +334,28 @@ struct SketchMesh::Impl
       intersection.update (sbIntersection.distance (), sbIntersection.position (),
                            sbIntersection.normal (), sbIntersection.mesh ());
     }
-    if (numExcludedLastPaths < this->paths.size ())
+    if (numExcludedLastPaths < this->paths.size () &&
+        this->intersects (ray, spIntersection, this->paths.size () - numExcludedLastPaths))
     {
-      for (unsigned int i = 0; i < this->paths.size () - numExcludedLastPaths; i++)
-      {
-        if (this->paths.at (i).intersects (ray, *this->self, spIntersection))
-        {
-          intersection.update (spIntersection.distance (), spIntersection.position (),
-                               spIntersection.normal (), spIntersection.mesh ());
-        }
-      }
+      intersection.update (spIntersection.distance (), spIntersection.position (),
+                           spIntersection.normal (), spIntersection.mesh ());
     }
     return intersection.isIntersection ();
   }
 
   bool intersects (const PrimRay& ray, SketchPathIntersection& intersection)
   {
-    for (unsigned int i = 0; i < this->paths.size (); i++)
-    {
-      this->paths.at (i).intersects (ray, *this->self, intersection);
-    }
-    return intersection.isIntersection ();
+    return this->intersects (ray, intersection, this->paths.size ());
   }
 
   bool intersects (const glm::vec3& point, PrimSphereIntersection& intersection,
                    const SketchPath& excluded)
   {
-    auto checkSphere = [&point, &intersection](const SketchNode& node) {
-      const float d2 = glm::distance2 (point, node.data ().center ());
-      if (d2 <= node.data ().radius () * node.data ().radius ())
+    auto checkSphere = [&point, &intersection](const PrimSphere& sphere) {
+      const float d2 = glm::distance2 (point, sphere.center ());
+      if (d2 <= sphere.radius () * sphere.radius ())
       {
-        intersection.update (glm::sqrt (d2), node.data ());
+        intersection.update (glm::sqrt (d2), sphere);
       }
     };
 
@@ -267,42 +413,51 @@ struct SketchMesh::Impl
       }
       else
       {
-        checkSphere (node);
+        checkSphere (node.data ());
       }
     };
 
-    if (this->tree.hasRoot ())
-    {
-      this->tree.root ().forEachNode ([&checkBone](SketchNode& node) { checkBone (node); });
-    }
+    this->updateTreeBvh ();
+    this->treeBvh.contains (point, [this, &checkBone](unsigned int i) {
+      checkBone (*this->treeNodes[i]);
+    });
 
-    for (const SketchPath& p : this->paths)
-    {
-      if (&p != &excluded)
+    this->updatePathBvh ();
+    this->pathBvh.contains (point, [this, &excluded, &checkSphere](unsigned int i) {
+      const SketchPath& path = this->paths[this->pathSpheres[i].path];
+
+      if (&path != &excluded)
       {
-        for (const PrimSphere& s : p.spheres ())
-        {
-          checkSphere (s);
-        }
+        checkSphere (path.spheres ()[this->pathSpheres[i].sphere]);
       }
-    }
+    });
     return intersection.isIntersection ();
   }
 
-  void renderTree (Camera& camera)
+  /* Nodes and bones outside of the view frustum are skipped.  Bubbles are placed every half
+   * radius but at least `bubbleMinSpacing` pixels apart, such that distant bones get few bubbles.
+   */
+  void addTreeInstances (const Camera& camera)
   {
     if (this->tree.hasRoot ())
     {
-      this->tree.root ().forEachConstNode ([this, &camera](const SketchNode& node) {
+      const glm::vec3 eye = camera.position ();
+
+      this->tree.root ().forEachConstNode ([this, &camera, &eye](const SketchNode& node) {
         const glm::vec3& pos = node.data ().center ();
         const float      radius = node.data ().radius ();
 
-        this->sphereMesh.position (pos);
-        this->sphereMesh.scaling (glm::vec3 (radius));
-        this->sphereMesh.color (this->renderConfig.nodeColor);
-        this->sphereMesh.render (camera);
+        if (isVisible (camera, pos, radius))
+        {
+          this->sphereInstances.add (pos, radius, this->renderConfig.nodeColor);
+        }
 
-        if (node.parent ())
+        glm::vec3 min, max;
+        bool      isBoneInside = false;
+        nodeBounds (node, min, max);
+
+        if (node.parent () &&
+            camera.isVisible (PrimAABox (min, max), glm::mat4x4 (1.0f), &isBoneInside))
         {
           const glm::vec3& parPos = node.parent ()->data ().center ();
           const float      parRadius = node.parent ()->data ().radius ();
@@ -312,40 +467,39 @@ struct SketchMesh::Impl
           if (this->renderConfig.renderWireframe)
           {
             const glm::vec3 down = glm::vec3 (0.0f, -1.0f, 0.0f);
+            glm::mat4x4     rotation (1.0f);
 
             if (Util::colinearUnit (direction, down))
             {
-              this->boneMesh.rotationMatrix (glm::mat4x4 (1.0f));
-
               if (glm::dot (direction, down) < 0.0f)
               {
-                this->boneMesh.rotateX (glm::pi<float> ());
+                rotation =
+                  glm::rotate (rotation, glm::pi<float> (), glm::vec3 (1.0f, 0.0f, 0.0f));
               }
             }
             else
             {
-              this->boneMesh.rotationMatrix (glm::orientation (direction, down));
+              rotation = glm::orientation (direction, down);
             }
 
-            this->boneMesh.color (this->renderConfig.nodeColor);
-            this->boneMesh.position (parPos);
-            this->boneMesh.scaling (glm::vec3 (parRadius, distance, parRadius));
-            this->boneMesh.render (camera);
+            this->boneInstances.add (parPos, glm::vec3 (parRadius, distance, parRadius), rotation,
+                                     this->renderConfig.nodeColor);
           }
           else
           {
-            this->sphereMesh.color (this->renderConfig.bubbleColor);
-
             for (float d = radius * 0.5f; d < distance;)
             {
               const glm::vec3 bubblePos = pos + (d * direction);
               const float     bubbleRadius = glm::mix (radius, parRadius, d / distance);
+              const float     spacing = this->renderConfig.bubbleMinSpacing;
+              const float     minSpacing = camera.toWorld (spacing, glm::distance (eye, bubblePos));
 
-              this->sphereMesh.position (bubblePos);
-              this->sphereMesh.scaling (glm::vec3 (bubbleRadius));
-              this->sphereMesh.render (camera);
-
-              d += bubbleRadius * 0.5f;
+              if (isBoneInside || isVisible (camera, bubblePos, bubbleRadius))
+              {
+                this->sphereInstances.add (bubblePos, bubbleRadius,
+                                           this->renderConfig.bubbleColor);
+              }
+              d += glm::max (bubbleRadius * 0.5f, minSpacing);
             }
           }
         }
@@ -353,24 +507,27 @@ struct SketchMesh::Impl
     }
   }
 
-  void renderPaths (Camera& camera)
+  void addPathInstances (const Camera& camera)
   {
-    this->sphereMesh.color (this->renderConfig.sphereColor);
-
     for (const SketchPath& p : this->paths)
     {
-      p.render (camera, this->sphereMesh);
+      p.addInstances (this->sphereInstances, this->renderConfig.sphereColor, camera);
     }
   }
 
   void render (Camera& camera)
   {
-    this->renderTree (camera);
+    this->sphereInstances.reset ();
+    this->boneInstances.reset ();
+
+    this->addTreeInstances (camera);
 
     if (this->renderConfig.renderWireframe == false)
     {
-      this->renderPaths (camera);
+      this->addPathInstances (camera);
     }
+    this->sphereInstances.render (camera, *this->sphereMesh);
+    this->boneInstances.render (camera, *this->boneMesh);
   }
 
   void renderWireframe (bool v) { this->renderConfig.renderWireframe = v; }
@@ -453,6 +610,8 @@ struct SketchMesh::Impl
   {
     SketchNode& newNode = parent.emplaceChild (pos, radius);
 
+    this->isTreeBvhValid = false;
+
     if (dim)
     {
       this->addMirroredNode (newNode, this->mirrorPlane (*dim));
@@ -468,6 +627,8 @@ struct SketchMesh::Impl
     SketchNode& newNode = child.parent ()->emplaceChild (pos, radius);
     newNode.addChild (child);
 
+    this->isTreeBvhValid = false;
+
     if (dim)
     {
       const PrimPlane mPlane = this->mirrorPlane (*dim);
@@ -490,6 +651,7 @@ struct SketchMesh::Impl
   SketchPath& addPath (const SketchPath& path)
   {
     this->paths.push_back (path);
+    this->isPathBvhValid = false;
     return this->paths.back ();
   }
 
@@ -505,6 +667,7 @@ struct SketchMesh::Impl
       }
     }
     this->paths.back ().addSphere (intersection, position, radius);
+    this->addLastPathSphereToBvh (this->paths.size () - 1);
 
     if (dim)
     {
@@ -512,6 +675,54 @@ struct SketchMesh::Impl
 
       this->paths.at (this->paths.size () - 2)
         .addSphere (mirrorPlane.mirror (intersection), mirrorPlane.mirror (position), radius);
+      this->addLastPathSphereToBvh (this->paths.size () - 2);
+    }
+  }
+
+  void addSpheres (bool newPath, const glm::vec3& intersection,
+                   const SketchPath::Spheres& spheres, const Dimension* dim)
+  {
+    if (spheres.empty ())
+    {
+      return;
+    }
+    else if (newPath)
+    {
+      this->paths.emplace_back ();
+      if (dim)
+      {
+        this->paths.emplace_back ();
+      }
+    }
+    this->paths.back ().addSpheres (intersection, spheres);
+    this->addLastPathSpheresToBvh (this->paths.size () - 1, spheres.size ());
+
+    if (dim)
+    {
+      const PrimPlane mirrorPlane = this->mirrorPlane (*dim);
+      const glm::vec3 mIntersection = mirrorPlane.mirror (intersection);
+      SketchPath&     mPath = this->paths.at (this->paths.size () - 2);
+
+      for (const PrimSphere& s : spheres)
+      {
+        mPath.addSphere (mIntersection, mirrorPlane.mirror (s.center ()), s.radius ());
+      }
+      this->addLastPathSpheresToBvh (this->paths.size () - 2, spheres.size ());
+    }
+  }
+
+  void addLastPathSphereToBvh (unsigned int path) { this->addLastPathSpheresToBvh (path, 1); }
+
+  void addLastPathSpheresToBvh (unsigned int path, unsigned int numSpheres)
+  {
+    if (this->isPathBvhValid)
+    {
+      const unsigned int end = this->paths[path].spheres ().size ();
+
+      for (unsigned int i = end - numSpheres; i < end; i++)
+      {
+        this->addPathSphereToBvh (path, i);
+      }
     }
   }
 
@@ -545,6 +756,7 @@ struct SketchMesh::Impl
     {
       moveNodes (node, delta);
     }
+    this->isTreeBvhFitted = false;
   }
 
   void scale (SketchNode& node, float factor, bool all, const Dimension* dim)
@@ -576,6 +788,7 @@ struct SketchMesh::Impl
     {
       scaleNodes (node);
     }
+    this->isTreeBvhFitted = false;
   }
 
   void rotate (SketchNode& node, const glm::vec3& axis, float angle, const Dimension* dim)
@@ -604,12 +817,15 @@ struct SketchMesh::Impl
     {
       rotateNodes (node, axis, angle);
     }
+    this->isTreeBvhFitted = false;
   }
 
   void deleteNode (SketchNode& node, bool deleteChildren, const Dimension* dim)
   {
     assert (this->tree.hasRoot ());
 
+    this->isTreeBvhValid = false;
+
     if (node.parent () == nullptr)
     {
       this->reset ();
@@ -649,6 +865,8 @@ struct SketchMesh::Impl
   {
     assert (this->paths.empty () == false);
 
+    this->isPathBvhValid = false;
+
     if (dim && this->paths.size () >= 2)
     {
       const unsigned int index = Util::findIndexByReference (this->paths, path);
@@ -696,22 +914,31 @@ struct SketchMesh::Impl
                (mirrorPlane.absDistance (node.parent ()->data ().center ()) > Util::epsilon ());
       };
 
-      std::function<void(SketchNode&)> mirrorNode = [this, &mirrorPlane, &requiresMirroring,
-                                                     &mirrorNode](SketchNode& node) {
-        unsigned int numChildren = node.numChildren ();
-        node.forEachChild (
-          [this, &mirrorPlane, &requiresMirroring, &mirrorNode, &numChildren](SketchNode& c) {
-            if (numChildren > 0)
-            {
-              if (requiresMirroring (c))
+      /* Mirrored nodes are added to the mirror of their parent, which is passed along the
+       * recursion instead of being searched in the whole tree.  Nodes on the mirror plane are
+       * their own mirrors.
+       */
+      std::function<void(SketchNode&, SketchNode&)> mirrorNode =
+        [&mirrorPlane, &requiresMirroring, &mirrorNode](SketchNode& node, SketchNode& nodeM) {
+          unsigned int numChildren = node.numChildren ();
+          node.forEachChild (
+            [&mirrorPlane, &requiresMirroring, &mirrorNode, &nodeM, &numChildren](SketchNode& c) {
+              if (numChildren > 0)
               {
-                this->addMirroredNode (c, mirrorPlane);
+                numChildren--;
+
+                if (requiresMirroring (c))
+                {
+                  const glm::vec3 pos = mirrorPlane.mirror (c.data ().center ());
+                  mirrorNode (c, nodeM.emplaceChild (pos, c.data ().radius ()));
+                }
+                else
+                {
+                  mirrorNode (c, c);
+                }
               }
-              mirrorNode (c);
-              numChildren--;
-            }
-          });
-      };
+            });
+        };
 
       this->tree.root ().forEachNode ([&mirrorPlane](SketchNode& parent) {
         parent.deleteChildIf ([&mirrorPlane](const SketchNode& child) {
@@ -719,7 +946,7 @@ struct SketchMesh::Impl
         });
       });
 
-      mirrorNode (this->tree.root ());
+      mirrorNode (this->tree.root (), this->tree.root ());
     }
   }
 
@@ -746,12 +973,15 @@ struct SketchMesh::Impl
   {
     this->mirrorTree (dim);
     this->mirrorPaths (dim);
+    this->isTreeBvhValid = false;
+    this->isPathBvhValid = false;
   }
 
   void rebalance (SketchNode& newRoot)
   {
     assert (this->tree.hasRoot ());
     this->tree.rebalance (newRoot);
+    this->isTreeBvhValid = false;
   }
 
   SketchNode& snap (SketchNode& node, Dimension dim)
@@ -759,6 +989,8 @@ struct SketchMesh::Impl
     assert (this->tree.hasRoot ());
     const PrimPlane mPlane = this->mirrorPlane (dim);
 
+    this->isTreeBvhValid = false;
+
     SketchNode* nodeM = this->mirrored (node, mPlane, node);
     if (nodeM && nodeM != &node)
     {
@@ -836,87 +1068,86 @@ struct SketchMesh::Impl
       path.smooth (range, halfWidth, effect,
                    intersection1.isIntersection () ? &intersection1.sphere () : nullptr,
                    intersection2.isIntersection () ? &intersection2.sphere () : nullptr);
+
+      this->isPathBvhValid = false;
     }
   }
 
+  /* Deletes spheres of paths that are contained in a sphere of another path or in a bone.  The
+   * center of a contained sphere lies within the bounds of its container, so containers are found
+   * by point queries.  Containers may be deleted as well, since a strictly larger sphere or a bone
+   * that covers them remains.
+   */
   void optimizePaths ()
   {
-    for (SketchPath& p1 : this->paths)
+    this->isPathBvhValid = false;
+    this->updatePathBvh ();
+    this->updateTreeBvh ();
+
+    std::vector<bool> isContained (this->pathSpheres.size (), false);
+
+    for (unsigned int i = 0; i < this->pathSpheres.size (); i++)
     {
-      for (SketchPath& p2 : this->paths)
-      {
-        if (&p1 < &p2)
-        {
-          for (auto it1 = p1.spheres ().begin (); it1 != p1.spheres ().end ();)
-          {
-            bool deletedP1Sphere = false;
+      const unsigned int path = this->pathSpheres[i].path;
+      const PrimSphere&  s1 = this->paths[path].spheres ()[this->pathSpheres[i].sphere];
 
-            for (auto it2 = p2.spheres ().begin (); it2 != p2.spheres ().end ();)
-            {
-              const PrimSphere& s1 = *it1;
-              const PrimSphere& s2 = *it2;
-              const float       d = glm::distance (s1.center (), s2.center ());
+      this->pathBvh.contains (s1.center (), [this, &isContained, i, path, &s1](unsigned int j) {
+        const PathSphere& other = this->pathSpheres[j];
 
-              if (s2.radius () > d + s1.radius ())
-              {
-                it1 = p1.deleteSphere (it1);
-                deletedP1Sphere = true;
-                break;
-              }
-              else if (s1.radius () > d + s2.radius ())
-              {
-                it2 = p2.deleteSphere (it2);
-              }
-              else
-              {
-                ++it2;
-              }
-            }
-            if (deletedP1Sphere == false)
-            {
-              ++it1;
-            }
+        if (other.path != path)
+        {
+          const PrimSphere& s2 = this->paths[other.path].spheres ()[other.sphere];
+          const float       d = glm::distance (s1.center (), s2.center ());
+
+          if (s2.radius () > d + s1.radius ())
+          {
+            isContained[i] = true;
           }
         }
-      }
-      if (this->tree.hasRoot ())
+      });
+
+      if (isContained[i] == false)
       {
-        this->tree.root ().forEachNode ([&p1](SketchNode& node) {
+        this->treeBvh.contains (s1.center (), [this, &isContained, i, &s1](unsigned int j) {
+          const SketchNode& node = *this->treeNodes[j];
+
           if (node.parent ())
           {
             const PrimConeSphere coneSphere (node.data (), node.parent ()->data ());
 
-            for (auto it1 = p1.spheres ().begin (); it1 != p1.spheres ().end ();)
+            if (Distance::distance (coneSphere, s1.center ()) < -s1.radius ())
             {
-              const PrimSphere& s1 = *it1;
-              const float       d = Distance::distance (coneSphere, s1.center ());
-
-              if (d < -s1.radius ())
-              {
-                it1 = p1.deleteSphere (it1);
-              }
-              else
-              {
-                ++it1;
-              }
+              isContained[i] = true;
             }
           }
         });
       }
     }
+
+    unsigned int offset = 0;
+    for (SketchPath& path : this->paths)
+    {
+      const unsigned int numSpheres = path.spheres ().size ();
+
+      path.deleteSpheres (
+        [&isContained, offset](unsigned int i) { return isContained[offset + i]; });
+      offset += numSpheres;
+    }
+    this->isPathBvhValid = false;
   }
 
   void runFromConfig (const Config& config)
   {
-    this->renderConfig.nodeColor = config.get<Color> ("editor/sketch/node/color");
-    this->renderConfig.bubbleColor = config.get<Color> ("editor/sketch/bubble/color");
-    this->renderConfig.sphereColor = config.get<Color> ("editor/sketch/sphere/color");
+    this->renderConfig.nodeColor = config.get (nodeColorKey);
+    this->renderConfig.bubbleColor = config.get (bubbleColorKey);
+    this->renderConfig.sphereColor = config.get (sphereColorKey);
+    this->renderConfig.bubbleMinSpacing = config.get (bubbleMinSpacingKey);
   }
 };
 
 DELEGATE_BIG4_COPY_SELF (SketchMesh);
 GETTER_CONST (const SketchTree&, SketchMesh, tree)
-GETTER (SketchTree&, SketchMesh, tree)
+SketchTree& SketchMesh::tree () { return this->impl->mutableTree (); }
 GETTER_CONST (const SketchPaths&, SketchMesh, paths)
 DELEGATE_CONST (bool, SketchMesh, isEmpty)
 DELEGATE1 (void, SketchMesh, fromTree, const SketchTree&)
@@ -933,6 +1164,8 @@ DELEGATE4 (SketchNode&, SketchMesh, addChild, SketchNode&, const glm::vec3&, flo
 DELEGATE4 (SketchNode&, SketchMesh, addParent, SketchNode&, const glm::vec3&, float,
            const Dimension*)
 DELEGATE1 (SketchPath&, SketchMesh, addPath, const SketchPath&)
+DELEGATE4 (void, SketchMesh, addSpheres, bool, const glm::vec3&, const SketchPath::Spheres&,
+           const Dimension*)
 DELEGATE5 (void, SketchMesh, addSphere, bool, const glm::vec3&, const glm::vec3&, float,
            const Dimension*)
 DELEGATE4 (void, SketchMesh, move, SketchNode&, const glm::vec3&, bool, const Dimension*)
@@ -39,6 +39,8 @@ public:
   SketchNode& addParent (SketchNode&, const glm::vec3&, float, const Dimension*);
   SketchPath& addPath (const SketchPath&);
   void        addSphere (bool, const glm::vec3&, const glm::vec3&, float, const Dimension*);
+  // adds several spheres that share an intersection to the last path at once
+  void        addSpheres (bool, const glm::vec3&, const std::vector<PrimSphere>&, const Dimension*);
   void        move (SketchNode&, const glm::vec3&, bool, const Dimension*);
   void        scale (SketchNode&, float, bool, const Dimension*);
   void        rotate (SketchNode&, const glm::vec3&, float, const Dimension*);
@@ -1,5 +1,6 @@
-#include "../mesh.hpp"
+#include "camera.hpp"
 #include "intersection.hpp"
+#include "mesh-instances.hpp"
 #include "primitive/aabox.hpp"
 #include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
@@ -70,18 +71,63 @@ struct SketchPath::Impl
     this->spheres.emplace_back (position, radius);
   }
 
-  SketchPath::Spheres::iterator deleteSphere (SketchPath::Spheres::const_iterator it)
+  void addSpheres (const glm::vec3& intersection, const SketchPath::Spheres& newSpheres)
   {
-    return this->spheres.erase (it);
+    if (newSpheres.empty ())
+    {
+      return;
+    }
+    else if (this->spheres.empty ())
+    {
+      this->intersectionFirst = intersection;
+    }
+    this->intersectionLast = intersection;
+
+    for (const PrimSphere& s : newSpheres)
+    {
+      this->maximum = glm::max (this->maximum, s.center () + glm::vec3 (s.radius ()));
+      this->minimum = glm::min (this->minimum, s.center () - glm::vec3 (s.radius ()));
+    }
+    this->spheres.insert (this->spheres.end (), newSpheres.begin (), newSpheres.end ());
   }
 
-  void render (Camera& camera, Mesh& mesh) const
+  void deleteSpheres (const std::function<bool(unsigned int)>& isDeleted)
   {
+    unsigned int numKept = 0;
+
+    for (unsigned int i = 0; i < this->spheres.size (); i++)
+    {
+      if (isDeleted (i) == false)
+      {
+        if (numKept != i)
+        {
+          this->spheres[numKept] = this->spheres[i];
+        }
+        numKept++;
+      }
+    }
+    this->spheres.erase (this->spheres.begin () + numKept, this->spheres.end ());
+    this->setMinMax ();
+  }
+
+  void addInstances (MeshInstances& instances, const Color& color, const Camera& camera) const
+  {
+    const glm::mat4x4 model (1.0f);
+    bool              isInside = false;
+
+    if (this->isEmpty () || camera.isVisible (this->aabox (), model, &isInside) == false)
+    {
+      return;
+    }
     for (const PrimSphere& s : this->spheres)
     {
-      mesh.position (s.center ());
-      mesh.scaling (glm::vec3 (s.radius ()));
-      mesh.render (camera);
+      const glm::vec3 extent (s.radius ());
+
+      if (isInside ||
+          camera.isVisible (PrimAABox (s.center () - extent, s.center () + extent), model))
+      {
+        instances.add (s.center (), s.radius (), color);
+      }
     }
   }
 
@@ -142,77 +188,103 @@ struct SketchPath::Impl
     return mirrored;
   }
 
+  /* Replaces each sphere that intersects `range` by the average of the spheres within
+   * `halfWidth` of it, whose windows are shortened symmetrically at the ends of the path.
+   * Averages are taken of the unsmoothed spheres by prefix sums, such that each sphere is
+   * smoothed in constant time regardless of `halfWidth`.
+   */
   void smooth (const PrimSphere& range, unsigned int halfWidth, SketchPathSmoothEffect effect,
                const PrimSphere* nearestToFirst, const PrimSphere* nearestToLast)
   {
     const unsigned int numS = this->spheres.size ();
 
+    std::vector<unsigned int> affected;
     for (unsigned int i = 0; i < numS; i++)
     {
-      if (IntersectionUtil::intersects (range, this->spheres.at (i)))
+      if (IntersectionUtil::intersects (range, this->spheres[i]))
       {
-        const unsigned int hW =
-          i < halfWidth ? i : (i >= numS - halfWidth ? numS - i - 1 : halfWidth);
-        glm::vec3 center (0.0f);
-        float     radius (0.0f);
-        for (unsigned int j = i - hW; j <= i + hW; j++)
+        affected.push_back (i);
+      }
+    }
+
+    if (affected.empty ())
+    {
+      return;
+    }
+
+    // sums of the spheres in `[begin, j)` at index `j - begin`
+    const unsigned int begin = affected.front () - glm::min (affected.front (), halfWidth);
+    const unsigned int end = glm::min (numS, affected.back () + halfWidth + 1);
+
+    std::vector<glm::dvec3> centerSums (1, glm::dvec3 (0.0));
+    std::vector<double>     radiusSums (1, 0.0);
+
+    for (unsigned int j = begin; j < end; j++)
+    {
+      centerSums.push_back (centerSums.back () + glm::dvec3 (this->spheres[j].center ()));
+      radiusSums.push_back (radiusSums.back () + double(this->spheres[j].radius ()));
+    }
+
+    for (unsigned int i : affected)
+    {
+      const unsigned int hW = glm::min (halfWidth, glm::min (i, numS - i - 1));
+      const unsigned int first = i - hW - begin;
+      const unsigned int last = i + hW + 1 - begin;
+
+      glm::vec3 center (centerSums[last] - centerSums[first]);
+      float     radius = float(radiusSums[last] - radiusSums[first]);
+
+      const bool effectEmbeds = effect == SketchPathSmoothEffect::Embed ||
+                                effect == SketchPathSmoothEffect::EmbedAndAdjust;
+      unsigned int numAffectedCenter = 0;
+      unsigned int numAffectedRadius = 0;
+
+      if (effect != SketchPathSmoothEffect::None)
+      {
+        if (i < halfWidth)
         {
-          center += this->spheres.at (j).center ();
-          radius += this->spheres.at (j).radius ();
-        }
+          if (nearestToFirst && effectEmbeds)
+          {
+            numAffectedCenter++;
+            center += nearestToFirst->center ();
+          }
 
-        const bool effectEmbeds = effect == SketchPathSmoothEffect::Embed ||
-                                  effect == SketchPathSmoothEffect::EmbedAndAdjust;
-        unsigned int numAffectedCenter = 0;
-        unsigned int numAffectedRadius = 0;
+          if (nearestToFirst && effect == SketchPathSmoothEffect::EmbedAndAdjust)
+          {
+            numAffectedRadius++;
+            radius += nearestToFirst->radius ();
+          }
+          else if (effect == SketchPathSmoothEffect::Pinch)
+          {
+            numAffectedRadius++;
+            numAffectedCenter++;
+            center += this->intersectionFirst;
+          }
+        }
 
-        if (effect != SketchPathSmoothEffect::None)
+        if (i + halfWidth >= numS)
         {
-          if (i < halfWidth)
+          if (nearestToLast && effectEmbeds)
           {
-            if (nearestToFirst && effectEmbeds)
-            {
-              numAffectedCenter++;
-              center += nearestToFirst->center ();
-            }
-
-            if (nearestToFirst && effect == SketchPathSmoothEffect::EmbedAndAdjust)
-            {
-              numAffectedRadius++;
-              radius += nearestToFirst->radius ();
-            }
-            else if (effect == SketchPathSmoothEffect::Pinch)
-            {
-              numAffectedRadius++;
-              numAffectedCenter++;
-              center += this->intersectionFirst;
-            }
+            numAffectedCenter++;
+            center += nearestToLast->center ();
           }
 
-          if (i >= numS - halfWidth)
+          if (nearestToLast && effect == SketchPathSmoothEffect::EmbedAndAdjust)
+          {
+            numAffectedRadius++;
+            radius += nearestToLast->radius ();
+          }
+          else if (effect == SketchPathSmoothEffect::Pinch)
           {
-            if (nearestToLast && effectEmbeds)
-            {
-              numAffectedCenter++;
-              center += nearestToLast->center ();
-            }
-
-            if (nearestToLast && effect == SketchPathSmoothEffect::EmbedAndAdjust)
-            {
-              numAffectedRadius++;
-              radius += nearestToLast->radius ();
-            }
-            else if (effect == SketchPathSmoothEffect::Pinch)
-            {
-              numAffectedRadius++;
-              numAffectedCenter++;
-              center += this->intersectionLast;
-            }
+            numAffectedRadius++;
+            numAffectedCenter++;
+            center += this->intersectionLast;
           }
         }
-        this->spheres.at (i).center (center / float((2 * hW) + 1 + numAffectedCenter));
-        this->spheres.at (i).radius (radius / float((2 * hW) + 1 + numAffectedRadius));
       }
+      this->spheres.at (i).center (center / float((2 * hW) + 1 + numAffectedCenter));
+      this->spheres.at (i).radius (radius / float((2 * hW) + 1 + numAffectedRadius));
     }
     this->setMinMax ();
   }
@@ -230,9 +302,9 @@ DELEGATE (void, SketchPath, reset)
 DELEGATE_CONST (bool, SketchPath, isEmpty)
 DELEGATE_CONST (PrimAABox, SketchPath, aabox)
 DELEGATE3 (void, SketchPath, addSphere, const glm::vec3&, const glm::vec3&, float)
-DELEGATE1 (SketchPath::Spheres::iterator, SketchPath, deleteSphere,
-           SketchPath::Spheres::const_iterator)
-DELEGATE2_CONST (void, SketchPath, render, Camera&, Mesh&)
+DELEGATE2 (void, SketchPath, addSpheres, const glm::vec3&, const SketchPath::Spheres&)
+DELEGATE1 (void, SketchPath, deleteSpheres, const std::function<bool(unsigned int)>&)
+DELEGATE3_CONST (void, SketchPath, addInstances, MeshInstances&, const Color&, const Camera&)
 DELEGATE3 (bool, SketchPath, intersects, const PrimRay&, SketchMesh&, SketchPathIntersection&)
 DELEGATE1 (SketchPath, SketchPath, mirror, const PrimPlane&)
 DELEGATE5 (void, SketchPath, smooth, const PrimSphere&, unsigned int, SketchPathSmoothEffect,
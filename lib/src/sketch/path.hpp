@@ -5,13 +5,16 @@
 #ifndef DILAY_SKETCH_PATH
 #define DILAY_SKETCH_PATH
 
+#include <functional>
 #include <glm/fwd.hpp>
+#include <vector>
 #include "macro.hpp"
 #include "sketch/fwd.hpp"
 
 class Camera;
+class Color;
 class Intersection;
-class Mesh;
+class MeshInstances;
 class PrimAABox;
 class PrimPlane;
 class PrimRay;
@@ -42,8 +45,12 @@ public:
   bool              isEmpty () const;
   PrimAABox         aabox () const;
   void              addSphere (const glm::vec3&, const glm::vec3&, float);
-  Spheres::iterator deleteSphere (Spheres::const_iterator);
-  void              render (Camera&, Mesh&) const;
+  // appends spheres whose last intersection is given
+  void              addSpheres (const glm::vec3&, const Spheres&);
+  // deletes the spheres whose indices satisfy a predicate in a single pass
+  void              deleteSpheres (const std::function<bool(unsigned int)>&);
+  // adds the spheres that may be visible
+  void              addInstances (MeshInstances&, const Color&, const Camera&) const;
   bool              intersects (const PrimRay&, SketchMesh&, SketchPathIntersection&);
   SketchPath        mirror (const PrimPlane&);
   void smooth (const PrimSphere&, unsigned int, SketchPathSmoothEffect, const PrimSphere*,
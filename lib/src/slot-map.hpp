@@ -0,0 +1,150 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_SLOT_MAP
+#define DILAY_SLOT_MAP
+
+#include <cassert>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "macro.hpp"
+
+/* Elements that are constructed in slots of fixed-size chunks and are never moved, such that
+ * references to an element stay valid until it is erased.  Slots of erased elements are reused.
+ * Elements are kept in order of their insertion in a contiguous array of pointers, which is
+ * iterated by index.  The positions of elements in this array are looked up by their addresses,
+ * so erasing an element does not search for it.
+ */
+template <typename T> class SlotMap
+{
+public:
+  SlotMap () = default;
+  DELETE_COPYMOVEASSIGN (SlotMap)
+  ~SlotMap () { this->clear (); }
+
+  unsigned int size () const { return this->elements.size (); }
+
+  bool isEmpty () const { return this->elements.empty (); }
+
+  T& operator[] (unsigned int i)
+  {
+    assert (i < this->size ());
+    return *this->elements[i];
+  }
+
+  const T& operator[] (unsigned int i) const
+  {
+    assert (i < this->size ());
+    return *this->elements[i];
+  }
+
+  T& back () { return (*this)[this->size () - 1]; }
+
+  bool contains (const T& element) const
+  {
+    return this->positions.find (&element) != this->positions.end ();
+  }
+
+  template <typename... Args> T& emplace (Args&&... args)
+  {
+    T* element = new (this->freeSlot ()) T (std::forward<Args> (args)...);
+
+    this->positions.emplace (element, this->elements.size ());
+    this->elements.push_back (element);
+    return *element;
+  }
+
+  // constructs a new element in the slot and at the position of an existing element
+  template <typename... Args> T& replace (T& element, Args&&... args)
+  {
+    assert (this->contains (element));
+
+    element.~T ();
+    return *new (&element) T (std::forward<Args> (args)...);
+  }
+
+  void erase (T& element)
+  {
+    const auto it = this->positions.find (&element);
+    assert (it != this->positions.end ());
+
+    const unsigned int position = it->second;
+
+    this->positions.erase (it);
+    this->elements.erase (this->elements.begin () + position);
+    this->destroy (element);
+
+    for (unsigned int i = position; i < this->elements.size (); i++)
+    {
+      this->positions[this->elements[i]] = i;
+    }
+  }
+
+  template <typename F> void eraseIf (const F& f)
+  {
+    unsigned int numKept = 0;
+
+    for (T* element : this->elements)
+    {
+      if (f (static_cast<const T&> (*element)))
+      {
+        this->positions.erase (element);
+        this->destroy (*element);
+      }
+      else
+      {
+        this->positions[element] = numKept;
+        this->elements[numKept++] = element;
+      }
+    }
+    this->elements.resize (numKept);
+  }
+
+  void clear ()
+  {
+    for (T* element : this->elements)
+    {
+      this->destroy (*element);
+    }
+    this->elements.clear ();
+    this->positions.clear ();
+  }
+
+private:
+  static constexpr unsigned int chunkSize = 16;
+
+  typedef typename std::aligned_storage<sizeof (T), alignof (T)>::type Slot;
+
+  std::vector<std::unique_ptr<Slot[]>>       chunks;
+  std::vector<void*>                         freeSlots;
+  std::vector<T*>                            elements;
+  std::unordered_map<const T*, unsigned int> positions;
+
+  void* freeSlot ()
+  {
+    if (this->freeSlots.empty ())
+    {
+      this->chunks.emplace_back (new Slot[chunkSize]);
+
+      for (unsigned int i = chunkSize; i > 0; i--)
+      {
+        this->freeSlots.push_back (&this->chunks.back ()[i - 1]);
+      }
+    }
+    void* slot = this->freeSlots.back ();
+    this->freeSlots.pop_back ();
+    return slot;
+  }
+
+  void destroy (T& element)
+  {
+    element.~T ();
+    this->freeSlots.push_back (&element);
+  }
+};
+
+#endif
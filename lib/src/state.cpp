@@ -2,16 +2,22 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <QDir>
 #include <QShortcut>
+#include <QTimer>
 #include <memory>
+#include "autosave.hpp"
 #include "cache.hpp"
 #include "camera.hpp"
 #include "config.hpp"
 #include "history.hpp"
+#include "maintenance.hpp"
 #include "maybe.hpp"
+#include "scene-loader.hpp"
 #include "scene.hpp"
 #include "state.hpp"
 #include "tool.hpp"
+#include "tool/sculpt/util/stroke-record.hpp"
 #include "tools.hpp"
 #include "view/gl-widget.hpp"
 #include "view/info-pane.hpp"
@@ -21,6 +27,7 @@
 #include "view/tool-pane.hpp"
 #include "view/tool-tip.hpp"
 #include "view/two-column-grid.hpp"
+#include "view/util.hpp"
 
 namespace
 {
@@ -36,9 +43,20 @@ struct State::Impl
   Camera                  camera;
   History                 history;
   Scene                   scene;
+  SculptStrokeRecorder    strokeRecorder;
+  SceneLoader             loader;
   std::unique_ptr<Tool>   toolPtr;
-  Maybe<ToolKey>          previousToolKey;
+  InlineMaybe<ToolKey>    previousToolKey;
   std::vector<QShortcut*> shortcuts;
+  QTimer                  idleTimer;
+  Maintenance             maintenance;
+  QTimer                  maintenanceTimer;
+  QTimer                  navigationTimer;
+  Autosave                autosave;
+  QTimer                  autosaveTimer;
+  int                     rebalanceDelay;
+  int                     maintenanceSliceTime;
+  int                     navigationDelay;
 
   Impl (State* s, ViewMainWindow& mW, Config& cfg, Cache& cch)
     : self (s)
@@ -48,10 +66,88 @@ struct State::Impl
     , camera (this->config)
     , history (this->config)
     , scene (this->config)
+    , loader (this->scene, this->config,
+              [this]() {
+                this->mainWindow.infoPane ().scene ().updateInfo ();
+                this->mainWindow.update ();
+              })
+    , maintenance (this->scene)
+    , autosave (QDir::temp ().filePath ("dilay-autosave.dly").toStdString ())
+    , rebalanceDelay (this->config.get<int> ("editor/mesh/octree/rebalance-delay"))
+    , maintenanceSliceTime (this->config.get<int> ("editor/maintenance/slice-time"))
+    , navigationDelay (this->config.get<int> ("editor/mesh/proxy/navigation-delay"))
   {
+    this->idleTimer.setSingleShot (true);
+    QObject::connect (&this->idleTimer, &QTimer::timeout, [this]() {
+      this->maintenance.start ();
+      this->maintenanceTimer.start (0);
+    });
+
+    // a slice of maintenance is run whenever the event loop has no pending events
+    QObject::connect (&this->maintenanceTimer, &QTimer::timeout, [this]() {
+      if (this->maintenance.runSlice (this->maintenanceSliceTime) == false)
+      {
+        this->maintenanceTimer.stop ();
+      }
+    });
+
+    this->navigationTimer.setSingleShot (true);
+    QObject::connect (&this->navigationTimer, &QTimer::timeout, [this]() {
+      this->scene.navigating (false);
+      this->mainWindow.update ();
+    });
+
+    QObject::connect (&this->autosaveTimer, &QTimer::timeout, [this]() {
+      if (this->scene.isEmpty () == false)
+      {
+        this->autosave.save (this->scene);
+      }
+    });
+    this->restartAutosaveTimer ();
+
     this->resetTool ();
   }
 
+  /* Interrupts maintenance and restarts the timer that starts it once the user stopped
+   * interacting for a while.
+   */
+  void interruptMaintenance ()
+  {
+    this->maintenance.stop ();
+    this->maintenanceTimer.stop ();
+
+    if (this->rebalanceDelay > 0)
+    {
+      this->idleTimer.start (this->rebalanceDelay);
+    }
+    else
+    {
+      this->idleTimer.stop ();
+    }
+  }
+
+  // renders proxies of meshes until the camera has not been moved for a while
+  void navigate ()
+  {
+    this->scene.navigating (true);
+    this->scene.updateProxies ();
+    this->navigationTimer.start (this->navigationDelay);
+  }
+
+  void restartAutosaveTimer ()
+  {
+    const int interval = this->config.get<int> ("editor/autosave-interval");
+
+    if (interval > 0)
+    {
+      this->autosaveTimer.start (1000 * interval);
+    }
+    else
+    {
+      this->autosaveTimer.stop ();
+    }
+  }
+
   bool hasTool () const { return bool(this->toolPtr); }
 
   Tool& tool ()
@@ -234,6 +330,8 @@ struct State::Impl
     {
       SET_TOOL (TransformMesh)
       SET_TOOL (DeleteMesh)
+      SET_TOOL (SeparateMesh)
+      SET_TOOL (SubdivideMesh)
       SET_TOOL (NewMesh)
       SET_TOOL (SculptDraw)
       SET_TOOL (SculptGrab)
@@ -242,12 +340,15 @@ struct State::Impl
       SET_TOOL (SculptCrease)
       SET_TOOL (SculptPinch)
       SET_TOOL (SculptReduce)
+      SET_TOOL (SculptMask)
       SET_TOOL (EditSketch)
       SET_TOOL (DeleteSketch)
       SET_TOOL (ConvertSketch)
       SET_TOOL (SketchSpheres)
       SET_TOOL (TrimMesh)
       SET_TOOL (Remesh)
+      SET_TOOL (Decimate)
+      SET_TOOL (Clay)
       SET_TOOL (MoveCamera)
     }
 #undef SET_TOOL
@@ -302,6 +403,11 @@ struct State::Impl
     this->camera.fromConfig (this->config);
     this->history.fromConfig (this->config);
     this->scene.fromConfig (this->config);
+    this->restartAutosaveTimer ();
+
+    this->rebalanceDelay = this->config.get<int> ("editor/mesh/octree/rebalance-delay");
+    this->maintenanceSliceTime = this->config.get<int> ("editor/maintenance/slice-time");
+    this->navigationDelay = this->config.get<int> ("editor/mesh/proxy/navigation-delay");
 
     if (this->hasTool ())
     {
@@ -309,8 +415,21 @@ struct State::Impl
     }
   }
 
+  void fromDlyFile (const std::string& fileName)
+  {
+    this->loader.load (fileName, [this](bool success) {
+      if (success == false)
+      {
+        ViewUtil::error (this->mainWindow, QObject::tr ("Could not open file."));
+      }
+    });
+  }
+
   void undo ()
   {
+    // the history expects the meshes of a file that is being loaded to be part of the scene
+    this->loader.finish ();
+
     if (this->hasTool ())
     {
       this->handleToolResponse (this->toolPtr->commit ());
@@ -322,6 +441,8 @@ struct State::Impl
 
   void redo ()
   {
+    this->loader.finish ();
+
     if (this->hasTool ())
     {
       this->handleToolResponse (this->toolPtr->commit ());
@@ -333,7 +454,11 @@ struct State::Impl
 
   void handleToolResponse (ToolResponse response)
   {
-    this->mainWindow.infoPane ().scene ().updateInfo ();
+    if (response != ToolResponse::RedrawOverlay)
+    {
+      this->mainWindow.infoPane ().scene ().updateInfo ();
+    }
+    this->interruptMaintenance ();
 
     switch (response)
     {
@@ -342,6 +467,9 @@ struct State::Impl
       case ToolResponse::Redraw:
         this->mainWindow.update ();
         break;
+      case ToolResponse::RedrawOverlay:
+        this->mainWindow.glWidget ().updateOverlay ();
+        break;
       case ToolResponse::Terminate:
         this->resetTool ();
         break;
@@ -357,6 +485,7 @@ GETTER (Cache&, State, cache)
 GETTER (Camera&, State, camera)
 GETTER (History&, State, history)
 GETTER (Scene&, State, scene)
+GETTER (SculptStrokeRecorder&, State, strokeRecorder)
 DELEGATE (bool, State, hasTool)
 DELEGATE (Tool&, State, tool)
 DELEGATE1 (void, State, setTool, ToolKey)
@@ -365,6 +494,9 @@ DELEGATE2 (void, State, setToolTip, const ViewToolTip*, const ViewShortcuts&)
 DELEGATE1 (void, State, setToolTip, const ViewToolTip*)
 DELEGATE (void, State, resetTool)
 DELEGATE (void, State, fromConfig)
+DELEGATE1 (void, State, fromDlyFile, const std::string&)
+DELEGATE (void, State, navigate)
+DELEGATE (void, State, interruptMaintenance)
 DELEGATE (void, State, undo)
 DELEGATE (void, State, redo)
 DELEGATE1 (void, State, handleToolResponse, ToolResponse)
@@ -6,6 +6,7 @@
 #define DILAY_STATE
 
 #include <initializer_list>
+#include <string>
 #include "macro.hpp"
 
 class Cache;
@@ -15,6 +16,7 @@ class History;
 class Id;
 class Mesh;
 class Scene;
+class SculptStrokeRecorder;
 class Tool;
 enum class ToolKey;
 enum class ToolResponse;
@@ -43,9 +45,18 @@ public:
   void            setToolTip (const ViewToolTip*);
   void            resetTool ();
   void            fromConfig ();
+  // loads a file into the scene on a background thread, cf. `SceneLoader`
+  void            fromDlyFile (const std::string&);
+  // called whenever the camera moves, cf. `Scene::navigating`
+  void            navigate ();
+  // called on input, which interrupts housekeeping until the user is idle, cf. `Maintenance`
+  void            interruptMaintenance ();
   void            undo ();
   void            redo ();
 
+  // records sculpt strokes, cf. `SculptStrokeRecorder`
+  SculptStrokeRecorder& strokeRecorder ();
+
   void handleToolResponse (ToolResponse);
 
 private:
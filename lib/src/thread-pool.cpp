@@ -0,0 +1,237 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "thread-pool.hpp"
+#include "util.hpp"
+
+namespace
+{
+  typedef std::function<void(unsigned int, unsigned int)> ChunkFunction;
+
+  // set on worker threads, while a thread runs the chunks of a job, and in serial scopes
+  thread_local bool isRunningChunks = false;
+
+  // number of threads of the global pool, where 0 stands for the hardware's concurrency
+  unsigned int numGlobalThreads = 0;
+
+  // chunks `[begin, end)` of a job: the owner takes from the front, thieves from the back
+  struct ChunkQueue
+  {
+    std::mutex   mutex;
+    unsigned int begin;
+    unsigned int end;
+
+    bool popFront (unsigned int& chunk)
+    {
+      std::lock_guard<std::mutex> lock (this->mutex);
+
+      if (this->begin < this->end)
+      {
+        chunk = this->begin++;
+        return true;
+      }
+      return false;
+    }
+
+    bool popBack (unsigned int& chunk)
+    {
+      std::lock_guard<std::mutex> lock (this->mutex);
+
+      if (this->begin < this->end)
+      {
+        chunk = --this->end;
+        return true;
+      }
+      return false;
+    }
+  };
+
+  struct Job
+  {
+    unsigned int             n;
+    unsigned int             chunkSize;
+    const ChunkFunction*     f;
+    const CancellationToken* token;
+  };
+}
+
+struct ThreadPool::Impl
+{
+  std::vector<std::thread>      workers;
+  std::unique_ptr<ChunkQueue[]> queues;
+  std::mutex                    mutex;
+  std::mutex                    runMutex;
+  std::condition_variable       wakeUp;
+  std::condition_variable       finished;
+  Job                           job;
+  unsigned int                  generation;
+  unsigned int                  numBusyWorkers;
+  bool                          stop;
+
+  Impl (unsigned int numThreads)
+    : queues (new ChunkQueue[std::max (1u, numThreads)])
+    , generation (0)
+    , numBusyWorkers (0)
+    , stop (false)
+  {
+    for (unsigned int i = 1; i < numThreads; i++)
+    {
+      this->workers.emplace_back ([this, i]() { this->work (i); });
+    }
+  }
+
+  ~Impl ()
+  {
+    {
+      std::lock_guard<std::mutex> lock (this->mutex);
+      this->stop = true;
+    }
+    this->wakeUp.notify_all ();
+
+    for (std::thread& worker : this->workers)
+    {
+      worker.join ();
+    }
+  }
+
+  static ThreadPool& global ()
+  {
+    static ThreadPool pool (numGlobalThreads > 0 ? numGlobalThreads
+                                                 : std::thread::hardware_concurrency ());
+    return pool;
+  }
+
+  static void globalNumThreads (unsigned int n) { numGlobalThreads = n; }
+
+  unsigned int numThreads () const { return this->workers.size () + 1; }
+
+  void work (unsigned int queue)
+  {
+    isRunningChunks = true;
+
+    unsigned int generation = 0;
+    for (;;)
+    {
+      {
+        std::unique_lock<std::mutex> lock (this->mutex);
+        this->wakeUp.wait (lock, [this, generation]() {
+          return this->stop || this->generation != generation;
+        });
+
+        if (this->stop)
+        {
+          return;
+        }
+        generation = this->generation;
+      }
+      this->runChunks (queue);
+      {
+        std::lock_guard<std::mutex> lock (this->mutex);
+        this->numBusyWorkers--;
+      }
+      this->finished.notify_one ();
+    }
+  }
+
+  bool nextChunk (unsigned int queue, unsigned int& chunk)
+  {
+    if (this->queues[queue].popFront (chunk))
+    {
+      return true;
+    }
+    for (unsigned int i = 1; i < this->numThreads (); i++)
+    {
+      if (this->queues[(queue + i) % this->numThreads ()].popBack (chunk))
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void runChunks (unsigned int queue)
+  {
+    const Job&   job = this->job;
+    unsigned int chunk;
+
+    while (this->nextChunk (queue, chunk))
+    {
+      if (job.token == nullptr || job.token->isCancelled () == false)
+      {
+        const unsigned int begin = chunk * job.chunkSize;
+        (*job.f) (begin, std::min (begin + job.chunkSize, job.n));
+      }
+    }
+  }
+
+  bool run (unsigned int n, unsigned int chunkSize, const ChunkFunction& f,
+            const CancellationToken* token)
+  {
+    assert (chunkSize > 0);
+
+    const unsigned int numChunks = (n + chunkSize - 1) / chunkSize;
+
+    if (numChunks <= 1 || this->numThreads () == 1 || isRunningChunks)
+    {
+      for (unsigned int begin = 0; begin < n; begin += chunkSize)
+      {
+        if (token && token->isCancelled ())
+        {
+          break;
+        }
+        f (begin, std::min (begin + chunkSize, n));
+      }
+    }
+    else
+    {
+      // jobs of different threads are run one after another
+      std::lock_guard<std::mutex> runLock (this->runMutex);
+
+      for (unsigned int i = 0; i < this->numThreads (); i++)
+      {
+        std::lock_guard<std::mutex> lock (this->queues[i].mutex);
+
+        this->queues[i].begin = (i * numChunks) / this->numThreads ();
+        this->queues[i].end = ((i + 1) * numChunks) / this->numThreads ();
+      }
+      {
+        std::lock_guard<std::mutex> lock (this->mutex);
+
+        this->job = Job{n, chunkSize, &f, token};
+        this->numBusyWorkers = this->workers.size ();
+        this->generation++;
+      }
+      this->wakeUp.notify_all ();
+
+      isRunningChunks = true;
+      this->runChunks (0);
+      isRunningChunks = false;
+
+      std::unique_lock<std::mutex> lock (this->mutex);
+      this->finished.wait (lock, [this]() { return this->numBusyWorkers == 0; });
+    }
+    return token == nullptr || token->isCancelled () == false;
+  }
+};
+
+ThreadPool::SerialScope::SerialScope ()
+  : wasSerial (isRunningChunks)
+{
+  isRunningChunks = true;
+}
+
+ThreadPool::SerialScope::~SerialScope () { isRunningChunks = this->wasSerial; }
+
+DELEGATE1_BIG2 (ThreadPool, unsigned int)
+DELEGATE_STATIC (ThreadPool&, ThreadPool, global)
+DELEGATE1_STATIC (void, ThreadPool, globalNumThreads, unsigned int)
+DELEGATE_CONST (unsigned int, ThreadPool, numThreads)
+DELEGATE4 (bool, ThreadPool, run, unsigned int, unsigned int, const ChunkFunction&,
+           const CancellationToken*)
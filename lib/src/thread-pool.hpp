@@ -0,0 +1,79 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_THREAD_POOL
+#define DILAY_THREAD_POOL
+
+#include <atomic>
+#include <functional>
+#include "macro.hpp"
+
+class CancellationToken
+{
+public:
+  CancellationToken ()
+    : _isCancelled (false)
+  {
+  }
+
+  void cancel () { this->_isCancelled = true; }
+  void reset () { this->_isCancelled = false; }
+  bool isCancelled () const { return this->_isCancelled; }
+
+private:
+  std::atomic<bool> _isCancelled;
+};
+
+/* Pool of worker threads, on which `parallelFor` distributes chunks of a range.  Each thread owns
+ * a queue of chunks and steals chunks from the other queues once its own queue is empty.  The
+ * calling thread takes part as well.  Calls from within a chunk run serially.
+ *
+ * Chunks only depend on the size of the range and the chunk size, but not on the number of
+ * threads.  Results are therefore identical across runs and thread counts as long as chunks write
+ * disjoint elements and per-chunk results are combined in the order of the chunks afterwards.
+ */
+class ThreadPool
+{
+public:
+  DECLARE_BIG2 (ThreadPool, unsigned int)
+
+  // runs all calls of the current thread serially while it exists, e.g. to compute references
+  class SerialScope
+  {
+  public:
+    SerialScope ();
+    SerialScope (const SerialScope&) = delete;
+    SerialScope (SerialScope&&) = delete;
+    const SerialScope& operator= (const SerialScope&) = delete;
+    const SerialScope& operator= (SerialScope&&) = delete;
+    ~SerialScope ();
+
+  private:
+    bool wasSerial;
+  };
+
+  static ThreadPool& global ();
+  // sets the number of threads of the global pool, which has no effect once it has been used
+  static void        globalNumThreads (unsigned int);
+
+  unsigned int numThreads () const;
+
+  /* Calls `f (begin, end)` on chunks of `[0, n)` with at most `chunkSize` elements.  Returns
+   * `false` if `token` has been cancelled, in which case some chunks may have been skipped.
+   */
+  template <typename F>
+  bool parallelFor (unsigned int n, unsigned int chunkSize, const F& f,
+                    const CancellationToken* token = nullptr)
+  {
+    return this->run (n, chunkSize, std::cref (f), token);
+  }
+
+private:
+  IMPLEMENTATION
+
+  bool run (unsigned int, unsigned int, const std::function<void(unsigned int, unsigned int)>&,
+            const CancellationToken*);
+};
+
+#endif
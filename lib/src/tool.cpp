@@ -8,14 +8,17 @@
 #include "cache.hpp"
 #include "camera.hpp"
 #include "dimension.hpp"
+#include "dynamic/mesh-intersection.hpp"
 #include "dynamic/mesh.hpp"
 #include "history.hpp"
 #include "intersection.hpp"
+#include "latency-profiler.hpp"
 #include "mesh.hpp"
 #include "mirror.hpp"
 #include "primitive/ray.hpp"
 #include "primitive/triangle.hpp"
 #include "scene.hpp"
+#include "sketch/mesh-intersection.hpp"
 #include "sketch/mesh.hpp"
 #include "state.hpp"
 #include "tool.hpp"
@@ -92,10 +95,6 @@ struct Tool::Impl
     const ViewPointingEvent eWithDelta (e, this->prevPointingEventPosition);
     ToolResponse            response = this->self->runPointingEvent (eWithDelta);
 
-    if (e.releaseEvent ())
-    {
-      this->state.scene ().sanitizeMeshes ();
-    }
     this->prevPointingEventPosition = e.position ();
     return response;
   }
@@ -115,6 +114,8 @@ struct Tool::Impl
 
   void updateGlWidget () { this->state.mainWindow ().glWidget ().update (); }
 
+  void updateGlWidgetOverlay () { this->state.mainWindow ().glWidget ().updateOverlay (); }
+
   ViewTwoColumnGrid& properties () const
   {
     return this->state.mainWindow ().toolPane ().properties ();
@@ -143,6 +144,11 @@ struct Tool::Impl
     this->state.history ().snapshotSketchMeshes (this->state.scene ());
   }
 
+  void snapshotDynamicMeshDeltas ()
+  {
+    this->state.history ().snapshotDynamicMeshDeltas (this->state.scene ());
+  }
+
   bool intersectsRecentDynamicMesh (const PrimRay& ray, Intersection& intersection) const
   {
     assert (this->state.history ().hasRecentDynamicMesh ());
@@ -157,6 +163,51 @@ struct Tool::Impl
     return this->intersectsRecentDynamicMesh (this->state.camera ().ray (pos), intersection);
   }
 
+  bool pickDynamicMeshes (const glm::ivec2& pos, glm::vec3& position)
+  {
+    bool isHit;
+    if (this->state.mainWindow ().glWidget ().pickDynamicMeshes (pos, isHit, position))
+    {
+      return isHit;
+    }
+
+    DynamicMeshIntersection intersection;
+    if (this->intersectsScene (pos, intersection))
+    {
+      position = intersection.position ();
+      return true;
+    }
+    return false;
+  }
+
+  // the depth buffer only covers dynamic meshes, so sketch meshes are still intersected
+  bool pickScene (const glm::ivec2& pos, glm::vec3& position)
+  {
+    bool isHit;
+    if (this->state.mainWindow ().glWidget ().pickDynamicMeshes (pos, isHit, position))
+    {
+      const glm::vec3        eye = this->state.camera ().position ();
+      SketchMeshIntersection intersection;
+
+      if (this->intersectsScene (pos, intersection) &&
+          (isHit == false ||
+           glm::distance (eye, intersection.position ()) < glm::distance (eye, position)))
+      {
+        position = intersection.position ();
+        return true;
+      }
+      return isHit;
+    }
+
+    Intersection intersection;
+    if (this->intersectsScene (pos, intersection))
+    {
+      position = intersection.position ();
+      return true;
+    }
+    return false;
+  }
+
   void supportsMirror ()
   {
     assert (bool(this->_mirror) == false);
@@ -241,7 +292,7 @@ struct Tool::Impl
     ViewUtil::connect (*this->mirrorCheckBox, [this](bool m) {
       this->state.cache ().set ("editor/tool/mirror", m);
       this->mirrorSyncButton->setEnabled (m);
-      this->updateGlWidget ();
+      this->updateGlWidgetOverlay ();
     });
 
     this->mirrorSyncButton = &ViewUtil::pushButton (QObject::tr ("Sync"));
@@ -301,6 +352,7 @@ struct Tool::Impl
   template <typename T, typename... Ts>
   bool intersectsScene (const PrimRay& ray, T& intersection, Ts... args)
   {
+    LatencyTimer timer (LatencyStage::Intersection);
     return this->state.scene ().intersects (ray, intersection, std::forward<Ts> (args)...);
   }
 
@@ -346,6 +398,7 @@ DELEGATE (ToolResponse, Tool, commit)
 DELEGATE (void, Tool, fromConfig)
 GETTER_CONST (State&, Tool, state)
 DELEGATE (void, Tool, updateGlWidget)
+DELEGATE (void, Tool, updateGlWidgetOverlay)
 DELEGATE_CONST (ViewTwoColumnGrid&, Tool, properties)
 DELEGATE_CONST (Config&, Tool, config)
 DELEGATE (CacheProxy&, Tool, cache)
@@ -354,8 +407,11 @@ DELEGATE_CONST (glm::ivec2, Tool, cursorPosition)
 DELEGATE (void, Tool, snapshotAll)
 DELEGATE (void, Tool, snapshotDynamicMeshes)
 DELEGATE (void, Tool, snapshotSketchMeshes)
+DELEGATE (void, Tool, snapshotDynamicMeshDeltas)
 DELEGATE2_CONST (bool, Tool, intersectsRecentDynamicMesh, const PrimRay&, Intersection&)
 DELEGATE2_CONST (bool, Tool, intersectsRecentDynamicMesh, const glm::ivec2&, Intersection&)
+DELEGATE2 (bool, Tool, pickDynamicMeshes, const glm::ivec2&, glm::vec3&)
+DELEGATE2 (bool, Tool, pickScene, const glm::ivec2&, glm::vec3&)
 DELEGATE (void, Tool, supportsMirror)
 DELEGATE_CONST (bool, Tool, mirrorEnabled)
 DELEGATE1 (void, Tool, mirrorPosition, const glm::vec3&)
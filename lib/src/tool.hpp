@@ -29,7 +29,8 @@ enum class ToolResponse
 {
   None,
   Terminate,
-  Redraw
+  Redraw,
+  RedrawOverlay
 };
 
 class Tool
@@ -51,6 +52,7 @@ public:
 protected:
   State&             state () const;
   void               updateGlWidget ();
+  void               updateGlWidgetOverlay ();
   ViewTwoColumnGrid& properties () const;
   Config&            config () const;
   CacheProxy&        cache ();
@@ -59,8 +61,13 @@ protected:
   void               snapshotAll ();
   void               snapshotDynamicMeshes ();
   void               snapshotSketchMeshes ();
+  void               snapshotDynamicMeshDeltas ();
   bool               intersectsRecentDynamicMesh (const PrimRay&, Intersection&) const;
   bool               intersectsRecentDynamicMesh (const glm::ivec2&, Intersection&) const;
+  // yields the position of the dynamic mesh under a point, which is picked on the GPU if possible
+  bool               pickDynamicMeshes (const glm::ivec2&, glm::vec3&);
+  // same as `pickDynamicMeshes` but also yields positions of sketch meshes
+  bool               pickScene (const glm::ivec2&, glm::vec3&);
   void               supportsMirror ();
   bool               mirrorEnabled () const;
   void               mirrorPosition (const glm::vec3&);
@@ -0,0 +1,265 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QCheckBox>
+#include <QPushButton>
+#include "cache.hpp"
+#include "camera.hpp"
+#include "config.hpp"
+#include "dynamic/mesh-intersection.hpp"
+#include "dynamic/mesh.hpp"
+#include "intersection.hpp"
+#include "primitive/ray.hpp"
+#include "primitive/sphere.hpp"
+#include "scene.hpp"
+#include "state.hpp"
+#include "tool/sculpt/util/action.hpp"
+#include "tool/util/clay-volume.hpp"
+#include "tool/util/step.hpp"
+#include "tools.hpp"
+#include "view/cursor.hpp"
+#include "view/double-slider.hpp"
+#include "view/info-pane.hpp"
+#include "view/info-pane/scene.hpp"
+#include "view/main-window.hpp"
+#include "view/pointing-event.hpp"
+#include "view/resolution-slider.hpp"
+#include "view/tool-tip.hpp"
+#include "view/two-column-grid.hpp"
+#include "view/util.hpp"
+
+struct ToolClay::Impl
+{
+  ToolClay*          self;
+  ViewCursor         cursor;
+  ViewDoubleSlider&  radiusEdit;
+  float              resolution;
+  bool               subtract;
+  float              stepWidthFactor;
+  ToolUtilStep       step;
+  ToolUtilClayVolume volume;
+  bool               isSubtracting;
+
+  Impl (ToolClay* s)
+    : self (s)
+    , radiusEdit (ViewUtil::slider (2, 0.01f, s->cache ().get<float> ("radius", 0.2f), 1.0f))
+    , resolution (s->cache ().get<float> ("resolution", 0.04f))
+    , subtract (s->cache ().get<bool> ("subtract", false))
+    , stepWidthFactor (0.0f)
+    , isSubtracting (false)
+  {
+  }
+
+  void setupProperties ()
+  {
+    ViewTwoColumnGrid& properties = this->self->properties ();
+
+    ViewUtil::connect (this->radiusEdit, [this](float r) {
+      this->cursor.radius (r);
+      this->self->cache ().set ("radius", r);
+    });
+    properties.addStacked (QObject::tr ("Radius"), this->radiusEdit);
+
+    ViewResolutionSlider& resolutionEdit =
+      ViewUtil::resolutionSlider (0.01f, this->resolution, 0.1f);
+    ViewUtil::connect (resolutionEdit, [this](float r) {
+      this->resolution = r;
+      this->self->cache ().set ("resolution", r);
+    });
+    properties.addStacked (QObject::tr ("Resolution"), resolutionEdit);
+
+    QCheckBox& subtractEdit = ViewUtil::checkBox (QObject::tr ("Subtract"), this->subtract);
+    ViewUtil::connect (subtractEdit, [this](bool s) {
+      this->subtract = s;
+      this->self->cache ().set ("subtract", s);
+    });
+    properties.add (subtractEdit);
+
+    properties.add (ViewUtil::horizontalLine ());
+
+    QPushButton& convertButton = ViewUtil::pushButton (QObject::tr ("Convert to mesh"));
+    ViewUtil::connect (convertButton, [this]() {
+      this->convert ();
+      this->self->updateGlWidget ();
+    });
+    properties.add (convertButton);
+  }
+
+  void setupToolTip ()
+  {
+    ViewToolTip toolTip;
+    toolTip.add (ViewInputEvent::MouseLeft, QObject::tr ("Drag to add clay"));
+    toolTip.add (ViewInputEvent::MouseLeft, ViewInputModifier::Shift,
+                 QObject::tr ("Drag to remove clay"));
+    toolTip.add (ViewInputEvent::R, QObject::tr ("Move to change radius"));
+    this->self->state ().setToolTip (&toolTip);
+  }
+
+  void setupCursor ()
+  {
+    this->cursor.disable ();
+    this->cursor.radius (this->radiusEdit.doubleValue ());
+  }
+
+  ToolResponse runInitialize ()
+  {
+    this->setupProperties ();
+    this->setupToolTip ();
+    this->setupCursor ();
+
+    return ToolResponse::None;
+  }
+
+  void runRender () const
+  {
+    Camera& camera = this->self->state ().camera ();
+
+    this->volume.render (camera);
+
+    if (this->cursor.isEnabled ())
+    {
+      this->cursor.render (camera);
+    }
+  }
+
+  void dab (const glm::vec3& position)
+  {
+    this->volume.dab (PrimSphere (position, this->radiusEdit.doubleValue ()),
+                      this->isSubtracting);
+  }
+
+  bool intersectsVolume (const glm::ivec2& pos, Intersection& intersection) const
+  {
+    const PrimRay ray = this->self->state ().camera ().ray (pos);
+    return this->volume.intersects (ray, intersection);
+  }
+
+  ToolResponse runMoveEvent (const ViewPointingEvent& e)
+  {
+    this->step.stepWidth (this->radiusEdit.doubleValue () * this->stepWidthFactor);
+
+    if (e.leftButton () && this->volume.isEmpty () == false)
+    {
+      Intersection intersection;
+      if (this->intersectsVolume (e.position (), intersection))
+      {
+        this->cursor.enable ();
+        this->cursor.position (intersection.position ());
+
+        this->step.step (intersection.position (), [this](const glm::vec3& position) {
+          this->dab (position);
+          return true;
+        });
+      }
+      return ToolResponse::Redraw;
+    }
+    else
+    {
+      if (this->self->onKeymap ('r'))
+      {
+        this->radiusEdit.setIntValue (this->radiusEdit.intValue () + e.delta ().x);
+      }
+      return this->runCursorUpdate (e.position ());
+    }
+  }
+
+  /* Pressing a mesh of the scene outside of the volume converts the volume and replaces the
+   * pressed mesh by a new volume.
+   */
+  ToolResponse runPressEvent (const ViewPointingEvent& e)
+  {
+    if (e.leftButton () == false)
+    {
+      return ToolResponse::None;
+    }
+    this->isSubtracting = this->subtract != (e.modifiers () == Qt::ShiftModifier);
+
+    Intersection intersection;
+    if (this->intersectsVolume (e.position (), intersection) == false)
+    {
+      DynamicMeshIntersection meshIntersection;
+      if (this->self->intersectsScene (e, meshIntersection) == false)
+      {
+        this->cursor.disable ();
+        return ToolResponse::None;
+      }
+      this->convert ();
+      this->self->snapshotDynamicMeshes ();
+
+      this->volume.fromMesh (meshIntersection.mesh (), this->resolution);
+      this->self->state ().scene ().deleteMesh (meshIntersection.mesh ());
+      this->self->state ().mainWindow ().infoPane ().scene ().updateInfo ();
+
+      intersection.update (meshIntersection.distance (), meshIntersection.position (),
+                           meshIntersection.normal ());
+    }
+    this->cursor.enable ();
+    this->cursor.position (intersection.position ());
+    this->step.position (intersection.position ());
+    this->dab (intersection.position ());
+
+    return ToolResponse::Redraw;
+  }
+
+  ToolResponse runCursorUpdate (const glm::ivec2& pos)
+  {
+    const unsigned int      cursorRevision = this->cursor.revision ();
+    Intersection            intersection;
+    DynamicMeshIntersection meshIntersection;
+
+    if (this->intersectsVolume (pos, intersection))
+    {
+      this->cursor.enable ();
+      this->cursor.position (intersection.position ());
+    }
+    else if (this->self->intersectsScene (pos, meshIntersection))
+    {
+      this->cursor.enable ();
+      this->cursor.position (meshIntersection.position ());
+    }
+    else
+    {
+      this->cursor.disable ();
+    }
+    return cursorRevision == this->cursor.revision () ? ToolResponse::None
+                                                      : ToolResponse::RedrawOverlay;
+  }
+
+  // the surface of the volume is relaxed like a remeshed mesh, cf. `ToolSculptAction::smoothMesh`
+  void convert ()
+  {
+    if (this->volume.isEmpty () == false)
+    {
+      State&       state = this->self->state ();
+      DynamicMesh& mesh =
+        state.scene ().newDynamicMesh (state.config (), std::move (this->volume.surface ()));
+
+      ToolSculptAction::smoothMesh (mesh);
+      this->volume.reset ();
+      state.mainWindow ().infoPane ().scene ().updateInfo ();
+    }
+  }
+
+  ToolResponse runCommit ()
+  {
+    this->convert ();
+    return ToolResponse::Redraw;
+  }
+
+  void runFromConfig ()
+  {
+    const Config& config = this->self->config ();
+
+    this->cursor.color (config.get<Color> ("editor/tool/cursor-color"));
+    this->stepWidthFactor = config.get<float> ("editor/tool/clay/step-width-factor");
+  }
+};
+
+DELEGATE_TOOL (ToolClay)
+DELEGATE_TOOL_RUN_RENDER (ToolClay)
+DELEGATE_TOOL_RUN_MOVE_EVENT (ToolClay)
+DELEGATE_TOOL_RUN_PRESS_EVENT (ToolClay)
+DELEGATE_TOOL_RUN_CURSOR_UPDATE (ToolClay)
+DELEGATE_TOOL_RUN_COMMIT (ToolClay)
+DELEGATE_TOOL_RUN_FROM_CONFIG (ToolClay)
@@ -3,20 +3,25 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <QCheckBox>
+#include <QPainter>
+#include <QSpinBox>
+#include <memory>
 #include "cache.hpp"
-#include "distance.hpp"
+#include "dimension.hpp"
 #include "dynamic/mesh.hpp"
 #include "isosurface-extraction.hpp"
 #include "mesh.hpp"
 #include "primitive/aabox.hpp"
-#include "primitive/cone-sphere.hpp"
+#include "primitive/plane.hpp"
 #include "scene.hpp"
+#include "sketch/distance-field.hpp"
 #include "sketch/mesh-intersection.hpp"
 #include "sketch/mesh.hpp"
-#include "sketch/path.hpp"
 #include "state.hpp"
 #include "tool/sculpt/util/action.hpp"
+#include "tool/util/refinement.hpp"
 #include "tools.hpp"
+#include "view/main-window.hpp"
 #include "view/pointing-event.hpp"
 #include "view/resolution-slider.hpp"
 #include "view/tool-tip.hpp"
@@ -25,6 +30,12 @@
 
 namespace
 {
+  // maximal edge length in flat regions of adaptive meshes relative to the resolution
+  constexpr float adaptiveEdgeLength = 4.0f;
+
+  // resolution of previews relative to the resolution of progressive conversions
+  constexpr float previewResolution = 4.0f;
+
   glm::vec3 computeCenter (const SketchMesh& mesh)
   {
     if (mesh.tree ().hasRoot ())
@@ -44,12 +55,25 @@ struct ToolConvertSketch::Impl
 {
   ToolConvertSketch* self;
   float              resolution;
+  bool               faceBudget;
+  unsigned int       numFaces;
   bool               moveToCenter;
+  bool               adaptive;
+  bool               progressive;
+  bool               symmetric;
+  ToolUtilRefinement refinement;
 
   Impl (ToolConvertSketch* s)
     : self (s)
     , resolution (s->cache ().get<float> ("resolution", 0.06))
+    , faceBudget (s->cache ().get<bool> ("face-budget", false))
+    , numFaces (s->cache ().get<int> ("num-faces", 100000))
     , moveToCenter (s->cache ().get<bool> ("move-to-center", true))
+    , adaptive (s->cache ().get<bool> ("adaptive", false))
+    , progressive (s->cache ().get<bool> ("progressive", false))
+    , symmetric (s->cache ().get<bool> ("symmetric", false))
+    , refinement (s->state ().mainWindow ().infoPane (),
+                  [this]() { this->self->updateGlWidget (); })
   {
   }
 
@@ -73,6 +97,23 @@ struct ToolConvertSketch::Impl
     });
     properties.addStacked (QObject::tr ("Resolution"), resolutionEdit);
 
+    QCheckBox& faceBudgetEdit = ViewUtil::checkBox (QObject::tr ("Face budget"), this->faceBudget);
+    QSpinBox&  numFacesEdit = ViewUtil::spinBox (1000, int(this->numFaces), 10000000, 1000);
+    ViewUtil::connect (faceBudgetEdit, [this, &resolutionEdit, &numFacesEdit](bool b) {
+      this->faceBudget = b;
+      this->self->cache ().set ("face-budget", b);
+      resolutionEdit.setEnabled (b == false);
+      numFacesEdit.setEnabled (b);
+    });
+    ViewUtil::connect (numFacesEdit, [this](int n) {
+      this->numFaces = (unsigned int) (n);
+      this->self->cache ().set ("num-faces", n);
+    });
+    resolutionEdit.setEnabled (this->faceBudget == false);
+    numFacesEdit.setEnabled (this->faceBudget);
+    properties.add (faceBudgetEdit);
+    properties.add (QObject::tr ("Faces"), numFacesEdit);
+
     QCheckBox& moveToCenterEdit =
       ViewUtil::checkBox (QObject::tr ("Move to center"), this->moveToCenter);
     ViewUtil::connect (moveToCenterEdit, [this](bool m) {
@@ -80,6 +121,29 @@ struct ToolConvertSketch::Impl
       this->self->cache ().set ("move-to-center", m);
     });
     properties.add (moveToCenterEdit);
+
+    QCheckBox& adaptiveEdit =
+      ViewUtil::checkBox (QObject::tr ("Coarsen flat regions"), this->adaptive);
+    ViewUtil::connect (adaptiveEdit, [this](bool a) {
+      this->adaptive = a;
+      this->self->cache ().set ("adaptive", a);
+    });
+    properties.add (adaptiveEdit);
+
+    QCheckBox& progressiveEdit =
+      ViewUtil::checkBox (QObject::tr ("Progressive"), this->progressive);
+    ViewUtil::connect (progressiveEdit, [this](bool p) {
+      this->progressive = p;
+      this->self->cache ().set ("progressive", p);
+    });
+    properties.add (progressiveEdit);
+
+    QCheckBox& symmetricEdit = ViewUtil::checkBox (QObject::tr ("Symmetric"), this->symmetric);
+    ViewUtil::connect (symmetricEdit, [this](bool s) {
+      this->symmetric = s;
+      this->self->cache ().set ("symmetric", s);
+    });
+    properties.add (symmetricEdit);
   }
 
   void setupToolTip ()
@@ -89,71 +153,126 @@ struct ToolConvertSketch::Impl
     this->self->state ().setToolTip (&toolTip);
   }
 
-  DynamicMesh& convert (SketchMesh& sketch)
+  DynamicMesh& addMesh (DynamicMesh&& mesh, const glm::vec3& center, float resolution)
   {
+    State&       state = this->self->state ();
+    DynamicMesh& dMesh = state.scene ().newDynamicMesh (state.config (), std::move (mesh));
+
+    if (this->adaptive)
+    {
+      ToolSculptAction::coarsenMesh (dMesh, adaptiveEdgeLength * resolution);
+    }
+    if (this->moveToCenter)
+    {
+      dMesh.translate (-center);
+      dMesh.normalize ();
+      dMesh.bufferData ();
+    }
+    ToolSculptAction::smoothMesh (dMesh);
+    return dMesh;
+  }
+
+  /* Replaces `sketch` by its isosurface.  When converting progressively, a preview is extracted
+   * at a coarser resolution and replaced by the result once the background refinement has
+   * finished.  If the conversion aims at a number of faces, the resolution is estimated from the
+   * area of a coarse extraction (cf. `IsosurfaceExtraction::resolutionForFaces`).  Symmetric
+   * sketches are extracted at the plane through their root, cf. `SketchMesh::mirror`.
+   */
+  void convert (SketchMesh& sketch)
+  {
+    const glm::vec3 center = computeCenter (sketch);
+    float           resolution = this->resolution;
+
     glm::vec3 min, max;
     sketch.minMax (min, max);
 
-    const IsosurfaceExtraction::DistanceCallback getDistance = [&sketch](const glm::vec3& pos) {
-      float distance = Util::maxFloat ();
+    sketch.optimizePaths ();
 
-      if (sketch.tree ().hasRoot ())
-      {
-        sketch.tree ().root ().forEachConstNode ([&pos, &distance](const SketchNode& node) {
-          const float d =
-            node.parent ()
-              ? Distance::distance (PrimConeSphere (node.data (), node.parent ()->data ()), pos)
-              : Distance::distance (node.data (), pos);
+    const std::shared_ptr<const SketchDistanceField> distanceField =
+      std::make_shared<const SketchDistanceField> (sketch);
+    const PrimAABox bounds (min, max);
+    const PrimPlane plane = sketch.mirrorPlane (Dimension::X);
+    const bool      symmetric = this->symmetric;
 
-          distance = glm::min (distance, d);
-        });
+    const auto extract = [distanceField, bounds, plane,
+                          symmetric](float resolution, DynamicMesh& mesh,
+                                     const IsosurfaceExtraction::ProgressCallback& p,
+                                     const CancellationToken*                      token) {
+      const IsosurfaceExtraction::DistanceCallback getDistance =
+        [distanceField](const glm::vec3& pos, float upperBound) {
+          return distanceField->distance (pos, upperBound);
+        };
+      if (symmetric)
+      {
+        return IsosurfaceExtraction::extractSymmetric (getDistance, bounds, resolution, plane,
+                                                       mesh, p, token);
       }
-      for (const SketchPath& p : sketch.paths ())
+      else
       {
-        for (const PrimSphere& s : p.spheres ())
-        {
-          distance = glm::min (distance, Distance::distance (s, pos));
-        }
+        return IsosurfaceExtraction::extract (getDistance, bounds, resolution, mesh, p, token);
       }
-      return distance;
     };
 
-    sketch.optimizePaths ();
-    DynamicMesh mesh;
-    IsosurfaceExtraction::extract (getDistance, PrimAABox (min, max), this->resolution, mesh);
+    if (this->faceBudget)
+    {
+      IsosurfaceExtraction::resolutionForFaces (
+        [&extract](float r, DynamicMesh& mesh) { return extract (r, mesh, nullptr, nullptr); },
+        bounds, this->numFaces, resolution);
+    }
+
+    DynamicMesh extractedMesh;
+    extract (this->progressive ? previewResolution * resolution : resolution, extractedMesh,
+             nullptr, nullptr);
 
-    State& state = this->self->state ();
-    return state.scene ().newDynamicMesh (state.config (), mesh);
+    this->self->state ().scene ().deleteMesh (sketch);
+    DynamicMesh* preview = &this->addMesh (std::move (extractedMesh), center, resolution);
+
+    if (this->progressive)
+    {
+      this->refinement.run (
+        QObject::tr ("Refining"),
+        [extract, resolution](DynamicMesh& mesh, const IsosurfaceExtraction::ProgressCallback& p,
+                              const CancellationToken& token) {
+          return extract (resolution, mesh, p, &token);
+        },
+        [this, preview, center, resolution](DynamicMesh& mesh) {
+          this->self->state ().scene ().deleteMesh (*preview);
+          this->addMesh (std::move (mesh), center, resolution);
+        });
+    }
   }
 
   ToolResponse runReleaseEvent (const ViewPointingEvent& e)
   {
+    this->refinement.cancel ();
+
     if (e.leftButton ())
     {
       SketchMeshIntersection intersection;
       if (this->self->intersectsScene (e, intersection))
       {
-        SketchMesh& sMesh = intersection.mesh ();
-        glm::vec3   center = computeCenter (sMesh);
-
         this->self->snapshotAll ();
-
-        DynamicMesh& dMesh = this->convert (sMesh);
-
-        if (this->moveToCenter)
-        {
-          dMesh.translate (-center);
-          dMesh.normalize ();
-          dMesh.bufferData ();
-        }
-        ToolSculptAction::smoothMesh (dMesh);
-        this->self->state ().scene ().deleteMesh (sMesh);
+        this->convert (intersection.mesh ());
         return ToolResponse::Redraw;
       }
     }
     return ToolResponse::None;
   }
+
+  void runPaint (QPainter& painter) const
+  {
+    this->refinement.paint (painter, this->self->cursorPosition ());
+  }
+
+  // accepts the current preview
+  ToolResponse runCommit ()
+  {
+    this->refinement.cancel ();
+    return ToolResponse::Redraw;
+  }
 };
 
 DELEGATE_TOOL (ToolConvertSketch)
 DELEGATE_TOOL_RUN_RELEASE_EVENT (ToolConvertSketch)
+DELEGATE_TOOL_RUN_PAINT (ToolConvertSketch)
+DELEGATE_TOOL_RUN_COMMIT (ToolConvertSketch)
@@ -0,0 +1,131 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QObject>
+#include <QSlider>
+#include <memory>
+#include "cache.hpp"
+#include "dynamic/mesh-intersection.hpp"
+#include "dynamic/mesh.hpp"
+#include "mesh.hpp"
+#include "scene.hpp"
+#include "state.hpp"
+#include "tool/sculpt/util/action.hpp"
+#include "tool/util/refinement.hpp"
+#include "tools.hpp"
+#include "view/info-pane.hpp"
+#include "view/info-pane/scene.hpp"
+#include "view/main-window.hpp"
+#include "view/pointing-event.hpp"
+#include "view/tool-tip.hpp"
+#include "view/two-column-grid.hpp"
+#include "view/util.hpp"
+
+struct ToolDecimate::Impl
+{
+  ToolDecimate*      self;
+  int                percentage;
+  ToolUtilRefinement refinement;
+
+  Impl (ToolDecimate* s)
+    : self (s)
+    , percentage (s->cache ().get<int> ("percentage", 50))
+    , refinement (s->state ().mainWindow ().infoPane (),
+                  [this]() { this->self->updateGlWidget (); })
+  {
+  }
+
+  ToolResponse runInitialize ()
+  {
+    ViewTwoColumnGrid& properties = this->self->properties ();
+
+    QSlider& percentageEdit = ViewUtil::slider (1, this->percentage, 99);
+    ViewUtil::connect (percentageEdit, [this](int p) {
+      this->percentage = p;
+      this->self->cache ().set ("percentage", p);
+    });
+    properties.addStacked (QObject::tr ("Remaining faces (%)"), percentageEdit);
+
+    ViewToolTip toolTip;
+    toolTip.add (ViewInputEvent::MouseLeft, QObject::tr ("Decimate selection"));
+    this->self->state ().setToolTip (&toolTip);
+
+    return ToolResponse::None;
+  }
+
+  /* Simplifies a copy of the selected mesh on a background thread.  The selected mesh stays in the
+   * scene until the result is done.
+   */
+  ToolResponse runReleaseEvent (const ViewPointingEvent& e)
+  {
+    if (e.leftButton ())
+    {
+      this->refinement.finish ();
+
+      DynamicMeshIntersection intersection;
+      if (this->self->intersectsScene (e, intersection))
+      {
+        DynamicMesh& mesh = intersection.mesh ();
+
+        this->self->snapshotDynamicMeshes ();
+        mesh.prune ();
+
+        const auto         copy = std::make_shared<DynamicMesh> (mesh);
+        const unsigned int maxFaces = (mesh.numFaces () * this->percentage) / 100;
+        DynamicMesh*       replaced = &mesh;
+
+        this->refinement.run (
+          QObject::tr ("Decimating"),
+          [copy, maxFaces](DynamicMesh& result, const IsosurfaceExtraction::ProgressCallback&,
+                           const CancellationToken& token) {
+            ToolSculptAction::simplifyMesh (*copy, maxFaces, token);
+            if (token.isCancelled ())
+            {
+              return false;
+            }
+            copy->prune ();
+
+            const Mesh& m = copy->mesh ();
+            for (unsigned int i = 0; i < m.numVertices (); i++)
+            {
+              result.addVertex (m.vertex (i), m.normal (i));
+            }
+            for (unsigned int i = 0; i < m.numIndices (); i += 3)
+            {
+              result.addFace (m.index (i), m.index (i + 1), m.index (i + 2));
+            }
+            return true;
+          },
+          [this, replaced](DynamicMesh& result) {
+            State& state = this->self->state ();
+
+            state.scene ().deleteMesh (*replaced);
+            if (result.isEmpty () == false)
+            {
+              state.scene ().newDynamicMesh (state.config (), std::move (result));
+            }
+            state.mainWindow ().infoPane ().scene ().updateInfo ();
+          });
+        return ToolResponse::Redraw;
+      }
+    }
+    return ToolResponse::None;
+  }
+
+  void runPaint (QPainter& painter) const
+  {
+    this->refinement.paint (painter, this->self->cursorPosition ());
+  }
+
+  ToolResponse runCommit ()
+  {
+    this->refinement.finish ();
+    return ToolResponse::Redraw;
+  }
+};
+
+DELEGATE_TOOL (ToolDecimate)
+DELEGATE_TOOL_RUN_RELEASE_EVENT (ToolDecimate)
+DELEGATE_TOOL_RUN_PAINT (ToolDecimate)
+DELEGATE_TOOL_RUN_COMMIT (ToolDecimate)
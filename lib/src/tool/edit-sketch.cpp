@@ -16,7 +16,9 @@
 #include "tool/util/movement.hpp"
 #include "tool/util/rotation.hpp"
 #include "tool/util/scaling.hpp"
+#include "tool/util/sketch-preview.hpp"
 #include "tools.hpp"
+#include "view/main-window.hpp"
 #include "view/pointing-event.hpp"
 #include "view/tool-tip.hpp"
 #include "view/two-column-grid.hpp"
@@ -24,17 +26,19 @@
 
 struct ToolEditSketch::Impl
 {
-  ToolEditSketch*  self;
-  SketchMesh*      mesh;
-  SketchNode*      node;
-  SketchNode*      parent;
-  ToolUtilMovement movement;
-  ToolUtilScaling  scaling;
-  ToolUtilRotation rotation;
-  bool             transformChildren;
-  bool             splitAndJoin;
-  bool             snap;
-  QSlider&         snapWidthEdit;
+  ToolEditSketch*       self;
+  SketchMesh*           mesh;
+  SketchNode*           node;
+  SketchNode*           parent;
+  ToolUtilMovement      movement;
+  ToolUtilScaling       scaling;
+  ToolUtilRotation      rotation;
+  bool                  transformChildren;
+  bool                  splitAndJoin;
+  bool                  snap;
+  QSlider&              snapWidthEdit;
+  bool                  showPreview;
+  ToolUtilSketchPreview preview;
 
   Impl (ToolEditSketch* s)
     : self (s)
@@ -48,6 +52,8 @@ struct ToolEditSketch::Impl
     , splitAndJoin (s->cache ().get<bool> ("split-and-join", false))
     , snap (s->cache ().get<bool> ("snap", true))
     , snapWidthEdit (ViewUtil::slider (1, s->cache ().get<int> ("snap-width", 5), 10))
+    , showPreview (s->cache ().get<bool> ("preview", false))
+    , preview (s->state ().mainWindow ().infoPane (), [this]() { this->self->updateGlWidget (); })
   {
   }
 
@@ -105,6 +111,15 @@ struct ToolEditSketch::Impl
       this->snapWidthEdit.setEnabled (not this->splitAndJoin);
       this->self->enableMirrorProperties (not this->splitAndJoin);
     });
+
+    QCheckBox& previewEdit = ViewUtil::checkBox (QObject::tr ("Preview"), this->showPreview);
+    ViewUtil::connect (previewEdit, [this](bool p) {
+      this->showPreview = p;
+      this->self->cache ().set ("preview", p);
+      this->preview.reset ();
+      this->self->updateGlWidget ();
+    });
+    properties.add (previewEdit);
   }
 
   void setupToolTip ()
@@ -122,6 +137,22 @@ struct ToolEditSketch::Impl
     this->self->state ().setToolTip (&toolTip);
   }
 
+  void updatePreview ()
+  {
+    if (this->showPreview && this->mesh)
+    {
+      this->preview.update (*this->mesh);
+    }
+  }
+
+  void runRender () const
+  {
+    if (this->showPreview)
+    {
+      this->preview.render (this->self->state ().camera ());
+    }
+  }
+
   ToolResponse runMoveEvent (const ViewPointingEvent& e)
   {
     if (e.leftButton () && this->node)
@@ -159,6 +190,7 @@ struct ToolEditSketch::Impl
         this->mesh->move (*this->node, this->movement.delta (), transformChildren,
                           this->self->mirrorDimension ());
       }
+      this->updatePreview ();
       return ToolResponse::Redraw;
     }
     else
@@ -256,11 +288,13 @@ struct ToolEditSketch::Impl
       if (this->self->intersectsScene (e, nodeIntersection))
       {
         handleNodeIntersection (nodeIntersection);
+        this->updatePreview ();
         return ToolResponse::Redraw;
       }
       else if (this->self->intersectsScene (e, boneIntersection))
       {
         handleBoneIntersection (boneIntersection);
+        this->updatePreview ();
         return ToolResponse::Redraw;
       }
       else if (e.modifiers () == Qt::NoModifier)
@@ -334,6 +368,7 @@ struct ToolEditSketch::Impl
         this->self->mirrorPosition (this->mesh->tree ().root ().data ().center ());
       }
     }
+    this->updatePreview ();
 
     this->mesh = nullptr;
     this->node = nullptr;
@@ -344,6 +379,7 @@ struct ToolEditSketch::Impl
 };
 
 DELEGATE_TOOL (ToolEditSketch)
+DELEGATE_TOOL_RUN_RENDER (ToolEditSketch)
 DELEGATE_TOOL_RUN_MOVE_EVENT (ToolEditSketch)
 DELEGATE_TOOL_RUN_PRESS_EVENT (ToolEditSketch)
 DELEGATE_TOOL_RUN_RELEASE_EVENT (ToolEditSketch)
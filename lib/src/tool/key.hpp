@@ -11,6 +11,8 @@ enum class ToolKey
 {
   TransformMesh,
   DeleteMesh,
+  SeparateMesh,
+  SubdivideMesh,
   NewMesh,
   SculptDraw,
   SculptGrab,
@@ -19,12 +21,15 @@ enum class ToolKey
   SculptCrease,
   SculptPinch,
   SculptReduce,
+  SculptMask,
   EditSketch,
   DeleteSketch,
   ConvertSketch,
   SketchSpheres,
   TrimMesh,
   Remesh,
+  Decimate,
+  Clay,
   MoveCamera
 };
 
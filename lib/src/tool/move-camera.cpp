@@ -3,11 +3,11 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <QWheelEvent>
+#include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 #include "camera.hpp"
 #include "config.hpp"
 #include "dimension.hpp"
-#include "intersection.hpp"
 #include "state.hpp"
 #include "tools.hpp"
 #include "view/floor-plane.hpp"
@@ -109,6 +109,7 @@ struct ToolMoveCamera::Impl
         this->self->state ().mainWindow ().glWidget ().floorPlane ().update (cam);
       }
       this->oldPos = e.position ();
+      this->self->state ().navigate ();
       return ToolResponse::Redraw;
     }
     else
@@ -122,11 +123,11 @@ struct ToolMoveCamera::Impl
   {
     if (this->mouseButton (e) && e.modifiers () == Qt::AltModifier)
     {
-      Intersection intersection;
-      if (this->self->intersectsScene (e.position (), intersection))
+      glm::vec3 position;
+      if (this->self->pickScene (e.position (), position))
       {
         Camera& camera = this->self->state ().camera ();
-        camera.set (intersection.position (), camera.position () - intersection.position ());
+        camera.set (position, camera.position () - position);
         return ToolResponse::Redraw;
       }
     }
@@ -158,6 +159,7 @@ struct ToolMoveCamera::Impl
         camera.stepAlongGaze (1.0f / this->zoomInMouseWheelFactor);
       }
       this->self->state ().mainWindow ().glWidget ().floorPlane ().update (camera);
+      this->self->state ().navigate ();
       return ToolResponse::Redraw;
     }
     return ToolResponse::None;
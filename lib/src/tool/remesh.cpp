@@ -2,21 +2,38 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <QCheckBox>
 #include <QPainter>
+#include <QPushButton>
+#include <QSpinBox>
+#include <functional>
+#include <memory>
+#include <vector>
 #include "cache.hpp"
 #include "color.hpp"
 #include "config.hpp"
+#include "dimension.hpp"
+#include "dynamic/faces.hpp"
+#include "dynamic/mesh-boolean.hpp"
+#include "dynamic/mesh-distance-field.hpp"
 #include "dynamic/mesh-intersection.hpp"
 #include "dynamic/mesh.hpp"
 #include "isosurface-extraction.hpp"
 #include "maybe.hpp"
 #include "mesh.hpp"
 #include "primitive/aabox.hpp"
-#include "primitive/ray.hpp"
+#include "primitive/plane.hpp"
+#include "primitive/triangle.hpp"
 #include "scene.hpp"
 #include "state.hpp"
+#include "thread-pool.hpp"
 #include "tool/sculpt/util/action.hpp"
+#include "tool/util/refinement.hpp"
 #include "tools.hpp"
+#include "util.hpp"
+#include "view/info-pane.hpp"
+#include "view/info-pane/scene.hpp"
+#include "view/main-window.hpp"
 #include "view/pointing-event.hpp"
 #include "view/resolution-slider.hpp"
 #include "view/tool-tip.hpp"
@@ -25,6 +42,9 @@
 
 namespace
 {
+  // maximal edge length in flat regions of adaptive meshes relative to the resolution
+  constexpr float adaptiveEdgeLength = 4.0f;
+
   enum class Mode
   {
     Normal,
@@ -32,19 +52,275 @@ namespace
     Difference,
     Intersection
   };
+
+  // resolution of previews relative to the resolution of progressive remeshing
+  constexpr float previewResolution = 4.0f;
+
+  // resolution of extractions whose vertices are reprojected, relative to the resolution
+  constexpr float reprojectedResolution = 2.0f;
+  // faces of reprojected meshes that deviate further from their sources are subdivided
+  constexpr float maxReprojectedDeviation = 0.5f;
+
+  typedef IsosurfaceExtraction::ProgressCallback ProgressCallback;
+  typedef std::function<bool(const std::vector<const DynamicMesh*>&, float, DynamicMesh&,
+                             const ProgressCallback&, const CancellationToken*)>
+    Extraction;
+
+  // maps the progress of a stage to the progress of all stages
+  ProgressCallback stageProgress (const ProgressCallback& progress, unsigned int stage,
+                                  unsigned int numStages)
+  {
+    if (progress)
+    {
+      return [progress, stage, numStages](float p) {
+        progress ((float(stage) + p) / float(numStages));
+      };
+    }
+    else
+    {
+      return nullptr;
+    }
+  }
+
+  /* Symmetric meshes are extracted at the plane of the sculpting mirror, cf.
+   * `IsosurfaceExtraction::extractSymmetric`.
+   */
+  bool extractMesh (const DynamicMesh& mesh, float resolution, bool symmetric,
+                    DynamicMesh& extractedMesh, const ProgressCallback& progress,
+                    const CancellationToken* token)
+  {
+    const std::shared_ptr<const DynamicMeshDistanceField> field =
+      DynamicMeshDistanceField::get (mesh, resolution, stageProgress (progress, 0, 2), token);
+
+    if (field == nullptr)
+    {
+      return false;
+    }
+
+    const IsosurfaceExtraction::DistanceCallback getDistance =
+      [&field](const glm::vec3& pos, float) { return field->distance (pos); };
+
+    if (symmetric)
+    {
+      const PrimPlane plane (glm::vec3 (0.0f), DimensionUtil::vector (Dimension::X));
+
+      return IsosurfaceExtraction::extractSymmetric (getDistance, mesh.bounds (), resolution,
+                                                     plane, extractedMesh,
+                                                     stageProgress (progress, 1, 2), token);
+    }
+    else
+    {
+      return IsosurfaceExtraction::extract (getDistance, mesh.bounds (), resolution,
+                                            extractedMesh, stageProgress (progress, 1, 2), token);
+    }
+  }
+
+  /* Moves the vertices of a mesh that has been extracted at a coarser resolution to their closest
+   * points on its source, which restores detail that is finer than the extraction.  Faces whose
+   * centers still deviate from the source by more than a fraction of the resolution are
+   * subdivided down to the resolution, and the vertices of the new faces are moved as well.
+   */
+  bool reprojectMesh (const DynamicMesh& source, float resolution, DynamicMesh& mesh,
+                      const CancellationToken* token)
+  {
+    const float               maxDistance = 2.0f * reprojectedResolution * resolution;
+    std::vector<unsigned int> vertices;
+    std::vector<glm::vec3>    points;
+
+    const auto project = [&source, &mesh, &vertices, &points, maxDistance]() {
+      points.clear ();
+      for (unsigned int i : vertices)
+      {
+        points.push_back (mesh.vertex (i));
+      }
+      source.closestPoints (points, maxDistance);
+
+      for (unsigned int k = 0; k < vertices.size (); k++)
+      {
+        mesh.vertex (vertices[k], points[k]);
+      }
+    };
+
+    mesh.forEachVertex ([&mesh, &vertices](unsigned int i) {
+      if (mesh.valence (i) > 0)
+      {
+        vertices.push_back (i);
+      }
+    });
+    project ();
+
+    if (token && token->isCancelled ())
+    {
+      return false;
+    }
+
+    std::vector<unsigned int> faceIndices;
+    std::vector<glm::vec3>    centers;
+
+    mesh.forEachFace ([&mesh, &faceIndices, &centers](unsigned int f) {
+      faceIndices.push_back (f);
+      centers.push_back (mesh.face (f).center ());
+    });
+    source.closestPoints (centers, maxDistance);
+
+    DynamicFaces faces;
+    for (unsigned int k = 0; k < faceIndices.size (); k++)
+    {
+      const float deviation = glm::distance (mesh.face (faceIndices[k]).center (), centers[k]);
+
+      if (deviation > maxReprojectedDeviation * resolution)
+      {
+        faces.insert (faceIndices[k]);
+      }
+    }
+    faces.commit ();
+
+    if (faces.numElements () > 0)
+    {
+      ToolSculptAction::subdivideFaces (mesh, resolution, faces);
+
+      vertices.clear ();
+      mesh.forEachVertex (faces, [&vertices](unsigned int i) { vertices.push_back (i); });
+      project ();
+    }
+    mesh.setAllNormals ();
+    mesh.realignAllFaces ();
+    return token == nullptr || token->isCancelled () == false;
+  }
+
+  /* Boolean operations combine the signed distance fields of both meshes, which are cached, such
+   * that trying different modes only resamples the fields.
+   */
+  bool extractMesh (const DynamicMesh& meshA, const DynamicMesh& meshB, Mode mode,
+                    float resolution, DynamicMesh& extractedMesh, const ProgressCallback& progress,
+                    const CancellationToken* token)
+  {
+    assert (mode != Mode::Normal);
+
+    const std::shared_ptr<const DynamicMeshDistanceField> fieldA =
+      DynamicMeshDistanceField::get (meshA, resolution, stageProgress (progress, 0, 3), token);
+    if (fieldA == nullptr)
+    {
+      return false;
+    }
+
+    const std::shared_ptr<const DynamicMeshDistanceField> fieldB =
+      DynamicMeshDistanceField::get (meshB, resolution, stageProgress (progress, 1, 3), token);
+    if (fieldB == nullptr)
+    {
+      return false;
+    }
+
+    const IsosurfaceExtraction::DistanceCallback getDistance =
+      [&fieldA, &fieldB, mode](const glm::vec3& pos, float) {
+        const float distanceA = fieldA->distance (pos);
+        const float distanceB = fieldB->distance (pos);
+
+        switch (mode)
+        {
+          case Mode::Union:
+            return glm::min (distanceA, distanceB);
+          case Mode::Difference:
+            return glm::max (distanceA, -distanceB);
+          case Mode::Intersection:
+            return glm::max (distanceA, distanceB);
+          default:
+            DILAY_IMPOSSIBLE
+        }
+      };
+
+    const PrimAABox boundsA = meshA.bounds ();
+    const PrimAABox boundsB = meshB.bounds ();
+    const glm::vec3 min = glm::min (boundsA.minimum (), boundsB.minimum ());
+    const glm::vec3 max = glm::max (boundsA.maximum (), boundsB.maximum ());
+
+    return IsosurfaceExtraction::extract (getDistance, PrimAABox (min, max), resolution,
+                                          extractedMesh, stageProgress (progress, 2, 3), token);
+  }
+
+  /* Unions and intersections of several meshes combine the fields of all meshes in a single
+   * extraction, which only evaluates the fields that are near each sample.
+   */
+  bool extractMesh (const std::vector<const DynamicMesh*>& meshes, Mode mode, float resolution,
+                    DynamicMesh& extractedMesh, const ProgressCallback& progress,
+                    const CancellationToken* token)
+  {
+    assert (mode == Mode::Union || mode == Mode::Intersection);
+
+    const unsigned int numStages = meshes.size () + 1;
+
+    std::vector<std::shared_ptr<const DynamicMeshDistanceField>> fields;
+    for (unsigned int i = 0; i < meshes.size (); i++)
+    {
+      fields.push_back (DynamicMeshDistanceField::get (*meshes[i], resolution,
+                                                       stageProgress (progress, i, numStages),
+                                                       token));
+      if (fields.back () == nullptr)
+      {
+        return false;
+      }
+    }
+
+    const DynamicMeshDistanceFields combinedFields (
+      fields, mode == Mode::Union ? DynamicMeshDistanceFields::Operation::Union
+                                  : DynamicMeshDistanceFields::Operation::Intersection);
+
+    const IsosurfaceExtraction::DistanceCallback getDistance =
+      [&combinedFields](const glm::vec3& pos, float) { return combinedFields.distance (pos); };
+
+    return IsosurfaceExtraction::extract (getDistance, combinedFields.bounds (), resolution,
+                                          extractedMesh,
+                                          stageProgress (progress, meshes.size (), numStages),
+                                          token);
+  }
+
+  DynamicMeshBoolean::Operation booleanOperation (Mode mode)
+  {
+    switch (mode)
+    {
+      case Mode::Union:
+        return DynamicMeshBoolean::Operation::Union;
+      case Mode::Difference:
+        return DynamicMeshBoolean::Operation::Difference;
+      case Mode::Intersection:
+        return DynamicMeshBoolean::Operation::Intersection;
+      default:
+        DILAY_IMPOSSIBLE
+    }
+  }
 }
 
 struct ToolRemesh::Impl
 {
-  ToolRemesh*       self;
-  float             resolution;
-  Mode              mode;
-  Maybe<glm::ivec2> pressPoint;
+  ToolRemesh*             self;
+  float                   resolution;
+  bool                    faceBudget;
+  unsigned int            numFaces;
+  Mode                    mode;
+  bool                    adaptive;
+  bool                    progressive;
+  bool                    symmetric;
+  bool                    exact;
+  bool                    reproject;
+  InlineMaybe<glm::ivec2> pressPoint;
+  ToolUtilRefinement      refinement;
+  bool                    hasPreview;
+  Color                   onScreenColor;
 
   Impl (ToolRemesh* s)
     : self (s)
     , resolution (s->cache ().get<float> ("resolution", 0.06))
+    , faceBudget (s->cache ().get<bool> ("face-budget", false))
+    , numFaces (s->cache ().get<int> ("num-faces", 100000))
     , mode (Mode (s->cache ().get<int> ("mode", int(Mode::Normal))))
+    , adaptive (s->cache ().get<bool> ("adaptive", false))
+    , progressive (s->cache ().get<bool> ("progressive", false))
+    , symmetric (s->cache ().get<bool> ("symmetric", false))
+    , exact (s->cache ().get<bool> ("exact", true))
+    , reproject (s->cache ().get<bool> ("reproject", false))
+    , refinement (s->state ().mainWindow ().infoPane (),
+                  [this]() { this->self->updateGlWidget (); })
+    , hasPreview (false)
   {
   }
 
@@ -55,12 +331,19 @@ struct ToolRemesh::Impl
     QButtonGroup& modeEdit =
       ViewUtil::buttonGroup ({QObject::tr ("Normal"), QObject::tr ("Union"),
                               QObject::tr ("Difference"), QObject::tr ("Intersection")});
-    ViewUtil::connect (modeEdit, int(this->mode), [this](int id) {
+    QPushButton& combineAllButton = ViewUtil::pushButton (QObject::tr ("Combine all meshes"));
+
+    ViewUtil::connect (modeEdit, int(this->mode), [this, &combineAllButton](int id) {
       this->mode = Mode (id);
       this->self->cache ().set ("mode", id);
+      combineAllButton.setEnabled (this->canCombineAll ());
     });
     properties.add (modeEdit);
 
+    ViewUtil::connect (combineAllButton, [this]() { this->combineAll (); });
+    combineAllButton.setEnabled (this->canCombineAll ());
+    properties.add (combineAllButton);
+
     ViewResolutionSlider& resolutionEdit =
       ViewUtil::resolutionSlider (0.02f, this->resolution, 0.1f);
     ViewUtil::connect (resolutionEdit, [this](float r) {
@@ -68,6 +351,70 @@ struct ToolRemesh::Impl
       this->self->cache ().set ("resolution", r);
     });
     properties.addStacked (QObject::tr ("Resolution"), resolutionEdit);
+
+    QCheckBox& faceBudgetEdit = ViewUtil::checkBox (QObject::tr ("Face budget"), this->faceBudget);
+    QSpinBox&  numFacesEdit = ViewUtil::spinBox (1000, int(this->numFaces), 10000000, 1000);
+    ViewUtil::connect (faceBudgetEdit, [this, &resolutionEdit, &numFacesEdit](bool b) {
+      this->faceBudget = b;
+      this->self->cache ().set ("face-budget", b);
+      resolutionEdit.setEnabled (b == false);
+      numFacesEdit.setEnabled (b);
+    });
+    ViewUtil::connect (numFacesEdit, [this](int n) {
+      this->numFaces = (unsigned int) (n);
+      this->self->cache ().set ("num-faces", n);
+    });
+    resolutionEdit.setEnabled (this->faceBudget == false);
+    numFacesEdit.setEnabled (this->faceBudget);
+    properties.add (faceBudgetEdit);
+    properties.add (QObject::tr ("Faces"), numFacesEdit);
+
+    QCheckBox& adaptiveEdit =
+      ViewUtil::checkBox (QObject::tr ("Coarsen flat regions"), this->adaptive);
+    ViewUtil::connect (adaptiveEdit, [this](bool a) {
+      this->adaptive = a;
+      this->self->cache ().set ("adaptive", a);
+    });
+    properties.add (adaptiveEdit);
+
+    QCheckBox& progressiveEdit =
+      ViewUtil::checkBox (QObject::tr ("Progressive"), this->progressive);
+    ViewUtil::connect (progressiveEdit, [this](bool p) {
+      this->progressive = p;
+      this->self->cache ().set ("progressive", p);
+    });
+    properties.add (progressiveEdit);
+
+    QCheckBox& symmetricEdit = ViewUtil::checkBox (QObject::tr ("Symmetric"), this->symmetric);
+    ViewUtil::connect (symmetricEdit, [this](bool s) {
+      this->symmetric = s;
+      this->self->cache ().set ("symmetric", s);
+    });
+    properties.add (symmetricEdit);
+
+    QCheckBox& reprojectEdit =
+      ViewUtil::checkBox (QObject::tr ("Reproject detail"), this->reproject);
+    ViewUtil::connect (reprojectEdit, [this](bool r) {
+      this->reproject = r;
+      this->self->cache ().set ("reproject", r);
+    });
+    properties.add (reprojectEdit);
+
+    QCheckBox& exactEdit = ViewUtil::checkBox (QObject::tr ("Exact booleans"), this->exact);
+    ViewUtil::connect (exactEdit, [this](bool e) {
+      this->exact = e;
+      this->self->cache ().set ("exact", e);
+    });
+    properties.add (exactEdit);
+  }
+
+  void finalizeMesh (DynamicMesh& mesh, float resolution) const
+  {
+    if (this->adaptive)
+    {
+      ToolSculptAction::coarsenMesh (mesh, adaptiveEdgeLength * resolution);
+    }
+    ToolSculptAction::smoothMesh (mesh);
   }
 
   void setupToolTip ()
@@ -90,246 +437,224 @@ struct ToolRemesh::Impl
     return this->mode == Mode::Normal ? ToolResponse::None : ToolResponse::Redraw;
   }
 
-  void remesh (DynamicMesh& mesh)
+  // exact results keep the faces of their sources and are thus not finalized
+  DynamicMesh& addMesh (DynamicMesh&& mesh, float resolution, bool isExact = false)
   {
-    const IsosurfaceExtraction::IntersectionCallback getIntersection =
-      [&mesh](const PrimRay& ray, Intersection& intersection) {
-        if (mesh.intersects (ray, intersection, true))
-        {
-          return IsosurfaceExtraction::Intersection::Sample;
-        }
-        else
-        {
-          return IsosurfaceExtraction::Intersection::None;
-        }
-      };
+    State&       state = this->self->state ();
+    DynamicMesh& dMesh = state.scene ().newDynamicMesh (state.config (), std::move (mesh));
 
-    const IsosurfaceExtraction::DistanceCallback getDistance = [&mesh](const glm::vec3& pos) {
-      return mesh.unsignedDistance (pos);
-    };
-
-    const PrimAABox bounds = mesh.mesh ().bounds ();
-    DynamicMesh     extractedMesh;
-    IsosurfaceExtraction::extract (getDistance, getIntersection, bounds, this->resolution,
-                                   extractedMesh);
-
-    State& state = this->self->state ();
-    state.scene ().deleteMesh (mesh);
-    DynamicMesh& dMesh = state.scene ().newDynamicMesh (state.config (), extractedMesh);
-    ToolSculptAction::smoothMesh (dMesh);
+    if (isExact == false)
+    {
+      this->finalizeMesh (dMesh, resolution);
+    }
+    return dMesh;
   }
 
-  void remesh (DynamicMesh& meshA, DynamicMesh& meshB)
+  /* Returns the resolution of remeshing `meshes`.  If remeshing aims at a number of faces, the
+   * resolution is estimated from the area of a coarse extraction (cf.
+   * `IsosurfaceExtraction::resolutionForFaces`).
+   */
+  float extractionResolution (const std::vector<DynamicMesh*>& meshes,
+                              const Extraction&                extract) const
   {
-    const IsosurfaceExtraction::IntersectionCallback getCommutativeIntersection =
-      [this, &meshA, &meshB](const PrimRay& ray, Intersection& intersection) {
-        assert (this->mode == Mode::Union || this->mode == Mode::Intersection);
+    float resolution = this->resolution;
 
-        Intersection intersectionA, intersectionB;
-        meshA.intersects (ray, intersectionA, true);
-        meshB.intersects (ray, intersectionB, true);
-
-        Intersection::sort (intersectionA, intersectionB);
-        intersection = intersectionA;
+    if (this->faceBudget)
+    {
+      const std::vector<const DynamicMesh*> sources (meshes.begin (), meshes.end ());
+      glm::vec3                             min (Util::maxFloat ());
+      glm::vec3                             max (-Util::maxFloat ());
 
-        const bool intersectsA = intersectionA.isIntersection ();
-        const bool intersectsB = intersectionB.isIntersection ();
+      for (const DynamicMesh* mesh : sources)
+      {
+        min = glm::min (min, mesh->bounds ().minimum ());
+        max = glm::max (max, mesh->bounds ().maximum ());
+      }
+      IsosurfaceExtraction::resolutionForFaces (
+        [&sources, &extract](float r, DynamicMesh& mesh) {
+          return extract (sources, r, mesh, nullptr, nullptr);
+        },
+        PrimAABox (min, max), this->numFaces, resolution);
+    }
+    return resolution;
+  }
 
-        if (intersectsA && intersectsB)
-        {
-          const bool insideA = glm::dot (ray.direction (), intersectionA.normal ()) > 0.0f;
-          const bool insideB = glm::dot (ray.direction (), intersectionB.normal ()) > 0.0f;
+  /* Replaces `meshes` by the result of `extract`, which runs on a background thread against
+   * copies of `meshes`.  When remeshing progressively, the sources are immediately replaced by a
+   * preview extracted at a coarser resolution.  Otherwise they stay in the scene until the result
+   * is done.  Extractions that may compute exact results report them by `isExact`, and are never
+   * previewed.
+   */
+  void remesh (const std::vector<DynamicMesh*>& meshes, const Extraction& extract,
+               float resolution, const std::shared_ptr<bool>& isExact = nullptr)
+  {
+    const auto copies = std::make_shared<std::vector<std::unique_ptr<DynamicMesh>>> ();
 
-          if (insideA && insideB)
-          {
-            // (B (A o-> A) B)
-            // (A (B o-> A) B)
-            if (this->mode == Mode::Union)
-            {
-              return IsosurfaceExtraction::Intersection::Continue;
-            }
-            else
-            {
-              assert (this->mode == Mode::Intersection);
-              return IsosurfaceExtraction::Intersection::Sample;
-            }
-          }
-          else if (insideA && insideB == false)
-          {
-            // (A o-> A) (B B)
-            if (this->mode == Mode::Union)
-            {
-              return IsosurfaceExtraction::Intersection::Sample;
-            }
-            else
-            {
-              assert (this->mode == Mode::Intersection);
-              return IsosurfaceExtraction::Intersection::Continue;
-            }
-          }
-          else if (insideA == false && insideB)
-          {
-            // (B o-> (A A) B)
-            // (B o-> (A B) A)
-            if (this->mode == Mode::Union)
-            {
-              return IsosurfaceExtraction::Intersection::Continue;
-            }
-            else
-            {
-              assert (this->mode == Mode::Intersection);
-              return IsosurfaceExtraction::Intersection::Sample;
-            }
-          }
-          else if (insideA == false && insideB == false)
-          {
-            // o-> (A (B B) A)
-            // o-> (A (B A) B)
-            // o-> (A A) (B B)
-            if (this->mode == Mode::Union)
-            {
-              return IsosurfaceExtraction::Intersection::Sample;
-            }
-            else
-            {
-              assert (this->mode == Mode::Intersection);
-              return IsosurfaceExtraction::Intersection::Continue;
-            }
-          }
-          DILAY_IMPOSSIBLE
-        }
-        else if (intersectsA)
-        {
-          if (this->mode == Mode::Union)
-          {
-            return IsosurfaceExtraction::Intersection::Sample;
-          }
-          else
-          {
-            assert (this->mode == Mode::Intersection);
-            return IsosurfaceExtraction::Intersection::Continue;
-          }
-        }
-        else
-        {
-          assert (intersectsB == false);
-          return IsosurfaceExtraction::Intersection::None;
-        }
-        DILAY_IMPOSSIBLE
-      };
+    for (const DynamicMesh* mesh : meshes)
+    {
+      copies->emplace_back (new DynamicMesh (*mesh));
+    }
 
-    const IsosurfaceExtraction::IntersectionCallback getDifferenceIntersection =
-      [this, &meshA, &meshB](const PrimRay& ray, Intersection& intersection) {
-        assert (this->mode == Mode::Difference);
+    Scene&                    scene = this->self->state ().scene ();
+    std::vector<DynamicMesh*> replaced;
 
-        Intersection intersectionA, intersectionB;
-        const bool   intersectsA = meshA.intersects (ray, intersectionA, true);
-        const bool   intersectsB = meshB.intersects (ray, intersectionB, true);
+    const bool progressive = this->progressive && isExact == nullptr;
 
-        if (intersectsA && intersectsB)
-        {
-          const bool insideA = glm::dot (ray.direction (), intersectionA.normal ()) > 0.0f;
-          const bool insideB = glm::dot (ray.direction (), intersectionB.normal ()) > 0.0f;
-          const bool aBeforeB = intersectionA.distance () < intersectionB.distance ();
+    if (progressive)
+    {
+      const std::vector<const DynamicMesh*> sources (meshes.begin (), meshes.end ());
+      DynamicMesh                           preview;
 
-          intersection = aBeforeB ? intersectionA : intersectionB;
+      extract (sources, previewResolution * resolution, preview, nullptr, nullptr);
 
-          if (insideA && insideB)
-          {
-            if (aBeforeB)
-            {
-              // (B (A o-> A) B)
-              // (A (B o-> A) B)
-              return IsosurfaceExtraction::Intersection::Continue;
-            }
-            else
-            {
-              // (A (B o-> B) A)
-              // (B (A o-> B) A)
-              return IsosurfaceExtraction::Intersection::Sample;
-            }
-          }
-          else if (insideA && insideB == false)
-          {
-            // (A o-> A) (B B)
-            // (A o-> (B B) A)
-            // (A o-> (B A) B)
-            return IsosurfaceExtraction::Intersection::Sample;
-          }
-          else if (insideA == false && insideB)
-          {
-            // (B o-> B) (A A)
-            // (B o-> (A A) B)
-            // (B o-> (A B) A)
-            return IsosurfaceExtraction::Intersection::Continue;
-          }
-          else if (insideA == false && insideB == false)
-          {
-            if (aBeforeB)
-            {
-              // o-> (A (B B) A)
-              // o-> (A (B A) B)
-              // o-> (A A) (B B)
-              return IsosurfaceExtraction::Intersection::Sample;
-            }
-            else
-            {
-              // o-> (B (A A) B)
-              // o-> (B (A B) A)
-              // o-> (B B) (A A)
-              return IsosurfaceExtraction::Intersection::Continue;
-            }
-          }
-          DILAY_IMPOSSIBLE
-        }
-        else if (intersectsA)
+      for (DynamicMesh* mesh : meshes)
+      {
+        scene.deleteMesh (*mesh);
+      }
+      if (preview.isEmpty () == false)
+      {
+        replaced.push_back (&this->addMesh (std::move (preview), resolution));
+      }
+    }
+    else
+    {
+      replaced = meshes;
+    }
+    this->hasPreview = progressive;
+
+    this->refinement.run (
+      progressive ? QObject::tr ("Refining") : QObject::tr ("Remeshing"),
+      [extract, copies, resolution](DynamicMesh& mesh, const ProgressCallback& progress,
+                                    const CancellationToken& token) {
+        std::vector<const DynamicMesh*> sources;
+        for (const std::unique_ptr<DynamicMesh>& copy : *copies)
         {
-          intersection = intersectionA;
-          return IsosurfaceExtraction::Intersection::Sample;
+          sources.push_back (copy.get ());
         }
-        else if (intersectsB)
+        return extract (sources, resolution, mesh, progress, &token);
+      },
+      [this, replaced, resolution, isExact](DynamicMesh& mesh) {
+        for (DynamicMesh* r : replaced)
         {
-          intersection = intersectionB;
-          return IsosurfaceExtraction::Intersection::Continue;
+          this->self->state ().scene ().deleteMesh (*r);
         }
-        else
+        if (mesh.isEmpty () == false)
         {
-          return IsosurfaceExtraction::Intersection::None;
+          this->addMesh (std::move (mesh), resolution, isExact && *isExact);
         }
-        DILAY_IMPOSSIBLE
-      };
-
-    const IsosurfaceExtraction::DistanceCallback getDistance = [&meshA,
-                                                                &meshB](const glm::vec3& pos) {
-      return glm::min (meshA.unsignedDistance (pos), meshB.unsignedDistance (pos));
-    };
-
-    const PrimAABox boundsA = meshA.mesh ().bounds ();
-    const PrimAABox boundsB = meshB.mesh ().bounds ();
-    const glm::vec3 min = glm::min (boundsA.minimum (), boundsB.minimum ());
-    const glm::vec3 max = glm::max (boundsA.maximum (), boundsB.maximum ());
-    const PrimAABox bounds (min, max);
+        this->self->state ().mainWindow ().infoPane ().scene ().updateInfo ();
+      });
+  }
 
-    DynamicMesh extractedMesh;
-    if (this->mode == Mode::Difference)
+  // keeps the preview of a progressive remeshing or waits for the result otherwise
+  void finishRemeshing ()
+  {
+    if (this->hasPreview)
     {
-      IsosurfaceExtraction::extract (getDistance, getDifferenceIntersection, bounds,
-                                     this->resolution, extractedMesh);
+      this->refinement.cancel ();
     }
     else
     {
-      IsosurfaceExtraction::extract (getDistance, getCommutativeIntersection, bounds,
-                                     this->resolution, extractedMesh);
+      this->refinement.finish ();
     }
+  }
+
+  void remesh (DynamicMesh& mesh)
+  {
+    const bool       symmetric = this->symmetric;
+    const bool       reproject = this->reproject;
+    const Extraction extract = [symmetric, reproject](
+                                 const std::vector<const DynamicMesh*>& sources, float resolution,
+                                 DynamicMesh& extractedMesh, const ProgressCallback& progress,
+                                 const CancellationToken* token) {
+      assert (sources.size () == 1);
+
+      if (reproject)
+      {
+        return extractMesh (*sources[0], reprojectedResolution * resolution, symmetric,
+                            extractedMesh, progress, token) &&
+               reprojectMesh (*sources[0], resolution, extractedMesh, token);
+      }
+      else
+      {
+        return extractMesh (*sources[0], resolution, symmetric, extractedMesh, progress, token);
+      }
+    };
+    this->remesh ({&mesh}, extract, this->extractionResolution ({&mesh}, extract));
+  }
 
-    State& state = this->self->state ();
-    state.scene ().deleteMesh (meshA);
-    state.scene ().deleteMesh (meshB);
+  /* Exact booleans only cut the meshes along their intersection curve.  They fall back to
+   * sampling both meshes if the curve cannot be computed exactly, whose resolution is thus
+   * estimated without computing exact booleans.
+   */
+  void remesh (DynamicMesh& meshA, DynamicMesh& meshB)
+  {
+    const Mode                  mode = this->mode;
+    const std::shared_ptr<bool> isExact = this->exact ? std::make_shared<bool> (false) : nullptr;
+
+    const Extraction sample = [mode](const std::vector<const DynamicMesh*>& sources,
+                                     float resolution, DynamicMesh& extractedMesh,
+                                     const ProgressCallback&  progress,
+                                     const CancellationToken* token) {
+      return extractMesh (*sources[0], *sources[1], mode, resolution, extractedMesh, progress,
+                          token);
+    };
+    const float fallbackResolution = this->extractionResolution ({&meshA, &meshB}, sample);
+
+    this->remesh ({&meshA, &meshB},
+                  [mode, isExact](const std::vector<const DynamicMesh*>& sources,
+                                  float resolution, DynamicMesh& extractedMesh,
+                                  const ProgressCallback& progress,
+                                  const CancellationToken* token) {
+                    assert (sources.size () == 2);
+
+                    if (isExact && DynamicMeshBoolean::compute (*sources[0], *sources[1],
+                                                                booleanOperation (mode),
+                                                                extractedMesh, token))
+                    {
+                      *isExact = true;
+                      return true;
+                    }
+                    else if (token && token->isCancelled ())
+                    {
+                      return false;
+                    }
+                    return extractMesh (*sources[0], *sources[1], mode, resolution, extractedMesh,
+                                        progress, token);
+                  },
+                  fallbackResolution, isExact);
+  }
+
+  bool canCombineAll () const
+  {
+    return this->mode == Mode::Union || this->mode == Mode::Intersection;
+  }
 
-    if (extractedMesh.isEmpty () == false)
+  // unites or intersects all meshes of the scene in a single extraction
+  void combineAll ()
+  {
+    assert (this->canCombineAll ());
+
+    this->finishRemeshing ();
+
+    std::vector<DynamicMesh*> meshes;
+    this->self->state ().scene ().forEachMesh (
+      [&meshes](DynamicMesh& mesh) { meshes.push_back (&mesh); });
+
+    if (meshes.size () > 1)
     {
-      DynamicMesh& dMesh = state.scene ().newDynamicMesh (state.config (), extractedMesh);
-      ToolSculptAction::smoothMesh (dMesh);
+      const Mode mode = this->mode;
+
+      const Extraction extract = [mode](const std::vector<const DynamicMesh*>& sources,
+                                        float resolution, DynamicMesh& extractedMesh,
+                                        const ProgressCallback&  progress,
+                                        const CancellationToken* token) {
+        return extractMesh (sources, mode, resolution, extractedMesh, progress, token);
+      };
+
+      this->self->snapshotDynamicMeshes ();
+      this->remesh (meshes, extract, this->extractionResolution (meshes, extract));
+      this->self->updateGlWidget ();
     }
   }
 
@@ -354,6 +679,8 @@ struct ToolRemesh::Impl
     }
     else
     {
+      this->finishRemeshing ();
+
       if (this->mode == Mode::Normal)
       {
         DynamicMeshIntersection intersection;
@@ -408,16 +735,26 @@ struct ToolRemesh::Impl
     {
       const QPoint cursorPos (ViewUtil::toQPoint (this->self->cursorPosition ()));
 
-      QPen pen (this->self->config ().get<Color> ("editor/on-screen-color").qColor ());
+      QPen pen (this->onScreenColor.qColor ());
       pen.setCapStyle (Qt::FlatCap);
       pen.setWidth (2);
 
       painter.setPen (pen);
       painter.drawLine (ViewUtil::toQPoint (*this->pressPoint), cursorPos);
     }
+    this->refinement.paint (painter, this->self->cursorPosition ());
+  }
+
+  ToolResponse runCommit ()
+  {
+    this->finishRemeshing ();
+    return ToolResponse::Redraw;
   }
 
-  ToolResponse runCommit () { return ToolResponse::Redraw; }
+  void runFromConfig ()
+  {
+    this->onScreenColor = this->self->config ().get<Color> ("editor/on-screen-color");
+  }
 };
 
 DELEGATE_TOOL (ToolRemesh)
@@ -426,3 +763,4 @@ DELEGATE_TOOL_RUN_PRESS_EVENT (ToolRemesh)
 DELEGATE_TOOL_RUN_RELEASE_EVENT (ToolRemesh)
 DELEGATE_TOOL_RUN_PAINT (ToolRemesh)
 DELEGATE_TOOL_RUN_COMMIT (ToolRemesh)
+DELEGATE_TOOL_RUN_FROM_CONFIG (ToolRemesh)
@@ -3,12 +3,16 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <QCheckBox>
+#include <QFileDialog>
 #include <QFrame>
+#include <QPushButton>
 #include <QWheelEvent>
 #include "cache.hpp"
 #include "camera.hpp"
+#include "color.hpp"
 #include "config.hpp"
 #include "dynamic/mesh-intersection.hpp"
+#include "dynamic/mesh-layers.hpp"
 #include "dynamic/mesh.hpp"
 #include "history.hpp"
 #include "maybe.hpp"
@@ -19,10 +23,18 @@
 #include "tool/sculpt.hpp"
 #include "tool/sculpt/util/action.hpp"
 #include "tool/sculpt/util/brush.hpp"
+#include "tool/sculpt/util/governor.hpp"
+#include "tool/sculpt/util/stamp.hpp"
+#include "tool/sculpt/util/stroke-record.hpp"
+#include "tool/sculpt/util/visibility.hpp"
 #include "tool/util/movement.hpp"
+#include "tool/util/prediction.hpp"
 #include "tool/util/step.hpp"
+#include "util.hpp"
 #include "view/cursor.hpp"
 #include "view/double-slider.hpp"
+#include "view/gl-widget.hpp"
+#include "view/main-window.hpp"
 #include "view/pointing-event.hpp"
 #include "view/tool-tip.hpp"
 #include "view/two-column-grid.hpp"
@@ -37,19 +49,43 @@ namespace
     Sculpted,
     Ended
   };
+
+  // bounds the predicted cursor displacement in pixels, such that sudden turns do not overshoot
+  const float maxPredictionDistance = 64.0f;
+
+  // the stamp is shared by all sculpt tools and is kept until it is cleared
+  SculptStamp& globalStamp ()
+  {
+    static SculptStamp stamp;
+    return stamp;
+  }
 }
 
 struct ToolSculpt::Impl
 {
-  ToolSculpt*       self;
-  SculptBrush       brush;
-  ViewCursor        cursor;
-  CacheProxy        commonCache;
-  ViewDoubleSlider& radiusEdit;
-  ViewDoubleSlider* secondarySlider;
-  bool              absoluteRadius;
-  SculptState       sculptState;
-  ToolUtilStep      step;
+  ToolSculpt*        self;
+  SculptBrush        brush;
+  ViewCursor         cursor;
+  CacheProxy         commonCache;
+  ViewDoubleSlider&  radiusEdit;
+  ViewDoubleSlider*  secondarySlider;
+  bool               absoluteRadius;
+  bool               sculptIntoLayer;
+  bool               isAdjustingLayers;
+  SculptState        sculptState;
+  ToolUtilStep       step;
+  ToolUtilPrediction prediction;
+  unsigned int       recentFace;
+  unsigned int       subdivisionBudget;
+  float              maxAbsoluteRadius;
+  bool               deferNormals;
+  float              predictionTime;
+  SculptGovernor     governor;
+  SculptVisibility   visibility;
+  bool               visibleDomain;
+  unsigned int       visibilityRingWidth;
+  Color              cursorColor;
+  Color              throttlingColor;
 
   Impl (ToolSculpt* s)
     : self (s)
@@ -58,7 +94,16 @@ struct ToolSculpt::Impl
         ViewUtil::slider (2, 0.01f, this->commonCache.get<float> ("radius", 0.1f), 1.0f, 3))
     , secondarySlider (nullptr)
     , absoluteRadius (this->commonCache.get<bool> ("absolute-radius", true))
+    , sculptIntoLayer (this->commonCache.get<bool> ("layer/sculpt-into", false))
+    , isAdjustingLayers (false)
     , sculptState (SculptState::None)
+    , recentFace (Util::invalidIndex ())
+    , subdivisionBudget (0)
+    , maxAbsoluteRadius (0.0f)
+    , deferNormals (false)
+    , predictionTime (0.0f)
+    , visibleDomain (false)
+    , visibilityRingWidth (0)
   {
   }
 
@@ -77,6 +122,8 @@ struct ToolSculpt::Impl
   void setupBrush ()
   {
     this->brush.subdivide (this->commonCache.get<bool> ("subdivide", true));
+    this->brush.stamp (&globalStamp ());
+    this->brush.visibility (&this->visibility);
 
     if (this->absoluteRadius)
     {
@@ -142,12 +189,144 @@ struct ToolSculpt::Impl
     });
     properties.add (absRadiusEdit);
 
+    QPushButton& loadStampButton = ViewUtil::pushButton (QObject::tr ("Load stamp"));
+    QPushButton& clearStampButton = ViewUtil::pushButton (QObject::tr ("Clear stamp"));
+    ViewUtil::connect (loadStampButton, [this, &clearStampButton]() {
+      ViewMainWindow& mainWindow = this->self->state ().mainWindow ();
+      const QString   fileName = QFileDialog::getOpenFileName (
+        &mainWindow, QObject::tr ("Load stamp"), QString (),
+        QObject::tr ("Images (*.png *.jpg *.jpeg *.bmp)"), nullptr,
+        QFileDialog::DontUseNativeDialog);
+
+      if (fileName.isEmpty () == false)
+      {
+        if (globalStamp ().fromFile (fileName) == false)
+        {
+          ViewUtil::error (mainWindow, QObject::tr ("Could not load stamp."));
+        }
+        clearStampButton.setEnabled (globalStamp ().isEmpty () == false);
+      }
+    });
+    ViewUtil::connect (clearStampButton, [&clearStampButton]() {
+      globalStamp ().reset ();
+      clearStampButton.setEnabled (false);
+    });
+    clearStampButton.setEnabled (globalStamp ().isEmpty () == false);
+    properties.add (loadStampButton, clearStampButton);
+
+    this->setupLayerProperties ();
     this->self->addMirrorProperties ();
     properties.add (ViewUtil::horizontalLine ());
 
     this->self->runSetupProperties (properties);
   }
 
+  // only the topmost layer of each mesh is sculpted into and adjusted
+  void forEachTopLayer (const std::function<void(DynamicMesh&, unsigned int)>& f)
+  {
+    this->self->state ().scene ().forEachMesh ([&f](DynamicMesh& mesh) {
+      if (mesh.layers ().numLayers () > 0)
+      {
+        f (mesh, mesh.layers ().numLayers () - 1);
+      }
+    });
+  }
+
+  /* Adjusting the layers of all meshes is recorded as a single step of the history.  Adjustments
+   * that are not final are recorded into the same step, until `stopAdjustingTopLayers` is called.
+   */
+  void adjustTopLayers (const std::function<void(DynamicMesh&, unsigned int)>& f,
+                        bool isFinal = true)
+  {
+    bool hasLayers = false;
+    this->forEachTopLayer ([&hasLayers](DynamicMesh&, unsigned int) { hasLayers = true; });
+
+    if (hasLayers)
+    {
+      if (this->isAdjustingLayers == false)
+      {
+        this->self->snapshotDynamicMeshDeltas ();
+        this->isAdjustingLayers = true;
+      }
+      this->forEachTopLayer ([&f](DynamicMesh& mesh, unsigned int l) {
+        f (mesh, l);
+        mesh.bufferData ();
+      });
+      if (isFinal)
+      {
+        this->stopAdjustingTopLayers ();
+      }
+      this->self->updateGlWidget ();
+    }
+  }
+
+  void stopAdjustingTopLayers ()
+  {
+    if (this->isAdjustingLayers)
+    {
+      this->self->state ().history ().stopRecording ();
+      this->isAdjustingLayers = false;
+    }
+  }
+
+  void setupLayerProperties ()
+  {
+    ViewTwoColumnGrid& properties = this->self->properties ();
+
+    float strength = 1.0f;
+    bool  isEnabled = true;
+    this->forEachTopLayer ([&strength, &isEnabled](DynamicMesh& mesh, unsigned int l) {
+      strength = mesh.layers ().strength (l);
+      isEnabled = mesh.layers ().isEnabled (l);
+    });
+
+    QPushButton& addButton = ViewUtil::pushButton (QObject::tr ("Add layer"));
+    QPushButton& applyButton = ViewUtil::pushButton (QObject::tr ("Apply layer"));
+    QCheckBox&   sculptIntoEdit =
+      ViewUtil::checkBox (QObject::tr ("Sculpt into layer"), this->sculptIntoLayer);
+    QCheckBox&        enableEdit = ViewUtil::checkBox (QObject::tr ("Show layer"), isEnabled);
+    ViewDoubleSlider& strengthEdit = ViewUtil::slider (2, 0.0f, strength, 2.0f);
+
+    // adding and applying layers changes their number, which requires a complete snapshot
+    ViewUtil::connect (addButton, [this, &enableEdit, &strengthEdit]() {
+      const float newStrength = float(strengthEdit.doubleValue ());
+      const bool  newIsEnabled = enableEdit.isChecked ();
+
+      this->self->snapshotDynamicMeshes ();
+      this->self->state ().scene ().forEachMesh ([newStrength, newIsEnabled](DynamicMesh& mesh) {
+        const unsigned int l = mesh.addLayer ();
+
+        mesh.layerStrength (l, newStrength);
+        mesh.enableLayer (l, newIsEnabled);
+      });
+    });
+    ViewUtil::connect (applyButton, [this]() {
+      this->self->snapshotDynamicMeshes ();
+      this->forEachTopLayer ([](DynamicMesh& mesh, unsigned int l) { mesh.applyLayer (l); });
+    });
+    properties.add (addButton, applyButton);
+
+    ViewUtil::connect (sculptIntoEdit, [this](bool s) {
+      this->sculptIntoLayer = s;
+      this->commonCache.set ("layer/sculpt-into", s);
+    });
+    properties.add (sculptIntoEdit);
+
+    ViewUtil::connect (enableEdit, [this](bool e) {
+      this->adjustTopLayers ([e](DynamicMesh& mesh, unsigned int l) { mesh.enableLayer (l, e); });
+    });
+    properties.add (enableEdit);
+
+    // dragging the slider adjusts the strength live and is recorded once it is released
+    ViewUtil::connect (strengthEdit, [this, &strengthEdit](float s) {
+      this->adjustTopLayers ([s](DynamicMesh& mesh, unsigned int l) { mesh.layerStrength (l, s); },
+                             strengthEdit.isSliderDown () == false);
+    });
+    QObject::connect (&strengthEdit, &QSlider::sliderReleased,
+                      [this]() { this->stopAdjustingTopLayers (); });
+    properties.addStacked (QObject::tr ("Layer strength"), strengthEdit);
+  }
+
   void setupToolTip ()
   {
     ViewToolTip toolTip;
@@ -168,7 +347,53 @@ struct ToolSculpt::Impl
     }
   }
 
+  // the scene only needs to be redrawn if it was sculpted, otherwise only the cursor may have moved
+  ToolResponse cursorResponse (unsigned int cursorRevision) const
+  {
+    return cursorRevision == this->cursor.revision () ? ToolResponse::None
+                                                      : ToolResponse::RedrawOverlay;
+  }
+
   ToolResponse runPointingEvent (const ViewPointingEvent& e)
+  {
+    const unsigned int cursorRevision = this->cursor.revision ();
+    const ToolResponse response = this->runPointingEventWithoutPrediction (e, cursorRevision);
+
+    if (e.moveEvent () == false)
+    {
+      this->prediction.reset ();
+    }
+    else if (this->predictionTime > 0.0f)
+    {
+      this->prediction.add (glm::vec2 (e.position ()), e.timestamp ());
+
+      // only a cursor that follows the pointer is predicted, e.g. not while changing the radius
+      if (this->cursor.isEnabled () && this->cursor.revision () != cursorRevision)
+      {
+        this->predictCursor ();
+      }
+    }
+    return response == ToolResponse::None ? this->cursorResponse (cursorRevision) : response;
+  }
+
+  // the cursor is placed where the pointer is expected to be when the frame is shown
+  void predictCursor ()
+  {
+    if (this->prediction.hasPrediction ())
+    {
+      const glm::vec2 predicted =
+        this->prediction.predict (this->predictionTime, maxPredictionDistance);
+
+      glm::vec3 position;
+      if (this->self->pickDynamicMeshes (glm::ivec2 (glm::round (predicted)), position))
+      {
+        this->setCursor (position);
+      }
+    }
+  }
+
+  ToolResponse runPointingEventWithoutPrediction (const ViewPointingEvent& e,
+                                                  unsigned int             cursorRevision)
   {
     if (this->self->onKeymap ('r') && e.moveEvent ())
     {
@@ -182,8 +407,14 @@ struct ToolSculpt::Impl
     {
       if (e.pressEvent ())
       {
-        this->self->snapshotDynamicMeshes ();
+        this->self->snapshotDynamicMeshDeltas ();
         this->sculptState = SculptState::Started;
+        this->deferMeshNormals (this->deferNormals);
+
+        if (this->sculptIntoLayer)
+        {
+          this->forEachTopLayer ([](DynamicMesh& mesh, unsigned int l) { mesh.recordLayer (l); });
+        }
       }
 
       const bool doSculpt =
@@ -197,41 +428,87 @@ struct ToolSculpt::Impl
       {
         this->runCommit ();
       }
+      return ToolResponse::Redraw;
     }
-    else
+    else if (this->self->runSculptPointingEvent (e))
     {
-      this->self->runSculptPointingEvent (e);
+      return ToolResponse::Redraw;
     }
-    return ToolResponse::Redraw;
+    return this->cursorResponse (cursorRevision);
   }
 
   ToolResponse runCursorUpdate (const glm::ivec2& pos)
   {
-    DynamicMeshIntersection cursorIntersection;
-    this->setCursorByIntersection (pos, cursorIntersection);
-    return ToolResponse::Redraw;
+    const unsigned int cursorRevision = this->cursor.revision ();
+
+    this->setCursorByPicking (pos);
+    return this->cursorResponse (cursorRevision);
   }
 
   ToolResponse runCommit ()
   {
+    ToolSculptAction::finishRefinement ();
     this->brush.resetPointOfAction ();
+    this->self->state ().strokeRecorder ().endStroke ();
+    this->deferMeshNormals (false);
+    this->governor.reset ();
+    this->updateCursorColor ();
+    this->self->state ().scene ().forEachMesh (
+      [](DynamicMesh& mesh) { mesh.recordLayer (Util::invalidIndex ()); });
 
     if (this->sculptState == SculptState::Started)
     {
       this->self->state ().history ().dropPastSnapshot ();
     }
+    else
+    {
+      this->self->state ().history ().stopRecording ();
+    }
     this->sculptState = SculptState::None;
+    this->isAdjustingLayers = false;
     return ToolResponse::None;
   }
 
+  // normals of deferring meshes are buffered when deferring is stopped
+  void deferMeshNormals (bool defer)
+  {
+    this->self->state ().scene ().forEachMesh ([defer](DynamicMesh& mesh) {
+      if (mesh.deferNormals () != defer)
+      {
+        mesh.deferNormals (defer);
+
+        if (defer == false)
+        {
+          mesh.bufferData ();
+        }
+      }
+    });
+  }
+
   void runFromConfig ()
   {
     const Config& config = this->self->config ();
 
     this->brush.detailFactor (config.get<float> ("editor/tool/sculpt/detail-factor"));
     this->brush.stepWidthFactor (config.get<float> ("editor/tool/sculpt/step-width-factor"));
+    this->subdivisionBudget = config.get<int> ("editor/tool/sculpt/subdivision-budget");
+    this->maxAbsoluteRadius = config.get<float> ("editor/tool/sculpt/max-absolute-radius");
+    this->deferNormals = config.get<bool> ("editor/tool/sculpt/defer-normals");
+    this->predictionTime = float(config.get<int> ("editor/tool/sculpt/prediction-time")) / 1000.0f;
+    this->governor.runFromConfig (config);
+    this->visibleDomain = config.get<bool> ("editor/tool/sculpt/visible-domain/enabled");
+    this->visibilityRingWidth = config.get<int> ("editor/tool/sculpt/visible-domain/ring-width");
+
+    this->cursorColor = config.get<Color> ("editor/tool/cursor-color");
+    this->throttlingColor = config.get<Color> ("editor/tool/sculpt/governor/color");
+    this->updateCursorColor ();
+  }
 
-    this->cursor.color (this->self->config ().get<Color> ("editor/tool/cursor-color"));
+  // the cursor indicates whether the governor limits the detail or the dab rate
+  void updateCursorColor ()
+  {
+    this->cursor.color (this->governor.isThrottling () ? this->throttlingColor
+                                                       : this->cursorColor);
   }
 
   void addDefaultToolTip (ViewToolTip& toolTip, bool hasInvertedMode, bool hasIntensity)
@@ -254,31 +531,105 @@ struct ToolSculpt::Impl
   {
     assert (this->brush.hasPointOfAction ());
 
-    ToolSculptAction::sculpt (this->brush);
-    if (this->self->mirrorEnabled () && this->brush.mesh ().isEmpty () == false)
+    State&                state = this->self->state ();
+    SculptStrokeRecorder& recorder = state.strokeRecorder ();
+
+    if (this->self->mirrorEnabled ())
     {
-      this->brush.mirror (this->self->mirror ().plane ());
+      const PrimPlane& plane = this->self->mirror ().plane ();
+
+      recorder.dab (state.scene (), this->brush, &plane);
+      ToolSculptAction::sculpt (this->brush, plane);
+    }
+    else
+    {
+      recorder.dab (state.scene (), this->brush, nullptr);
       ToolSculptAction::sculpt (this->brush);
-      this->brush.mirror (this->self->mirror ().plane ());
     }
 
     if (this->brush.mesh ().isEmpty ())
     {
-      this->self->state ().scene ().deleteEmptyMeshes ();
+      ToolSculptAction::flushBatch ();
+      ToolSculptAction::finishRefinement ();
+      state.history ().resolveDynamicMeshDeltas ();
+      state.scene ().deleteEmptyMeshes ();
       this->brush.resetPointOfAction ();
     }
   }
 
+  /* Reads the depths of the last frame around the dabs between two positions, which discard the
+   * hidden faces of their domains if enabled.  Without depths, only faces that face away from a
+   * brush are discarded.
+   */
+  void updateVisibility (const glm::vec3& from, const glm::vec3& to)
+  {
+    this->visibility.reset ();
+
+    if (this->visibleDomain == false)
+    {
+      return;
+    }
+
+    const Camera&     camera = this->self->state ().camera ();
+    const glm::mat4x4 model (1.0f);
+    const glm::vec2   fromPoint = camera.fromWorld (from, model, false);
+    const glm::vec2   toPoint = camera.fromWorld (to, model, false);
+    const glm::vec3   radius = this->brush.radius () * camera.right ();
+    const float       margin =
+      glm::max (glm::distance (camera.fromWorld (from + radius, model, false), fromPoint),
+                glm::distance (camera.fromWorld (to + radius, model, false), toPoint)) +
+      float(this->visibilityRingWidth + 1);
+
+    const glm::ivec2 resolution (camera.resolution ());
+    const glm::ivec2 min =
+      glm::max (glm::ivec2 (glm::floor (glm::min (fromPoint, toPoint) - margin)), glm::ivec2 (0));
+    const glm::ivec2 max =
+      glm::min (glm::ivec2 (glm::ceil (glm::max (fromPoint, toPoint) + margin)), resolution);
+
+    if (glm::any (glm::greaterThanEqual (min, max)))
+    {
+      return;
+    }
+
+    std::vector<float> depths;
+    if (this->self->state ().mainWindow ().glWidget ().depths (min, max - min, depths))
+    {
+      this->visibility.fromDepths (camera, min, max - min, depths, this->visibilityRingWidth);
+    }
+  }
+
+  void setCursor (const glm::vec3& position)
+  {
+    this->cursor.enable ();
+    this->cursor.position (position);
+
+    if (this->absoluteRadius == false)
+    {
+      this->setRelativeRadius ();
+    }
+  }
+
   bool setCursorByIntersection (const glm::ivec2& pos, DynamicMeshIntersection& intersection)
   {
     if (this->self->intersectsScene (pos, intersection))
     {
-      if (this->absoluteRadius == false)
-      {
-        this->setRelativeRadius (intersection.distance ());
-      }
-      this->cursor.enable ();
-      this->cursor.position (intersection.position ());
+      this->setCursor (intersection.position ());
+      return true;
+    }
+    else
+    {
+      this->cursor.disable ();
+      return false;
+    }
+  }
+
+  // hovering only places the cursor, which does not require a precise intersection
+  bool setCursorByPicking (const glm::ivec2& pos)
+  {
+    glm::vec3 position;
+    if (this->self->pickDynamicMeshes (pos, position))
+    {
+      this->setCursor (position);
       return true;
     }
     else
@@ -295,10 +646,19 @@ struct ToolSculpt::Impl
 
     DynamicMeshIntersection intersection;
 
+    // consecutive rays of a stroke are coherent, so a hit near the recent face bounds the search
+    if (this->brush.hasPointOfAction () && this->recentFace != Util::invalidIndex ())
+    {
+      this->brush.mesh ().intersectsNeighborhood (ray, this->recentFace, intersection);
+    }
+
     if (this->self->intersectsScene (ray, intersection))
     {
+      this->recentFace = intersection.faceIndex ();
+
       if (this->brush.hasPointOfAction () && (&this->brush.mesh () != &intersection.mesh ()))
       {
+        ToolSculptAction::flushBatch ();
         this->brush.mesh ().bufferData ();
       }
 
@@ -312,6 +672,7 @@ struct ToolSculpt::Impl
         }
         else
         {
+          ToolSculptAction::flushBatch ();
           this->brush.mesh ().bufferData ();
           this->brush.resetPointOfAction ();
           return false;
@@ -326,6 +687,7 @@ struct ToolSculpt::Impl
     }
     else
     {
+      ToolSculptAction::flushBatch ();
       this->brush.mesh ().bufferData ();
       this->brush.resetPointOfAction ();
       return false;
@@ -337,11 +699,17 @@ struct ToolSculpt::Impl
   {
     DynamicMeshIntersection cursorIntersection;
 
-    if (this->setCursorByIntersection (e.position (), cursorIntersection) && e.leftButton ())
+    if (e.leftButton () == false)
     {
-      SBParameters& parameters = this->brush.parameters<SBParameters> ();
-      const float   defaultIntesity = parameters.intensity ();
-      const bool    doToggle = toggle && e.modifiers () == Qt::ShiftModifier;
+      this->setCursorByPicking (e.position ());
+      return false;
+    }
+    else if (this->setCursorByIntersection (e.position (), cursorIntersection))
+    {
+      SBParameters&         parameters = this->brush.parameters<SBParameters> ();
+      SculptStrokeRecorder& recorder = this->self->state ().strokeRecorder ();
+      const float           defaultIntesity = parameters.intensity ();
+      const bool            doToggle = toggle && e.modifiers () == Qt::ShiftModifier;
 
       parameters.intensity (defaultIntesity * e.intensity ());
 
@@ -350,6 +718,16 @@ struct ToolSculpt::Impl
         (*toggle) ();
       }
 
+      // all dabs of an event share a single final pass and a single subdivision budget
+      recorder.beginStep (e.timestamp ());
+      this->governor.beginStep (this->brush);
+      ToolSculptAction::openBatch ();
+      ToolSculptAction::refinementDeadline (this->subdivisionBudget);
+
+      this->updateVisibility (this->brush.hasPointOfAction () ? this->brush.position ()
+                                                              : cursorIntersection.position (),
+                              cursorIntersection.position ());
+
       if (this->brush.hasPointOfAction ())
       {
         this->step.stepWidth (this->brush.stepWidth ());
@@ -377,12 +755,17 @@ struct ToolSculpt::Impl
           this->sculpt ();
         }
       }
+      ToolSculptAction::refineDeferred ();
+      ToolSculptAction::closeBatch ();
+      recorder.endStep ();
 
       if (this->brush.hasPointOfAction ())
       {
         assert (this->brush.mesh ().isEmpty () == false);
         this->brush.mesh ().bufferData ();
       }
+      this->governor.endStep (this->brush);
+      this->updateCursorColor ();
 
       if (doToggle)
       {
@@ -411,6 +794,9 @@ struct ToolSculpt::Impl
                                         cursorIntersection.normal ());
           this->cursor.disable ();
           movement.reset (cursorIntersection.position ());
+
+          // grabbed faces move away from their depths of the last frame, so none are hidden
+          this->visibility.reset ();
           return true;
         }
         else
@@ -430,21 +816,30 @@ struct ToolSculpt::Impl
     {
       if (e.leftButton () == false)
       {
-        this->setCursorByIntersection (e.position (), cursorIntersection);
+        this->setCursorByPicking (e.position ());
         return false;
       }
       else if (this->brush.hasPointOfAction ())
       {
         if (e.moveEvent () && movement.move (e))
         {
+          SculptStrokeRecorder& recorder = this->self->state ().strokeRecorder ();
+
           this->brush.setPointOfAction (this->brush.mesh (), movement.position (),
                                         this->brush.normal ());
+          recorder.beginStep (e.timestamp ());
+          this->governor.beginStep (this->brush);
+          ToolSculptAction::refinementDeadline (this->subdivisionBudget);
           this->sculpt ();
+          ToolSculptAction::refineDeferred ();
+          recorder.endStep ();
           if (this->brush.hasPointOfAction ())
           {
             assert (this->brush.mesh ().isEmpty () == false);
             this->brush.mesh ().bufferData ();
           }
+          this->governor.endStep (this->brush);
+          this->updateCursorColor ();
           return true;
         }
         else
@@ -480,12 +875,11 @@ struct ToolSculpt::Impl
 
   void setAbsoluteRadius ()
   {
-    const float max = this->self->config ().get<float> ("editor/tool/sculpt/max-absolute-radius");
-    const float factor = this->radiusEdit.doubleValue ();
+    const float radius = this->radiusEdit.doubleValue () * this->maxAbsoluteRadius;
 
     this->absoluteRadius = true;
-    this->brush.radius (factor * max);
-    this->cursor.radius (factor * max);
+    this->brush.radius (radius);
+    this->cursor.radius (radius);
   }
 };
 
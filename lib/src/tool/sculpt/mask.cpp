@@ -0,0 +1,88 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QCheckBox>
+#include <QPushButton>
+#include "cache.hpp"
+#include "dynamic/mesh.hpp"
+#include "scene.hpp"
+#include "state.hpp"
+#include "tool/sculpt/util/brush.hpp"
+#include "tools.hpp"
+#include "view/double-slider.hpp"
+#include "view/two-column-grid.hpp"
+#include "view/util.hpp"
+
+struct ToolSculptMask::Impl
+{
+  ToolSculptMask* self;
+
+  Impl (ToolSculptMask* s)
+    : self (s)
+  {
+  }
+
+  void runSetupBrush (SculptBrush& brush)
+  {
+    auto& params = brush.initParameters<SBMaskParameters> ();
+
+    params.intensity (this->self->cache ().get<float> ("intensity", 0.5f));
+    params.invert (this->self->cache ().get<bool> ("invert", false));
+
+    brush.subdivide (false);
+  }
+
+  void runSetupCursor (ViewCursor&) {}
+
+  void runSetupProperties (ViewTwoColumnGrid& properties)
+  {
+    auto& params = this->self->brush ().parameters<SBMaskParameters> ();
+
+    ViewDoubleSlider& intensityEdit = ViewUtil::slider (2, 0.1f, params.intensity (), 1.0f);
+    ViewUtil::connect (intensityEdit, [this, &params](float i) {
+      params.intensity (i);
+      this->self->cache ().set ("intensity", i);
+    });
+    properties.addStacked (QObject::tr ("Intensity"), intensityEdit);
+    this->self->registerSecondarySlider (intensityEdit);
+
+    QCheckBox& invertEdit = ViewUtil::checkBox (QObject::tr ("Invert"), params.invert ());
+    ViewUtil::connect (invertEdit, [this, &params](bool i) {
+      params.invert (i);
+      this->self->cache ().set ("invert", i);
+    });
+    properties.add (invertEdit);
+
+    QPushButton& clearEdit = ViewUtil::pushButton (QObject::tr ("Clear mask"));
+    ViewUtil::connect (clearEdit, [this]() {
+      Scene& scene = this->self->state ().scene ();
+
+      this->self->snapshotDynamicMeshes ();
+      scene.forEachMesh ([](DynamicMesh& mesh) {
+        if (mesh.hasMask ())
+        {
+          mesh.resetMask ();
+          mesh.bufferData ();
+        }
+      });
+      this->self->updateGlWidget ();
+    });
+    properties.add (clearEdit);
+  }
+
+  void runSetupToolTip (ViewToolTip& toolTip)
+  {
+    this->self->addDefaultToolTip (toolTip, true, true);
+  }
+
+  bool runSculptPointingEvent (const ViewPointingEvent& e)
+  {
+    const std::function<void()> toggleInvert = [this]() {
+      this->self->brush ().parameters<SBMaskParameters> ().toggleInvert ();
+    };
+    return this->self->drawlikeStroke (e, false, &toggleInvert);
+  }
+};
+
+DELEGATE_TOOL_SCULPT (ToolSculptMask)
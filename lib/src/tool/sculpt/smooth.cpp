@@ -3,6 +3,7 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <QCheckBox>
+#include <QSpinBox>
 #include "cache.hpp"
 #include "tool/sculpt/util/brush.hpp"
 #include "tools.hpp"
@@ -24,6 +25,7 @@ struct ToolSculptSmooth::Impl
     auto& params = brush.initParameters<SBSmoothParameters> ();
 
     params.intensity (this->self->cache ().get<float> ("intensity", 0.5f));
+    params.iterations ((unsigned int) (this->self->cache ().get<int> ("iterations", 1)));
 
     brush.subdivide (false);
   }
@@ -41,6 +43,13 @@ struct ToolSculptSmooth::Impl
     });
     properties.addStacked (QObject::tr ("Intensity"), intensityEdit);
     this->self->registerSecondarySlider (intensityEdit);
+
+    QSpinBox& iterationsEdit = ViewUtil::spinBox (1, int(params.iterations ()), 20);
+    ViewUtil::connect (iterationsEdit, [this, &params](int n) {
+      params.iterations ((unsigned int) (n));
+      this->self->cache ().set ("iterations", n);
+    });
+    properties.add (QObject::tr ("Iterations"), iterationsEdit);
   }
 
   void runSetupToolTip (ViewToolTip& toolTip)
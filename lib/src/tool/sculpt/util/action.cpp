@@ -2,32 +2,53 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <algorithm>
+#include <chrono>
 #include <functional>
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
 #include "dynamic/faces.hpp"
 #include "dynamic/mesh.hpp"
+#include "edge-map.hpp"
 #include "intersection.hpp"
+#include "latency-profiler.hpp"
+#include "memory-report.hpp"
+#include "primitive/plane.hpp"
 #include "primitive/sphere.hpp"
 #include "primitive/triangle.hpp"
+#include "profiler.hpp"
+#include "thread-pool.hpp"
 #include "tool/sculpt/util/action.hpp"
 #include "tool/sculpt/util/brush.hpp"
-#include "tool/sculpt/util/edge-collection.hpp"
 #include "util.hpp"
 
 namespace
 {
+  typedef std::chrono::steady_clock Clock;
+
   constexpr float minEdgeLength = 0.001f;
+  constexpr float maxFlatAngle = 5.0f;
+
+  // number of dabs of a grab stroke between realignments of its faces
+  constexpr unsigned int grabRealignInterval = 8;
+
+  // number of dabs whose domains are derived from their predecessors before a full query
+  constexpr unsigned int dabRequeryInterval = 16;
+  // maximal distance of consecutive dabs, relative to their radius, whose domains are derived
+  constexpr float maxDabOverlapDistance = 0.5f;
+
+  // number of faces, vertices or edges per chunk of parallel passes
+  constexpr unsigned int elementsPerChunk = 2048;
 
   struct NewFaces
   {
-    std::vector<unsigned int>        vertexIndices;
-    std::unordered_set<unsigned int> facesToDelete;
+    std::vector<unsigned int> vertexIndices;
+    DynamicFaces              facesToDelete;
 
     void reset ()
     {
       this->vertexIndices.clear ();
-      this->facesToDelete.clear ();
+      this->facesToDelete.reset ();
     }
 
     void addFace (unsigned int i1, unsigned int i2, unsigned int i3)
@@ -43,7 +64,9 @@ namespace
     {
       assert (this->vertexIndices.size () % 3 == 0);
 
-      for (unsigned int i : this->facesToDelete)
+      const unsigned int numFacesToDelete = this->facesToDelete.uncommitted ().size ();
+
+      for (unsigned int i : this->facesToDelete.uncommitted ())
       {
         mesh.deleteFace (i);
       }
@@ -53,23 +76,301 @@ namespace
         const unsigned int f = mesh.addFace (this->vertexIndices[i + 0], this->vertexIndices[i + 1],
                                              this->vertexIndices[i + 2]);
 
-        if (i >= this->facesToDelete.size () * 3)
+        if (i >= numFacesToDelete * 3)
         {
           faces.insert (f);
         }
       }
-      return this->facesToDelete.size () <= (this->vertexIndices.size () / 3);
+      return numFacesToDelete <= (this->vertexIndices.size () / 3);
+    }
+  };
+
+  // edge that is split at a new vertex
+  struct EdgeSplit
+  {
+    unsigned int i1;
+    unsigned int i2;
+    unsigned int vertex;
+    glm::vec3    position;
+    glm::vec3    normal;
+
+    EdgeSplit (unsigned int j1, unsigned int j2)
+      : i1 (j1)
+      , i2 (j2)
+      , vertex (Util::invalidIndex ())
+    {
+    }
+  };
+
+  /* Triangulations of a face, which are indexed by the mask of its split edges `e12`, `e13` and
+   * `e23`, and by whether the end points of its only unsplit edge have descending valences.
+   * Corners 0 to 2 refer to `i1`, `i2` and `i3`, corners 3 to 5 to `e12`, `e13` and `e23`.
+   */
+  struct Triangulation
+  {
+    unsigned int numFaces;
+    unsigned int corners[4][3];
+  };
+
+  const Triangulation triangulations[8][2] = {
+    {{0, {}}, {0, {}}},
+    {{2, {{0, 3, 2}, {2, 3, 1}}}, {2, {{0, 3, 2}, {2, 3, 1}}}},
+    {{2, {{2, 4, 1}, {1, 4, 0}}}, {2, {{2, 4, 1}, {1, 4, 0}}}},
+    {{3, {{3, 4, 0}, {1, 2, 4}, {1, 4, 3}}}, {3, {{3, 4, 0}, {2, 3, 1}, {2, 4, 3}}}},
+    {{2, {{1, 5, 0}, {0, 5, 2}}}, {2, {{1, 5, 0}, {0, 5, 2}}}},
+    {{3, {{5, 3, 1}, {0, 5, 2}, {0, 3, 5}}}, {3, {{5, 3, 1}, {2, 0, 3}, {2, 3, 5}}}},
+    {{3, {{4, 5, 2}, {0, 1, 5}, {0, 5, 4}}}, {3, {{4, 5, 2}, {1, 4, 0}, {1, 5, 4}}}},
+    {{4, {{3, 5, 4}, {0, 3, 4}, {1, 5, 3}, {2, 4, 5}}},
+     {4, {{3, 5, 4}, {0, 3, 4}, {1, 5, 3}, {2, 4, 5}}}}};
+
+  // corners of the edges `e12`, `e13` and `e23`, which are indexed by their bits of a mask
+  const unsigned int edgeCorners[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+
+  // edge of a collapse queue, whose top is the edge with the smallest key
+  struct CollapseEdge
+  {
+    float        key;
+    unsigned int i1;
+    unsigned int i2;
+
+    CollapseEdge (float k, unsigned int j1, unsigned int j2)
+      : key (k)
+      , i1 (j1)
+      , i2 (j2)
+    {
+    }
+
+    bool operator< (const CollapseEdge& other) const { return this->key > other.key; }
+  };
+
+  // sum of squared distances to planes, which are weighted by the areas of their faces
+  struct Quadric
+  {
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+    Quadric ()
+      : a2 (0.0)
+      , ab (0.0)
+      , ac (0.0)
+      , ad (0.0)
+      , b2 (0.0)
+      , bc (0.0)
+      , bd (0.0)
+      , c2 (0.0)
+      , cd (0.0)
+      , d2 (0.0)
+    {
+    }
+
+    Quadric (const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3)
+    {
+      const glm::vec3 cross = glm::cross (p2 - p1, p3 - p1);
+      const double    area = 0.5 * double(glm::length (cross));
+      const glm::vec3 n = area > 0.0 ? glm::normalize (cross) : glm::vec3 (0.0f);
+      const double    a = n.x, b = n.y, c = n.z, d = -double(glm::dot (n, p1));
+
+      this->a2 = area * a * a;
+      this->ab = area * a * b;
+      this->ac = area * a * c;
+      this->ad = area * a * d;
+      this->b2 = area * b * b;
+      this->bc = area * b * c;
+      this->bd = area * b * d;
+      this->c2 = area * c * c;
+      this->cd = area * c * d;
+      this->d2 = area * d * d;
+    }
+
+    Quadric operator+ (const Quadric& o) const
+    {
+      Quadric q;
+      q.a2 = this->a2 + o.a2;
+      q.ab = this->ab + o.ab;
+      q.ac = this->ac + o.ac;
+      q.ad = this->ad + o.ad;
+      q.b2 = this->b2 + o.b2;
+      q.bc = this->bc + o.bc;
+      q.bd = this->bd + o.bd;
+      q.c2 = this->c2 + o.c2;
+      q.cd = this->cd + o.cd;
+      q.d2 = this->d2 + o.d2;
+      return q;
+    }
+
+    float error (const glm::vec3& p) const
+    {
+      const double x = p.x, y = p.y, z = p.z;
+
+      return float((this->a2 * x * x) + (2.0 * this->ab * x * y) + (2.0 * this->ac * x * z) +
+                   (2.0 * this->ad * x) + (this->b2 * y * y) + (2.0 * this->bc * y * z) +
+                   (2.0 * this->bd * y) + (this->c2 * z * z) + (2.0 * this->cd * z) + this->d2);
+    }
+  };
+
+  // domains of the dabs of an open batch, whose final pass is deferred until it is flushed
+  struct Batch
+  {
+    bool         isOpen;
+    DynamicMesh* mesh;
+    DynamicFaces faces;
+
+    Batch ()
+      : isOpen (false)
+      , mesh (nullptr)
+    {
+    }
+  };
+
+  /* Vertices that are moved by a grab stroke and their weights, which are captured by the first
+   * dab of the stroke.  Subsequent dabs continue the stroke if their mesh has not been modified
+   * in between and if they start where the previous dab ended.
+   */
+  struct GrabDomain
+  {
+    DynamicMesh*              mesh;
+    unsigned int              revision;
+    glm::vec3                 position;
+    std::vector<unsigned int> vertices;
+    std::vector<float>        weights;
+    DynamicFaces              faces;
+    unsigned int              numUnaligned;
+
+    GrabDomain ()
+      : mesh (nullptr)
+      , revision (0)
+      , numUnaligned (0)
+    {
+    }
+
+    bool isContinuedBy (const SculptBrush& brush) const
+    {
+      return this->mesh == &brush.mesh () && this->revision == brush.mesh ().revision () &&
+             this->position == brush.lastPosition ();
+    }
+
+    void displace (const glm::vec3& delta)
+    {
+      LatencyTimer timer (LatencyStage::Deform);
+
+      for (unsigned int k = 0; k < this->vertices.size (); k++)
+      {
+        const unsigned int i = this->vertices[k];
+        this->mesh->vertex (i, this->mesh->vertex (i) + (this->weights[k] * delta));
+      }
+    }
+  };
+
+  /* Faces within the sphere of the previous dab, regardless of their orientation, including the
+   * faces that have been created around collapsed edges.  A subsequent dab derives its domain from
+   * these faces if it overlaps the previous dab and if its mesh has not been modified in between.
+   */
+  struct DabDomain
+  {
+    DynamicMesh* mesh;
+    unsigned int revision;
+    PrimSphere   sphere;
+    DynamicFaces faces;
+    unsigned int numDerived;
+
+    DabDomain ()
+      : mesh (nullptr)
+      , revision (0)
+      , sphere (glm::vec3 (0.0f), 0.0f)
+      , numDerived (0)
+    {
+    }
+
+    bool isContinuedBy (const SculptBrush& brush) const
+    {
+      const PrimSphere s = brush.sphere ();
+
+      return this->mesh == &brush.mesh () && this->revision == brush.mesh ().revision () &&
+             this->numDerived < dabRequeryInterval && this->sphere.radius () == s.radius () &&
+             glm::distance (this->sphere.center (), s.center ()) <=
+               maxDabOverlapDistance * s.radius ();
+    }
+  };
+
+  // subdivision of a dab's domain that has been deferred
+  struct Refinement
+  {
+    DynamicMesh* mesh;
+    PrimSphere   sphere;
+    float        maxLength;
+
+    Refinement (DynamicMesh& m, const PrimSphere& s, float l)
+      : mesh (&m)
+      , sphere (s)
+      , maxLength (l)
+    {
+    }
+  };
+
+  struct Refinements
+  {
+    std::vector<Refinement> deferred;
+    bool                    hasDeadline;
+    Clock::time_point       deadline;
+
+    Refinements ()
+      : hasDeadline (false)
+    {
     }
+
+    bool isExpired () const { return this->hasDeadline && Clock::now () >= this->deadline; }
+  };
+
+  // corners of a face and of the splits of its edges, and the triangulation of the split face
+  struct FaceSplit
+  {
+    unsigned int         corners[6];
+    const Triangulation* triangulation;
+  };
+
+  /* Temporary containers of the sculpt actions.  They are kept across calls, so that their
+   * storage is reused and a stroke does not allocate once the containers have grown large
+   * enough.  Sculpt actions never nest.  Each thread has its own containers, since meshes are
+   * also simplified in the background (cf. `ToolSculptAction::simplifyMesh`).
+   */
+  struct Scratch
+  {
+    DynamicFaces                                     affectedFaces;
+    DynamicFaces                                     mirroredFaces;
+    DynamicFaces                                     frontier;
+    DynamicFaces                                     extendedFrontier;
+    std::vector<CollapseEdge>                        collapseQueue;
+    std::vector<Quadric>                             quadrics;
+    DynamicFaces                                     collapseCreated;
+    NewFaces                                         newFaces;
+    EdgeMap                                          newEdges;
+    std::vector<EdgeSplit>                           edgeSplits;
+    std::vector<unsigned char>                       splitMasks;
+    std::vector<unsigned int>                        splitFaces;
+    std::vector<FaceSplit>                           faceSplits;
+    EdgeSet                                          relaxableEdges;
+    std::vector<unsigned int>                        domainVertices;
+    std::vector<glm::vec3>                           newPositions;
+    Batch                                            batch;
+    GrabDomain                                       grabDomain;
+    DabDomain                                        dabDomain;
+    Refinements                                      refinements;
   };
 
-  void extendAndFilterDomain (const SculptBrush& brush, DynamicFaces& faces, unsigned int numRings)
+  Scratch& scratch ()
+  {
+    static thread_local Scratch instance;
+    return instance;
+  }
+
+  void extendAndFilterDomain (const DynamicMesh& mesh, const PrimSphere& sphere,
+                              DynamicFaces& faces, unsigned int numRings)
   {
     assert (faces.hasUncomitted () == false);
-    const DynamicMesh& mesh = brush.mesh ();
-    const PrimSphere   sphere = brush.sphere ();
 
-    std::unordered_set<unsigned int> frontier;
+    DynamicFaces& frontier = scratch ().frontier;
+    DynamicFaces& extendedFrontier = scratch ().extendedFrontier;
 
+    frontier.reset ();
     faces.filter ([&mesh, &sphere, &frontier](unsigned int i) {
       const PrimTriangle face = mesh.face (i);
 
@@ -83,10 +384,11 @@ namespace
       }
       return true;
     });
+    frontier.commit ();
 
     for (unsigned int ring = 0; ring < numRings; ring++)
     {
-      std::unordered_set<unsigned int> extendedFrontier;
+      extendedFrontier.reset ();
 
       for (unsigned int i : frontier)
       {
@@ -94,7 +396,7 @@ namespace
           i, [&mesh, &faces, &frontier, &extendedFrontier](unsigned int v) {
             for (unsigned int a : mesh.adjacentFaces (v))
             {
-              if (faces.contains (a) == false && frontier.find (a) == frontier.end ())
+              if (faces.contains (a) == false && frontier.contains (a) == false)
               {
                 faces.insert (a);
                 extendedFrontier.insert (a);
@@ -103,7 +405,8 @@ namespace
           });
       }
       faces.commit ();
-      frontier = std::move (extendedFrontier);
+      extendedFrontier.commit ();
+      std::swap (frontier, extendedFrontier);
     }
   }
 
@@ -173,152 +476,148 @@ namespace
     }
   }
 
-  void splitEdges (DynamicMesh& mesh, ToolSculptEdgeMap& newE, float maxLength, DynamicFaces& faces)
+  /* Splits all edges of the domain that are longer than `maxLength`, which maps them to their
+   * splits.  Edge lengths and split positions are computed in parallel and the new vertices are
+   * added in one batch.  Faces without long edges are removed from the domain.
+   */
+  void splitEdges (DynamicMesh& mesh, EdgeMap& newE, std::vector<EdgeSplit>& splits,
+                   float maxLength, DynamicFaces& faces)
   {
     assert (faces.hasUncomitted () == false);
 
-    const auto split = [&mesh, &newE, maxLength](unsigned int i1, unsigned int i2) {
-      if (glm::distance2 (mesh.vertex (i1), mesh.vertex (i2)) > maxLength * maxLength)
-      {
-        const glm::vec3 normal = glm::normalize (mesh.vertexNormal (i1) + mesh.vertexNormal (i2));
-        const unsigned int i3 = mesh.addVertex (getSplitPosition (mesh, i1, i2), normal);
-        newE.insert (i1, i2, i3);
-        return true;
-      }
-      else
-      {
-        return false;
-      }
+    std::vector<unsigned char>& masks = scratch ().splitMasks;
+    const float                 maxLengthSqr = maxLength * maxLength;
+
+    const auto isLong = [&mesh, maxLengthSqr](unsigned int i1, unsigned int i2) {
+      return glm::distance2 (mesh.vertex (i1), mesh.vertex (i2)) > maxLengthSqr;
     };
 
-    faces.filter ([&mesh, &newE, &split](unsigned int f) {
-      bool wasSplit = false;
+    masks.resize (faces.numElements ());
+    ThreadPool::global ().parallelFor (
+      faces.numElements (), elementsPerChunk, [&](unsigned int first, unsigned int last) {
+        for (unsigned int k = first; k < last; k++)
+        {
+          unsigned int i1, i2, i3;
+          mesh.vertexIndices (faces.indices ()[k], i1, i2, i3);
 
-      unsigned int i1, i2, i3;
-      mesh.vertexIndices (f, i1, i2, i3);
+          masks[k] = (isLong (i1, i2) ? 1 : 0) | (isLong (i1, i3) ? 2 : 0) |
+                     (isLong (i2, i3) ? 4 : 0);
+        }
+      });
 
-      if (newE.contains (i1, i2) == false)
+    const auto insert = [&newE, &splits](unsigned int i1, unsigned int i2) {
+      bool inserted;
+      newE.findOrInsert (i1, i2, splits.size (), inserted);
+      if (inserted)
       {
-        wasSplit = split (i1, i2) || wasSplit;
+        splits.emplace_back (i1, i2);
       }
+    };
 
-      if (newE.contains (i1, i3) == false)
-      {
-        wasSplit = split (i1, i3) || wasSplit;
-      }
+    unsigned int k = 0;
+    faces.filter ([&mesh, &masks, &insert, &k](unsigned int f) {
+      const unsigned char mask = masks[k++];
 
-      if (newE.contains (i2, i3) == false)
+      if (mask != 0)
       {
-        wasSplit = split (i2, i3) || wasSplit;
+        unsigned int i[3];
+        mesh.vertexIndices (f, i[0], i[1], i[2]);
+
+        for (unsigned int e = 0; e < 3; e++)
+        {
+          if (mask & (1 << e))
+          {
+            insert (i[edgeCorners[e][0]], i[edgeCorners[e][1]]);
+          }
+        }
       }
-      return wasSplit;
+      return mask != 0;
     });
+
+    ThreadPool::global ().parallelFor (
+      splits.size (), elementsPerChunk, [&mesh, &splits](unsigned int first, unsigned int last) {
+        for (unsigned int s = first; s < last; s++)
+        {
+          EdgeSplit& split = splits[s];
+
+          split.position = getSplitPosition (mesh, split.i1, split.i2);
+          split.normal =
+            glm::normalize (mesh.vertexNormal (split.i1) + mesh.vertexNormal (split.i2));
+        }
+      });
+
+    for (EdgeSplit& split : splits)
+    {
+      split.vertex = mesh.addVertex (split.position, split.normal);
+      mesh.mask (split.vertex, 0.5f * (mesh.mask (split.i1) + mesh.mask (split.i2)));
+    }
   }
 
-  void triangulate (DynamicMesh& mesh, const ToolSculptEdgeMap& newE, DynamicFaces& faces)
+  /* Replaces faces of the domain and their neighbors by triangulations of their split edges.  The
+   * triangulations only read the mesh, so they are chosen in parallel.  The faces are replaced
+   * afterwards in the order of the domain, since that modifies shared adjacency.
+   */
+  void triangulate (DynamicMesh& mesh, const EdgeMap& newE, const std::vector<EdgeSplit>& splits,
+                    DynamicFaces& faces)
   {
     assert (faces.hasUncomitted () == false);
 
-    NewFaces newF;
+    std::vector<unsigned int>& splitFaces = scratch ().splitFaces;
+    std::vector<FaceSplit>&    faceSplits = scratch ().faceSplits;
+    NewFaces&                  newF = scratch ().newFaces;
 
-    mesh.forEachFaceExt (faces, [&mesh, &newE, &newF](unsigned int f) {
-      unsigned int i1, i2, i3;
-      mesh.vertexIndices (f, i1, i2, i3);
+    splitFaces.clear ();
+    mesh.forEachFaceExt (faces, [&splitFaces](unsigned int f) { splitFaces.push_back (f); });
+    faceSplits.resize (splitFaces.size ());
 
-      const unsigned int e12 = newE.find (i1, i2);
-      const unsigned int e13 = newE.find (i1, i3);
-      const unsigned int e23 = newE.find (i2, i3);
-      const unsigned int invalid = Util::invalidIndex ();
+    ThreadPool::global ().parallelFor (
+      splitFaces.size (), elementsPerChunk, [&](unsigned int first, unsigned int last) {
+        for (unsigned int k = first; k < last; k++)
+        {
+          FaceSplit&   split = faceSplits[k];
+          unsigned int mask = 0;
 
-      const unsigned int v1 = mesh.valence (i1);
-      const unsigned int v2 = mesh.valence (i2);
-      const unsigned int v3 = mesh.valence (i3);
+          mesh.vertexIndices (splitFaces[k], split.corners[0], split.corners[1],
+                              split.corners[2]);
 
-      if (e12 == invalid && e13 == invalid && e23 == invalid)
-      {
-      }
-      // One new vertex
-      else if (e12 != invalid && e13 == invalid && e23 == invalid)
-      {
-        newF.deleteFace (f);
-        newF.addFace (i1, e12, i3);
-        newF.addFace (i3, e12, i2);
-      }
-      else if (e12 == invalid && e13 != invalid && e23 == invalid)
-      {
-        newF.deleteFace (f);
-        newF.addFace (i3, e13, i2);
-        newF.addFace (i2, e13, i1);
-      }
-      else if (e12 == invalid && e13 == invalid && e23 != invalid)
-      {
-        newF.deleteFace (f);
-        newF.addFace (i2, e23, i1);
-        newF.addFace (i1, e23, i3);
-      }
-      // Two new vertices
-      else if (e12 != invalid && e13 != invalid && e23 == invalid)
-      {
-        newF.deleteFace (f);
-        newF.addFace (e12, e13, i1);
+          for (unsigned int e = 0; e < 3; e++)
+          {
+            const unsigned int s =
+              newE.find (split.corners[edgeCorners[e][0]], split.corners[edgeCorners[e][1]]);
 
-        if (v2 < v3)
-        {
-          newF.addFace (i2, i3, e13);
-          newF.addFace (i2, e13, e12);
-        }
-        else
-        {
-          newF.addFace (i3, e12, i2);
-          newF.addFace (i3, e13, e12);
-        }
-      }
-      else if (e12 != invalid && e13 == invalid && e23 != invalid)
-      {
-        newF.deleteFace (f);
-        newF.addFace (e23, e12, i2);
+            if (s != Util::invalidIndex ())
+            {
+              split.corners[3 + e] = splits[s].vertex;
+              mask |= 1 << e;
+            }
+          }
 
-        if (v1 < v3)
-        {
-          newF.addFace (i1, e23, i3);
-          newF.addFace (i1, e12, e23);
-        }
-        else
-        {
-          newF.addFace (i3, i1, e12);
-          newF.addFace (i3, e12, e23);
+          const unsigned int unsplit = mask == 3 ? 2 : (mask == 5 ? 1 : (mask == 6 ? 0 : 3));
+          const bool         descending =
+            unsplit < 3 && mesh.valence (split.corners[edgeCorners[unsplit][0]]) >=
+                             mesh.valence (split.corners[edgeCorners[unsplit][1]]);
+
+          split.triangulation = mask == 0 ? nullptr : &triangulations[mask][descending ? 1 : 0];
         }
-      }
-      else if (e12 == invalid && e13 != invalid && e23 != invalid)
+      });
+
+    newF.reset ();
+    for (unsigned int k = 0; k < splitFaces.size (); k++)
+    {
+      const FaceSplit& split = faceSplits[k];
+
+      if (split.triangulation)
       {
-        newF.deleteFace (f);
-        newF.addFace (e13, e23, i3);
+        const Triangulation& t = *split.triangulation;
 
-        if (v1 < v2)
-        {
-          newF.addFace (i1, i2, e23);
-          newF.addFace (i1, e23, e13);
-        }
-        else
+        newF.deleteFace (splitFaces[k]);
+        for (unsigned int n = 0; n < t.numFaces; n++)
         {
-          newF.addFace (i2, e13, i1);
-          newF.addFace (i2, e23, e13);
+          newF.addFace (split.corners[t.corners[n][0]], split.corners[t.corners[n][1]],
+                        split.corners[t.corners[n][2]]);
         }
       }
-      // Three new vertices
-      else if (e12 != invalid && e13 != invalid && e23 != invalid)
-      {
-        newF.deleteFace (f);
-        newF.addFace (e12, e23, e13);
-        newF.addFace (i1, e12, e13);
-        newF.addFace (i2, e23, e12);
-        newF.addFace (i3, e13, e23);
-      }
-      else
-      {
-        DILAY_IMPOSSIBLE
-      }
-    });
+    }
     const bool increasing = newF.applyToMesh (mesh, faces);
     assert (increasing);
     unused (increasing);
@@ -326,10 +625,9 @@ namespace
     faces.commit ();
   }
 
-  void relaxEdges (DynamicMesh& mesh, const DynamicFaces& faces)
+  // flips edges of high-valence vertices if that brings the valences of their quads closer to 6
+  void relaxEdges (DynamicMesh& mesh, const std::vector<unsigned int>& vertices)
   {
-    assert (faces.hasUncomitted () == false);
-
     const auto isRelaxable = [&mesh](const ui_pair& edge, unsigned int leftVertex,
                                      unsigned int rightVertex) {
       const int vE1 = int(mesh.valence (edge.first));
@@ -345,14 +643,17 @@ namespace
       return (vE1 > 3) && (vE2 > 3) && (post < pre);
     };
 
-    ToolSculptEdgeSet edgeSet;
-    mesh.forEachVertex (faces, [&mesh, &edgeSet](unsigned int i) {
+    EdgeSet& edgeSet = scratch ().relaxableEdges;
+    edgeSet.reset ();
+
+    for (unsigned int i : vertices)
+    {
       if (mesh.valence (i) > 6)
       {
         mesh.forEachVertexAdjacentToVertex (
           i, [i, &edgeSet](unsigned int j) { edgeSet.insert (i, j); });
       }
-    });
+    }
 
     for (const ui_pair& edge : edgeSet)
     {
@@ -375,11 +676,16 @@ namespace
     }
   }
 
-  void smooth (DynamicMesh& mesh, DynamicFaces& faces)
+  /* Moves each vertex to the projection of the tangential component of its neighbors' average
+   * onto its adjacent faces.  New positions are computed in parallel into an array that is indexed
+   * like `vertices`, and are written back afterwards.
+   */
+  void smooth (DynamicMesh& mesh, const std::vector<unsigned int>& vertices)
   {
-    std::unordered_map<unsigned int, glm::vec3> newPosition;
+    std::vector<glm::vec3>& newPositions = scratch ().newPositions;
+    newPositions.resize (vertices.size ());
 
-    mesh.forEachVertex (faces, [&mesh, &newPosition](unsigned int i) {
+    const auto newPosition = [&mesh](unsigned int i) {
       const glm::vec3  avgPos = mesh.averagePosition (i);
       const glm::vec3& normal = mesh.vertexNormal (i);
       const glm::vec3  delta = avgPos - mesh.vertex (i);
@@ -421,22 +727,45 @@ namespace
           }
         }
       }
-      if (minDistance != Util::maxFloat ())
-      {
-        newPosition.emplace (i, projectedPos);
-      }
-      else
-      {
-        newPosition.emplace (i, tangentialPos);
-      }
-    });
+      return minDistance != Util::maxFloat () ? projectedPos : tangentialPos;
+    };
+
+    ThreadPool::global ().parallelFor (
+      vertices.size (), elementsPerChunk, [&](unsigned int first, unsigned int last) {
+        for (unsigned int k = first; k < last; k++)
+        {
+          const unsigned int i = vertices[k];
+
+          newPositions[k] = glm::mix (newPosition (i), mesh.vertex (i), mesh.mask (i));
+        }
+      });
 
-    for (const auto& it : newPosition)
+    for (unsigned int k = 0; k < vertices.size (); k++)
     {
-      mesh.vertex (it.first, it.second);
+      mesh.vertex (vertices[k], newPositions[k]);
     }
   }
 
+  const std::vector<unsigned int>& domainVertices (DynamicMesh& mesh, const DynamicFaces& faces)
+  {
+    std::vector<unsigned int>& vertices = scratch ().domainVertices;
+
+    vertices.clear ();
+    mesh.forEachVertex (faces, [&vertices](unsigned int i) { vertices.push_back (i); });
+    return vertices;
+  }
+
+  void relaxEdges (DynamicMesh& mesh, const DynamicFaces& faces)
+  {
+    assert (faces.hasUncomitted () == false);
+    relaxEdges (mesh, domainVertices (mesh, faces));
+  }
+
+  void smooth (DynamicMesh& mesh, const DynamicFaces& faces)
+  {
+    smooth (mesh, domainVertices (mesh, faces));
+  }
+
   bool deleteValence3Vertex (DynamicMesh& mesh, unsigned int i, DynamicFaces& faces)
   {
     assert (mesh.isFreeVertex (i) == false);
@@ -446,50 +775,17 @@ namespace
     const unsigned int adj2 = mesh.adjacentFaces (i)[1];
     const unsigned int adj3 = mesh.adjacentFaces (i)[2];
 
-    unsigned int adj11, adj12, adj13;
-    mesh.vertexIndices (adj1, adj11, adj12, adj13);
-
-    unsigned int adj21, adj22, adj23;
-    mesh.vertexIndices (adj2, adj21, adj22, adj23);
-
-    unsigned int newI1, newI2, newI3;
-
-    if (i == adj11)
-    {
-      newI1 = adj12;
-      newI2 = adj13;
-    }
-    else if (i == adj12)
+    unsigned int h = 3 * adj1;
+    while (mesh.halfEdgeSource (h) != i)
     {
-      newI1 = adj13;
-      newI2 = adj11;
-    }
-    else if (i == adj13)
-    {
-      newI1 = adj11;
-      newI2 = adj12;
-    }
-    else
-    {
-      DILAY_IMPOSSIBLE
+      h = mesh.nextHalfEdge (h);
     }
 
-    if (adj21 != newI1 && adj21 != newI2)
-    {
-      newI3 = adj21;
-    }
-    else if (adj22 != newI1 && adj22 != newI2)
-    {
-      newI3 = adj22;
-    }
-    else if (adj23 != newI1 && adj23 != newI2)
-    {
-      newI3 = adj23;
-    }
-    else
-    {
-      DILAY_IMPOSSIBLE
-    }
+    const unsigned int newI1 = mesh.halfEdgeTarget (h);
+    const unsigned int newI2 = mesh.halfEdgeTarget (mesh.nextHalfEdge (h));
+    const unsigned int newI3 =
+      mesh.halfEdgeTarget (mesh.nextHalfEdge (mesh.oppositeHalfEdge (h)));
+
     assert (newI1 != newI2);
     assert (newI1 != newI3);
     assert (newI2 != newI3);
@@ -511,7 +807,8 @@ namespace
     }
   };
 
-  bool collapseEdge (DynamicMesh& mesh, unsigned int i1, unsigned int i2, DynamicFaces faces)
+  unsigned int collapseEdge (DynamicMesh& mesh, unsigned int i1, unsigned int i2,
+                             DynamicFaces& faces)
   {
     const unsigned int v1 = mesh.valence (i1);
     const unsigned int v2 = mesh.valence (i2);
@@ -525,22 +822,14 @@ namespace
       assert (mesh.isFreeVertex (i1) == false);
       assert (mesh.isFreeVertex (i2) == false);
 
-      for (unsigned int a : mesh.adjacentFaces (i1))
-      {
-        unsigned int a1, a2, a3;
-        mesh.vertexIndices (a, a1, a2, a3);
-
-        if (i2 == a1 || i2 == a2 || i2 == a3)
-        {
-          return true;
-        }
-      }
-      return false;
+      return mesh.halfEdge (i1, i2) != Util::invalidIndex () ||
+             mesh.halfEdge (i2, i1) != Util::invalidIndex ();
     };
     assert (isValidEdge (i1, i2));
 #endif
 
-    NewFaces newFaces;
+    NewFaces& newFaces = scratch ().newFaces;
+    newFaces.reset ();
 
     const auto addFaces = [&mesh, &newFaces](unsigned int newI, unsigned int i1, unsigned int i2) {
       for (unsigned int a : mesh.adjacentFaces (i1))
@@ -614,17 +903,19 @@ namespace
     };
 
     const glm::vec3 newPos = Util::midpoint (mesh.vertex (i1), mesh.vertex (i2));
+    const float     newMask = 0.5f * (mesh.mask (i1) + mesh.mask (i2));
 
     if (v1 == 3)
     {
       if (deleteValence3Vertex (mesh, i1, faces))
       {
         mesh.vertex (i2, newPos);
-        return true;
+        mesh.mask (i2, newMask);
+        return i2;
       }
       else
       {
-        return false;
+        return Util::invalidIndex ();
       }
     }
     if (v2 == 3)
@@ -632,11 +923,12 @@ namespace
       if (deleteValence3Vertex (mesh, i2, faces))
       {
         mesh.vertex (i1, newPos);
-        return true;
+        mesh.mask (i1, newMask);
+        return i1;
       }
       else
       {
-        return false;
+        return Util::invalidIndex ();
       }
     }
 
@@ -651,15 +943,16 @@ namespace
 
     if (leftVertex == rightVertex)
     {
-      return false;
+      return Util::invalidIndex ();
     }
     else if (vLeftVertex == 3 || vRightVertex == 3)
     {
-      return false;
+      return Util::invalidIndex ();
     }
     else if (numCommonAdjacentVertices () == 2)
     {
       const unsigned int newI = mesh.addVertex (newPos, glm::vec3 (0.0f));
+      mesh.mask (newI, newMask);
 
       addFaces (newI, i1, i2);
       addFaces (newI, i2, i1);
@@ -676,78 +969,435 @@ namespace
       assert (mesh.isFreeVertex (i2));
       assert (mesh.valence (newI) == v1 + v2 - 4);
 
-      return true;
+      return newI;
     }
     else
     {
-      return false;
+      return Util::invalidIndex ();
     }
   }
 
-  typedef std::function<bool(unsigned int, unsigned int)> CollapsePredicate;
-  bool collapseEdges (DynamicMesh& mesh, const CollapsePredicate& doCollapse, DynamicFaces& faces)
+  // checks if moving `i` to `p` flips a face that is not adjacent to `other`
+  bool flipsFace (const DynamicMesh& mesh, unsigned int i, unsigned int other, const glm::vec3& p)
   {
-    bool         collapsed = false;
-    DynamicFaces current;
-    current.insert (faces.indices ());
-
-    do
+    for (unsigned int a : mesh.adjacentFaces (i))
     {
-      faces.insert (current.uncommitted ());
-      current.commit ();
+      unsigned int a1, a2, a3;
+      mesh.vertexIndices (a, a1, a2, a3);
 
-      for (unsigned int i : current)
+      if (a1 != other && a2 != other && a3 != other)
       {
-        if (mesh.isFreeFace (i) == false)
-        {
-          unsigned int i1, i2, i3;
-          mesh.vertexIndices (i, i1, i2, i3);
+        const glm::vec3 v1 = a1 == i ? p : mesh.vertex (a1);
+        const glm::vec3 v2 = a2 == i ? p : mesh.vertex (a2);
+        const glm::vec3 v3 = a3 == i ? p : mesh.vertex (a3);
 
-          if (doCollapse (i1, i2))
-          {
-            collapsed = collapseEdge (mesh, i1, i2, current) || collapsed;
-          }
-          else if (doCollapse (i1, i3))
-          {
-            collapsed = collapseEdge (mesh, i1, i3, current) || collapsed;
-          }
-          else if (doCollapse (i2, i3))
-          {
-            collapsed = collapseEdge (mesh, i2, i3, current) || collapsed;
-          }
+        if (glm::dot (glm::cross (v2 - v1, v3 - v1), mesh.faceNormal (a)) <= 0.0f)
+        {
+          return true;
         }
       }
-    } while (current.uncommitted ().empty () == false);
-
-    faces.filter ([&mesh](unsigned int f) { return mesh.isFreeFace (f) == false; });
-    faces.commit ();
-    return collapsed;
+    }
+    return false;
   }
 
-  bool collapseEdgesByLength (DynamicMesh& mesh, float maxEdgeLengthSqr, DynamicFaces& faces)
+  typedef std::function<bool(unsigned int, unsigned int)> CollapsePredicate;
+
+  /* Collapses edges in order of increasing length.  Entries of the queue are validated when they
+   * are popped: entries of deleted edges are dropped and entries of edges that have become longer
+   * are pushed again, such that the queue never has to be searched.  The edges of vertices that
+   * remain from a collapse are pushed again, as are their faces to the domain.
+   */
+  bool collapseEdges (DynamicMesh& mesh, const CollapsePredicate& doCollapse, DynamicFaces& faces)
   {
-    const auto isCollapsable = [&mesh, maxEdgeLengthSqr](unsigned int i1, unsigned i2) -> bool {
-      assert (mesh.isFreeVertex (i1) == false);
-      assert (mesh.isFreeVertex (i2) == false);
+    bool                       collapsed = false;
+    std::vector<CollapseEdge>& queue = scratch ().collapseQueue;
+    DynamicFaces&              created = scratch ().collapseCreated;
 
-      return glm::distance2 (mesh.vertex (i1), mesh.vertex (i2)) < maxEdgeLengthSqr;
+    const auto push = [&mesh, &doCollapse, &queue](unsigned int i1, unsigned int i2) {
+      if (doCollapse (i1, i2))
+      {
+        queue.emplace_back (glm::distance2 (mesh.vertex (i1), mesh.vertex (i2)), i1, i2);
+        std::push_heap (queue.begin (), queue.end ());
+      }
     };
-    return collapseEdges (mesh, isCollapsable, faces);
-  }
 
-  bool collapseAllEdges (DynamicMesh& mesh, DynamicFaces& faces)
+    queue.clear ();
+    for (unsigned int f : faces)
+    {
+      for (unsigned int h = 3 * f; h < (3 * f) + 3; h++)
+      {
+        if (mesh.halfEdgeSource (h) < mesh.halfEdgeTarget (h))
+        {
+          push (mesh.halfEdgeSource (h), mesh.halfEdgeTarget (h));
+        }
+      }
+    }
+
+    while (queue.empty () == false)
+    {
+      std::pop_heap (queue.begin (), queue.end ());
+      const CollapseEdge edge = queue.back ();
+      queue.pop_back ();
+
+      if (mesh.isFreeVertex (edge.i1) || mesh.isFreeVertex (edge.i2) ||
+          mesh.halfEdge (edge.i1, edge.i2) == Util::invalidIndex ())
+      {
+        continue;
+      }
+      else if (glm::distance2 (mesh.vertex (edge.i1), mesh.vertex (edge.i2)) > edge.key)
+      {
+        push (edge.i1, edge.i2);
+        continue;
+      }
+      else if (doCollapse (edge.i1, edge.i2) == false)
+      {
+        continue;
+      }
+
+      created.reset ();
+      const unsigned int i = collapseEdge (mesh, edge.i1, edge.i2, created);
+
+      if (i != Util::invalidIndex ())
+      {
+        collapsed = true;
+
+        for (unsigned int a : mesh.adjacentFaces (i))
+        {
+          faces.insert (a);
+        }
+        mesh.forEachVertexAdjacentToVertex (i, [i, &push](unsigned int a) { push (i, a); });
+      }
+    }
+
+    faces.filter ([&mesh](unsigned int f) { return mesh.isFreeFace (f) == false; });
+    faces.commit ();
+    return collapsed;
+  }
+
+  bool collapseEdgesByLength (DynamicMesh& mesh, float maxEdgeLengthSqr, DynamicFaces& faces)
+  {
+    const auto isCollapsable = [&mesh, maxEdgeLengthSqr](unsigned int i1, unsigned i2) -> bool {
+      assert (mesh.isFreeVertex (i1) == false);
+      assert (mesh.isFreeVertex (i2) == false);
+
+      return glm::distance2 (mesh.vertex (i1), mesh.vertex (i2)) < maxEdgeLengthSqr;
+    };
+    return collapseEdges (mesh, isCollapsable, faces);
+  }
+
+  /* Collapses short edges whose surrounding faces deviate at most `maxAngle` from their average.
+   * Collapses that would flip a face, e.g. on thin features, are skipped.
+   */
+  bool collapseFlatEdges (DynamicMesh& mesh, float maxEdgeLengthSqr, float maxAngle,
+                          DynamicFaces& faces)
+  {
+    const float minCosAngle = glm::cos (maxAngle);
+
+    const auto isFlat = [&mesh, minCosAngle](unsigned int i, const glm::vec3& normal) -> bool {
+      for (unsigned int a : mesh.adjacentFaces (i))
+      {
+        if ((glm::dot (mesh.faceNormal (a), normal) >= minCosAngle) == false)
+        {
+          return false;
+        }
+      }
+      return true;
+    };
+
+    const auto isCollapsable = [&mesh, maxEdgeLengthSqr, &isFlat](unsigned int i1,
+                                                                  unsigned i2) -> bool {
+      assert (mesh.isFreeVertex (i1) == false);
+      assert (mesh.isFreeVertex (i2) == false);
+
+      if (glm::distance2 (mesh.vertex (i1), mesh.vertex (i2)) < maxEdgeLengthSqr)
+      {
+        const glm::vec3 normal = glm::normalize (mesh.averageNormal (i1) + mesh.averageNormal (i2));
+        const glm::vec3 newPos = Util::midpoint (mesh.vertex (i1), mesh.vertex (i2));
+
+        return isFlat (i1, normal) && isFlat (i2, normal) &&
+               flipsFace (mesh, i1, i2, newPos) == false &&
+               flipsFace (mesh, i2, i1, newPos) == false;
+      }
+      return false;
+    };
+    return collapseEdges (mesh, isCollapsable, faces);
+  }
+
+  bool collapseAllEdges (DynamicMesh& mesh, DynamicFaces& faces)
   {
     return collapseEdges (mesh, [](unsigned int, unsigned int) { return true; }, faces);
   }
 
   void finalize (DynamicMesh& mesh, const DynamicFaces& faces)
   {
-    mesh.forEachVertex (faces, [&mesh](unsigned int i) { mesh.setVertexNormal (i); });
+    PROFILE_ZONE ("sculpt/finalize")
+    LatencyTimer timer (LatencyStage::Finalize);
+
+    mesh.setVertexNormals (faces);
+    mesh.realignFaces (faces);
+  }
+
+  // finalizes the domain of a dab or adds it to the open batch
+  void finalizeDab (DynamicMesh& mesh, const DynamicFaces& faces)
+  {
+    Batch& batch = scratch ().batch;
+
+    if (batch.isOpen == false)
+    {
+      finalize (mesh, faces);
+    }
+    else
+    {
+      if (batch.mesh != &mesh)
+      {
+        ToolSculptAction::flushBatch ();
+        batch.mesh = &mesh;
+      }
+      batch.faces.insert (faces.indices ());
+    }
+  }
+
+  // realigns the faces of the grab domain if necessary and releases it
+  void releaseGrabDomain ()
+  {
+    GrabDomain& domain = scratch ().grabDomain;
 
-    for (unsigned int i : faces)
+    if (domain.mesh && domain.mesh->isEmpty () == false && domain.numUnaligned > 0)
     {
-      mesh.realignFace (i);
+      DynamicMesh& mesh = *domain.mesh;
+
+      domain.faces.filter ([&mesh](unsigned int f) { return mesh.isFreeFace (f) == false; });
+      mesh.realignFaces (domain.faces);
     }
+    domain.mesh = nullptr;
+    domain.numUnaligned = 0;
+    domain.vertices.clear ();
+    domain.weights.clear ();
+    domain.faces.reset ();
+  }
+
+  /* Dabs of grab strokes without subdivision move the vertices of the grab domain by their
+   * weights, which skips the query of the domain.  Faces are realigned every few dabs, or
+   * immediately if short edges have been collapsed.  Returns `false` for other dabs, which
+   * release the grab domain.
+   */
+  bool grab (const SculptBrush& brush)
+  {
+    auto parameters = dynamic_cast<const SBGrablikeParameters*> (&brush.parameters ());
+
+    if (parameters == nullptr || brush.subdivide ())
+    {
+      releaseGrabDomain ();
+      return false;
+    }
+
+    PROFILE_ZONE ("sculpt/grab")
+    DynamicMesh& mesh = brush.mesh ();
+    GrabDomain&  domain = scratch ().grabDomain;
+
+    if (domain.isContinuedBy (brush) == false)
+    {
+      releaseGrabDomain ();
+      brush.getAffectedFaces (domain.faces);
+
+      if (domain.faces.numElements () == 0)
+      {
+        return true;
+      }
+      parameters->weights (brush, domain.faces, domain.vertices, domain.weights);
+      domain.mesh = &mesh;
+    }
+
+    domain.displace (brush.delta ());
+
+    if (collapseEdgesByLength (mesh, minEdgeLength * minEdgeLength, domain.faces))
+    {
+      finalizeDab (mesh, domain.faces);
+      domain.numUnaligned = 0;
+      releaseGrabDomain ();
+    }
+    else
+    {
+      LatencyTimer timer (LatencyStage::Finalize);
+
+      mesh.setVertexNormals (domain.faces);
+      if (++domain.numUnaligned >= grabRealignInterval)
+      {
+        mesh.realignFaces (domain.faces);
+        domain.numUnaligned = 0;
+      }
+      domain.revision = mesh.revision ();
+      domain.position = brush.position ();
+    }
+    return true;
+  }
+
+  /* Gets the affected faces of a dab.  If the dab continues the dab domain, faces that left the
+   * sphere are dropped and faces that entered it are found by growing the remaining faces on the
+   * boundary of either sphere over adjacent faces, which skips the query of the octree.  Parts of
+   * the mesh that enter the sphere without being connected to the remaining faces within the
+   * sphere are missed, which is why the domain is queried anew every few dabs.
+   */
+  void getDabDomain (const SculptBrush& brush, DynamicFaces& faces)
+  {
+    DabDomain&       domain = scratch ().dabDomain;
+    DynamicMesh&     mesh = brush.mesh ();
+    const PrimSphere sphere = brush.sphere ();
+
+    if (domain.isContinuedBy (brush) == false)
+    {
+      PROFILE_ZONE ("sculpt/domain")
+      LatencyTimer timer (LatencyStage::Domain);
+
+      domain.faces.reset ();
+      mesh.intersects (sphere, domain.faces);
+      domain.numDerived = 0;
+    }
+    else
+    {
+      PROFILE_ZONE ("sculpt/domain-incremental")
+      LatencyTimer  timer (LatencyStage::Domain);
+      DynamicFaces& frontier = scratch ().frontier;
+      DynamicFaces& extendedFrontier = scratch ().extendedFrontier;
+
+      frontier.reset ();
+      domain.faces.filter ([&mesh, &sphere, &domain, &frontier](unsigned int i) {
+        if (mesh.isFreeFace (i))
+        {
+          return false;
+        }
+
+        const PrimTriangle face = mesh.face (i);
+
+        if (IntersectionUtil::intersects (sphere, face) == false)
+        {
+          return false;
+        }
+        else if (sphere.contains (face) == false || domain.sphere.contains (face) == false)
+        {
+          frontier.insert (i);
+        }
+        return true;
+      });
+      frontier.commit ();
+
+      while (frontier.numElements () > 0)
+      {
+        extendedFrontier.reset ();
+
+        for (unsigned int i : frontier)
+        {
+          mesh.forEachVertexAdjacentToFace (
+            i, [&mesh, &sphere, &domain, &extendedFrontier](unsigned int v) {
+              for (unsigned int a : mesh.adjacentFaces (v))
+              {
+                if (domain.faces.contains (a) == false &&
+                    IntersectionUtil::intersects (sphere, mesh.face (a)))
+                {
+                  extendedFrontier.insert (a);
+                }
+              }
+            });
+        }
+        extendedFrontier.commit ();
+        domain.faces.insert (extendedFrontier.indices ());
+        domain.faces.commit ();
+        std::swap (frontier, extendedFrontier);
+      }
+      domain.numDerived++;
+    }
+    domain.mesh = nullptr;
+
+    faces.reset ();
+    faces.insert (domain.faces.indices ());
+    faces.commit ();
+    brush.filterAffectedFaces (faces);
+  }
+
+  // keeps the domain of a finished dab, whose faces have been queried by `getDabDomain`
+  void setDabDomain (const SculptBrush& brush, const DynamicFaces& faces)
+  {
+    DabDomain& domain = scratch ().dabDomain;
+
+    domain.faces.insert (faces.indices ());
+    domain.faces.commit ();
+    domain.mesh = &brush.mesh ();
+    domain.revision = brush.mesh ().revision ();
+    domain.sphere = brush.sphere ();
+  }
+
+  /* Subdivides the domain until no edge within `sphere` is longer than `maxLength`.  Passes stop
+   * once the deadline of the refinements has passed, in which case the remaining subdivision is
+   * deferred.
+   */
+  void subdivideDomain (DynamicMesh& mesh, const PrimSphere& sphere, float maxLength,
+                        DynamicFaces& faces)
+  {
+    PROFILE_ZONE ("sculpt/subdivide")
+    LatencyTimer            timer (LatencyStage::Subdivide);
+    EdgeMap&                newEdges = scratch ().newEdges;
+    std::vector<EdgeSplit>& splits = scratch ().edgeSplits;
+    Refinements&            refinements = scratch ().refinements;
+    bool                    isDone = false;
+
+    while (isDone == false && refinements.isExpired () == false)
+    {
+      newEdges.reset ();
+      splits.clear ();
+
+      extendAndFilterDomain (mesh, sphere, faces, 1);
+      extendDomainByPoles (mesh, faces);
+      splitEdges (mesh, newEdges, splits, maxLength, faces);
+
+      if (splits.empty () == false)
+      {
+        triangulate (mesh, newEdges, splits, faces);
+      }
+      extendDomain (mesh, faces, 1);
+      relaxEdges (mesh, faces);
+      smooth (mesh, faces);
+      finalize (mesh, faces);
+
+      isDone = faces.numElements () == 0 || splits.empty ();
+    }
+
+    if (isDone == false)
+    {
+      refinements.deferred.emplace_back (mesh, sphere, maxLength);
+    }
+  }
+
+  void subdivideDomain (const SculptBrush& brush, DynamicFaces& faces)
+  {
+    const float maxLength = glm::max (brush.subdivThreshold (), 2.0f * minEdgeLength);
+
+    subdivideDomain (brush.mesh (), brush.sphere (), maxLength, faces);
+  }
+
+  /* Sculpts the affected faces and copies the reflected positions of their vertices to their
+   * symmetric vertices, which is only done if all affected faces have symmetric faces.
+   */
+  bool sculptSymmetric (const SculptBrush& brush, const PrimPlane& mirrorPlane, DynamicFaces& faces,
+                        DynamicFaces& mirroredFaces)
+  {
+    DynamicMesh& mesh = brush.mesh ();
+
+    if (mesh.hasSymmetry (mirrorPlane) == false)
+    {
+      return false;
+    }
+
+    brush.getAffectedFaces (faces);
+    if (faces.numElements () == 0 || mesh.symmetricFaces (faces, mirroredFaces) == false)
+    {
+      return false;
+    }
+
+    brush.sculpt (faces);
+    mesh.forEachVertex (faces, [&mesh, &mirrorPlane](unsigned int i) {
+      mesh.vertex (mesh.symmetricVertex (i), mirrorPlane.mirror (mesh.vertex (i)));
+    });
+    return true;
   }
 }
 
@@ -755,7 +1405,14 @@ namespace ToolSculptAction
 {
   void sculpt (const SculptBrush& brush)
   {
-    DynamicFaces faces = brush.getAffectedFaces ();
+    PROFILE_ZONE ("sculpt")
+    if (grab (brush))
+    {
+      return;
+    }
+
+    DynamicFaces& faces = scratch ().affectedFaces;
+    getDabDomain (brush, faces);
 
     if (faces.numElements () > 0)
     {
@@ -784,45 +1441,352 @@ namespace ToolSculptAction
       {
         if (brush.subdivide ())
         {
-          ToolSculptEdgeMap newEdges;
-          do
-          {
-            newEdges.reset ();
+          subdivideDomain (brush, faces);
+          brush.getAffectedFaces (faces);
+        }
+        brush.sculpt (faces);
+        collapseEdgesByLength (mesh, minEdgeLength * minEdgeLength, faces);
+        finalizeDab (mesh, faces);
 
-            extendAndFilterDomain (brush, faces, 1);
-            extendDomainByPoles (mesh, faces);
+        if (brush.subdivide () == false)
+        {
+          setDabDomain (brush, faces);
+        }
+      }
+    }
+  }
 
-            const float maxLength = glm::max (brush.subdivThreshold (), 2.0f * minEdgeLength);
-            splitEdges (mesh, newEdges, maxLength, faces);
+  void sculpt (SculptBrush& brush, const PrimPlane& mirrorPlane)
+  {
+    PROFILE_ZONE ("sculpt/mirrored")
+    const PrimSphere sphere = brush.sphere ();
 
-            if (newEdges.isEmpty () == false)
-            {
-              triangulate (mesh, newEdges, faces);
-            }
-            extendDomain (mesh, faces, 1);
-            relaxEdges (mesh, faces);
-            smooth (mesh, faces);
-            finalize (mesh, faces);
-          } while (faces.numElements () > 0 && newEdges.isEmpty () == false);
+    releaseGrabDomain ();
+
+    if (brush.parameters ().reduce () ||
+        mirrorPlane.absDistance (sphere.center ()) <= sphere.radius ())
+    {
+      sculpt (brush);
+
+      if (brush.mesh ().isEmpty () == false)
+      {
+        brush.mirror (mirrorPlane);
+        sculpt (brush);
+        brush.mirror (mirrorPlane);
+      }
+    }
+    else
+    {
+      DynamicMesh&  mesh = brush.mesh ();
+      DynamicFaces& faces = scratch ().affectedFaces;
+      DynamicFaces& mirroredFaces = scratch ().mirroredFaces;
+
+      // subdivision changes the topology, such that each half queries its own domain
+      if (brush.subdivide ())
+      {
+        for (unsigned int half = 0; half < 2; half++)
+        {
+          brush.getAffectedFaces (faces);
+          if (faces.numElements () > 0)
+          {
+            subdivideDomain (brush, faces);
+          }
+          brush.mirror (mirrorPlane);
         }
-        faces = brush.getAffectedFaces ();
-        brush.sculpt (faces);
+      }
+
+      if (sculptSymmetric (brush, mirrorPlane, faces, mirroredFaces) == false)
+      {
+        brush.getAffectedFaces (mirrorPlane, faces, mirroredFaces);
+        if (faces.numElements () > 0)
+        {
+          brush.sculpt (faces);
+        }
+        if (mirroredFaces.numElements () > 0)
+        {
+          brush.mirror (mirrorPlane);
+          brush.sculpt (mirroredFaces);
+          brush.mirror (mirrorPlane);
+        }
+      }
+
+      faces.insert (mirroredFaces.indices ());
+      faces.commit ();
+
+      if (faces.numElements () > 0)
+      {
         collapseEdgesByLength (mesh, minEdgeLength * minEdgeLength, faces);
-        finalize (mesh, faces);
+        finalizeDab (mesh, faces);
+      }
+    }
+  }
+
+  void openBatch ()
+  {
+    Batch& batch = scratch ().batch;
+
+    assert (batch.isOpen == false);
+    batch.isOpen = true;
+  }
+
+  void flushBatch ()
+  {
+    Batch& batch = scratch ().batch;
+
+    if (batch.mesh && batch.mesh->isEmpty () == false)
+    {
+      DynamicMesh& mesh = *batch.mesh;
+
+      batch.faces.commit ();
+      batch.faces.filter ([&mesh](unsigned int f) { return mesh.isFreeFace (f) == false; });
+
+      if (batch.faces.numElements () > 0)
+      {
+        finalize (mesh, batch.faces);
+      }
+    }
+    batch.faces.reset ();
+    batch.mesh = nullptr;
+  }
+
+  void closeBatch ()
+  {
+    flushBatch ();
+    scratch ().batch.isOpen = false;
+  }
+
+  void refinementDeadline (unsigned int milliseconds)
+  {
+    Refinements& refinements = scratch ().refinements;
+
+    refinements.hasDeadline = milliseconds > 0;
+    refinements.deadline = Clock::now () + std::chrono::milliseconds (milliseconds);
+  }
+
+  void refineDeferred ()
+  {
+    PROFILE_ZONE ("sculpt/refine-deferred")
+    Refinements&  refinements = scratch ().refinements;
+    DynamicFaces& faces = scratch ().affectedFaces;
+    unsigned int  numRefined = 0;
+    DynamicMesh*  refinedMesh = nullptr;
+
+    // refinements that are deferred again are appended and visited after all others
+    while (numRefined < refinements.deferred.size () && refinements.isExpired () == false)
+    {
+      const Refinement refinement = refinements.deferred[numRefined++];
+
+      if (refinedMesh && refinedMesh != refinement.mesh && refinedMesh->isEmpty () == false)
+      {
+        refinedMesh->bufferData ();
+      }
+      refinedMesh = refinement.mesh;
+
+      faces.reset ();
+      if (refinement.mesh->intersects (refinement.sphere, faces))
+      {
+        subdivideDomain (*refinement.mesh, refinement.sphere, refinement.maxLength, faces);
       }
     }
+    refinements.deferred.erase (refinements.deferred.begin (),
+                                refinements.deferred.begin () + numRefined);
+    refinements.hasDeadline = false;
+
+    if (refinedMesh && refinedMesh->isEmpty () == false)
+    {
+      refinedMesh->bufferData ();
+    }
+  }
+
+  void finishRefinement ()
+  {
+    releaseGrabDomain ();
+    scratch ().refinements.hasDeadline = false;
+    refineDeferred ();
   }
 
   void smoothMesh (DynamicMesh& mesh)
   {
+    PROFILE_ZONE ("sculpt/smooth-mesh")
+    std::vector<unsigned int>& vertices = scratch ().domainVertices;
+
+    vertices.clear ();
+    mesh.forEachVertex ([&mesh, &vertices](unsigned int i) {
+      if (mesh.valence (i) > 0)
+      {
+        vertices.push_back (i);
+      }
+    });
+
+    relaxEdges (mesh, vertices);
+    smooth (mesh, vertices);
+    mesh.setAllNormals ();
+    mesh.realignAllFaces ();
+    mesh.bufferData ();
+  }
+
+  void subdivideFaces (DynamicMesh& mesh, float maxLength, DynamicFaces& faces)
+  {
+    PROFILE_ZONE ("sculpt/subdivide-faces")
+    EdgeMap&                newEdges = scratch ().newEdges;
+    std::vector<EdgeSplit>& splits = scratch ().edgeSplits;
+    DynamicFaces            created;
+
+    while (faces.numElements () > 0)
+    {
+      newEdges.reset ();
+      splits.clear ();
+
+      splitEdges (mesh, newEdges, splits, maxLength, faces);
+
+      if (splits.empty ())
+      {
+        break;
+      }
+      triangulate (mesh, newEdges, splits, faces);
+      created.insert (faces.indices ());
+      created.commit ();
+    }
+
+    created.filter ([&mesh](unsigned int f) { return mesh.isFreeFace (f) == false; });
+    finalize (mesh, created);
+    std::swap (faces, created);
+  }
+
+  void coarsenMesh (DynamicMesh& mesh, float maxEdgeLength)
+  {
+    PROFILE_ZONE ("sculpt/coarsen-mesh")
     DynamicFaces faces;
 
     mesh.forEachFace ([&faces](unsigned int i) { faces.insert (i); });
     faces.commit ();
-    relaxEdges (mesh, faces);
-    smooth (mesh, faces);
+    collapseFlatEdges (mesh, maxEdgeLength * maxEdgeLength, glm::radians (maxFlatAngle), faces);
     finalize (mesh, faces);
-    mesh.bufferData ();
+  }
+
+  /* Collapses edges in order of the quadric errors of their cheapest positions, which are chosen
+   * among their end points and their midpoints.  Collapses that would flip a face are skipped.
+   * Quadrics and the initial queue are computed in parallel.
+   */
+  bool simplifyMesh (DynamicMesh& mesh, unsigned int maxFaces, const CancellationToken& token)
+  {
+    PROFILE_ZONE ("sculpt/simplify-mesh")
+    std::vector<CollapseEdge>& queue = scratch ().collapseQueue;
+    std::vector<Quadric>&      quadrics = scratch ().quadrics;
+    DynamicFaces&              created = scratch ().collapseCreated;
+
+    const auto faceQuadric = [&mesh](unsigned int f) {
+      unsigned int i1, i2, i3;
+      mesh.vertexIndices (f, i1, i2, i3);
+      return Quadric (mesh.vertex (i1), mesh.vertex (i2), mesh.vertex (i3));
+    };
+
+    const auto position = [&mesh](const Quadric& q, unsigned int i1, unsigned int i2) {
+      const glm::vec3 p1 = mesh.vertex (i1);
+      const glm::vec3 p2 = mesh.vertex (i2);
+      const glm::vec3 m = Util::midpoint (p1, p2);
+      const float     e1 = q.error (p1);
+      const float     e2 = q.error (p2);
+      const float     eM = q.error (m);
+
+      return eM <= e1 && eM <= e2 ? m : (e1 <= e2 ? p1 : p2);
+    };
+
+    const auto edge = [&quadrics, &position](unsigned int i1, unsigned int i2) {
+      const Quadric q = quadrics[i1] + quadrics[i2];
+      return CollapseEdge (q.error (position (q, i1, i2)), i1, i2);
+    };
+
+    const unsigned int numVertexSlots = mesh.mesh ().numVertices ();
+
+    quadrics.assign (numVertexSlots, Quadric ());
+    ThreadPool::global ().parallelFor (
+      numVertexSlots, elementsPerChunk, [&](unsigned int first, unsigned int last) {
+        for (unsigned int i = first; i < last; i++)
+        {
+          if (mesh.isFreeVertex (i) == false)
+          {
+            for (unsigned int a : mesh.adjacentFaces (i))
+            {
+              quadrics[i] = quadrics[i] + faceQuadric (a);
+            }
+          }
+        }
+      });
+
+    queue.clear ();
+    mesh.forEachFace ([&mesh, &queue](unsigned int f) {
+      for (unsigned int h = 3 * f; h < (3 * f) + 3; h++)
+      {
+        if (mesh.halfEdgeSource (h) < mesh.halfEdgeTarget (h))
+        {
+          queue.emplace_back (0.0f, mesh.halfEdgeSource (h), mesh.halfEdgeTarget (h));
+        }
+      }
+    });
+    ThreadPool::global ().parallelFor (
+      queue.size (), elementsPerChunk, [&](unsigned int first, unsigned int last) {
+        for (unsigned int e = first; e < last; e++)
+        {
+          queue[e] = edge (queue[e].i1, queue[e].i2);
+        }
+      });
+    std::make_heap (queue.begin (), queue.end ());
+
+    while (mesh.numFaces () > maxFaces && queue.empty () == false)
+    {
+      if (token.isCancelled ())
+      {
+        return false;
+      }
+
+      std::pop_heap (queue.begin (), queue.end ());
+      const CollapseEdge e = queue.back ();
+      queue.pop_back ();
+
+      if (mesh.isFreeVertex (e.i1) || mesh.isFreeVertex (e.i2) ||
+          mesh.halfEdge (e.i1, e.i2) == Util::invalidIndex ())
+      {
+        continue;
+      }
+
+      const CollapseEdge current = edge (e.i1, e.i2);
+      if (current.key != e.key)
+      {
+        queue.push_back (current);
+        std::push_heap (queue.begin (), queue.end ());
+        continue;
+      }
+
+      const Quadric   q = quadrics[e.i1] + quadrics[e.i2];
+      const glm::vec3 p = position (q, e.i1, e.i2);
+
+      if (flipsFace (mesh, e.i1, e.i2, p) || flipsFace (mesh, e.i2, e.i1, p))
+      {
+        continue;
+      }
+
+      created.reset ();
+      const unsigned int i = collapseEdge (mesh, e.i1, e.i2, created);
+
+      if (i != Util::invalidIndex ())
+      {
+        mesh.vertex (i, p);
+
+        if (i >= quadrics.size ())
+        {
+          quadrics.resize (i + 1);
+        }
+        quadrics[i] = q;
+
+        mesh.forEachVertexAdjacentToVertex (i, [i, &queue, &edge](unsigned int a) {
+          queue.push_back (edge (i, a));
+          std::push_heap (queue.begin (), queue.end ());
+        });
+      }
+    }
+    mesh.setAllNormals ();
+    return mesh.numFaces () <= maxFaces;
   }
 
   bool deleteFaces (DynamicMesh& mesh, DynamicFaces& faces)
@@ -833,4 +1797,15 @@ namespace ToolSculptAction
     mesh.bufferData ();
     return collapsed;
   }
+
+  void reportMemory (MemoryReport& report)
+  {
+    const Scratch& s = scratch ();
+
+    report.add (MemoryCategory::FaceSets,
+                s.affectedFaces.numBytes () + s.mirroredFaces.numBytes () +
+                  s.frontier.numBytes () + s.extendedFrontier.numBytes () +
+                  s.collapseCreated.numBytes () + s.batch.faces.numBytes () +
+                  s.grabDomain.faces.numBytes () + s.dabDomain.faces.numBytes ());
+  }
 }
@@ -5,14 +5,59 @@
 #ifndef DILAY_TOOL_SCULPT_ACTION
 #define DILAY_TOOL_SCULPT_ACTION
 
+class CancellationToken;
+class DynamicFaces;
 class DynamicMesh;
+class MemoryReport;
+class PrimPlane;
 class SculptBrush;
 
 namespace ToolSculptAction
 {
+  /* Sculpts with a brush.  Grab strokes without subdivision keep the vertices and weights of
+   * their first dab and realign their faces every few dabs, until the stroke ends with
+   * `finishRefinement`.
+   */
   void sculpt (const SculptBrush&);
+  /* Sculpts with a brush and its mirror image.  Both halves share a single query of their
+   * domains, as well as the final pass over normals and octree, unless they overlap.
+   */
+  void sculpt (SculptBrush&, const PrimPlane&);
+
+  /* Dabs that are sculpted while a batch is open defer their final pass over normals and octree.
+   * The pass runs once over the joint domain of these dabs when the batch is flushed or closed,
+   * and whenever a dab sculpts another mesh.
+   */
+  void openBatch ();
+  void flushBatch ();
+  void closeBatch ();
+
+  /* Subdivision of dabs stops once a deadline in the given number of milliseconds has passed, and
+   * the rest of it is deferred.  `refineDeferred` continues deferred subdivisions until the
+   * deadline and then removes it.  `finishRefinement` completes them without a deadline and ends
+   * the current grab stroke.  Both buffer the meshes they have refined.
+   */
+  void refinementDeadline (unsigned int);
+  void refineDeferred ();
+  void finishRefinement ();
+
   void smoothMesh (DynamicMesh&);
+  /* Splits edges of the given faces that are longer than the given length until there are none,
+   * and replaces the faces by the faces that have been created.
+   */
+  void subdivideFaces (DynamicMesh&, float, DynamicFaces&);
+  /* Collapses edges of flat regions of a mesh up to the given length.  This runs after a mesh
+   * has been made at full resolution, so it makes smaller meshes but takes additional time.
+   */
+  void coarsenMesh (DynamicMesh&, float);
+  /* Collapses edges in order of their quadric errors until a mesh has at most the given number of
+   * faces.  Returns `false` if the mesh cannot be simplified any further or if the token has been
+   * cancelled.
+   */
+  bool simplifyMesh (DynamicMesh&, unsigned int, const CancellationToken&);
   bool deleteFaces (DynamicMesh&, DynamicFaces&);
+  // reports the sets of faces that the sculpt actions of the calling thread keep for reuse
+  void reportMemory (MemoryReport&);
 };
 
 #endif
@@ -2,15 +2,449 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <cmath>
 #include <memory>
+#include <vector>
 #include "dynamic/faces.hpp"
 #include "dynamic/mesh.hpp"
+#include "latency-profiler.hpp"
 #include "primitive/plane.hpp"
 #include "primitive/sphere.hpp"
 #include "primitive/triangle.hpp"
+#include "profiler.hpp"
+#include "thread-pool.hpp"
 #include "tool/sculpt/util/brush.hpp"
+#include "tool/sculpt/util/stamp.hpp"
+#include "tool/sculpt/util/visibility.hpp"
 #include "util.hpp"
 
+namespace
+{
+  constexpr unsigned int verticesPerChunk = 2048;
+
+  // depth by which a vertex may lie behind the visible surface, relative to the brush's radius
+  constexpr float visibilityTolerance = 0.1f;
+
+  /* Positions and masks of the vertices affected by a brush as structure of arrays, together
+   * with a per-vertex factor.  Brushes are composed of the kernels below, each of which is a plain
+   * loop over a range of vertices that the compiler can vectorize.
+   */
+  struct BrushVertices
+  {
+    std::vector<unsigned int> indices;
+    std::vector<float>        x;
+    std::vector<float>        y;
+    std::vector<float>        z;
+    std::vector<float>        mask;
+    std::vector<float>        factor;
+
+    // the level of the stamp that is sampled and the frame that maps positions to its texels
+    const float* stampTexels;
+    unsigned int stampWidth;
+    glm::vec3    stampOrigin;
+    glm::vec3    stampU;
+    glm::vec3    stampV;
+
+    BrushVertices ()
+      : stampTexels (nullptr)
+      , stampWidth (0)
+    {
+    }
+
+    unsigned int numVertices () const { return this->indices.size (); }
+
+    glm::vec3 position (unsigned int k) const
+    {
+      return glm::vec3 (this->x[k], this->y[k], this->z[k]);
+    }
+
+    void position (unsigned int k, const glm::vec3& p)
+    {
+      this->x[k] = p.x;
+      this->y[k] = p.y;
+      this->z[k] = p.z;
+    }
+
+    void gather (const DynamicMesh& mesh)
+    {
+      const unsigned int n = this->numVertices ();
+
+      this->x.resize (n);
+      this->y.resize (n);
+      this->z.resize (n);
+      this->mask.resize (n);
+      this->factor.resize (n);
+
+      ThreadPool::global ().parallelFor (n, verticesPerChunk, [this, &mesh](unsigned int begin,
+                                                                            unsigned int end) {
+        for (unsigned int k = begin; k < end; k++)
+        {
+          this->position (k, mesh.vertex (this->indices[k]));
+          this->mask[k] = mesh.mask (this->indices[k]);
+        }
+      });
+    }
+
+    /* Partially masked vertices keep their old positions in proportion to their masks.  Vertices
+     * that have not moved, e.g. outside of the falloff, are not written, such that they are
+     * neither recorded nor buffered again.
+     */
+    void scatter (DynamicMesh& mesh) const
+    {
+      for (unsigned int k = 0; k < this->numVertices (); k++)
+      {
+        const unsigned int i = this->indices[k];
+        const glm::vec3&   old = mesh.vertex (i);
+        const glm::vec3    p = this->position (k);
+        const glm::vec3    newP = this->mask[k] > 0.0f ? glm::mix (p, old, this->mask[k]) : p;
+
+        if (newP != old)
+        {
+          mesh.vertex (i, newP);
+        }
+      }
+    }
+
+    // cf. `Util::linearStep`
+    void linearFalloff (const glm::vec3& center, float innerRadius, float radius,
+                        unsigned int begin, unsigned int end)
+    {
+      assert (innerRadius <= radius);
+
+      const bool  isStep = radius - innerRadius < Util::epsilon ();
+      const float invWidth = isStep ? 0.0f : 1.0f / (radius - innerRadius);
+
+      for (unsigned int k = begin; k < end; k++)
+      {
+        const float dx = this->x[k] - center.x;
+        const float dy = this->y[k] - center.y;
+        const float dz = this->z[k] - center.z;
+        const float d = std::sqrt ((dx * dx) + (dy * dy) + (dz * dz));
+        const float f = glm::clamp ((radius - d) * invWidth, 0.0f, 1.0f);
+
+        this->factor[k] = isStep ? (d > radius ? 0.0f : 1.0f) : f;
+      }
+    }
+
+    // cf. `Util::smoothStep`
+    void smoothFalloff (const glm::vec3& center, float innerRadius, float radius,
+                        unsigned int begin, unsigned int end)
+    {
+      this->linearFalloff (center, innerRadius, radius, begin, end);
+
+      if (radius - innerRadius >= Util::epsilon ())
+      {
+        for (unsigned int k = begin; k < end; k++)
+        {
+          const float f = this->factor[k];
+          this->factor[k] = f * f * f * (f * (f * 6.0f - 15.0f) + 10.0f);
+        }
+      }
+    }
+
+    void quadraticFalloff (const glm::vec3& center, float radius, unsigned int begin,
+                           unsigned int end)
+    {
+      this->linearFalloff (center, 0.0f, radius, begin, end);
+      this->squareFactors (begin, end);
+    }
+
+    /* Projects the brush's stamp onto the plane of its normal.  The stamp's level is chosen such
+     * that its texels are about as far apart as the vertices of the affected faces.
+     */
+    void setupStamp (const SculptBrush& brush, const DynamicFaces& faces)
+    {
+      const SculptStamp* stamp = brush.stamp ();
+
+      if (stamp == nullptr || stamp->isEmpty ())
+      {
+        this->stampTexels = nullptr;
+      }
+      else
+      {
+        const PrimSphere sphere = brush.sphere ();
+        const float      diameter = 2.0f * sphere.radius ();
+        const float      edgeLength = glm::sqrt (brush.mesh ().averageEdgeLengthSqr (faces));
+        const float      numTexels =
+          edgeLength > Util::epsilon () ? diameter / edgeLength : Util::maxFloat ();
+        const unsigned int level = stamp->level (numTexels);
+        const glm::vec3    u = glm::normalize (Util::orthogonal (brush.normal ()));
+        const glm::vec3    v = glm::cross (brush.normal (), u);
+
+        this->stampTexels = stamp->texels (level);
+        this->stampWidth = stamp->width (level);
+        this->stampOrigin = sphere.center () - (sphere.radius () * (u + v));
+        this->stampU = u * (float(this->stampWidth) / diameter);
+        this->stampV = v * (float(this->stampWidth) / diameter);
+      }
+    }
+
+    // scales each factor by the bilinearly interpolated stamp, which is zero outside of it
+    void stampFactors (unsigned int begin, unsigned int end)
+    {
+      if (this->stampTexels == nullptr)
+      {
+        return;
+      }
+
+      const float* texels = this->stampTexels;
+      const int    w = int(this->stampWidth);
+      const float  maxST = float(w) - 1.0f;
+
+      for (unsigned int k = begin; k < end; k++)
+      {
+        const float dx = this->x[k] - this->stampOrigin.x;
+        const float dy = this->y[k] - this->stampOrigin.y;
+        const float dz = this->z[k] - this->stampOrigin.z;
+        const float s = (dx * this->stampU.x) + (dy * this->stampU.y) + (dz * this->stampU.z);
+        const float t = (dx * this->stampV.x) + (dy * this->stampV.y) + (dz * this->stampV.z);
+
+        const bool  isInside = s >= 0.0f && t >= 0.0f && s <= float(w) && t <= float(w);
+        const float sC = glm::clamp (s - 0.5f, 0.0f, maxST);
+        const float tC = glm::clamp (t - 0.5f, 0.0f, maxST);
+        const int   s0 = int(sC);
+        const int   t0 = int(tC);
+        const int   s1 = glm::min (s0 + 1, w - 1);
+        const int   t1 = glm::min (t0 + 1, w - 1);
+        const float fs = sC - float(s0);
+        const float ft = tC - float(t0);
+
+        const float a = glm::mix (texels[(t0 * w) + s0], texels[(t0 * w) + s1], fs);
+        const float b = glm::mix (texels[(t1 * w) + s0], texels[(t1 * w) + s1], fs);
+
+        this->factor[k] *= isInside ? glm::mix (a, b, ft) : 0.0f;
+      }
+    }
+
+    void squareFactors (unsigned int begin, unsigned int end)
+    {
+      for (unsigned int k = begin; k < end; k++)
+      {
+        this->factor[k] *= this->factor[k];
+      }
+    }
+
+    void scaleFactors (float scale, unsigned int begin, unsigned int end)
+    {
+      for (unsigned int k = begin; k < end; k++)
+      {
+        this->factor[k] *= scale;
+      }
+    }
+
+    // scales each factor by the signed distance to `plane`, which is clamped to `[min, max]`
+    void scaleFactorsByDistance (const PrimPlane& plane, float min, float max, unsigned int begin,
+                                 unsigned int end)
+    {
+      const glm::vec3& n = plane.normal ();
+      const float      offset = glm::dot (n, plane.point ());
+
+      for (unsigned int k = begin; k < end; k++)
+      {
+        const float d = (n.x * this->x[k]) + (n.y * this->y[k]) + (n.z * this->z[k]) - offset;
+        this->factor[k] *= glm::clamp (d, min, max);
+      }
+    }
+
+    // scales each factor by the part of its vertex that is not masked
+    void unmaskFactors (unsigned int begin, unsigned int end)
+    {
+      for (unsigned int k = begin; k < end; k++)
+      {
+        this->factor[k] *= 1.0f - this->mask[k];
+      }
+    }
+
+    // moves each vertex by `factor * direction`
+    void displace (const glm::vec3& direction, unsigned int begin, unsigned int end)
+    {
+      for (unsigned int k = begin; k < end; k++)
+      {
+        this->x[k] += this->factor[k] * direction.x;
+        this->y[k] += this->factor[k] * direction.y;
+        this->z[k] += this->factor[k] * direction.z;
+      }
+    }
+
+    // moves each vertex by `factor * scale` of its way to `target`
+    void pull (const glm::vec3& target, float scale, unsigned int begin, unsigned int end)
+    {
+      for (unsigned int k = begin; k < end; k++)
+      {
+        const float f = this->factor[k] * scale;
+
+        this->x[k] += f * (target.x - this->x[k]);
+        this->y[k] += f * (target.y - this->y[k]);
+        this->z[k] += f * (target.z - this->z[k]);
+      }
+    }
+  };
+
+  /* Uniform Laplacian of the vertices of a brush, whose neighbors are stored as compressed rows
+   * of local indices.  Neighbors that are not affected by the brush are appended to the brush's
+   * vertices, which are then split into `numMoving` leading vertices and fixed trailing ones.
+   */
+  struct BrushLaplacian
+  {
+    unsigned int              numMoving;
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> neighbors;
+    std::vector<float>        invValences;
+    std::vector<unsigned int> localIndices;
+    std::vector<float>        newX;
+    std::vector<float>        newY;
+    std::vector<float>        newZ;
+
+    BrushLaplacian ()
+      : numMoving (0)
+    {
+    }
+
+    // vertices without a local index are appended to the brush's vertices
+    unsigned int localIndex (BrushVertices& vertices, unsigned int i)
+    {
+      if (i >= this->localIndices.size ())
+      {
+        this->localIndices.resize (i + 1, Util::invalidIndex ());
+      }
+      if (this->localIndices[i] == Util::invalidIndex ())
+      {
+        this->localIndices[i] = vertices.indices.size ();
+        vertices.indices.push_back (i);
+      }
+      return this->localIndices[i];
+    }
+
+    // must be called before the vertices are gathered
+    void build (const DynamicMesh& mesh, BrushVertices& vertices)
+    {
+      this->numMoving = vertices.numVertices ();
+      this->offsets.resize (this->numMoving + 1);
+      this->invValences.resize (this->numMoving);
+      this->neighbors.clear ();
+
+      for (unsigned int k = 0; k < this->numMoving; k++)
+      {
+        this->localIndex (vertices, vertices.indices[k]);
+      }
+
+      for (unsigned int k = 0; k < this->numMoving; k++)
+      {
+        const unsigned int i = vertices.indices[k];
+
+        this->offsets[k] = this->neighbors.size ();
+        this->invValences[k] = 1.0f / float(mesh.valence (i));
+
+        mesh.forEachVertexAdjacentToVertex (i, [this, &vertices](unsigned int a) {
+          this->neighbors.push_back (this->localIndex (vertices, a));
+        });
+      }
+      this->offsets[this->numMoving] = this->neighbors.size ();
+
+      for (unsigned int i : vertices.indices)
+      {
+        this->localIndices[i] = Util::invalidIndex ();
+      }
+    }
+
+    /* Jacobi iterations, each of which moves all moving vertices at once by `factor` of their
+     * way to the average of their neighbors.  Fixed vertices are the same in both buffers.
+     */
+    void smooth (BrushVertices& vertices, float factor, unsigned int numIterations)
+    {
+      this->newX = vertices.x;
+      this->newY = vertices.y;
+      this->newZ = vertices.z;
+
+      const float keep = 1.0f - factor;
+
+      for (unsigned int iteration = 0; iteration < numIterations; iteration++)
+      {
+        ThreadPool::global ().parallelFor (this->numMoving, verticesPerChunk,
+                                           [this, &vertices, factor, keep](unsigned int begin,
+                                                                           unsigned int end) {
+          for (unsigned int k = begin; k < end; k++)
+          {
+            float sumX = 0.0f;
+            float sumY = 0.0f;
+            float sumZ = 0.0f;
+
+            for (unsigned int e = this->offsets[k]; e < this->offsets[k + 1]; e++)
+            {
+              sumX += vertices.x[this->neighbors[e]];
+              sumY += vertices.y[this->neighbors[e]];
+              sumZ += vertices.z[this->neighbors[e]];
+            }
+            const float scale = factor * this->invValences[k];
+
+            this->newX[k] = (keep * vertices.x[k]) + (scale * sumX);
+            this->newY[k] = (keep * vertices.y[k]) + (scale * sumY);
+            this->newZ[k] = (keep * vertices.z[k]) + (scale * sumZ);
+          }
+        });
+        vertices.x.swap (this->newX);
+        vertices.y.swap (this->newY);
+        vertices.z.swap (this->newZ);
+      }
+    }
+  };
+
+  // brushes are only applied on the main thread
+  BrushVertices& brushVertices ()
+  {
+    static BrushVertices instance;
+    return instance;
+  }
+
+  BrushLaplacian& brushLaplacian ()
+  {
+    static BrushLaplacian instance;
+    return instance;
+  }
+
+  // collects the vertices of `faces`, which skips fully masked vertices unless `withMasked` is set
+  BrushVertices& collect (DynamicMesh& mesh, const DynamicFaces& faces, bool withMasked)
+  {
+    BrushVertices& vertices = brushVertices ();
+
+    vertices.indices.clear ();
+    mesh.forEachVertex (faces, [&mesh, &vertices, withMasked](unsigned int i) {
+      if (withMasked || mesh.mask (i) < 1.0f)
+      {
+        vertices.indices.push_back (i);
+      }
+    });
+    return vertices;
+  }
+
+  // runs `kernel (vertices, begin, end)` on the collected vertices of `faces`
+  template <typename F>
+  BrushVertices& runKernel (const SculptBrush& brush, const DynamicFaces& faces, bool withMasked,
+                            const F& kernel)
+  {
+    DynamicMesh&   mesh = brush.mesh ();
+    BrushVertices& vertices = collect (mesh, faces, withMasked);
+
+    vertices.gather (mesh);
+    vertices.setupStamp (brush, faces);
+
+    ThreadPool::global ().parallelFor (vertices.numVertices (), verticesPerChunk,
+                                       [&vertices, &kernel](unsigned int begin, unsigned int end) {
+                                         kernel (vertices, begin, end);
+                                       });
+    return vertices;
+  }
+
+  /* Kernels only see the positions from before the brush is applied, and the new positions are
+   * written to the mesh once all of them are known.
+   */
+  template <typename F>
+  void applyKernel (const SculptBrush& brush, const DynamicFaces& faces, const F& kernel)
+  {
+    runKernel (brush, faces, false, kernel).scatter (brush.mesh ());
+  }
+}
+
 SBFlattenParameters::SBFlattenParameters ()
   : _lockPlane (false)
 {
@@ -44,14 +478,15 @@ void SBDrawParameters::sculpt (const SculptBrush& brush, const DynamicFaces& fac
       const glm::vec3 planePos = brush.position () + (planeNormal * intensity * brush.radius ());
       const PrimPlane plane (planePos, planeNormal);
 
-      brush.mesh ().forEachVertex (faces, [&brush, &plane, intensity](unsigned int i) {
-        const glm::vec3& oldPos = brush.mesh ().vertex (i);
-        const float      factor = intensity * Util::linearStep (oldPos, brush.position (),
-                                                           0.5f * brush.radius (), brush.radius ());
-        const float      distance = glm::min (0.0f, plane.distance (oldPos));
-        const glm::vec3  newPos = oldPos - (plane.normal () * factor * distance);
-
-        brush.mesh ().vertex (i, newPos);
+      applyKernel (brush, faces, [&brush, &plane, intensity](BrushVertices& vertices,
+                                                              unsigned int  begin,
+                                                              unsigned int  end) {
+        vertices.linearFalloff (brush.position (), 0.5f * brush.radius (), brush.radius (),
+                                begin, end);
+        vertices.stampFactors (begin, end);
+        vertices.scaleFactors (intensity, begin, end);
+        vertices.scaleFactorsByDistance (plane, -Util::maxFloat (), 0.0f, begin, end);
+        vertices.displace (-plane.normal (), begin, end);
       });
     }
     else
@@ -59,13 +494,13 @@ void SBDrawParameters::sculpt (const SculptBrush& brush, const DynamicFaces& fac
       const float     intensity = 0.1f * this->intensity () * brush.radius ();
       const glm::vec3 avgDir = this->invert (brush.mesh ().averageNormal (faces));
 
-      brush.mesh ().forEachVertex (faces, [&brush, &avgDir, intensity](unsigned int i) {
-        const glm::vec3& oldPos = brush.mesh ().vertex (i);
-        const float      factor =
-          intensity * Util::smoothStep (oldPos, brush.position (), 0.0f, brush.radius ());
-        const glm::vec3 newPos = oldPos + (factor * avgDir);
-
-        brush.mesh ().vertex (i, newPos);
+      applyKernel (brush, faces, [&brush, &avgDir, intensity](BrushVertices& vertices,
+                                                               unsigned int  begin,
+                                                               unsigned int  end) {
+        vertices.smoothFalloff (brush.position (), 0.0f, brush.radius (), begin, end);
+        vertices.stampFactors (begin, end);
+        vertices.scaleFactors (intensity, begin, end);
+        vertices.displace (avgDir, begin, end);
       });
     }
   }
@@ -73,24 +508,49 @@ void SBDrawParameters::sculpt (const SculptBrush& brush, const DynamicFaces& fac
 
 void SBGrablikeParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces) const
 {
-  brush.mesh ().forEachVertex (faces, [&brush](unsigned int i) {
-    const glm::vec3& oldPos = brush.mesh ().vertex (i);
-    const float factor = Util::linearStep (oldPos, brush.lastPosition (), 0.0f, brush.radius ());
-    const glm::vec3 newPos = oldPos + (factor * brush.delta ());
-
-    brush.mesh ().vertex (i, newPos);
+  applyKernel (brush, faces, [&brush](BrushVertices& vertices, unsigned int begin,
+                                      unsigned int end) {
+    vertices.linearFalloff (brush.lastPosition (), 0.0f, brush.radius (), begin, end);
+    vertices.stampFactors (begin, end);
+    vertices.displace (brush.delta (), begin, end);
   });
 }
 
-void SBSmoothParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces) const
+void SBGrablikeParameters::weights (const SculptBrush& brush, const DynamicFaces& faces,
+                                    std::vector<unsigned int>& indices,
+                                    std::vector<float>&        weights) const
 {
-  brush.mesh ().forEachVertex (faces, [this, &brush](unsigned int i) {
-    const glm::vec3  avgPos = brush.mesh ().averagePosition (i);
-    const glm::vec3& oldPos = brush.mesh ().vertex (i);
-    const glm::vec3  newPos = oldPos + (this->intensity () * (avgPos - oldPos));
+  const BrushVertices& weighted =
+    runKernel (brush, faces, false, [&brush](BrushVertices& vertices, unsigned int begin,
+                                             unsigned int end) {
+      vertices.linearFalloff (brush.lastPosition (), 0.0f, brush.radius (), begin, end);
+      vertices.stampFactors (begin, end);
+      vertices.unmaskFactors (begin, end);
+    });
 
-    brush.mesh ().vertex (i, newPos);
-  });
+  indices.clear ();
+  weights.clear ();
+
+  for (unsigned int k = 0; k < weighted.numVertices (); k++)
+  {
+    if (weighted.factor[k] > 0.0f)
+    {
+      indices.push_back (weighted.indices[k]);
+      weights.push_back (weighted.factor[k]);
+    }
+  }
+}
+
+void SBSmoothParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces) const
+{
+  DynamicMesh&    mesh = brush.mesh ();
+  BrushVertices&  vertices = collect (mesh, faces, false);
+  BrushLaplacian& laplacian = brushLaplacian ();
+
+  laplacian.build (mesh, vertices);
+  vertices.gather (mesh);
+  laplacian.smooth (vertices, this->intensity (), this->iterations ());
+  vertices.scatter (mesh);
 }
 
 void SBReduceParameters::sculpt (const SculptBrush&, const DynamicFaces&) const {}
@@ -112,16 +572,15 @@ void SBFlattenParameters::sculpt (const SculptBrush& brush, const DynamicFaces&
       plane = PrimPlane (avgPos, avgNormal);
     }
 
-    brush.mesh ().forEachVertex (faces, [this, &brush, &plane](unsigned int i) {
-      const glm::vec3& oldPos = brush.mesh ().vertex (i);
-      const float      distance = plane.distance (oldPos);
+    const float min = this->hasLockedPlane () ? -Util::maxFloat () : 0.0f;
 
-      float factor =
-        this->intensity () * Util::linearStep (oldPos, brush.position (), 0.0f, brush.radius ());
-      factor *= this->hasLockedPlane () ? distance : glm::max (0.0f, distance);
-
-      const glm::vec3 newPos = oldPos - (plane.normal () * factor);
-      brush.mesh ().vertex (i, newPos);
+    applyKernel (brush, faces, [this, &brush, &plane, min](BrushVertices& vertices,
+                                                           unsigned int begin, unsigned int end) {
+      vertices.linearFalloff (brush.position (), 0.0f, brush.radius (), begin, end);
+      vertices.stampFactors (begin, end);
+      vertices.scaleFactors (this->intensity (), begin, end);
+      vertices.scaleFactorsByDistance (plane, min, Util::maxFloat (), begin, end);
+      vertices.displace (-plane.normal (), begin, end);
     });
   }
 }
@@ -131,55 +590,63 @@ void SBCreaseParameters::sculpt (const SculptBrush& brush, const DynamicFaces& f
   if (faces.isEmpty () == false && brush.position () != brush.lastPosition ())
   {
     const glm::vec3 normal = this->invert (brush.normal ());
-
-    brush.mesh ().forEachVertex (faces, [this, &brush, &normal](unsigned int i) {
-      const glm::vec3& oldPos = brush.mesh ().vertex (i);
-      const glm::vec3  delta = brush.position () - oldPos;
-      const float      distance = glm::length (delta) / brush.radius ();
-
-      if (distance <= 1.0f)
-      {
-        const float invDistance2 = (distance - 1.0f) * (distance - 1.0f);
-        const float hFactor = invDistance2 * this->intensity ();
-        float vFactor = invDistance2 * invDistance2 * brush.radius () * this->intensity () * 0.5f;
-        const glm::vec3 newPos = (oldPos + (hFactor * delta)) + (normal * vFactor);
-
-        brush.mesh ().vertex (i, newPos);
-      }
+    const float     vScale = brush.radius () * this->intensity () * 0.5f;
+
+    applyKernel (brush, faces, [this, &brush, &normal, vScale](BrushVertices& vertices,
+                                                               unsigned int  begin,
+                                                               unsigned int  end) {
+      vertices.quadraticFalloff (brush.position (), brush.radius (), begin, end);
+      vertices.stampFactors (begin, end);
+      vertices.pull (brush.position (), this->intensity (), begin, end);
+      vertices.squareFactors (begin, end);
+      vertices.scaleFactors (vScale, begin, end);
+      vertices.displace (normal, begin, end);
     });
   }
 }
 
 void SBPinchParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces) const
 {
-  brush.mesh ().forEachVertex (faces, [&brush](unsigned int i) {
-    const glm::vec3& oldPos = brush.mesh ().vertex (i);
-    const glm::vec3  delta = brush.position () - oldPos;
-    const float      distance = glm::length (delta) / brush.radius ();
-
-    if (distance <= 1.0f)
-    {
-      const float     invDistance2 = (distance - 1.0f) * (distance - 1.0f);
-      const float     hFactor = invDistance2 * 0.5f;
-      const glm::vec3 newPos = oldPos + (hFactor * delta);
+  applyKernel (brush, faces, [&brush](BrushVertices& vertices, unsigned int begin,
+                                      unsigned int end) {
+    vertices.quadraticFalloff (brush.position (), brush.radius (), begin, end);
+    vertices.stampFactors (begin, end);
+    vertices.pull (brush.position (), 0.5f, begin, end);
+  });
+}
 
-      brush.mesh ().vertex (i, newPos);
-    }
+void SBMaskParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces) const
+{
+  DynamicMesh&   mesh = brush.mesh ();
+  const float    intensity = this->invert () ? -this->intensity () : this->intensity ();
+  BrushVertices& painted = runKernel (brush, faces, true, [&brush](BrushVertices& vertices,
+                                                                 unsigned int  begin,
+                                                                 unsigned int  end) {
+    vertices.smoothFalloff (brush.position (), 0.0f, brush.radius (), begin, end);
+    vertices.stampFactors (begin, end);
   });
+
+  for (unsigned int k = 0; k < painted.numVertices (); k++)
+  {
+    mesh.mask (painted.indices[k], painted.mask[k] + (intensity * painted.factor[k]));
+  }
 }
 
 struct SculptBrush::Impl
 {
-  SculptBrush* self;
-  float        radius;
-  float        detailFactor;
-  float        stepWidthFactor;
-  bool         subdivide;
-  DynamicMesh* _mesh;
-  bool         hasPointOfAction;
-  glm::vec3    _prevPosition;
-  glm::vec3    _position;
-  glm::vec3    _normal;
+  SculptBrush*            self;
+  float                   radius;
+  float                   detailFactor;
+  float                   stepWidthFactor;
+  bool                    subdivide;
+  const SculptStamp*      stamp;
+  const SculptVisibility* visibility;
+  DynamicMesh*            _mesh;
+  bool                    hasPointOfAction;
+  bool                    isMirrored;
+  glm::vec3               _prevPosition;
+  glm::vec3               _position;
+  glm::vec3               _normal;
 
   std::unique_ptr<SBParameters> _parameters;
 
@@ -189,8 +656,11 @@ struct SculptBrush::Impl
     , detailFactor (0.0f)
     , stepWidthFactor (0.0f)
     , subdivide (true)
+    , stamp (nullptr)
+    , visibility (nullptr)
     , _mesh (nullptr)
     , hasPointOfAction (false)
+    , isMirrored (false)
   {
   }
 
@@ -263,6 +733,8 @@ struct SculptBrush::Impl
 
   void mirror (const PrimPlane& plane)
   {
+    this->isMirrored = !this->isMirrored;
+
     if (this->_parameters)
     {
       this->_parameters->mirror (plane);
@@ -276,26 +748,85 @@ struct SculptBrush::Impl
     }
   }
 
-  DynamicFaces getAffectedFaces () const
+  void getAffectedFaces (DynamicFaces& faces) const
   {
     assert (this->hasPointOfAction);
     assert (this->_parameters);
 
-    DynamicFaces faces;
+    PROFILE_ZONE ("sculpt/domain")
+    LatencyTimer timer (LatencyStage::Domain);
+
+    faces.reset ();
     this->_mesh->intersects (this->sphere (), faces);
+    this->filterAffectedFaces (faces);
+  }
+
+  void filterAffectedFaces (DynamicFaces& faces) const
+  {
+    assert (this->hasPointOfAction);
+    assert (this->_parameters);
 
     if (this->_parameters->discardBack ())
     {
       faces.filter ([this](unsigned int i) {
         return glm::dot (this->normal (), this->_mesh->face (i).cross ()) > 0.0f;
       });
+      this->filterHiddenFaces (faces);
+    }
+  }
+
+  // faces are kept if any of their vertices is visible
+  void filterHiddenFaces (DynamicFaces& faces) const
+  {
+    if (this->visibility && this->visibility->isEmpty () == false && this->isMirrored == false)
+    {
+      const float tolerance = visibilityTolerance * this->radius;
+
+      faces.filter ([this, tolerance](unsigned int i) {
+        const PrimTriangle face = this->_mesh->face (i);
+
+        return this->visibility->isVisible (face.vertex1 (), tolerance) ||
+               this->visibility->isVisible (face.vertex2 (), tolerance) ||
+               this->visibility->isVisible (face.vertex3 (), tolerance);
+      });
+    }
+  }
+
+  void getAffectedFaces (const PrimPlane& plane, DynamicFaces& faces,
+                         DynamicFaces& mirroredFaces) const
+  {
+    assert (this->hasPointOfAction);
+    assert (this->_parameters);
+
+    PROFILE_ZONE ("sculpt/domain")
+    LatencyTimer     timer (LatencyStage::Domain);
+    const PrimSphere sphere = this->sphere ();
+    const PrimSphere mirroredSphere (plane.mirror (sphere.center ()), sphere.radius ());
+
+    faces.reset ();
+    mirroredFaces.reset ();
+    this->_mesh->intersects (sphere, mirroredSphere, faces, mirroredFaces);
+
+    if (this->_parameters->discardBack ())
+    {
+      const glm::vec3 mirroredNormal = plane.mirrorDirection (this->normal ());
+
+      faces.filter ([this](unsigned int i) {
+        return glm::dot (this->normal (), this->_mesh->face (i).cross ()) > 0.0f;
+      });
+      mirroredFaces.filter ([this, &mirroredNormal](unsigned int i) {
+        return glm::dot (mirroredNormal, this->_mesh->face (i).cross ()) > 0.0f;
+      });
+      this->filterHiddenFaces (faces);
     }
-    return faces;
   }
 
   void sculpt (const DynamicFaces& faces) const
   {
     assert (this->_parameters);
+
+    PROFILE_ZONE ("sculpt/deform")
+    LatencyTimer timer (LatencyStage::Deform);
     this->_parameters->sculpt (*this->self, faces);
   }
 
@@ -310,11 +841,15 @@ GETTER_CONST (float, SculptBrush, radius)
 GETTER_CONST (float, SculptBrush, detailFactor)
 GETTER_CONST (float, SculptBrush, stepWidthFactor)
 GETTER_CONST (bool, SculptBrush, subdivide)
+GETTER_CONST (const SculptStamp*, SculptBrush, stamp)
+GETTER_CONST (const SculptVisibility*, SculptBrush, visibility)
 DELEGATE_CONST (DynamicMesh&, SculptBrush, mesh)
 SETTER (float, SculptBrush, radius)
 SETTER (float, SculptBrush, detailFactor)
 SETTER (float, SculptBrush, stepWidthFactor)
 SETTER (bool, SculptBrush, subdivide)
+SETTER (const SculptStamp*, SculptBrush, stamp)
+SETTER (const SculptVisibility*, SculptBrush, visibility)
 DELEGATE_CONST (float, SculptBrush, subdivThreshold)
 DELEGATE_CONST (const glm::vec3&, SculptBrush, lastPosition)
 DELEGATE_CONST (const glm::vec3&, SculptBrush, position)
@@ -326,7 +861,10 @@ GETTER_CONST (bool, SculptBrush, hasPointOfAction)
 DELEGATE3 (void, SculptBrush, setPointOfAction, DynamicMesh&, const glm::vec3&, const glm::vec3&)
 DELEGATE (void, SculptBrush, resetPointOfAction)
 DELEGATE1 (void, SculptBrush, mirror, const PrimPlane&)
-DELEGATE_CONST (DynamicFaces, SculptBrush, getAffectedFaces)
+DELEGATE1_CONST (void, SculptBrush, getAffectedFaces, DynamicFaces&)
+DELEGATE3_CONST (void, SculptBrush, getAffectedFaces, const PrimPlane&, DynamicFaces&,
+                 DynamicFaces&)
+DELEGATE1_CONST (void, SculptBrush, filterAffectedFaces, DynamicFaces&)
 DELEGATE1_CONST (void, SculptBrush, sculpt, const DynamicFaces&)
 DELEGATE_CONST (SBParameters*, SculptBrush, parametersPointer)
 DELEGATE1 (void, SculptBrush, parametersPointer, SBParameters*)
@@ -6,6 +6,7 @@
 #define DILAY_TOOL_SCULPT_BRUSH
 
 #include <glm/glm.hpp>
+#include <vector>
 #include "macro.hpp"
 #include "maybe.hpp"
 
@@ -14,6 +15,8 @@ class DynamicMesh;
 class PrimPlane;
 class PrimSphere;
 class SculptBrush;
+class SculptStamp;
+class SculptVisibility;
 
 class SBParameters
 {
@@ -95,13 +98,27 @@ class SBGrablikeParameters : public SBDiscardBackParameter
 public:
   void sculpt (const SculptBrush&, const DynamicFaces&) const override;
 
+  /* Gets the vertices of the faces that are moved by the brush, together with their weights.
+   * Weights account for masks, such that moving each vertex by `weight * delta` equals `sculpt`.
+   */
+  void weights (const SculptBrush&, const DynamicFaces&, std::vector<unsigned int>&,
+                std::vector<float>&) const;
+
   bool useLastPos () const override { return true; }
 };
 
 class SBSmoothParameters : public SBIntensityParameter
 {
 public:
+  SBSmoothParameters ()
+    : _iterations (1)
+  {
+  }
+
   void sculpt (const SculptBrush&, const DynamicFaces&) const;
+
+  // number of smoothing iterations of each dab
+  MEMBER_GETTER_SETTER (unsigned int, iterations);
 };
 
 class SBReduceParameters : public SBIntensityParameter
@@ -128,7 +145,7 @@ public:
   MEMBER_GETTER_SETTER (bool, lockPlane);
 
 private:
-  Maybe<PrimPlane> _lockedPlane;
+  InlineMaybe<PrimPlane> _lockedPlane;
 };
 
 class SBCreaseParameters : public SBIntensityParameter, public SBInvertParameter
@@ -143,22 +160,35 @@ public:
   void sculpt (const SculptBrush&, const DynamicFaces&) const;
 };
 
+// paints masks, which are cleared if inverted
+class SBMaskParameters : public SBIntensityParameter, public SBInvertParameter
+{
+public:
+  void sculpt (const SculptBrush&, const DynamicFaces&) const override;
+};
+
 class SculptBrush
 {
 public:
   DECLARE_BIG3 (SculptBrush)
 
-  float        radius () const;
-  float        detailFactor () const;
-  float        stepWidthFactor () const;
-  bool         subdivide () const;
-  bool         hasMesh () const;
-  DynamicMesh& mesh () const;
+  float                   radius () const;
+  float                   detailFactor () const;
+  float                   stepWidthFactor () const;
+  bool                    subdivide () const;
+  const SculptStamp*      stamp () const;
+  const SculptVisibility* visibility () const;
+  bool                    hasMesh () const;
+  DynamicMesh&            mesh () const;
 
   void radius (float);
   void detailFactor (float);
   void stepWidthFactor (float);
   void subdivide (bool);
+  // the falloff of the brush is scaled by a non-empty stamp, which is not owned by the brush
+  void stamp (const SculptStamp*);
+  // faces hidden by a non-empty visibility are discarded, which is not owned by the brush
+  void visibility (const SculptVisibility*);
 
   float            subdivThreshold () const;
   const glm::vec3& lastPosition () const;
@@ -172,7 +202,13 @@ public:
   void             resetPointOfAction ();
   void             mirror (const PrimPlane&);
 
-  DynamicFaces getAffectedFaces () const;
+  void         getAffectedFaces (DynamicFaces&) const;
+  // gets the affected faces of the brush and of its mirror image in a single query
+  void         getAffectedFaces (const PrimPlane&, DynamicFaces&, DynamicFaces&) const;
+  /* discards the faces of the brush's sphere that face away from it or that are hidden, if its
+   * parameters do so.  Mirrored brushes keep hidden faces.
+   */
+  void         filterAffectedFaces (DynamicFaces&) const;
   void         sculpt (const DynamicFaces&) const;
 
   template <typename T> T& initParameters ()
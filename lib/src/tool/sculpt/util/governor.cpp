@@ -0,0 +1,136 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <chrono>
+#include <glm/glm.hpp>
+#include "config.hpp"
+#include "dynamic/mesh.hpp"
+#include "tool/sculpt/util/brush.hpp"
+#include "tool/sculpt/util/governor.hpp"
+
+namespace
+{
+  // steps below this fraction of both budgets recover the factors
+  constexpr float recoveryPressure = 0.5f;
+  constexpr float recoveryRate = 0.8f;
+  // factors grow by at most this ratio per step, such that single outliers are damped
+  constexpr float maxGrowthPerStep = 2.0f;
+  constexpr float minDetailFactor = 0.01f;
+
+  typedef std::chrono::steady_clock Clock;
+}
+
+struct SculptGovernor::Impl
+{
+  bool               isEnabled;
+  float              timeBudget;
+  unsigned int       maxFaceGrowth;
+  float              maxScale;
+  float              detailScale;
+  float              stepScale;
+  float              detailFactor;
+  float              stepWidthFactor;
+  const DynamicMesh* mesh;
+  unsigned int       numFaces;
+  Clock::time_point  start;
+
+  Impl ()
+    : isEnabled (false)
+    , timeBudget (0.0f)
+    , maxFaceGrowth (0)
+    , maxScale (1.0f)
+    , mesh (nullptr)
+    , numFaces (0)
+  {
+    this->reset ();
+  }
+
+  bool isThrottling () const { return this->detailScale > 1.0f || this->stepScale > 1.0f; }
+
+  void beginStep (SculptBrush& brush)
+  {
+    this->detailFactor = brush.detailFactor ();
+    this->stepWidthFactor = brush.stepWidthFactor ();
+
+    if (this->isEnabled)
+    {
+      const float threshold = this->detailScale * (1.0f - this->detailFactor);
+
+      brush.detailFactor (glm::max (minDetailFactor, 1.0f - threshold));
+      brush.stepWidthFactor (this->stepScale * this->stepWidthFactor);
+
+      this->mesh = brush.hasPointOfAction () ? &brush.mesh () : nullptr;
+      this->numFaces = this->mesh ? this->mesh->numFaces () : 0;
+      this->start = Clock::now ();
+    }
+  }
+
+  void endStep (SculptBrush& brush)
+  {
+    brush.detailFactor (this->detailFactor);
+    brush.stepWidthFactor (this->stepWidthFactor);
+
+    if (this->isEnabled)
+    {
+      const std::chrono::duration<float, std::milli> time = Clock::now () - this->start;
+      const bool sameMesh = brush.hasPointOfAction () && &brush.mesh () == this->mesh;
+      const unsigned int numFaces = sameMesh ? brush.mesh ().numFaces () : 0;
+      const unsigned int growth = numFaces > this->numFaces ? numFaces - this->numFaces : 0;
+
+      const float timePressure = time.count () / this->timeBudget;
+      const float growthPressure = float(growth) / float(this->maxFaceGrowth);
+      const float pressure = glm::max (timePressure, growthPressure);
+
+      this->detailScale = this->adjust (this->detailScale, pressure);
+      this->stepScale = this->adjust (this->stepScale, timePressure);
+    }
+  }
+
+  float adjust (float scale, float pressure) const
+  {
+    if (pressure > 1.0f)
+    {
+      return glm::min (this->maxScale, scale * glm::min (pressure, maxGrowthPerStep));
+    }
+    else if (pressure < recoveryPressure)
+    {
+      return glm::max (1.0f, scale * recoveryRate);
+    }
+    else
+    {
+      return scale;
+    }
+  }
+
+  void reset ()
+  {
+    this->detailScale = 1.0f;
+    this->stepScale = 1.0f;
+  }
+
+  void runFromConfig (const Config& config)
+  {
+    this->isEnabled = config.get<bool> ("editor/tool/sculpt/governor/enabled");
+    const int timeBudget = config.get<int> ("editor/tool/sculpt/governor/time-budget");
+    const int maxFaceGrowth = config.get<int> ("editor/tool/sculpt/governor/max-face-growth");
+
+    this->timeBudget = float(glm::max (1, timeBudget));
+    this->maxFaceGrowth = glm::max (1, maxFaceGrowth);
+    this->maxScale = glm::max (1.0f, config.get<float> ("editor/tool/sculpt/governor/max-scale"));
+
+    if (this->isEnabled == false)
+    {
+      this->reset ();
+    }
+  }
+};
+
+DELEGATE_BIG2 (SculptGovernor)
+DELEGATE_CONST (bool, SculptGovernor, isThrottling)
+GETTER_CONST (float, SculptGovernor, detailScale)
+GETTER_CONST (float, SculptGovernor, stepScale)
+DELEGATE1 (void, SculptGovernor, beginStep, SculptBrush&)
+DELEGATE1 (void, SculptGovernor, endStep, SculptBrush&)
+DELEGATE (void, SculptGovernor, reset)
+DELEGATE1 (void, SculptGovernor, runFromConfig, const Config&)
@@ -0,0 +1,40 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_SCULPT_GOVERNOR
+#define DILAY_TOOL_SCULPT_GOVERNOR
+
+#include "macro.hpp"
+
+class Config;
+class SculptBrush;
+
+/* Limits the detail and the dab rate of dynamic-topology strokes, such that each step of a
+ * stroke stays within a time budget and adds a bounded number of faces.  A step that exceeds a
+ * budget coarsens the subdivision threshold and widens the step width of the following steps by
+ * the exceeded ratio.  Both recover gradually once steps are well within their budgets.  The
+ * brush is only adjusted during a step, such that recorded strokes replay the adjusted dabs.
+ */
+class SculptGovernor
+{
+public:
+  DECLARE_BIG2 (SculptGovernor)
+
+  bool  isThrottling () const;
+  // factors of the subdivision threshold and of the step width, which are at least 1
+  float detailScale () const;
+  float stepScale () const;
+
+  // adjusts the brush for the next step of a stroke
+  void beginStep (SculptBrush&);
+  // restores the brush and updates the factors by the duration and the face growth of the step
+  void endStep (SculptBrush&);
+  void reset ();
+  void runFromConfig (const Config&);
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -0,0 +1,124 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QImage>
+#include <QString>
+#include <glm/glm.hpp>
+#include <utility>
+#include <vector>
+#include "tool/sculpt/util/stamp.hpp"
+
+namespace
+{
+  constexpr unsigned int maxWidth = 1024;
+}
+
+struct SculptStamp::Impl
+{
+  std::vector<std::vector<float>> levels;
+  unsigned int                    baseWidth;
+
+  Impl ()
+    : baseWidth (0)
+  {
+  }
+
+  bool isEmpty () const { return this->levels.empty (); }
+
+  void reset ()
+  {
+    this->levels.clear ();
+    this->baseWidth = 0;
+  }
+
+  bool fromFile (const QString& fileName)
+  {
+    QImage image (fileName);
+
+    if (image.isNull ())
+    {
+      return false;
+    }
+
+    const int    size = glm::max (image.width (), image.height ());
+    unsigned int w = 1;
+
+    while (w < (unsigned int) size && w < maxWidth)
+    {
+      w *= 2;
+    }
+    image = image.scaled (int(w), int(w), Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+              .convertToFormat (QImage::Format_ARGB32);
+
+    this->reset ();
+    this->baseWidth = w;
+    this->levels.emplace_back (w * w);
+
+    for (unsigned int y = 0; y < w; y++)
+    {
+      const QRgb* line = reinterpret_cast<const QRgb*> (image.constScanLine (int(y)));
+
+      for (unsigned int x = 0; x < w; x++)
+      {
+        const float value = float(qGray (line[x]) * qAlpha (line[x])) / (255.0f * 255.0f);
+
+        this->levels[0][(y * w) + x] = value;
+      }
+    }
+
+    for (; w > 1; w /= 2)
+    {
+      const std::vector<float>& fine = this->levels.back ();
+      const unsigned int        c = w / 2;
+      std::vector<float>        coarse (c * c);
+
+      for (unsigned int y = 0; y < c; y++)
+      {
+        for (unsigned int x = 0; x < c; x++)
+        {
+          const unsigned int i = (2 * y * w) + (2 * x);
+
+          coarse[(y * c) + x] = 0.25f * (fine[i] + fine[i + 1] + fine[i + w] + fine[i + w + 1]);
+        }
+      }
+      this->levels.push_back (std::move (coarse));
+    }
+    return true;
+  }
+
+  unsigned int numLevels () const { return this->levels.size (); }
+
+  unsigned int width (unsigned int l) const
+  {
+    assert (l < this->numLevels ());
+    return this->baseWidth >> l;
+  }
+
+  const float* texels (unsigned int l) const
+  {
+    assert (l < this->numLevels ());
+    return this->levels[l].data ();
+  }
+
+  unsigned int level (float numTexels) const
+  {
+    assert (this->isEmpty () == false);
+
+    unsigned int l = 0;
+    while (l + 1 < this->numLevels () && float(this->width (l + 1)) >= numTexels)
+    {
+      l++;
+    }
+    return l;
+  }
+};
+
+DELEGATE_BIG2 (SculptStamp)
+DELEGATE_CONST (bool, SculptStamp, isEmpty)
+DELEGATE (void, SculptStamp, reset)
+DELEGATE1 (bool, SculptStamp, fromFile, const QString&)
+DELEGATE_CONST (unsigned int, SculptStamp, numLevels)
+DELEGATE1_CONST (unsigned int, SculptStamp, width, unsigned int)
+DELEGATE1_CONST (const float*, SculptStamp, texels, unsigned int)
+DELEGATE1_CONST (unsigned int, SculptStamp, level, float)
@@ -0,0 +1,38 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_SCULPT_STAMP
+#define DILAY_TOOL_SCULPT_STAMP
+
+#include "macro.hpp"
+
+class QString;
+
+/* Square alpha map that scales the falloff of a brush.  Its texels are stored as a chain of
+ * levels, each of which has half the width of the previous one, such that large brushes can
+ * sample a level that matches the density of the mesh's vertices.
+ */
+class SculptStamp
+{
+public:
+  DECLARE_BIG2 (SculptStamp)
+
+  bool isEmpty () const;
+  void reset ();
+
+  // loads the product of brightness and alpha of an image, which is scaled to a power of two
+  bool fromFile (const QString&);
+
+  unsigned int numLevels () const;
+  unsigned int width (unsigned int) const;
+  const float* texels (unsigned int) const;
+
+  // returns the coarsest level with at least the given number of texels along each side
+  unsigned int level (float) const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
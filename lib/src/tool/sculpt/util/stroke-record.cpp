@@ -0,0 +1,565 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <glm/glm.hpp>
+#include "dynamic/mesh.hpp"
+#include "import-export.hpp"
+#include "primitive/plane.hpp"
+#include "scene.hpp"
+#include "tool/sculpt/util/action.hpp"
+#include "tool/sculpt/util/brush.hpp"
+#include "tool/sculpt/util/stroke-record.hpp"
+#include "util.hpp"
+
+namespace
+{
+  /* A record starts with `recordMagic` and `recordVersion`, followed by entries, each of which
+   * starts with its tag.  Values are stored in native byte order.
+   */
+  const char          recordMagic[] = {'D', 'L', 'Y', 'S'};
+  const std::uint32_t recordVersion = 2;
+
+  enum class Tag : std::uint32_t
+  {
+    BeginStep,
+    Dab,
+    EndStep,
+    EndStroke
+  };
+
+  enum class Kind : std::uint32_t
+  {
+    Draw,
+    Grablike,
+    Smooth,
+    Reduce,
+    Flatten,
+    Crease,
+    Pinch,
+    Mask
+  };
+
+  enum Flag : std::uint32_t
+  {
+    Subdivide = 1 << 0,
+    Invert = 1 << 1,
+    Flat = 1 << 2,
+    ConstantHeight = 1 << 3,
+    DiscardBack = 1 << 4,
+    LockPlane = 1 << 5,
+    Mirror = 1 << 6
+  };
+
+  struct Dab
+  {
+    std::uint32_t meshIndex;
+    Kind          kind;
+    std::uint32_t flags;
+    float         radius;
+    float         detailFactor;
+    float         stepWidthFactor;
+    float         intensity;
+    std::uint32_t iterations;
+    glm::vec3     lastPosition;
+    glm::vec3     position;
+    glm::vec3     normal;
+    glm::vec3     mirrorPoint;
+    glm::vec3     mirrorNormal;
+
+    bool hasFlag (Flag flag) const { return (this->flags & flag) != 0; }
+  };
+
+  template <typename T> void write (std::ostream& stream, const T& value)
+  {
+    stream.write (reinterpret_cast<const char*> (&value), sizeof (T));
+  }
+
+  template <typename T> bool read (std::istream& stream, T& value)
+  {
+    return bool(stream.read (reinterpret_cast<char*> (&value), sizeof (T)));
+  }
+
+  void write (std::ostream& stream, const glm::vec3& v)
+  {
+    write (stream, v.x);
+    write (stream, v.y);
+    write (stream, v.z);
+  }
+
+  bool read (std::istream& stream, glm::vec3& v)
+  {
+    return read (stream, v.x) && read (stream, v.y) && read (stream, v.z);
+  }
+
+  Kind parametersKind (const SBParameters& p)
+  {
+    if (dynamic_cast<const SBDrawParameters*> (&p))
+    {
+      return Kind::Draw;
+    }
+    else if (dynamic_cast<const SBGrablikeParameters*> (&p))
+    {
+      return Kind::Grablike;
+    }
+    else if (dynamic_cast<const SBSmoothParameters*> (&p))
+    {
+      return Kind::Smooth;
+    }
+    else if (dynamic_cast<const SBReduceParameters*> (&p))
+    {
+      return Kind::Reduce;
+    }
+    else if (dynamic_cast<const SBFlattenParameters*> (&p))
+    {
+      return Kind::Flatten;
+    }
+    else if (dynamic_cast<const SBCreaseParameters*> (&p))
+    {
+      return Kind::Crease;
+    }
+    else if (dynamic_cast<const SBPinchParameters*> (&p))
+    {
+      return Kind::Pinch;
+    }
+    else if (dynamic_cast<const SBMaskParameters*> (&p))
+    {
+      return Kind::Mask;
+    }
+    DILAY_IMPOSSIBLE
+  }
+
+  std::uint32_t parametersFlags (const SBParameters& p)
+  {
+    std::uint32_t flags = p.discardBack () ? Flag::DiscardBack : 0;
+
+    if (auto invert = dynamic_cast<const SBInvertParameter*> (&p))
+    {
+      flags |= invert->invert () ? Flag::Invert : 0;
+    }
+    if (auto draw = dynamic_cast<const SBDrawParameters*> (&p))
+    {
+      flags |= draw->flat () ? Flag::Flat : 0;
+      flags |= draw->constantHeight () ? Flag::ConstantHeight : 0;
+    }
+    if (auto flatten = dynamic_cast<const SBFlattenParameters*> (&p))
+    {
+      flags |= flatten->lockPlane () ? Flag::LockPlane : 0;
+    }
+    return flags;
+  }
+
+  std::uint32_t parametersIterations (const SBParameters& p)
+  {
+    if (auto smooth = dynamic_cast<const SBSmoothParameters*> (&p))
+    {
+      return smooth->iterations ();
+    }
+    return 1;
+  }
+
+  SBParameters& initParameters (SculptBrush& brush, Kind kind)
+  {
+    switch (kind)
+    {
+      case Kind::Draw:
+        return brush.initParameters<SBDrawParameters> ();
+      case Kind::Grablike:
+        return brush.initParameters<SBGrablikeParameters> ();
+      case Kind::Smooth:
+        return brush.initParameters<SBSmoothParameters> ();
+      case Kind::Reduce:
+        return brush.initParameters<SBReduceParameters> ();
+      case Kind::Flatten:
+        return brush.initParameters<SBFlattenParameters> ();
+      case Kind::Crease:
+        return brush.initParameters<SBCreaseParameters> ();
+      case Kind::Pinch:
+        return brush.initParameters<SBPinchParameters> ();
+      case Kind::Mask:
+        return brush.initParameters<SBMaskParameters> ();
+      default:
+        DILAY_IMPOSSIBLE
+    }
+  }
+
+  void applyParameters (SBParameters& p, const Dab& dab)
+  {
+    p.intensity (dab.intensity);
+
+    if (auto invert = dynamic_cast<SBInvertParameter*> (&p))
+    {
+      invert->invert (dab.hasFlag (Flag::Invert));
+    }
+    if (auto draw = dynamic_cast<SBDrawParameters*> (&p))
+    {
+      draw->flat (dab.hasFlag (Flag::Flat));
+      draw->constantHeight (dab.hasFlag (Flag::ConstantHeight));
+    }
+    if (auto discardBack = dynamic_cast<SBDiscardBackParameter*> (&p))
+    {
+      discardBack->discardBack (dab.hasFlag (Flag::DiscardBack));
+    }
+    if (auto flatten = dynamic_cast<SBFlattenParameters*> (&p))
+    {
+      flatten->lockPlane (dab.hasFlag (Flag::LockPlane));
+    }
+    if (auto smooth = dynamic_cast<SBSmoothParameters*> (&p))
+    {
+      smooth->iterations (dab.iterations);
+    }
+  }
+
+  void writeDab (std::ostream& stream, const Dab& dab)
+  {
+    write (stream, Tag::Dab);
+    write (stream, dab.meshIndex);
+    write (stream, dab.kind);
+    write (stream, dab.flags);
+    write (stream, dab.radius);
+    write (stream, dab.detailFactor);
+    write (stream, dab.stepWidthFactor);
+    write (stream, dab.intensity);
+    write (stream, dab.iterations);
+    write (stream, dab.lastPosition);
+    write (stream, dab.position);
+    write (stream, dab.normal);
+
+    if (dab.hasFlag (Flag::Mirror))
+    {
+      write (stream, dab.mirrorPoint);
+      write (stream, dab.mirrorNormal);
+    }
+  }
+
+  bool readDab (std::istream& stream, Dab& dab)
+  {
+    const bool success =
+      read (stream, dab.meshIndex) && read (stream, dab.kind) && read (stream, dab.flags) &&
+      read (stream, dab.radius) && read (stream, dab.detailFactor) &&
+      read (stream, dab.stepWidthFactor) && read (stream, dab.intensity) &&
+      read (stream, dab.iterations) && read (stream, dab.lastPosition) &&
+      read (stream, dab.position) && read (stream, dab.normal);
+
+    if (success == false || dab.kind > Kind::Mask)
+    {
+      return false;
+    }
+    else if (dab.hasFlag (Flag::Mirror))
+    {
+      return read (stream, dab.mirrorPoint) && read (stream, dab.mirrorNormal);
+    }
+    return true;
+  }
+
+  unsigned int meshIndex (const Scene& scene, const DynamicMesh& mesh)
+  {
+    unsigned int i = 0;
+    unsigned int index = Util::invalidIndex ();
+
+    scene.forEachConstMesh ([&mesh, &i, &index](const DynamicMesh& m) {
+      if (&m == &mesh)
+      {
+        index = i;
+      }
+      i++;
+    });
+    return index;
+  }
+}
+
+struct SculptStrokeRecorder::Impl
+{
+  std::ofstream     file;
+  Clock::time_point startTime;
+  bool              isInStep;
+  bool              isInStroke;
+
+  Impl ()
+    : isInStep (false)
+    , isInStroke (false)
+  {
+  }
+
+  ~Impl () { this->stop (); }
+
+  bool isRecording () const { return this->file.is_open (); }
+
+  bool start (const std::string& fileName, const Scene& scene)
+  {
+    this->stop ();
+
+    if (ImportExportSnapshot (scene).toDlyFile (fileName + ".dly") == false)
+    {
+      return false;
+    }
+
+    this->file.open (fileName, std::ios::binary);
+    if (this->file.is_open () == false)
+    {
+      return false;
+    }
+    this->file.write (recordMagic, sizeof (recordMagic));
+    write (this->file, recordVersion);
+    this->startTime = Clock::now ();
+    return true;
+  }
+
+  void stop ()
+  {
+    if (this->isRecording ())
+    {
+      this->endStroke ();
+      this->file.close ();
+    }
+  }
+
+  void beginStep (const Clock::time_point& time)
+  {
+    if (this->isRecording ())
+    {
+      this->endStep ();
+
+      const std::chrono::duration<float, std::milli> recordedTime = time - this->startTime;
+
+      write (this->file, Tag::BeginStep);
+      write (this->file, recordedTime.count ());
+      this->isInStep = true;
+      this->isInStroke = true;
+    }
+  }
+
+  void dab (const Scene& scene, const SculptBrush& brush, const PrimPlane* mirror)
+  {
+    if (this->isRecording () && this->isInStep)
+    {
+      assert (brush.hasPointOfAction ());
+
+      const SBParameters& parameters = brush.parameters ();
+      Dab                 dab;
+
+      dab.meshIndex = meshIndex (scene, brush.mesh ());
+      dab.kind = parametersKind (parameters);
+      dab.flags = parametersFlags (parameters);
+      dab.flags |= brush.subdivide () ? Flag::Subdivide : 0;
+      dab.flags |= mirror ? Flag::Mirror : 0;
+      dab.radius = brush.radius ();
+      dab.detailFactor = brush.detailFactor ();
+      dab.stepWidthFactor = brush.stepWidthFactor ();
+      dab.intensity = parameters.intensity ();
+      dab.iterations = parametersIterations (parameters);
+      dab.lastPosition = brush.lastPosition ();
+      dab.position = brush.position ();
+      dab.normal = brush.normal ();
+
+      if (mirror)
+      {
+        dab.mirrorPoint = mirror->point ();
+        dab.mirrorNormal = mirror->normal ();
+      }
+      writeDab (this->file, dab);
+    }
+  }
+
+  void endStep ()
+  {
+    if (this->isRecording () && this->isInStep)
+    {
+      write (this->file, Tag::EndStep);
+      this->isInStep = false;
+    }
+  }
+
+  void endStroke ()
+  {
+    if (this->isRecording () && this->isInStroke)
+    {
+      this->endStep ();
+      write (this->file, Tag::EndStroke);
+      this->file.flush ();
+      this->isInStroke = false;
+    }
+  }
+};
+
+DELEGATE_BIG2 (SculptStrokeRecorder)
+DELEGATE_CONST (bool, SculptStrokeRecorder, isRecording)
+DELEGATE2 (bool, SculptStrokeRecorder, start, const std::string&, const Scene&)
+DELEGATE (void, SculptStrokeRecorder, stop)
+DELEGATE1 (void, SculptStrokeRecorder, beginStep, const SculptStrokeRecorder::Clock::time_point&)
+DELEGATE3 (void, SculptStrokeRecorder, dab, const Scene&, const SculptBrush&, const PrimPlane*)
+DELEGATE (void, SculptStrokeRecorder, endStep)
+DELEGATE (void, SculptStrokeRecorder, endStroke)
+
+namespace
+{
+  typedef std::chrono::steady_clock Clock;
+
+  class Replay
+  {
+  public:
+    Replay (std::vector<DynamicMesh>& m, const SculptStrokeReplay::StepCallback& f)
+      : meshes (m)
+      , callback (f)
+      , isInStep (false)
+      , isNewStroke (true)
+    {
+      this->step.stroke = 0;
+      this->step.numDabs = 0;
+      this->step.recordedTime = 0.0f;
+      this->step.duration = 0.0f;
+    }
+
+    ~Replay ()
+    {
+      if (this->isInStep)
+      {
+        ToolSculptAction::closeBatch ();
+      }
+      ToolSculptAction::finishRefinement ();
+    }
+
+    bool run (std::istream& stream)
+    {
+      char          magic[sizeof (recordMagic)];
+      std::uint32_t version;
+
+      if (stream.read (magic, sizeof (magic)).fail () ||
+          std::memcmp (magic, recordMagic, sizeof (magic)) != 0 ||
+          read (stream, version) == false || version != recordVersion)
+      {
+        return false;
+      }
+
+      Tag tag;
+      while (read (stream, tag))
+      {
+        if (this->runEntry (stream, tag) == false)
+        {
+          return false;
+        }
+      }
+      return stream.eof ();
+    }
+
+  private:
+    bool runEntry (std::istream& stream, Tag tag)
+    {
+      switch (tag)
+      {
+        case Tag::BeginStep:
+          if (this->isInStep || read (stream, this->step.recordedTime) == false)
+          {
+            return false;
+          }
+          this->step.numDabs = 0;
+          this->isInStep = true;
+          this->start = Clock::now ();
+
+          ToolSculptAction::openBatch ();
+          ToolSculptAction::refinementDeadline (0);
+          return true;
+
+        case Tag::Dab:
+        {
+          Dab dab;
+          if (this->isInStep == false || readDab (stream, dab) == false ||
+              dab.meshIndex >= this->meshes.size ())
+          {
+            return false;
+          }
+          this->sculpt (dab);
+          this->step.numDabs++;
+          return true;
+        }
+        case Tag::EndStep:
+        {
+          if (this->isInStep == false)
+          {
+            return false;
+          }
+          ToolSculptAction::refineDeferred ();
+          ToolSculptAction::closeBatch ();
+          this->isInStep = false;
+
+          const std::chrono::duration<float, std::milli> duration = Clock::now () - this->start;
+
+          this->step.duration = duration.count ();
+          this->callback (this->step);
+          return true;
+        }
+        case Tag::EndStroke:
+          if (this->isInStep)
+          {
+            return false;
+          }
+          ToolSculptAction::finishRefinement ();
+          this->brush.resetPointOfAction ();
+          this->step.stroke++;
+          this->isNewStroke = true;
+          return true;
+
+        default:
+          return false;
+      }
+    }
+
+    void sculpt (const Dab& dab)
+    {
+      DynamicMesh& mesh = this->meshes[dab.meshIndex];
+
+      if (mesh.isEmpty ())
+      {
+        return;
+      }
+
+      if (this->isNewStroke)
+      {
+        initParameters (this->brush, dab.kind);
+        this->isNewStroke = false;
+      }
+      applyParameters (this->brush.parameters<SBParameters> (), dab);
+
+      this->brush.radius (dab.radius);
+      this->brush.detailFactor (dab.detailFactor);
+      this->brush.stepWidthFactor (dab.stepWidthFactor);
+      this->brush.subdivide (dab.hasFlag (Flag::Subdivide));
+
+      // restores the previous position of the point of action as well
+      this->brush.resetPointOfAction ();
+      this->brush.setPointOfAction (mesh, dab.lastPosition, dab.normal);
+      this->brush.setPointOfAction (mesh, dab.position, dab.normal);
+
+      if (dab.hasFlag (Flag::Mirror))
+      {
+        ToolSculptAction::sculpt (this->brush, PrimPlane (dab.mirrorPoint, dab.mirrorNormal));
+      }
+      else
+      {
+        ToolSculptAction::sculpt (this->brush);
+      }
+    }
+
+    std::vector<DynamicMesh>&               meshes;
+    const SculptStrokeReplay::StepCallback& callback;
+    SculptBrush                             brush;
+    SculptStrokeReplayStep                  step;
+    Clock::time_point                       start;
+    bool                                    isInStep;
+    bool                                    isNewStroke;
+  };
+}
+
+namespace SculptStrokeReplay
+{
+  bool replay (const std::string& fileName, std::vector<DynamicMesh>& meshes,
+               const StepCallback& f)
+  {
+    std::ifstream file (fileName, std::ios::binary);
+
+    return file.is_open () && Replay (meshes, f).run (file);
+  }
+}
@@ -0,0 +1,65 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_SCULPT_STROKE_RECORD
+#define DILAY_TOOL_SCULPT_STROKE_RECORD
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include "macro.hpp"
+
+class DynamicMesh;
+class PrimPlane;
+class Scene;
+class SculptBrush;
+
+/* Records sculpt strokes as a sequence of steps, each of which holds the dabs of a single pointing
+ * event.  A dab consists of the settings, parameters and point of action of the brush, and of the
+ * index of its mesh in the scene.  Starting a recording saves the scene next to the record, such
+ * that its strokes can be replayed without camera, tools or OpenGL.  Stamps are not recorded.
+ */
+class SculptStrokeRecorder
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  DECLARE_BIG2 (SculptStrokeRecorder)
+
+  bool isRecording () const;
+  // writes the scene to `<file>.dly` and returns `false` if either file cannot be written
+  bool start (const std::string&, const Scene&);
+  void stop ();
+  // steps are timed by the timestamps of their pointing events
+  void beginStep (const Clock::time_point&);
+  void dab (const Scene&, const SculptBrush&, const PrimPlane*);
+  void endStep ();
+  void endStroke ();
+
+private:
+  IMPLEMENTATION
+};
+
+struct SculptStrokeReplayStep
+{
+  unsigned int stroke;
+  unsigned int numDabs;
+  // milliseconds since the start of the recording, and milliseconds it took to replay the step
+  float recordedTime;
+  float duration;
+};
+
+namespace SculptStrokeReplay
+{
+  typedef std::function<void(const SculptStrokeReplayStep&)> StepCallback;
+
+  /* Replays a record against the meshes of its scene, like the sculpt tool without a subdivision
+   * budget, such that each replay yields the same meshes.  Returns `false` if the record cannot
+   * be read or refers to a missing mesh.
+   */
+  bool replay (const std::string&, std::vector<DynamicMesh>&, const StepCallback&);
+}
+
+#endif
@@ -0,0 +1,129 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include <limits>
+#include <vector>
+#include "camera.hpp"
+#include "tool/sculpt/util/visibility.hpp"
+
+struct SculptVisibility::Impl
+{
+  glm::mat4x4        viewProjection;
+  glm::vec2          resolution;
+  glm::vec3          eye;
+  glm::ivec2         windowMin;
+  glm::ivec2         windowSize;
+  std::vector<float> distances;
+
+  bool isEmpty () const { return this->distances.empty (); }
+
+  void reset () { this->distances.clear (); }
+
+  void fromDepths (const Camera& camera, const glm::ivec2& min, const glm::ivec2& size,
+                   const std::vector<float>& depths, unsigned int ringWidth)
+  {
+    assert (depths.size () == std::size_t (size.x * size.y));
+
+    this->viewProjection = camera.projection () * camera.view ();
+    this->resolution = glm::vec2 (camera.resolution ());
+    this->eye = camera.position ();
+    this->windowMin = min;
+    this->windowSize = size;
+
+    const glm::mat4x4  unprojection = glm::inverse (this->viewProjection);
+    std::vector<float> surface (depths.size ());
+
+    for (int y = 0; y < size.y; y++)
+    {
+      for (int x = 0; x < size.x; x++)
+      {
+        const unsigned int i = (y * size.x) + x;
+
+        if (depths[i] >= 1.0f)
+        {
+          surface[i] = std::numeric_limits<float>::infinity ();
+        }
+        else
+        {
+          const glm::vec4 ndc ((2.0f * float(min.x + x) / this->resolution.x) - 1.0f,
+                               1.0f - (2.0f * float(min.y + y) / this->resolution.y),
+                               (2.0f * depths[i]) - 1.0f, 1.0f);
+          const glm::vec4 p = unprojection * ndc;
+
+          surface[i] = glm::distance (this->eye, glm::vec3 (p) / p.w);
+        }
+      }
+    }
+    this->widen (surface, ringWidth);
+  }
+
+  // takes the largest distance of each square of points around a point, one axis after the other
+  void widen (const std::vector<float>& surface, unsigned int ringWidth)
+  {
+    const int          r = int(ringWidth);
+    const glm::ivec2&  size = this->windowSize;
+    std::vector<float> rows (surface.size ());
+
+    for (int y = 0; y < size.y; y++)
+    {
+      for (int x = 0; x < size.x; x++)
+      {
+        float d = surface[(y * size.x) + x];
+        for (int n = glm::max (0, x - r); n <= glm::min (size.x - 1, x + r); n++)
+        {
+          d = glm::max (d, surface[(y * size.x) + n]);
+        }
+        rows[(y * size.x) + x] = d;
+      }
+    }
+
+    this->distances.resize (surface.size ());
+    for (int y = 0; y < size.y; y++)
+    {
+      for (int x = 0; x < size.x; x++)
+      {
+        float d = rows[(y * size.x) + x];
+        for (int n = glm::max (0, y - r); n <= glm::min (size.y - 1, y + r); n++)
+        {
+          d = glm::max (d, rows[(n * size.x) + x]);
+        }
+        this->distances[(y * size.x) + x] = d;
+      }
+    }
+  }
+
+  bool isVisible (const glm::vec3& point, float tolerance) const
+  {
+    assert (this->isEmpty () == false);
+
+    const glm::vec4 clip = this->viewProjection * glm::vec4 (point, 1.0f);
+
+    if (clip.w <= 0.0f)
+    {
+      return true;
+    }
+
+    const glm::vec2  ndc = glm::vec2 (clip) / clip.w;
+    const glm::ivec2 p =
+      glm::ivec2 (glm::round (glm::vec2 ((ndc.x + 1.0f) * 0.5f * this->resolution.x,
+                                         (1.0f - ndc.y) * 0.5f * this->resolution.y))) -
+      this->windowMin;
+
+    if (glm::any (glm::lessThan (p, glm::ivec2 (0))) ||
+        glm::any (glm::greaterThanEqual (p, this->windowSize)))
+    {
+      return true;
+    }
+    return glm::distance (this->eye, point) <=
+           this->distances[(p.y * this->windowSize.x) + p.x] + tolerance;
+  }
+};
+
+DELEGATE_BIG2 (SculptVisibility)
+DELEGATE_CONST (bool, SculptVisibility, isEmpty)
+DELEGATE (void, SculptVisibility, reset)
+DELEGATE5 (void, SculptVisibility, fromDepths, const Camera&, const glm::ivec2&, const glm::ivec2&,
+           const std::vector<float>&, unsigned int)
+DELEGATE2_CONST (bool, SculptVisibility, isVisible, const glm::vec3&, float)
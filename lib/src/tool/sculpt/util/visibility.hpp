@@ -0,0 +1,38 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_SCULPT_VISIBILITY
+#define DILAY_TOOL_SCULPT_VISIBILITY
+
+#include <glm/fwd.hpp>
+#include <vector>
+#include "macro.hpp"
+
+class Camera;
+
+/* Distances of the visible surface from the eye in a window of points around a brush, which are
+ * taken from the depth buffer of a frame.  The visible surface is widened by a ring of points,
+ * such that faces next to silhouettes are kept.  A point is hidden if it is farther away than the
+ * visible surface by more than a tolerance.
+ */
+class SculptVisibility
+{
+public:
+  DECLARE_BIG2 (SculptVisibility)
+
+  bool isEmpty () const;
+  void reset ();
+
+  // the window is given by its top left point and its size, and its depths row by row
+  void fromDepths (const Camera&, const glm::ivec2&, const glm::ivec2&, const std::vector<float>&,
+                   unsigned int);
+
+  // points outside of the window are visible
+  bool isVisible (const glm::vec3&, float) const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
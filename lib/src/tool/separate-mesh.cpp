@@ -0,0 +1,67 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QObject>
+#include <vector>
+#include "dynamic/mesh-intersection.hpp"
+#include "dynamic/mesh.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "scene.hpp"
+#include "state.hpp"
+#include "tools.hpp"
+#include "view/pointing-event.hpp"
+#include "view/tool-tip.hpp"
+
+struct ToolSeparateMesh::Impl
+{
+  ToolSeparateMesh* self;
+
+  Impl (ToolSeparateMesh* s)
+    : self (s)
+  {
+  }
+
+  ToolResponse runInitialize ()
+  {
+    ViewToolTip toolTip;
+    toolTip.add (ViewInputEvent::MouseLeft, QObject::tr ("Separate selection"));
+    this->self->state ().setToolTip (&toolTip);
+
+    return ToolResponse::None;
+  }
+
+  // replaces the selected mesh by its connected components
+  ToolResponse runReleaseEvent (const ViewPointingEvent& e)
+  {
+    if (e.leftButton ())
+    {
+      DynamicMeshIntersection intersection;
+      if (this->self->intersectsScene (e, intersection))
+      {
+        // the mesh is not pruned, because it is kept without a snapshot if it is connected
+        DynamicMesh&            mesh = intersection.mesh ();
+        const std::vector<Mesh> components = MeshUtil::components (
+          MeshUtil::compact (mesh.mesh (), mesh.freeVertexIndices (), mesh.freeFaceIndices ()));
+        if (components.size () > 1)
+        {
+          Scene& scene = this->self->state ().scene ();
+
+          this->self->snapshotDynamicMeshes ();
+          scene.deleteMesh (mesh);
+
+          for (const Mesh& component : components)
+          {
+            scene.newDynamicMesh (this->self->state ().config (), component);
+          }
+          return ToolResponse::Redraw;
+        }
+      }
+    }
+    return ToolResponse::None;
+  }
+};
+
+DELEGATE_TOOL (ToolSeparateMesh)
+DELEGATE_TOOL_RUN_RELEASE_EVENT (ToolSeparateMesh)
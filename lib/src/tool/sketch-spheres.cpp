@@ -2,6 +2,7 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <QCheckBox>
 #include <QFrame>
 #include "cache.hpp"
 #include "camera.hpp"
@@ -16,10 +17,12 @@
 #include "sketch/path-intersection.hpp"
 #include "sketch/path.hpp"
 #include "state.hpp"
+#include "tool/util/sketch-preview.hpp"
 #include "tool/util/step.hpp"
 #include "tools.hpp"
 #include "view/cursor.hpp"
 #include "view/double-slider.hpp"
+#include "view/main-window.hpp"
 #include "view/pointing-event.hpp"
 #include "view/tool-tip.hpp"
 #include "view/two-column-grid.hpp"
@@ -35,6 +38,9 @@ struct ToolSketchSpheres::Impl
   float                  stepWidthFactor;
   SketchMesh*            mesh;
   ToolUtilStep           step;
+  SketchPath::Spheres    stepSpheres;
+  bool                   showPreview;
+  ToolUtilSketchPreview  preview;
 
   Impl (ToolSketchSpheres* s)
     : self (s)
@@ -44,6 +50,8 @@ struct ToolSketchSpheres::Impl
         s->cache ().get<int> ("smooth-effect", int(SketchPathSmoothEffect::Embed))))
     , stepWidthFactor (0.0f)
     , mesh (nullptr)
+    , showPreview (s->cache ().get<bool> ("preview", false))
+    , preview (s->state ().mainWindow ().infoPane (), [this]() { this->self->updateGlWidget (); })
   {
   }
 
@@ -73,6 +81,25 @@ struct ToolSketchSpheres::Impl
       this->self->cache ().set ("smooth-effect", id);
     });
     properties.addStacked (QObject::tr ("Smoothing effect"), smoothEffectEdit);
+
+    properties.add (ViewUtil::horizontalLine ());
+
+    QCheckBox& previewEdit = ViewUtil::checkBox (QObject::tr ("Preview"), this->showPreview);
+    ViewUtil::connect (previewEdit, [this](bool p) {
+      this->showPreview = p;
+      this->self->cache ().set ("preview", p);
+      this->preview.reset ();
+      this->self->updateGlWidget ();
+    });
+    properties.add (previewEdit);
+  }
+
+  void updatePreview ()
+  {
+    if (this->showPreview && this->mesh)
+    {
+      this->preview.update (*this->mesh);
+    }
   }
 
   void setupToolTip ()
@@ -106,6 +133,10 @@ struct ToolSketchSpheres::Impl
   {
     Camera& camera = this->self->state ().camera ();
 
+    if (this->showPreview)
+    {
+      this->preview.render (camera);
+    }
     if (this->cursor.isEnabled ())
     {
       this->cursor.render (camera);
@@ -178,17 +209,20 @@ struct ToolSketchSpheres::Impl
           this->cursor.enable ();
           this->cursor.position (intersection.position ());
 
+          // spheres of a single event are added at once into a buffer that is reused
+          this->stepSpheres.clear ();
           this->step.step (intersection.position (), [this, considerHeight,
                                                       &intersection](const glm::vec3& position) {
-            this->mesh->addSphere (
-              false, intersection.position (),
+            this->stepSpheres.emplace_back (
               this->newSpherePosition (considerHeight, position, intersection.normal ()),
-              this->radiusEdit.doubleValue (), this->self->mirrorDimension ());
-
+              this->radiusEdit.doubleValue ());
             return true;
           });
+          this->mesh->addSpheres (false, intersection.position (), this->stepSpheres,
+                                  this->self->mirrorDimension ());
         }
       }
+      this->updatePreview ();
       return ToolResponse::Redraw;
     }
     else
@@ -247,6 +281,7 @@ struct ToolSketchSpheres::Impl
           this->cursor.disable ();
         }
       }
+      this->updatePreview ();
       return ToolResponse::Redraw;
     }
     else
@@ -259,7 +294,9 @@ struct ToolSketchSpheres::Impl
 
   ToolResponse runCursorUpdate (const glm::ivec2& pos)
   {
+    const unsigned int     cursorRevision = this->cursor.revision ();
     SketchMeshIntersection intersection;
+
     if (this->self->intersectsScene (pos, intersection))
     {
       this->cursor.enable ();
@@ -269,7 +306,8 @@ struct ToolSketchSpheres::Impl
     {
       this->cursor.disable ();
     }
-    return ToolResponse::Redraw;
+    return cursorRevision == this->cursor.revision () ? ToolResponse::None
+                                                      : ToolResponse::RedrawOverlay;
   }
 
   ToolResponse runCommit ()
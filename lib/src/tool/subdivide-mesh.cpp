@@ -0,0 +1,64 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QObject>
+#include "dynamic/mesh-intersection.hpp"
+#include "dynamic/mesh.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "scene.hpp"
+#include "state.hpp"
+#include "tools.hpp"
+#include "view/info-pane.hpp"
+#include "view/info-pane/scene.hpp"
+#include "view/main-window.hpp"
+#include "view/pointing-event.hpp"
+#include "view/tool-tip.hpp"
+
+struct ToolSubdivideMesh::Impl
+{
+  ToolSubdivideMesh* self;
+
+  Impl (ToolSubdivideMesh* s)
+    : self (s)
+  {
+  }
+
+  ToolResponse runInitialize ()
+  {
+    ViewToolTip toolTip;
+    toolTip.add (ViewInputEvent::MouseLeft, QObject::tr ("Subdivide selection"));
+    this->self->state ().setToolTip (&toolTip);
+
+    return ToolResponse::None;
+  }
+
+  // replaces the selected mesh by a mesh with four times as many faces
+  ToolResponse runReleaseEvent (const ViewPointingEvent& e)
+  {
+    if (e.leftButton ())
+    {
+      DynamicMeshIntersection intersection;
+      if (this->self->intersectsScene (e, intersection))
+      {
+        State&       state = this->self->state ();
+        DynamicMesh& mesh = intersection.mesh ();
+
+        this->self->snapshotDynamicMeshes ();
+        mesh.prune ();
+
+        const Mesh subdivided = MeshUtil::subdivide (mesh.mesh ());
+
+        state.scene ().deleteMesh (mesh);
+        state.scene ().newDynamicMesh (state.config (), subdivided);
+        state.mainWindow ().infoPane ().scene ().updateInfo ();
+        return ToolResponse::Redraw;
+      }
+    }
+    return ToolResponse::None;
+  }
+};
+
+DELEGATE_TOOL (ToolSubdivideMesh)
+DELEGATE_TOOL_RUN_RELEASE_EVENT (ToolSubdivideMesh)
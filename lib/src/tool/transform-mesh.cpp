@@ -129,7 +129,7 @@ struct ToolTransformMesh::Impl
               this->rotation.reset (intersection.position ());
               break;
             case RotationOrigin::Center:
-              this->rotation.reset (this->mesh->mesh ().bounds ().center ());
+              this->rotation.reset (this->mesh->bounds ().center ());
               break;
             case RotationOrigin::Origin:
               this->rotation.reset (glm::vec3 (0.0f));
@@ -48,6 +48,7 @@ struct ToolTrimMesh::Impl
   std::vector<glm::ivec2> points;
   TrimMode                trimMode;
   QSlider&                widthEdit;
+  Color                   onScreenColor;
 
   Impl (ToolTrimMesh* s)
     : self (s)
@@ -106,7 +107,7 @@ struct ToolTrimMesh::Impl
     {
       this->widthEdit.setValue (this->widthEdit.value () + e.delta ().x);
     }
-    return this->points.empty () ? ToolResponse::None : ToolResponse::Redraw;
+    return this->points.empty () ? ToolResponse::None : ToolResponse::RedrawOverlay;
   }
 
   TrimStatus trimMesh (DynamicMesh& mesh, int offset, bool reverse)
@@ -268,8 +269,10 @@ struct ToolTrimMesh::Impl
             break;
         }
         this->points.clear ();
+        return ToolResponse::Redraw;
       }
-      return ToolResponse::Redraw;
+      // the border is painted on top of the scene
+      return ToolResponse::RedrawOverlay;
     }
   }
 
@@ -277,7 +280,7 @@ struct ToolTrimMesh::Impl
   {
     const QPoint cursorPos (ViewUtil::toQPoint (this->self->cursorPosition ()));
 
-    QPen pen (this->self->config ().get<Color> ("editor/on-screen-color").qColor ());
+    QPen pen (this->onScreenColor.qColor ());
     pen.setCapStyle (Qt::FlatCap);
     pen.setWidth (this->trimMode == TrimMode::Normal ? 2 : this->widthEdit.value ());
 
@@ -297,7 +300,12 @@ struct ToolTrimMesh::Impl
   ToolResponse runCommit ()
   {
     this->points.clear ();
-    return ToolResponse::Redraw;
+    return ToolResponse::RedrawOverlay;
+  }
+
+  void runFromConfig ()
+  {
+    this->onScreenColor = this->self->config ().get<Color> ("editor/on-screen-color");
   }
 };
 
@@ -306,3 +314,4 @@ DELEGATE_TOOL_RUN_MOVE_EVENT (ToolTrimMesh)
 DELEGATE_TOOL_RUN_RELEASE_EVENT (ToolTrimMesh)
 DELEGATE_TOOL_RUN_PAINT (ToolTrimMesh)
 DELEGATE_TOOL_RUN_COMMIT (ToolTrimMesh)
+DELEGATE_TOOL_RUN_FROM_CONFIG (ToolTrimMesh)
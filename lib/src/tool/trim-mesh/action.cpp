@@ -2,11 +2,14 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <algorithm>
 #include <functional>
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
 #include <list>
-#include <unordered_set>
+#include <set>
+#include <vector>
+#include "dynamic/faces.hpp"
 #include "dynamic/mesh.hpp"
 #include "primitive/plane.hpp"
 #include "tool/trim-mesh/action.hpp"
@@ -142,6 +145,7 @@ namespace
       float        angle;
       float        distanceToPrev;
       float        distanceToNext;
+      unsigned int order;
 
       TwoDVertex (unsigned int i, const glm::vec2& p)
         : index (i)
@@ -151,6 +155,7 @@ namespace
         , angle (0.0f)
         , distanceToPrev (0.0f)
         , distanceToNext (0.0f)
+        , order (0)
       {
       }
 
@@ -179,6 +184,20 @@ namespace
     typedef TwoDVertices::iterator       TwoDVertexRef;
     typedef TwoDVertices::const_iterator TwoDVertexCRef;
 
+    // ears are clipped in the order of their weights, and then of their ranks
+    struct Ear
+    {
+      float        weight;
+      unsigned int rank;
+      unsigned int order;
+
+      bool operator< (const Ear& other) const
+      {
+        return this->weight < other.weight ||
+               (this->weight == other.weight && this->rank < other.rank);
+      }
+    };
+
     struct TwoDPolyline;
     typedef std::vector<TwoDPolyline> TwoDPolylines;
 
@@ -237,14 +256,17 @@ namespace
         }
       }
 
-      void setIsEar (TwoDVertexRef v) const
+      /* Only non-convex vertices are tested, since a convex vertex can only lie inside an ear if
+       * a non-convex vertex does so too.
+       */
+      void setIsEar (TwoDVertexRef v, const std::vector<TwoDVertexRef>& nonConvex) const
       {
         if (v->curvature == Curvature::Convex)
         {
           const TwoDVertexCRef p = this->prev (v);
           const TwoDVertexCRef n = this->next (v);
 
-          for (TwoDVertexCRef it = this->begin (); it != this->end (); ++it)
+          for (TwoDVertexCRef it : nonConvex)
           {
             if (it != p && it != v && it != n)
             {
@@ -309,29 +331,15 @@ namespace
 
         for (TwoDVertexRef v = this->begin (); v != this->end (); ++v)
         {
-          this->setIsEar (v);
           this->setAngle (v);
         }
       }
 
-      void removeEar (TwoDVertexRef v)
-      {
-        assert (v->isEar);
-        assert (this->size () > 3);
-
-        TwoDVertexRef p = this->prev (v);
-        TwoDVertexRef n = this->next (v);
-
-        this->vertices.erase (v);
-        this->setCurvature (p);
-        this->setCurvature (n);
-        this->setIsEar (p);
-        this->setIsEar (n);
-        this->setAngle (p);
-        this->setAngle (n);
-      }
-
-      bool updateEarCandidate (TwoDVertexCRef v, float& weight) const
+      /* Degenerated ears are clipped first, the last of them in the order of the polyline
+       * first.  Other ears are clipped by how close their angle is to the best angle, the first
+       * of them in the order of the polyline first.
+       */
+      Ear ear (TwoDVertexCRef v) const
       {
         assert (v->isEar);
 
@@ -340,55 +348,112 @@ namespace
 
         if (nearPrev || nearNext)
         {
-          weight = Util::minFloat ();
-          return true;
+          return Ear{Util::minFloat (), Util::invalidIndex () - v->order, v->order};
         }
         else
         {
           const float bestAngle = glm::cos (glm::radians (60.0f));
-          const float w = glm::abs (v->angle - bestAngle);
-
-          if (w < weight)
-          {
-            weight = w;
-            return true;
-          }
-          else
-          {
-            return false;
-          }
+          return Ear{glm::abs (v->angle - bestAngle), v->order, v->order};
         }
       }
 
+      /* Ears are kept in an ordered set, and only the neighbors of a clipped ear are updated.
+       * Clipping an ear only makes its neighbors more convex, so the list of non-convex vertices
+       * mostly shrinks.
+       */
       bool fillHole (DynamicMesh& mesh)
       {
         const auto addFace = [&mesh](TwoDVertexCRef a, TwoDVertexCRef b, TwoDVertexCRef c) {
           mesh.addFace (a->index, b->index, c->index);
         };
 
-        while (this->size () > 3)
-        {
-          TwoDVertexRef earCandidate = this->end ();
-          float         weight = Util::maxFloat ();
+        std::vector<TwoDVertexRef> vertices;
+        std::vector<TwoDVertexRef> nonConvex;
+        std::vector<Ear>           ears;
+        std::set<Ear>              queue;
 
-          for (TwoDVertexRef v = this->begin (); v != this->end (); ++v)
+        // ears without a valid weight are never clipped
+        const auto enqueue = [this, &ears, &queue](TwoDVertexRef v) {
+          if (v->isEar)
           {
-            if (v->isEar && updateEarCandidate (v, weight))
+            ears[v->order] = this->ear (v);
+
+            if (ears[v->order].weight < Util::maxFloat ())
             {
-              earCandidate = v;
+              queue.insert (ears[v->order]);
+            }
+            else
+            {
+              v->isEar = false;
             }
           }
+        };
 
-          if (earCandidate != this->end ())
+        const auto dequeue = [&ears, &queue](TwoDVertexRef v) {
+          if (v->isEar)
           {
-            addFace (this->prev (earCandidate), earCandidate, this->next (earCandidate));
-            this->removeEar (earCandidate);
+            queue.erase (ears[v->order]);
           }
-          else
+        };
+
+        for (TwoDVertexRef v = this->begin (); v != this->end (); ++v)
+        {
+          v->order = vertices.size ();
+          vertices.push_back (v);
+
+          if (v->curvature != Curvature::Convex)
+          {
+            nonConvex.push_back (v);
+          }
+        }
+        ears.resize (vertices.size ());
+
+        for (TwoDVertexRef v : vertices)
+        {
+          this->setIsEar (v, nonConvex);
+          enqueue (v);
+        }
+
+        while (this->size () > 3)
+        {
+          if (queue.empty ())
           {
             DILAY_WARN ("Could not find ear candidate");
             return false;
           }
+
+          const TwoDVertexRef v = vertices[queue.begin ()->order];
+          const TwoDVertexRef p = this->prev (v);
+          const TwoDVertexRef n = this->next (v);
+
+          addFace (p, v, n);
+          dequeue (v);
+          dequeue (p);
+          dequeue (n);
+          this->vertices.erase (v);
+
+          for (TwoDVertexRef c : {p, n})
+          {
+            const bool wasConvex = c->curvature == Curvature::Convex;
+
+            this->setCurvature (c);
+            if (wasConvex && c->curvature != Curvature::Convex)
+            {
+              nonConvex.push_back (c);
+            }
+          }
+          this->setIsEar (p, nonConvex);
+          this->setIsEar (n, nonConvex);
+          this->setAngle (p);
+          this->setAngle (n);
+
+          nonConvex.erase (std::remove_if (nonConvex.begin (), nonConvex.end (),
+                                           [](TwoDVertexCRef c) {
+                                             return c->curvature == Curvature::Convex;
+                                           }),
+                           nonConvex.end ());
+          enqueue (p);
+          enqueue (n);
         }
         assert (this->size () == 3);
         addFace (this->vertices.begin (), std::next (this->vertices.begin (), 1),
@@ -397,6 +462,27 @@ namespace
         return true;
       }
 
+      // contribution of the segment that starts at `v0` to the winding number of `v`
+      int winding (const glm::vec2& v, TwoDVertexCRef v0) const
+      {
+        TwoDVertexCRef v1 = this->next (v0);
+        const float    v0Y = v0->position.y;
+        const float    v1Y = v1->position.y;
+
+        if (v0Y <= v.y && v.y < v1Y && isLeft (v, v0->position, v1->position))
+        {
+          return 1;
+        }
+        else if (v1Y <= v.y && v.y < v0Y && isRight (v, v0->position, v1->position))
+        {
+          return -1;
+        }
+        else
+        {
+          return 0;
+        }
+      }
+
       bool contains (const glm::vec2& v) const
       {
         assert (this->size () >= 3);
@@ -404,18 +490,7 @@ namespace
 
         for (TwoDVertexCRef v0 = this->begin (); v0 != this->end (); ++v0)
         {
-          TwoDVertexCRef v1 = this->next (v0);
-          const float    v0Y = v0->position.y;
-          const float    v1Y = v1->position.y;
-
-          if (v0Y <= v.y && v.y < v1Y && isLeft (v, v0->position, v1->position))
-          {
-            windingNumber++;
-          }
-          else if (v1Y <= v.y && v.y < v0Y && isRight (v, v0->position, v1->position))
-          {
-            windingNumber--;
-          }
+          windingNumber += this->winding (v, v0);
         }
         return windingNumber != 0;
       }
@@ -431,18 +506,6 @@ namespace
         }
         return true;
       }
-
-      bool intersects (const TwoDSquare& square) const
-      {
-        for (TwoDVertexCRef v = this->begin (); v != this->end (); ++v)
-        {
-          if (square.intersects (v->position, this->next (v)->position))
-          {
-            return true;
-          }
-        }
-        return false;
-      }
     };
 
     struct TwoDGrid
@@ -539,20 +602,77 @@ namespace
         }
         this->squares.reserve (this->dimension.x * this->dimension.y);
 
+        const auto position = [&min, avgLength](unsigned int x, unsigned int y) {
+          return min + (glm::vec2 (float(x), float(y)) * avgLength);
+        };
+        const auto firstCell = [avgLength](float value, float minimum, unsigned int dim) {
+          const float c = glm::floor (((value - minimum) / avgLength) - 0.5f) - 1.0f;
+          return (unsigned int) (glm::clamp (c, 0.0f, float(dim - 1)));
+        };
+        const auto lastCell = [avgLength](float value, float minimum, unsigned int dim) {
+          const float c = glm::ceil (((value - minimum) / avgLength) + 0.5f) + 1.0f;
+          return (unsigned int) (glm::clamp (c, 0.0f, float(dim - 1)));
+        };
+
+        /* Segments are bucketed by the rows that they may cross, and by the squares that they
+         * may intersect, such that each square only visits nearby segments.
+         */
+        std::vector<std::vector<std::pair<unsigned int, TwoDVertexCRef>>> rowSegments (
+          this->dimension.y);
+        std::vector<unsigned char> isIntersected (this->dimension.x * this->dimension.y, 0);
+
+        for (unsigned int i = 0; i < ps.size (); i++)
+        {
+          for (TwoDVertexCRef v = ps[i].begin (); v != ps[i].end (); ++v)
+          {
+            const glm::vec2&   p1 = v->position;
+            const glm::vec2&   p2 = ps[i].next (v)->position;
+            const glm::vec2    lower = glm::min (p1, p2);
+            const glm::vec2    upper = glm::max (p1, p2);
+            const unsigned int x1 = firstCell (lower.x, min.x, this->dimension.x);
+            const unsigned int x2 = lastCell (upper.x, min.x, this->dimension.x);
+            const unsigned int y1 = firstCell (lower.y, min.y, this->dimension.y);
+            const unsigned int y2 = lastCell (upper.y, min.y, this->dimension.y);
+
+            for (unsigned int y = y1; y <= y2; y++)
+            {
+              rowSegments[y].emplace_back (i, v);
+
+              for (unsigned int x = x1; x <= x2; x++)
+              {
+                const unsigned int j = (y * this->dimension.x) + x;
+
+                if (isIntersected[j] == 0 &&
+                    TwoDSquare (glm::uvec2 (x, y), position (x, y), avgLength).intersects (p1, p2))
+                {
+                  isIntersected[j] = 1;
+                }
+              }
+            }
+          }
+        }
+
         for (unsigned int y = 0; y < this->dimension.y; y++)
         {
+          const std::vector<std::pair<unsigned int, TwoDVertexCRef>>& segments = rowSegments[y];
+
           for (unsigned int x = 0; x < this->dimension.x; x++)
           {
-            const glm::vec2 pos = min + (glm::vec2 (float(x), float(y)) * avgLength);
+            const glm::vec2 pos = position (x, y);
             this->squares.emplace_back (glm::uvec2 (x, y), pos, avgLength);
             TwoDSquare& square = this->squares.back ();
 
+            // segments of a row are grouped by their polylines
             unsigned int numContains = 0;
-            for (const TwoDPolyline& p : ps)
+            int          windingNumber = 0;
+            for (unsigned int s = 0; s < segments.size (); s++)
             {
-              if (p.contains (pos))
+              windingNumber += ps[segments[s].first].winding (pos, segments[s].second);
+
+              if (s + 1 == segments.size () || segments[s + 1].first != segments[s].first)
               {
-                numContains++;
+                numContains += windingNumber != 0 ? 1 : 0;
+                windingNumber = 0;
               }
             }
 
@@ -564,23 +684,11 @@ namespace
             assert (y < this->dimension.y - 1 || square.state == outside);
             assert (x > 0 || square.state == outside);
             assert (x < this->dimension.x - 1 || square.state == outside);
-          }
-        }
-        for (unsigned int y = 1; y < this->dimension.y - 1; y++)
-        {
-          for (unsigned int x = 1; x < this->dimension.x - 1; x++)
-          {
-            TwoDSquare& square = this->squares[this->index (x, y)];
-            if (square.state == inside)
+
+            if (square.state == inside && x > 0 && x < this->dimension.x - 1 && y > 0 &&
+                y < this->dimension.y - 1 && isIntersected[this->index (x, y)])
             {
-              for (const TwoDPolyline& p : ps)
-              {
-                if (p.intersects (square))
-                {
-                  square.state = outside;
-                  break;
-                }
-              }
+              square.state = outside;
             }
           }
         }
@@ -1078,40 +1186,46 @@ namespace
     return true;
   }
 
+  /* Marks the vertices above the border that are connected to its polylines in a bitmap, and
+   * deletes all of them at once.
+   */
   void trimVertices (const ToolTrimMeshBorder& border)
   {
-    const auto isAboveBorder = [&border](unsigned int i) {
-      const glm::vec3& p = border.mesh ().vertex (i);
-      return border.onBorder (p) == false && border.plane ().distance (p) > 0.0f;
-    };
-
-    std::unordered_set<unsigned int> set;
-    const auto addAdjacentAboveBorder = [&border, &isAboveBorder, &set](unsigned int i) {
-      border.mesh ().forEachVertexAdjacentToVertex (i, [&isAboveBorder, &set](unsigned int a) {
-        if (isAboveBorder (a))
+    DynamicMesh&               mesh = border.mesh ();
+    std::vector<unsigned char> isMarked (mesh.mesh ().numVertices (), 0);
+    std::vector<unsigned int>  marked;
+    std::vector<unsigned int>  stack;
+
+    const auto markAdjacentAboveBorder = [&](unsigned int i) {
+      mesh.forEachVertexAdjacentToVertex (i, [&](unsigned int a) {
+        if (isMarked[a] == 0)
         {
-          set.insert (a);
+          const glm::vec3& p = mesh.vertex (a);
+
+          if (border.onBorder (p) == false && border.plane ().distance (p) > 0.0f)
+          {
+            isMarked[a] = 1;
+            marked.push_back (a);
+            stack.push_back (a);
+          }
         }
       });
     };
 
-    DynamicMesh& mesh = border.mesh ();
     for (const ToolTrimMeshBorder::Polyline& p : border.polylines ())
     {
       for (unsigned int i : p)
       {
-        addAdjacentAboveBorder (i);
+        markAdjacentAboveBorder (i);
       }
     }
-
-    while (set.empty () == false)
+    while (stack.empty () == false)
     {
-      const unsigned int i = *set.begin ();
-      set.erase (set.begin ());
-
-      addAdjacentAboveBorder (i);
-      mesh.deleteVertex (i);
+      const unsigned int i = stack.back ();
+      stack.pop_back ();
+      markAdjacentAboveBorder (i);
     }
+    mesh.deleteVertices (marked);
   }
 }
 
@@ -1128,8 +1242,36 @@ namespace ToolTrimMeshAction
       border.setNewIndices (newIndices);
     }
 
-    if (fillHole (border) && border.mesh ().pruneAndCheckConsistency ())
+    // the mesh is pruned, so filling the hole only appends faces
+    DynamicMesh&       mesh = border.mesh ();
+    const unsigned int numFaces = mesh.numFaces ();
+
+    if (fillHole (border) == false)
+    {
+      return false;
+    }
+
+    DynamicFaces modified;
+    for (unsigned int i = numFaces; i < mesh.numFaces (); i++)
+    {
+      modified.insert (i);
+    }
+    for (const ToolTrimMeshBorder::Polyline& p : border.polylines ())
+    {
+      for (unsigned int i : p)
+      {
+        for (unsigned int f : mesh.adjacentFaces (i))
+        {
+          modified.insert (f);
+        }
+      }
+    }
+    modified.commit ();
+    mesh.bufferData ();
+
+    if (mesh.checkConsistency (modified))
     {
+      assert (mesh.pruneAndCheckConsistency ());
       return true;
     }
     else
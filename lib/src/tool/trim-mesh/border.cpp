@@ -3,6 +3,7 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include "intersection.hpp"
+#include "primitive/convex-polytope.hpp"
 #include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
 #include "tool/trim-mesh/border.hpp"
@@ -98,6 +99,22 @@ struct ToolTrimMeshBorder::Impl
     }
   }
 
+  // the region is thickened by epsilon, such that it contains all points `onBorder`
+  PrimConvexPolytope polytope () const
+  {
+    const glm::vec3& n = this->plane.normal ();
+    const glm::vec3  outward1 = glm::normalize (glm::cross (n, this->edge1.direction ()));
+    const glm::vec3  outward2 = glm::normalize (glm::cross (this->edge2.direction (), n));
+    const float      eps = Util::epsilon ();
+
+    PrimConvexPolytope polytope;
+    polytope.addPlane (PrimPlane (this->plane.point () + (eps * n), n));
+    polytope.addPlane (PrimPlane (this->plane.point () - (eps * n), -n));
+    polytope.addPlane (PrimPlane (this->edge1.origin () + (eps * outward1), outward1));
+    polytope.addPlane (PrimPlane (this->edge2.origin () + (eps * outward2), outward2));
+    return polytope;
+  }
+
   void deleteEmptyPolylines ()
   {
     this->polylines.erase (std::remove_if (this->polylines.begin (), this->polylines.end (),
@@ -127,5 +144,6 @@ DELEGATE (void, ToolTrimMeshBorder, addPolyline)
 DELEGATE1 (void, ToolTrimMeshBorder, setNewIndices, const std::vector<unsigned int>&)
 DELEGATE1_CONST (bool, ToolTrimMeshBorder, onBorder, const glm::vec3&)
 DELEGATE2_CONST (bool, ToolTrimMeshBorder, intersects, const PrimRay&, float&)
+DELEGATE_CONST (PrimConvexPolytope, ToolTrimMeshBorder, polytope)
 DELEGATE (void, ToolTrimMeshBorder, deleteEmptyPolylines)
 DELEGATE_CONST (bool, ToolTrimMeshBorder, hasVertices)
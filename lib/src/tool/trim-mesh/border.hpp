@@ -10,6 +10,7 @@
 #include "macro.hpp"
 
 class DynamicMesh;
+class PrimConvexPolytope;
 class PrimPlane;
 class PrimRay;
 
@@ -32,6 +33,9 @@ public:
   void             deleteEmptyPolylines ();
   bool             hasVertices () const;
 
+  // conservative bounds of the border's region on its plane
+  PrimConvexPolytope polytope () const;
+
 private:
   IMPLEMENTATION
 };
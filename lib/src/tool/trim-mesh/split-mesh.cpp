@@ -5,7 +5,8 @@
 #include <unordered_set>
 #include "dynamic/faces.hpp"
 #include "dynamic/mesh.hpp"
-#include "hash.hpp"
+#include "edge-map.hpp"
+#include "primitive/convex-polytope.hpp"
 #include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
 #include "tool/trim-mesh/border.hpp"
@@ -73,20 +74,20 @@ namespace
   void splitMesh (const ToolTrimMeshBorder& border, BorderVertices& borderVertices)
   {
     DynamicFaces faces;
-    border.mesh ().intersects (border.plane (), faces);
+    border.mesh ().intersects (border.polytope (), faces);
 
-    std::unordered_set<ui_pair> edges;
+    EdgeSet edges;
     while (faces.isEmpty () == false)
     {
-      edges.clear ();
+      edges.reset ();
       for (unsigned int f : faces)
       {
         unsigned int i1, i2, i3;
         border.mesh ().vertexIndices (f, i1, i2, i3);
 
-        edges.emplace (glm::min (i1, i2), glm::max (i1, i2));
-        edges.emplace (glm::min (i1, i3), glm::max (i1, i3));
-        edges.emplace (glm::min (i2, i3), glm::max (i2, i3));
+        edges.insert (i1, i2);
+        edges.insert (i1, i3);
+        edges.insert (i2, i3);
       }
 
       for (const auto e : edges)
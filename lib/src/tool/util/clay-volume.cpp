@@ -0,0 +1,148 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include <memory>
+#include "dynamic/mesh-distance-field.hpp"
+#include "dynamic/mesh.hpp"
+#include "isosurface-extraction.hpp"
+#include "isosurface-extraction/grid.hpp"
+#include "parallel.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/sphere.hpp"
+#include "profiler.hpp"
+#include "render-mode.hpp"
+#include "tool/util/clay-volume.hpp"
+
+namespace
+{
+  // margin of the grid relative to the largest extent of the mesh, which bounds the added clay
+  constexpr float gridMargin = 0.5f;
+
+  // width of the narrow band (in samples), beyond which distances are clamped
+  constexpr float narrowBand = 2.0f;
+}
+
+struct ToolUtilClayVolume::Impl
+{
+  std::unique_ptr<IsosurfaceExtractionGrid> grid;
+  DynamicMesh                               surface;
+
+  bool isEmpty () const { return this->grid == nullptr; }
+
+  void fromMesh (const DynamicMesh& mesh, float resolution)
+  {
+    PROFILE_ZONE ("clay-volume/from-mesh")
+
+    this->reset ();
+
+    const std::shared_ptr<const DynamicMeshDistanceField> field =
+      DynamicMeshDistanceField::get (mesh, resolution);
+
+    const PrimAABox bounds = mesh.bounds ();
+    const glm::vec3 extent = bounds.maximum () - bounds.minimum ();
+    const glm::vec3 margin (gridMargin * glm::max (glm::max (extent.x, extent.y), extent.z));
+
+    this->grid.reset (new IsosurfaceExtractionGrid (
+      PrimAABox (bounds.minimum () - margin, bounds.maximum () + margin), resolution));
+
+    const IsosurfaceExtraction::DistanceCallback getDistance =
+      [&field](const glm::vec3& pos, float) { return field->distance (pos); };
+    const IsosurfaceExtraction::InsideCallback isInside =
+      [&field](const glm::vec3& pos) { return field->distance (pos) < 0.0f; };
+
+    IsosurfaceExtraction::sample (getDistance, isInside, *this->grid);
+
+    const float band = narrowBand * this->grid->resolution ();
+
+    Parallel::forEach (this->grid->totalNumSamples (), [this, band](unsigned int i) {
+      this->grid->sample (i, glm::clamp (this->grid->sample (i), -band, band));
+    });
+
+    this->surface.renderMode () = mesh.renderMode ();
+    this->surface.color (mesh.color ());
+    this->grid->updateMesh (glm::uvec3 (0), this->grid->numSamples (), this->surface);
+    this->surface.bufferData ();
+  }
+
+  /* The outermost samples of the grid are never changed, such that the surface remains closed.
+   * Samples are combined with the distance to the sphere by a union or a difference.
+   */
+  void dab (const PrimSphere& sphere, bool subtract)
+  {
+    PROFILE_ZONE ("clay-volume/dab")
+    assert (this->isEmpty () == false);
+
+    const float      band = narrowBand * this->grid->resolution ();
+    const glm::vec3  halfWidth (sphere.radius () + band);
+    const glm::uvec3 numSamples = this->grid->numSamples ();
+    glm::uvec3       begin, end;
+
+    this->grid->sampleRange (
+      PrimAABox (sphere.center () - halfWidth, sphere.center () + halfWidth), begin, end);
+
+    begin = glm::max (begin, glm::uvec3 (1));
+    end = glm::min (end, numSamples - glm::uvec3 (1));
+
+    if (glm::any (glm::greaterThanEqual (begin, end)))
+    {
+      return;
+    }
+
+    Parallel::forEach (end.z - begin.z,
+                       [this, &sphere, subtract, band, &begin, &end](unsigned int z) {
+                         this->dabSlice (sphere, subtract, band, begin, end, begin.z + z);
+                       },
+                       1);
+
+    this->grid->updateMesh (begin, end, this->surface);
+    this->surface.bufferData ();
+  }
+
+  void dabSlice (const PrimSphere& sphere, bool subtract, float band, const glm::uvec3& begin,
+                 const glm::uvec3& end, unsigned int z)
+  {
+    for (unsigned int y = begin.y; y < end.y; y++)
+    {
+      for (unsigned int x = begin.x; x < end.x; x++)
+      {
+        const unsigned int i = this->grid->sampleIndex (x, y, z);
+        const float        s = this->grid->sample (i);
+        const float        d =
+          glm::distance (this->grid->samplePos (i), sphere.center ()) - sphere.radius ();
+        const float combined = subtract ? glm::max (s, -d) : glm::min (s, d);
+
+        this->grid->sample (i, glm::clamp (combined, -band, band));
+      }
+    }
+  }
+
+  bool intersects (const PrimRay& ray, Intersection& intersection) const
+  {
+    return this->isEmpty () == false && this->surface.intersects (ray, intersection);
+  }
+
+  void render (Camera& camera) const
+  {
+    if (this->isEmpty () == false)
+    {
+      this->surface.render (camera);
+    }
+  }
+
+  void reset ()
+  {
+    this->grid.reset ();
+    this->surface.reset ();
+  }
+};
+
+DELEGATE_BIG2 (ToolUtilClayVolume)
+DELEGATE_CONST (bool, ToolUtilClayVolume, isEmpty)
+DELEGATE2 (void, ToolUtilClayVolume, fromMesh, const DynamicMesh&, float)
+DELEGATE2 (void, ToolUtilClayVolume, dab, const PrimSphere&, bool)
+DELEGATE2_CONST (bool, ToolUtilClayVolume, intersects, const PrimRay&, Intersection&)
+DELEGATE1_CONST (void, ToolUtilClayVolume, render, Camera&)
+GETTER (DynamicMesh&, ToolUtilClayVolume, surface)
+DELEGATE (void, ToolUtilClayVolume, reset)
@@ -0,0 +1,45 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_UTIL_CLAY_VOLUME
+#define DILAY_TOOL_UTIL_CLAY_VOLUME
+
+#include "macro.hpp"
+
+class Camera;
+class DynamicMesh;
+class Intersection;
+class PrimRay;
+class PrimSphere;
+
+/* Narrow-band signed distance field of a mesh that is sculpted by adding and subtracting spheres.
+ * The field is sampled on an isosurface extraction grid, of which a dab only changes the samples
+ * around its sphere, and only the faces of the displayed surface around these samples are made
+ * again.  The surface has no topology to maintain and becomes a mesh of the scene when the volume
+ * is converted.
+ */
+class ToolUtilClayVolume
+{
+public:
+  DECLARE_BIG2 (ToolUtilClayVolume)
+
+  bool isEmpty () const;
+
+  // samples the volume of a mesh at the given resolution, whose render mode is copied
+  void fromMesh (const DynamicMesh&, float);
+
+  // dabs are clipped to the bounds of the volume, which extend those of its mesh by a margin
+  void dab (const PrimSphere&, bool);
+  bool intersects (const PrimRay&, Intersection&) const;
+  void render (Camera&) const;
+
+  // the surface is left empty after it has been moved out of the volume
+  DynamicMesh& surface ();
+  void         reset ();
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -0,0 +1,97 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include "tool/util/prediction.hpp"
+
+namespace
+{
+  const float alpha = 0.6f;
+  const float beta = 0.2f;
+
+  // shorter intervals are treated as coalesced events, longer intervals as a pause of the pointer
+  const float minInterval = 0.001f;
+  const float maxInterval = 0.1f;
+}
+
+struct ToolUtilPrediction::Impl
+{
+  typedef ToolUtilPrediction::Clock Clock;
+
+  unsigned int      numSamples;
+  glm::vec2         position;
+  glm::vec2         velocity;
+  Clock::time_point time;
+
+  Impl () { this->reset (); }
+
+  void reset ()
+  {
+    this->numSamples = 0;
+    this->position = glm::vec2 (0.0f);
+    this->velocity = glm::vec2 (0.0f);
+  }
+
+  void add (const glm::vec2& sample, const Clock::time_point& t)
+  {
+    const std::chrono::duration<float> interval = t - this->time;
+    const float                        dt = glm::max (minInterval, interval.count ());
+
+    if (this->numSamples == 0 || dt > maxInterval)
+    {
+      this->numSamples = 1;
+      this->position = sample;
+      this->velocity = glm::vec2 (0.0f);
+    }
+    else
+    {
+      const glm::vec2 estimate = this->position + (dt * this->velocity);
+      const glm::vec2 residual = sample - estimate;
+
+      if (this->numSamples == 1)
+      {
+        this->velocity = (sample - this->position) / dt;
+        this->position = sample;
+      }
+      else
+      {
+        this->position = estimate + (alpha * residual);
+        this->velocity += (beta / dt) * residual;
+      }
+      this->numSamples++;
+    }
+    this->time = t;
+  }
+
+  bool hasPrediction () const { return this->numSamples >= 2; }
+
+  glm::vec2 predict (float seconds, float maxDistance) const
+  {
+    assert (seconds >= 0.0f);
+    assert (maxDistance >= 0.0f);
+
+    if (this->hasPrediction () == false)
+    {
+      return this->position;
+    }
+
+    const glm::vec2 displacement = seconds * this->velocity;
+    const float     distance = glm::length (displacement);
+
+    if (distance > maxDistance)
+    {
+      return this->position + (displacement * (maxDistance / distance));
+    }
+    else
+    {
+      return this->position + displacement;
+    }
+  }
+};
+
+DELEGATE_BIG3 (ToolUtilPrediction)
+DELEGATE (void, ToolUtilPrediction, reset)
+DELEGATE2 (void, ToolUtilPrediction, add, const glm::vec2&, const Clock::time_point&)
+DELEGATE_CONST (bool, ToolUtilPrediction, hasPrediction)
+DELEGATE2_CONST (glm::vec2, ToolUtilPrediction, predict, float, float)
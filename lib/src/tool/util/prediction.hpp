@@ -0,0 +1,33 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_UTIL_PREDICTION
+#define DILAY_TOOL_UTIL_PREDICTION
+
+#include <chrono>
+#include <glm/fwd.hpp>
+#include "macro.hpp"
+
+/* Predicts the pointer position a given time ahead of its most recent sample.  Position and
+ * velocity are tracked by an alpha-beta filter, i.e. a steady-state Kalman filter of a constant
+ * velocity model, such that each new sample corrects the previous estimate.
+ */
+class ToolUtilPrediction
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  DECLARE_BIG3 (ToolUtilPrediction)
+
+  void reset ();
+  void add (const glm::vec2&, const Clock::time_point&);
+  bool hasPrediction () const;
+  // the predicted displacement is bounded by a maximum distance
+  glm::vec2 predict (float, float) const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
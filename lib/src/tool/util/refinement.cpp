@@ -0,0 +1,145 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QPainter>
+#include <QTimer>
+#include <atomic>
+#include <glm/glm.hpp>
+#include <thread>
+#include "dynamic/mesh.hpp"
+#include "maybe.hpp"
+#include "thread-pool.hpp"
+#include "tool/util/refinement.hpp"
+#include "view/info-pane.hpp"
+
+namespace
+{
+  // interval (in milliseconds) in which the result of a refinement is polled
+  constexpr int pollInterval = 50;
+
+  // offset of the progress label to the cursor
+  const QPoint labelOffset (16, -16);
+}
+
+struct ToolUtilRefinement::Impl
+{
+  ViewInfoPane&         infoPane;
+  std::function<void()> update;
+  QTimer                timer;
+  std::thread           thread;
+  CancellationToken     token;
+  std::atomic<bool>     isFinished;
+  std::atomic<float>    progress;
+  bool                  succeeded;
+  QString               label;
+  Maybe<DynamicMesh>    result;
+  Extraction            extraction;
+  Callback              callback;
+
+  Impl (ViewInfoPane& i, const std::function<void()>& u)
+    : infoPane (i)
+    , update (u)
+    , isFinished (false)
+    , progress (0.0f)
+    , succeeded (false)
+  {
+    this->timer.setInterval (pollInterval);
+    QObject::connect (&this->timer, &QTimer::timeout, [this]() { this->poll (); });
+  }
+
+  ~Impl () { this->cancel (); }
+
+  bool isRunning () const { return this->thread.joinable (); }
+
+  void run (const QString& l, const Extraction& e, const Callback& c)
+  {
+    this->cancel ();
+
+    this->label = l;
+    this->extraction = e;
+    this->callback = c;
+    this->token.reset ();
+    this->isFinished = false;
+    this->progress = 0.0f;
+    this->succeeded = false;
+
+    this->result = Maybe<DynamicMesh>::make ();
+    this->thread = std::thread ([this]() {
+      this->succeeded = this->extraction (*this->result, [this](float p) { this->progress = p; },
+                                          this->token);
+      this->isFinished = true;
+    });
+    this->timer.start ();
+    this->infoPane.showProgress (this->label, 0.0f);
+  }
+
+  void reset ()
+  {
+    this->timer.stop ();
+    this->infoPane.hideProgress ();
+    this->result.reset ();
+    this->extraction = nullptr;
+    this->callback = nullptr;
+  }
+
+  void deliver ()
+  {
+    if (this->succeeded && this->token.isCancelled () == false)
+    {
+      this->callback (*this->result);
+    }
+    this->reset ();
+  }
+
+  void poll ()
+  {
+    if (this->isFinished)
+    {
+      this->thread.join ();
+      this->deliver ();
+    }
+    else
+    {
+      this->infoPane.showProgress (this->label, this->progress);
+    }
+    this->update ();
+  }
+
+  void cancel ()
+  {
+    if (this->isRunning ())
+    {
+      this->token.cancel ();
+      this->thread.join ();
+      this->reset ();
+    }
+  }
+
+  void finish ()
+  {
+    if (this->isRunning ())
+    {
+      this->thread.join ();
+      this->deliver ();
+    }
+  }
+
+  void paint (QPainter& painter, const glm::ivec2& cursorPos) const
+  {
+    if (this->isRunning ())
+    {
+      const int     percent = int(100.0f * glm::clamp (float(this->progress), 0.0f, 1.0f));
+      const QString text = QString ("%1 %2%").arg (this->label).arg (percent);
+
+      painter.drawText (QPoint (cursorPos.x, cursorPos.y) + labelOffset, text);
+    }
+  }
+};
+
+DELEGATE2_BIG2 (ToolUtilRefinement, ViewInfoPane&, const std::function<void()>&)
+DELEGATE_CONST (bool, ToolUtilRefinement, isRunning)
+DELEGATE3 (void, ToolUtilRefinement, run, const QString&, const Extraction&, const Callback&)
+DELEGATE (void, ToolUtilRefinement, cancel)
+DELEGATE (void, ToolUtilRefinement, finish)
+DELEGATE2_CONST (void, ToolUtilRefinement, paint, QPainter&, const glm::ivec2&)
@@ -0,0 +1,45 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_UTIL_REFINEMENT
+#define DILAY_TOOL_UTIL_REFINEMENT
+
+#include <functional>
+#include <glm/fwd.hpp>
+#include "isosurface-extraction.hpp"
+#include "macro.hpp"
+
+class CancellationToken;
+class DynamicMesh;
+class QPainter;
+class QString;
+class ViewInfoPane;
+
+/* Runs an extraction on a background thread.  The calling thread polls for the result from its
+ * event loop and passes it to a callback, unless the refinement has been cancelled.  The progress
+ * is shown in the info pane.  Each extraction writes to a fresh mesh, which the callback may move
+ * into the scene.
+ */
+class ToolUtilRefinement
+{
+public:
+  typedef std::function<bool(DynamicMesh&, const IsosurfaceExtraction::ProgressCallback&,
+                             const CancellationToken&)>
+                                            Extraction;
+  typedef std::function<void(DynamicMesh&)> Callback;
+
+  DECLARE_BIG2 (ToolUtilRefinement, ViewInfoPane&, const std::function<void()>&)
+
+  bool isRunning () const;
+  void run (const QString&, const Extraction&, const Callback&);
+  void cancel ();
+  // waits for a running extraction and passes its result to the callback
+  void finish ();
+  void paint (QPainter&, const glm::ivec2&) const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
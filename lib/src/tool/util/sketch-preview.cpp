@@ -0,0 +1,282 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QObject>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include "dynamic/mesh.hpp"
+#include "isosurface-extraction.hpp"
+#include "isosurface-extraction/grid.hpp"
+#include "mesh.hpp"
+#include "opengl.hpp"
+#include "primitive/aabox.hpp"
+#include "sketch/distance-field.hpp"
+#include "sketch/mesh.hpp"
+#include "sketch/path.hpp"
+#include "tool/util/refinement.hpp"
+#include "tool/util/sketch-preview.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // number of samples along the longest side of the grid
+  constexpr float numSamples = 48.0f;
+
+  // margin of the grid relative to the extent of the sketch, such that edits rarely outgrow it
+  constexpr float gridMargin = 0.25f;
+
+  // margin of resampled regions (in samples), which covers the narrow band of the extraction
+  constexpr float regionMargin = 2.0f;
+
+  constexpr float opacity = 0.4f;
+
+  struct Box
+  {
+    glm::vec3 min;
+    glm::vec3 max;
+
+    Box ()
+      : min (Util::maxFloat ())
+      , max (Util::minFloat ())
+    {
+    }
+
+    Box (const glm::vec3& mi, const glm::vec3& ma)
+      : min (mi)
+      , max (ma)
+    {
+    }
+
+    explicit Box (const PrimSphere& sphere)
+      : Box (sphere.center () - glm::vec3 (sphere.radius ()),
+             sphere.center () + glm::vec3 (sphere.radius ()))
+    {
+    }
+
+    bool operator!= (const Box& o) const { return this->min != o.min || this->max != o.max; }
+
+    bool isEmpty () const { return glm::any (glm::greaterThan (this->min, this->max)); }
+
+    bool intersects (const Box& o) const
+    {
+      return glm::all (glm::lessThanEqual (this->min, o.max)) &&
+             glm::all (glm::lessThanEqual (o.min, this->max));
+    }
+
+    bool contains (const Box& o) const
+    {
+      return glm::all (glm::lessThanEqual (this->min, o.min)) &&
+             glm::all (glm::greaterThanEqual (this->max, o.max));
+    }
+
+    void add (const Box& o)
+    {
+      this->min = glm::min (this->min, o.min);
+      this->max = glm::max (this->max, o.max);
+    }
+
+    float maxExtent () const
+    {
+      const glm::vec3 extent = this->max - this->min;
+      return glm::max (glm::max (extent.x, extent.y), extent.z);
+    }
+  };
+
+  typedef std::vector<Box> Boxes;
+
+  // the box of a node also encloses the bone to its parent
+  void collectBoxes (const SketchMesh& mesh, Boxes& nodeBoxes, Boxes& pathBoxes)
+  {
+    if (mesh.tree ().hasRoot ())
+    {
+      mesh.tree ().root ().forEachConstNode ([&nodeBoxes](const SketchNode& node) {
+        Box box (node.data ());
+        if (node.parent ())
+        {
+          box.add (Box (node.parent ()->data ()));
+        }
+        nodeBoxes.push_back (box);
+      });
+    }
+    for (const SketchPath& path : mesh.paths ())
+    {
+      for (const PrimSphere& sphere : path.spheres ())
+      {
+        pathBoxes.push_back (Box (sphere));
+      }
+    }
+  }
+
+  // intersecting regions are merged, such that fewer samples are updated twice
+  void addRegion (Boxes& regions, const Box& region)
+  {
+    Box merged = region;
+
+    for (std::size_t i = 0; i < regions.size ();)
+    {
+      if (regions[i].intersects (merged))
+      {
+        merged.add (regions[i]);
+        regions.erase (regions.begin () + i);
+        i = 0;
+      }
+      else
+      {
+        i++;
+      }
+    }
+    regions.push_back (merged);
+  }
+
+  void addDifferences (const Boxes& boxes1, const Boxes& boxes2, Boxes& regions)
+  {
+    for (std::size_t i = 0; i < std::max (boxes1.size (), boxes2.size ()); i++)
+    {
+      if (i >= boxes1.size ())
+      {
+        addRegion (regions, boxes2[i]);
+      }
+      else if (i >= boxes2.size ())
+      {
+        addRegion (regions, boxes1[i]);
+      }
+      else if (boxes1[i] != boxes2[i])
+      {
+        Box region = boxes1[i];
+        region.add (boxes2[i]);
+        addRegion (regions, region);
+      }
+    }
+  }
+}
+
+struct ToolUtilSketchPreview::Impl
+{
+  ToolUtilRefinement                        refinement;
+  Mesh                                      mesh; // copy of the last update for rendering
+  std::shared_ptr<DynamicMesh>              extractedMesh;
+  std::shared_ptr<IsosurfaceExtractionGrid> grid;
+  Box                                       gridBounds;
+  Boxes                                     pendingRegions; // have not been updated yet
+  Boxes                                     nodeBoxes;
+  Boxes                                     pathBoxes;
+
+  Impl (ViewInfoPane& infoPane, const std::function<void()>& update)
+    : refinement (infoPane, update)
+  {
+  }
+
+  void update (const SketchMesh& sketch)
+  {
+    Boxes nodeBoxes, pathBoxes;
+    collectBoxes (sketch, nodeBoxes, pathBoxes);
+
+    addDifferences (this->nodeBoxes, nodeBoxes, this->pendingRegions);
+    addDifferences (this->pathBoxes, pathBoxes, this->pendingRegions);
+
+    this->nodeBoxes = std::move (nodeBoxes);
+    this->pathBoxes = std::move (pathBoxes);
+
+    if (this->pendingRegions.empty ())
+    {
+      return;
+    }
+    this->refinement.cancel ();
+
+    Box bounds;
+    for (const Box& box : this->nodeBoxes)
+    {
+      bounds.add (box);
+    }
+    for (const Box& box : this->pathBoxes)
+    {
+      bounds.add (box);
+    }
+
+    if (bounds.isEmpty ())
+    {
+      this->reset ();
+      return;
+    }
+    else if (this->grid == nullptr || this->gridBounds.contains (bounds) == false)
+    {
+      const glm::vec3 margin (gridMargin * bounds.maxExtent ());
+
+      this->gridBounds = Box (bounds.min - margin, bounds.max + margin);
+      this->grid = std::make_shared<IsosurfaceExtractionGrid> (
+        PrimAABox (this->gridBounds.min, this->gridBounds.max),
+        this->gridBounds.maxExtent () / numSamples);
+      this->extractedMesh = std::make_shared<DynamicMesh> ();
+      this->pendingRegions = {this->gridBounds};
+    }
+
+    const std::shared_ptr<IsosurfaceExtractionGrid>  grid = this->grid;
+    const std::shared_ptr<DynamicMesh>               extractedMesh = this->extractedMesh;
+    const std::shared_ptr<const SketchDistanceField> distanceField =
+      std::make_shared<const SketchDistanceField> (sketch);
+    const glm::vec3        margin (regionMargin * grid->resolution ());
+    std::vector<PrimAABox> regions;
+
+    for (const Box& region : this->pendingRegions)
+    {
+      regions.emplace_back (region.min - margin, region.max + margin);
+    }
+
+    // the extracted mesh is updated in place, so the mesh of the refinement remains empty
+    this->refinement.run (
+      QObject::tr ("Previewing"),
+      [grid, extractedMesh, distanceField, regions](
+        DynamicMesh&, const IsosurfaceExtraction::ProgressCallback& progress,
+        const CancellationToken& token) {
+        const IsosurfaceExtraction::DistanceCallback getDistance =
+          [distanceField](const glm::vec3& pos, float upperBound) {
+            return distanceField->distance (pos, upperBound);
+          };
+        return IsosurfaceExtraction::update (getDistance, *grid, regions, *extractedMesh,
+                                             progress, &token);
+      },
+      [this](DynamicMesh&) {
+        this->pendingRegions.clear ();
+        this->extractedMesh->bufferData ();
+        this->mesh = this->extractedMesh->mesh ();
+        this->mesh.bufferData ();
+      });
+  }
+
+  void reset ()
+  {
+    this->refinement.cancel ();
+    this->mesh.reset ();
+    this->extractedMesh.reset ();
+    this->grid.reset ();
+    this->gridBounds = Box ();
+    this->pendingRegions.clear ();
+    this->nodeBoxes.clear ();
+    this->pathBoxes.clear ();
+  }
+
+  void render (Camera& camera) const
+  {
+    if (this->mesh.numIndices () > 0)
+    {
+      OpenGL::glEnable (OpenGL::Blend ());
+      OpenGL::glBlendEquation (OpenGL::FuncAdd ());
+      OpenGL::glBlendColor (0.0f, 0.0f, 0.0f, opacity);
+      OpenGL::glBlendFunc (OpenGL::ConstantAlpha (), OpenGL::OneMinusConstantAlpha ());
+      OpenGL::glDepthMask (false);
+
+      this->mesh.render (camera);
+
+      OpenGL::glDepthMask (true);
+      OpenGL::glDisable (OpenGL::Blend ());
+    }
+  }
+};
+
+DELEGATE2_BIG2 (ToolUtilSketchPreview, ViewInfoPane&, const std::function<void()>&)
+DELEGATE1 (void, ToolUtilSketchPreview, update, const SketchMesh&)
+DELEGATE (void, ToolUtilSketchPreview, reset)
+DELEGATE1_CONST (void, ToolUtilSketchPreview, render, Camera&)
@@ -0,0 +1,33 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_UTIL_SKETCH_PREVIEW
+#define DILAY_TOOL_UTIL_SKETCH_PREVIEW
+
+#include <functional>
+#include "macro.hpp"
+
+class Camera;
+class SketchMesh;
+class ViewInfoPane;
+
+/* Translucent preview of the isosurface of a sketch mesh.  Distances are cached in a coarse grid,
+ * of which only the regions that enclose the primitives that have changed since the last update
+ * are sampled again, and only the parts of the preview around them are made again.  Sampling and
+ * extraction run on a background thread.
+ */
+class ToolUtilSketchPreview
+{
+public:
+  DECLARE_BIG2 (ToolUtilSketchPreview, ViewInfoPane&, const std::function<void()>&)
+
+  void update (const SketchMesh&);
+  void reset ();
+  void render (Camera&) const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
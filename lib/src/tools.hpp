@@ -14,6 +14,10 @@ DECLARE_TOOL (TransformMesh, DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_PRESS_
 
 DECLARE_TOOL (DeleteMesh, DECLARE_TOOL_RUN_RELEASE_EVENT)
 
+DECLARE_TOOL (SeparateMesh, DECLARE_TOOL_RUN_RELEASE_EVENT)
+
+DECLARE_TOOL (SubdivideMesh, DECLARE_TOOL_RUN_RELEASE_EVENT)
+
 DECLARE_TOOL (NewMesh, DECLARE_TOOL_RUN_RENDER DECLARE_TOOL_RUN_COMMIT)
 
 DECLARE_TOOL_SCULPT (SculptDraw)
@@ -23,13 +27,16 @@ DECLARE_TOOL_SCULPT (SculptFlatten)
 DECLARE_TOOL_SCULPT (SculptCrease)
 DECLARE_TOOL_SCULPT (SculptPinch)
 DECLARE_TOOL_SCULPT (SculptReduce)
+DECLARE_TOOL_SCULPT (SculptMask)
 
-DECLARE_TOOL (EditSketch, DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_PRESS_EVENT
-                            DECLARE_TOOL_RUN_RELEASE_EVENT DECLARE_TOOL_RUN_COMMIT)
+DECLARE_TOOL (EditSketch, DECLARE_TOOL_RUN_RENDER DECLARE_TOOL_RUN_MOVE_EVENT
+                            DECLARE_TOOL_RUN_PRESS_EVENT DECLARE_TOOL_RUN_RELEASE_EVENT
+                              DECLARE_TOOL_RUN_COMMIT)
 
 DECLARE_TOOL (DeleteSketch, DECLARE_TOOL_RUN_RELEASE_EVENT)
 
-DECLARE_TOOL (ConvertSketch, DECLARE_TOOL_RUN_RELEASE_EVENT)
+DECLARE_TOOL (ConvertSketch, DECLARE_TOOL_RUN_RELEASE_EVENT DECLARE_TOOL_RUN_PAINT
+                               DECLARE_TOOL_RUN_COMMIT)
 
 DECLARE_TOOL (SketchSpheres,
               DECLARE_TOOL_RUN_RENDER DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_PRESS_EVENT
@@ -37,10 +44,18 @@ DECLARE_TOOL (SketchSpheres,
                   DECLARE_TOOL_RUN_COMMIT DECLARE_TOOL_RUN_FROM_CONFIG)
 
 DECLARE_TOOL (TrimMesh, DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_RELEASE_EVENT
-                          DECLARE_TOOL_RUN_PAINT DECLARE_TOOL_RUN_COMMIT)
+                          DECLARE_TOOL_RUN_PAINT DECLARE_TOOL_RUN_COMMIT
+                            DECLARE_TOOL_RUN_FROM_CONFIG)
+
+DECLARE_TOOL (Remesh, DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_PRESS_EVENT
+                        DECLARE_TOOL_RUN_RELEASE_EVENT DECLARE_TOOL_RUN_PAINT
+                          DECLARE_TOOL_RUN_COMMIT DECLARE_TOOL_RUN_FROM_CONFIG)
+
+DECLARE_TOOL (Decimate,
+              DECLARE_TOOL_RUN_RELEASE_EVENT DECLARE_TOOL_RUN_PAINT DECLARE_TOOL_RUN_COMMIT)
 
-DECLARE_TOOL (Remesh,
-              DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_PRESS_EVENT
-                DECLARE_TOOL_RUN_RELEASE_EVENT DECLARE_TOOL_RUN_PAINT DECLARE_TOOL_RUN_COMMIT)
+DECLARE_TOOL (Clay, DECLARE_TOOL_RUN_RENDER DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_PRESS_EVENT
+                      DECLARE_TOOL_RUN_CURSOR_UPDATE DECLARE_TOOL_RUN_COMMIT
+                        DECLARE_TOOL_RUN_FROM_CONFIG)
 
 #endif
@@ -6,28 +6,55 @@
 #define DILAY_TREE
 
 #include <list>
+#include <vector>
 #include "maybe.hpp"
+#include "pool-allocator.hpp"
 #include "util.hpp"
 
+template <typename T> class Tree;
+
+/* The nodes of a tree are allocated from a memory pool of their root, which is freed at once
+ * when the tree is destroyed.  Copies of a subtree, e.g. copies of a tree, have a pool of their
+ * own, so trees do not share their pools.
+ */
 template <typename T> class TreeNode
 {
 public:
-  TreeNode (const T& d, TreeNode* p = nullptr)
+  typedef PoolAllocator<TreeNode> Allocator;
+
+  TreeNode (const T& d, TreeNode* p = nullptr, const Allocator& a = Allocator ())
     : _data (d)
     , _parent (p)
+    , _children (a)
   {
   }
 
-  TreeNode (T&& d, TreeNode* p = nullptr)
+  TreeNode (T&& d, TreeNode* p = nullptr, const Allocator& a = Allocator ())
     : _data (std::move (d))
     , _parent (p)
+    , _children (a)
   {
   }
 
   TreeNode (const TreeNode& o)
+    : TreeNode (o, Allocator ())
+  {
+  }
+
+  TreeNode (const TreeNode& o, const Allocator& a)
     : _data (o._data)
     , _parent (nullptr)
-    , _children (o._children)
+    , _children (a)
+  {
+    o.forEachConstChild ([this, &a](const TreeNode& c) { this->_children.emplace_back (c, a); });
+    this->forEachChild ([this](TreeNode& c) { c._parent = this; });
+  }
+
+  // moves the children along with their pool, so that no node is copied
+  TreeNode (TreeNode&& o)
+    : _data (std::move (o._data))
+    , _parent (nullptr)
+    , _children (std::move (o._children))
   {
     this->forEachChild ([this](TreeNode& c) { c._parent = this; });
   }
@@ -47,15 +74,14 @@ public:
 
   template <typename... Args> TreeNode& emplaceChild (Args&&... args)
   {
-    this->_children.emplace_back (make (std::forward<Args> (args)...));
-    this->_children.back ()._parent = this;
-
+    this->_children.emplace_back (T (std::forward<Args> (args)...), this,
+                                  this->_children.get_allocator ());
     return this->_children.back ();
   }
 
   TreeNode& addChild (const TreeNode& node)
   {
-    this->_children.emplace_back (node);
+    this->_children.emplace_back (node, this->_children.get_allocator ());
     this->_children.back ()._parent = this;
 
     return this->_children.back ();
@@ -74,7 +100,10 @@ public:
     DILAY_IMPOSSIBLE
   }
 
-  void forEachChild (const std::function<void(TreeNode&)>& f)
+  /* Visitors that are visible to the compiler, such that a lambda passed to them can be inlined
+   * and is not wrapped in a `std::function` at each level of the recursion.
+   */
+  template <typename F> void forEachChild (const F& f)
   {
     for (TreeNode& c : this->_children)
     {
@@ -82,7 +111,7 @@ public:
     }
   }
 
-  void forEachConstChild (const std::function<void(const TreeNode&)>& f) const
+  template <typename F> void forEachConstChild (const F& f) const
   {
     for (const TreeNode& c : this->_children)
     {
@@ -90,18 +119,24 @@ public:
     }
   }
 
-  void forEachNode (const std::function<void(TreeNode&)>& f)
+  template <typename F> void forEachNode (const F& f)
   {
     f (*this);
 
-    this->forEachChild ([&f](TreeNode& c) { c.forEachNode (f); });
+    for (TreeNode& c : this->_children)
+    {
+      c.forEachNode (f);
+    }
   }
 
-  void forEachConstNode (const std::function<void(const TreeNode&)>& f) const
+  template <typename F> void forEachConstNode (const F& f) const
   {
     f (*this);
 
-    this->forEachConstChild ([&f](const TreeNode& c) { c.forEachConstNode (f); });
+    for (const TreeNode& c : this->_children)
+    {
+      c.forEachConstNode (f);
+    }
   }
 
   TreeNode& lastChild ()
@@ -125,11 +160,11 @@ public:
     return n;
   }
 
-  void deleteChildIf (const std::function<bool(const TreeNode&)>& f)
+  template <typename F> void deleteChildIf (const F& f)
   {
     for (auto it = this->_children.begin (); it != this->_children.end ();)
     {
-      if (f (*it))
+      if (f (static_cast<const TreeNode&> (*it)))
       {
         it = this->_children.erase (it);
       }
@@ -141,9 +176,20 @@ public:
   }
 
 private:
-  T                   _data;
-  TreeNode*           _parent;
-  std::list<TreeNode> _children;
+  friend class Tree<T>;
+
+  T                              _data;
+  TreeNode*                      _parent;
+  std::list<TreeNode, Allocator> _children;
+
+  // moves a node of the same tree, whose parent keeps an empty node in its place
+  TreeNode& moveChild (TreeNode& node)
+  {
+    this->_children.emplace_back (std::move (node));
+    this->_children.back ()._parent = this;
+
+    return this->_children.back ();
+  }
 };
 
 template <typename T> class Tree
@@ -171,28 +217,24 @@ public:
 
   void reset () { this->_root.reset (); }
 
+  /* Makes a node the root of its tree.  Nodes are moved along the path to the old root, which
+   * reverses their relationship, such that no node is copied.
+   */
   void rebalance (TreeNode<T>& node)
   {
-    const std::function<void(const TreeNode<T>&, TreeNode<T>&)> go = [&go](const auto& child,
-                                                                           auto& rebalancedChild) {
-      if (child.parent ())
-      {
-        const auto& parent = *child.parent ();
-        auto&       rebalancedParent = rebalancedChild.emplaceChild (parent.data ());
-
-        parent.forEachConstChild ([&rebalancedParent, &child](const auto& c) {
-          if (&c != &child)
-          {
-            rebalancedParent.addChild (c);
-          }
-        });
-        go (parent, rebalancedParent);
-      }
-    };
+    TreeNode<T>  newRoot (std::move (node));
+    TreeNode<T>* rebalanced = &newRoot;
+    TreeNode<T>* child = &node;
 
-    TreeNode<T>& newRoot (node);
-    go (node, newRoot);
-    this->_root = std::move (newRoot);
+    while (child->parent ())
+    {
+      TreeNode<T>& parent = *child->parent ();
+
+      parent.deleteChild (*child);
+      rebalanced = &rebalanced->moveChild (parent);
+      child = &parent;
+    }
+    this->_root = Maybe<TreeNode<T>>::make (std::move (newRoot));
   }
 
   Tree<T> split (TreeNode<T>& node)
@@ -215,4 +257,89 @@ private:
   Maybe<TreeNode<T>> _root;
 };
 
+/* A snapshot of a tree whose nodes are stored in depth-first order in contiguous arrays.  The
+ * descendants of node `i` are the nodes in `[i + 1, subtreeEnd (i))`, so subtrees are iterated as
+ * ranges of indices.  Snapshots are copied as arrays and reuse their storage when they are assigned
+ * another tree.
+ */
+template <typename T> class FlatTree
+{
+public:
+  FlatTree () = default;
+
+  explicit FlatTree (const Tree<T>& tree) { this->assign (tree); }
+
+  void assign (const Tree<T>& tree)
+  {
+    this->_data.clear ();
+    this->_parents.clear ();
+    this->_subtreeEnds.clear ();
+
+    if (tree.hasRoot ())
+    {
+      this->addNode (tree.root (), Util::invalidIndex ());
+    }
+  }
+
+  unsigned int numNodes () const { return this->_data.size (); }
+
+  bool isEmpty () const { return this->_data.empty (); }
+
+  const T& data (unsigned int i) const
+  {
+    assert (i < this->numNodes ());
+    return this->_data[i];
+  }
+
+  // returns `Util::invalidIndex ()` for the root
+  unsigned int parent (unsigned int i) const
+  {
+    assert (i < this->numNodes ());
+    return this->_parents[i];
+  }
+
+  unsigned int subtreeEnd (unsigned int i) const
+  {
+    assert (i < this->numNodes ());
+    return this->_subtreeEnds[i];
+  }
+
+  const std::vector<T>& data () const { return this->_data; }
+
+  // rebuilds a tree with the same structure, whose children are in the same order
+  Tree<T> toTree () const
+  {
+    Tree<T> tree;
+
+    if (this->isEmpty () == false)
+    {
+      std::vector<TreeNode<T>*> nodes (this->numNodes (), nullptr);
+
+      nodes[0] = &tree.emplaceRoot (this->_data[0]);
+      for (unsigned int i = 1; i < this->numNodes (); i++)
+      {
+        nodes[i] = &nodes[this->_parents[i]]->emplaceChild (this->_data[i]);
+      }
+    }
+    return tree;
+  }
+
+private:
+  std::vector<T>            _data;
+  std::vector<unsigned int> _parents;
+  std::vector<unsigned int> _subtreeEnds;
+
+  void addNode (const TreeNode<T>& node, unsigned int parent)
+  {
+    const unsigned int index = this->_data.size ();
+
+    this->_data.push_back (node.data ());
+    this->_parents.push_back (parent);
+    this->_subtreeEnds.push_back (index + 1);
+
+    node.forEachConstChild ([this, index](const TreeNode<T>& c) { this->addNode (c, index); });
+    this->_subtreeEnds[index] = this->_data.size ();
+  }
+};
+
 #endif
@@ -0,0 +1,317 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include <vector>
+#include "cpu-dispatch.hpp"
+#include "primitive/ray.hpp"
+#include "triangle-batch.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // arrays are padded to a multiple of the number of lanes with degenerated triangles
+  constexpr unsigned int numLanes = 8;
+
+  struct TriangleArrays
+  {
+    std::vector<unsigned int> indices;
+    std::vector<float>        v1X, v1Y, v1Z;
+    std::vector<float>        e1X, e1Y, e1Z;
+    std::vector<float>        e2X, e2Y, e2Z;
+    std::vector<float>        normalX, normalY, normalZ;
+  };
+
+  /* Möller-Trumbore with the lanes of a block written such that they can be vectorized.  Returns
+   * the position of the nearest triangle that is hit before `nearestT`, which is updated.
+   */
+  DILAY_KERNEL unsigned int intersectsKernel (const TriangleArrays& a, unsigned int numTriangles,
+                                              const glm::vec3& o, const glm::vec3& d,
+                                              bool bothSides, float minT, float& nearestT)
+  {
+    const float eps = Util::epsilon ();
+
+    unsigned int nearest = Util::invalidIndex ();
+    float        ts[numLanes];
+
+    for (unsigned int begin = 0; begin < numTriangles; begin += numLanes)
+    {
+      for (unsigned int l = 0; l < numLanes; l++)
+      {
+        const unsigned int i = begin + l;
+
+        const float dot = (d.x * a.normalX[i]) + (d.y * a.normalY[i]) + (d.z * a.normalZ[i]);
+        const float facing = bothSides ? glm::abs (dot) : -dot;
+
+        const float s1X = (d.y * a.e2Z[i]) - (d.z * a.e2Y[i]);
+        const float s1Y = (d.z * a.e2X[i]) - (d.x * a.e2Z[i]);
+        const float s1Z = (d.x * a.e2Y[i]) - (d.y * a.e2X[i]);
+        const float invDet = 1.0f / ((s1X * a.e1X[i]) + (s1Y * a.e1Y[i]) + (s1Z * a.e1Z[i]));
+
+        const float pX = o.x - a.v1X[i];
+        const float pY = o.y - a.v1Y[i];
+        const float pZ = o.z - a.v1Z[i];
+        const float s2X = (pY * a.e1Z[i]) - (pZ * a.e1Y[i]);
+        const float s2Y = (pZ * a.e1X[i]) - (pX * a.e1Z[i]);
+        const float s2Z = (pX * a.e1Y[i]) - (pY * a.e1X[i]);
+
+        const float b1 = ((pX * s1X) + (pY * s1Y) + (pZ * s1Z)) * invDet;
+        const float b2 = ((d.x * s2X) + (d.y * s2Y) + (d.z * s2Z)) * invDet;
+        const float t = ((a.e2X[i] * s2X) + (a.e2Y[i] * s2Y) + (a.e2Z[i] * s2Z)) * invDet;
+
+        const bool isHit =
+          facing >= eps && b1 >= 0.0f && b2 >= 0.0f && b1 + b2 <= 1.0f && t >= minT;
+
+        ts[l] = isHit ? t : Util::maxFloat ();
+      }
+      for (unsigned int l = 0; l < numLanes; l++)
+      {
+        if (ts[l] < nearestT)
+        {
+          nearest = begin + l;
+          nearestT = ts[l];
+        }
+      }
+    }
+    return nearest;
+  }
+
+  /* Unlike `Distance::distance` the region of the point is not branched on: the distance to the
+   * plane is taken if the point projects into the triangle, otherwise the distance to the nearest
+   * edge.  Returns the squared distance of the nearest triangle.
+   */
+  DILAY_KERNEL float distanceSqrKernel (const TriangleArrays& arrays, unsigned int n,
+                                        const glm::vec3& p)
+  {
+    float nearestSqr = Util::maxFloat ();
+    float sqrs[numLanes];
+
+    for (unsigned int begin = 0; begin < n; begin += numLanes)
+    {
+      for (unsigned int l = 0; l < numLanes; l++)
+      {
+        const unsigned int i = begin + l;
+
+        const float dX = arrays.v1X[i] - p.x;
+        const float dY = arrays.v1Y[i] - p.y;
+        const float dZ = arrays.v1Z[i] - p.z;
+
+        const float a = (arrays.e1X[i] * arrays.e1X[i]) + (arrays.e1Y[i] * arrays.e1Y[i]) +
+                        (arrays.e1Z[i] * arrays.e1Z[i]);
+        const float b = (arrays.e1X[i] * arrays.e2X[i]) + (arrays.e1Y[i] * arrays.e2Y[i]) +
+                        (arrays.e1Z[i] * arrays.e2Z[i]);
+        const float c = (arrays.e2X[i] * arrays.e2X[i]) + (arrays.e2Y[i] * arrays.e2Y[i]) +
+                        (arrays.e2Z[i] * arrays.e2Z[i]);
+        const float d = (arrays.e1X[i] * dX) + (arrays.e1Y[i] * dY) + (arrays.e1Z[i] * dZ);
+        const float e = (arrays.e2X[i] * dX) + (arrays.e2Y[i] * dY) + (arrays.e2Z[i] * dZ);
+        const float f = (dX * dX) + (dY * dY) + (dZ * dZ);
+
+        const float det = (a * c) - (b * b);
+        const float s = (b * e) - (c * d);
+        const float t = (b * d) - (a * e);
+
+        // squared distance to the plane if the point projects into the triangle
+        const bool  isInside = det > 0.0f && s >= 0.0f && t >= 0.0f && s + t <= det;
+        const float sI = isInside ? s / det : 0.0f;
+        const float tI = isInside ? t / det : 0.0f;
+        const float insideSqr = (sI * ((a * sI) + (b * tI) + (2.0f * d))) +
+                                (tI * ((b * sI) + (c * tI) + (2.0f * e))) + f;
+
+        // squared distances to the edges `v1v2`, `v1v3` and `v2v3`
+        const float u1 = a > 0.0f ? glm::clamp (-d / a, 0.0f, 1.0f) : 0.0f;
+        const float u2 = c > 0.0f ? glm::clamp (-e / c, 0.0f, 1.0f) : 0.0f;
+        const float edge1Sqr = (u1 * ((a * u1) + (2.0f * d))) + f;
+        const float edge2Sqr = (u2 * ((c * u2) + (2.0f * e))) + f;
+
+        const float g = a - (2.0f * b) + c;
+        const float h = (b - a) + (e - d);
+        const float k = a + (2.0f * d) + f;
+        const float u3 = g > 0.0f ? glm::clamp (-h / g, 0.0f, 1.0f) : 0.0f;
+        const float edge3Sqr = (u3 * ((g * u3) + (2.0f * h))) + k;
+
+        const float sqr =
+          isInside ? insideSqr : glm::min (edge1Sqr, glm::min (edge2Sqr, edge3Sqr));
+
+        sqrs[l] = i < n ? glm::max (0.0f, sqr) : Util::maxFloat ();
+      }
+      for (unsigned int l = 0; l < numLanes; l++)
+      {
+        nearestSqr = glm::min (nearestSqr, sqrs[l]);
+      }
+    }
+    return nearestSqr;
+  }
+
+  // kernels for each instruction set, which are vectorized by the compiler
+#define DILAY_TRIANGLE_KERNELS(isa, attribute)                                                     \
+  attribute unsigned int intersects##isa (const TriangleArrays& a, unsigned int n,                 \
+                                          const glm::vec3& o, const glm::vec3& d,                  \
+                                          bool bothSides, float minT, float& nearestT)             \
+  {                                                                                                \
+    return intersectsKernel (a, n, o, d, bothSides, minT, nearestT);                               \
+  }                                                                                                \
+  attribute float distanceSqr##isa (const TriangleArrays& a, unsigned int n, const glm::vec3& p)   \
+  {                                                                                                \
+    return distanceSqrKernel (a, n, p);                                                            \
+  }
+
+  DILAY_TRIANGLE_KERNELS (Generic, )
+#ifdef DILAY_CPU_DISPATCH_X86
+  DILAY_TRIANGLE_KERNELS (SSE4, DILAY_TARGET ("sse4.2"))
+  DILAY_TRIANGLE_KERNELS (AVX2, DILAY_TARGET ("avx2,fma"))
+  DILAY_TRIANGLE_KERNELS (AVX512, DILAY_TARGET ("avx512f,avx512vl,avx2,fma"))
+#endif
+#undef DILAY_TRIANGLE_KERNELS
+}
+
+TriangleRecord::TriangleRecord ()
+  : vertex1 (0.0f)
+  , edge1 (0.0f)
+  , edge2 (0.0f)
+  , normal (0.0f)
+{
+}
+
+TriangleRecord::TriangleRecord (const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& v3)
+  : vertex1 (v1)
+  , edge1 (v2 - v1)
+  , edge2 (v3 - v1)
+{
+  const glm::vec3 c = glm::cross (this->edge1, this->edge2);
+  const float     l = glm::length (c);
+
+  this->normal = l > 0.0f ? (c / l) : glm::vec3 (0.0f);
+}
+
+struct TriangleBatch::Impl : public TriangleArrays
+{
+  unsigned int numTriangles () const { return this->indices.size (); }
+
+  void reset ()
+  {
+    this->indices.clear ();
+    this->forEachArray ([](std::vector<float>& a) { a.clear (); });
+  }
+
+  template <typename F>
+  void forEachArray (const F& f)
+  {
+    f (this->v1X);
+    f (this->v1Y);
+    f (this->v1Z);
+    f (this->e1X);
+    f (this->e1Y);
+    f (this->e1Z);
+    f (this->e2X);
+    f (this->e2Y);
+    f (this->e2Z);
+    f (this->normalX);
+    f (this->normalY);
+    f (this->normalZ);
+  }
+
+  void add (unsigned int index, const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& v3)
+  {
+    this->add (index, TriangleRecord (v1, v2, v3));
+  }
+
+  void add (unsigned int index, const TriangleRecord& record)
+  {
+    const unsigned int i = this->indices.size ();
+
+    if (i % numLanes == 0)
+    {
+      this->forEachArray ([i](std::vector<float>& a) { a.resize (i + numLanes, 0.0f); });
+    }
+    this->indices.push_back (index);
+
+    this->v1X[i] = record.vertex1.x;
+    this->v1Y[i] = record.vertex1.y;
+    this->v1Z[i] = record.vertex1.z;
+    this->e1X[i] = record.edge1.x;
+    this->e1Y[i] = record.edge1.y;
+    this->e1Z[i] = record.edge1.z;
+    this->e2X[i] = record.edge2.x;
+    this->e2Y[i] = record.edge2.y;
+    this->e2Z[i] = record.edge2.z;
+    this->normalX[i] = record.normal.x;
+    this->normalY[i] = record.normal.y;
+    this->normalZ[i] = record.normal.z;
+  }
+
+  bool intersects (const PrimRay& ray, bool bothSides, float upperBound, unsigned int& index,
+                   float& distance) const
+  {
+    const unsigned int n = this->numTriangles ();
+    const glm::vec3&   o = ray.origin ();
+    const glm::vec3&   d = ray.direction ();
+    const float        minT = ray.isLine () ? -Util::maxFloat () : 0.0f;
+    float              nearestT = upperBound;
+    unsigned int       nearest;
+
+    switch (CpuDispatch::selected ())
+    {
+#ifdef DILAY_CPU_DISPATCH_X86
+      case CpuDispatch::Isa::AVX512:
+        nearest = intersectsAVX512 (*this, n, o, d, bothSides, minT, nearestT);
+        break;
+      case CpuDispatch::Isa::AVX2:
+        nearest = intersectsAVX2 (*this, n, o, d, bothSides, minT, nearestT);
+        break;
+      case CpuDispatch::Isa::SSE4:
+        nearest = intersectsSSE4 (*this, n, o, d, bothSides, minT, nearestT);
+        break;
+#endif
+      default:
+        nearest = intersectsGeneric (*this, n, o, d, bothSides, minT, nearestT);
+        break;
+    }
+
+    if (nearest == Util::invalidIndex ())
+    {
+      return false;
+    }
+    else
+    {
+      index = this->indices[nearest];
+      distance = nearestT;
+      return true;
+    }
+  }
+
+  float distance (const glm::vec3& p) const
+  {
+    const unsigned int n = this->numTriangles ();
+    float              nearestSqr;
+
+    switch (CpuDispatch::selected ())
+    {
+#ifdef DILAY_CPU_DISPATCH_X86
+      case CpuDispatch::Isa::AVX512:
+        nearestSqr = distanceSqrAVX512 (*this, n, p);
+        break;
+      case CpuDispatch::Isa::AVX2:
+        nearestSqr = distanceSqrAVX2 (*this, n, p);
+        break;
+      case CpuDispatch::Isa::SSE4:
+        nearestSqr = distanceSqrSSE4 (*this, n, p);
+        break;
+#endif
+      default:
+        nearestSqr = distanceSqrGeneric (*this, n, p);
+        break;
+    }
+    return n > 0 ? glm::sqrt (nearestSqr) : Util::maxFloat ();
+  }
+};
+
+DELEGATE_BIG2 (TriangleBatch)
+DELEGATE_CONST (unsigned int, TriangleBatch, numTriangles)
+DELEGATE (void, TriangleBatch, reset)
+DELEGATE4 (void, TriangleBatch, add, unsigned int, const glm::vec3&, const glm::vec3&,
+           const glm::vec3&)
+DELEGATE2 (void, TriangleBatch, add, unsigned int, const TriangleRecord&)
+DELEGATE5_CONST (bool, TriangleBatch, intersects, const PrimRay&, bool, float, unsigned int&,
+                 float&)
+DELEGATE1_CONST (float, TriangleBatch, distance, const glm::vec3&)
@@ -0,0 +1,50 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TRIANGLE_BATCH
+#define DILAY_TRIANGLE_BATCH
+
+#include <glm/glm.hpp>
+#include "macro.hpp"
+
+class PrimRay;
+
+// a triangle given by its first vertex, the two edges that start there, and its unit normal
+struct TriangleRecord
+{
+  glm::vec3 vertex1;
+  glm::vec3 edge1;
+  glm::vec3 edge2;
+  glm::vec3 normal;
+
+  TriangleRecord ();
+  TriangleRecord (const glm::vec3&, const glm::vec3&, const glm::vec3&);
+};
+
+/* Triangles that are stored as structure of arrays, such that a ray is intersected with several
+ * triangles at once.  Each triangle is identified by an index that is given by the caller.
+ */
+class TriangleBatch
+{
+public:
+  DECLARE_BIG2 (TriangleBatch)
+
+  unsigned int numTriangles () const;
+  void         reset ();
+  void         add (unsigned int, const glm::vec3&, const glm::vec3&, const glm::vec3&);
+  void         add (unsigned int, const TriangleRecord&);
+
+  /* Returns the index and distance of the nearest triangle that is intersected at a distance less
+   * than the given upper bound.  Triangles are culled like `IntersectionUtil::intersects`.
+   */
+  bool intersects (const PrimRay&, bool, float, unsigned int&, float&) const;
+
+  // returns the distance of the nearest triangle to a point
+  float distance (const glm::vec3&) const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -13,8 +13,16 @@
 #include <vector>
 #include "log.hpp"
 
-#define DILAY_INFO(fmt, ...) Log::log (Log::Level::Info, __FILE__, __LINE__, fmt, ##__VA_ARGS__);
-#define DILAY_WARN(fmt, ...) Log::log (Log::Level::Warning, __FILE__, __LINE__, fmt, ##__VA_ARGS__);
+#define DILAY_INFO(fmt, ...)                                                           \
+  {                                                                                    \
+    static Log::CallSite dilayLogSite;                                                 \
+    Log::log (dilayLogSite, Log::Level::Info, __FILE__, __LINE__, fmt, ##__VA_ARGS__); \
+  }
+#define DILAY_WARN(fmt, ...)                                                              \
+  {                                                                                       \
+    static Log::CallSite dilayLogSite;                                                    \
+    Log::log (dilayLogSite, Log::Level::Warning, __FILE__, __LINE__, fmt, ##__VA_ARGS__); \
+  }
 #define DILAY_PANIC(fmt, ...)                                                              \
   {                                                                                        \
     Log::log (Log::Level::Panic, __FILE__, __LINE__, fmt, ##__VA_ARGS__);                  \
@@ -69,6 +77,11 @@ namespace Util
 
   constexpr int maxUnsignedInt () { return std::numeric_limits<unsigned int>::max (); }
 
+  constexpr unsigned int maxUnsignedShort ()
+  {
+    return std::numeric_limits<unsigned short>::max ();
+  }
+
   constexpr unsigned int invalidIndex () { return std::numeric_limits<unsigned int>::max (); }
 
   template <typename T> void setIfNotNull (T* ptr, const T& value)
@@ -9,7 +9,7 @@
 #include "color.hpp"
 #include "config.hpp"
 #include "dimension.hpp"
-#include "mesh-util.hpp"
+#include "mesh-primitives.hpp"
 #include "mesh.hpp"
 #include "opengl.hpp"
 #include "render-mode.hpp"
@@ -17,34 +17,25 @@
 
 struct ViewAxis::Impl
 {
-  Mesh         coneMesh;
-  Mesh         cylinderMesh;
-  Mesh         gridMesh;
-  glm::uvec2   axisResolution;
-  Color        axisColor;
-  Color        axisLabelColor;
-  glm::vec3    axisScaling;
-  glm::vec3    axisArrowScaling;
-  unsigned int gridResolution;
+  std::shared_ptr<Mesh> coneMesh;
+  std::shared_ptr<Mesh> cylinderMesh;
+  Mesh                  gridMesh;
+  glm::uvec2            axisResolution;
+  Color                 axisColor;
+  Color                 axisLabelColor;
+  glm::vec3             axisScaling;
+  glm::vec3             axisArrowScaling;
+  unsigned int          gridResolution;
 
   Impl (const Config& config)
+    : coneMesh (MeshPrimitives::get (MeshPrimitive::AxisCone))
+    , cylinderMesh (MeshPrimitives::get (MeshPrimitive::AxisCylinder))
   {
     this->runFromConfig (config);
 
     this->axisResolution = glm::uvec2 (200, 200);
     this->gridResolution = 6;
 
-    this->coneMesh = MeshUtil::cone (10);
-    this->cylinderMesh = MeshUtil::cylinder (10);
-
-    this->cylinderMesh.renderMode ().constantShading (true);
-    this->cylinderMesh.renderMode ().cameraRotationOnly (true);
-    this->cylinderMesh.bufferData ();
-
-    this->coneMesh.renderMode ().constantShading (true);
-    this->coneMesh.renderMode ().cameraRotationOnly (true);
-    this->coneMesh.bufferData ();
-
     this->initializeGrid ();
   }
 
@@ -81,35 +72,35 @@ struct ViewAxis::Impl
     const glm::uvec2 resolution = camera.resolution ();
     camera.updateResolution (glm::uvec2 (200, 200));
 
-    this->cylinderMesh.scaling (this->axisScaling);
+    this->cylinderMesh->scaling (this->axisScaling);
 
-    this->cylinderMesh.position (glm::vec3 (0.0f, this->axisScaling.y * 0.5f, 0.0f));
-    this->cylinderMesh.rotationMatrix (glm::mat4x4 (1.0f));
-    this->cylinderMesh.color (this->axisColor);
-    this->cylinderMesh.render (camera);
+    this->cylinderMesh->position (glm::vec3 (0.0f, this->axisScaling.y * 0.5f, 0.0f));
+    this->cylinderMesh->rotationMatrix (glm::mat4x4 (1.0f));
+    this->cylinderMesh->color (this->axisColor);
+    this->cylinderMesh->render (camera);
 
-    this->cylinderMesh.position (glm::vec3 (this->axisScaling.y * 0.5f, 0.0f, 0.0f));
-    this->cylinderMesh.rotationZ (0.5f * glm::pi<float> ());
-    this->cylinderMesh.render (camera);
+    this->cylinderMesh->position (glm::vec3 (this->axisScaling.y * 0.5f, 0.0f, 0.0f));
+    this->cylinderMesh->rotationZ (0.5f * glm::pi<float> ());
+    this->cylinderMesh->render (camera);
 
-    this->cylinderMesh.position (glm::vec3 (0.0f, 0.0f, this->axisScaling.y * 0.5f));
-    this->cylinderMesh.rotationX (0.5f * glm::pi<float> ());
-    this->cylinderMesh.render (camera);
+    this->cylinderMesh->position (glm::vec3 (0.0f, 0.0f, this->axisScaling.y * 0.5f));
+    this->cylinderMesh->rotationX (0.5f * glm::pi<float> ());
+    this->cylinderMesh->render (camera);
 
-    this->coneMesh.scaling (this->axisArrowScaling);
+    this->coneMesh->scaling (this->axisArrowScaling);
 
-    this->coneMesh.position (glm::vec3 (0.0f, this->axisScaling.y, 0.0f));
-    this->coneMesh.rotationMatrix (glm::mat4x4 (1.0f));
-    this->coneMesh.color (this->axisColor);
-    this->coneMesh.render (camera);
+    this->coneMesh->position (glm::vec3 (0.0f, this->axisScaling.y, 0.0f));
+    this->coneMesh->rotationMatrix (glm::mat4x4 (1.0f));
+    this->coneMesh->color (this->axisColor);
+    this->coneMesh->render (camera);
 
-    this->coneMesh.position (glm::vec3 (this->axisScaling.y, 0.0f, 0.0f));
-    this->coneMesh.rotationZ (-0.5f * glm::pi<float> ());
-    this->coneMesh.render (camera);
+    this->coneMesh->position (glm::vec3 (this->axisScaling.y, 0.0f, 0.0f));
+    this->coneMesh->rotationZ (-0.5f * glm::pi<float> ());
+    this->coneMesh->render (camera);
 
-    this->coneMesh.position (glm::vec3 (0.0f, 0.0f, this->axisScaling.y));
-    this->coneMesh.rotationX (0.5f * glm::pi<float> ());
-    this->coneMesh.render (camera);
+    this->coneMesh->position (glm::vec3 (0.0f, 0.0f, this->axisScaling.y));
+    this->coneMesh->rotationX (0.5f * glm::pi<float> ());
+    this->coneMesh->render (camera);
 
     this->renderGrid (camera);
 
@@ -137,7 +128,8 @@ struct ViewAxis::Impl
 
   void render (Camera& camera, QPainter& painter)
   {
-    this->coneMesh.rotationMatrix (glm::mat4x4 (1.0f));
+    this->coneMesh->scaling (this->axisArrowScaling);
+    this->coneMesh->rotationMatrix (glm::mat4x4 (1.0f));
 
     QFont font;
     font.setWeight (QFont::Bold);
@@ -149,9 +141,9 @@ struct ViewAxis::Impl
 
     auto renderLabel = [this, &resolution, &painter, w, &camera](const glm::vec3& p,
                                                                  const QString&   l) {
-      this->coneMesh.position (p);
+      this->coneMesh->position (p);
 
-      glm::vec2 pos = camera.fromWorld (glm::vec3 (0.0f), this->coneMesh.modelMatrix (), true);
+      glm::vec2 pos = camera.fromWorld (glm::vec3 (0.0f), this->coneMesh->modelMatrix (), true);
       QRect     rect (int(pos.x) - (w / 2),
                       resolution.y - this->axisResolution.y + int(pos.y) - (w / 2), w, w);
 
@@ -188,16 +188,35 @@ namespace
                   QObject::tr ("Step width factor"), Util::epsilon (), 1.0f);
     addFloatEdit (data, *gridSculpt, "editor/tool/sculpt/max-absolute-radius",
                   QObject::tr ("Maximum absolute radius"), Util::epsilon (), 100.0f);
+    addBoolEdit (data, *gridSculpt, "editor/tool/sculpt/defer-normals",
+                 QObject::tr ("Shade flat while sculpting"));
+    addIntEdit (data, *gridSculpt, "editor/tool/sculpt/prediction-time",
+                QObject::tr ("Cursor prediction (ms)"), 0, 100);
+    addBoolEdit (data, *gridSculpt, "editor/tool/sculpt/governor/enabled",
+                 QObject::tr ("Limit detail to keep up"));
+    addIntEdit (data, *gridSculpt, "editor/tool/sculpt/governor/time-budget",
+                QObject::tr ("Step time budget (ms)"), 1, 1000);
+    addColorButton (data, *gridSculpt, "editor/tool/sculpt/governor/color",
+                    QObject::tr ("Limited cursor color"));
+    addBoolEdit (data, *gridSculpt, "editor/tool/sculpt/visible-domain/enabled",
+                 QObject::tr ("Sculpt visible faces only (GPU picking)"));
+    addIntEdit (data, *gridSculpt, "editor/tool/sculpt/visible-domain/ring-width",
+                QObject::tr ("Visible faces margin (px)"), 0, 32);
     addFloatEdit (data, *gridSculpt, "editor/tool/sculpt/mirror/width",
                   QObject::tr ("Mirror width"), Util::epsilon (), 1.0f);
     addColorButton (data, *gridSculpt, "editor/tool/sculpt/mirror/color",
                     QObject::tr ("Mirror color"));
+    gridSculpt->addCenter (QObject::tr ("Clay"));
+    addFloatEdit (data, *gridSculpt, "editor/tool/clay/step-width-factor",
+                  QObject::tr ("Step width factor"), Util::epsilon (), 1.0f);
     gridSculpt->addStretcher ();
 
     ViewTwoColumnGrid* gridSketch = new ViewTwoColumnGrid;
     gridSketch->addCenter (QObject::tr ("Sketch"));
     addFloatEdit (data, *gridSketch, "editor/tool/sketch-spheres/step-width-factor",
                   QObject::tr ("Step width factor"), Util::epsilon (), 1.0f);
+    addFloatEdit (data, *gridSketch, "editor/sketch/bubble/min-spacing",
+                  QObject::tr ("Bubble spacing (px)"), 0.0f, 100.0f);
     gridSketch->addStretcher ();
 
     layout->addWidget (gridSculpt);
@@ -211,6 +230,10 @@ namespace
     ViewTwoColumnGrid* grid = new ViewTwoColumnGrid;
 
     addIntEdit (data, *grid, "editor/undo-depth", QObject::tr ("Undo depth"), 1, Util::maxInt ());
+    addIntEdit (data, *grid, "editor/undo-memory-budget", QObject::tr ("Undo memory budget (MB)"),
+                0, Util::maxInt ());
+    addIntEdit (data, *grid, "editor/autosave-interval", QObject::tr ("Autosave interval (s)"), 0,
+                Util::maxInt ());
     addIntEdit (data, *grid, "window/initial-width", QObject::tr ("Initial window width"), 1,
                 Util::maxInt ());
     addIntEdit (data, *grid, "window/initial-height", QObject::tr ("Initial window height"), 1,
@@ -226,6 +249,13 @@ namespace
                   QObject::tr ("Table pressure intensity"), Util::epsilon (), 10.0f);
 
     addBoolEdit (data, *grid, "editor/use-geometry-shader", QObject::tr ("Use geometry shader"));
+    addBoolEdit (data, *grid, "editor/use-gpu-picking", QObject::tr ("Use GPU picking"));
+    addBoolEdit (data, *grid, "editor/export/quantize-gltf", QObject::tr ("Quantize glTF exports"));
+
+    addFloatEdit (data, *grid, "editor/dynamic-resolution/target-frame-time",
+                  QObject::tr ("Target frame time in motion (ms)"), 0.0f, 1000.0f);
+    addFloatEdit (data, *grid, "editor/dynamic-resolution/min-scale",
+                  QObject::tr ("Minimum resolution scale"), 0.1f, 1.0f);
 
     grid->addStretcher ();
 
@@ -3,53 +3,90 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <glm/glm.hpp>
-#include "mesh-util.hpp"
+#include "color.hpp"
+#include "mesh-primitives.hpp"
 #include "mesh.hpp"
 #include "opengl.hpp"
-#include "render-mode.hpp"
 #include "view/cursor.hpp"
 
 struct ViewCursor::Impl
 {
-  Mesh  radiusMesh;
-  float _radius;
-  bool  isEnabled;
+  std::shared_ptr<Mesh> radiusMesh;
+  float                 _radius;
+  glm::vec3             _position;
+  Color                 _color;
+  bool                  isEnabled;
+  unsigned int          revision;
 
   static const unsigned int numSectors = 40;
 
   Impl ()
-    : _radius (0.0f)
+    : radiusMesh (MeshPrimitives::get (MeshPrimitive::CursorSphere))
+    , _radius (0.0f)
+    , _position (0.0f)
+    , _color (Color::White ())
     , isEnabled (false)
+    , revision (0)
   {
-    this->radiusMesh = MeshUtil::icosphere (2);
-    this->radiusMesh.renderMode ().constantShading (true);
-    this->radiusMesh.bufferData ();
   }
 
   float radius () const { return this->_radius; }
 
-  glm::vec3 position () const { return this->radiusMesh.position (); }
+  glm::vec3 position () const { return this->_position; }
 
-  const Color& color () const { return this->radiusMesh.color (); }
+  const Color& color () const { return this->_color; }
 
   void radius (float r)
   {
-    this->_radius = r;
-    this->update ();
+    if (r != this->_radius)
+    {
+      this->_radius = r;
+      this->revision++;
+    }
   }
 
-  void position (const glm::vec3& p) { this->radiusMesh.position (p); }
+  void position (const glm::vec3& p)
+  {
+    if (p != this->_position)
+    {
+      this->_position = p;
+      this->revision++;
+    }
+  }
 
-  void color (const Color& color) { this->radiusMesh.color (color); }
+  void color (const Color& color)
+  {
+    this->_color = color;
+    this->revision++;
+  }
 
-  void enable () { this->isEnabled = true; }
+  void enable ()
+  {
+    if (this->isEnabled == false)
+    {
+      this->isEnabled = true;
+      this->revision++;
+    }
+  }
 
-  void disable () { this->isEnabled = false; }
+  void disable ()
+  {
+    if (this->isEnabled)
+    {
+      this->isEnabled = false;
+      this->revision++;
+    }
+  }
 
   void render (Camera& camera) const
   {
     if (this->isEnabled)
     {
+      // the sphere is shared with other cursors
+      this->radiusMesh->position (this->_position);
+      this->radiusMesh->scaling (glm::vec3 (this->_radius));
+      this->radiusMesh->color (this->_color);
+
       OpenGL::glClear (OpenGL::StencilBufferBit ());
 
       OpenGL::glDepthMask (false);
@@ -62,7 +99,7 @@ struct ViewCursor::Impl
       OpenGL::glStencilFunc (OpenGL::Always (), 1, 255);
       OpenGL::glStencilOp (OpenGL::Keep (), OpenGL::Replace (), OpenGL::Keep ());
 
-      this->radiusMesh.render (camera);
+      this->radiusMesh->render (camera);
 
       OpenGL::glCullFace (OpenGL::Back ());
       OpenGL::glColorMask (true, true, true, true);
@@ -74,15 +111,13 @@ struct ViewCursor::Impl
       OpenGL::glBlendEquation (OpenGL::FuncAdd ());
       OpenGL::glBlendFunc (OpenGL::DstColor (), OpenGL::Zero ());
 
-      this->radiusMesh.render (camera);
+      this->radiusMesh->render (camera);
 
       OpenGL::glDisable (OpenGL::Blend ());
       OpenGL::glDisable (OpenGL::StencilTest ());
       OpenGL::glDepthMask (true);
     }
   }
-
-  void update () { this->radiusMesh.scaling (glm::vec3 (this->radius ())); }
 };
 
 DELEGATE_BIG6 (ViewCursor)
@@ -90,6 +125,7 @@ DELEGATE_CONST (float, ViewCursor, radius)
 DELEGATE_CONST (glm::vec3, ViewCursor, position)
 DELEGATE_CONST (const Color&, ViewCursor, color)
 GETTER_CONST (bool, ViewCursor, isEnabled)
+GETTER_CONST (unsigned int, ViewCursor, revision)
 DELEGATE1 (void, ViewCursor, radius, float)
 DELEGATE1 (void, ViewCursor, position, const glm::vec3&)
 DELEGATE1 (void, ViewCursor, color, const Color&)
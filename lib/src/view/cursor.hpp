@@ -21,7 +21,9 @@ public:
   glm::vec3    position () const;
   const Color& color () const;
   bool         isEnabled () const;
+  unsigned int revision () const;
 
+  // the revision changes whenever a setter changes how the cursor is rendered
   void radius (float);
   void position (const glm::vec3&);
   void color (const Color&);
@@ -0,0 +1,146 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QOpenGLFramebufferObject>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <memory>
+#include "opengl-buffer-id.hpp"
+#include "opengl.hpp"
+#include "view/depth-picker.hpp"
+
+struct ViewDepthPicker::Impl
+{
+  std::unique_ptr<QOpenGLFramebufferObject> framebuffer;
+  OpenGLBufferId                            bufferId;
+  bool                                      isPending;
+  glm::ivec2                                pendingPixel;
+
+  Impl ()
+    : isPending (false)
+  {
+  }
+
+  bool hasCapture () const { return bool(this->framebuffer); }
+
+  void capture (const glm::ivec2& size)
+  {
+    if (QOpenGLFramebufferObject::hasOpenGLFramebufferBlit () == false)
+    {
+      return;
+    }
+
+    const QSize qSize (size.x, size.y);
+    const QRect rect (QPoint (0, 0), qSize);
+
+    if (this->framebuffer == nullptr || this->framebuffer->size () != qSize)
+    {
+      this->framebuffer.reset (
+        new QOpenGLFramebufferObject (qSize, QOpenGLFramebufferObject::CombinedDepthStencil));
+    }
+    QOpenGLFramebufferObject::blitFramebuffer (this->framebuffer.get (), rect, nullptr, rect,
+                                               OpenGL::DepthBufferBit ());
+    this->isPending = false;
+  }
+
+  void request (const glm::ivec2& pixel)
+  {
+    assert (this->hasCapture ());
+
+    const QSize size = this->framebuffer->size ();
+
+    if (this->bufferId.isValid () == false)
+    {
+      this->bufferId.allocate ();
+      OpenGL::glBindBuffer (OpenGL::PixelPackBuffer (), this->bufferId.id ());
+      OpenGL::glBufferData (OpenGL::PixelPackBuffer (), sizeof (float), nullptr,
+                            OpenGL::StreamRead ());
+    }
+    else
+    {
+      OpenGL::glBindBuffer (OpenGL::PixelPackBuffer (), this->bufferId.id ());
+    }
+
+    this->framebuffer->bind ();
+    OpenGL::glReadPixels (glm::clamp (pixel.x, 0, size.width () - 1),
+                          glm::clamp (pixel.y, 0, size.height () - 1), 1, 1,
+                          OpenGL::DepthComponent (), OpenGL::Float (), nullptr);
+    this->framebuffer->release ();
+
+    OpenGL::glBindBuffer (OpenGL::PixelPackBuffer (), 0);
+
+    this->isPending = true;
+    this->pendingPixel = pixel;
+  }
+
+  float depth (const glm::ivec2& pixel)
+  {
+    assert (this->hasCapture ());
+
+    if (this->isPending == false || this->pendingPixel != pixel)
+    {
+      this->request (pixel);
+    }
+
+    float depth = 1.0f;
+
+    OpenGL::glBindBuffer (OpenGL::PixelPackBuffer (), this->bufferId.id ());
+    const void* data = OpenGL::glMapBuffer (OpenGL::PixelPackBuffer (), OpenGL::ReadOnly ());
+    if (data)
+    {
+      depth = *static_cast<const float*> (data);
+      OpenGL::glUnmapBuffer (OpenGL::PixelPackBuffer ());
+    }
+    OpenGL::glBindBuffer (OpenGL::PixelPackBuffer (), 0);
+
+    return depth;
+  }
+
+  void depths (const glm::ivec2& pixel, const glm::ivec2& size, std::vector<float>& depths)
+  {
+    assert (this->hasCapture ());
+    assert (glm::all (glm::greaterThan (size, glm::ivec2 (0))));
+
+    const QSize      fbSize = this->framebuffer->size ();
+    const glm::ivec2 min = glm::max (pixel, glm::ivec2 (0));
+    const glm::ivec2 max = glm::min (pixel + size, glm::ivec2 (fbSize.width (), fbSize.height ()));
+
+    depths.assign (size.x * size.y, 1.0f);
+
+    if (glm::any (glm::greaterThanEqual (min, max)))
+    {
+      return;
+    }
+
+    const glm::ivec2   readSize = max - min;
+    std::vector<float> rect (readSize.x * readSize.y);
+
+    this->framebuffer->bind ();
+    OpenGL::glReadPixels (min.x, min.y, readSize.x, readSize.y, OpenGL::DepthComponent (),
+                          OpenGL::Float (), rect.data ());
+    this->framebuffer->release ();
+
+    for (int y = 0; y < readSize.y; y++)
+    {
+      std::copy (rect.begin () + (y * readSize.x), rect.begin () + ((y + 1) * readSize.x),
+                 depths.begin () + ((min.y - pixel.y + y) * size.x) + (min.x - pixel.x));
+    }
+  }
+
+  void reset ()
+  {
+    this->framebuffer.reset ();
+    this->bufferId.reset ();
+    this->isPending = false;
+  }
+};
+
+DELEGATE_BIG2 (ViewDepthPicker)
+DELEGATE_CONST (bool, ViewDepthPicker, hasCapture)
+DELEGATE1 (void, ViewDepthPicker, capture, const glm::ivec2&)
+DELEGATE1 (void, ViewDepthPicker, request, const glm::ivec2&)
+DELEGATE1 (float, ViewDepthPicker, depth, const glm::ivec2&)
+DELEGATE3 (void, ViewDepthPicker, depths, const glm::ivec2&, const glm::ivec2&,
+           std::vector<float>&)
+DELEGATE (void, ViewDepthPicker, reset)
@@ -0,0 +1,44 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_VIEW_DEPTH_PICKER
+#define DILAY_VIEW_DEPTH_PICKER
+
+#include <glm/fwd.hpp>
+#include <vector>
+#include "macro.hpp"
+
+/* Picks points on the GPU: the depth buffer of a frame is copied once the dynamic meshes have been
+ * rendered, and the depths of single pixels are read back through a pixel buffer object.  A read
+ * that is requested at the end of a frame has usually completed when its result is needed.
+ * Pixels are given in framebuffer coordinates with the origin at the bottom left.
+ */
+class ViewDepthPicker
+{
+public:
+  DECLARE_BIG2 (ViewDepthPicker)
+
+  bool hasCapture () const;
+
+  // copies the depth buffer of the bound framebuffer, whose size is given in pixels
+  void capture (const glm::ivec2&);
+
+  // starts reading the depth of a pixel without waiting for the result
+  void request (const glm::ivec2&);
+
+  // returns the depth of a pixel, which is taken from a pending request of the same pixel if any
+  float depth (const glm::ivec2&);
+
+  /* reads the depths of a rectangle, which is given by its bottom left pixel and its size, row by
+   * row and waits for the result.  Pixels outside of the capture have a depth of 1.
+   */
+  void depths (const glm::ivec2&, const glm::ivec2&, std::vector<float>&);
+
+  void reset ();
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
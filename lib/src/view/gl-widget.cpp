@@ -3,19 +3,36 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QGuiApplication>
 #include <QMouseEvent>
+#include <QOpenGLFramebufferObject>
 #include <QPainter>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QTimer>
+#include <chrono>
 #include <glm/glm.hpp>
 #include "camera.hpp"
+#include "color.hpp"
 #include "config.hpp"
+#include "latency-profiler.hpp"
+#include "maybe.hpp"
 #include "mesh-util.hpp"
 #include "mesh.hpp"
+#include "opengl-upload.hpp"
 #include "opengl.hpp"
+#include "overlay-batch.hpp"
+#include "profiler.hpp"
+#include "render-profiler.hpp"
 #include "renderer.hpp"
 #include "scene.hpp"
 #include "state.hpp"
 #include "tool/move-camera.hpp"
 #include "view/axis.hpp"
+#include "view/depth-picker.hpp"
 #include "view/floor-plane.hpp"
 #include "view/gl-widget.hpp"
 #include "view/info-pane.hpp"
@@ -26,31 +43,93 @@
 #include "view/tool-pane.hpp"
 #include "view/util.hpp"
 
+namespace
+{
+  typedef std::chrono::steady_clock Clock;
+
+  const Config::Key<Color> labelColorKey ("editor/axis/color/label");
+
+  // delay after which a scene that was rendered at a reduced resolution is rendered again in full
+  constexpr int fullResolutionDelay = 200;
+}
+
 struct ViewGlWidget::Impl
 {
-  typedef std::unique_ptr<ToolMoveCamera> ToolMoveCameraPtr;
-  typedef std::unique_ptr<State>          StatePtr;
-  typedef std::unique_ptr<ViewAxis>       AxisPtr;
-  typedef std::unique_ptr<ViewFloorPlane> FloorPlanePtr;
-
-  ViewGlWidget*     self;
-  ViewMainWindow&   mainWindow;
-  Config&           config;
-  Cache&            cache;
-  ToolMoveCameraPtr _immediateMoveCamera;
-  StatePtr          _state;
-  AxisPtr           axis;
-  FloorPlanePtr     _floorPlane;
-  bool              tabletPressed;
+  typedef std::unique_ptr<ToolMoveCamera>           ToolMoveCameraPtr;
+  typedef std::unique_ptr<State>                    StatePtr;
+  typedef std::unique_ptr<ViewAxis>                 AxisPtr;
+  typedef std::unique_ptr<ViewFloorPlane>           FloorPlanePtr;
+  typedef std::unique_ptr<QOpenGLFramebufferObject> FramebufferPtr;
+  typedef std::unique_ptr<ViewDepthPicker>          DepthPickerPtr;
+
+  ViewGlWidget*                  self;
+  ViewMainWindow&                mainWindow;
+  Config&                        config;
+  Cache&                         cache;
+  ToolMoveCameraPtr              _immediateMoveCamera;
+  StatePtr                       _state;
+  AxisPtr                        axis;
+  FloorPlanePtr                  _floorPlane;
+  FramebufferPtr                 sceneCache;
+  glm::mat4x4                    sceneCacheWorld;
+  FramebufferPtr                 scaledScene;
+  float                          renderScale;
+  float                          targetFrameTime;
+  float                          minRenderScale;
+  glm::mat4x4                    previousWorld;
+  bool                           isIdle;
+  QTimer                         idleTimer;
+  DepthPickerPtr                 depthPicker;
+  glm::mat4x4                    depthPickerWorld;
+  bool                           isSceneOutdated;
+  bool                           isOverlayOutdated;
+  bool                           tabletPressed;
+  float                          tabletPressureIntensity;
+  InlineMaybe<ViewPointingEvent> pendingMoveEvent;
+  InlineMaybe<Clock::time_point> unpaintedInput;
+  QTimer                         moveEventTimer;
+  QTimer                         precompileTimer;
+  bool                           isRenderProfileShown;
+  int                            renderProfileDumpInterval;
+  bool                           hasDumpedRenderProfile;
+  Clock::time_point              lastRenderProfileDump;
+  bool                           isLatencyProfileShown;
+  int                            latencyProfileDumpInterval;
+  Clock::time_point              lastLatencyProfileDump;
 
   Impl (ViewGlWidget* s, ViewMainWindow& mW, Config& cfg, Cache& cch)
     : self (s)
     , mainWindow (mW)
     , config (cfg)
     , cache (cch)
+    , renderScale (1.0f)
+    , targetFrameTime (0.0f)
+    , minRenderScale (1.0f)
+    , isIdle (false)
+    , isSceneOutdated (true)
+    , isOverlayOutdated (false)
     , tabletPressed (false)
+    , tabletPressureIntensity (this->config.get<float> ("editor/tablet-pressure-intensity"))
+    , isRenderProfileShown (false)
+    , renderProfileDumpInterval (0)
+    , hasDumpedRenderProfile (false)
+    , isLatencyProfileShown (false)
+    , latencyProfileDumpInterval (0)
   {
     this->self->setAutoFillBackground (false);
+
+    this->moveEventTimer.setSingleShot (true);
+    QObject::connect (&this->moveEventTimer, &QTimer::timeout,
+                      [this]() { this->flushMoveEvent (); });
+
+    QObject::connect (&this->precompileTimer, &QTimer::timeout,
+                      [this]() { this->precompileProgram (); });
+
+    this->idleTimer.setSingleShot (true);
+    QObject::connect (&this->idleTimer, &QTimer::timeout, [this]() {
+      this->isIdle = true;
+      this->update ();
+    });
   }
 
   ~Impl ()
@@ -60,6 +139,10 @@ struct ViewGlWidget::Impl
     this->_state.reset (nullptr);
     this->axis.reset (nullptr);
     this->_floorPlane.reset (nullptr);
+    this->sceneCache.reset (nullptr);
+    this->scaledScene.reset (nullptr);
+    this->depthPicker.reset (nullptr);
+    OpenGLUploader::stop ();
 
     this->self->doneCurrent ();
   }
@@ -99,22 +182,139 @@ struct ViewGlWidget::Impl
     this->floorPlane ().update (this->state ().camera ());
 
     this->_immediateMoveCamera->fromConfig ();
+
+    this->tabletPressureIntensity = this->config.get<float> ("editor/tablet-pressure-intensity");
+    this->renderProfilerFromConfig ();
+    this->latencyProfilerFromConfig ();
+    this->depthPickerFromConfig ();
+  }
+
+  void renderScaleFromConfig ()
+  {
+    this->targetFrameTime = this->config.get<float> ("editor/dynamic-resolution/target-frame-time");
+    this->minRenderScale = this->config.get<float> ("editor/dynamic-resolution/min-scale");
+    this->renderScale = 1.0f;
+  }
+
+  void depthPickerFromConfig ()
+  {
+    if (this->config.get<bool> ("editor/use-gpu-picking"))
+    {
+      if (this->depthPicker == nullptr)
+      {
+        this->depthPicker.reset (new ViewDepthPicker);
+        this->isSceneOutdated = true;
+      }
+    }
+    else if (this->depthPicker)
+    {
+      this->self->makeCurrent ();
+      this->depthPicker.reset (nullptr);
+    }
+  }
+
+  RenderProfiler& renderProfiler () { return this->state ().camera ().renderer ().profiler (); }
+
+  void renderProfilerFromConfig ()
+  {
+    this->renderProfileDumpInterval =
+      this->config.get<int> ("editor/render-profiler/dump-interval");
+    this->renderScaleFromConfig ();
+    this->updateRenderProfiler ();
+  }
+
+  // the dynamic resolution is sized by the GPU times of the profiler
+  void updateRenderProfiler ()
+  {
+    this->renderProfiler ().enable (this->isRenderProfileShown ||
+                                    this->renderProfileDumpInterval > 0 ||
+                                    this->targetFrameTime > 0.0f);
+  }
+
+  void showRenderProfile (bool value)
+  {
+    this->isRenderProfileShown = value;
+    this->updateRenderProfiler ();
+  }
+
+  void latencyProfilerFromConfig ()
+  {
+    this->latencyProfileDumpInterval =
+      this->config.get<int> ("editor/latency-profiler/dump-interval");
+    this->updateLatencyProfiler ();
+  }
+
+  void updateLatencyProfiler ()
+  {
+    const bool isEnabled = this->isLatencyProfileShown || this->latencyProfileDumpInterval > 0;
+
+    if (isEnabled && LatencyProfiler::isEnabled () == false)
+    {
+      LatencyProfiler::reset ();
+      this->lastLatencyProfileDump = Clock::now ();
+    }
+    LatencyProfiler::enable (isEnabled);
+    this->unpaintedInput.reset ();
+  }
+
+  void showLatencyProfile (bool value)
+  {
+    this->isLatencyProfileShown = value;
+    this->updateLatencyProfiler ();
+  }
+
+  void update ()
+  {
+    this->isSceneOutdated = true;
+    this->self->QOpenGLWidget::update ();
+  }
+
+  void updateOverlay ()
+  {
+    this->isOverlayOutdated = true;
+    this->self->QOpenGLWidget::update ();
   }
 
   void initializeGL ()
   {
     OpenGL::initializeFunctions (this->config.get<bool> ("editor/use-geometry-shader"));
+    if (this->config.get<bool> ("editor/opengl-debug/enabled"))
+    {
+      OpenGL::initializeDebugOutput (this->config.get<int> ("editor/opengl-debug/min-severity"));
+    }
+    if (this->config.get<bool> ("editor/mesh/background-upload/enabled"))
+    {
+      const int minKilobytes =
+        this->config.get<int> ("editor/mesh/background-upload/min-kilobytes");
+      OpenGLUploader::start (*this->self->context (), 1024 * minKilobytes);
+    }
 
     this->_state.reset (new State (this->mainWindow, this->config, this->cache));
     this->axis.reset (new ViewAxis (this->config));
     this->_floorPlane.reset (new ViewFloorPlane (this->config, this->state ().camera ()));
     this->_immediateMoveCamera.reset (new ToolMoveCamera (this->state (), true));
     this->_immediateMoveCamera->initialize ();
+    this->renderProfilerFromConfig ();
+    this->latencyProfilerFromConfig ();
+    this->depthPickerFromConfig ();
 
     this->self->setMouseTracking (true);
     this->self->setTabletTracking (true);
     this->initializeScene ();
     this->mainWindow.toolPane ().forceWidth ();
+
+    // the remaining programs are compiled whenever no events are pending
+    this->precompileTimer.start (0);
+  }
+
+  void precompileProgram ()
+  {
+    this->self->makeCurrent ();
+
+    if (this->state ().camera ().renderer ().precompileProgram () == false)
+    {
+      this->precompileTimer.stop ();
+    }
   }
 
   void initializeScene ()
@@ -122,11 +322,7 @@ struct ViewGlWidget::Impl
     const QStringList arguments = QCoreApplication::arguments ();
     if (arguments.size () > 1)
     {
-      const std::string fileName = arguments.at (1).toStdString ();
-      if (this->state ().scene ().fromDlyFile (this->state ().config (), fileName) == false)
-      {
-        ViewUtil::error (this->mainWindow, QObject::tr ("Could not open file."));
-      }
+      this->state ().fromDlyFile (arguments.at (1).toStdString ());
     }
     else
     {
@@ -135,35 +331,378 @@ struct ViewGlWidget::Impl
     this->mainWindow.infoPane ().scene ().updateInfo ();
   }
 
-  void paintGL ()
+  QRect framebufferRect () const
   {
-    QPainter painter (this->self);
-    painter.beginNativePainting ();
+    const qreal ratio = this->self->devicePixelRatioF ();
+    return QRect (0, 0, int(this->self->width () * ratio), int(this->self->height () * ratio));
+  }
+
+  // converts a position of the widget into a pixel of its framebuffer
+  glm::ivec2 framebufferPixel (const glm::ivec2& pos) const
+  {
+    const qreal ratio = this->self->devicePixelRatioF ();
+    return glm::ivec2 (int(pos.x * ratio),
+                       this->framebufferRect ().height () - 1 - int(pos.y * ratio));
+  }
+
+  unsigned int framebufferBits () const
+  {
+    return OpenGL::ColorBufferBit () | OpenGL::DepthBufferBit () | OpenGL::StencilBufferBit ();
+  }
+
+  // repaints that were only requested by `updateOverlay` reuse the cached scene, as long as it
+  // was rendered with the same camera and resolution
+  bool canRenderOverlayOnly ()
+  {
+    return this->isSceneOutdated == false && this->isOverlayOutdated && this->sceneCache &&
+           this->sceneCache->size () == this->framebufferRect ().size () &&
+           this->sceneCacheWorld == this->state ().camera ().world ();
+  }
+
+  /* While the camera moves or a button is held, e.g. during a stroke, the scene is rendered at a
+   * resolution that is scaled such that the GPU time of a frame approaches the target frame time.
+   * Frames are rendered in full resolution again once no frame has been rendered for a while.
+   */
+  void updateRenderScale ()
+  {
+    const glm::mat4x4& world = this->state ().camera ().world ();
+    const bool         isMoving = world != this->previousWorld ||
+                          QGuiApplication::mouseButtons () != Qt::NoButton || this->tabletPressed;
+
+    this->previousWorld = world;
+
+    if (this->targetFrameTime <= 0.0f || this->isIdle || isMoving == false ||
+        QOpenGLFramebufferObject::hasOpenGLFramebufferBlit () == false)
+    {
+      this->renderScale = 1.0f;
+    }
+    else
+    {
+      // the GPU time of a frame is roughly proportional to its number of pixels
+      const float frameTime = this->renderProfiler ().recentGpuFrameTime ();
+
+      if (frameTime > 0.0f)
+      {
+        this->renderScale =
+          glm::clamp (this->renderScale * glm::sqrt (this->targetFrameTime / frameTime),
+                      glm::min (this->minRenderScale, 1.0f), 1.0f);
+      }
+      if (this->renderScale < 1.0f)
+      {
+        this->idleTimer.start (fullResolutionDelay);
+      }
+    }
+    this->isIdle = false;
+  }
+
+  QRect scaledFramebufferRect () const
+  {
+    const QRect rect = this->framebufferRect ();
+
+    return QRect (0, 0, glm::max (1, int(float(rect.width ()) * this->renderScale)),
+                  glm::max (1, int(float(rect.height ()) * this->renderScale)));
+  }
+
+  void renderScene ()
+  {
+    RenderProfiler& profiler = this->renderProfiler ();
+    const bool      isScaled = this->renderScale < 1.0f;
+    const QRect     rect = this->framebufferRect ();
+    const QRect     scaledRect = this->scaledFramebufferRect ();
+
+    if (isScaled)
+    {
+      if (this->scaledScene == nullptr || this->scaledScene->size () != scaledRect.size ())
+      {
+        this->scaledScene.reset (new QOpenGLFramebufferObject (
+          scaledRect.size (), QOpenGLFramebufferObject::CombinedDepthStencil));
+      }
+      this->scaledScene->bind ();
+      OpenGL::glViewport (0, 0, scaledRect.width (), scaledRect.height ());
+    }
 
     this->state ().camera ().renderer ().setupRendering ();
-    this->state ().scene ().render (this->state ().camera ());
+    this->state ().scene ().render (this->state ().camera (), [this, isScaled, &rect]() {
+      // depths of a scaled scene do not match the pixels of the framebuffer
+      if (this->depthPicker && isScaled)
+      {
+        this->depthPicker->reset ();
+      }
+      else if (this->depthPicker)
+      {
+        this->depthPicker->capture (glm::ivec2 (rect.width (), rect.height ()));
+        this->depthPickerWorld = this->state ().camera ().world ();
+      }
+    });
+
+    profiler.beginPhase (RenderPhase::FloorPlane);
     this->floorPlane ().render (this->state ().camera ());
+    profiler.endPhase (RenderPhase::FloorPlane);
+
+    if (isScaled)
+    {
+      this->scaledScene->release ();
+      OpenGL::glViewport (0, 0, rect.width (), rect.height ());
+
+      QOpenGLFramebufferObject::blitFramebuffer (nullptr, rect, this->scaledScene.get (),
+                                                 scaledRect, OpenGL::ColorBufferBit (),
+                                                 OpenGL::Linear ());
+      QOpenGLFramebufferObject::blitFramebuffer (
+        nullptr, rect, this->scaledScene.get (), scaledRect,
+        OpenGL::DepthBufferBit () | OpenGL::StencilBufferBit (), OpenGL::Nearest ());
+    }
+
+    if (QOpenGLFramebufferObject::hasOpenGLFramebufferBlit ())
+    {
+
+      if (this->sceneCache == nullptr || this->sceneCache->size () != rect.size ())
+      {
+        this->sceneCache.reset (new QOpenGLFramebufferObject (
+          rect.size (), QOpenGLFramebufferObject::CombinedDepthStencil));
+      }
+      QOpenGLFramebufferObject::blitFramebuffer (this->sceneCache.get (), rect, nullptr, rect,
+                                                 this->framebufferBits ());
+      this->sceneCacheWorld = this->state ().camera ().world ();
+    }
+  }
+
+  void restoreScene ()
+  {
+    const QRect rect = this->framebufferRect ();
+
+    QOpenGLFramebufferObject::blitFramebuffer (nullptr, rect, this->sceneCache.get (), rect,
+                                               this->framebufferBits ());
+    this->state ().camera ().renderer ().setupRendering (false);
+  }
+
+  void paintGL ()
+  {
+    PROFILE_ZONE ("render/frame")
+    LatencyTimer    timer (LatencyStage::Paint);
+    RenderProfiler& profiler = this->renderProfiler ();
+    QPainter        painter (this->self);
+
+    profiler.beginFrame ();
+    painter.beginNativePainting ();
+
+    if (this->canRenderOverlayOnly ())
+    {
+      this->restoreScene ();
+    }
+    else
+    {
+      this->updateRenderScale ();
+      this->renderScene ();
+    }
+    this->isSceneOutdated = false;
+    this->isOverlayOutdated = false;
 
     if (this->state ().hasTool ())
     {
+      profiler.beginPhase (RenderPhase::Tool);
       this->state ().tool ().render ();
+      this->state ().camera ().renderer ().overlay ().flush (this->state ().camera ());
+      profiler.endPhase (RenderPhase::Tool);
     }
+    profiler.beginPhase (RenderPhase::Axis);
     this->axis->render (this->state ().camera ());
+    profiler.endPhase (RenderPhase::Axis);
+
+    // the depth under the cursor is likely needed by the next hover event
+    if (this->depthPicker && this->depthPicker->hasCapture ())
+    {
+      this->depthPicker->request (this->framebufferPixel (this->cursorPosition ()));
+    }
 
     this->state ().camera ().renderer ().shutdownRendering ();
     painter.endNativePainting ();
 
+    profiler.beginPhase (RenderPhase::Overlays);
     this->axis->render (this->state ().camera (), painter);
     if (this->state ().hasTool ())
     {
       this->state ().tool ().paint (painter);
     }
+    profiler.endPhase (RenderPhase::Overlays);
+    profiler.endFrame ();
+
+    if (this->isRenderProfileShown)
+    {
+      this->paintRenderProfile (painter);
+    }
+    this->dumpRenderProfile ();
+
+    if (this->unpaintedInput)
+    {
+      LatencyProfiler::record (LatencyStage::Input, Clock::now () - *this->unpaintedInput);
+      this->unpaintedInput.reset ();
+    }
+    this->dumpLatencyProfile ();
+  }
+
+  void paintRenderProfile (QPainter& painter)
+  {
+    const RenderProfiler& profiler = this->renderProfiler ();
+    const bool            hasGpuTimes = profiler.hasGpuTimes ();
+    QString               text = QObject::tr ("Phase: GPU / CPU ms");
+    float                 gpuTotal = 0.0f;
+    float                 cpuTotal = 0.0f;
+
+    const auto time = [](float ms) { return QString::number (double(ms), 'f', 2); };
+    const auto gpuTime = [hasGpuTimes, &time](float ms) {
+      return hasGpuTimes ? time (ms) : QObject::tr ("n/a");
+    };
+
+    profiler.forEachPhase ([&](const char* name, float gpu, float cpu) {
+      text += "\n" + QString (name) + ": " + gpuTime (gpu) + " / " + time (cpu);
+      gpuTotal += gpu;
+      cpuTotal += cpu;
+    });
+    text += "\n" + QObject::tr ("Total") + ": " + gpuTime (gpuTotal) + " / " + time (cpuTotal);
+
+    painter.setPen (this->config.get (labelColorKey).qColor ());
+    painter.drawText (this->self->rect ().adjusted (10, 10, -10, -10),
+                      Qt::AlignLeft | Qt::AlignTop, text);
+  }
+
+  // appends the averaged frame times to a CSV file if the configured interval elapsed
+  void dumpRenderProfile ()
+  {
+    if (this->renderProfileDumpInterval <= 0)
+    {
+      return;
+    }
+
+    const Clock::time_point now = Clock::now ();
+    if (this->hasDumpedRenderProfile &&
+        now - this->lastRenderProfileDump < std::chrono::seconds (this->renderProfileDumpInterval))
+    {
+      return;
+    }
+
+    const QDir dir (QStandardPaths::writableLocation (QStandardPaths::ConfigLocation));
+    QFile      file (dir.filePath ("dilay-render-profile.csv"));
+    const bool isNew = file.exists () == false;
+
+    if (file.open (QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text) == false)
+    {
+      return;
+    }
+
+    QTextStream   stream (&file);
+    const QString time = QDateTime::currentDateTime ().toString (Qt::ISODate);
+
+    if (isNew)
+    {
+      stream << "time,phase,gpu-ms,cpu-ms\n";
+    }
+
+    this->renderProfiler ().forEachPhase (
+      [&stream, &time](const char* name, float gpu, float cpu) {
+        stream << time << "," << name << "," << gpu << "," << cpu << "\n";
+      });
+
+    this->hasDumpedRenderProfile = true;
+    this->lastRenderProfileDump = now;
+  }
+
+  // writes the latency histograms that have been measured so far if the configured interval elapsed
+  void dumpLatencyProfile ()
+  {
+    if (this->latencyProfileDumpInterval <= 0)
+    {
+      return;
+    }
+
+    const Clock::time_point    now = Clock::now ();
+    const std::chrono::seconds interval (this->latencyProfileDumpInterval);
+
+    if (now - this->lastLatencyProfileDump < interval)
+    {
+      return;
+    }
+
+    const QDir dir (QStandardPaths::writableLocation (QStandardPaths::ConfigLocation));
+
+    LatencyProfiler::dump (dir.filePath ("dilay-latency-profile.json").toStdString ());
+    this->lastLatencyProfileDump = now;
+  }
+
+  void resizeGL (int w, int h)
+  {
+    this->state ().camera ().updateResolution (glm::uvec2 (w, h));
+    this->isSceneOutdated = true;
+  }
+
+  bool pickDynamicMeshes (const glm::ivec2& pos, bool& isHit, glm::vec3& position)
+  {
+    const Camera& camera = this->state ().camera ();
+
+    if (this->depthPicker == nullptr || this->depthPicker->hasCapture () == false ||
+        this->isSceneOutdated || this->depthPickerWorld != camera.world ())
+    {
+      return false;
+    }
+
+    this->self->makeCurrent ();
+
+    const float depth = this->depthPicker->depth (this->framebufferPixel (pos));
+
+    isHit = depth < 1.0f;
+    if (isHit)
+    {
+      position = camera.unproject (pos, depth);
+    }
+    return true;
   }
 
-  void resizeGL (int w, int h) { this->state ().camera ().updateResolution (glm::uvec2 (w, h)); }
+  bool depths (const glm::ivec2& pos, const glm::ivec2& size, std::vector<float>& depths)
+  {
+    if (this->depthPicker == nullptr || this->depthPicker->hasCapture () == false ||
+        this->depthPickerWorld != this->state ().camera ().world ())
+    {
+      return false;
+    }
+
+    // the pixels of the framebuffer may be more dense than the points of the window
+    const glm::ivec2   pixelMin = this->framebufferPixel (pos + glm::ivec2 (0, size.y - 1));
+    const glm::ivec2   pixelMax = this->framebufferPixel (pos + glm::ivec2 (size.x - 1, 0));
+    const glm::ivec2   pixelSize = pixelMax - pixelMin + glm::ivec2 (1);
+    std::vector<float> pixelDepths;
+
+    this->self->makeCurrent ();
+    this->depthPicker->depths (pixelMin, pixelSize, pixelDepths);
+
+    depths.resize (size.x * size.y);
+    for (int y = 0; y < size.y; y++)
+    {
+      for (int x = 0; x < size.x; x++)
+      {
+        const glm::ivec2 pixel = this->framebufferPixel (pos + glm::ivec2 (x, y)) - pixelMin;
+
+        depths[(y * size.x) + x] = pixelDepths[(pixel.y * pixelSize.x) + pixel.x];
+      }
+    }
+    return true;
+  }
+
+  /* Keeps the time of the oldest input that has not been painted yet.  Maintenance is
+   * interrupted before the input is dispatched.
+   */
+  void receiveInput (const ViewPointingEvent& e)
+  {
+    this->state ().interruptMaintenance ();
+
+    if (this->unpaintedInput == false && LatencyProfiler::isEnabled ())
+    {
+      this->unpaintedInput = e.timestamp ();
+    }
+  }
 
   void pointingEvent (const ViewPointingEvent& e)
   {
+    this->receiveInput (e);
+
     if (e.valid ())
     {
       if (this->_immediateMoveCamera->pointingEvent (e) == ToolResponse::Redraw)
@@ -179,11 +718,41 @@ struct ViewGlWidget::Impl
     }
   }
 
+  /* Move events are not dispatched immediately but once the event queue has been processed, such
+   * that a tool that falls behind a high-rate device (e.g. a sculpt stroke on a tablet) only sees
+   * the most recent of the moves that have been queued in the meantime.  Intermediate positions of
+   * a stroke are interpolated by the tool anyway.
+   */
+  void queueMoveEvent (const ViewPointingEvent& e)
+  {
+    this->receiveInput (e);
+    this->pendingMoveEvent = e;
+
+    if (this->moveEventTimer.isActive () == false)
+    {
+      this->moveEventTimer.start (0);
+    }
+  }
+
+  // dispatches a pending move event before any other event
+  void flushMoveEvent ()
+  {
+    this->moveEventTimer.stop ();
+
+    if (this->pendingMoveEvent)
+    {
+      const ViewPointingEvent e = *this->pendingMoveEvent;
+
+      this->pendingMoveEvent.reset ();
+      this->pointingEvent (e);
+    }
+  }
+
   void mouseMoveEvent (QMouseEvent* e)
   {
     if (this->tabletPressed == false)
     {
-      this->pointingEvent (ViewPointingEvent (*e));
+      this->queueMoveEvent (ViewPointingEvent (*e));
     }
   }
 
@@ -191,6 +760,7 @@ struct ViewGlWidget::Impl
   {
     if (this->tabletPressed == false)
     {
+      this->flushMoveEvent ();
       this->pointingEvent (ViewPointingEvent (*e));
     }
   }
@@ -199,12 +769,15 @@ struct ViewGlWidget::Impl
   {
     if (this->tabletPressed == false)
     {
+      this->flushMoveEvent ();
       this->pointingEvent (ViewPointingEvent (*e));
     }
   }
 
   void wheelEvent (QWheelEvent* e)
   {
+    this->flushMoveEvent ();
+
     if (this->_immediateMoveCamera->wheelEvent (*e) == ToolResponse::Redraw)
     {
       this->state ().handleToolResponse (ToolResponse::Redraw);
@@ -214,7 +787,7 @@ struct ViewGlWidget::Impl
 
   void tabletEvent (QTabletEvent* e)
   {
-    const ViewPointingEvent pointingEvent (this->state ().config (), *e);
+    const ViewPointingEvent pointingEvent (this->tabletPressureIntensity, *e);
 
     if (pointingEvent.pressEvent ())
     {
@@ -224,13 +797,24 @@ struct ViewGlWidget::Impl
     {
       this->tabletPressed = false;
     }
-    this->pointingEvent (pointingEvent);
+
+    if (pointingEvent.moveEvent ())
+    {
+      this->queueMoveEvent (pointingEvent);
+    }
+    else
+    {
+      this->flushMoveEvent ();
+      this->pointingEvent (pointingEvent);
+    }
   }
 
   void keyPressEvent (QKeyEvent* e)
   {
     const ViewKeyEvent keyEvent (*e, true);
 
+    this->flushMoveEvent ();
+
     if (this->state ().hasTool ())
     {
       this->state ().tool ().keyEvent (keyEvent);
@@ -242,6 +826,8 @@ struct ViewGlWidget::Impl
   {
     const ViewKeyEvent keyEvent (*e, false);
 
+    this->flushMoveEvent ();
+
     if (this->state ().hasTool ())
     {
       this->state ().tool ().keyEvent (keyEvent);
@@ -267,6 +853,12 @@ DELEGATE (State&, ViewGlWidget, state)
 DELEGATE (ViewFloorPlane&, ViewGlWidget, floorPlane)
 DELEGATE (glm::ivec2, ViewGlWidget, cursorPosition)
 DELEGATE (void, ViewGlWidget, fromConfig)
+DELEGATE1 (void, ViewGlWidget, showRenderProfile, bool)
+DELEGATE1 (void, ViewGlWidget, showLatencyProfile, bool)
+DELEGATE (void, ViewGlWidget, update)
+DELEGATE (void, ViewGlWidget, updateOverlay)
+DELEGATE3 (bool, ViewGlWidget, pickDynamicMeshes, const glm::ivec2&, bool&, glm::vec3&)
+DELEGATE3 (bool, ViewGlWidget, depths, const glm::ivec2&, const glm::ivec2&, std::vector<float>&)
 DELEGATE (void, ViewGlWidget, initializeGL)
 DELEGATE2 (void, ViewGlWidget, resizeGL, int, int)
 DELEGATE (void, ViewGlWidget, paintGL)
@@ -7,6 +7,7 @@
 
 #include <QOpenGLWidget>
 #include <glm/fwd.hpp>
+#include <vector>
 #include "macro.hpp"
 
 class Cache;
@@ -27,6 +28,26 @@ public:
   ViewFloorPlane& floorPlane ();
   glm::ivec2      cursorPosition ();
   void            fromConfig ();
+  void            showRenderProfile (bool);
+  void            showLatencyProfile (bool);
+
+  // schedules a repaint of the whole scene
+  void update ();
+
+  // schedules a repaint of the tool's and the axis' overlays on top of the last rendered scene
+  void updateOverlay ();
+
+  /* Picks a point of the dynamic meshes with the depth buffer of the last frame if GPU picking
+   * is enabled.  Returns `false` if the last frame does not show the current scene.
+   */
+  bool pickDynamicMeshes (const glm::ivec2&, bool&, glm::vec3&);
+
+  /* Gets the depths of a window of points, which is given by its top left point and its size, row
+   * by row from the depth buffer of the last frame if GPU picking is enabled.  Unlike picking, the
+   * scene may have changed since the last frame.  Returns `false` if the last frame shows another
+   * view.
+   */
+  bool depths (const glm::ivec2&, const glm::ivec2&, std::vector<float>&);
 
 protected:
   void initializeGL ();
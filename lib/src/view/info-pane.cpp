@@ -2,10 +2,14 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <QProgressBar>
 #include <QScrollArea>
 #include <QTabWidget>
 #include <QVBoxLayout>
+#include <glm/glm.hpp>
 #include "view/info-pane.hpp"
+#include "view/info-pane/latency.hpp"
+#include "view/info-pane/memory.hpp"
 #include "view/info-pane/scene.hpp"
 #include "view/tool-tip.hpp"
 #include "view/two-column-grid.hpp"
@@ -16,24 +20,37 @@ struct ViewInfoPane::Impl
   ViewGlWidget&      glWidget;
   ViewTwoColumnGrid& toolTip;
   ViewInfoPaneScene& scene;
+  QProgressBar&      progressBar;
 
   Impl (ViewInfoPane* s, ViewGlWidget& g)
     : self (s)
     , glWidget (g)
     , toolTip (*new ViewTwoColumnGrid)
     , scene (*new ViewInfoPaneScene (g))
+    , progressBar (*new QProgressBar)
   {
+    QWidget*     pane = new QWidget;
+    QVBoxLayout* layout = new QVBoxLayout (pane);
     QScrollArea* scrollArea = new QScrollArea;
     QTabWidget*  tabWidget = new QTabWidget;
 
     tabWidget->addTab (this->initializeToolTipTab (), QObject::tr ("Keys"));
     tabWidget->addTab (&this->scene, QObject::tr ("Scene"));
+    tabWidget->addTab (new ViewInfoPaneLatency (g), QObject::tr ("Latency"));
+    tabWidget->addTab (new ViewInfoPaneMemory (g), QObject::tr ("Memory"));
 
     scrollArea->setWidgetResizable (true);
     scrollArea->setWidget (tabWidget);
 
+    this->progressBar.setRange (0, 100);
+    this->progressBar.hide ();
+
+    layout->setContentsMargins (0, 0, 0, 0);
+    layout->addWidget (scrollArea);
+    layout->addWidget (&this->progressBar);
+
     this->self->setWindowTitle (QObject::tr ("Info"));
-    this->self->setWidget (scrollArea);
+    this->self->setWidget (pane);
     this->self->setFeatures (DockWidgetMovable | DockWidgetClosable);
     this->self->setAllowedAreas (Qt::LeftDockWidgetArea | Qt::RightDockWidgetArea);
 
@@ -73,9 +90,20 @@ struct ViewInfoPane::Impl
   }
 
   void resetToolTip () { this->toolTip.reset (); }
+
+  void showProgress (const QString& label, float progress)
+  {
+    this->progressBar.setFormat (label + " %p%");
+    this->progressBar.setValue (int(100.0f * glm::clamp (progress, 0.0f, 1.0f)));
+    this->progressBar.show ();
+  }
+
+  void hideProgress () { this->progressBar.hide (); }
 };
 
 DELEGATE_BIG2_BASE (ViewInfoPane, (ViewGlWidget & g, QWidget* p), (this, g), QDockWidget, (p))
 GETTER (ViewInfoPaneScene&, ViewInfoPane, scene)
 DELEGATE1 (void, ViewInfoPane, addToolTip, const ViewToolTip&)
 DELEGATE (void, ViewInfoPane, resetToolTip)
+DELEGATE2 (void, ViewInfoPane, showProgress, const QString&, float)
+DELEGATE (void, ViewInfoPane, hideProgress)
@@ -21,6 +21,8 @@ public:
   void               addToolTip (const ViewToolTip&);
   void               resetToolTip ();
   void               reset ();
+  void               showProgress (const QString&, float);
+  void               hideProgress ();
 
 private:
   IMPLEMENTATION
@@ -0,0 +1,84 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QPushButton>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+#include "latency-profiler.hpp"
+#include "view/gl-widget.hpp"
+#include "view/info-pane/latency.hpp"
+#include "view/util.hpp"
+
+namespace
+{
+  constexpr int updateInterval = 500;
+
+  QString timeString (float ms) { return QString::number (double(ms), 'f', 2); }
+}
+
+struct ViewInfoPaneLatency::Impl
+{
+  ViewInfoPaneLatency* self;
+  ViewGlWidget&        glWidget;
+  QTreeWidget*         tree;
+  QTimer               updateTimer;
+
+  Impl (ViewInfoPaneLatency* s, ViewGlWidget& g)
+    : self (s)
+    , glWidget (g)
+    , tree (new QTreeWidget (this->self))
+  {
+    QVBoxLayout* layout = new QVBoxLayout;
+    QPushButton& resetButton = ViewUtil::pushButton (QObject::tr ("Reset"));
+
+    this->self->setLayout (layout);
+
+    this->tree->setHeaderLabels ({QObject::tr ("Stage (ms)"), QObject::tr ("Count"),
+                                  QObject::tr ("Mean"), QObject::tr ("Median"),
+                                  QObject::tr ("95%"), QObject::tr ("Max.")});
+    this->tree->setRootIsDecorated (false);
+
+    ViewUtil::connect (resetButton, [this]() {
+      LatencyProfiler::reset ();
+      this->updateInfo ();
+    });
+
+    layout->addWidget (this->tree);
+    layout->addWidget (&resetButton);
+
+    QObject::connect (&this->updateTimer, &QTimer::timeout, [this]() { this->updateInfo (); });
+  }
+
+  void updateInfo ()
+  {
+    this->tree->clear ();
+
+    LatencyProfiler::forEachStage ([this](const char* name, const LatencySummary& s) {
+      new QTreeWidgetItem (this->tree,
+                           {QString (name), QString::number (s.count), timeString (s.mean),
+                            timeString (s.median), timeString (s.percentile95),
+                            timeString (s.maximum)});
+    });
+  }
+
+  void showEvent (QShowEvent* e)
+  {
+    this->self->QWidget::showEvent (e);
+    this->glWidget.showLatencyProfile (true);
+    this->updateInfo ();
+    this->updateTimer.start (updateInterval);
+  }
+
+  void hideEvent (QHideEvent* e)
+  {
+    this->self->QWidget::hideEvent (e);
+    this->glWidget.showLatencyProfile (false);
+    this->updateTimer.stop ();
+  }
+};
+
+DELEGATE_BIG2_BASE (ViewInfoPaneLatency, (ViewGlWidget & g, QWidget* p), (this, g), QWidget, (p))
+DELEGATE1 (void, ViewInfoPaneLatency, showEvent, QShowEvent*)
+DELEGATE1 (void, ViewInfoPaneLatency, hideEvent, QHideEvent*)
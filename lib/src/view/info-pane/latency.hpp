@@ -0,0 +1,29 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_VIEW_INFO_PANE_LATENCY
+#define DILAY_VIEW_INFO_PANE_LATENCY
+
+#include <QWidget>
+#include "macro.hpp"
+
+class ViewGlWidget;
+
+/* Shows the latency histograms of handling input.  Latencies are measured while this widget is
+ * visible or while they are periodically dumped to a file.
+ */
+class ViewInfoPaneLatency : public QWidget
+{
+public:
+  DECLARE_BIG2 (ViewInfoPaneLatency, ViewGlWidget&, QWidget* = nullptr)
+
+protected:
+  void showEvent (QShowEvent*);
+  void hideEvent (QHideEvent*);
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
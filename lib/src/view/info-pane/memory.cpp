@@ -0,0 +1,83 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QTimer>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+#include "history.hpp"
+#include "memory-report.hpp"
+#include "scene.hpp"
+#include "state.hpp"
+#include "tool/sculpt/util/action.hpp"
+#include "view/gl-widget.hpp"
+#include "view/info-pane/memory.hpp"
+
+namespace
+{
+  constexpr int updateInterval = 500;
+
+  QString memoryString (std::size_t bytes)
+  {
+    return QString::number (double(bytes) / (1024.0 * 1024.0), 'f', 2);
+  }
+}
+
+struct ViewInfoPaneMemory::Impl
+{
+  ViewInfoPaneMemory* self;
+  ViewGlWidget&       glWidget;
+  QTreeWidget*        tree;
+  QTimer              updateTimer;
+
+  Impl (ViewInfoPaneMemory* s, ViewGlWidget& g)
+    : self (s)
+    , glWidget (g)
+    , tree (new QTreeWidget (this->self))
+  {
+    QVBoxLayout* layout = new QVBoxLayout;
+
+    this->self->setLayout (layout);
+
+    this->tree->setHeaderLabels ({QObject::tr ("Category"), QObject::tr ("MiB")});
+    this->tree->setRootIsDecorated (false);
+
+    layout->addWidget (this->tree);
+
+    QObject::connect (&this->updateTimer, &QTimer::timeout, [this]() { this->updateInfo (); });
+  }
+
+  void updateInfo ()
+  {
+    MemoryReport report;
+
+    this->glWidget.state ().scene ().reportMemory (report);
+    this->glWidget.state ().history ().reportMemory (report);
+    ToolSculptAction::reportMemory (report);
+
+    this->tree->clear ();
+
+    report.forEachCategory ([this](MemoryCategory category, std::size_t bytes) {
+      new QTreeWidgetItem (this->tree, {QString (MemoryReport::name (category)),
+                                        memoryString (bytes)});
+    });
+    new QTreeWidgetItem (this->tree, {QObject::tr ("Total"), memoryString (report.total ())});
+  }
+
+  void showEvent (QShowEvent* e)
+  {
+    this->self->QWidget::showEvent (e);
+    this->updateInfo ();
+    this->updateTimer.start (updateInterval);
+  }
+
+  void hideEvent (QHideEvent* e)
+  {
+    this->self->QWidget::hideEvent (e);
+    this->updateTimer.stop ();
+  }
+};
+
+DELEGATE_BIG2_BASE (ViewInfoPaneMemory, (ViewGlWidget & g, QWidget* p), (this, g), QWidget, (p))
+DELEGATE1 (void, ViewInfoPaneMemory, showEvent, QShowEvent*)
+DELEGATE1 (void, ViewInfoPaneMemory, hideEvent, QHideEvent*)
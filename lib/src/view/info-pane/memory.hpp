@@ -0,0 +1,27 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_VIEW_INFO_PANE_MEMORY
+#define DILAY_VIEW_INFO_PANE_MEMORY
+
+#include <QWidget>
+#include "macro.hpp"
+
+class ViewGlWidget;
+
+// Shows the memory of the scene, the history and the sculpt actions while this widget is visible.
+class ViewInfoPaneMemory : public QWidget
+{
+public:
+  DECLARE_BIG2 (ViewInfoPaneMemory, ViewGlWidget&, QWidget* = nullptr)
+
+protected:
+  void showEvent (QShowEvent*);
+  void hideEvent (QHideEvent*);
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
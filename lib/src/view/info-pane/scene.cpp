@@ -2,26 +2,47 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <QTextStream>
 #include <QTreeWidget>
 #include <QVBoxLayout>
+#include <chrono>
 #include "../../scene.hpp"
+#include "config.hpp"
 #include "dynamic/mesh.hpp"
+#include "dynamic/octree.hpp"
 #include "sketch/mesh.hpp"
 #include "sketch/path.hpp"
 #include "state.hpp"
 #include "view/gl-widget.hpp"
 #include "view/info-pane/scene.hpp"
 
+namespace
+{
+  typedef std::chrono::steady_clock Clock;
+
+  QString memoryString (std::size_t bytes)
+  {
+    return QString::number (double(bytes) / 1024.0, 'f', 1) + " KiB";
+  }
+}
+
 struct ViewInfoPaneScene::Impl
 {
   ViewInfoPaneScene* self;
   ViewGlWidget&      glWidget;
   QTreeWidget*       tree;
+  bool               hasDumpedStatistics;
+  Clock::time_point  lastStatisticsDump;
 
   Impl (ViewInfoPaneScene* s, ViewGlWidget& g)
     : self (s)
     , glWidget (g)
     , tree (new QTreeWidget (this->self))
+    , hasDumpedStatistics (false)
   {
     this->self->setLayout (new QVBoxLayout);
 
@@ -36,6 +57,11 @@ struct ViewInfoPaneScene::Impl
 
       new QTreeWidgetItem (item, {QObject::tr ("Faces"), QString::number (mesh.numFaces ())});
       new QTreeWidgetItem (item, {QObject::tr ("Vertices"), QString::number (mesh.numVertices ())});
+
+      if (this->self->isVisible ())
+      {
+        this->showOctreeStatistics (*item, mesh.octreeStatistics ());
+      }
     };
 
     const auto showSketch = [this](const SketchMesh& sketch) {
@@ -57,8 +83,96 @@ struct ViewInfoPaneScene::Impl
     this->tree->setItemsExpandable (false);
 
     this->self->layout ()->addWidget (this->tree);
+    this->dumpStatistics ();
+  }
+
+  void showEvent (QShowEvent* e)
+  {
+    this->self->QWidget::showEvent (e);
+    this->updateInfo ();
+  }
+
+  void showOctreeStatistics (QTreeWidgetItem& parent, const DynamicOctreeStatistics& stats)
+  {
+    QTreeWidgetItem* item = new QTreeWidgetItem (&parent, {QObject::tr ("Octree")});
+
+    new QTreeWidgetItem (item, {QObject::tr ("Nodes"), QString::number (stats.numNodes)});
+
+    if (stats.numNodes > 0)
+    {
+      const QString depth =
+        QString::number (stats.minDepth) + " - " + QString::number (stats.maxDepth);
+      new QTreeWidgetItem (item, {QObject::tr ("Depth"), depth});
+    }
+    new QTreeWidgetItem (item, {QObject::tr ("Max. elements per node"),
+                                QString::number (stats.maxElementsPerNode)});
+    new QTreeWidgetItem (item, {QObject::tr ("Node memory"), memoryString (stats.nodeMemory)});
+    new QTreeWidgetItem (item,
+                         {QObject::tr ("Element memory"), memoryString (stats.elementMemory)});
+
+    for (const auto& e : stats.numElementsPerDepth)
+    {
+      const unsigned int numNodes = stats.numNodesPerDepth.at (e.first);
+
+      new QTreeWidgetItem (item, {QObject::tr ("Depth %1").arg (e.first),
+                                  QObject::tr ("%1 elements in %2 nodes")
+                                    .arg (e.second)
+                                    .arg (numNodes)});
+    }
+  }
+
+  // appends the octree statistics of all meshes to a CSV file if the configured interval elapsed
+  void dumpStatistics ()
+  {
+    const Config& config = this->glWidget.state ().config ();
+    const int     interval = config.get<int> ("editor/octree-statistics/dump-interval");
+
+    if (interval <= 0)
+    {
+      return;
+    }
+
+    const Clock::time_point now = Clock::now ();
+    if (this->hasDumpedStatistics &&
+        now - this->lastStatisticsDump < std::chrono::seconds (interval))
+    {
+      return;
+    }
+
+    const QDir dir (QStandardPaths::writableLocation (QStandardPaths::ConfigLocation));
+    QFile      file (dir.filePath ("dilay-octree-statistics.csv"));
+    const bool isNew = file.exists () == false;
+
+    if (file.open (QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text) == false)
+    {
+      return;
+    }
+
+    QTextStream   stream (&file);
+    const QString time = QDateTime::currentDateTime ().toString (Qt::ISODate);
+    unsigned int  meshIndex = 0;
+
+    if (isNew)
+    {
+      stream << "time,mesh,faces,nodes,elements,min-depth,max-depth,max-elements-per-node,"
+             << "node-memory,element-memory\n";
+    }
+
+    this->glWidget.state ().scene ().forEachConstMesh (
+      [&stream, &time, &meshIndex](const DynamicMesh& mesh) {
+        const DynamicOctreeStatistics stats = mesh.octreeStatistics ();
+
+        stream << time << "," << meshIndex++ << "," << mesh.numFaces () << "," << stats.numNodes
+               << "," << stats.numElements << "," << stats.minDepth << "," << stats.maxDepth
+               << "," << stats.maxElementsPerNode << "," << qulonglong (stats.nodeMemory) << ","
+               << qulonglong (stats.elementMemory) << "\n";
+      });
+
+    this->hasDumpedStatistics = true;
+    this->lastStatisticsDump = now;
   }
 };
 
 DELEGATE_BIG2_BASE (ViewInfoPaneScene, (ViewGlWidget & g, QWidget* p), (this, g), QWidget, (p))
 DELEGATE (void, ViewInfoPaneScene, updateInfo)
+DELEGATE1 (void, ViewInfoPaneScene, showEvent, QShowEvent*)
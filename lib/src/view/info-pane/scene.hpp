@@ -17,6 +17,9 @@ public:
 
   void updateInfo ();
 
+protected:
+  void showEvent (QShowEvent*);
+
 private:
   IMPLEMENTATION
 };
@@ -2,14 +2,19 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <QActionGroup>
 #include <QDesktopServices>
 #include <QFileDialog>
 #include <QMenuBar>
 #include "../util.hpp"
+#include "config.hpp"
+#include "dynamic/octree.hpp"
 #include "history.hpp"
+#include "import-export.hpp"
 #include "scene.hpp"
 #include "state.hpp"
 #include "tool/move-camera.hpp"
+#include "tool/sculpt/util/stroke-record.hpp"
 #include "view/configuration.hpp"
 #include "view/floor-plane.hpp"
 #include "view/gl-widget.hpp"
@@ -57,6 +62,10 @@ namespace
 
   QString filterObjFiles () { return QObject::tr ("Wavefront files (*.obj)"); }
 
+  QString filterImportFiles () { return QObject::tr ("STL and PLY files (*.stl *.ply)"); }
+
+  QString filterGlbFiles () { return QObject::tr ("glTF binary files (*.glb)"); }
+
   QString fileDialogFilters ()
   {
     return filterAllFiles () + ";;" + filterDlyFiles () + ";;" + filterObjFiles ();
@@ -77,6 +86,26 @@ namespace
     }
     return filterAllFiles ();
   }
+
+  bool recordStrokes (ViewMainWindow& mainWindow, State& state)
+  {
+    const std::string fileName =
+      QFileDialog::getSaveFileName (&mainWindow, QObject::tr ("Record sculpt strokes"),
+                                    getFileDialogPath (state.scene ()), filterAllFiles (), nullptr,
+                                    QFileDialog::DontUseNativeDialog)
+        .toStdString ();
+
+    if (fileName.empty ())
+    {
+      return false;
+    }
+    else if (state.strokeRecorder ().start (fileName, state.scene ()) == false)
+    {
+      ViewUtil::error (mainWindow, QObject::tr ("Could not record to file."));
+      return false;
+    }
+    return true;
+  }
 }
 
 void ViewMenuBar::setup (ViewMainWindow& mainWindow, ViewGlWidget& glWidget)
@@ -92,30 +121,26 @@ void ViewMenuBar::setup (ViewMainWindow& mainWindow, ViewGlWidget& glWidget)
     QString           filter = filterAllFiles ();
     const std::string fileName =
       QFileDialog::getOpenFileName (&mainWindow, QObject::tr ("Open"), getFileDialogPath (scene),
-                                    fileDialogFilters (), &filter, QFileDialog::DontUseNativeDialog)
+                                    fileDialogFilters () + ";;" + filterImportFiles (), &filter,
+                                    QFileDialog::DontUseNativeDialog)
         .toStdString ();
     if (fileName.empty () == false)
     {
 #ifndef NDEBUG
-      scene.reset ();
       glWidget.state ().history ().reset ();
+      scene.reset ();
 #else
       if (scene.isEmpty () == false) {
         if (ViewUtil::question (mainWindow, QObject::tr ("Replace existent scene?"))) {
-          scene.reset ();
           glWidget.state ().history ().reset ();
+          scene.reset ();
         }
         else {
           glWidget.state ().history ().snapshotAll (scene);
         }
       }
 #endif
-      if (scene.fromDlyFile (glWidget.state ().config (), fileName) == false)
-      {
-        ViewUtil::error (mainWindow, QObject::tr ("Could not open file."));
-      }
-      mainWindow.infoPane ().scene ().updateInfo ();
-      mainWindow.update ();
+      glWidget.state ().fromDlyFile (fileName);
     }
   });
 
@@ -162,6 +187,31 @@ void ViewMenuBar::setup (ViewMainWindow& mainWindow, ViewGlWidget& glWidget)
                }
              });
 
+  // exporting does not change the file name of the scene
+  addAction (
+    fileMenu, QObject::tr ("&Export glTF..."), QKeySequence (), [&mainWindow, &glWidget]() {
+      State&            state = glWidget.state ();
+      const std::string fileName =
+        QFileDialog::getSaveFileName (&mainWindow, QObject::tr ("Export glTF"),
+                                      getFileDialogPath (state.scene ()), filterGlbFiles (),
+                                      nullptr, QFileDialog::DontUseNativeDialog)
+          .toStdString ();
+      if (fileName.empty () == false)
+      {
+        const bool quantize = state.config ().get<bool> ("editor/export/quantize-gltf");
+
+        if (ImportExport::toGlbFile (fileName, state.scene (), quantize) == false)
+        {
+          ViewUtil::error (mainWindow, QObject::tr ("Could not export to file."));
+        }
+        else if (state.scene ().numSketchMeshes () > 0)
+        {
+          ViewUtil::info (mainWindow,
+                          QObject::tr ("Sketches are omitted when exporting glTF files."));
+        }
+      }
+    });
+
   fileMenu.addSeparator ();
 
   addAction (fileMenu, QObject::tr ("&Quit"), QKeySequence::Quit,
@@ -173,6 +223,26 @@ void ViewMenuBar::setup (ViewMainWindow& mainWindow, ViewGlWidget& glWidget)
   addAction (editMenu, QObject::tr ("&Configuration..."), QKeySequence (),
              [&mainWindow, &glWidget]() { ViewConfiguration::show (mainWindow, glWidget); });
 
+  editMenu.addSeparator ();
+
+  // strokes are recorded next to a copy of the scene, cf. `SculptStrokeRecorder`
+  QAction& recordAction =
+    addCheckableAction (editMenu, QObject::tr ("Record sculpt s&trokes..."), QKeySequence (), false,
+                        [&glWidget](bool r) {
+                          if (r == false)
+                          {
+                            glWidget.state ().strokeRecorder ().stop ();
+                          }
+                        });
+
+  QObject::connect (&recordAction, &QAction::triggered,
+                    [&mainWindow, &glWidget, &recordAction](bool r) {
+                      if (r && recordStrokes (mainWindow, glWidget.state ()) == false)
+                      {
+                        recordAction.setChecked (false);
+                      }
+                    });
+
   addAction (viewMenu, QObject::tr ("Toggle &info pane"), Qt::CTRL + Qt::Key_I, [&mainWindow]() {
     if (mainWindow.infoPane ().isVisible ())
     {
@@ -210,6 +280,31 @@ void ViewMenuBar::setup (ViewMainWindow& mainWindow, ViewGlWidget& glWidget)
                         mainWindow.update ();
                       });
 
+  addCheckableAction (viewMenu, QObject::tr ("Show frame &times"), QKeySequence (), false,
+                      [&mainWindow, &glWidget](bool a) {
+                        glWidget.showRenderProfile (a);
+                        mainWindow.update ();
+                      });
+
+  QMenu&        octreeMenu = *viewMenu.addMenu (QObject::tr ("Show &octrees"));
+  QActionGroup& octreeGroup = *new QActionGroup (&octreeMenu);
+
+  const auto addOctreeAction = [&](const QString& label, DynamicOctreeOverlay overlay) {
+    QAction& a = addCheckableAction (octreeMenu, label, QKeySequence (),
+                                     overlay == DynamicOctreeOverlay::None,
+                                     [&mainWindow, &glWidget, overlay](bool checked) {
+                                       if (checked)
+                                       {
+                                         glWidget.state ().scene ().octreeOverlay (overlay);
+                                         mainWindow.update ();
+                                       }
+                                     });
+    octreeGroup.addAction (&a);
+  };
+  addOctreeAction (QObject::tr ("&None"), DynamicOctreeOverlay::None);
+  addOctreeAction (QObject::tr ("By &visits"), DynamicOctreeOverlay::Visits);
+  addOctreeAction (QObject::tr ("By &elements"), DynamicOctreeOverlay::Elements);
+
   addAction (helpMenu, QObject::tr ("&Manual..."), QKeySequence (), [&mainWindow]() {
     if (QDesktopServices::openUrl (QUrl ("http://abau.org/dilay/manual.html")) == false)
     {
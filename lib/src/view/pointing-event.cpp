@@ -5,7 +5,6 @@
 #include <QGuiApplication>
 #include <QMouseEvent>
 #include <QTabletEvent>
-#include "config.hpp"
 #include "view/pointing-event.hpp"
 
 namespace
@@ -40,10 +39,11 @@ ViewPointingEvent::ViewPointingEvent (const QMouseEvent& event)
   , _position (glm::ivec2 (event.x (), event.y ()))
   , _prevPosition (_position)
   , _intensity (1.0f)
+  , _timestamp (Clock::now ())
 {
 }
 
-ViewPointingEvent::ViewPointingEvent (const Config& config, const QTabletEvent& event)
+ViewPointingEvent::ViewPointingEvent (float pressureIntensity, const QTabletEvent& event)
   : _modifiers (QGuiApplication::queryKeyboardModifiers ())
   , _pressEvent (event.type () == QEvent::TabletPress)
   , _moveEvent (event.type () == QEvent::TabletMove)
@@ -51,7 +51,8 @@ ViewPointingEvent::ViewPointingEvent (const Config& config, const QTabletEvent&
   , _button (fromButtons (this->_moveEvent ? event.buttons () : event.button ()))
   , _position (glm::ivec2 (event.x (), event.y ()))
   , _prevPosition (_position)
-  , _intensity (config.get<float> ("editor/tablet-pressure-intensity") * event.pressure ())
+  , _intensity (pressureIntensity * event.pressure ())
+  , _timestamp (Clock::now ())
 {
 }
 
@@ -64,6 +65,7 @@ ViewPointingEvent::ViewPointingEvent (const ViewPointingEvent& e, const glm::ive
   , _position (e._position)
   , _prevPosition (prevPos)
   , _intensity (e._intensity)
+  , _timestamp (e._timestamp)
 {
 }
 
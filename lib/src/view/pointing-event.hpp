@@ -6,17 +6,20 @@
 #define DILAY_VIEW_POINTING_EVENT
 
 #include <Qt>
+#include <chrono>
 #include <glm/glm.hpp>
 
-class Config;
 class QMouseEvent;
 class QTabletEvent;
 
 class ViewPointingEvent
 {
 public:
+  typedef std::chrono::steady_clock Clock;
+
   explicit ViewPointingEvent (const QMouseEvent&);
-  explicit ViewPointingEvent (const Config&, const QTabletEvent&);
+  // the intensity of a tablet event is its pressure scaled by the given factor
+  explicit ViewPointingEvent (float, const QTabletEvent&);
   explicit ViewPointingEvent (const ViewPointingEvent&, const glm::ivec2&);
 
   bool valid () const;
@@ -38,6 +41,9 @@ public:
 
   float intensity () const { return this->_intensity; }
 
+  // the time at which the event has been received
+  const Clock::time_point& timestamp () const { return this->_timestamp; }
+
 private:
   Qt::KeyboardModifiers _modifiers;
   bool                  _pressEvent;
@@ -47,5 +53,6 @@ private:
   glm::ivec2            _position;
   glm::ivec2            _prevPosition;
   float                 _intensity;
+  Clock::time_point     _timestamp;
 };
 #endif
@@ -82,6 +82,7 @@ struct ViewToolPane::Impl
     toolPane->setLayout (toolPaneLayout);
     this->addToolButton (ToolKey::NewMesh, toolPaneLayout, QObject::tr ("01234567890123456789"));
     this->addToolButton (ToolKey::DeleteMesh, toolPaneLayout, QObject::tr ("Delete mesh"));
+    this->addToolButton (ToolKey::SeparateMesh, toolPaneLayout, QObject::tr ("Separate mesh"));
     this->addToolButton (ToolKey::TransformMesh, toolPaneLayout, QObject::tr ("Transform mesh"));
     toolPaneLayout->addWidget (&ViewUtil::horizontalLine ());
     this->addToolButton (ToolKey::SculptDraw, toolPaneLayout, QObject::tr ("Draw"));
@@ -92,9 +93,13 @@ struct ViewToolPane::Impl
     this->addToolButton (ToolKey::SculptSmooth, toolPaneLayout, QObject::tr ("Smooth"));
     this->addToolButton (ToolKey::SculptFlatten, toolPaneLayout, QObject::tr ("Flatten"));
     this->addToolButton (ToolKey::SculptReduce, toolPaneLayout, QObject::tr ("Reduce"));
+    this->addToolButton (ToolKey::SculptMask, toolPaneLayout, QObject::tr ("Mask"));
     toolPaneLayout->addWidget (&ViewUtil::horizontalLine ());
     this->addToolButton (ToolKey::Remesh, toolPaneLayout, QObject::tr ("Remesh"));
+    this->addToolButton (ToolKey::Decimate, toolPaneLayout, QObject::tr ("Decimate"));
+    this->addToolButton (ToolKey::SubdivideMesh, toolPaneLayout, QObject::tr ("Subdivide"));
     this->addToolButton (ToolKey::TrimMesh, toolPaneLayout, QObject::tr ("Trim"));
+    this->addToolButton (ToolKey::Clay, toolPaneLayout, QObject::tr ("Clay"));
 
     toolPaneLayout->addStretch (1);
 
@@ -5,12 +5,22 @@
 #include <QCoreApplication>
 #include <iostream>
 #include "test-bitset.hpp"
+#include "test-change-journal.hpp"
 #include "test-distance.hpp"
+#include "test-edge-map.hpp"
+#include "test-faces.hpp"
+#include "test-import-export.hpp"
 #include "test-intersection.hpp"
+#include "test-isosurface-extraction.hpp"
+#include "test-kvstore.hpp"
+#include "test-layers.hpp"
 #include "test-maybe.hpp"
 #include "test-misc.hpp"
 #include "test-octree.hpp"
+#include "test-parallel.hpp"
 #include "test-prune.hpp"
+#include "test-slot-map.hpp"
+#include "test-thread-pool.hpp"
 #include "test-tree.hpp"
 
 int main ()
@@ -19,17 +29,31 @@ int main ()
 
   TestIntersection::test1 ();
   TestIntersection::test2 ();
+  TestIntersection::test3 ();
   TestMaybe::test1 ();
   TestMaybe::test2 ();
   TestMaybe::test3 ();
+  TestMaybe::test4 ();
   TestOctree::test ();
   TestBitset::test ();
   TestTree::test1 ();
   TestTree::test2 ();
   TestTree::test3 ();
+  TestTree::test4 ();
+  TestTree::test5 ();
   TestMisc::test ();
   TestDistance::test ();
   TestPrune::test ();
+  TestFaces::test ();
+  TestSlotMap::test ();
+  TestEdgeMap::test ();
+  TestKVStore::test ();
+  TestThreadPool::test ();
+  TestParallel::test ();
+  TestImportExport::test ();
+  TestChangeJournal::test ();
+  TestIsosurfaceExtraction::test ();
+  TestLayers::test ();
 
   std::cout << "all tests ran successfully\n";
   return 0;
@@ -0,0 +1,63 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <cassert>
+#include <glm/glm.hpp>
+#include <vector>
+#include "dynamic/mesh.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "test-change-journal.hpp"
+#include "util.hpp"
+
+void TestChangeJournal::test ()
+{
+  typedef std::vector<unsigned int> Indices;
+
+  DynamicMesh        mesh (MeshUtil::cube (2));
+  const unsigned int first = mesh.subscribeToChanges ();
+  const unsigned int second = mesh.subscribeToChanges ();
+  Indices            vertices, faces;
+
+  mesh.vertex (1, glm::vec3 (1.0f));
+  mesh.vertex (0, glm::vec3 (1.0f));
+  mesh.vertex (1, glm::vec3 (2.0f));
+
+  // indices are consumed sorted and without duplicates
+  const bool isConsumed1 = mesh.consumeChanges (first, vertices, faces);
+  assert (isConsumed1 && vertices == Indices ({0, 1}) && faces.empty ());
+
+  const bool isConsumed2 = mesh.consumeChanges (first, vertices, faces);
+  assert (isConsumed2 && vertices.empty () && faces.empty ());
+
+  // subscribers have their own cursors
+  mesh.deleteFace (0);
+  mesh.unsubscribeFromChanges (first);
+
+  const bool isConsumed3 = mesh.consumeChanges (second, vertices, faces);
+  assert (isConsumed3 && faces == Indices ({0}));
+  assert (std::binary_search (vertices.begin (), vertices.end (), 0));
+  assert (std::binary_search (vertices.begin (), vertices.end (), 1));
+
+  // pruning renumbers all vertices and faces
+  mesh.prune ();
+
+  const bool isConsumed4 = mesh.consumeChanges (second, vertices, faces);
+  assert (isConsumed4 == false && vertices.empty () && faces.empty ());
+
+  // copies have no subscribers
+  const DynamicMesh  copy (mesh);
+  const unsigned int third = mesh.subscribeToChanges ();
+  assert (third == first);
+
+  mesh.unsubscribeFromChanges (second);
+  mesh.unsubscribeFromChanges (third);
+
+  unused (isConsumed1);
+  unused (isConsumed2);
+  unused (isConsumed3);
+  unused (isConsumed4);
+  unused (copy);
+}
@@ -4,9 +4,13 @@
  */
 #include <glm/glm.hpp>
 #include <glm/gtc/epsilon.hpp>
+#include "cpu-dispatch.hpp"
 #include "distance.hpp"
+#include "primitive/ray.hpp"
 #include "primitive/cylinder.hpp"
+#include "primitive/triangle.hpp"
 #include "test-distance.hpp"
+#include "triangle-batch.hpp"
 #include "util.hpp"
 
 void TestDistance::test ()
@@ -31,5 +35,54 @@ void TestDistance::test ()
                              glm::sqrt ((1.5f * 1.5f) + (2.0f * 2.0f)), eps));
   assert (glm::epsilonEqual (distance (cyl, glm::vec3 (2.0f, 2.0f, 0.0f)),
                              glm::sqrt ((1.5f * 1.5f) + (1.0f * 1.0f)), eps));
+
+  const glm::vec3 v1 (0.0f, 0.0f, 0.0f);
+  const glm::vec3 v2 (2.0f, 0.0f, 0.0f);
+  const glm::vec3 v3 (0.0f, 2.0f, 0.0f);
+  const glm::vec3 v4 (3.0f, 3.0f, 1.0f);
+  TriangleBatch   batch;
+
+  const PrimTriangle tri (v1, v2, v3);
+  assert (glm::all (glm::epsilonEqual (Distance::closestPoint (tri, glm::vec3 (0.5f, 0.5f, 1.0f)),
+                                       glm::vec3 (0.5f, 0.5f, 0.0f), eps)));
+  assert (glm::all (glm::epsilonEqual (Distance::closestPoint (tri, glm::vec3 (-1.0f, -1.0f, 0.0f)),
+                                       v1, eps)));
+  assert (glm::all (glm::epsilonEqual (Distance::closestPoint (tri, glm::vec3 (2.0f, 2.0f, 0.0f)),
+                                       glm::vec3 (1.0f, 1.0f, 0.0f), eps)));
+
+  batch.add (0, v1, v2, v3);
+  batch.add (1, v2, v4, v3);
+  batch.add (2, v1, v2, v2 * 0.5f);
+
+  // the kernels of each supported instruction set are validated against the scalar distance
+  for (CpuDispatch::Isa isa : {CpuDispatch::Isa::Generic, CpuDispatch::Isa::SSE4,
+                               CpuDispatch::Isa::AVX2, CpuDispatch::Isa::AVX512})
+  {
+    if (CpuDispatch::select (isa) == false)
+    {
+      continue;
+    }
+
+    for (const glm::vec3& p :
+         {glm::vec3 (0.5f, 0.5f, 1.0f), glm::vec3 (-1.0f, -1.0f, 0.0f),
+          glm::vec3 (1.5f, 1.5f, -0.5f), glm::vec3 (1.0f, -2.0f, 0.3f),
+          glm::vec3 (4.0f, 4.0f, 4.0f), glm::vec3 (3.0f, 0.5f, 0.0f)})
+    {
+      const float expected = glm::min (distance (PrimTriangle (v1, v2, v3), p),
+                                       distance (PrimTriangle (v2, v4, v3), p));
+
+      assert (glm::epsilonEqual (batch.distance (p), expected, eps));
+      unused (expected);
+    }
+
+    const PrimRay ray (glm::vec3 (0.5f, 0.5f, 1.0f), glm::vec3 (0.0f, 0.0f, -1.0f));
+    unsigned int  index = Util::invalidIndex ();
+    float         t = 0.0f;
+    const bool    isHit = batch.intersects (ray, false, 10.0f, index, t);
+
+    assert (isHit && index == 0 && glm::epsilonEqual (t, 1.0f, eps));
+    unused (isHit);
+  }
+  CpuDispatch::select (CpuDispatch::best ());
   unused (eps);
 }
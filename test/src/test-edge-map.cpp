@@ -0,0 +1,48 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cassert>
+#include "edge-map.hpp"
+#include "test-edge-map.hpp"
+#include "util.hpp"
+
+void TestEdgeMap::test ()
+{
+  EdgeMap map;
+
+  // edges are undirected and the table grows beyond its initial number of slots
+  for (unsigned int i = 0; i < 1000; i++)
+  {
+    map.insert (i + 1, i, i);
+  }
+  assert (map.find (0, 1) == 0);
+  assert (map.find (1000, 999) == 999);
+  assert (map.find (0, 2) == Util::invalidIndex ());
+
+  bool               inserted;
+  const unsigned int existing = map.findOrInsert (500, 501, 42, inserted);
+
+  assert (existing == 500 && inserted == false);
+  unused (existing);
+
+  map.reset ();
+  assert (map.isEmpty ());
+  assert (map.contains (0, 1) == false);
+
+  const unsigned int added = map.findOrInsert (501, 500, 42, inserted);
+
+  assert (added == 42 && inserted);
+  assert (map.find (500, 501) == 42);
+  unused (added);
+
+  // sets keep their edges in the order of insertion
+  EdgeSet set;
+  set.insert (3, 1);
+  set.insert (2, 5);
+  set.insert (1, 3);
+
+  assert (set.end () - set.begin () == 2);
+  assert (*set.begin () == ui_pair (1, 3));
+  assert (set.contains (5, 2));
+}
@@ -0,0 +1,68 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <cassert>
+#include "dynamic/faces.hpp"
+#include "test-faces.hpp"
+
+namespace
+{
+  bool equals (const DynamicFaces::Container& container, const DynamicFaces::Container& expected)
+  {
+    return std::equal (container.begin (), container.end (), expected.begin (), expected.end ());
+  }
+}
+
+void TestFaces::test ()
+{
+  DynamicFaces faces;
+  assert (faces.isEmpty ());
+
+  faces.insert (7);
+  faces.insert (3);
+  faces.insert (7);
+  assert (faces.hasUncomitted ());
+  assert (faces.contains (7) == false);
+  assert (equals (faces.uncommitted (), {7, 3}));
+
+  faces.commit ();
+  assert (faces.hasUncomitted () == false);
+  assert (faces.contains (7) && faces.contains (3));
+  assert (faces.contains (5) == false && faces.contains (100) == false);
+  assert (equals (faces.indices (), {7, 3}));
+
+  faces.insert ({3, 12, 0});
+  assert (equals (faces.uncommitted (), {3, 12, 0}));
+
+  faces.commit ();
+  assert (faces.numElements () == 4);
+  assert (equals (faces.indices (), {7, 3, 12, 0}));
+
+  faces.insert (5);
+  faces.insert (4);
+  faces.filter ([](unsigned int i) { return i % 2 == 0; });
+  assert (equals (faces.indices (), {12, 0}));
+  assert (equals (faces.uncommitted (), {4}));
+  assert (faces.contains (7) == false && faces.contains (3) == false);
+
+  faces.insert (7);
+  faces.commit ();
+  assert (equals (faces.indices (), {12, 0, 4, 7}));
+
+  const DynamicFaces copy = faces;
+
+  faces.resetCommitted ();
+  assert (faces.isEmpty ());
+  assert (faces.contains (12) == false);
+  assert (copy.contains (12) && copy.numElements () == 4);
+
+  faces.insert (1);
+  faces.reset ();
+  assert (faces.isEmpty ());
+
+  faces.insert (12);
+  faces.commit ();
+  assert (equals (faces.indices (), {12}));
+}
@@ -0,0 +1,268 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QTemporaryFile>
+#include <QtEndian>
+#include <QtGlobal>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "config.hpp"
+#include "dynamic/mesh-version.hpp"
+#include "dynamic/mesh.hpp"
+#include "import-export.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "primitive/aabox.hpp"
+#include "scene.hpp"
+#include "test-import-export.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // vertices are compared as sets, since their layout is optimized when a file is read
+  std::vector<std::tuple<float, float, float>> sortedVertices (const Mesh& mesh)
+  {
+    std::vector<std::tuple<float, float, float>> vertices;
+
+    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    {
+      const glm::vec3& v = mesh.vertex (i);
+      vertices.emplace_back (v.x, v.y, v.z);
+    }
+    std::sort (vertices.begin (), vertices.end ());
+    return vertices;
+  }
+
+  template <typename T> void writeValue (std::ostream& stream, T value, bool isBigEndian)
+  {
+    char bytes[sizeof (T)];
+
+    std::memcpy (bytes, &value, sizeof (T));
+    if (isBigEndian != (Q_BYTE_ORDER == Q_BIG_ENDIAN))
+    {
+      std::reverse (bytes, bytes + sizeof (T));
+    }
+    stream.write (bytes, sizeof (T));
+  }
+
+  // each face of a binary STL file has its own corners
+  void writeStlFile (std::ostream& stream, const Mesh& mesh)
+  {
+    stream << std::string (80, ' ');
+    writeValue (stream, std::uint32_t (mesh.numIndices () / 3), false);
+
+    for (unsigned int i = 0; i < mesh.numIndices (); i++)
+    {
+      if (i % 3 == 0)
+      {
+        stream << std::string (12, '\0');
+      }
+      for (unsigned int d = 0; d < 3; d++)
+      {
+        writeValue (stream, mesh.vertex (mesh.index (i))[d], false);
+      }
+      if (i % 3 == 2)
+      {
+        stream << std::string (2, '\0');
+      }
+    }
+  }
+
+  // vertices of binary PLY files have a property that is skipped, malformed files have a NaN index
+  void writePlyFile (std::ostream& stream, const Mesh& mesh, bool isMalformed = false)
+  {
+    stream << "ply\nformat binary_big_endian 1.0\ncomment test\n"
+           << "element vertex " << mesh.numVertices ()
+           << "\nproperty float x\nproperty float y\nproperty float z\nproperty uchar flags\n"
+           << "element face " << mesh.numIndices () / 3
+           << "\nproperty list uchar " << (isMalformed ? "float" : "int")
+           << " vertex_indices\nend_header\n";
+
+    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    {
+      for (unsigned int d = 0; d < 3; d++)
+      {
+        writeValue (stream, mesh.vertex (i)[d], true);
+      }
+      writeValue (stream, std::uint8_t (0), true);
+    }
+    for (unsigned int i = 0; i < mesh.numIndices (); i++)
+    {
+      if (i % 3 == 0)
+      {
+        writeValue (stream, std::uint8_t (3), true);
+      }
+      if (isMalformed)
+      {
+        writeValue (stream,
+                    i == 0 ? std::numeric_limits<float>::quiet_NaN () : float(mesh.index (i)),
+                    true);
+      }
+      else
+      {
+        writeValue (stream, std::int32_t (mesh.index (i)), true);
+      }
+    }
+  }
+}
+
+void TestImportExport::test ()
+{
+  const Config config;
+  Scene        scene (config);
+
+  // spans several chunks of vertices and indices
+  const Mesh& original = scene.newDynamicMesh (config, MeshUtil::icosphere (7)).mesh ();
+
+  std::stringstream stream;
+  ImportExport::toDlyFile (stream, scene, false);
+
+  ImportExportContents contents;
+  const bool           isRead = contents.fromDlyFile (stream);
+
+  assert (isRead);
+  assert (contents.numMeshes () == 1);
+  assert (contents.mesh (0).numIndices () == original.numIndices ());
+  assert (sortedVertices (contents.mesh (0)) == sortedVertices (original));
+
+  const std::string  data = stream.str ();
+  std::istringstream truncated (data.substr (0, data.size () / 2));
+  const bool         isTruncatedRead = contents.fromDlyFile (truncated);
+
+  assert (isTruncatedRead == false);
+
+  // a vertex count whose number of chunks wraps around is rejected
+  std::string         corruptData = data;
+  std::uint64_t       meshOffset;
+  const std::uint32_t corruptCount = 0xffffffff;
+
+  std::memcpy (&meshOffset, &corruptData[16], sizeof (meshOffset));
+  std::memcpy (&corruptData[meshOffset], &corruptCount, sizeof (corruptCount));
+
+  std::istringstream corrupt (corruptData);
+  const bool         isCorruptRead = contents.fromDlyFile (corrupt);
+
+  assert (isCorruptRead == false);
+
+  // only the second mesh is read, which is found by the table of contents
+  const Mesh     cube = MeshUtil::cube (2);
+  glm::vec3      cubeMinimum (Util::maxFloat ());
+  QTemporaryFile file;
+
+  for (unsigned int i = 0; i < cube.numVertices (); i++)
+  {
+    cubeMinimum = glm::min (cubeMinimum, cube.vertex (i));
+  }
+  scene.newDynamicMesh (config, cube);
+
+  const bool isOpen = file.open ();
+  file.close ();
+
+  const std::string fileName = file.fileName ().toStdString ();
+  const bool        isWritten = ImportExport::toDlyFile (fileName, scene, false);
+
+  ImportExportContents selection;
+  const bool           isContentsRead = selection.tableOfContentsFromDlyFile (fileName);
+  const bool           isMeshLoaded = selection.loadMesh (1);
+
+  assert (isOpen && isWritten && isContentsRead && isMeshLoaded);
+  assert (selection.numMeshes () == 2);
+  assert (selection.numSketches () == 0);
+  assert (selection.numFaces (1) == cube.numIndices () / 3);
+  assert (selection.meshBounds (1).minimum () == cubeMinimum);
+  assert (sortedVertices (selection.mesh (1)) == sortedVertices (cube));
+
+  // corners of STL files and vertices of PLY files are welded
+  std::stringstream stlStream, plyStream;
+  writeStlFile (stlStream, cube);
+  writePlyFile (plyStream, cube);
+
+  ImportExportContents stl, ply;
+  const bool           isStlRead = stl.fromDlyFile (stlStream);
+  const bool           isPlyRead = ply.fromDlyFile (plyStream);
+
+  assert (isStlRead && isPlyRead);
+  assert (stl.isImportedFile () && ply.isImportedFile ());
+  assert (stl.numMeshes () == 1 && ply.numMeshes () == 1);
+  assert (stl.mesh (0).numIndices () == cube.numIndices ());
+  assert (sortedVertices (stl.mesh (0)) == sortedVertices (cube));
+  assert (sortedVertices (ply.mesh (0)) == sortedVertices (cube));
+
+  // NaN indices of PLY faces are out of bounds
+  std::stringstream malformedPlyStream;
+  writePlyFile (malformedPlyStream, cube, true);
+
+  ImportExportContents malformedPly;
+  const bool           isMalformedPlyRead = malformedPly.fromDlyFile (malformedPlyStream);
+
+  assert (isMalformedPlyRead == false);
+
+  // readers of a revision share its version, which is not affected by later modifications
+  DynamicMesh                                     dynamicCube (cube);
+  const std::shared_ptr<const DynamicMeshVersion> version = dynamicCube.version ();
+  const glm::vec3                                 vertex = cube.vertex (0);
+
+  assert (dynamicCube.version () == version);
+  dynamicCube.vertex (0, vertex + glm::vec3 (1.0f));
+  assert (dynamicCube.version () != version);
+  assert (version->mesh.vertex (0) == vertex);
+
+  // the length in the header of a glTF file is its size, which quantization reduces
+  std::stringstream glbStream, quantizedGlbStream;
+  ImportExport::toGlbFile (glbStream, scene, false);
+  ImportExport::toGlbFile (quantizedGlbStream, scene, true);
+
+  const std::string glb = glbStream.str ();
+  const std::string quantizedGlb = quantizedGlbStream.str ();
+  std::uint32_t     glbLength = 0;
+
+  std::memcpy (&glbLength, glb.data () + 8, sizeof (std::uint32_t));
+  assert (glb.compare (0, 4, "glTF") == 0);
+  assert (qFromLittleEndian (glbLength) == glb.size ());
+  assert (quantizedGlb.size () < glb.size ());
+  assert (quantizedGlb.find ("KHR_mesh_quantization") != std::string::npos);
+
+  // meshes with cached adjacency and octree are restored without rebuilding them
+  std::stringstream cachedStream;
+  ImportExport::toDlyFile (cachedStream, scene, false, 1);
+
+  ImportExportContents cached;
+  const bool           isCachedRead = cached.fromDlyFile (cachedStream);
+
+  assert (isCachedRead);
+  assert (cached.numMeshes () == 2);
+
+  const DynamicMesh restoredCube = cached.dynamicMesh (1);
+  unsigned int      sumValences = 0;
+
+  for (unsigned int i = 0; i < restoredCube.numVertices (); i++)
+  {
+    sumValences += restoredCube.valence (i);
+  }
+  assert (restoredCube.numFaces () == cube.numIndices () / 3);
+  assert (sumValences == cube.numIndices ());
+  assert (sortedVertices (restoredCube.mesh ()) == sortedVertices (cube));
+
+  unused (isRead);
+  unused (isTruncatedRead);
+  unused (isCorruptRead);
+  unused (isOpen);
+  unused (isWritten);
+  unused (isContentsRead);
+  unused (isMeshLoaded);
+  unused (isStlRead);
+  unused (isPlyRead);
+  unused (isMalformedPlyRead);
+  unused (isCachedRead);
+  unused (sortedVertices);
+  unused (sumValences);
+}
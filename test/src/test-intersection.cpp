@@ -3,6 +3,7 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <glm/glm.hpp>
+#include <vector>
 #include "intersection.hpp"
 #include "primitive/aabox.hpp"
 #include "primitive/cone.hpp"
@@ -12,6 +13,7 @@
 #include "primitive/sphere.hpp"
 #include "primitive/triangle.hpp"
 #include "test-intersection.hpp"
+#include "triangle-batch.hpp"
 #include "util.hpp"
 
 void TestIntersection::test1 ()
@@ -117,3 +119,67 @@ void TestIntersection::test2 ()
   assert (i2.position () == glm::vec3 (2.0f));
   assert (i2.normal () == glm::vec3 (2.0f));
 }
+
+void TestIntersection::test3 ()
+{
+  TriangleBatch          batch;
+  std::vector<glm::vec3> vertices;
+
+  for (unsigned int i = 0; i < 11; i++)
+  {
+    const float z = float(i) - 5.0f;
+
+    // every other triangle faces away from the rays
+    vertices.emplace_back (-1.0f, -1.0f, z);
+    vertices.emplace_back (i % 2 == 0 ? glm::vec3 (2.0f, -1.0f, z) : glm::vec3 (-1.0f, 2.0f, z));
+    vertices.emplace_back (i % 2 == 0 ? glm::vec3 (-1.0f, 2.0f, z) : glm::vec3 (2.0f, -1.0f, z));
+
+    batch.add (i, vertices[(3 * i) + 0], vertices[(3 * i) + 1], vertices[(3 * i) + 2]);
+  }
+  assert (batch.numTriangles () == 11);
+
+  const glm::vec3 down (0.0f, 0.0f, -1.0f);
+  const PrimRay   rays[] = {PrimRay (glm::vec3 (0.1f, 0.1f, 10.0f), down),
+                          PrimRay (glm::vec3 (0.1f, 0.1f, 0.5f), down),
+                          PrimRay (true, glm::vec3 (0.1f, 0.1f, 0.5f), down),
+                          PrimRay (glm::vec3 (0.1f, 0.1f, -10.0f), -down),
+                          PrimRay (glm::vec3 (1.5f, 1.5f, 10.0f), down)};
+
+  for (const PrimRay& ray : rays)
+  {
+    for (bool bothSides : {false, true})
+    {
+      unsigned int expectedIndex = Util::invalidIndex ();
+      float        expectedT = Util::maxFloat ();
+
+      for (unsigned int i = 0; i < batch.numTriangles (); i++)
+      {
+        const PrimTriangle tri (vertices[(3 * i) + 0], vertices[(3 * i) + 1],
+                                vertices[(3 * i) + 2]);
+        float              t;
+
+        if (IntersectionUtil::intersects (ray, tri, bothSides, &t) && t < expectedT)
+        {
+          expectedIndex = i;
+          expectedT = t;
+        }
+      }
+
+      unsigned int index;
+      float        t;
+
+      if (batch.intersects (ray, bothSides, Util::maxFloat (), index, t))
+      {
+        assert (index == expectedIndex);
+        assert (glm::abs (t - expectedT) < Util::epsilon ());
+        assert (batch.intersects (ray, bothSides, t, index, t) == false);
+      }
+      else
+      {
+        assert (expectedIndex == Util::invalidIndex ());
+      }
+    }
+  }
+  batch.reset ();
+  assert (batch.numTriangles () == 0);
+}
@@ -9,6 +9,7 @@ namespace TestIntersection
 {
   void test1 ();
   void test2 ();
+  void test3 ();
 }
 
 #endif
@@ -0,0 +1,228 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cassert>
+#include <glm/glm.hpp>
+#include <sstream>
+#include "dynamic/faces.hpp"
+#include "dynamic/mesh-winding-number.hpp"
+#include "dynamic/mesh.hpp"
+#include "isosurface-extraction.hpp"
+#include "isosurface-extraction/grid.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/plane.hpp"
+#include "test-isosurface-extraction.hpp"
+#include "thread-pool.hpp"
+#include "util.hpp"
+
+namespace
+{
+  typedef IsosurfaceExtractionGrid::SampleFormat SampleFormat;
+
+  const float resolution = 0.1f;
+
+  const IsosurfaceExtraction::DistanceCallback sphereDistance = [](const glm::vec3& pos, float) {
+    return glm::length (pos) - 1.0f;
+  };
+
+  // returns the largest distance of the vertices of a unit sphere's isosurface from the sphere
+  float extractSphere (SampleFormat format, DynamicMesh& mesh)
+  {
+    IsosurfaceExtractionGrid::defaultSampleFormat (format);
+
+    const bool isExtracted = IsosurfaceExtraction::extract (
+      sphereDistance, PrimAABox (glm::vec3 (-1.0f), glm::vec3 (1.0f)), resolution, mesh);
+
+    assert (isExtracted);
+    unused (isExtracted);
+
+    float maxError = 0.0f;
+    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    {
+      maxError = glm::max (maxError, glm::abs (glm::length (mesh.vertex (i)) - 1.0f));
+    }
+    return maxError;
+  }
+
+  bool isBitIdentical (const Mesh& m1, const Mesh& m2)
+  {
+    if (m1.numVertices () != m2.numVertices () || m1.numIndices () != m2.numIndices ())
+    {
+      return false;
+    }
+    for (unsigned int i = 0; i < m1.numVertices (); i++)
+    {
+      if (m1.vertex (i) != m2.vertex (i) || m1.normal (i) != m2.normal (i))
+      {
+        return false;
+      }
+    }
+    for (unsigned int i = 0; i < m1.numIndices (); i++)
+    {
+      if (m1.index (i) != m2.index (i))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+void TestIsosurfaceExtraction::test ()
+{
+  const SampleFormat defaultFormat = IsosurfaceExtractionGrid::defaultSampleFormat ();
+  DynamicMesh        reference;
+  const float        referenceError = extractSphere (SampleFormat::Float32, reference);
+
+  // extractions do not depend on the number of threads
+  DynamicMesh serialMesh;
+  {
+    ThreadPool::SerialScope serial;
+    extractSphere (SampleFormat::Float32, serialMesh);
+  }
+  assert (isBitIdentical (reference.mesh (), serialMesh.mesh ()));
+
+  // compact formats keep the signs of all samples and thereby the topology of the isosurface
+  for (SampleFormat format : {SampleFormat::Float16, SampleFormat::Narrow16, SampleFormat::Narrow8})
+  {
+    DynamicMesh mesh;
+    const float error = extractSphere (format, mesh);
+
+    assert (mesh.numVertices () == reference.numVertices ());
+    assert (mesh.numFaces () == reference.numFaces ());
+    assert (error < referenceError + (0.05f * resolution));
+    unused (error);
+  }
+
+  // marks are stored exactly
+  IsosurfaceExtractionGrid::defaultSampleFormat (SampleFormat::Narrow8);
+
+  IsosurfaceExtractionGrid grid (PrimAABox (glm::vec3 (0.0f), glm::vec3 (1.0f)), resolution);
+
+  assert (grid.sample (0) == Util::maxFloat ());
+  grid.sample (0, IsosurfaceExtractionGrid::markInsideToSample);
+  assert (grid.sample (0) == IsosurfaceExtractionGrid::markInsideToSample);
+  grid.sample (0, -0.0001f);
+  assert (grid.sample (0) < 0.0f);
+  grid.sample (0, 1000.0f);
+  assert (grid.sample (0) > 0.0f);
+
+  IsosurfaceExtractionGrid::defaultSampleFormat (defaultFormat);
+
+  // resolutions that are estimated for a number of faces roughly yield that number
+  const PrimAABox    sphereBounds (glm::vec3 (-1.0f), glm::vec3 (1.0f));
+  const unsigned int numFaces = 20000;
+  float              budgetResolution = 0.0f;
+  DynamicMesh        budgetMesh;
+
+  const bool isEstimated = IsosurfaceExtraction::resolutionForFaces (
+    [&sphereBounds](float r, DynamicMesh& mesh) {
+      return IsosurfaceExtraction::extract (sphereDistance, sphereBounds, r, mesh);
+    },
+    sphereBounds, numFaces, budgetResolution);
+  const bool isBudgetExtracted =
+    IsosurfaceExtraction::extract (sphereDistance, sphereBounds, budgetResolution, budgetMesh);
+
+  assert (isEstimated && isBudgetExtracted);
+  assert (budgetMesh.numFaces () > (numFaces * 3) / 4);
+  assert (budgetMesh.numFaces () < (numFaces * 5) / 4);
+
+  // symmetric extractions pair each vertex with its reflection
+  const PrimPlane plane (glm::vec3 (0.0f), glm::vec3 (1.0f, 0.0f, 0.0f));
+  DynamicMesh     symmetricMesh;
+
+  const bool isSymmetricExtracted = IsosurfaceExtraction::extractSymmetric (
+    sphereDistance, sphereBounds, resolution, plane, symmetricMesh);
+
+  assert (isSymmetricExtracted);
+  assert (symmetricMesh.isEmpty () == false);
+  assert (symmetricMesh.hasSymmetry (plane));
+
+  symmetricMesh.forEachVertex ([&symmetricMesh, &plane](unsigned int i) {
+    const unsigned int j = symmetricMesh.symmetricVertex (i);
+
+    assert (j != Util::invalidIndex ());
+    assert (glm::distance (plane.mirror (symmetricMesh.vertex (i)), symmetricMesh.vertex (j)) <
+            Util::epsilon ());
+    unused (j);
+  });
+
+  // a vertex that is moved without its reflection is unpaired when its faces are mirrored
+  unsigned int asymmetric = Util::invalidIndex ();
+  symmetricMesh.forEachVertex ([&symmetricMesh, &asymmetric](unsigned int i) {
+    if (asymmetric == Util::invalidIndex () && symmetricMesh.symmetricVertex (i) != i)
+    {
+      asymmetric = i;
+    }
+  });
+  assert (asymmetric != Util::invalidIndex ());
+
+  DynamicFaces asymmetricFaces;
+  DynamicFaces mirroredFaces;
+
+  symmetricMesh.vertex (asymmetric, symmetricMesh.vertex (asymmetric) * 1.1f);
+  for (unsigned int f : symmetricMesh.adjacentFaces (asymmetric))
+  {
+    asymmetricFaces.insert (f);
+  }
+  asymmetricFaces.commit ();
+
+  const bool isMirrored = symmetricMesh.symmetricFaces (asymmetricFaces, mirroredFaces);
+
+  assert (isMirrored == false);
+  assert (symmetricMesh.symmetricVertex (asymmetric) == Util::invalidIndex ());
+  unused (isMirrored);
+
+  // bricks that are sampled separately and gathered make the same mesh as a single extraction
+  const unsigned int numBricks = 3;
+  DynamicMesh        brickMesh;
+  std::stringstream  brickStream;
+  bool               isGathered = true;
+
+  for (unsigned int i = 0; i < numBricks; i++)
+  {
+    IsosurfaceExtractionGrid brickGrid (sphereBounds, resolution);
+    glm::uvec3               begin, end;
+
+    IsosurfaceExtraction::brickRange (brickGrid, i, numBricks, begin, end);
+    isGathered = isGathered &&
+                 IsosurfaceExtraction::sampleBrick (sphereDistance, brickGrid, i, numBricks);
+    brickGrid.writeSamples (brickStream, begin, end);
+  }
+
+  IsosurfaceExtractionGrid gatheredGrid (sphereBounds, resolution);
+
+  for (unsigned int i = 0; i < numBricks; i++)
+  {
+    glm::uvec3 begin, end;
+
+    IsosurfaceExtraction::brickRange (gatheredGrid, i, numBricks, begin, end);
+    isGathered = isGathered && gatheredGrid.readSamples (brickStream, begin, end);
+  }
+  gatheredGrid.makeMesh (brickMesh);
+
+  assert (isGathered);
+  assert (isBitIdentical (reference.mesh (), brickMesh.mesh ()));
+
+  // winding numbers classify positions even if the mesh has a hole
+  Mesh sphere = MeshUtil::icosphere (3);
+  sphere.shrinkIndices (sphere.numIndices () - 3);
+
+  const DynamicMesh              holeySphere (sphere);
+  const DynamicMeshWindingNumber windingNumber (holeySphere);
+
+  assert (windingNumber.isInside (glm::vec3 (0.0f)));
+  assert (windingNumber.isInside (glm::vec3 (0.0f, 0.5f, 0.0f)));
+  assert (windingNumber.isInside (glm::vec3 (2.0f, 0.0f, 0.0f)) == false);
+  assert (glm::abs (windingNumber.windingNumber (glm::vec3 (0.0f, 0.0f, 3.0f))) < 0.01f);
+
+  unused (referenceError);
+  unused (isSymmetricExtracted);
+  unused (isEstimated);
+  unused (isBudgetExtracted);
+  unused (isGathered);
+  unused (isBitIdentical);
+}
@@ -0,0 +1,64 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+#include "kvstore.hpp"
+#include "test-kvstore.hpp"
+#include "util.hpp"
+
+void TestKVStore::test ()
+{
+  const KVStore::Key widthKey = KVStore::key ("test", "window/width");
+  const KVStore::Key heightKey = KVStore::key ("test", "window/height");
+
+  assert (widthKey != heightKey);
+  assert (KVStore::key ("test", "/test/window/width") == widthKey);
+
+  KVStore                   store ("test");
+  KVStore                   other ("test");
+  std::vector<KVStore::Key> changed;
+
+  assert (store.key ("window/width") == widthKey);
+
+  const unsigned int id =
+    store.subscribe ([&changed](KVStore::Key key) { changed.push_back (key); });
+
+  store.set<int> ("window/width", 1024);
+  store.set<int> (heightKey, 768);
+  assert (store.get<int> (widthKey) == 1024);
+  assert (store.get<int> ("window/height") == 768);
+  assert (store.get<int> ("window/depth", 42) == 42);
+  assert (changed.size () == 2 && changed[0] == widthKey && changed[1] == heightKey);
+
+  bool threw = false;
+  try
+  {
+    unused (other.get<int> (widthKey));
+  }
+  catch (std::runtime_error&)
+  {
+    threw = true;
+  }
+  assert (threw);
+
+  const int& width = store.get<int> (widthKey);
+  for (unsigned int i = 0; i < 1000; i++)
+  {
+    store.set<bool> ("flag-" + std::to_string (i), true);
+  }
+  assert (width == 1024);
+
+  store.unsubscribe (id);
+  changed.clear ();
+
+  store.remove ("window/width");
+  assert (store.get<int> (widthKey, 0) == 0);
+  assert (store.get<int> (heightKey) == 768);
+
+  store.reset ();
+  assert (store.get<int> (heightKey, 0) == 0);
+  assert (changed.empty ());
+}
@@ -0,0 +1,67 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cassert>
+#include <glm/glm.hpp>
+#include "dynamic/mesh-layers.hpp"
+#include "dynamic/mesh.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "test-layers.hpp"
+#include "util.hpp"
+
+namespace
+{
+  bool isNear (const glm::vec3& a, const glm::vec3& b)
+  {
+    return glm::distance (a, b) < Util::epsilon ();
+  }
+}
+
+void TestLayers::test ()
+{
+  DynamicMesh        mesh (MeshUtil::cube (2));
+  const glm::vec3    origin = mesh.vertex (0);
+  const glm::vec3    offset (1.0f, 0.0f, 0.0f);
+  const unsigned int layer = mesh.addLayer ();
+
+  // modifications are added to the layer when recording stops
+  mesh.recordLayer (layer);
+  mesh.vertex (0, origin + offset);
+  mesh.recordLayer (Util::invalidIndex ());
+  assert (isNear (mesh.layers ().displacement (layer, 0), offset));
+  assert (mesh.layers ().displacement (layer, 1) == glm::vec3 (0.0f));
+
+  // disabled layers do not displace vertices and keep their displacements
+  mesh.enableLayer (layer, false);
+  assert (isNear (mesh.vertex (0), origin));
+
+  mesh.layerStrength (layer, 0.5f);
+  assert (isNear (mesh.vertex (0), origin));
+
+  mesh.enableLayer (layer, true);
+  assert (isNear (mesh.vertex (0), origin + (0.5f * offset)));
+
+  // deltas restore strengths and positions
+  DynamicMeshDelta delta;
+  mesh.recordDelta (&delta);
+  mesh.layerStrength (layer, 2.0f);
+  mesh.recordDelta (nullptr);
+  assert (isNear (mesh.vertex (0), origin + (2.0f * offset)));
+
+  mesh.applyDelta (delta);
+  assert (mesh.layers ().strength (layer) == 0.5f);
+  assert (isNear (mesh.vertex (0), origin + (0.5f * offset)));
+
+  // copies keep their layers
+  DynamicMesh copy (mesh);
+  copy.enableLayer (layer, false);
+  assert (isNear (copy.vertex (0), origin));
+  assert (isNear (mesh.vertex (0), origin + (0.5f * offset)));
+
+  // applying a layer keeps the positions of its vertices
+  mesh.applyLayer (layer);
+  assert (mesh.layers ().numLayers () == 0);
+  assert (isNear (mesh.vertex (0), origin + (0.5f * offset)));
+}
@@ -89,3 +89,35 @@ void TestMaybe::test3 ()
   assert (m2.hasValue ());
   assert (*m2 == 5);
 }
+
+void TestMaybe::test4 ()
+{
+  InlineMaybe<int> m1 (5);
+
+  assert (m1.hasValue ());
+  assert (*m1 == 5);
+
+  InlineMaybe<int> m2 (m1);
+
+  assert (*m1 == 5);
+  assert (*m2 == 5);
+
+  m2 = 12;
+  m1 = m2;
+
+  assert (*m1 == 12);
+
+  m2.reset ();
+  m1 = m2;
+
+  assert (m1.hasValue () == false);
+  assert (m1 == false);
+
+  InlineMaybe<Foo> m3 = InlineMaybe<Foo>::make (7);
+  InlineMaybe<Foo> m4 (std::move (m3));
+
+  assert (m4->data () == 7);
+
+  m4.emplace (8);
+  assert (m4->data () == 8);
+}
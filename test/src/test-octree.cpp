@@ -5,10 +5,20 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <array>
 #include <random>
+#include <vector>
+#include "distance.hpp"
 #include "dynamic/octree.hpp"
+#include "intersection.hpp"
+#include "primitive/convex-polytope.hpp"
+#include "primitive/plane.hpp"
+#include "primitive/ray.hpp"
+#include "primitive/sphere.hpp"
 #include "primitive/triangle.hpp"
 #include "test-octree.hpp"
+#include "util.hpp"
 
 void TestOctree::test ()
 {
@@ -23,6 +33,8 @@ void TestOctree::test ()
   std::uniform_real_distribution<float> scaleD (0.00001f, 10.0f);
   std::uniform_real_distribution<float> twoPiD (0.0f, 2.0f * glm::pi<float> ());
 
+  std::vector<std::array<glm::vec3, 3>> triangles;
+
   for (unsigned int i = 0; i < numSamples; i++)
   {
     const glm::vec3 m1 (-1.0f, 0.0f, 0.0f);
@@ -46,9 +58,237 @@ void TestOctree::test ()
     const PrimTriangle tri = PrimTriangle (w1, w2, w3);
 
     octree.addElement (i, tri.center (), tri.maxDimExtent ());
+    triangles.push_back ({w1, w2, w3});
   }
+
+  const auto distance = [&triangles](unsigned int i, const glm::vec3& p) {
+    return Distance::distance (PrimTriangle (triangles[i][0], triangles[i][1], triangles[i][2]), p);
+  };
+
+  const auto checkDistances = [&triangles, &posD, &gen, &distance](const DynamicOctree& o) {
+    for (unsigned int i = 0; i < 100; i++)
+    {
+      const glm::vec3 p (posD (gen), posD (gen), posD (gen));
+      float           minDistance = Util::maxFloat ();
+
+      for (unsigned int j = 0; j < triangles.size (); j++)
+      {
+        minDistance = glm::min (minDistance, distance (j, p));
+      }
+      const auto getDistance = [&p, &distance](const std::vector<unsigned int>& is) {
+        float nearest = Util::maxFloat ();
+        for (unsigned int j : is)
+        {
+          nearest = glm::min (nearest, distance (j, p));
+        }
+        return nearest;
+      };
+      const float d = o.distance (p, getDistance);
+      const float dBounded = o.distance (p, minDistance + 1.0f, getDistance);
+      const float dTooSmall = o.distance (p, minDistance * 0.5f, getDistance);
+
+      assert (d == minDistance);
+      assert (dBounded == minDistance);
+      assert (dTooSmall == minDistance * 0.5f);
+      unused (d);
+      unused (dBounded);
+      unused (dTooSmall);
+    }
+  };
+  checkDistances (octree);
+
+  const auto intersects = [&triangles](const PrimRay& ray, unsigned int i) {
+    const PrimTriangle tri (triangles[i][0], triangles[i][1], triangles[i][2]);
+    float              t;
+    return IntersectionUtil::intersects (ray, tri, true, &t) ? t : Util::maxFloat ();
+  };
+
+  const auto checkRays = [&posD, &gen, &intersects](const DynamicOctree& o) {
+    const glm::vec3      dir = glm::normalize (glm::vec3 (0.1f, 0.2f, 1.0f));
+    std::vector<PrimRay> rays;
+
+    for (unsigned int i = 0; i < 64; i++)
+    {
+      rays.emplace_back (glm::vec3 (posD (gen), posD (gen), -20.0f), dir);
+    }
+
+    std::vector<float> packetDistances (rays.size (), Util::maxFloat ());
+    o.intersects (rays.data (), rays.size (),
+                  [&rays, &packetDistances, &intersects](const std::vector<unsigned int>& is,
+                                                         const unsigned int* rs, unsigned int n,
+                                                         float* distances) {
+                    for (unsigned int j = 0; j < n; j++)
+                    {
+                      for (unsigned int i : is)
+                      {
+                        distances[rs[j]] = glm::min (distances[rs[j]], intersects (rays[rs[j]], i));
+                      }
+                      packetDistances[rs[j]] = distances[rs[j]];
+                    }
+                  });
+
+    for (unsigned int r = 0; r < rays.size (); r++)
+    {
+      float distance = Util::maxFloat ();
+      o.intersects (rays[r],
+                    [&rays, r, &distance, &intersects](const std::vector<unsigned int>& is) {
+                      for (unsigned int i : is)
+                      {
+                        distance = glm::min (distance, intersects (rays[r], i));
+                      }
+                      return distance;
+                    });
+      assert (distance == packetDistances[r]);
+      unused (distance);
+    }
+  };
+  checkRays (octree);
+
+  const auto checkSpheres = [&posD, &scaleD, &gen](const DynamicOctree& o) {
+    using Elements = std::vector<std::pair<bool, unsigned int>>;
+
+    for (unsigned int i = 0; i < 20; i++)
+    {
+      const PrimSphere sphere1 (glm::vec3 (posD (gen), posD (gen), posD (gen)), scaleD (gen));
+      const PrimSphere sphere2 (glm::vec3 (posD (gen), posD (gen), posD (gen)), scaleD (gen));
+
+      Elements elements1, elements2, jointElements1, jointElements2;
+
+      o.intersects (sphere1,
+                    [&elements1](bool c, unsigned int e) { elements1.emplace_back (c, e); });
+      o.intersects (sphere2,
+                    [&elements2](bool c, unsigned int e) { elements2.emplace_back (c, e); });
+      o.intersects (sphere1, sphere2,
+                    [&jointElements1, &jointElements2](unsigned int s, bool c, unsigned int e) {
+                      (s == 0 ? jointElements1 : jointElements2).emplace_back (c, e);
+                    });
+
+      for (Elements* elements : {&elements1, &elements2, &jointElements1, &jointElements2})
+      {
+        std::sort (elements->begin (), elements->end ());
+      }
+      assert (elements1 == jointElements1);
+      assert (elements2 == jointElements2);
+    }
+  };
+  checkSpheres (octree);
+
+  const auto checkPolytopes = [&triangles, &posD, &unitD, &gen](const DynamicOctree& o) {
+    for (unsigned int i = 0; i < 20; i++)
+    {
+      const glm::vec3    center (posD (gen), posD (gen), posD (gen));
+      PrimConvexPolytope polytope;
+
+      for (unsigned int j = 0; j < 4; j++)
+      {
+        const glm::vec3 n =
+          glm::normalize (glm::vec3 (unitD (gen), unitD (gen), unitD (gen)) - glm::vec3 (0.5f));
+        polytope.addPlane (PrimPlane (center + (n * 4.0f * unitD (gen)), n));
+        polytope.addPlane (PrimPlane (center - (n * 4.0f * unitD (gen)), -n));
+      }
+
+      std::vector<bool> isReported (triangles.size (), false);
+      o.intersects (polytope, [&triangles, &polytope, &isReported](bool c, unsigned int e) {
+        const PrimTriangle tri (triangles[e][0], triangles[e][1], triangles[e][2]);
+        assert (c == false || polytope.contains (tri));
+        unused (tri);
+        isReported[e] = true;
+      });
+
+      for (unsigned int j = 0; j < triangles.size (); j++)
+      {
+        const PrimTriangle tri (triangles[j][0], triangles[j][1], triangles[j][2]);
+        assert (isReported[j] || IntersectionUtil::intersects (polytope, tri) == false);
+        unused (tri);
+      }
+    }
+  };
+  checkPolytopes (octree);
+
+  std::vector<unsigned int> indices;
+  std::vector<glm::vec3>    positions;
+  std::vector<float>        maxDimExtents;
+
+  for (unsigned int i = 0; i < numSamples; i++)
+  {
+    const PrimTriangle tri (triangles[i][0], triangles[i][1], triangles[i][2]);
+    indices.push_back (i);
+    positions.push_back (tri.center ());
+    maxDimExtents.push_back (tri.maxDimExtent ());
+  }
+  DynamicOctree built;
+  built.build (indices, positions, maxDimExtents);
+  checkDistances (built);
+  checkRays (built);
+  checkSpheres (built);
+  checkPolytopes (built);
+
+  for (unsigned int i = 0; i < numSamples; i++)
+  {
+    built.deleteElement (i);
+  }
+  built.deleteEmptyChildren ();
+  assert (built.hasRoot () == false);
+
+  DynamicOctree copy (octree);
+  checkDistances (copy);
+
+  for (unsigned int i = 0; i < numSamples; i += 2)
+  {
+    const glm::vec3 offset (posD (gen), posD (gen), posD (gen));
+
+    for (glm::vec3& v : triangles[i])
+    {
+      v += offset;
+    }
+    const PrimTriangle tri (triangles[i][0], triangles[i][1], triangles[i][2]);
+    copy.realignElement (i, tri.center (), tri.maxDimExtent ());
+  }
+  checkDistances (copy);
+  checkRays (copy);
+
+  indices.clear ();
+  positions.clear ();
+  maxDimExtents.clear ();
+  for (unsigned int i = 0; i < numSamples; i += 2)
+  {
+    const PrimTriangle tri (triangles[i][0], triangles[i][1], triangles[i][2]);
+    indices.push_back (i);
+    positions.push_back (tri.center ());
+    maxDimExtents.push_back (tri.maxDimExtent ());
+  }
+  octree.realignElements (indices, positions, maxDimExtents);
+  checkDistances (octree);
+
+  std::uniform_real_distribution<float> smallOffsetD (-0.1f, 0.1f);
+  indices.clear ();
+  positions.clear ();
+  maxDimExtents.clear ();
+  for (unsigned int i = 1; i < 100; i += 2)
+  {
+    const glm::vec3 offset (smallOffsetD (gen), smallOffsetD (gen), smallOffsetD (gen));
+
+    for (glm::vec3& v : triangles[i])
+    {
+      v += offset;
+    }
+    const PrimTriangle tri (triangles[i][0], triangles[i][1], triangles[i][2]);
+    indices.push_back (i);
+    positions.push_back (tri.center ());
+    maxDimExtents.push_back (tri.maxDimExtent ());
+  }
+  octree.realignElements (indices, positions, maxDimExtents);
+  copy.realignElements (indices, positions, maxDimExtents);
+  checkDistances (octree);
+  checkDistances (copy);
+
   for (unsigned int i = 0; i < numSamples; i++)
   {
     octree.deleteElement (i);
+    copy.deleteElement (i);
   }
+  octree.deleteEmptyChildren ();
+  copy.deleteEmptyChildren ();
+  assert (octree.hasRoot () == false);
+  assert (copy.hasRoot () == false);
 }
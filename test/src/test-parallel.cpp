@@ -0,0 +1,100 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <random>
+#include <vector>
+#include "parallel.hpp"
+#include "test-parallel.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // small chunks, such that the inputs of the test are split into many of them
+  constexpr unsigned int chunkSize = 100;
+  constexpr unsigned int n = 10007;
+}
+
+void TestParallel::test ()
+{
+  std::default_random_engine                  gen;
+  std::uniform_int_distribution<unsigned int> valueD (0, 1000);
+  std::vector<unsigned int>                   values (n);
+
+  for (unsigned int& v : values)
+  {
+    v = valueD (gen);
+  }
+
+  unsigned int serialSum = 0;
+  for (unsigned int v : values)
+  {
+    serialSum += v;
+  }
+
+  const unsigned int sum = Parallel::reduce (
+    n, 0u, [&values](unsigned int i) { return values[i]; },
+    [](unsigned int a, unsigned int b) { return a + b; }, chunkSize);
+  assert (sum == serialSum);
+
+  const unsigned int maximum = Parallel::reduce (
+    n, 0u, [&values](unsigned int i) { return values[i]; },
+    [](unsigned int a, unsigned int b) { return std::max (a, b); }, chunkSize);
+  assert (maximum == *std::max_element (values.begin (), values.end ()));
+
+  std::vector<unsigned int> scanned (values);
+  const unsigned int        total = Parallel::exclusiveScan (scanned, chunkSize);
+
+  assert (total == serialSum);
+  for (unsigned int i = 0, s = 0; i < n; s += values[i], i++)
+  {
+    assert (scanned[i] == s);
+  }
+
+  // pairs of values and their indices show whether the sort is stable
+  std::vector<ui_pair> pairs (n);
+  for (unsigned int i = 0; i < n; i++)
+  {
+    pairs[i] = ui_pair (values[i] % 100, i);
+  }
+  std::vector<ui_pair> sorted (pairs);
+
+  Parallel::sort (sorted,
+                  [](const ui_pair& a, const ui_pair& b) { return a.first < b.first; },
+                  chunkSize);
+  std::stable_sort (pairs.begin (), pairs.end (),
+                    [](const ui_pair& a, const ui_pair& b) { return a.first < b.first; });
+  assert (sorted == pairs);
+
+  std::vector<unsigned int> pruned (values);
+  std::vector<unsigned int> indexMap;
+
+  Parallel::prune (pruned, [](unsigned int v) { return v % 3 == 0; }, &indexMap, chunkSize);
+
+  assert (indexMap.size () == n);
+  for (unsigned int i = 0, k = 0; i < n; i++)
+  {
+    if (values[i] % 3 == 0)
+    {
+      assert (indexMap[i] == Util::invalidIndex ());
+    }
+    else
+    {
+      assert (indexMap[i] == k);
+      assert (pruned[k] == values[i]);
+      k++;
+    }
+  }
+
+  std::vector<unsigned int> empty;
+  Parallel::prune (empty, [](unsigned int) { return true; }, &indexMap);
+  assert (empty.empty () && indexMap.empty ());
+  assert (Parallel::exclusiveScan (empty) == 0);
+
+  unused (sum);
+  unused (maximum);
+  unused (total);
+}
@@ -0,0 +1,67 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cassert>
+#include <string>
+#include <vector>
+#include "slot-map.hpp"
+#include "test-slot-map.hpp"
+#include "util.hpp"
+
+namespace
+{
+  bool equals (const SlotMap<std::string>& map, const std::vector<std::string>& expected)
+  {
+    if (map.size () != expected.size ())
+    {
+      return false;
+    }
+    for (unsigned int i = 0; i < map.size (); i++)
+    {
+      if (map[i] != expected[i])
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+void TestSlotMap::test ()
+{
+  SlotMap<std::string>      map;
+  std::vector<std::string*> elements;
+
+  for (unsigned int i = 0; i < 40; i++)
+  {
+    elements.push_back (&map.emplace (std::to_string (i)));
+  }
+  assert (map.size () == 40);
+  assert (&map[17] == elements[17]);
+
+  map.erase (*elements[0]);
+  map.erase (*elements[20]);
+  map.eraseIf ([](const std::string& s) { return s.size () == 2 && s[0] != '1'; });
+  assert (equals (map, {"1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "11", "12", "13", "14",
+                        "15", "16", "17", "18", "19"}));
+  assert (&map[16] == elements[17]);
+  assert (map.contains (*elements[17]));
+
+  std::string& replaced = map.replace (*elements[5], "five");
+  assert (&replaced == elements[5]);
+  assert (map[4] == "five");
+
+  // slots of erased elements are reused and new elements are appended
+  std::string& added = map.emplace ("new");
+  assert (&map.back () == &added);
+  assert (map.size () == 20);
+
+  map.erase (map[0]);
+  assert (map[0] == "2");
+  assert (&map[15] == elements[17]);
+
+  map.clear ();
+  assert (map.isEmpty ());
+  unused (replaced);
+}
@@ -0,0 +1,67 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <vector>
+#include "test-thread-pool.hpp"
+#include "thread-pool.hpp"
+#include "util.hpp"
+
+void TestThreadPool::test ()
+{
+  ThreadPool pool (4);
+  assert (pool.numThreads () == 4);
+
+  std::vector<unsigned int> visits (10000, 0);
+  std::atomic<unsigned int> numNested (0);
+
+  const auto visit = [&](unsigned int begin, unsigned int end) {
+    for (unsigned int j = begin; j < end; j++)
+    {
+      visits[j]++;
+    }
+    pool.parallelFor (3, 1, [&numNested](unsigned int, unsigned int) { numNested++; });
+  };
+
+  for (unsigned int i = 0; i < 3; i++)
+  {
+    const bool completed = pool.parallelFor (visits.size (), 7, visit);
+    assert (completed);
+    unused (completed);
+  }
+  assert (std::all_of (visits.begin (), visits.end (), [](unsigned int v) { return v == 3; }));
+  assert (numNested == 3 * 3 * ((visits.size () + 6) / 7));
+
+  CancellationToken         token;
+  std::atomic<unsigned int> numChunks (0);
+
+  const auto countChunks = [&numChunks, &token](unsigned int, unsigned int) {
+    if (++numChunks == 10)
+    {
+      token.cancel ();
+    }
+  };
+
+  const bool completed = pool.parallelFor (1000, 1, countChunks, &token);
+  assert (completed == false);
+  unused (completed);
+  assert (numChunks < 1000);
+  assert (ThreadPool::global ().numThreads () > 0);
+
+  // serial scopes run all chunks on the calling thread
+  {
+    ThreadPool::SerialScope serial;
+    const std::thread::id   id = std::this_thread::get_id ();
+    bool                    isSerial = true;
+
+    pool.parallelFor (1000, 1, [&id, &isSerial](unsigned int, unsigned int) {
+      isSerial = isSerial && std::this_thread::get_id () == id;
+    });
+    assert (isSerial);
+    unused (isSerial);
+  }
+}
@@ -3,6 +3,7 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <cassert>
+#include <vector>
 #include "test-tree.hpp"
 #include "tree.hpp"
 
@@ -102,3 +103,70 @@ void TestTree::test3 ()
   assert (t3.root ().data () == 1);
   assert (t3.root ().lastChild ().data () == 2);
 }
+
+void TestTree::test4 ()
+{
+  Tree<int> t;
+
+  TreeNode<int>& n1 = t.emplaceRoot (1);
+  n1.emplaceChild (10);
+  TreeNode<int>& n2 = n1.emplaceChild (2);
+  n1.emplaceChild (11);
+  n2.emplaceChild (20);
+  TreeNode<int>& n3 = n2.emplaceChild (3);
+
+  t.rebalance (n3);
+
+  std::vector<int> data;
+  t.root ().forEachConstNode ([&data](const TreeNode<int>& n) { data.push_back (n.data ()); });
+
+  assert ((data == std::vector<int>{3, 2, 20, 1, 10, 11}));
+  assert (t.root ().parent () == nullptr);
+
+  t.root ().forEachConstNode ([](const TreeNode<int>& n) {
+    n.forEachConstChild ([&n](const TreeNode<int>& c) { assert (c.parent () == &n); });
+  });
+
+  Tree<int> copy (t);
+  t.reset ();
+
+  assert (copy.root ().numNodes () == 6);
+  assert (copy.root ().lastChild ().lastChild ().parent () == &copy.root ().lastChild ());
+}
+
+void TestTree::test5 ()
+{
+  Tree<int> t;
+
+  TreeNode<int>& n1 = t.emplaceRoot (1);
+  TreeNode<int>& n2 = n1.emplaceChild (2);
+  n2.emplaceChild (20);
+  n2.emplaceChild (21);
+  n1.emplaceChild (3).emplaceChild (30);
+
+  FlatTree<int> flat (t);
+
+  assert ((flat.data () == std::vector<int>{1, 2, 20, 21, 3, 30}));
+  assert (flat.parent (0) == Util::invalidIndex ());
+  assert (flat.parent (1) == 0);
+  assert (flat.parent (2) == 1);
+  assert (flat.parent (3) == 1);
+  assert (flat.parent (4) == 0);
+  assert (flat.parent (5) == 4);
+  assert (flat.subtreeEnd (0) == 6);
+  assert (flat.subtreeEnd (1) == 4);
+  assert (flat.subtreeEnd (2) == 3);
+  assert (flat.subtreeEnd (4) == 6);
+
+  Tree<int> copy = flat.toTree ();
+  t.reset ();
+
+  std::vector<int> data;
+  copy.root ().forEachConstNode ([&data](const TreeNode<int>& n) { data.push_back (n.data ()); });
+
+  assert ((data == flat.data ()));
+  assert (copy.root ().lastChild ().lastChild ().parent () == &copy.root ().lastChild ());
+
+  flat.assign (t);
+  assert (flat.isEmpty ());
+}
@@ -10,6 +10,8 @@ namespace TestTree
   void test1 ();
   void test2 ();
   void test3 ();
+  void test4 ();
+  void test5 ();
 }
 
 #endif
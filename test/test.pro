@@ -9,22 +9,42 @@ INCLUDEPATH    += src $$PWD/../lib/src
 SOURCES += \
            src/main.cpp \
            src/test-bitset.cpp \
+           src/test-change-journal.cpp \
            src/test-distance.cpp \
+           src/test-edge-map.cpp \
+           src/test-faces.cpp \
+           src/test-import-export.cpp \
            src/test-intersection.cpp \
+           src/test-isosurface-extraction.cpp \
+           src/test-kvstore.cpp \
+           src/test-layers.cpp \
            src/test-maybe.cpp \
            src/test-misc.cpp \
            src/test-octree.cpp \
+           src/test-parallel.cpp \
            src/test-prune.cpp \
+           src/test-slot-map.cpp \
+           src/test-thread-pool.cpp \
            src/test-tree.cpp
 
 HEADERS += \
            src/test-bitset.hpp \
+           src/test-change-journal.hpp \
            src/test-distance.hpp \
+           src/test-edge-map.hpp \
+           src/test-faces.hpp \
+           src/test-import-export.hpp \
            src/test-intersection.hpp \
+           src/test-isosurface-extraction.hpp \
+           src/test-kvstore.hpp \
+           src/test-layers.hpp \
            src/test-maybe.hpp \
            src/test-misc.hpp \
            src/test-octree.hpp \
+           src/test-parallel.hpp \
            src/test-prune.hpp \
+           src/test-slot-map.hpp \
+           src/test-thread-pool.hpp \
            src/test-tree.hpp
 
 win32:CONFIG(release, debug|release):    LIBS += -L$$OUT_PWD/../lib/release/ -ldilay